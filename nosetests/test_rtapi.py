@@ -45,5 +45,16 @@ def test_unloadrt_or2():
     rt.delthread("servo-thread")
     rt.unloadrt("or2")
 
+
+def test_newthread_timing():
+    rt.newthread("sampled-thread", 1000000, fp=True,
+                 timing=rtapi.TT_SAMPLED, timing_arg=10)
+    rt.delthread("sampled-thread")
+    try:
+        rt.newthread("bad-thread", 1000000, timing=rtapi.TT_OFF + 1)
+        raise AssertionError("newthread accepted a bad timing policy")
+    except RuntimeError:
+        pass
+
 (lambda s=__import__('signal'):
     s.signal(s.SIGTERM, s.SIG_IGN))()
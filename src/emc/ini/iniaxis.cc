@@ -39,6 +39,7 @@
   UNITS <float>                units per mm or deg
   MAX_VELOCITY <float>         max vel for axis
   MAX_ACCELERATION <float>     max accel for axis
+  MAX_JERK <float>             max jerk for axis, 0 = not limited
   BACKLASH <float>             backlash
   INPUT_SCALE <float> <float>  scale, offset
   OUTPUT_SCALE <float> <float> scale, offset
@@ -73,6 +74,7 @@
   emcAxisDeactivate(int axis);
   emcAxisSetMaxVelocity(int axis, double vel);
   emcAxisSetMaxAcceleration(int axis, double acc);
+  emcAxisSetMaxJerk(int axis, double jerk);
   emcAxisLoadComp(int axis, const char * file);
   emcAxisLoadComp(int axis, const char * file);
   */
@@ -101,6 +103,7 @@ static int loadAxis(int axis, EmcIniFile *axisIniFile)
     int comp_file_type; //type for the compensation file. type==0 means nom, forw, rev. 
     double maxVelocity;
     double maxAcceleration;
+    double maxJerk;
     double ferror;
 
     // compose string to match, axis = 0 -> AXIS_0, etc.
@@ -254,6 +257,16 @@ static int loadAxis(int axis, EmcIniFile *axisIniFile)
 
         old_inihal_data.max_acceleration[axis] = maxAcceleration;
 
+        maxJerk = DEFAULT_AXIS_MAX_JERK;
+        axisIniFile->Find(&maxJerk, "MAX_JERK", axisString);
+
+        if (0 != emcAxisSetMaxJerk(axis, maxJerk)) {
+            if (emc_debug & EMC_DEBUG_CONFIG) {
+                rcs_print_error("bad return from emcAxisSetMaxJerk\n");
+            }
+            return -1;
+        }
+
         comp_file_type = 0;             // default
         axisIniFile->Find(&comp_file_type, "COMP_FILE_TYPE", axisString);
 
@@ -29,7 +29,7 @@
 #include "posemath.h"
 #include "hal.h"
 
-#define VTVERSION VTKINEMATICS_VERSION1
+#define VTVERSION VTKINEMATICS_VERSION2
 
 struct hal_joint_t {
   hal_bit_t *homed;
@@ -25,7 +25,7 @@ struct data {
 
 char *coordinates = "XYZABC";
 RTAPI_MP_STRING(coordinates, "Mapping from axes to joints");
-#define VTVERSION VTKINEMATICS_VERSION1
+#define VTVERSION VTKINEMATICS_VERSION2
 
 MODULE_LICENSE("GPL");
 
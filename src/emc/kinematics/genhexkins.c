@@ -54,7 +54,7 @@
 #include "genhexkins.h"
 #include "kinematics.h"             /* these decls, KINEMATICS_FORWARD_FLAGS */
 
-#define VTVERSION VTKINEMATICS_VERSION1
+#define VTVERSION VTKINEMATICS_VERSION2
 
 /******************************* MatInvert() ***************************/
 
@@ -27,7 +27,6 @@
   TODO:
     * make number of joints a loadtime parameter
     * add HAL pins for all settable parameters, including joint type: ANGULAR / LINEAR
-    * add HAL pins for debug data (num_iterations)
     * add HAL pins for ULAPI compiled version
 */
 
@@ -47,6 +46,10 @@ struct haldata {
     hal_float_t *a[GENSER_MAX_JOINTS];
     hal_float_t *alpha[GENSER_MAX_JOINTS];
     hal_float_t *d[GENSER_MAX_JOINTS];
+    hal_s32_t *iterations;	// iterations used by the last inverse kins
+    hal_float_t *residual;	// Cartesian error left after them
+    hal_float_t *damping;	// damped least squares factor, 0 = undamped
+    hal_bit_t *warm_start;	// extrapolate the estimate along a path
     genser_struct *kins;
     go_pose *pos;		// used in various functions, we malloc it
 				// only once in rtapi_app_main
@@ -66,6 +69,16 @@ double j[GENSER_MAX_JOINTS];
 
 enum { GENSER_DEFAULT_MAX_ITERATIONS = 100 };
 
+/* default for genserkins.damping, the damping of the steps taken where
+   the plain Newton-Raphson step is singular or larger than
+   GENSER_DAMPED_STEP (radians or length units) */
+#define GENSER_DEFAULT_DAMPING 0.01
+#define GENSER_DAMPED_STEP 0.2
+
+/* largest joint step (radians) between the last two solutions which is
+   still extrapolated by the warm start */
+#define GENSER_WARM_START_MAX_STEP 0.1
+
 int genser_kin_init(void) {
     genser_struct *genser = KINS_PTR;
     int t;
@@ -224,6 +237,126 @@ static int compute_jinv(go_matrix * Jfwd, go_matrix * Jinv)
     return GO_RESULT_OK;
 }
 
+static int link_pose(const go_link * link, go_pose * pose)
+{
+    if (GO_LINK_DH == link->type) {
+	go_dh_pose_convert(&link->u.dh, pose);
+    } else if (GO_LINK_PP == link->type) {
+	*pose = link->u.pp.pose;
+    } else {
+	return GO_RESULT_IMPL_ERROR;
+    }
+    return GO_RESULT_OK;
+}
+
+static void mat_array_convert(const go_mat * m, go_real R[3][3])
+{
+    R[0][0] = m->x.x, R[0][1] = m->y.x, R[0][2] = m->z.x;
+    R[1][0] = m->x.y, R[1][1] = m->y.y, R[1][2] = m->z.y;
+    R[2][0] = m->x.z, R[2][1] = m->y.z, R[2][2] = m->z.z;
+}
+
+/* compute_jfwd() for exactly 6 links, on fixed size arrays.
+   Saves the go_matrix setup and the generic loops of the go_matrix_*
+   functions, and only transforms the columns filled in so far.
+   T_L_0 is the forward kinematics of the links as a by-product. */
+static int compute_jfwd6(const go_link * link_params,
+			 go_real Jfwd[6][6],
+			 go_pose * T_L_0)
+{
+    go_real Jv[3][6], Jw[3][6], R[3][3];
+    go_real v[3], w[3];
+    go_pose pose;
+    go_quat quat;
+    go_mat mat;
+    int row, col, k;
+
+    for (row = 0; row < 3; row++) {
+	for (col = 0; col < 6; col++) {
+	    Jv[row][col] = 0;
+	    Jw[row][col] = 0;
+	}
+    }
+
+    if (GO_RESULT_OK != link_pose(&link_params[0], &pose))
+	return GO_RESULT_IMPL_ERROR;
+    *T_L_0 = pose;
+    Jv[2][0] = (GO_QUANTITY_LENGTH == link_params[0].quantity ? 1 : 0);
+    Jw[2][0] = (GO_QUANTITY_ANGLE == link_params[0].quantity ? 1 : 0);
+
+    for (col = 1; col < 6; col++) {
+	if (GO_RESULT_OK != link_pose(&link_params[col], &pose))
+	    return GO_RESULT_IMPL_ERROR;
+	go_quat_inv(&pose.rot, &quat);
+	go_quat_mat_convert(&quat, &mat);
+	mat_array_convert(&mat, R);
+
+	/* Jv = R_i_ip1 (Jv + Jw x P_ip1_i), Jw = R_i_ip1 Jw */
+	for (k = 0; k < col; k++) {
+	    v[0] = Jv[0][k] + Jw[1][k] * pose.tran.z - Jw[2][k] * pose.tran.y;
+	    v[1] = Jv[1][k] + Jw[2][k] * pose.tran.x - Jw[0][k] * pose.tran.z;
+	    v[2] = Jv[2][k] + Jw[0][k] * pose.tran.y - Jw[1][k] * pose.tran.x;
+	    w[0] = Jw[0][k], w[1] = Jw[1][k], w[2] = Jw[2][k];
+	    for (row = 0; row < 3; row++) {
+		Jv[row][k] = R[row][0] * v[0] + R[row][1] * v[1] + R[row][2] * v[2];
+		Jw[row][k] = R[row][0] * w[0] + R[row][1] * w[1] + R[row][2] * w[2];
+	    }
+	}
+	Jv[2][col] = (GO_QUANTITY_LENGTH == link_params[col].quantity ? 1 : 0);
+	Jw[2][col] = (GO_QUANTITY_ANGLE == link_params[col].quantity ? 1 : 0);
+
+	go_pose_pose_mult(T_L_0, &pose, T_L_0);
+    }
+
+    /* rotate back into {0} frame, Jv atop Jw */
+    go_quat_mat_convert(&T_L_0->rot, &mat);
+    mat_array_convert(&mat, R);
+    for (k = 0; k < 6; k++) {
+	for (row = 0; row < 3; row++) {
+	    Jfwd[row][k] = R[row][0] * Jv[0][k] + R[row][1] * Jv[1][k] + R[row][2] * Jv[2][k];
+	    Jfwd[row + 3][k] = R[row][0] * Jw[0][k] + R[row][1] * Jw[1][k] + R[row][2] * Jw[2][k];
+	}
+    }
+
+    return GO_RESULT_OK;
+}
+
+/* the joint step dj for the Cartesian error dvw.
+   lambda == 0: solve Jfwd dj = dvw.
+   lambda > 0: damped least squares, dj = JT (J JT + lambda^2 I)inv dvw,
+   which stays bounded near singularities at the price of slower
+   convergence there. */
+static int compute_step6(go_real Jfwd[6][6], const go_real dvw[6],
+			 go_real lambda, go_real dj[6])
+{
+    go_real JJT[6][6];
+    go_real y[6];
+    int row, col, k;
+    int retval;
+
+    if (lambda <= 0)
+	return go_mat6_solve(Jfwd, dvw, dj);
+
+    for (row = 0; row < 6; row++) {
+	for (col = row; col < 6; col++) {
+	    JJT[row][col] = 0;
+	    for (k = 0; k < 6; k++)
+		JJT[row][col] += Jfwd[row][k] * Jfwd[col][k];
+	    JJT[col][row] = JJT[row][col];
+	}
+	JJT[row][row] += lambda * lambda;
+    }
+    retval = go_mat6_solve(JJT, dvw, y);
+    if (GO_RESULT_OK != retval)
+	return retval;
+    for (k = 0; k < 6; k++) {
+	dj[k] = 0;
+	for (row = 0; row < 6; row++)
+	    dj[k] += Jfwd[row][k] * y[row];
+    }
+    return GO_RESULT_OK;
+}
+
 int genser_kin_jac_inv(void *kins,
     const go_pose * pos,
     const go_screw * vel, const go_real * joints, go_real * jointvels)
@@ -384,21 +517,24 @@ int genser_kin_fwd(void *kins, const go_real * joints, go_pose * pos)
     return GO_RESULT_OK;
 }
 
-int kinematicsInverse(const EmcPose * world,
-		      double *joints,
-		      const KINEMATICS_INVERSE_FLAGS * iflags,
-		      KINEMATICS_FORWARD_FLAGS * fflags)
+/* Newton-Raphson iteration on the joint estimate jest[] (radians) until
+   the joint increments get small.
+   fixed selects the 6x6 specialization, which needs link_num == 6.
+   If lambda > 0 it takes damped least squares steps near singularities.
+   The go_matrix version handles any number of links, undamped. */
+static int genser_kin_inv_solve(genser_struct * genser,
+				const go_pose * pos,
+				go_real * jest,
+				go_real lambda,
+				int fixed,
+				go_real * residual)
 {
-
-    genser_struct *genser = KINS_PTR;
     GO_MATRIX_DECLARE(Jfwd, Jfwd_stg, 6, GENSER_MAX_JOINTS);
     GO_MATRIX_DECLARE(Jinv, Jinv_stg, GENSER_MAX_JOINTS, 6);
-    go_pose T_L_0;
+    go_real J6[6][6];
     go_real dvw[6];
-    go_real jest[GENSER_MAX_JOINTS];
     go_real dj[GENSER_MAX_JOINTS];
-    go_pose pest, pestinv, Tdelta;	// pos = converted pose from EmcPose
-    go_rpy rpy;
+    go_pose pest, pestinv, Tdelta;
     go_rvec rvec;
     go_cart cart;
     go_link linkout[GENSER_MAX_JOINTS];
@@ -406,49 +542,23 @@ int kinematicsInverse(const EmcPose * world,
     int smalls;
     int retval;
 
-//    rtapi_print("kineInverse(joints: %f %f %f %f %f %f)\n", joints[0],joints[1],joints[2],joints[3],joints[4],joints[5]);
-//    rtapi_print("kineInverse(world: %f %f %f %f %f %f)\n", world->tran.x, world->tran.y, world->tran.z, world->a, world->b, world->c);
-
-//    genser_kin_init();
-    
-    // FIXME-AJ: rpy or zyx ?
-    rpy.y = world->c * PM_PI / 180;
-    rpy.p = world->b * PM_PI / 180;
-    rpy.r = world->a * PM_PI / 180;
-
-    go_rpy_quat_convert(&rpy, &haldata->pos->rot);
-    haldata->pos->tran.x = world->tran.x;
-    haldata->pos->tran.y = world->tran.y;
-    haldata->pos->tran.z = world->tran.z;
-
     go_matrix_init(Jfwd, Jfwd_stg, 6, genser->link_num);
     go_matrix_init(Jinv, Jinv_stg, genser->link_num, 6);
 
-    /* jest[] is a copy of joints[], which is the joint estimate */
-    for (link = 0; link < genser->link_num; link++) {
-	// jest, and the rest of joint related calcs are in radians
-	jest[link] = joints[link] * (PM_PI / 180);
-    }
-
     for (genser->iterations = 0; genser->iterations < genser->max_iterations; genser->iterations++) {
 	/* update the Jacobians */
 	for (link = 0; link < genser->link_num; link++) {
 	    go_link_joint_set(&genser->links[link], jest[link], &linkout[link]);
 	}
-	retval = compute_jfwd(linkout, genser->link_num, &Jfwd, &T_L_0);
-	if (GO_RESULT_OK != retval) {
-	    rtapi_print("ERR kI - compute_jfwd (joints: %f %f %f %f %f %f), (iterations=%d)\n", joints[0],joints[1],joints[2],joints[3],joints[4],joints[5], genser->iterations);
-	    return retval;
-	}
-	retval = compute_jinv(&Jfwd, &Jinv);
-	if (GO_RESULT_OK != retval) {
-	    rtapi_print("ERR kI - compute_jinv (joints: %f %f %f %f %f %f), (iterations=%d)\n", joints[0],joints[1],joints[2],joints[3],joints[4],joints[5], genser->iterations);
+	/* pest is the resulting pose estimate given joint estimate,
+	   it falls out of the Jacobian computation */
+	if (fixed)
+	    retval = compute_jfwd6(linkout, J6, &pest);
+	else
+	    retval = compute_jfwd(linkout, genser->link_num, &Jfwd, &pest);
+	if (GO_RESULT_OK != retval)
 	    return retval;
-	}
 
-	/* pest is the resulting pose estimate given joint estimate */
-	genser_kin_fwd(KINS_PTR, jest, &pest);
-//	printf("jest: %f %f %f %f %f %f\n",jest[0],jest[1],jest[2],jest[3],jest[4],jest[5]);
 	/* pestinv is its inverse */
 	go_pose_inv(&pest, &pestinv);
 	/*
@@ -462,33 +572,54 @@ int kinematicsInverse(const EmcPose * world,
 	    .Tdelta =  pestinv *  pos
 	    L         0          L
 	*/
-	go_pose_pose_mult(&pestinv, haldata->pos, &Tdelta);
+	go_pose_pose_mult(&pestinv, pos, &Tdelta);
 
 	/*
 	    We need Tdelta in 0 frame, not pest frame, so rotate it
-    	    back. Since it's effectively a velocity, we just rotate it, and
-    	    don't translate it.
-        */
-
-        /* first rotate the translation differential */
-        go_quat_cart_mult(&pest.rot, &Tdelta.tran, &cart);
-        dvw[0] = cart.x;
-        dvw[1] = cart.y;
-        dvw[2] = cart.z;
-
-        /* to rotate the rotation differential, convert it to a
-    	    velocity screw and rotate that */
-        go_quat_rvec_convert(&Tdelta.rot, &rvec);
-        cart.x = rvec.x;
-        cart.y = rvec.y;
-        cart.z = rvec.z;
-        go_quat_cart_mult(&pest.rot, &cart, &cart);
-        dvw[3] = cart.x;
-        dvw[4] = cart.y;
-        dvw[5] = cart.z;
+	    back. Since it's effectively a velocity, we just rotate it, and
+	    don't translate it.
+	*/
+
+	/* first rotate the translation differential */
+	go_quat_cart_mult(&pest.rot, &Tdelta.tran, &cart);
+	dvw[0] = cart.x;
+	dvw[1] = cart.y;
+	dvw[2] = cart.z;
+
+	/* to rotate the rotation differential, convert it to a
+	    velocity screw and rotate that */
+	go_quat_rvec_convert(&Tdelta.rot, &rvec);
+	cart.x = rvec.x;
+	cart.y = rvec.y;
+	cart.z = rvec.z;
+	go_quat_cart_mult(&pest.rot, &cart, &cart);
+	dvw[3] = cart.x;
+	dvw[4] = cart.y;
+	dvw[5] = cart.z;
+
+	*residual = rtapi_sqrt(dvw[0] * dvw[0] + dvw[1] * dvw[1] + dvw[2] * dvw[2] +
+			       dvw[3] * dvw[3] + dvw[4] * dvw[4] + dvw[5] * dvw[5]);
 
 	/* push the Cartesian velocity vector through the inverse Jacobian */
-	go_matrix_vector_mult(&Jinv, dvw, dj);
+	if (fixed) {
+	    retval = compute_step6(J6, dvw, 0, dj);
+	    if (lambda > 0) {
+		/* damping slows down convergence, only use it where the
+		   plain step goes wild */
+		for (link = 0; GO_RESULT_OK == retval && link < 6; link++) {
+		    if (rtapi_fabs(dj[link]) > GENSER_DAMPED_STEP)
+			break;
+		}
+		if (link < 6)
+		    retval = compute_step6(J6, dvw, lambda, dj);
+	    }
+	} else {
+	    retval = compute_jinv(&Jfwd, &Jinv);
+	    if (GO_RESULT_OK == retval)
+		retval = go_matrix_vector_mult(&Jinv, dvw, dj);
+	}
+	if (GO_RESULT_OK != retval)
+	    return retval;
 
 	/* check for small joint increments, if so we're done */
 	for (link = 0, smalls = 0; link < genser->link_num; link++) {
@@ -500,25 +631,131 @@ int kinematicsInverse(const EmcPose * world,
 		    smalls++;
 	    }
 	}
-	if (smalls == genser->link_num) {
-	    /* converged, copy jest[] out */
-	    for (link = 0; link < genser->link_num; link++) {
-		// convert from radians back to angles
-		joints[link] = jest[link] * 180 / PM_PI;
-	    }
-//	    rtapi_print("DONEkineInverse(joints: %f %f %f %f %f %f), (iterations=%d)\n", joints[0],joints[1],joints[2],joints[3],joints[4],joints[5], genser->iterations);
+	if (smalls == genser->link_num)
 	    return GO_RESULT_OK;
-	}
+
 	/* else keep iterating */
 	for (link = 0; link < genser->link_num; link++) {
 	    jest[link] += dj[link]; //still in radians
 	}
     }				/* for (iterations) */
 
-    rtapi_print("ERRkineInverse(joints: %f %f %f %f %f %f), (iterations=%d)\n", joints[0],joints[1],joints[2],joints[3],joints[4],joints[5], genser->iterations);
     return GO_RESULT_ERROR;
 }
 
+/* inverse kins with the EMC conventions: joints[] in degrees is the
+   initial estimate and receives the solution.
+   reference = 1 solves the way genserkins always did (go_matrix, no
+   damping, no warm start), for comparing against in the benchmark. */
+static int genser_inverse(const EmcPose * world, double *joints, int reference)
+{
+    genser_struct *genser = KINS_PTR;
+    genser_history *hist = NULL;
+    go_real jest[GENSER_MAX_JOINTS];
+    go_real jstart[GENSER_MAX_JOINTS];
+    go_rpy rpy;
+    go_real residual = 0;
+    int fixed, warm = 0;
+    int link, h;
+    int retval;
+
+    /* no genser_kin_init() here, the links are set up once and
+       kinematicsForward(), which motion runs every servo cycle, picks up
+       changes of the DH pins */
+
+    // FIXME-AJ: rpy or zyx ?
+    rpy.y = world->c * PM_PI / 180;
+    rpy.p = world->b * PM_PI / 180;
+    rpy.r = world->a * PM_PI / 180;
+
+    go_rpy_quat_convert(&rpy, &haldata->pos->rot);
+    haldata->pos->tran.x = world->tran.x;
+    haldata->pos->tran.y = world->tran.y;
+    haldata->pos->tran.z = world->tran.z;
+
+    /* jest[] is a copy of joints[], which is the joint estimate */
+    for (link = 0; link < genser->link_num; link++) {
+	// jest, and the rest of joint related calcs are in radians
+	jest[link] = joints[link] * (PM_PI / 180);
+	jstart[link] = jest[link];
+    }
+
+    /* warm start: motion passes the previous solution as the estimate;
+       along a path the next solution is closer to the linear
+       extrapolation of the last two. Each caller finds its own history
+       by that estimate, so callers don't extrapolate from each other's
+       solutions. */
+    for (h = 0; !reference && h < GENSER_HISTORIES && !hist; h++) {
+	if (genser->history[h].solutions < 1)
+	    continue;
+	for (link = 0; link < genser->link_num; link++) {
+	    if (!GO_ROT_CLOSE(jest[link], genser->history[h].last[link]))
+		break;
+	}
+	if (link == genser->link_num)
+	    hist = &genser->history[h];
+    }
+    if (hist && *(haldata->warm_start) && hist->solutions >= 2) {
+	for (link = 0; link < genser->link_num; link++) {
+	    if (rtapi_fabs(hist->last[link] - hist->prev[link]) > GENSER_WARM_START_MAX_STEP)
+		break;
+	}
+	if (link == genser->link_num) {
+	    for (link = 0; link < genser->link_num; link++)
+		jest[link] = 2 * hist->last[link] - hist->prev[link];
+	    warm = 1;
+	}
+    }
+
+    fixed = !reference && (genser->link_num == 6);
+    retval = genser_kin_inv_solve(genser, haldata->pos, jest,
+				  *(haldata->damping), fixed, &residual);
+    if (GO_RESULT_OK != retval && warm) {
+	/* the extrapolation was off, start over from the estimate */
+	for (link = 0; link < genser->link_num; link++)
+	    jest[link] = jstart[link];
+	retval = genser_kin_inv_solve(genser, haldata->pos, jest,
+				      *(haldata->damping), fixed, &residual);
+    }
+    *(haldata->iterations) = genser->iterations;
+    *(haldata->residual) = residual;
+
+    if (GO_RESULT_OK != retval) {
+	if (hist)
+	    hist->solutions = 0;
+	rtapi_print("ERRkineInverse(joints: %f %f %f %f %f %f), (iterations=%d, result=%d)\n", joints[0],joints[1],joints[2],joints[3],joints[4],joints[5], genser->iterations, retval);
+	return retval;
+    }
+
+    /* a caller seen for the first time takes over the oldest history */
+    if (!reference && !hist) {
+	hist = &genser->history[genser->history_next];
+	genser->history_next = (genser->history_next + 1) % GENSER_HISTORIES;
+	hist->solutions = 0;
+    }
+
+    /* converged, copy jest[] out */
+    for (link = 0; link < genser->link_num; link++) {
+	// convert from radians back to angles
+	joints[link] = jest[link] * 180 / PM_PI;
+	if (hist) {
+	    hist->prev[link] = hist->last[link];
+	    hist->last[link] = jest[link];
+	}
+    }
+    if (hist && hist->solutions < 2)
+	hist->solutions++;
+    return GO_RESULT_OK;
+}
+
+int kinematicsInverse(const EmcPose * world,
+		      double *joints,
+		      const KINEMATICS_INVERSE_FLAGS * iflags,
+		      KINEMATICS_FORWARD_FLAGS * fflags)
+{
+    return genser_inverse(world, joints, 0);
+}
+
 /*
   Extras, not callable using go_kin_ wrapper but if you know you have
   linked in these kinematics, go ahead and call these for your ad hoc
@@ -604,12 +841,34 @@ int rtapi_app_main(void)
         *(haldata->d[i])=0;
     }
 
+    if ((res =
+	    hal_pin_s32_newf(HAL_OUT, &(haldata->iterations), comp_id,
+		"genserkins.iterations")) < 0)
+	goto error;
+    if ((res =
+	    hal_pin_float_newf(HAL_OUT, &(haldata->residual), comp_id,
+		"genserkins.residual")) < 0)
+	goto error;
+    if ((res =
+	    hal_pin_float_newf(HAL_IN, &(haldata->damping), comp_id,
+		"genserkins.damping")) < 0)
+	goto error;
+    *(haldata->damping) = GENSER_DEFAULT_DAMPING;
+    if ((res =
+	    hal_pin_bit_newf(HAL_IN, &(haldata->warm_start), comp_id,
+		"genserkins.warm-start")) < 0)
+	goto error;
+    *(haldata->warm_start) = 1;
+
     KINS_PTR = hal_malloc(sizeof(genser_struct));
     haldata->pos = (go_pose *) hal_malloc(sizeof(go_pose));
     if (KINS_PTR == NULL)
 	goto error;
     if (haldata->pos == NULL)
 	goto error;
+    for (i = 0; i < GENSER_HISTORIES; i++)
+	KINS_PTR->history[i].solutions = 0;
+    KINS_PTR->history_next = 0;
     if ((res=
         hal_param_s32_newf(HAL_RO, &(KINS_PTR->iterations), comp_id, "genserkins.last-iterations")) < 0)
         goto error;
@@ -638,13 +897,14 @@ int rtapi_app_main(void)
     D(3) = DEFAULT_D4;
     D(4) = DEFAULT_D5;
     D(5) = DEFAULT_D6;
+    genser_kin_init();
 
-    vtable_id = hal_export_vtable(name, VTKINEMATICS_VERSION1, &vtk, comp_id);
+    vtable_id = hal_export_vtable(name, VTKINEMATICS_VERSION2, &vtk, comp_id);
 
     if (vtable_id < 0) {
 	rtapi_print_msg(RTAPI_MSG_ERR,
 			"%s: ERROR: hal_export_vtable(%s,%d,%p) failed: %d\n",
-			name, name,  VTKINEMATICS_VERSION1, &vtk, vtable_id );
+			name, name,  VTKINEMATICS_VERSION2, &vtk, vtable_id );
 	return -ENOENT;
     }
     hal_ready(comp_id);
@@ -680,6 +940,105 @@ static double timestamp()
     return ((double) tp.tv_sec) + ((double) tp.tv_usec) / 1000000.0;
 }
 
+/* the next point of a recorded path, one line of 6 joint positions
+   (degrees) each, or of a generated one which moves all joints and
+   passes the wrist singularity (joint 4 at 0) a few times */
+static int next_point(FILE *path, int n, int points, double *joints)
+{
+    char buffer[BUFFERLEN];
+    double t;
+    int i;
+
+    if (path != NULL) {
+	while (NULL != fgets(buffer, BUFFERLEN, path)) {
+	    if (6 == sscanf(buffer, "%lf %lf %lf %lf %lf %lf",
+			    &joints[0], &joints[1], &joints[2],
+			    &joints[3], &joints[4], &joints[5]))
+		return 1;
+	}
+	return 0;
+    }
+    if (n >= points)
+	return 0;
+    t = (double) n / points;
+    for (i = 0; i < 6; i++)
+	joints[i] = 20 + 40 * rtapi_sin(2 * PM_PI * (i + 1) * t + i);
+    joints[4] = 30 * rtapi_sin(6 * PM_PI * t + 1);
+    return 1;
+}
+
+struct bench_stats {
+    int solved, failed;
+    long iterations;
+    int max_iterations;
+    double time;
+    double max_error;		// largest deviation from the path, degrees
+};
+
+static void bench_solve(struct bench_stats *st, const EmcPose *world,
+			const double *target, double *joints, int reference)
+{
+    double start = timestamp();
+    int i;
+
+    if (0 == genser_inverse(world, joints, reference))
+	st->solved++;
+    else
+	st->failed++;
+    st->time += timestamp() - start;
+    st->iterations += KINS_PTR->iterations;
+    if (KINS_PTR->iterations > st->max_iterations)
+	st->max_iterations = KINS_PTR->iterations;
+    for (i = 0; i < 6; i++) {
+	if (rtapi_fabs(joints[i] - target[i]) > st->max_error)
+	    st->max_error = rtapi_fabs(joints[i] - target[i]);
+    }
+}
+
+static void bench_report(const char *name, const struct bench_stats *st)
+{
+    int n = st->solved + st->failed;
+
+    printf("%-9s points %d failed %d iterations mean %.2f max %d, %.2f us/point, "
+	   "largest error against the path %g deg\n",
+	   name, n, st->failed, (double) st->iterations / n,
+	   st->max_iterations, st->time * 1e6 / n, st->max_error);
+}
+
+/* run the inverse kins along a path, starting each point from the
+   previous solution like motion does, once the way genserkins always
+   did and once with the 6x6 solver, and compare the results.
+   An error against the path of a multiple of 360 degrees is a solver
+   which jumped to another turn of a joint near a singularity. */
+static int benchmark(FILE *path, int points)
+{
+    struct bench_stats ref = {0}, fast = {0};
+    double target[6], jref[6], jfast[6];
+    KINEMATICS_INVERSE_FLAGS iflags = 0;
+    KINEMATICS_FORWARD_FLAGS fflags = 0;
+    EmcPose world;
+    int n, i;
+
+    for (n = 0; next_point(path, n, points, target); n++) {
+	if (0 != kinematicsForward(target, &world, &fflags, &iflags))
+	    continue;
+	if (n == 0) {
+	    for (i = 0; i < 6; i++)
+		jref[i] = jfast[i] = target[i];
+	}
+	bench_solve(&ref, &world, target, jref, 1);
+	bench_solve(&fast, &world, target, jfast, 0);
+    }
+    if (n == 0) {
+	fprintf(stderr, "no points\n");
+	return 1;
+    }
+    printf("damping %g\n", *(haldata->damping));
+    bench_report("reference", &ref);
+    bench_report("6x6", &fast);
+    return 0;
+}
+
 int main(int argc, char *argv[])
 {
     char buffer[BUFFERLEN];
@@ -699,8 +1058,15 @@ int main(int argc, char *argv[])
     // FIXME-AJ: implement ULAPI HAL version of the pins
     haldata = malloc(sizeof(struct haldata));
 
-    KINS_PTR = malloc(sizeof(genser_struct));
+    KINS_PTR = calloc(1, sizeof(genser_struct));
+    KINS_PTR->max_iterations = GENSER_DEFAULT_MAX_ITERATIONS;
     haldata->pos = (go_pose *) malloc(sizeof(go_pose));
+    haldata->iterations = calloc(1, sizeof(hal_s32_t));
+    haldata->residual = calloc(1, sizeof(hal_float_t));
+    haldata->damping = malloc(sizeof(hal_float_t));
+    *(haldata->damping) = GENSER_DEFAULT_DAMPING;
+    haldata->warm_start = malloc(sizeof(hal_bit_t));
+    *(haldata->warm_start) = 1;
 
     for (i = 0; i < GENSER_MAX_JOINTS ; i++) {
 	haldata->a[i] = malloc(sizeof(double));
@@ -725,6 +1091,26 @@ int main(int argc, char *argv[])
     D(3) = DEFAULT_D4;
     D(4) = DEFAULT_D5;
     D(5) = DEFAULT_D6;
+    genser_kin_init();
+
+    /* genserkins b [points|pathfile] [damping] */
+    if (argc >= 2 && argv[1][0] == 'b') {
+	FILE *path = NULL;
+	int points = 2000;
+
+	if (argc >= 3 && 1 != sscanf(argv[2], "%d", &points)) {
+	    path = fopen(argv[2], "r");
+	    if (path == NULL) {
+		perror(argv[2]);
+		return 1;
+	    }
+	}
+	if (argc >= 4 && 1 != sscanf(argv[3], "%lf", haldata->damping)) {
+	    fprintf(stderr, "bad damping: %s\n", argv[3]);
+	    return 1;
+	}
+	return benchmark(path, points);
+    }
 
     /* syntax is a.out {i|f # # # # # #} */
     if (argc == 8) {
@@ -69,11 +69,23 @@
 #define DEFAULT_ALPHA6 -PI_2
 #define DEFAULT_D6 0
 
+/* callers of the inverse kinematics which keep their own warm start,
+   e.g. the servo thread and a queue time check */
+#define GENSER_HISTORIES 4
+
+typedef struct {
+  go_real last[GENSER_MAX_JOINTS];	/*!< The last inverse kinematics solution, in radians. */
+  go_real prev[GENSER_MAX_JOINTS];	/*!< The one before, for the warm start. */
+  int solutions;		/*!< How many of last[] and prev[] are valid. */
+} genser_history;
+
 typedef struct {
   go_link links[GENSER_MAX_JOINTS]; /*!< The link description of the device. */
   int link_num;		/*!< How many are actually present. */
   hal_s32_t iterations;	/*!< How many iterations were actually used to compute the inverse kinematics. */
   hal_s32_t max_iterations;	/*!< Number of iterations after which to give up and report an error. */
+  genser_history history[GENSER_HISTORIES];	/*!< Recent solutions of each caller, for the warm start. */
+  int history_next;		/*!< The history to reuse for a new caller. */
 } genser_struct;
 
 extern int genser_kin_size(void); 
@@ -126,11 +126,81 @@ typedef int (* vtk_kinematicsHome_t)(struct EmcPose * world,
 
 typedef KINEMATICS_TYPE  (*vtk_kinematicsType_t)(void);
 
+/* the batch kinematics convert n points in one call, e.g. all the
+   interpolated points of a segment for a soft limit check. This saves
+   the call overhead per point and lets the kinematics hoist the
+   parameter reads out of the loop.
+   world[] holds n poses, joints[] n joint sets of stride doubles each;
+   stride must be at least EMCMOT_MAX_JOINTS since the kinematics may
+   write that many.
+   Inverse: the first joint set is the initial estimate of iterative
+   kinematics, every following point starts from the solution of the
+   previous one. The same flags are used for all points.
+   Return the number of points converted, n if all went fine, i < n if
+   point i failed; the points after it are left alone. */
+typedef int (*vtk_kinematicsForwardBatch_t)(const double *joints,
+					  struct EmcPose * world,
+					  int n, int stride,
+					  const KINEMATICS_FORWARD_FLAGS * fflags,
+					  KINEMATICS_INVERSE_FLAGS * iflags);
+
+typedef int (*vtk_kinematicsInverseBatch_t)(const struct EmcPose * world,
+					  double *joints,
+					  int n, int stride,
+					  const KINEMATICS_INVERSE_FLAGS * iflags,
+					  KINEMATICS_FORWARD_FLAGS * fflags);
+
+// VTKINEMATICS_VERSION1 ends after kinematicsType, the batch methods
+// came with VTKINEMATICS_VERSION2 and may be NULL
 typedef struct {
     vtk_kinematicsForward_t kinematicsForward;
     vtk_kinematicsInverse_t kinematicsInverse;
     vtk_kinematicsHome_t    kinematicsHome; // used by drawbotkins
     vtk_kinematicsType_t    kinematicsType;
+    vtk_kinematicsForwardBatch_t kinematicsForwardBatch;
+    vtk_kinematicsInverseBatch_t kinematicsInverseBatch;
 } vtkins_t;
 
+// batch conversion through a kins vtable, point by point for
+// kinematics which do not implement it
+static inline int vtk_forward_batch(const vtkins_t *vtk,
+				    const double *joints,
+				    struct EmcPose * world,
+				    int n, int stride,
+				    const KINEMATICS_FORWARD_FLAGS * fflags,
+				    KINEMATICS_INVERSE_FLAGS * iflags)
+{
+    int i;
+
+    if (vtk->kinematicsForwardBatch)
+	return vtk->kinematicsForwardBatch(joints, world, n, stride, fflags, iflags);
+    for (i = 0; i < n; i++) {
+	if (vtk->kinematicsForward(joints + i * stride, world + i, fflags, iflags))
+	    return i;
+    }
+    return n;
+}
+
+static inline int vtk_inverse_batch(const vtkins_t *vtk,
+				    const struct EmcPose * world,
+				    double *joints,
+				    int n, int stride,
+				    const KINEMATICS_INVERSE_FLAGS * iflags,
+				    KINEMATICS_FORWARD_FLAGS * fflags)
+{
+    int i, j;
+
+    if (vtk->kinematicsInverseBatch)
+	return vtk->kinematicsInverseBatch(world, joints, n, stride, iflags, fflags);
+    for (i = 0; i < n; i++) {
+	if (i > 0) {
+	    for (j = 0; j < stride; j++)
+		joints[i * stride + j] = joints[(i - 1) * stride + j];
+	}
+	if (vtk->kinematicsInverse(world + i, joints + i * stride, iflags, fflags))
+	    return i;
+    }
+    return n;
+}
+
 #endif
@@ -20,7 +20,7 @@
 #include "rtapi_app.h"
 
 #include "lineardeltakins-common.h"
-#define VTVERSION VTKINEMATICS_VERSION1
+#define VTVERSION VTKINEMATICS_VERSION2
 
 struct haldata
 {
@@ -42,6 +42,33 @@ int kinematicsInverse(const EmcPose *pos, double *joints,
     return kinematics_inverse(pos, joints);
 }
 
+/* the geometry only needs to be checked once per batch */
+static int kinematicsForwardBatch(const double *joints,
+                                  EmcPose * pos,
+                                  int n, int stride,
+                                  const KINEMATICS_FORWARD_FLAGS * fflags,
+                                  KINEMATICS_INVERSE_FLAGS * iflags) {
+    int i;
+
+    set_geometry(*haldata->r, *haldata->l,*haldata ->j0off,*haldata ->j1off,*haldata ->j2off,*haldata ->r1off,*haldata ->r2off,*haldata ->a1off,*haldata ->a2off);
+    for(i = 0; i < n; i++)
+        if(kinematics_forward(joints + i * stride, pos + i)) return i;
+    return n;
+}
+
+static int kinematicsInverseBatch(const EmcPose * pos,
+                                  double *joints,
+                                  int n, int stride,
+                                  const KINEMATICS_INVERSE_FLAGS * iflags,
+                                  KINEMATICS_FORWARD_FLAGS * fflags) {
+    int i;
+
+    set_geometry(*haldata->r, *haldata->l,*haldata ->j0off,*haldata ->j1off,*haldata ->j2off,*haldata ->r1off,*haldata ->r2off,*haldata ->a1off,*haldata ->a2off);
+    for(i = 0; i < n; i++)
+        if(kinematics_inverse(pos + i, joints + i * stride)) return i;
+    return n;
+}
+
 KINEMATICS_TYPE kinematicsType(void)
 {
     return KINEMATICS_BOTH;
@@ -51,7 +78,9 @@ static vtkins_t vtk = {
     .kinematicsForward = kinematicsForward,
     .kinematicsInverse  = kinematicsInverse,
     // .kinematicsHome = kinematicsHome,
-    .kinematicsType = kinematicsType
+    .kinematicsType = kinematicsType,
+    .kinematicsForwardBatch = kinematicsForwardBatch,
+    .kinematicsInverseBatch = kinematicsInverseBatch
 };
 
 static int comp_id, vtable_id;
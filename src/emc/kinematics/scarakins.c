@@ -23,7 +23,7 @@
 #include "rtapi_app.h"		/* RTAPI realtime module decls */
 #include "hal.h"
 
-#define VTVERSION VTKINEMATICS_VERSION1
+#define VTVERSION VTKINEMATICS_VERSION2
 
 #define DEFAULT_D1 490
 #define DEFAULT_D2 340
@@ -179,6 +179,34 @@ int kinematicsInverse(const EmcPose * world,
     return (0);
 }
 
+/* batches call the point functions directly, which the compiler can
+   inline, instead of going through the vtable for every point */
+static int kinematicsForwardBatch(const double * joint,
+                                  EmcPose * world,
+                                  int n, int stride,
+                                  const KINEMATICS_FORWARD_FLAGS * fflags,
+                                  KINEMATICS_INVERSE_FLAGS * iflags)
+{
+    int i;
+
+    for (i = 0; i < n; i++)
+	kinematicsForward(joint + i * stride, world + i, fflags, iflags);
+    return n;
+}
+
+static int kinematicsInverseBatch(const EmcPose * world,
+                                  double * joint,
+                                  int n, int stride,
+                                  const KINEMATICS_INVERSE_FLAGS * iflags,
+                                  KINEMATICS_FORWARD_FLAGS * fflags)
+{
+    int i;
+
+    for (i = 0; i < n; i++)
+	kinematicsInverse(world + i, joint + i * stride, iflags, fflags);
+    return n;
+}
+
 int kinematicsHome(EmcPose * world,
                    double * joint,
                    KINEMATICS_FORWARD_FLAGS * fflags,
@@ -198,7 +226,9 @@ static vtkins_t vtk = {
     .kinematicsForward = kinematicsForward,
     .kinematicsInverse  = kinematicsInverse,
     // .kinematicsHome = kinematicsHome,
-    .kinematicsType = kinematicsType
+    .kinematicsType = kinematicsType,
+    .kinematicsForwardBatch = kinematicsForwardBatch,
+    .kinematicsInverseBatch = kinematicsInverseBatch
 };
 
 static int comp_id, vtable_id;
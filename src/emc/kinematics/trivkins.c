@@ -19,7 +19,7 @@
 #include "rtapi_app.h"		/* RTAPI realtime module decls */
 #include "hal.h"
 
-#define VTVERSION VTKINEMATICS_VERSION1
+#define VTVERSION VTKINEMATICS_VERSION2
 
 
 int kinematicsForward(const double *joints,
@@ -58,6 +58,33 @@ int kinematicsInverse(const EmcPose * pos,
     return 0;
 }
 
+/* the batch versions are a plain copy per point, inlined */
+static int kinematicsForwardBatch(const double *joints,
+				  EmcPose * pos,
+				  int n, int stride,
+				  const KINEMATICS_FORWARD_FLAGS * fflags,
+				  KINEMATICS_INVERSE_FLAGS * iflags)
+{
+    int i;
+
+    for (i = 0; i < n; i++)
+	kinematicsForward(joints + i * stride, pos + i, fflags, iflags);
+    return n;
+}
+
+static int kinematicsInverseBatch(const EmcPose * pos,
+				  double *joints,
+				  int n, int stride,
+				  const KINEMATICS_INVERSE_FLAGS * iflags,
+				  KINEMATICS_FORWARD_FLAGS * fflags)
+{
+    int i;
+
+    for (i = 0; i < n; i++)
+	kinematicsInverse(pos + i, joints + i * stride, iflags, fflags);
+    return n;
+}
+
 /* implemented for these kinematics as giving joints preference */
 int kinematicsHome(EmcPose * world,
 		   double *joint,
@@ -81,7 +108,9 @@ static vtkins_t vtk = {
     .kinematicsForward = kinematicsForward,
     .kinematicsInverse  = kinematicsInverse,
     // .kinematicsHome = kinematicsHome,
-    .kinematicsType = kinematicsType
+    .kinematicsType = kinematicsType,
+    .kinematicsForwardBatch = kinematicsForwardBatch,
+    .kinematicsInverseBatch = kinematicsInverseBatch
 };
 
 static int comp_id, vtable_id;
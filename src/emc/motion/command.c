@@ -295,6 +295,66 @@ hal_bit_t emcmotGetRotaryIsUnlocked(int axis) {
     return *(emcmot_hal_data->joint[axis].is_unlocked);
 }
 
+/*! \function emcmotGetJointLimits()
+
+  joint velocity and acceleration limits for the joint limit check
+  the tp does when a segment is queued. Returns the number of joints,
+  or 0 to skip the check: with identity kinematics the axis limits
+  the tp already obeys are the joint limits, and kinematics without
+  a batch inverse are typically iterative (genserkins), running them
+  for every sample in the command handler costs too much. Those are
+  left to the soft limit checks.
+*/
+int emcmotGetJointLimits(double *vel_limit, double *acc_limit)
+{
+    int joint_num;
+    emcmot_joint_t *joint;
+
+    if (kinType == KINEMATICS_IDENTITY ||
+	emcmotConfig->vtk->kinematicsInverseBatch == NULL) {
+	return 0;
+    }
+    for (joint_num = 0; joint_num < num_joints; joint_num++) {
+	joint = &joints[joint_num];
+	if (!GET_JOINT_ACTIVE_FLAG(joint)) {
+	    /* 0 tells the tp to ignore the joint */
+	    vel_limit[joint_num] = 0.0;
+	    acc_limit[joint_num] = 0.0;
+	    continue;
+	}
+	vel_limit[joint_num] = joint->vel_limit;
+	acc_limit[joint_num] = joint->acc_limit;
+    }
+    return num_joints;
+}
+
+/*! \function emcmotKinsInverseBatch()
+
+  runs the poses of a queued segment through the inverse kinematics,
+  starting from seed, the joints at the end of the previous queued
+  segment, or from the commanded joint positions if there is none.
+  Works on copies of the kinematics flags, the ones of the commanded
+  position are left alone.
+*/
+int emcmotKinsInverseBatch(const double *seed, const EmcPose *world,
+			   double *joint_pos, int n, int stride)
+{
+    KINEMATICS_INVERSE_FLAGS ifl = iflags;
+    KINEMATICS_FORWARD_FLAGS ffl = fflags;
+    int joint_num;
+
+    for (joint_num = 0; joint_num < stride; joint_num++) {
+	if (seed) {
+	    joint_pos[joint_num] = seed[joint_num];
+	} else {
+	    joint_pos[joint_num] = (joint_num < num_joints) ?
+		joints[joint_num].pos_cmd : 0.0;
+	}
+    }
+    return vtk_inverse_batch(emcmotConfig->vtk, world, joint_pos, n, stride,
+			     &ifl, &ffl);
+}
+
 /*! \function emcmotDioWrite()
 
   sets or clears a HAL DIO pin, 
@@ -1036,6 +1096,66 @@ int emcmotCommandHandler(void *arg, const hal_funct_args_t *fa)
 	    }
 	    break;
 
+	case EMCMOT_SET_SPLINE:
+	    /* emcmotDebug->tp up a spline move */
+	    /* requires coordinated mode, enable on, not on limits */
+	    rtapi_print_msg(RTAPI_MSG_DBG, "SET_SPLINE");
+	    if (!GET_MOTION_COORD_FLAG() || !GET_MOTION_ENABLE_FLAG()) {
+		reportError
+		    (_("need to be enabled, in coord mode for spline move"));
+		emcmotStatus->commandStatus = EMCMOT_COMMAND_INVALID_COMMAND;
+		SET_MOTION_ERROR_FLAG(1);
+		break;
+	    } else if (!inRange(emcmotCommand->pos, emcmotCommand->id, "Spline")) {
+		emcmotStatus->commandStatus = EMCMOT_COMMAND_INVALID_PARAMS;
+		abort_and_switchback(); // tpAbort(emcmotQueue);
+
+		SET_MOTION_ERROR_FLAG(1);
+		break;
+	    } else if (!limits_ok()) {
+		reportError(_("can't do spline move with limits exceeded"));
+		emcmotStatus->commandStatus = EMCMOT_COMMAND_INVALID_PARAMS;
+		abort_and_switchback(); // tpAbort(emcmotQueue);
+
+		SET_MOTION_ERROR_FLAG(1);
+		break;
+	    }
+            if(emcmotStatus->atspeed_next_feed) {
+                issue_atspeed = 1;
+                emcmotStatus->atspeed_next_feed = 0;
+            }
+	    /* append it to the emcmotDebug->queue */
+	    emcmotConfig->vtp->tpSetId(emcmotQueue, emcmotCommand->id);
+
+	    int res_addspline =
+		emcmotConfig->vtp->tpAddSpline(emcmotQueue, emcmotCommand->pos,
+                            emcmotCommand->ctrl1, emcmotCommand->ctrl2,
+                            emcmotCommand->motion_type,
+                            emcmotCommand->vel, emcmotCommand->ini_maxvel,
+                            emcmotCommand->acc, emcmotStatus->enables_new,
+                            issue_atspeed, emcmotCommand->tag);
+	    if (res_addspline < 0) {
+		reportError(_("can't add spline move at line %d, error code %d"),
+			    emcmotCommand->id, res_addspline);
+		emcmotStatus->commandStatus = EMCMOT_COMMAND_BAD_EXEC;
+		abort_and_switchback(); // tpAbort(emcmotQueue);
+
+		SET_MOTION_ERROR_FLAG(1);
+		break;
+	    } else if (res_addspline != 0) {
+		// see EMCMOT_SET_CIRCLE
+		if (issue_atspeed) {
+		    emcmotStatus->atspeed_next_feed = 1;
+		}
+	    } else {
+		SET_MOTION_ERROR_FLAG(0);
+		/* set flag that indicates all joints need rehoming, if any
+		   joint is moved in joint mode, for machines with no forward
+		   kins */
+		rehomeAll = 1;
+	    }
+	    break;
+
 	case EMCMOT_SET_VEL:
 	    /* set the velocity for subsequent moves */
 	    /* can do it at any time */
@@ -1077,6 +1197,17 @@ int emcmotCommandHandler(void *arg, const hal_funct_args_t *fa)
 	    joint->acc_limit = emcmotCommand->acc;
 	    break;
 
+	case EMCMOT_SET_JOINT_JERK_LIMIT:
+	    rtapi_print_msg(RTAPI_MSG_DBG, "SET_JOINT_JERK_LIMIT");
+	    rtapi_print_msg(RTAPI_MSG_DBG, " %d", joint_num);
+	    emcmot_config_change();
+	    /* check joint range */
+	    if (joint == 0) {
+		break;
+	    }
+	    joint->jerk_limit = emcmotCommand->jerk;
+	    break;
+
 	case EMCMOT_SET_ACC:
 	    /* set the max acceleration */
 	    /* can do it at any time */
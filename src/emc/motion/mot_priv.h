@@ -317,6 +317,12 @@ extern void emcmotAioWrite(unsigned int index, hal_float_t value);
 extern void emcmotSetRotaryUnlock(int axis,  hal_bit_t unlock);
 extern hal_bit_t emcmotGetRotaryIsUnlocked(int axis);
 
+/* upcalls for the tp's queue time joint limit check */
+extern int emcmotGetJointLimits(double *vel_limit, double *acc_limit);
+extern int emcmotKinsInverseBatch(const double *seed,
+				  const EmcPose *world, double *joint_pos,
+				  int n, int stride);
+
 /* homing is no longer in control.c, make functions public */
 extern void do_homing_sequence(void);
 extern void do_homing(void);
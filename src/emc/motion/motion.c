@@ -22,8 +22,8 @@
 #include "rtapi_math.h"
 
 // vtable signatures
-#define VTKINS_VERSION VTKINEMATICS_VERSION1
-#define VTP_VERSION    VTTP_VERSION1
+#define VTKINS_VERSION VTKINEMATICS_VERSION2
+#define VTP_VERSION    VTTP_VERSION2
 
 // Mark strings for translation, but defer translation to userspace
 #define _(s) (s)
@@ -126,6 +126,16 @@ struct emcmot_error_t *emcmotError = 0;	/* unused for RT_FIFO */
 /* RTAPI shmem ID - for comms with higher level user space stuff */
 static int emc_shmem_id;	/* the shared memory ID */
 
+/* vtable of kinematics exporting VTKINEMATICS_VERSION1 only */
+static vtkins_t vtk_version1;
+
+/* vtable of a tp exporting VTTP_VERSION1 only, its splines and batches
+   are queued here through its single segment calls */
+static vtp_t vtp_version1;
+
+/* number of lines a spline becomes with such a tp */
+#define SPLINE_LINES 16
+
 /***********************************************************************
 *                   LOCAL FUNCTION PROTOTYPES                          *
 ************************************************************************/
@@ -162,6 +172,15 @@ static int init_shared(tp_shared_t *tps,
 		       emcmot_debug_t *dbg,
 		       emcmot_joint_t *joint,
 		       emcmot_hal_data_t *hal);
+
+/* stand-ins for the VTTP_VERSION2 methods of a VTTP_VERSION1 tp */
+static int tpAddSplineAsLines(TP_STRUCT * queue, EmcPose end,
+			      PmCartesian ctrl1, PmCartesian ctrl2,
+			      int type, double vel, double ini_maxvel,
+			      double acc, unsigned char enables,
+			      char atspeed, struct state_tag_t tag);
+static int tpAddSegmentsOneByOne(TP_STRUCT * queue, tp_segment_t const * segs,
+				 int count, int * added);
 /***********************************************************************
 *                     PUBLIC FUNCTION CODE                             *
 ************************************************************************/
@@ -951,10 +970,27 @@ static int init_comm_buffers(void)
     emcmotConfig->kins_vid = hal_reference_vtable(kins, VTKINS_VERSION,
 						  (void **)&emcmotConfig->vtk);
     if (emcmotConfig->kins_vid < 0) {
-	rtapi_print_msg(RTAPI_MSG_ERR,
-			"MOTION: hal_reference_vtable(%s,%d) failed: %d\n",
-			kins, VTKINS_VERSION, emcmotConfig->kins_vid);
-	return -1;
+	// kinematics built before the batch methods: use a copy of
+	// their vtable with the batch methods left NULL
+	vtkins_t *vtk1;
+
+	emcmotConfig->kins_vid = hal_reference_vtable(kins, VTKINEMATICS_VERSION1,
+						      (void **)&vtk1);
+	if (emcmotConfig->kins_vid < 0) {
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+			    "MOTION: hal_reference_vtable(%s,%d) failed: %d\n",
+			    kins, VTKINS_VERSION, emcmotConfig->kins_vid);
+	    return -1;
+	}
+	memset(&vtk_version1, 0, sizeof(vtk_version1));
+	vtk_version1.kinematicsForward = vtk1->kinematicsForward;
+	vtk_version1.kinematicsInverse = vtk1->kinematicsInverse;
+	vtk_version1.kinematicsHome = vtk1->kinematicsHome;
+	vtk_version1.kinematicsType = vtk1->kinematicsType;
+	emcmotConfig->vtk = &vtk_version1;
+	rtapi_print_msg(RTAPI_MSG_INFO,
+			"MOTION: %s has no batch kinematics, converting point by point\n",
+			kins);
     }
 
     /* record the kinematics type of the machine */
@@ -964,10 +1000,27 @@ static int init_comm_buffers(void)
     emcmotConfig->tp_vid = hal_reference_vtable(tp, VTP_VERSION,
 						(void **)&emcmotConfig->vtp);
     if (emcmotConfig->tp_vid < 0) {
-	rtapi_print_msg(RTAPI_MSG_ERR,
-			"MOTION: hal_reference_vtable(%s,%d) failed: %d\n",
-			tp, VTP_VERSION, emcmotConfig->tp_vid);
-	return -1;
+	// tp built before splines and batches: use a copy of its vtable
+	// with those two done by its single segment calls
+	vtp_t *vtp1;
+
+	emcmotConfig->tp_vid = hal_reference_vtable(tp, VTTP_VERSION1,
+						    (void **)&vtp1);
+	if (emcmotConfig->tp_vid < 0) {
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+			    "MOTION: hal_reference_vtable(%s,%d) failed: %d\n",
+			    tp, VTP_VERSION, emcmotConfig->tp_vid);
+	    return -1;
+	}
+	// the VTTP_VERSION1 methods are the front of vtp_t
+	memset(&vtp_version1, 0, sizeof(vtp_version1));
+	memcpy(&vtp_version1, vtp1, offsetof(vtp_t, tpAddSpline));
+	vtp_version1.tpAddSpline = tpAddSplineAsLines;
+	vtp_version1.tpAddSegments = tpAddSegmentsOneByOne;
+	emcmotConfig->vtp = &vtp_version1;
+	rtapi_print_msg(RTAPI_MSG_INFO,
+			"MOTION: %s has no splines or batches, a spline becomes %d lines\n",
+			tp, SPLINE_LINES);
     }
 
 
@@ -1074,6 +1127,7 @@ static int init_comm_buffers(void)
 	joint->min_pos_limit = -1.0;
 	joint->vel_limit = 1.0;
 	joint->acc_limit = 1.0;
+	joint->jerk_limit = 0.0;
 	joint->min_ferror = 0.01;
 	joint->max_ferror = 1.0;
 	joint->home_search_vel = 0.0;
@@ -1411,6 +1465,8 @@ static int init_shared(tp_shared_t *tps,
 		       emcmot_joint_t *joint,
 		       emcmot_hal_data_t *hal) // hal not used yet
 {
+    int n;
+
     // global module param
     tps->num_dio = &num_dio;
     tps->num_aio = &num_aio;
@@ -1455,6 +1511,11 @@ static int init_shared(tp_shared_t *tps,
     tps->acc_limit[1] = &joint[1].acc_limit;
     tps->acc_limit[2] = &joint[2].acc_limit;
 
+    // jerk per axis, EMCMOT_MAX_JOINTS >= 9
+    for (n = 0; n < 9; n++) {
+	tps->jerk_limit[n] = &joint[n].jerk_limit;
+    }
+
     tps->vel_limit[0] = &joint[0].vel_limit;
     tps->vel_limit[1] = &joint[1].vel_limit;
     tps->vel_limit[2] = &joint[2].vel_limit;
@@ -1469,5 +1530,107 @@ static int init_shared(tp_shared_t *tps,
     // rotary setter/getters
     tps->SetRotaryUnlock = emcmotSetRotaryUnlock;
     tps->GetRotaryIsUnlocked = emcmotGetRotaryIsUnlocked;
+
+    // joint limit check at queue time
+    tps->GetJointLimits = emcmotGetJointLimits;
+    tps->KinsInverseBatch = emcmotKinsInverseBatch;
+    return 0;
+}
+
+/* point u of a cubic Bezier curve, in one coordinate */
+static double bezier(double p0, double p1, double p2, double p3, double u)
+{
+    double v = 1.0 - u;
+
+    return v * v * v * p0 + 3.0 * v * v * u * p1 + 3.0 * v * u * u * p2 +
+	u * u * u * p3;
+}
+
+/* tpAddSpline for a tp without TC_SPLINE: SPLINE_LINES lines through
+   points at equal parameter steps along the XYZ curve, ABC and UVW move
+   linearly. All of them get the id set for the spline, the first one
+   waits for the spindle if the spline would have. */
+static int tpAddSplineAsLines(TP_STRUCT * queue, EmcPose end,
+			      PmCartesian ctrl1, PmCartesian ctrl2,
+			      int type, double vel, double ini_maxvel,
+			      double acc, unsigned char enables,
+			      char atspeed, struct state_tag_t tag)
+{
+    EmcPose start = queue->goalPos, pos;
+    double u;
+    int n, res;
+
+    for (n = 1; n <= SPLINE_LINES; n++) {
+	u = (double) n / SPLINE_LINES;
+	if (n == SPLINE_LINES) {
+	    pos = end;
+	} else {
+	    pos.tran.x = bezier(start.tran.x, ctrl1.x, ctrl2.x, end.tran.x, u);
+	    pos.tran.y = bezier(start.tran.y, ctrl1.y, ctrl2.y, end.tran.y, u);
+	    pos.tran.z = bezier(start.tran.z, ctrl1.z, ctrl2.z, end.tran.z, u);
+	    pos.a = start.a + u * (end.a - start.a);
+	    pos.b = start.b + u * (end.b - start.b);
+	    pos.c = start.c + u * (end.c - start.c);
+	    pos.u = start.u + u * (end.u - start.u);
+	    pos.v = start.v + u * (end.v - start.v);
+	    pos.w = start.w + u * (end.w - start.w);
+	}
+	res = vtp_version1.tpAddLine(queue, pos, type, vel, ini_maxvel, acc,
+				     enables, atspeed, -1, tag);
+	if (res != 0) {
+	    return res;
+	}
+	atspeed = 0;
+    }
     return 0;
 }
+
+/* tpAddSegments for a tp without batches: the segments are added one at
+   a time, each with its own speed optimization. Stops at the first one
+   which can't be added, like the batch. */
+static int tpAddSegmentsOneByOne(TP_STRUCT * queue, tp_segment_t const * segs,
+				 int count, int * added)
+{
+    tp_segment_t const *seg;
+    int n, res = 0;
+
+    for (n = 0; n < count; n++) {
+	seg = &segs[n];
+	vtp_version1.tpSetId(queue, seg->id);
+	switch (seg->type) {
+	case TC_LINEAR:
+	    res = vtp_version1.tpAddLine(queue, seg->end,
+					 seg->canon_motion_type, seg->vel,
+					 seg->ini_maxvel, seg->acc,
+					 seg->enables, seg->atspeed,
+					 seg->indexrotary, seg->tag);
+	    break;
+	case TC_CIRCULAR:
+	    res = vtp_version1.tpAddCircle(queue, seg->end, seg->center,
+					   seg->normal, seg->turn,
+					   seg->canon_motion_type, seg->vel,
+					   seg->ini_maxvel, seg->acc,
+					   seg->enables, seg->atspeed,
+					   seg->tag);
+	    break;
+	case TC_SPLINE:
+	    res = tpAddSplineAsLines(queue, seg->end, seg->ctrl1, seg->ctrl2,
+				     seg->canon_motion_type, seg->vel,
+				     seg->ini_maxvel, seg->acc, seg->enables,
+				     seg->atspeed, seg->tag);
+	    break;
+	default:
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+			    "MOTION: can't add segment of type %d\n", seg->type);
+	    res = TP_ERR_INPUT_TYPE;
+	    break;
+	}
+	if (res != 0) {
+	    break;
+	}
+    }
+    if (added) {
+	*added = n;
+    }
+    return res;
+}
@@ -179,6 +179,8 @@ extern "C" {
     EMCMOT_SET_MAX_FEED_OVERRIDE = 62,
     EMCMOT_SETUP_ARC_BLENDS = 63,
     EMCMOT_RAPID_SCALE = 64,	          /* set scale factor for rapids */
+    EMCMOT_SET_SPLINE = 65,               /* queue up a spline move */
+    EMCMOT_SET_JOINT_JERK_LIMIT = 66,     /* set the max joint jerk */
     } cmd_code_t;
 
 /* this enum lists the possible results of a command */
@@ -213,6 +215,7 @@ extern "C" {
 	EmcPose pos;		/* line/circle endpt, or teleop vector */
 	PmCartesian center;	/* center for circle */
 	PmCartesian normal;	/* normal vec for circle */
+	PmCartesian ctrl1, ctrl2;	/* inner control points for spline */
 	int turn;		/* turns for circle or which rotary to unlock for a line */
 	double vel;		/* max velocity */
         double ini_maxvel;      /* max velocity allowed by machine
@@ -220,6 +223,7 @@ extern "C" {
         int motion_type;        /* this move is because of traverse, feed, arc, or toolchange */
         double spindlesync;     /* user units per spindle revolution, 0 = no sync */
 	double acc;		/* max acceleration */
+	double jerk;		/* max jerk, 0 = not limited */
 	double backlash;	/* amount of backlash */
 	int id;			/* id for motion */
 	int termCond;		/* termination condition */
@@ -490,6 +494,7 @@ Suggestion: Split this in to an Error and a Status flag register..
 	double min_jog_limit;
 	double vel_limit;	/* upper limit of joint speed */
 	double acc_limit;	/* upper limit of joint accel */
+	double jerk_limit;	/* upper limit of joint jerk, 0 = none */
 	double min_ferror;	/* zero speed following error limit */
 	double max_ferror;	/* max speed following error limit */
 	double home_search_vel;	/* dir/spd to look for home switch */
@@ -17,6 +17,8 @@
 * Last change:
 ********************************************************************/
 
+#include <stddef.h>		/* offsetof() */
+
 // Include all NML, CMS, and RCS classes and functions
 #include "rcs.hh"
 
@@ -378,6 +380,9 @@ int emcFormat(NMLTYPE type, void *buffer, CMS * cms)
     case EMC_TRAJ_RIGID_TAP_TYPE:
 	((EMC_TRAJ_RIGID_TAP *) buffer)->update(cms);
         break;
+    case EMC_TRAJ_SPLINE_MOVE_TYPE:
+	((EMC_TRAJ_SPLINE_MOVE *) buffer)->update(cms);
+	break;
     case EMC_TRAJ_PAUSE_TYPE:
 	((EMC_TRAJ_PAUSE *) buffer)->update(cms);
 	break;
@@ -757,6 +762,8 @@ const char *emc_symbol_lookup(long type)
 	return "EMC_TRAJ_SET_UNITS";
     case EMC_TRAJ_SET_VELOCITY_TYPE:
 	return "EMC_TRAJ_SET_VELOCITY";
+    case EMC_TRAJ_SPLINE_MOVE_TYPE:
+	return "EMC_TRAJ_SPLINE_MOVE";
     case EMC_TRAJ_STAT_TYPE:
 	return "EMC_TRAJ_STAT";
     case EMC_TRAJ_STEP_TYPE:
@@ -1079,12 +1086,24 @@ void EMC_AXIS_OVERRIDE_LIMITS::update(CMS * cms)
 *	Automatically generated by NML CodeGen Java Applet.
 *	on Sat Oct 11 13:45:16 UTC 2003
 */
+/*
+*	The update functions for the plain structs of doubles below hand
+*	runs of adjacent doubles to CMS as one array, which encodes the
+*	same as one update per member but in one call. The typedefs fail
+*	to compile if a struct is ever changed so that the members are no
+*	longer adjacent.
+*/
+typedef char PmCartesian_is_3_doubles
+    [sizeof(PmCartesian) == 3 * sizeof(double) ? 1 : -1];
+typedef char EmcPose_is_9_doubles
+    [sizeof(EmcPose) == 9 * sizeof(double) ? 1 : -1];
+typedef char CANON_TOOL_TABLE_has_12_adjacent_doubles
+    [offsetof(CANON_TOOL_TABLE, backangle) ==
+    offsetof(CANON_TOOL_TABLE, offset) + 11 * sizeof(double) ? 1 : -1];
+
 void PmCartesian_update(CMS * cms, PmCartesian * x)
 {
-    cms->update(x->x);
-    cms->update(x->y);
-    cms->update(x->z);
-
+    cms->update(&x->x, 3);
 }
 
 /*
@@ -1540,6 +1559,24 @@ void EMC_TRAJ_CIRCULAR_MOVE::update(CMS * cms)
 
 }
 
+/*
+*	NML/CMS Update function for EMC_TRAJ_SPLINE_MOVE
+*/
+void EMC_TRAJ_SPLINE_MOVE::update(CMS * cms)
+{
+
+    EMC_TRAJ_CMD_MSG::update(cms);
+    EmcPose_update(cms, &end);
+    cms->update(ctrl1);
+    cms->update(ctrl2);
+    cms->update(type);
+    cms->update(vel);
+    cms->update(ini_maxvel);
+    cms->update(acc);
+    cms->update(feed_mode);
+
+}
+
 /*
 *	NML/CMS Update function for EMC_TRAJ_SET_TERM_COND
 *	Automatically generated by NML CodeGen Java Applet.
@@ -1709,11 +1746,8 @@ void EMC_SPINDLE_DECREASE::update(CMS * cms)
 void CANON_TOOL_TABLE_update(CMS * cms, CANON_TOOL_TABLE * x)
 {
     cms->update(x->toolno);
-    EmcPose_update(cms, &x->offset);
-    cms->update(x->diameter);
-    cms->update(x->frontangle);
-    cms->update(x->backangle);
-
+    /* offset, diameter, frontangle, backangle */
+    cms->update(&x->offset.tran.x, 12);
 }
 
 /*
@@ -2539,13 +2573,8 @@ void EMC_COOLANT_FLOOD_OFF::update(CMS * cms)
 */
 void EmcPose_update(CMS * cms, EmcPose * x)
 {
-    PmCartesian_update(cms, &(x->tran));
-    cms->update(x->a);
-    cms->update(x->b);
-    cms->update(x->c);
-    cms->update(x->u);
-    cms->update(x->v);
-    cms->update(x->w);
+    /* tran, a, b, c, u, v, w */
+    cms->update(&x->tran.x, 9);
 }
 
 /*
@@ -813,6 +813,24 @@ class EMC_TRAJ_CIRCULAR_MOVE:public EMC_TRAJ_CMD_MSG {
     int feed_mode;
 };
 
+class EMC_TRAJ_SPLINE_MOVE:public EMC_TRAJ_CMD_MSG {
+  public:
+    EMC_TRAJ_SPLINE_MOVE():EMC_TRAJ_CMD_MSG(EMC_TRAJ_SPLINE_MOVE_TYPE,
+					    sizeof
+					    (EMC_TRAJ_SPLINE_MOVE)) {
+    };
+
+    // For internal NML/CMS use only.
+    void update(CMS * cms);
+
+    EmcPose end;
+    PM_CARTESIAN ctrl1;		// inner Bezier control points, XYZ
+    PM_CARTESIAN ctrl2;
+    int type;
+    double vel, ini_maxvel, acc;
+    int feed_mode;
+};
+
 class EMC_TRAJ_SET_TERM_COND:public EMC_TRAJ_CMD_MSG {
   public:
     EMC_TRAJ_SET_TERM_COND():EMC_TRAJ_CMD_MSG(EMC_TRAJ_SET_TERM_COND_TYPE,
@@ -0,0 +1,189 @@
+/********************************************************************
+* Description: emc_nml_bench.cc
+*   Time the NML encoding of EMC_STAT.
+*
+*   emc-nml-bench [-n count]
+*
+*   Reported are the ns per EMC_STAT for
+*     encode  write() on a neutral (XDR) buffer
+*     decode  read() of a neutral buffer
+*     raw     write() and read() on a raw buffer, for comparison
+*     server  read() by a server, which encodes the raw message for the
+*             remote client, once with a message changed by a write
+*             before every read and once with the same message
+*
+*   All buffers are LOCMEM buffers in this process, so the numbers are
+*   the cost of the format functions plus a memcpy.
+*
+*   Built by 'make bench', not installed.
+*
+* License: GPL Version 2
+* System: Linux
+*
+* Copyright (c) 2016 All rights reserved.
+********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "nml.hh"		/* class NML */
+#include "cms.hh"		/* class CMS */
+#include "rcs_print.hh"		/* set_rcs_print_destination() */
+#include "timer.hh"		/* etime() */
+#include "emc.hh"		/* emcFormat() */
+#include "emc_nml.hh"		/* EMC_STAT */
+
+static int count = 20000;
+static char cfg[64];
+
+static void write_config(void)
+{
+    FILE *f;
+    int fd;
+
+    strcpy(cfg, "/tmp/emc-nml-bench.XXXXXX");
+    fd = mkstemp(cfg);
+    if (fd < 0 || NULL == (f = fdopen(fd, "w"))) {
+	perror(cfg);
+	exit(1);
+    }
+    /* the encoded EMC_STAT is larger than the raw one */
+    fprintf(f, "B statn LOCMEM localhost %ld 1 0 1 4 0 xdr\n",
+	(long) sizeof(EMC_STAT) * 2);
+    fprintf(f, "B statr LOCMEM localhost %ld 0 0 2 4 0 xdr\n",
+	(long) sizeof(EMC_STAT) * 2);
+    fprintf(f, "P wr statn LOCAL localhost W 0 1.0 1 1\n");
+    fprintf(f, "P rd statn LOCAL localhost R 0 1.0 0 2\n");
+    fprintf(f, "P wr statr LOCAL localhost W 0 1.0 0 1\n");
+    fprintf(f, "P rd statr LOCAL localhost R 0 1.0 0 2\n");
+    fprintf(f, "P srv statr LOCAL localhost R 1 1.0 1 3\n");
+    fclose(f);
+}
+
+static NML *open_channel(const char *buf, const char *proc, int server)
+{
+    NML *nml = new NML(emcFormat, buf, proc, cfg, server);
+
+    if (!nml->valid()) {
+	fprintf(stderr, "emc-nml-bench: can't open %s for %s\n", buf, proc);
+	exit(1);
+    }
+    return nml;
+}
+
+/* a status message with something other than 0 in most fields */
+static void fill(EMC_STAT * stat)
+{
+    int i;
+
+    stat->task.state = EMC_TASK_STATE_ON;
+    stat->task.mode = EMC_TASK_MODE_AUTO;
+    stat->task.motionLine = 1234;
+    stat->task.currentLine = 1235;
+    strcpy(stat->task.file, "/home/user/linuxcnc/nc_files/3D_Chips.ngc");
+    stat->motion.traj.position.tran.x = 1.5;
+    stat->motion.traj.position.tran.y = -2.25;
+    stat->motion.traj.position.tran.z = 0.125;
+    stat->motion.traj.actualPosition = stat->motion.traj.position;
+    stat->motion.traj.current_vel = 12.5;
+    for (i = 0; i < 8; i++) {
+	stat->motion.axis[i].input = i * 1.1;
+	stat->motion.axis[i].output = i * 1.1 + 0.001;
+	stat->motion.axis[i].velocity = i * 0.5;
+	stat->motion.axis[i].homed = 1;
+	stat->motion.axis[i].enabled = 1;
+    }
+}
+
+static double time_writes(NML * nml, EMC_STAT * stat)
+{
+    double start = etime();
+    int i;
+
+    for (i = 0; i < count; i++) {
+	stat->echo_serial_number = i;
+	nml->write(stat);
+    }
+    return (etime() - start) / count;
+}
+
+/* forget the last id read so that every read returns the message */
+static double time_reads(NML * nml, NML * writer, EMC_STAT * stat)
+{
+    double start = etime();
+    int i;
+
+    for (i = 0; i < count; i++) {
+	if (NULL != writer) {
+	    stat->echo_serial_number = i;
+	    writer->write(stat);
+	}
+	nml->cms->in_buffer_id = 0;
+	if (nml->read() != EMC_STAT_TYPE) {
+	    fprintf(stderr, "emc-nml-bench: read failed\n");
+	    exit(1);
+	}
+    }
+    return (etime() - start) / count;
+}
+
+int main(int argc, char **argv)
+{
+    NML *nwr, *nrd, *rwr, *rrd, *srv;
+    EMC_STAT *stat = new EMC_STAT();
+    double enc, dec, raw_w, raw_r, srv_new, srv_same;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:")) != -1) {
+	switch (opt) {
+	case 'n':
+	    count = atoi(optarg);
+	    break;
+	default:
+	    fprintf(stderr, "usage: emc-nml-bench [-n count]\n");
+	    return 1;
+	}
+    }
+    if (count < 1) {
+	count = 1;
+    }
+    set_rcs_print_destination(RCS_PRINT_TO_NULL);
+    write_config();
+    /* the masters first */
+    srv = open_channel("statr", "srv", 1);
+    nwr = open_channel("statn", "wr", 0);
+    nrd = open_channel("statn", "rd", 0);
+    rwr = open_channel("statr", "wr", 0);
+    rrd = open_channel("statr", "rd", 0);
+    unlink(cfg);
+    /* the encode buffer of a server is set up by CMS_SERVER */
+    srv->cms->set_encoded_data(malloc(srv->cms->size * 2),
+	srv->cms->size * 2);
+    fill(stat);
+
+    enc = time_writes(nwr, stat);
+    dec = time_reads(nrd, NULL, stat);
+    raw_w = time_writes(rwr, stat);
+    raw_r = time_reads(rrd, NULL, stat);
+    srv_new = time_reads(srv, rwr, stat) - raw_w;
+    srv_same = time_reads(srv, NULL, stat);
+
+    printf("EMC_STAT %ld bytes, %ld encoded\n", (long) sizeof(EMC_STAT),
+	(long) nwr->cms->header.in_buffer_size);
+    printf("encode %8.0f ns\n", enc * 1e9);
+    printf("decode %8.0f ns\n", dec * 1e9);
+    printf("raw    %8.0f ns write  %8.0f ns read\n", raw_w * 1e9,
+	raw_r * 1e9);
+    printf("server %8.0f ns read of a new message  %8.0f ns unchanged\n",
+	srv_new * 1e9, srv_same * 1e9);
+
+    delete rrd;
+    delete rwr;
+    delete nrd;
+    delete nwr;
+    delete srv;
+    delete stat;
+    return 0;
+}
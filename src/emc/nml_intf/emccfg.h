@@ -51,6 +51,9 @@ extern "C" {
 /* default axis acceleration, in user units per second per second */
 #define DEFAULT_AXIS_MAX_ACCELERATION 1.0
 
+/* default axis jerk, in user units per second cubed, 0 = not limited */
+#define DEFAULT_AXIS_MAX_JERK 0.0
+
 #ifdef __cplusplus
 }				/* matches extern "C" at top */
 #endif
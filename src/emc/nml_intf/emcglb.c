@@ -37,6 +37,7 @@ char tool_table_file[LINELEN] = DEFAULT_TOOL_TABLE_FILE;
 
 double traj_default_velocity = DEFAULT_TRAJ_DEFAULT_VELOCITY;
 double traj_max_velocity = DEFAULT_TRAJ_MAX_VELOCITY;
+int traj_naivecam_arcs = 0;	/* naive cam also fits arcs */
 
 double axis_max_velocity[EMC_AXIS_MAX] = { 1.0 };	/*! \todo FIXME - I think
 							   these should be
@@ -57,6 +57,7 @@ extern "C" {
 
     extern double traj_default_velocity;
     extern double traj_max_velocity;
+    extern int traj_naivecam_arcs;
 
     extern double axis_max_velocity[EMC_AXIS_MAX];
     extern double axis_max_acceleration[EMC_AXIS_MAX];
@@ -0,0 +1,275 @@
+/********************************************************************
+ * Description: emcstatmirror.cc
+ *
+ *   Change notification for the EMC_STAT status buffer, see
+ *   emcstatmirror.hh.
+ *
+ * License: GPL Version 2
+ * System: Linux
+ *
+ * Copyright (c) 2016 All rights reserved.
+ ********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "emc.hh"
+#include "emc_nml.hh"
+#include "rcs_print.hh"
+#include "rtapi_shmkeys.h"	// SHM_FMT, EMC_STAT_MIRROR_KEY
+#include "emcstatmirror.hh"
+
+static void mirror_name(char *name, size_t size)
+{
+    const char *s = getenv("MK_INSTANCE");
+    int instance = s ? atoi(s) : 0;
+
+    snprintf(name, size, SHM_FMT, instance, EMC_STAT_MIRROR_KEY);
+}
+
+static int futex_wait(uint32_t *uaddr, uint32_t val, const struct timespec *ts)
+{
+    return syscall(SYS_futex, uaddr, FUTEX_WAIT, val, ts, NULL, 0);
+}
+
+static int futex_wake(uint32_t *uaddr)
+{
+    return syscall(SYS_futex, uaddr, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+// true if the size bytes at offset differ between a and b
+static inline bool differs(const EMC_STAT *a, const EMC_STAT *b,
+			   const void *member, size_t size)
+{
+    size_t offset = (const char *) member - (const char *) a;
+    return memcmp((const char *) a + offset,
+		  (const char *) b + offset, size) != 0;
+}
+
+// true if the bytes between the members from and to differ
+static inline bool range_differs(const EMC_STAT *a, const EMC_STAT *b,
+				 const void *from, const void *to)
+{
+    return differs(a, b, from, (const char *) to - (const char *) from);
+}
+
+EmcStatMirror::EmcStatMirror():mirror(0), owner(false), last(0)
+{
+    memset(seen, 0, sizeof(seen));
+}
+
+EmcStatMirror::~EmcStatMirror()
+{
+    detach();
+}
+
+int EmcStatMirror::create()
+{
+    char name[LINELEN];
+    int fd;
+
+    mirror_name(name, sizeof(name));
+    fd = shm_open(name, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    if (fd < 0) {
+	rcs_print_error("EmcStatMirror: shm_open(%s): %s\n",
+			name, strerror(errno));
+	return -1;
+    }
+    if (ftruncate(fd, sizeof(emc_stat_mirror_t)) < 0) {
+	rcs_print_error("EmcStatMirror: ftruncate(%s): %s\n",
+			name, strerror(errno));
+	close(fd);
+	return -1;
+    }
+    mirror = (emc_stat_mirror_t *) mmap(NULL, sizeof(emc_stat_mirror_t),
+					PROT_READ | PROT_WRITE,
+					MAP_SHARED, fd, 0);
+    close(fd);
+    if (mirror == MAP_FAILED) {
+	mirror = 0;
+	rcs_print_error("EmcStatMirror: mmap(%s): %s\n",
+			name, strerror(errno));
+	return -1;
+    }
+    // a leftover segment from a previous run keeps its sequence
+    // and generations so attached clients see a change, not a rewind
+    mirror->size = sizeof(EMC_STAT);
+    __atomic_store_n(&mirror->magic, EMC_STAT_MIRROR_MAGIC, __ATOMIC_RELEASE);
+    owner = true;
+    last = 0;
+    return 0;
+}
+
+unsigned EmcStatMirror::publish(const EMC_STAT *stat)
+{
+    unsigned mask = 0;
+    int i;
+
+    if (!mirror || !owner)
+	return 0;
+
+    if (last == 0) {
+	last = (EMC_STAT *) malloc(sizeof(EMC_STAT));
+	if (last == 0)
+	    return 0;
+	mask = EMC_STAT_ALL;
+    } else {
+	// heartbeats change every cycle and are not a change of state
+	last->task.heartbeat = stat->task.heartbeat;
+	last->motion.heartbeat = stat->motion.heartbeat;
+	last->io.heartbeat = stat->io.heartbeat;
+
+	if (range_differs(stat, last, stat, &stat->task) ||
+	    range_differs(stat, last, &stat->motion, &stat->motion.traj) ||
+	    differs(stat, last, &stat->motion.debug, sizeof(stat->motion.debug)) ||
+	    range_differs(stat, last, &stat->io, &stat->io.tool) ||
+	    differs(stat, last, &stat->debug, sizeof(stat->debug)))
+	    mask |= EMC_STAT_MASK(EMC_STAT_GROUP_TOP);
+	if (differs(stat, last, &stat->task, sizeof(stat->task)))
+	    mask |= EMC_STAT_MASK(EMC_STAT_GROUP_TASK);
+	if (differs(stat, last, &stat->motion.traj, sizeof(stat->motion.traj)))
+	    mask |= EMC_STAT_MASK(EMC_STAT_GROUP_TRAJ);
+	if (differs(stat, last, stat->motion.axis, sizeof(stat->motion.axis)))
+	    mask |= EMC_STAT_MASK(EMC_STAT_GROUP_AXIS);
+	if (differs(stat, last, &stat->motion.spindle, sizeof(stat->motion.spindle)))
+	    mask |= EMC_STAT_MASK(EMC_STAT_GROUP_SPINDLE);
+	if (range_differs(stat, last, stat->motion.synch_di, &stat->motion.debug))
+	    mask |= EMC_STAT_MASK(EMC_STAT_GROUP_MOTION_IO);
+	if (differs(stat, last, &stat->io.tool, sizeof(stat->io.tool)))
+	    mask |= EMC_STAT_MASK(EMC_STAT_GROUP_TOOL);
+	if (differs(stat, last, &stat->io.coolant, sizeof(stat->io.coolant)))
+	    mask |= EMC_STAT_MASK(EMC_STAT_GROUP_COOLANT);
+	if (differs(stat, last, &stat->io.aux, sizeof(stat->io.aux)))
+	    mask |= EMC_STAT_MASK(EMC_STAT_GROUP_AUX);
+	if (differs(stat, last, &stat->io.lube, sizeof(stat->io.lube)))
+	    mask |= EMC_STAT_MASK(EMC_STAT_GROUP_LUBE);
+    }
+    if (mask == 0)
+	return 0;
+
+    memcpy((void *) last, (const void *) stat, sizeof(EMC_STAT));
+
+    for (i = 0; i < EMC_STAT_GROUPS; i++) {
+	if (mask & EMC_STAT_MASK(i))
+	    __atomic_add_fetch(&mirror->generation[i], 1, __ATOMIC_RELEASE);
+    }
+    __atomic_add_fetch(&mirror->sequence, 1, __ATOMIC_RELEASE);
+    if (__atomic_load_n(&mirror->waiters, __ATOMIC_ACQUIRE))
+	futex_wake(&mirror->sequence);
+    return mask;
+}
+
+int EmcStatMirror::attach()
+{
+    char name[LINELEN];
+    int fd, i;
+
+    if (mirror)
+	return 0;
+    mirror_name(name, sizeof(name));
+    fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0)
+	return -1;
+    mirror = (emc_stat_mirror_t *) mmap(NULL, sizeof(emc_stat_mirror_t),
+					PROT_READ | PROT_WRITE,
+					MAP_SHARED, fd, 0);
+    close(fd);
+    if (mirror == MAP_FAILED) {
+	mirror = 0;
+	return -1;
+    }
+    if ((__atomic_load_n(&mirror->magic, __ATOMIC_ACQUIRE) != EMC_STAT_MIRROR_MAGIC) ||
+	(mirror->size != sizeof(EMC_STAT))) {
+	// not (yet) initialized, or a task built from different sources
+	detach();
+	return -1;
+    }
+    owner = false;
+    // report everything as changed on the first call
+    for (i = 0; i < EMC_STAT_GROUPS; i++)
+	seen[i] = __atomic_load_n(&mirror->generation[i], __ATOMIC_ACQUIRE) - 1;
+    return 0;
+}
+
+unsigned EmcStatMirror::changed(unsigned mask)
+{
+    unsigned result = 0;
+    uint32_t gen;
+    int i;
+
+    if (!mirror)
+	return mask;	// no mirror: assume everything changed
+    for (i = 0; i < EMC_STAT_GROUPS; i++) {
+	if (!(mask & EMC_STAT_MASK(i)))
+	    continue;
+	gen = __atomic_load_n(&mirror->generation[i], __ATOMIC_ACQUIRE);
+	if (gen != seen[i]) {
+	    seen[i] = gen;
+	    result |= EMC_STAT_MASK(i);
+	}
+    }
+    return result;
+}
+
+unsigned EmcStatMirror::wait(unsigned mask, double timeout)
+{
+    struct timespec now, deadline, ts;
+    unsigned result;
+    uint32_t seq;
+
+    if (!mirror)
+	return mask;
+
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += (time_t) timeout;
+    deadline.tv_nsec += (long) ((timeout - (time_t) timeout) * 1e9);
+    if (deadline.tv_nsec >= 1000000000) {
+	deadline.tv_sec++;
+	deadline.tv_nsec -= 1000000000;
+    }
+    while (1) {
+	// sample the sequence before the generations so a change
+	// published in between makes futex_wait() return at once
+	seq = __atomic_load_n(&mirror->sequence, __ATOMIC_ACQUIRE);
+	if ((result = changed(mask)) != 0)
+	    return result;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	ts.tv_sec = deadline.tv_sec - now.tv_sec;
+	ts.tv_nsec = deadline.tv_nsec - now.tv_nsec;
+	if (ts.tv_nsec < 0) {
+	    ts.tv_sec--;
+	    ts.tv_nsec += 1000000000;
+	}
+	if (ts.tv_sec < 0)
+	    return 0;
+
+	__atomic_add_fetch(&mirror->waiters, 1, __ATOMIC_ACQ_REL);
+	futex_wait(&mirror->sequence, seq, &ts);
+	__atomic_sub_fetch(&mirror->waiters, 1, __ATOMIC_ACQ_REL);
+    }
+}
+
+void EmcStatMirror::detach()
+{
+    if (mirror) {
+	munmap((void *) mirror, sizeof(emc_stat_mirror_t));
+	mirror = 0;
+    }
+    if (last) {
+	free(last);
+	last = 0;
+    }
+    owner = false;
+}
@@ -0,0 +1,93 @@
+/********************************************************************
+ * Description: emcstatmirror.hh
+ *
+ *   Change notification for the EMC_STAT status buffer.
+ *
+ *   Task publishes a small shared memory block next to the emcStatus
+ *   NML buffer with one write generation per EMC_STAT field group.
+ *   A group's generation is only bumped when its contents actually
+ *   changed since the last task cycle, so local clients can tell
+ *   which parts of EMC_STAT need to be looked at, or block until a
+ *   group they care about changes instead of polling the NML buffer.
+ *
+ *   The segment lives in /dev/shm under the usual
+ *   linuxcnc-<instance>-<key> name, so 'realtime stop' removes it.
+ *
+ * License: GPL Version 2
+ * System: Linux
+ *
+ * Copyright (c) 2016 All rights reserved.
+ ********************************************************************/
+
+#ifndef EMCSTATMIRROR_HH
+#define EMCSTATMIRROR_HH
+
+#include <stdint.h>
+
+class EMC_STAT;
+
+// EMC_STAT field groups
+enum EMC_STAT_GROUP {
+    EMC_STAT_GROUP_TOP,		// RCS status of EMC_STAT/motion/io, debug
+    EMC_STAT_GROUP_TASK,	// task
+    EMC_STAT_GROUP_TRAJ,	// motion.traj
+    EMC_STAT_GROUP_AXIS,	// motion.axis[]
+    EMC_STAT_GROUP_SPINDLE,	// motion.spindle
+    EMC_STAT_GROUP_MOTION_IO,	// motion.synch_di/do, analog_input/output
+    EMC_STAT_GROUP_TOOL,	// io.tool
+    EMC_STAT_GROUP_COOLANT,	// io.coolant
+    EMC_STAT_GROUP_AUX,		// io.aux
+    EMC_STAT_GROUP_LUBE,	// io.lube
+    EMC_STAT_GROUPS
+};
+
+#define EMC_STAT_MASK(group) (1U << (group))
+#define EMC_STAT_ALL         ((1U << EMC_STAT_GROUPS) - 1)
+
+#define EMC_STAT_MIRROR_MAGIC 0x45535431
+
+typedef struct {
+    uint32_t magic;
+    uint32_t size;		// sizeof(EMC_STAT) of the publisher
+    uint32_t sequence;		// bumped on any change - futex word
+    uint32_t waiters;		// clients blocked on sequence
+    uint32_t generation[EMC_STAT_GROUPS];
+} emc_stat_mirror_t;
+
+class EmcStatMirror {
+  public:
+    EmcStatMirror();
+    ~EmcStatMirror();
+
+    // publisher side (task): create the segment
+    int create();
+    // compare stat against the previous call, bump the generations
+    // of all changed groups and wake blocked clients.
+    // Call after the status has been written to the NML buffer.
+    // Returns the mask of changed groups.
+    unsigned publish(const EMC_STAT *stat);
+
+    // client side: attach to the segment created by task.
+    // Returns -1 if there is none (yet), clients should then fall
+    // back to polling.
+    int attach();
+    bool attached() const { return mirror != 0; }
+
+    // the groups in mask which changed since the last call to
+    // changed() or wait(). Does not block.
+    unsigned changed(unsigned mask = EMC_STAT_ALL);
+
+    // like changed(), but block up to timeout seconds until one
+    // of the groups in mask changes. Returns 0 on timeout.
+    unsigned wait(unsigned mask, double timeout);
+
+    void detach();
+
+  private:
+    emc_stat_mirror_t *mirror;
+    bool owner;
+    uint32_t seen[EMC_STAT_GROUPS];	// client: generations last seen
+    EMC_STAT *last;			// publisher: previous status
+};
+
+#endif // EMCSTATMIRROR_HH
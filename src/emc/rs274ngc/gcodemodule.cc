@@ -137,6 +137,195 @@ static PyTypeObject LineCodeType = {
     0,                      /*tp_is_gc*/
 };
 
+static void unrotate(double &x, double &y, double c, double s) {
+    double tx = x * c + y * s;
+    y = -x * s + y * c;
+    x = tx;
+}
+
+static void rotate(double &x, double &y, double c, double s) {
+    double tx = x * c - y * s;
+    y = x * s + y * c;
+    x = tx;
+}
+
+// offsets and rotation which map program coordinates to the preview's
+// translated coordinates, as kept by rs274.interpret.Translated
+struct arc_frame {
+    int plane;
+    double rotation_cos, rotation_sin;
+    double g5xoffset[9], g92offset[9];
+};
+
+// tessellate an arc starting at the translated position lo; appends
+// 9 coordinates per segment to segs and returns the segment count
+static int arc_segments(const arc_frame &fr, const double lo[9],
+        double x1, double y1, double cx, double cy, int rot, double z1,
+        double a, double b, double c, double u, double v, double w,
+        int max_segments, std::vector<double> &segs) {
+    double o[9], n[9];
+    const double *g5xoffset = fr.g5xoffset, *g92offset = fr.g92offset;
+    int X, Y, Z;
+
+    if(fr.plane == 1) {
+        X=0; Y=1; Z=2;
+    } else if(fr.plane == 3) {
+        X=2; Y=0; Z=1;
+    } else {
+        X=1; Y=2; Z=0;
+    }
+    n[X] = x1;
+    n[Y] = y1;
+    n[Z] = z1;
+    n[3] = a;
+    n[4] = b;
+    n[5] = c;
+    n[6] = u;
+    n[7] = v;
+    n[8] = w;
+    for(int ax=0; ax<9; ax++) o[ax] = lo[ax] - g5xoffset[ax];
+    unrotate(o[0], o[1], fr.rotation_cos, fr.rotation_sin);
+    for(int ax=0; ax<9; ax++) o[ax] -= g92offset[ax];
+
+    double theta1 = rtapi_atan2(o[Y]-cy, o[X]-cx);
+    double theta2 = rtapi_atan2(n[Y]-cy, n[X]-cx);
+
+    if(rot < 0) {
+        while(theta2 - theta1 > -CIRCLE_FUZZ) theta2 -= 2*M_PI;
+    } else {
+        while(theta2 - theta1 < CIRCLE_FUZZ) theta2 += 2*M_PI;
+    }
+
+    // if multi-turn, add the right number of full circles
+    if(rot < -1) theta2 += 2*M_PI*(rot+1);
+    if(rot > 1) theta2 += 2*M_PI*(rot-1);
+
+    int steps = std::max(3, int(max_segments * rtapi_fabs(theta1 - theta2) / M_PI));
+    double rsteps = 1. / steps;
+
+    double dtheta = theta2 - theta1;
+    double d[9] = {0, 0, 0, n[3]-o[3], n[4]-o[4], n[5]-o[5], n[6]-o[6], n[7]-o[7], n[8]-o[8]};
+    d[Z] = n[Z] - o[Z];
+
+    double tx = o[X] - cx, ty = o[Y] - cy, dc = rtapi_cos(dtheta*rsteps), ds = rtapi_sin(dtheta*rsteps);
+    for(int i=0; i<steps-1; i++) {
+        double f = (i+1) * rsteps;
+        double p[9];
+        rotate(tx, ty, dc, ds);
+        p[X] = tx + cx;
+        p[Y] = ty + cy;
+        p[Z] = o[Z] + d[Z] * f;
+        p[3] = o[3] + d[3] * f;
+        p[4] = o[4] + d[4] * f;
+        p[5] = o[5] + d[5] * f;
+        p[6] = o[6] + d[6] * f;
+        p[7] = o[7] + d[7] * f;
+        p[8] = o[8] + d[8] * f;
+        for(int ax=0; ax<9; ax++) p[ax] += g92offset[ax];
+        rotate(p[0], p[1], fr.rotation_cos, fr.rotation_sin);
+        for(int ax=0; ax<9; ax++) p[ax] += g5xoffset[ax];
+        segs.insert(segs.end(), p, p+9);
+    }
+    for(int ax=0; ax<9; ax++) n[ax] += g92offset[ax];
+    rotate(n[0], n[1], fr.rotation_cos, fr.rotation_sin);
+    for(int ax=0; ax<9; ax++) n[ax] += g5xoffset[ax];
+    segs.insert(segs.end(), n, n+9);
+    return steps;
+}
+
+/* Native preview sink
+
+   Calling back into Python for every straight_feed, straight_traverse
+   and arc_feed, and allocating a linecode for every line, dominates
+   the load time of large programs.  If the canon object passed to
+   parse() has a 'preview_sink' attribute holding a gcode.previewsink,
+   these moves are instead accumulated in contiguous typed buffers:
+
+     traverse, feed, arcfeed               float32 [n][2][3]  start/end xyz
+     traverse_lines, feed_lines, arcfeed_lines     int32 [n]  line number
+     feed_rates, arcfeed_rates                   float32 [n]  canon.feedrate
+
+   which are exported through the buffer protocol, so numpy.asarray()
+   or memoryview() can hand them to GL without copying.  Arcs are
+   tessellated here with canon.arcdivision segments per half circle.
+
+   The sink mirrors the GLCanon state it needs (lo, first_move,
+   suppress, feedrate, tool offset, plane, g5x/g92 offsets, rotation):
+   before any remaining Python callback the sink's position is pushed
+   to the canon, afterwards the canon's state is read back.  So
+   comments like (AXIS,hide), tool changes, probes and dwells keep
+   their Python semantics.  Rotary and UVW coordinates are tracked for
+   arcs but not stored; canons which need them keep the callback path.
+*/
+
+struct preview_segments {
+    std::vector<float> vertices;
+    std::vector<int> lines;
+    std::vector<float> rates;
+
+    void append(int lineno, const double *s, const double *e, double rate,
+                bool with_rate) {
+        vertices.push_back(s[0]); vertices.push_back(s[1]); vertices.push_back(s[2]);
+        vertices.push_back(e[0]); vertices.push_back(e[1]); vertices.push_back(e[2]);
+        lines.push_back(lineno);
+        if(with_rate) rates.push_back(rate);
+    }
+    void clear() {
+        std::vector<float>().swap(vertices);
+        std::vector<int>().swap(lines);
+        std::vector<float>().swap(rates);
+    }
+};
+
+struct preview_state {
+    preview_segments traverse, feed, arcfeed;
+    double lo[9];
+    bool first_move;
+    int suppress;
+    double feedrate;
+    double to[3];                   // tool length offset xyz
+    int arcdivision;
+    arc_frame frame;
+    double min[3], max[3];          // extents including tool offset
+    double min_nt[3], max_nt[3];    // extents of the programmed path
+    bool dirty;                     // lo/first_move changed since push
+    std::vector<double> arcbuf;
+
+    void reset_extents() {
+        for(int i=0; i<3; i++) {
+            min[i] = min_nt[i] = 9e99;
+            max[i] = max_nt[i] = -9e99;
+        }
+    }
+    void extend(const double *p) {
+        for(int i=0; i<3; i++) {
+            min_nt[i] = std::min(min_nt[i], p[i]);
+            max_nt[i] = std::max(max_nt[i], p[i]);
+            min[i] = std::min(min[i], p[i] + to[i]);
+            max[i] = std::max(max[i], p[i] + to[i]);
+        }
+    }
+};
+
+typedef struct {
+    PyObject_HEAD
+    preview_state *st;
+    int exports;                    // live previewarray objects
+} PreviewSink;
+
+typedef struct {
+    PyObject_HEAD
+    PreviewSink *sink;
+    void *data;
+    const char *format;
+    int ndim;
+    Py_ssize_t itemsize;
+    Py_ssize_t shape[3];
+    Py_ssize_t strides[3];
+} PreviewArray;
+
+static PreviewSink *sink;       // active during parse() only
+
 static PyObject *callback;
 static int interp_error;
 static int last_sequence_number;
@@ -147,7 +336,169 @@ EmcPose tool_offset;
 static InterpBase *pinterp;
 #define interp_new (*pinterp)
 
-#define callmethod(o, m, f, ...) PyObject_CallMethod((o), (char*)(m), (char*)(f), ## __VA_ARGS__)
+// read canon attributes tolerantly: a canon without some of them just
+// keeps the sink's defaults
+static void sink_get(const char *name, double *v) {
+    PyObject *attr = PyObject_GetAttrString(callback, name);
+    if(attr && attr != Py_None) {
+        double d = PyFloat_AsDouble(attr);
+        if(!PyErr_Occurred()) *v = d;
+    }
+    Py_XDECREF(attr);
+    PyErr_Clear();
+}
+
+static void sink_get(const char *name, int *v) {
+    double d = *v;
+    sink_get(name, &d);
+    *v = (int)d;
+}
+
+static void sink_get(const char *name, bool *v) {
+    PyObject *attr = PyObject_GetAttrString(callback, name);
+    if(attr) *v = PyObject_IsTrue(attr) > 0;
+    Py_XDECREF(attr);
+    PyErr_Clear();
+}
+
+static void sink_pull() {
+    preview_state *st = sink->st;
+    static const char *g5x[] = {"g5x_offset_x", "g5x_offset_y", "g5x_offset_z",
+        "g5x_offset_a", "g5x_offset_b", "g5x_offset_c",
+        "g5x_offset_u", "g5x_offset_v", "g5x_offset_w"};
+    static const char *g92[] = {"g92_offset_x", "g92_offset_y", "g92_offset_z",
+        "g92_offset_a", "g92_offset_b", "g92_offset_c",
+        "g92_offset_u", "g92_offset_v", "g92_offset_w"};
+    double rotation_xy = 0;
+
+    PyObject *lo = PyObject_GetAttrString(callback, "lo");
+    if(lo && PySequence_Check(lo) && PySequence_Size(lo) == 9) {
+        for(int i=0; i<9; i++) {
+            PyObject *item = PySequence_GetItem(lo, i);
+            if(item) st->lo[i] = PyFloat_AsDouble(item);
+            Py_XDECREF(item);
+        }
+    }
+    Py_XDECREF(lo);
+    PyErr_Clear();
+
+    sink_get("first_move", &st->first_move);
+    sink_get("suppress", &st->suppress);
+    sink_get("feedrate", &st->feedrate);
+    sink_get("xo", &st->to[0]);
+    sink_get("yo", &st->to[1]);
+    sink_get("zo", &st->to[2]);
+    sink_get("plane", &st->frame.plane);
+    sink_get("arcdivision", &st->arcdivision);
+    for(int i=0; i<9; i++) {
+        sink_get(g5x[i], &st->frame.g5xoffset[i]);
+        sink_get(g92[i], &st->frame.g92offset[i]);
+    }
+    sink_get("rotation_xy", &rotation_xy);
+    if(rotation_xy) {
+        sink_get("rotation_cos", &st->frame.rotation_cos);
+        sink_get("rotation_sin", &st->frame.rotation_sin);
+    } else {
+        st->frame.rotation_cos = 1;
+        st->frame.rotation_sin = 0;
+    }
+    st->dirty = false;
+}
+
+static void sink_push() {
+    preview_state *st = sink->st;
+    if(!st->dirty) return;
+    PyObject *lo = Py_BuildValue("(ddddddddd)", st->lo[0], st->lo[1], st->lo[2],
+            st->lo[3], st->lo[4], st->lo[5], st->lo[6], st->lo[7], st->lo[8]);
+    if(lo) PyObject_SetAttrString(callback, "lo", lo);
+    Py_XDECREF(lo);
+    PyObject_SetAttrString(callback, "first_move",
+            st->first_move ? Py_True : Py_False);
+    PyErr_Clear();
+    st->dirty = false;
+}
+
+// as PyObject_CallMethod, keeping an active preview sink and the canon
+// object in step around the call
+static PyObject *callmethod(PyObject *o, const char *m, const char *f, ...) {
+    PyObject *meth, *args, *result;
+    va_list ap;
+
+    if(sink) sink_push();
+    meth = PyObject_GetAttrString(o, m);
+    if(!meth) return NULL;
+    if(*f) {
+        va_start(ap, f);
+        args = Py_VaBuildValue(f, ap);
+        va_end(ap);
+    } else {
+        args = PyTuple_New(0);
+    }
+    if(args && !PyTuple_Check(args)) {
+        PyObject *t = PyTuple_Pack(1, args);
+        Py_DECREF(args);
+        args = t;
+    }
+    if(!args) {
+        Py_DECREF(meth);
+        return NULL;
+    }
+    result = PyObject_Call(meth, args, NULL);
+    Py_DECREF(args);
+    Py_DECREF(meth);
+    if(sink && result) sink_pull();
+    return result;
+}
+
+static void rotate_and_translate(const arc_frame &fr, double *p) {
+    for(int ax=0; ax<9; ax++) p[ax] += fr.g92offset[ax];
+    rotate(p[0], p[1], fr.rotation_cos, fr.rotation_sin);
+    for(int ax=0; ax<9; ax++) p[ax] += fr.g5xoffset[ax];
+}
+
+static void sink_straight(bool feed, int line_number,
+                          double x, double y, double z,
+                          double a, double b, double c,
+                          double u, double v, double w) {
+    preview_state *st = sink->st;
+    double l[9] = {x, y, z, a, b, c, u, v, w};
+
+    if(st->suppress > 0) return;
+    rotate_and_translate(st->frame, l);
+    if(feed) {
+        st->first_move = false;
+        st->feed.append(line_number, st->lo, l, st->feedrate, true);
+        st->extend(st->lo);
+        st->extend(l);
+    } else if(!st->first_move) {
+        st->traverse.append(line_number, st->lo, l, 0, false);
+        st->extend(st->lo);
+        st->extend(l);
+    }
+    memcpy(st->lo, l, sizeof(l));
+    st->dirty = true;
+}
+
+static void sink_arc(int line_number,
+                     double x1, double y1, double cx, double cy, int rot,
+                     double z1, double a, double b, double c,
+                     double u, double v, double w) {
+    preview_state *st = sink->st;
+
+    if(st->suppress > 0) return;
+    st->first_move = false;
+    st->extend(st->lo);
+    st->arcbuf.clear();
+    int steps = arc_segments(st->frame, st->lo, x1, y1, cx, cy, rot, z1,
+                             a, b, c, u, v, w, st->arcdivision, st->arcbuf);
+    for(int i=0; i<steps; i++) {
+        const double *l = &st->arcbuf[9*i];
+        st->arcfeed.append(line_number, st->lo, l, st->feedrate, true);
+        st->extend(l);
+        memcpy(st->lo, l, sizeof(st->lo));
+    }
+    st->dirty = true;
+}
 
 static void maybe_new_line(int sequence_number=interp_new.sequence_number());
 static void maybe_new_line(int sequence_number) {
@@ -203,6 +554,13 @@ void ARC_FEED(int line_number,
         v_position /= 25.4;
         w_position /= 25.4;
     }
+    if(interp_error) return;
+    if(sink) {
+        sink_arc(line_number, first_end, second_end, first_axis, second_axis,
+                 rotation, axis_end_point, a_position, b_position, c_position,
+                 u_position, v_position, w_position);
+        return;
+    }
     maybe_new_line(line_number);
     if(interp_error) return;
     PyObject *result =
@@ -223,6 +581,11 @@ void STRAIGHT_FEED(int line_number,
     _pos_a=a; _pos_b=b; _pos_c=c;
     _pos_u=u; _pos_v=v; _pos_w=w;
     if(metric) { x /= 25.4; y /= 25.4; z /= 25.4; u /= 25.4; v /= 25.4; w /= 25.4; }
+    if(interp_error) return;
+    if(sink) {
+        sink_straight(true, line_number, x, y, z, a, b, c, u, v, w);
+        return;
+    }
     maybe_new_line(line_number);
     if(interp_error) return;
     PyObject *result =
@@ -240,6 +603,11 @@ void STRAIGHT_TRAVERSE(int line_number,
     _pos_a=a; _pos_b=b; _pos_c=c;
     _pos_u=u; _pos_v=v; _pos_w=w;
     if(metric) { x /= 25.4; y /= 25.4; z /= 25.4; u /= 25.4; v /= 25.4; w /= 25.4; }
+    if(interp_error) return;
+    if(sink) {
+        sink_straight(false, line_number, x, y, z, a, b, c, u, v, w);
+        return;
+    }
     maybe_new_line(line_number);
     if(interp_error) return;
     PyObject *result =
@@ -681,8 +1049,303 @@ void SET_MOTION_CONTROL_MODE(CANON_MOTION_MODE mode) { motion_mode = mode; }
 CANON_MOTION_MODE GET_EXTERNAL_MOTION_CONTROL_MODE() { return motion_mode; }
 void SET_NAIVECAM_TOLERANCE(double tolerance) { }
 
+/* gcode.previewarray: read-only, buffer-protocol view of one sink buffer.
+   While any view exists the sink refuses to parse into or clear its
+   buffers, like a bytearray with exported buffers. */
+
+static void PreviewArray_dealloc(PreviewArray *self) {
+    self->sink->exports--;
+    Py_DECREF(self->sink);
+    PyObject_Del(self);
+}
+
+static Py_ssize_t PreviewArray_bytes(PreviewArray *self) {
+    Py_ssize_t len = self->itemsize;
+    for(int i=0; i<self->ndim; i++) len *= self->shape[i];
+    return len;
+}
+
+static int PreviewArray_getbuffer(PreviewArray *self, Py_buffer *view, int flags) {
+    if(flags & PyBUF_WRITABLE) {
+        PyErr_SetString(PyExc_BufferError, "previewarray is read-only");
+        view->obj = NULL;
+        return -1;
+    }
+    view->obj = (PyObject*)self;
+    Py_INCREF(self);
+    view->buf = self->data;
+    view->len = PreviewArray_bytes(self);
+    view->readonly = 1;
+    view->suboffsets = NULL;
+    view->internal = NULL;
+    if(flags & PyBUF_ND) {
+        view->itemsize = self->itemsize;
+        view->format = (flags & PyBUF_FORMAT) ? (char*)self->format : NULL;
+        view->ndim = self->ndim;
+        view->shape = self->shape;
+        view->strides = (flags & PyBUF_STRIDES) ? self->strides : NULL;
+    } else {
+        view->itemsize = 1;
+        view->format = NULL;
+        view->ndim = 1;
+        view->shape = NULL;
+        view->strides = NULL;
+    }
+    return 0;
+}
+
+static Py_ssize_t PreviewArray_len(PreviewArray *self) {
+    return self->shape[0];
+}
+
+/* the old buffer protocol, for the Python 2 consumers which only know
+   that one (buffer(), str(), PyObject_AsReadBuffer): one read-only
+   segment covering the whole array */
+
+static Py_ssize_t PreviewArray_getreadbuf(PreviewArray *self, Py_ssize_t segment, void **ptr) {
+    if(segment != 0) {
+        PyErr_SetString(PyExc_SystemError, "accessing non-existent previewarray segment");
+        return -1;
+    }
+    *ptr = self->data;
+    return PreviewArray_bytes(self);
+}
+
+static Py_ssize_t PreviewArray_getsegcount(PreviewArray *self, Py_ssize_t *lenp) {
+    if(lenp) *lenp = PreviewArray_bytes(self);
+    return 1;
+}
+
+static Py_ssize_t PreviewArray_getcharbuf(PreviewArray *self, Py_ssize_t segment, char **ptr) {
+    return PreviewArray_getreadbuf(self, segment, (void**)ptr);
+}
+
+static PySequenceMethods PreviewArraySequence = {
+    (lenfunc)PreviewArray_len, /*sq_length*/
+};
+
+static PyBufferProcs PreviewArrayBuffer = {
+    (readbufferproc)PreviewArray_getreadbuf, /*bf_getreadbuffer*/
+    0,                      /*bf_getwritebuffer*/
+    (segcountproc)PreviewArray_getsegcount, /*bf_getsegcount*/
+    (charbufferproc)PreviewArray_getcharbuf, /*bf_getcharbuffer*/
+    (getbufferproc)PreviewArray_getbuffer,
+    0,
+};
+
+static PyTypeObject PreviewArrayType = {
+    PyObject_HEAD_INIT(NULL)
+    0,                      /*ob_size*/
+    "gcode.previewarray",   /*tp_name*/
+    sizeof(PreviewArray),   /*tp_basicsize*/
+    0,                      /*tp_itemsize*/
+    /* methods */
+    (destructor)PreviewArray_dealloc, /*tp_dealloc*/
+    0,                      /*tp_print*/
+    0,                      /*tp_getattr*/
+    0,                      /*tp_setattr*/
+    0,                      /*tp_compare*/
+    0,                      /*tp_repr*/
+    0,                      /*tp_as_number*/
+    &PreviewArraySequence,  /*tp_as_sequence*/
+    0,                      /*tp_as_mapping*/
+    0,                      /*tp_hash*/
+    0,                      /*tp_call*/
+    0,                      /*tp_str*/
+    0,                      /*tp_getattro*/
+    0,                      /*tp_setattro*/
+    &PreviewArrayBuffer,    /*tp_as_buffer*/
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GETCHARBUFFER
+        | Py_TPFLAGS_HAVE_NEWBUFFER, /*tp_flags*/
+    "Read-only view of a preview sink buffer", /*tp_doc*/
+};
+
+enum { SINK_TRAVERSE, SINK_FEED, SINK_ARCFEED };
+enum { SINK_VERTICES, SINK_LINES, SINK_RATES };
+struct sink_array_desc { int kind, field; };
+
+static preview_segments &sink_segments(preview_state *st, int kind) {
+    if(kind == SINK_TRAVERSE) return st->traverse;
+    if(kind == SINK_FEED) return st->feed;
+    return st->arcfeed;
+}
+
+static PyObject *PreviewSink_array(PreviewSink *self, sink_array_desc *d) {
+    preview_segments &seg = sink_segments(self->st, d->kind);
+    PreviewArray *a = PyObject_New(PreviewArray, &PreviewArrayType);
+    if(!a) return NULL;
+    Py_INCREF(self);
+    a->sink = self;
+    self->exports++;
+    a->shape[0] = seg.lines.size();
+    switch(d->field) {
+    case SINK_VERTICES:
+        a->data = seg.vertices.empty() ? NULL : &seg.vertices[0];
+        a->format = "f";
+        a->itemsize = sizeof(float);
+        a->ndim = 3;
+        a->shape[1] = 2;
+        a->shape[2] = 3;
+        break;
+    case SINK_LINES:
+        a->data = seg.lines.empty() ? NULL : &seg.lines[0];
+        a->format = "i";
+        a->itemsize = sizeof(int);
+        a->ndim = 1;
+        break;
+    default:
+        a->data = seg.rates.empty() ? NULL : &seg.rates[0];
+        a->format = "f";
+        a->itemsize = sizeof(float);
+        a->ndim = 1;
+        break;
+    }
+    a->strides[a->ndim-1] = a->itemsize;
+    for(int i=a->ndim-2; i>=0; i--)
+        a->strides[i] = a->strides[i+1] * a->shape[i+1];
+    return (PyObject*)a;
+}
+
+static sink_array_desc sink_arrays[] = {
+    {SINK_TRAVERSE, SINK_VERTICES}, {SINK_TRAVERSE, SINK_LINES},
+    {SINK_FEED, SINK_VERTICES}, {SINK_FEED, SINK_LINES}, {SINK_FEED, SINK_RATES},
+    {SINK_ARCFEED, SINK_VERTICES}, {SINK_ARCFEED, SINK_LINES}, {SINK_ARCFEED, SINK_RATES},
+};
+
+static PyObject *PreviewSink_new(PyTypeObject *type, PyObject *args, PyObject *kw) {
+    PreviewSink *self = (PreviewSink*)type->tp_alloc(type, 0);
+    if(!self) return NULL;
+    self->st = new preview_state();
+    self->st->reset_extents();
+    self->exports = 0;
+    return (PyObject*)self;
+}
+
+static void PreviewSink_dealloc(PreviewSink *self) {
+    delete self->st;
+    self->ob_type->tp_free((PyObject*)self);
+}
+
+static PyObject *PreviewSink_clear(PreviewSink *self) {
+    if(self->exports) {
+        PyErr_SetString(PyExc_BufferError,
+                "previewsink: cannot clear while previewarrays exist");
+        return NULL;
+    }
+    self->st->traverse.clear();
+    self->st->feed.clear();
+    self->st->arcfeed.clear();
+    self->st->reset_extents();
+    Py_RETURN_NONE;
+}
+
+static PyObject *PreviewSink_extents(PreviewSink *self) {
+    preview_state *st = self->st;
+    return Py_BuildValue("[ddd][ddd][ddd][ddd]",
+        st->min[0], st->min[1], st->min[2], st->max[0], st->max[1], st->max[2],
+        st->min_nt[0], st->min_nt[1], st->min_nt[2],
+        st->max_nt[0], st->max_nt[1], st->max_nt[2]);
+}
+
+static PyMethodDef PreviewSinkMethods[] = {
+    {"clear", (PyCFunction)PreviewSink_clear, METH_NOARGS,
+        "Discard all accumulated moves"},
+    {"extents", (PyCFunction)PreviewSink_extents, METH_NOARGS,
+        "Return extents as calc_extents() does"},
+    {NULL}
+};
+
+static PyGetSetDef PreviewSinkGetSet[] = {
+    {(char*)"traverse", (getter)PreviewSink_array, 0, 0, &sink_arrays[0]},
+    {(char*)"traverse_lines", (getter)PreviewSink_array, 0, 0, &sink_arrays[1]},
+    {(char*)"feed", (getter)PreviewSink_array, 0, 0, &sink_arrays[2]},
+    {(char*)"feed_lines", (getter)PreviewSink_array, 0, 0, &sink_arrays[3]},
+    {(char*)"feed_rates", (getter)PreviewSink_array, 0, 0, &sink_arrays[4]},
+    {(char*)"arcfeed", (getter)PreviewSink_array, 0, 0, &sink_arrays[5]},
+    {(char*)"arcfeed_lines", (getter)PreviewSink_array, 0, 0, &sink_arrays[6]},
+    {(char*)"arcfeed_rates", (getter)PreviewSink_array, 0, 0, &sink_arrays[7]},
+    {NULL}
+};
+
+static PyTypeObject PreviewSinkType = {
+    PyObject_HEAD_INIT(NULL)
+    0,                      /*ob_size*/
+    "gcode.previewsink",    /*tp_name*/
+    sizeof(PreviewSink),    /*tp_basicsize*/
+    0,                      /*tp_itemsize*/
+    /* methods */
+    (destructor)PreviewSink_dealloc, /*tp_dealloc*/
+    0,                      /*tp_print*/
+    0,                      /*tp_getattr*/
+    0,                      /*tp_setattr*/
+    0,                      /*tp_compare*/
+    0,                      /*tp_repr*/
+    0,                      /*tp_as_number*/
+    0,                      /*tp_as_sequence*/
+    0,                      /*tp_as_mapping*/
+    0,                      /*tp_hash*/
+    0,                      /*tp_call*/
+    0,                      /*tp_str*/
+    0,                      /*tp_getattro*/
+    0,                      /*tp_setattro*/
+    0,                      /*tp_as_buffer*/
+    Py_TPFLAGS_DEFAULT,     /*tp_flags*/
+    "Accumulates preview moves in typed buffers, see canon.preview_sink", /*tp_doc*/
+    0,                      /*tp_traverse*/
+    0,                      /*tp_clear*/
+    0,                      /*tp_richcompare*/
+    0,                      /*tp_weaklistoffset*/
+    0,                      /*tp_iter*/
+    0,                      /*tp_iternext*/
+    PreviewSinkMethods,     /*tp_methods*/
+    0,                      /*tp_members*/
+    PreviewSinkGetSet,      /*tp_getset*/
+    0,                      /*tp_base*/
+    0,                      /*tp_dict*/
+    0,                      /*tp_descr_get*/
+    0,                      /*tp_descr_set*/
+    0,                      /*tp_dictoffset*/
+    0,                      /*tp_init*/
+    0,                      /*tp_alloc*/
+    PreviewSink_new,        /*tp_new*/
+};
+
+// attach the canon's preview sink, if it has one, for the duration of parse()
+static bool sink_attach() {
+    PyObject *s = PyObject_GetAttrString(callback, "preview_sink");
+    PyErr_Clear();
+    if(!s || !PyObject_TypeCheck(s, &PreviewSinkType)) {
+        Py_XDECREF(s);
+        return true;
+    }
+    if(((PreviewSink*)s)->exports) {
+        Py_DECREF(s);
+        PyErr_SetString(PyExc_BufferError,
+                "previewsink: cannot parse while previewarrays exist");
+        return false;
+    }
+    sink = (PreviewSink*)s;
+    sink->st->arcdivision = 64;
+    sink->st->first_move = true;
+    sink->st->suppress = 0;
+    sink->st->feedrate = 1;
+    memset(sink->st->lo, 0, sizeof(sink->st->lo));
+    memset(sink->st->to, 0, sizeof(sink->st->to));
+    memset(&sink->st->frame, 0, sizeof(sink->st->frame));
+    sink->st->frame.plane = 1;
+    sink_pull();
+    return true;
+}
+
+static void sink_detach(bool ok) {
+    if(!sink) return;
+    if(ok) sink_push();
+    Py_DECREF(sink);
+    sink = NULL;
+}
+
 #define RESULT_OK (result == INTERP_OK || result == INTERP_EXECUTE_FINISH)
-static PyObject *parse_file(PyObject *self, PyObject *args) {
+static PyObject *parse_file_1(PyObject *self, PyObject *args) {
     char *f;
     char *unitcode=0, *initcode=0, *interpname=0;
     int error_line_offset = 0;
@@ -690,6 +1353,8 @@ static PyObject *parse_file(PyObject *self, PyObject *args) {
     int wait = 1;
     if(!PyArg_ParseTuple(args, "sO|sss", &f, &callback, &unitcode, &initcode, &interpname))
         return NULL;
+    if(!sink_attach())
+        return NULL;
 
     if(pinterp) {
         delete pinterp;
@@ -758,6 +1423,12 @@ out_error:
     return retval;
 }
 
+static PyObject *parse_file(PyObject *self, PyObject *args) {
+    PyObject *result = parse_file_1(self, args);
+    sink_detach(result != NULL);
+    return result;
+}
+
 
 static int maxerror = -1;
 
@@ -872,25 +1543,12 @@ static bool get_attr(PyObject *o, const char *attr_name, const char *fmt, ...) {
     return result;
 }
 
-static void unrotate(double &x, double &y, double c, double s) {
-    double tx = x * c + y * s;
-    y = -x * s + y * c;
-    x = tx;
-}
-
-static void rotate(double &x, double &y, double c, double s) {
-    double tx = x * c - y * s;
-    y = x * s + y * c;
-    x = tx;
-}
-
 static PyObject *rs274_arc_to_segments(PyObject *self, PyObject *args) {
     PyObject *canon;
     double x1, y1, cx, cy, z1, a, b, c, u, v, w;
-    double o[9], n[9], g5xoffset[9], g92offset[9];
-    int rot, plane;
-    int X, Y, Z;
-    double rotation_cos, rotation_sin;
+    double o[9];
+    arc_frame fr;
+    int rot;
     int max_segments = 128;
 
     if(!PyArg_ParseTuple(args, "Oddddiddddddd|i:arcs_to_segments",
@@ -898,94 +1556,37 @@ static PyObject *rs274_arc_to_segments(PyObject *self, PyObject *args) {
     if(!get_attr(canon, "lo", "ddddddddd:arcs_to_segments lo", &o[0], &o[1], &o[2],
                     &o[3], &o[4], &o[5], &o[6], &o[7], &o[8]))
         return NULL;
-    if(!get_attr(canon, "plane", &plane)) return NULL;
-    if(!get_attr(canon, "rotation_cos", &rotation_cos)) return NULL;
-    if(!get_attr(canon, "rotation_sin", &rotation_sin)) return NULL;
-    if(!get_attr(canon, "g5x_offset_x", &g5xoffset[0])) return NULL;
-    if(!get_attr(canon, "g5x_offset_y", &g5xoffset[1])) return NULL;
-    if(!get_attr(canon, "g5x_offset_z", &g5xoffset[2])) return NULL;
-    if(!get_attr(canon, "g5x_offset_a", &g5xoffset[3])) return NULL;
-    if(!get_attr(canon, "g5x_offset_b", &g5xoffset[4])) return NULL;
-    if(!get_attr(canon, "g5x_offset_c", &g5xoffset[5])) return NULL;
-    if(!get_attr(canon, "g5x_offset_u", &g5xoffset[6])) return NULL;
-    if(!get_attr(canon, "g5x_offset_v", &g5xoffset[7])) return NULL;
-    if(!get_attr(canon, "g5x_offset_w", &g5xoffset[8])) return NULL;
-    if(!get_attr(canon, "g92_offset_x", &g92offset[0])) return NULL;
-    if(!get_attr(canon, "g92_offset_y", &g92offset[1])) return NULL;
-    if(!get_attr(canon, "g92_offset_z", &g92offset[2])) return NULL;
-    if(!get_attr(canon, "g92_offset_a", &g92offset[3])) return NULL;
-    if(!get_attr(canon, "g92_offset_b", &g92offset[4])) return NULL;
-    if(!get_attr(canon, "g92_offset_c", &g92offset[5])) return NULL;
-    if(!get_attr(canon, "g92_offset_u", &g92offset[6])) return NULL;
-    if(!get_attr(canon, "g92_offset_v", &g92offset[7])) return NULL;
-    if(!get_attr(canon, "g92_offset_w", &g92offset[8])) return NULL;
-
-    if(plane == 1) {
-        X=0; Y=1; Z=2;
-    } else if(plane == 3) {
-        X=2; Y=0; Z=1;
-    } else {
-        X=1; Y=2; Z=0;
-    }
-    n[X] = x1;
-    n[Y] = y1;
-    n[Z] = z1;
-    n[3] = a;
-    n[4] = b;
-    n[5] = c;
-    n[6] = u;
-    n[7] = v;
-    n[8] = w;
-    for(int ax=0; ax<9; ax++) o[ax] -= g5xoffset[ax];
-    unrotate(o[0], o[1], rotation_cos, rotation_sin);
-    for(int ax=0; ax<9; ax++) o[ax] -= g92offset[ax];
-
-    double theta1 = rtapi_atan2(o[Y]-cy, o[X]-cx);
-    double theta2 = rtapi_atan2(n[Y]-cy, n[X]-cx);
-
-    if(rot < 0) {
-        while(theta2 - theta1 > -CIRCLE_FUZZ) theta2 -= 2*M_PI;
-    } else {
-        while(theta2 - theta1 < CIRCLE_FUZZ) theta2 += 2*M_PI;
-    }
-
-    // if multi-turn, add the right number of full circles
-    if(rot < -1) theta2 += 2*M_PI*(rot+1);
-    if(rot > 1) theta2 += 2*M_PI*(rot-1);
-
-    int steps = std::max(3, int(max_segments * rtapi_fabs(theta1 - theta2) / M_PI));
-    double rsteps = 1. / steps;
+    if(!get_attr(canon, "plane", &fr.plane)) return NULL;
+    if(!get_attr(canon, "rotation_cos", &fr.rotation_cos)) return NULL;
+    if(!get_attr(canon, "rotation_sin", &fr.rotation_sin)) return NULL;
+    if(!get_attr(canon, "g5x_offset_x", &fr.g5xoffset[0])) return NULL;
+    if(!get_attr(canon, "g5x_offset_y", &fr.g5xoffset[1])) return NULL;
+    if(!get_attr(canon, "g5x_offset_z", &fr.g5xoffset[2])) return NULL;
+    if(!get_attr(canon, "g5x_offset_a", &fr.g5xoffset[3])) return NULL;
+    if(!get_attr(canon, "g5x_offset_b", &fr.g5xoffset[4])) return NULL;
+    if(!get_attr(canon, "g5x_offset_c", &fr.g5xoffset[5])) return NULL;
+    if(!get_attr(canon, "g5x_offset_u", &fr.g5xoffset[6])) return NULL;
+    if(!get_attr(canon, "g5x_offset_v", &fr.g5xoffset[7])) return NULL;
+    if(!get_attr(canon, "g5x_offset_w", &fr.g5xoffset[8])) return NULL;
+    if(!get_attr(canon, "g92_offset_x", &fr.g92offset[0])) return NULL;
+    if(!get_attr(canon, "g92_offset_y", &fr.g92offset[1])) return NULL;
+    if(!get_attr(canon, "g92_offset_z", &fr.g92offset[2])) return NULL;
+    if(!get_attr(canon, "g92_offset_a", &fr.g92offset[3])) return NULL;
+    if(!get_attr(canon, "g92_offset_b", &fr.g92offset[4])) return NULL;
+    if(!get_attr(canon, "g92_offset_c", &fr.g92offset[5])) return NULL;
+    if(!get_attr(canon, "g92_offset_u", &fr.g92offset[6])) return NULL;
+    if(!get_attr(canon, "g92_offset_v", &fr.g92offset[7])) return NULL;
+    if(!get_attr(canon, "g92_offset_w", &fr.g92offset[8])) return NULL;
+
+    std::vector<double> p;
+    int steps = arc_segments(fr, o, x1, y1, cx, cy, rot, z1, a, b, c, u, v, w,
+                             max_segments, p);
     PyObject *segs = PyList_New(steps);
-
-    double dtheta = theta2 - theta1;
-    double d[9] = {0, 0, 0, n[3]-o[3], n[4]-o[4], n[5]-o[5], n[6]-o[6], n[7]-o[7], n[8]-o[8]};
-    d[Z] = n[Z] - o[Z];
-
-    double tx = o[X] - cx, ty = o[Y] - cy, dc = rtapi_cos(dtheta*rsteps), ds = rtapi_sin(dtheta*rsteps);
-    for(int i=0; i<steps-1; i++) {
-        double f = (i+1) * rsteps;
-        double p[9];
-        rotate(tx, ty, dc, ds);
-        p[X] = tx + cx;
-        p[Y] = ty + cy;
-        p[Z] = o[Z] + d[Z] * f;
-        p[3] = o[3] + d[3] * f;
-        p[4] = o[4] + d[4] * f;
-        p[5] = o[5] + d[5] * f;
-        p[6] = o[6] + d[6] * f;
-        p[7] = o[7] + d[7] * f;
-        p[8] = o[8] + d[8] * f;
-        for(int ax=0; ax<9; ax++) p[ax] += g92offset[ax];
-        rotate(p[0], p[1], rotation_cos, rotation_sin);
-        for(int ax=0; ax<9; ax++) p[ax] += g5xoffset[ax];
+    for(int i=0; i<steps; i++) {
+        const double *q = &p[9*i];
         PyList_SET_ITEM(segs, i,
-            Py_BuildValue("ddddddddd", p[0], p[1], p[2], p[3], p[4], p[5], p[6], p[7], p[8]));
+            Py_BuildValue("ddddddddd", q[0], q[1], q[2], q[3], q[4], q[5], q[6], q[7], q[8]));
     }
-    for(int ax=0; ax<9; ax++) n[ax] += g92offset[ax];
-    rotate(n[0], n[1], rotation_cos, rotation_sin);
-    for(int ax=0; ax<9; ax++) n[ax] += g5xoffset[ax];
-    PyList_SET_ITEM(segs, steps-1,
-        Py_BuildValue("ddddddddd", n[0], n[1], n[2], n[3], n[4], n[5], n[6], n[7], n[8]));
     return segs;
 }
 
@@ -1006,6 +1607,10 @@ initgcode(void) {
                 "Interface to EMC rs274ngc interpreter");
     PyType_Ready(&LineCodeType);
     PyModule_AddObject(m, "linecode", (PyObject*)&LineCodeType);
+    PyType_Ready(&PreviewArrayType);
+    PyType_Ready(&PreviewSinkType);
+    Py_INCREF(&PreviewSinkType);
+    PyModule_AddObject(m, "previewsink", (PyObject*)&PreviewSinkType);
     PyObject_SetAttrString(m, "MAX_ERROR", PyInt_FromLong(maxerror));
     PyObject_SetAttrString(m, "MIN_ERROR",
             PyInt_FromLong(INTERP_MIN_ERROR));
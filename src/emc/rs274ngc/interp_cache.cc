@@ -0,0 +1,645 @@
+/********************************************************************
+* Description: interp_cache.cc
+*
+* Persistent cache of pre-parsed program lines.
+*
+* When [RS274NGC]PROGRAM_CACHE_DIR is set, Interp::open() looks up a
+* cache file for the program being opened, keyed by a hash of the
+* file contents and of the interpreter settings which influence
+* lexing (axis mask, remaps, feature flags). If none exists, one is
+* built by a single lexing pass over the file. The cache is memory
+* mapped; task and the preview (gcodemodule) share the same file.
+*
+* The build is synchronous: the first open() of a new or changed
+* program lexes the whole file before the first line can be read,
+* which costs about as much as parsing it without the cache, plus
+* writing the cache file. Every open() hashes the whole program, which
+* is a small fraction of that. A program which is only run once gains
+* nothing from the cache.
+*
+* [RS274NGC]PROGRAM_CACHE_SIZE bounds the directory, in megabytes
+* (default 256). Each build removes the least recently used cache
+* files beyond that; using a cache file updates its modification time.
+* The file just built is always kept.
+*
+* Only lines whose parse result is independent of runtime state are
+* cached: no O-words, parameters, expressions, comments, block delete
+* or remapped codes. All other lines are marked dynamic and go
+* through read_text()/parse_line() as usual, as does everything
+* read while inside a subroutine, while skipping O-blocks, or after
+* a seek which does not match the recorded line offset.
+*
+* License: GPL Version 2
+* System: Linux
+*
+* Copyright (c) 2026 All rights reserved.
+********************************************************************/
+#include <boost/python.hpp>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <dirent.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "rs274ngc.hh"
+#include "rs274ngc_return.hh"
+#include "interp_internal.hh"
+#include "rs274ngc_interp.hh"
+
+#define PROGRAM_CACHE_MAGIC   0x4343474e	// "NGCC"
+#define PROGRAM_CACHE_VERSION 1
+#define PROGRAM_CACHE_SUFFIX  ".ngcc"
+
+// line kinds
+enum cached_kind {
+    CACHED_DYNAMIC = 0,	// must be parsed at runtime
+    CACHED_BLANK   = 1,	// blank after close_and_downcase()
+    CACHED_STATIC  = 2,	// record carries the read_items() result
+};
+
+// bits in the 'present' word of a static record beyond the letters a..z
+#define CACHED_RADIUS (1U << 26)	// @ word
+#define CACHED_THETA  (1U << 27)	// ^ word
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;		// content + settings hash
+    uint64_t index_offset;	// file offset of uint64_t[nlines + 1]
+    uint32_t nlines;		// index[n] describes physical line n
+    uint32_t pad;
+} cache_header;
+
+/* Each record starts with the int64_t file offset of its line and a
+   kind byte. Static records continue with:
+
+     uint32_t present		bit per letter, plus CACHED_RADIUS/THETA
+     uint8_t  ng, then ng x (uint8_t group, int16_t code)	g_modes
+     uint8_t  nm, then nm x (uint8_t group, int16_t code)	m_modes
+     uint8_t  user_m
+     double   value per bit set in 'present', in bit order
+
+   Records are packed, fields are read with memcpy(). */
+
+struct program_cache {
+    char filename[PATH_MAX];
+    const char *base;		// mapping of the cache file
+    size_t size;
+    const uint64_t *index;	// possibly unaligned, see record_at()
+    uint32_t nlines;
+    int lines_cached;		// statistics, for the log
+    int lines_total;
+};
+
+static uint64_t hash_bytes(uint64_t h, const void *data, size_t len)
+{
+    const unsigned char *p = (const unsigned char *) data;
+    uint64_t w;
+
+    // word-at-a-time so hashing a multi-hundred-megabyte file stays
+    // well below the cost of lexing it
+    while (len >= sizeof(w)) {
+	memcpy(&w, p, sizeof(w));
+	h ^= w;
+	h *= 0x9e3779b97f4a7c15ULL;
+	h ^= h >> 29;
+	p += sizeof(w);
+	len -= sizeof(w);
+    }
+    while (len--) {
+	h ^= *p++;
+	h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+// everything besides the file contents which changes what read_items()
+// produces for a given line
+uint64_t Interp::cache_settings_key()
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+    int i;
+
+    i = PROGRAM_CACHE_VERSION;
+    h = hash_bytes(h, &i, sizeof(i));
+    i = sizeof(block);
+    h = hash_bytes(h, &i, sizeof(i));
+    h = hash_bytes(h, &_setup.feature_set, sizeof(_setup.feature_set));
+    for (i = 0; i < 256; i++) {
+	unsigned char r = (_readers[i] != 0);
+	h = hash_bytes(h, &r, 1);
+    }
+    for (int_remap_iterator it = _setup.g_remapped.begin();
+	 it != _setup.g_remapped.end(); ++it) {
+	if (it->second)
+	    h = hash_bytes(h, &it->first, sizeof(it->first));
+    }
+    h = hash_bytes(h, "m", 1);
+    for (int_remap_iterator it = _setup.m_remapped.begin();
+	 it != _setup.m_remapped.end(); ++it) {
+	if (it->second)
+	    h = hash_bytes(h, &it->first, sizeof(it->first));
+    }
+    return h;
+}
+
+static void put(std::string &out, const void *p, size_t n)
+{
+    out.append((const char *) p, n);
+}
+
+static void put_modes(std::string &out, const int *modes, int n)
+{
+    uint8_t count = 0;
+    int i;
+
+    for (i = 0; i < n; i++)
+	if (modes[i] != -1)
+	    count++;
+    put(out, &count, 1);
+    for (i = 0; i < n; i++) {
+	if (modes[i] != -1) {
+	    uint8_t group = i;
+	    int16_t code = modes[i];
+	    put(out, &group, 1);
+	    put(out, &code, 2);
+	}
+    }
+}
+
+// flag/value pairs of a block, indexed by letter
+#define CACHED_LETTERS(X)						\
+    X('a', a_flag, a_number) X('b', b_flag, b_number)			\
+    X('c', c_flag, c_number) X('d', d_flag, d_number_float)		\
+    X('e', e_flag, e_number) X('f', f_flag, f_number)			\
+    X('h', h_flag, h_number) X('i', i_flag, i_number)			\
+    X('j', j_flag, j_number) X('k', k_flag, k_number)			\
+    X('l', l_flag, l_number) X('p', p_flag, p_number)			\
+    X('q', q_flag, q_number) X('r', r_flag, r_number)			\
+    X('s', s_flag, s_number) X('t', t_flag, t_number)			\
+    X('u', u_flag, u_number) X('v', v_flag, v_number)			\
+    X('w', w_flag, w_number) X('x', x_flag, x_number)			\
+    X('y', y_flag, y_number) X('z', z_flag, z_number)
+
+#define LETTER_BIT(c) (1U << ((c) - 'a'))
+
+static void put_static(std::string &out, block_pointer block)
+{
+    uint32_t present = 0;
+    uint8_t user_m = block->user_m;
+    double v;
+
+#define X(c, flag, num) if (block->flag) present |= LETTER_BIT(c);
+    CACHED_LETTERS(X)
+#undef X
+    if (block->n_number != -1)
+	present |= LETTER_BIT('n');
+    if (block->radius_flag)
+	present |= CACHED_RADIUS;
+    if (block->theta_flag)
+	present |= CACHED_THETA;
+
+    put(out, &present, sizeof(present));
+    put_modes(out, block->g_modes, 16);
+    put_modes(out, block->m_modes, 11);
+    put(out, &user_m, 1);
+
+    // bit order: letters a..z, then radius, theta
+    for (int i = 0; i < 26; i++) {
+	if (!(present & (1U << i)))
+	    continue;
+	switch ('a' + i) {
+#define X(c, flag, num) case c: v = block->num; break;
+	    CACHED_LETTERS(X)
+#undef X
+	case 'n': v = block->n_number; break;
+	default: v = 0; break;
+	}
+	put(out, &v, sizeof(v));
+    }
+    if (present & CACHED_RADIUS)
+	put(out, &block->radius, sizeof(double));
+    if (present & CACHED_THETA)
+	put(out, &block->theta, sizeof(double));
+}
+
+// lex one line of the program into a record; any line which is not
+// provably independent of runtime state is recorded as dynamic
+int Interp::cache_lex_line(const char *raw, size_t len, block_pointer scratch)
+{
+    char line[LINELEN];
+    int index;
+
+    if (len >= LINELEN - 1)
+	return CACHED_DYNAMIC;
+    memcpy(line, raw, len);
+    line[len] = 0;
+    for (index = len - 1; (index >= 0) && isspace(line[index]); index--)
+	line[index] = 0;
+
+    if (close_and_downcase(line) != INTERP_OK)
+	return CACHED_DYNAMIC;
+    if (line[0] == 0)
+	return CACHED_BLANK;
+    // o-words, parameters, expressions, comments, block delete and
+    // percent lines depend on state or have side effects when read
+    if (strpbrk(line, "o#[(;/%"))
+	return CACHED_DYNAMIC;
+
+    init_block(scratch);
+    if (read_items(scratch, line, _setup.parameters) != INTERP_OK)
+	return CACHED_DYNAMIC;
+    if (_setup.parameter_occurrence || _setup.named_parameter_occurrence)
+	return CACHED_DYNAMIC;
+    for (int i = 0; i < 16; i++) {
+	int code = scratch->g_modes[i];
+	if ((code != -1) && _setup.g_remapped[code])
+	    return CACHED_DYNAMIC;
+    }
+    for (int i = 0; i < 11; i++) {
+	int code = scratch->m_modes[i];
+	if ((code != -1) && _setup.m_remapped[code])
+	    return CACHED_DYNAMIC;
+    }
+    return CACHED_STATIC;
+}
+
+int Interp::cache_build(const char *path, uint64_t key,
+			const char *text, size_t size)
+{
+    std::string out;
+    std::vector<uint64_t> index;
+    cache_header hdr;
+    block scratch;
+    char tmpname[PATH_MAX];
+    const char *p = text, *end = text + size;
+    bool diameter_mode = _setup.lathe_diameter_mode;
+    const char *skipping = _setup.skipping_o;
+    int fd, ok;
+
+    memset(&hdr, 0, sizeof(hdr));
+    put(out, &hdr, sizeof(hdr));
+    index.push_back(0);		// lines are numbered from 1
+
+    // lex in a neutral state: x words are stored as programmed and
+    // halved on use if G7 is active
+    _setup.lathe_diameter_mode = false;
+    _setup.skipping_o = 0;
+
+    while (p < end) {
+	const char *eol = (const char *) memchr(p, '\n', end - p);
+	size_t len = (eol ? eol : end) - p;
+	int64_t offset = p - text;
+	uint8_t kind;
+
+	_setup.parameter_occurrence = 0;
+	_setup.named_parameter_occurrence = 0;
+	kind = cache_lex_line(p, len, &scratch);
+
+	index.push_back(out.size());
+	put(out, &offset, sizeof(offset));
+	put(out, &kind, 1);
+	if (kind == CACHED_STATIC)
+	    put_static(out, &scratch);
+	p = eol ? eol + 1 : end;
+    }
+
+    _setup.lathe_diameter_mode = diameter_mode;
+    _setup.skipping_o = skipping;
+    _setup.parameter_occurrence = 0;
+    _setup.named_parameter_occurrence = 0;
+    // errors from lexing dynamic lines will be reported when they are read
+    _setup.stack_index = 0;
+    _setup.stack[0][0] = 0;
+    setSavedError("");
+
+    hdr.magic = PROGRAM_CACHE_MAGIC;
+    hdr.version = PROGRAM_CACHE_VERSION;
+    hdr.key = key;
+    hdr.index_offset = out.size();
+    hdr.nlines = index.size() - 1;
+    memcpy(&out[0], &hdr, sizeof(hdr));
+    index.push_back(out.size());	// sentinel
+    put(out, &index[0], index.size() * sizeof(uint64_t));
+
+    // write to a private name and rename, so concurrent builders
+    // (task and the preview) never see a partial file
+    snprintf(tmpname, sizeof(tmpname), "%s.%d", path, getpid());
+    fd = ::open(tmpname, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+	logDebug("program cache: cannot create %s: %s", tmpname, strerror(errno));
+	return -1;
+    }
+    ok = (write(fd, out.data(), out.size()) == (ssize_t) out.size());
+    ok = (::close(fd) == 0) && ok;
+    if (!ok || rename(tmpname, path)) {
+	logDebug("program cache: cannot write %s: %s", path, strerror(errno));
+	unlink(tmpname);
+	return -1;
+    }
+    return 0;
+}
+
+struct cache_entry {
+    std::string path;
+    off_t size;
+    time_t mtime;
+    bool operator<(const cache_entry &other) const {
+	return mtime < other.mtime;
+    }
+};
+
+// remove the least recently used cache files until the directory is
+// within program_cache_size. Temporaries left by a builder which died
+// count too, the file just built (keep) never goes.
+void Interp::cache_prune(const char *keep)
+{
+    std::vector<cache_entry> entries;
+    off_t total = 0, limit;
+    struct dirent *d;
+    struct stat st;
+    DIR *dir;
+
+    if (_setup.program_cache_size <= 0)
+	return;
+    limit = (off_t) (_setup.program_cache_size * 1024 * 1024);
+    if ((dir = opendir(_setup.program_cache_dir)) == NULL)
+	return;
+    while ((d = readdir(dir)) != NULL) {
+	if (strstr(d->d_name, PROGRAM_CACHE_SUFFIX) == NULL)
+	    continue;
+	cache_entry e;
+	e.path = std::string(_setup.program_cache_dir) + "/" + d->d_name;
+	if (stat(e.path.c_str(), &st) < 0 || !S_ISREG(st.st_mode))
+	    continue;
+	e.size = st.st_size;
+	e.mtime = st.st_mtime;
+	total += e.size;
+	if (e.path != keep)
+	    entries.push_back(e);
+    }
+    closedir(dir);
+
+    std::sort(entries.begin(), entries.end());
+    for (size_t i = 0; i < entries.size() && total > limit; i++) {
+	if (unlink(entries[i].path.c_str()) == 0) {
+	    logDebug("program cache: removed %s", entries[i].path.c_str());
+	    total -= entries[i].size;
+	}
+    }
+}
+
+static struct program_cache *cache_map(const char *path, uint64_t key)
+{
+    struct program_cache *pc;
+    cache_header hdr;
+    struct stat st;
+    void *base;
+    int fd;
+
+    if ((fd = ::open(path, O_RDONLY)) < 0)
+	return NULL;
+    if ((fstat(fd, &st) < 0) || ((size_t) st.st_size < sizeof(hdr))) {
+	::close(fd);
+	return NULL;
+    }
+    base = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED)
+	return NULL;
+
+    memcpy(&hdr, base, sizeof(hdr));
+    if ((hdr.magic != PROGRAM_CACHE_MAGIC) ||
+	(hdr.version != PROGRAM_CACHE_VERSION) ||
+	(hdr.key != key) ||
+	(hdr.index_offset + (hdr.nlines + 2) * sizeof(uint64_t) >
+	 (uint64_t) st.st_size)) {
+	munmap(base, st.st_size);
+	return NULL;
+    }
+    pc = new program_cache;
+    pc->base = (const char *) base;
+    pc->size = st.st_size;
+    pc->index = (const uint64_t *) (pc->base + hdr.index_offset);
+    pc->nlines = hdr.nlines;
+    pc->lines_cached = pc->lines_total = 0;
+    return pc;
+}
+
+// called by Interp::open() once the program file is open. Failure to
+// use the cache is never an error, parsing just proceeds as usual.
+int Interp::cache_open(const char *filename)
+{
+    char path[PATH_MAX];
+    struct stat st;
+    uint64_t key;
+    void *text;
+    int fd;
+
+    cache_close();
+    if (!_setup.program_cache_dir[0])
+	return INTERP_OK;
+
+    if ((fd = ::open(filename, O_RDONLY)) < 0)
+	return INTERP_OK;
+    if ((fstat(fd, &st) < 0) || (st.st_size == 0)) {
+	::close(fd);
+	return INTERP_OK;
+    }
+    text = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (text == MAP_FAILED)
+	return INTERP_OK;
+
+    key = hash_bytes(cache_settings_key(), text, st.st_size);
+    snprintf(path, sizeof(path), "%s/%016llx" PROGRAM_CACHE_SUFFIX,
+	     _setup.program_cache_dir, (unsigned long long) key);
+
+    _setup.program_cache = cache_map(path, key);
+    if (_setup.program_cache) {
+	// the modification time orders cache files for cache_prune()
+	utimes(path, NULL);
+    } else {
+	struct timeval t0, t1;
+
+	logDebug("program cache: building %s for %s", path, filename);
+	gettimeofday(&t0, NULL);
+	if (cache_build(path, key, (const char *) text, st.st_size) == 0) {
+	    _setup.program_cache = cache_map(path, key);
+	    gettimeofday(&t1, NULL);
+	    logDebug("program cache: built in %.3fs",
+		     (t1.tv_sec - t0.tv_sec) + (t1.tv_usec - t0.tv_usec) * 1e-6);
+	    cache_prune(path);
+	}
+    }
+    munmap(text, st.st_size);
+
+    if (_setup.program_cache) {
+	strcpy(_setup.program_cache->filename, filename);
+	logDebug("program cache: using %s, %u lines",
+		 path, _setup.program_cache->nlines);
+    }
+    return INTERP_OK;
+}
+
+void Interp::cache_close()
+{
+    struct program_cache *pc = _setup.program_cache;
+
+    if (pc == NULL)
+	return;
+    logDebug("program cache: %d of %d lines read from cache",
+	     pc->lines_cached, pc->lines_total);
+    munmap((void *) pc->base, pc->size);
+    delete pc;
+    _setup.program_cache = NULL;
+}
+
+static const char *record_at(struct program_cache *pc, int line)
+{
+    uint64_t off, next;
+
+    if ((line < 1) || ((uint32_t) line > pc->nlines))
+	return NULL;
+    memcpy(&off, pc->index + line, sizeof(off));
+    memcpy(&next, pc->index + line + 1, sizeof(next));
+    if ((off >= next) || (next > pc->size))
+	return NULL;
+    return pc->base + off;
+}
+
+static const char *get_modes(const char *r, int *modes, int *count)
+{
+    uint8_t n, group;
+    int16_t code;
+
+    n = *r++;
+    for (int i = 0; i < n; i++) {
+	group = *r++;
+	memcpy(&code, r, 2);
+	r += 2;
+	modes[group] = code;
+    }
+    if (count)
+	*count = n;
+    return r;
+}
+
+/*! read_cached
+
+Returned Value: int
+   If enhance_block, check_items or find_remappings return an error
+   code, this returns that code.
+   If the program ended unexpectedly:
+      NCE_FILE_ENDED_WITH_NO_PERCENT_SIGN_OR_PROGRAM_END
+   Otherwise, it returns INTERP_OK.
+
+Side effects:
+   *hit is set if the next line of the open file was taken from the
+   program cache. In that case the raw line has been read into
+   _setup.linetext and the block filled from the cached record as
+   parse_line() would have; otherwise nothing has been consumed.
+
+Called by: Interp::_read
+
+*/
+
+int Interp::read_cached(block_pointer block, int *hit)
+{
+    struct program_cache *pc = _setup.program_cache;
+    const char *r;
+    int64_t offset;
+    uint8_t kind;
+    int index;
+
+    *hit = 0;
+    pc->lines_total++;
+    if ((_setup.call_level != 0) || _setup.skipping_o ||
+	_setup.skipping_to_sub ||
+	strcmp(_setup.filename, pc->filename))
+	return INTERP_OK;
+
+    r = record_at(pc, _setup.sequence_number + 1);
+    if (r == NULL)
+	return INTERP_OK;
+    memcpy(&offset, r, sizeof(offset));
+    kind = r[sizeof(offset)];
+    if ((offset != block->offset) || (kind == CACHED_DYNAMIC))
+	return INTERP_OK;
+    r += sizeof(offset) + 1;
+
+    if (fgets(_setup.linetext, LINELEN, _setup.file_pointer) == NULL)
+	ERS(NCE_FILE_ENDED_WITH_NO_PERCENT_SIGN_OR_PROGRAM_END);
+    _setup.sequence_number++;
+    for (index = (strlen(_setup.linetext) - 1);
+	 (index >= 0) && (isspace(_setup.linetext[index]));
+	 index--) {
+	_setup.linetext[index] = 0;
+    }
+    _setup.blocktext[0] = 0;
+    _setup.parameter_occurrence = 0;
+    *hit = 1;
+    pc->lines_cached++;
+
+    if (kind == CACHED_BLANK) {
+	_setup.line_length = 0;
+	if (block->o_type != O_none)
+	    block->o_type = 0;
+	return INTERP_OK;
+    }
+    _setup.line_length = strlen(_setup.linetext);
+
+    uint32_t present;
+    uint8_t user_m;
+    double v;
+
+    CHP(init_block(block));
+    memcpy(&present, r, sizeof(present));
+    r += sizeof(present);
+    r = get_modes(r, block->g_modes, NULL);
+    r = get_modes(r, block->m_modes, &block->m_count);
+    user_m = *r++;
+    block->user_m = user_m;
+
+    for (int i = 0; i < 26; i++) {
+	if (!(present & (1U << i)))
+	    continue;
+	memcpy(&v, r, sizeof(v));
+	r += sizeof(v);
+	switch ('a' + i) {
+#define X(c, flag, num) case c: block->flag = true; block->num = v; break;
+	    CACHED_LETTERS(X)
+#undef X
+	case 'n': block->n_number = (int) v; break;
+	}
+    }
+    if (present & CACHED_RADIUS) {
+	memcpy(&block->radius, r, sizeof(double));
+	r += sizeof(double);
+	block->radius_flag = true;
+    }
+    if (present & CACHED_THETA) {
+	memcpy(&block->theta, r, sizeof(double));
+	block->theta_flag = true;
+    }
+    if (block->x_flag && _setup.lathe_diameter_mode)
+	block->x_number /= 2;
+
+    // the remainder of parse_line()
+    CHP(enhance_block(block, &_setup));
+    CHP(check_items(block, &_setup));
+    int n = find_remappings(block, &_setup);
+    if (n) logRemap("read_cached: found %d remappings", n);
+    return INTERP_OK;
+}
@@ -18,6 +18,7 @@
 #include <algorithm>
 #include "config.h"
 #include <limits.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <set>
 #include <map>
@@ -744,6 +745,9 @@ typedef struct setup_struct
   int debugmask;                     // from ini  EMC/DEBUG
   char log_file[PATH_MAX];
   char program_prefix[PATH_MAX];            // program directory
+  char program_cache_dir[PATH_MAX];         // [RS274NGC]PROGRAM_CACHE_DIR
+  double program_cache_size;                // [RS274NGC]PROGRAM_CACHE_SIZE, MB
+  struct program_cache *program_cache;      // pre-parsed lines of open file
   const char *subroutines[MAX_SUB_DIRS];  // subroutines directories
   int use_lazy_close;                // wait until next open before closing
                                      // the input file
@@ -117,6 +117,8 @@ setup_struct::setup_struct() :
     feed_hold(0),
     loggingLevel(0),
     debugmask(0),
+    program_cache_size(256.0),
+    program_cache(NULL),
     use_lazy_close(0),
     lazy_closing(0),
     tool_change_at_g30(0),
@@ -152,6 +154,7 @@ setup_struct::setup_struct() :
     memset(subroutines, 0, sizeof(subroutines));
     memset(log_file, 0, sizeof(log_file));
     memset(program_prefix, 0, sizeof(program_prefix));
+    memset(program_cache_dir, 0, sizeof(program_cache_dir));
     memset(wizard_root, 0, sizeof(wizard_root));
     memset(tool_table, 0, sizeof(tool_table));
     ZERO_EMC_POSE(tool_offset);
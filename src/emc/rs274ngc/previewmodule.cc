@@ -32,6 +32,10 @@ using namespace google::protobuf;
 #include "canon.hh"
 #include "config.h"		// LINELEN
 
+#include <deque>
+#include <vector>
+#include <algorithm>
+
 #include "czmq.h"
 #include "pbutil.hh" // hal/haltalk
 
@@ -42,7 +46,7 @@ static const char *p_client = "preview"; //NULL; // single client for now
 
 static machinetalk::Container istat, output;
 
-static size_t n_containers, n_messages, n_bytes;
+static size_t n_containers, n_messages, n_bytes, n_dropped;
 
 
 // #define REPLY_TIMEOUT 3000 //ms
@@ -69,26 +73,345 @@ static void publish_istat(machinetalk::InterpreterStateType state)
     }
 }
 
+// chunked streaming
+//
+// With PREVIEW_CHUNK set in the environment, moves are not sent as one
+// Preview submessage each.  Their end points are collected into PV_CHUNK
+// entries holding a PreviewChunk with packed type/line/x/y/z columns, arcs
+// tessellated here.  Any other entry closes the open chunk first, so the
+// order of offsets, feed changes etc. relative to the moves is kept.
+//
+// Chunk size follows the consumer: the preview socket is ZMQ_XPUB_NODROP
+// with a send high-water mark of send_hwm containers, and sends never
+// block.  A send which finds the queue full means the subscriber is behind
+// and the chunk size doubles (fewer, larger containers); sends which go
+// out immediately let it decay towards chunk_min again.  A full queue is
+// retried for at most send_timeout, after that the container is dropped
+// and counted so a stuck subscriber cannot hang the interpreter.  A
+// pending container is flushed at least every flush_interval so the first
+// moves show up quickly.
+//
+// PREVIEW_LOD=<tolerance> adds a coarse pass: while parsing, runs of moves
+// of the same type are merged as long as every dropped point stays within
+// tolerance of the merged segment, and chunks are tagged lod=1.  The full
+// detail stream is kept and sent as a second PV_PREVIEW_START ..
+// PV_PREVIEW_END pass (lod=0) once parsing is done.  The kept stream is
+// bounded by refine_max points (PREVIEW_LOD_MAX); a program beyond that
+// drops the refine pass and streams the rest of its moves at full detail
+// in the first pass.
+
+static bool chunked;
+static double lod_tolerance;            // > 0: coarse pass, then refine
+static int chunk_min = 256, chunk_max = 65536;
+static int chunk_limit = 256;           // points per chunk, adaptive
+static int64_t flush_interval = 100000; // usec
+static int64_t blocked_threshold = 2000; // usec; slower sends mean backpressure
+static int send_hwm = 32;               // containers queued per subscriber
+static int64_t send_timeout = 1000000;  // usec; then a container is dropped
+static int64_t last_flush;
+static int chunk_sequence;
+static int arc_division = 64;
+
+static machinetalk::PreviewChunk *open_chunk;  // last entry in output, if any
+
+// lod > 0: the full-detail pass, replayed after the coarse one
+static bool coarse;                     // this program streams a coarse pass
+static std::deque<machinetalk::Preview> refine;
+static machinetalk::PreviewChunk *fine_chunk;  // last entry in refine, if any
+static size_t refine_points, refine_max = 1000000;
+
+struct lod_point {
+    machinetalk::PreviewOpType type;
+    int line_number;
+    double x, y, z;
+};
+#define LOD_RUN_MAX 256
+// lod_run[0] is the last point sent, the rest are candidates for merging
+static std::vector<lod_point> lod_run;
+
+static size_t n_chunks, n_points, n_points_sent;
+
+// send output as a client/container message without blocking. Only the
+// first frame can find the queue full (EAGAIN), the rest of a message is
+// always accepted once that went out.  Returns 0, or -1 with the container
+// dropped; *blocked tells whether the queue was full at first.
+static int send_output(const char *client, bool *blocked)
+{
+    void *socket = zsock_resolve(z_preview);
+    int64_t deadline = zclock_usecs() + send_timeout;
+    std::string buf;
+
+    output.SerializeToString(&buf);
+    output.Clear();
+    *blocked = false;
+    while (zmq_send(socket, client, strlen(client),
+		    ZMQ_SNDMORE | ZMQ_DONTWAIT) < 0) {
+	// ZMQ_POLLOUT is always set on an XPUB socket, so poll by retrying
+	if (zmq_errno() != EAGAIN || zclock_usecs() > deadline)
+	    return -1;
+	*blocked = true;
+	zclock_sleep(1);
+    }
+    if (zmq_send(socket, buf.data(), buf.size(), ZMQ_DONTWAIT) < 0)
+	return -1;
+    return 0;
+}
+
+static void send_container(const char *client)
+{
+    bool blocked;
+    int64_t t0 = zclock_usecs();
+
+    n_containers++;
+    n_bytes += output.ByteSize();
+    output.set_type(machinetalk::MT_PREVIEW);
+    if (send_output(client, &blocked)) {
+	if (!n_dropped++)
+	    fprintf(stderr, "preview: subscriber stalled, dropping containers\n");
+    }
+    open_chunk = NULL;
+
+    last_flush = zclock_usecs();
+    if (!chunked)
+	return;
+    if (blocked || last_flush - t0 > blocked_threshold)
+	chunk_limit = std::min(chunk_limit * 2, chunk_max);
+    else
+	chunk_limit = std::max(chunk_limit - chunk_limit / 4, chunk_min);
+}
+
+static machinetalk::PreviewChunk *new_chunk(machinetalk::Preview *p, int lod)
+{
+    machinetalk::PreviewChunk *c;
+
+    p->set_type(machinetalk::PV_CHUNK);
+    c = p->mutable_chunk();
+    c->set_sequence(chunk_sequence++);
+    c->set_lod(lod);
+    if (lod)
+	c->set_tolerance(lod_tolerance);
+    n_chunks++;
+    return c;
+}
+
+static void chunk_append(machinetalk::PreviewChunk *c, const lod_point &q)
+{
+    c->add_type(q.type);
+    c->add_line_number(q.line_number);
+    c->add_x(q.x);
+    c->add_y(q.y);
+    c->add_z(q.z);
+}
+
+// add a point to the chunk going out now
+static void chunk_send(const lod_point &q)
+{
+    if (!open_chunk) {
+	open_chunk = new_chunk(output.add_preview(), coarse);
+	n_messages++;
+    }
+    chunk_append(open_chunk, q);
+    n_points_sent++;
+}
+
+static double segment_distance(const lod_point &a, const lod_point &b,
+			       const lod_point &p)
+{
+    double dx = b.x - a.x, dy = b.y - a.y, dz = b.z - a.z;
+    double px = p.x - a.x, py = p.y - a.y, pz = p.z - a.z;
+    double l2 = dx * dx + dy * dy + dz * dz;
+    double t = l2 > 0 ? (px * dx + py * dy + pz * dz) / l2 : 0;
+
+    t = std::max(0.0, std::min(1.0, t));
+    px -= t * dx;
+    py -= t * dy;
+    pz -= t * dz;
+    return rtapi_sqrt(px * px + py * py + pz * pz);
+}
+
+// send the last pending point of the current run, which becomes the anchor
+static void lod_flush()
+{
+    if (lod_run.size() > 1) {
+	lod_point anchor = lod_run.back();
+	chunk_send(anchor);
+	lod_run.clear();
+	lod_run.push_back(anchor);
+    }
+}
+
+static void lod_add(const lod_point &q)
+{
+    if (q.type == machinetalk::PV_RIGID_TAP) {
+	// goes there and back, never merged; the anchor stays
+	lod_flush();
+	chunk_send(q);
+	return;
+    }
+    if (lod_run.empty()) {
+	chunk_send(q);
+	lod_run.push_back(q);
+	return;
+    }
+    if (lod_run.size() > 1) {
+	bool fits = q.type == lod_run[1].type && lod_run.size() < LOD_RUN_MAX;
+	for (size_t i = 1; fits && i < lod_run.size(); i++)
+	    fits = segment_distance(lod_run[0], q, lod_run[i]) <= lod_tolerance;
+	if (!fits)
+	    lod_flush();
+    }
+    lod_run.push_back(q);
+}
+
+// any entry other than a move ends the open chunk(s)
+static void chunk_break()
+{
+    lod_flush();
+    lod_run.clear();
+    open_chunk = NULL;
+    fine_chunk = NULL;
+}
+
+static void send_preview(const char *client, bool flush);
+
+// the refine pass grew past refine_max: give it up, the rest of the
+// program goes out at full detail in this pass
+static void refine_drop()
+{
+    lod_flush();
+    lod_run.clear();
+    open_chunk = NULL;
+    fine_chunk = NULL;
+    refine.clear();
+    coarse = false;
+    fprintf(stderr, "preview: more than %zu points, no refine pass\n",
+	    refine_max);
+}
+
+// queue one move end point
+static void chunk_move(machinetalk::PreviewOpType type, int line_number,
+		       double x, double y, double z)
+{
+    lod_point q = { type, line_number, x, y, z };
+
+    n_points++;
+    if (coarse && refine_points >= refine_max)
+	refine_drop();
+    if (coarse) {
+	if (!fine_chunk || fine_chunk->x_size() >= chunk_max) {
+	    refine.push_back(machinetalk::Preview());
+	    fine_chunk = new_chunk(&refine.back(), 0);
+	}
+	chunk_append(fine_chunk, q);
+	refine_points++;
+	lod_add(q);
+    } else {
+	chunk_send(q);
+    }
+    if ((open_chunk && open_chunk->x_size() >= chunk_limit) ||
+	(output.preview_size() && zclock_usecs() - last_flush > flush_interval))
+	send_preview(p_client, true);
+}
+
+// tessellate an arc in the canon frame, like gcode.arc_to_segments() does
+// after removing offsets and rotation
+static void chunk_arc(int line_number, CANON_PLANE plane, const double start[3],
+		      double first_end, double second_end,
+		      double first_axis, double second_axis, int rotation,
+		      double axis_end_point)
+{
+    int X, Y, Z;
+    if (plane == CANON_PLANE_XZ) {
+	X = 2; Y = 0; Z = 1;
+    } else if (plane == CANON_PLANE_YZ) {
+	X = 1; Y = 2; Z = 0;
+    } else {
+	X = 0; Y = 1; Z = 2;
+    }
+    double theta1 = rtapi_atan2(start[Y] - second_axis, start[X] - first_axis);
+    double theta2 = rtapi_atan2(second_end - second_axis, first_end - first_axis);
+
+    if (rotation < 0) {
+	while (theta2 - theta1 > -CIRCLE_FUZZ) theta2 -= 2*M_PI;
+    } else {
+	while (theta2 - theta1 < CIRCLE_FUZZ) theta2 += 2*M_PI;
+    }
+    if (rotation < -1) theta2 += 2*M_PI*(rotation+1);
+    if (rotation > 1) theta2 += 2*M_PI*(rotation-1);
+
+    int steps = std::max(3, int(arc_division * rtapi_fabs(theta2 - theta1) / M_PI));
+    double dtheta = (theta2 - theta1) / steps;
+    double dc = rtapi_cos(dtheta), ds = rtapi_sin(dtheta);
+    double tx = start[X] - first_axis, ty = start[Y] - second_axis;
+    double p[3];
+
+    for (int i = 1; i < steps; i++) {
+	double t = tx * dc - ty * ds;
+	ty = tx * ds + ty * dc;
+	tx = t;
+	p[X] = first_axis + tx;
+	p[Y] = second_axis + ty;
+	p[Z] = start[Z] + (axis_end_point - start[Z]) * i / steps;
+	chunk_move(machinetalk::PV_ARC_FEED, line_number, p[0], p[1], p[2]);
+    }
+    p[X] = first_end;
+    p[Y] = second_end;
+    p[Z] = axis_end_point;
+    chunk_move(machinetalk::PV_ARC_FEED, line_number, p[0], p[1], p[2]);
+}
+
+// start a new preview entry which is not a move
+static machinetalk::Preview *add_preview()
+{
+    if (chunked)
+	chunk_break();
+    return output.add_preview();
+}
+
 // send off a preview frame if sufficent preview frames accumulated, or flushing
 // is is assumed a repeated submessage preview was just added
 static void send_preview(const char *client, bool flush = false)
 {
-    int retval;
-    n_messages++;
+    int n = output.preview_size();
 
-    if ((output.preview_size() > batch_limit) || flush) {
-	n_containers++;
-	n_bytes += output.ByteSize();
-	output.set_type(machinetalk::MT_PREVIEW);
-	retval = send_pbcontainer(client, output, z_preview);
-	assert(retval == 0);
+    if (!flush) {
+	n_messages++;
+	// keep everything but the coarse moves for the refine pass
+	if (coarse && n)
+	    refine.push_back(output.preview(n - 1));
+    }
+    if ((n > batch_limit) || (flush && n))
+	send_container(client);
+}
+
+// send the full-detail pass kept while streaming the coarse one
+static void send_refine(const char *client)
+{
+    for (size_t i = 0; i < refine.size(); i++) {
+	output.add_preview()->Swap(&refine[i]);
+	if ((output.preview_size() > batch_limit) ||
+	    (output.preview(output.preview_size() - 1).type() == machinetalk::PV_CHUNK))
+	    send_container(client);
     }
+    if (output.preview_size())
+	send_container(client);
+    refine.clear();
+    refine_points = 0;
 }
 
 // send preview start message
 static void preview_start()
 {
-    machinetalk::Preview *p = output.add_preview();
+    chunk_sequence = 0;
+    chunk_limit = chunk_min;
+    coarse = lod_tolerance > 0;
+    refine.clear();
+    refine_points = 0;
+    fine_chunk = NULL;
+    lod_run.clear();
+    last_flush = zclock_usecs();
+
+    machinetalk::Preview *p = add_preview();
     p->set_type(machinetalk::PV_PREVIEW_START);
     send_preview(p_client);
 }
@@ -96,9 +419,13 @@ static void preview_start()
 // send preview end message
 static void preview_end()
 {
-    machinetalk::Preview *p = output.add_preview();
+    machinetalk::Preview *p = add_preview();
     p->set_type(machinetalk::PV_PREVIEW_END);
     send_preview(p_client);
+    if (coarse) {
+	send_preview(p_client, true);
+	send_refine(p_client);
+    }
 }
 
 static int z_init(void)
@@ -110,6 +437,14 @@ static int z_init(void)
 
     if (getenv("BATCH"))
 	batch_limit = atoi(getenv("BATCH"));
+    if (getenv("PREVIEW_CHUNK"))
+	chunked = true;
+    if (getenv("PREVIEW_LOD")) {
+	lod_tolerance = atof(getenv("PREVIEW_LOD"));
+	chunked = lod_tolerance > 0 || chunked;
+    }
+    if (getenv("PREVIEW_LOD_MAX"))
+	refine_max = strtoul(getenv("PREVIEW_LOD_MAX"), NULL, 10);
 
     // Verify that the version of the library that we linked against is
     // compatible with the version of the headers we compiled against.
@@ -117,6 +452,14 @@ static int z_init(void)
 
 
     z_preview = zsock_new (ZMQ_XPUB);
+#ifdef ZMQ_XPUB_NODROP
+    // report a full queue instead of dropping silently when a subscriber
+    // falls behind, which is how chunk sizing notices backpressure
+    if (chunked) {
+	zsock_set_sndhwm(z_preview, send_hwm);
+	zsock_set_xpub_nodrop(z_preview, 1);
+    }
+#endif
 #if 0
     rc = zsock_bind(z_preview, z_preview_uri);
     assert (rc != 0);
@@ -145,6 +488,13 @@ static void z_shutdown(void)
         fprintf(stderr, "preview: %zu containers %zu preview msgs %zu bytes  avg=%zu bytes/container\n",
             n_containers, n_messages, n_bytes, n_bytes/n_containers);
     }
+    if (n_dropped > 0)
+        fprintf(stderr, "preview: %zu containers dropped\n", n_dropped);
+    if (n_chunks > 0)
+    {
+        fprintf(stderr, "preview: %zu chunks %zu points, %zu points in coarse pass\n",
+            n_chunks, n_points, lod_tolerance > 0 ? n_points_sent : n_points);
+    }
     zsock_destroy(&z_preview);
     zsock_destroy(&z_status);
 }
@@ -317,6 +667,7 @@ void ARC_FEED(int line_number,
               double a_position, double b_position, double c_position,
               double u_position, double v_position, double w_position) {
     double x, y, z;
+    double start[3] = { _pos_x, _pos_y, _pos_z };
     if (_pl == CANON_PLANE_XY) {
         x = first_end;
         y = second_end;
@@ -351,7 +702,13 @@ void ARC_FEED(int line_number,
     // if(result == NULL) interp_error ++;
     // Py_XDECREF(result);
 
-    machinetalk::Preview *p = output.add_preview();
+    if (chunked) {
+	chunk_arc(line_number, _pl, start, first_end, second_end,
+		  first_axis, second_axis, rotation, axis_end_point);
+	return;
+    }
+
+    machinetalk::Preview *p = add_preview();
     p->set_type(machinetalk::PV_ARC_FEED);
     p->set_line_number(line_number);
     p->set_first_end(first_end);
@@ -390,7 +747,12 @@ void STRAIGHT_FEED(int line_number,
     // if(result == NULL) interp_error ++;
     // Py_XDECREF(result);
 
-    machinetalk::Preview *p = output.add_preview();
+    if (chunked) {
+	chunk_move(machinetalk::PV_STRAIGHT_FEED, line_number, x, y, z);
+	return;
+    }
+
+    machinetalk::Preview *p = add_preview();
     p->set_type(machinetalk::PV_STRAIGHT_FEED);
     p->set_line_number(line_number);
 
@@ -423,7 +785,12 @@ void STRAIGHT_TRAVERSE(int line_number,
     // if(result == NULL) interp_error ++;
     // Py_XDECREF(result);
 
-    machinetalk::Preview *p = output.add_preview();
+    if (chunked) {
+	chunk_move(machinetalk::PV_STRAIGHT_TRAVERSE, line_number, x, y, z);
+	return;
+    }
+
+    machinetalk::Preview *p = add_preview();
     p->set_type(machinetalk::PV_STRAIGHT_TRAVERSE);
     p->set_line_number(line_number);
 
@@ -453,7 +820,7 @@ void SET_G5X_OFFSET(int g5x_index,
     // if(result == NULL) interp_error ++;
     // Py_XDECREF(result);
 
-    machinetalk::Preview *p = output.add_preview();
+    machinetalk::Preview *p = add_preview();
     p->set_type(machinetalk::PV_SET_G5X_OFFSET);
     //    p->set_line_number(line_number);
     p->set_g5_index(g5x_index);
@@ -484,7 +851,7 @@ void SET_G92_OFFSET(double x, double y, double z,
     // if(result == NULL) interp_error ++;
     // Py_XDECREF(result);
 
-    machinetalk::Preview *p = output.add_preview();
+    machinetalk::Preview *p = add_preview();
     p->set_type(machinetalk::PV_SET_G92_OFFSET);
     //    p->set_line_number(line_number);
 
@@ -509,7 +876,7 @@ void SET_XY_ROTATION(double t) {
     //     callmethod(callback, "set_xy_rotation", "f", t);
     // if(result == NULL) interp_error ++;
 
-    machinetalk::Preview *p = output.add_preview();
+    machinetalk::Preview *p = add_preview();
     p->set_type(machinetalk::PV_SET_G92_OFFSET);
     //    p->set_line_number(line_number);
     p->set_xy_rotation(t);
@@ -524,7 +891,7 @@ void SELECT_PLANE(CANON_PLANE pl) {
     maybe_new_line();
     if(interp_error) return;
 
-    machinetalk::Preview *p = output.add_preview();
+    machinetalk::Preview *p = add_preview();
     p->set_type(machinetalk::PV_SELECT_PLANE);
     p->set_plane(pl);
     send_preview(p_client);
@@ -543,7 +910,7 @@ void SET_TRAVERSE_RATE(double rate) {
     // if(result == NULL) interp_error ++;
     // Py_XDECREF(result);
 
-    machinetalk::Preview *p = output.add_preview();
+    machinetalk::Preview *p = add_preview();
     p->set_type(machinetalk::PV_SET_TRAVERSE_RATE);
     //    p->set_line_number(line_number);
     p->set_rate(rate);
@@ -570,7 +937,7 @@ void CHANGE_TOOL(int pocket) {
     if(result == NULL) interp_error ++;
     Py_XDECREF(result);
 
-    machinetalk::Preview *p = output.add_preview();
+    machinetalk::Preview *p = add_preview();
     p->set_type(machinetalk::PV_CHANGE_TOOL);
     //    p->set_line_number(line_number);
     p->set_pocket(pocket);
@@ -595,7 +962,7 @@ void SET_FEED_RATE(double rate) {
     // if(result == NULL) interp_error ++;
     // Py_XDECREF(result);
 
-    machinetalk::Preview *p = output.add_preview();
+    machinetalk::Preview *p = add_preview();
     p->set_type(machinetalk::PV_SET_FEED_RATE);
     //    p->set_line_number(line_number);
     p->set_rate(rate);
@@ -611,7 +978,7 @@ void DWELL(double time) {
     // if(result == NULL) interp_error ++;
     // Py_XDECREF(result);
 
-    machinetalk::Preview *p = output.add_preview();
+    machinetalk::Preview *p = add_preview();
     p->set_type(machinetalk::PV_DWELL);
     //    p->set_line_number(line_number);
     p->set_time(time);
@@ -627,7 +994,7 @@ void MESSAGE(char *comment) {
     // if(result == NULL) interp_error ++;
     // Py_XDECREF(result);
 
-    machinetalk::Preview *p = output.add_preview();
+    machinetalk::Preview *p = add_preview();
     p->set_type(machinetalk::PV_MESSAGE);
     //    p->set_line_number(line_number);
     p->set_text(comment);
@@ -648,7 +1015,7 @@ void COMMENT(const char *comment) {
     // if(result == NULL) interp_error ++;
     // Py_XDECREF(result);
 
-    machinetalk::Preview *p = output.add_preview();
+    machinetalk::Preview *p = add_preview();
     p->set_type(machinetalk::PV_COMMENT);
     //    p->set_line_number(line_number);
     p->set_text(comment);
@@ -670,7 +1037,7 @@ void USE_TOOL_LENGTH_OFFSET(EmcPose offset) {
     // if(result == NULL) interp_error ++;
     // Py_XDECREF(result);
 
-    machinetalk::Preview *p = output.add_preview();
+    machinetalk::Preview *p = add_preview();
     p->set_type(machinetalk::PV_USE_TOOL_OFFSET);
     //    p->set_line_number(line_number);
 
@@ -776,7 +1143,12 @@ void STRAIGHT_PROBE(int line_number,
     // if(result == NULL) interp_error ++;
     // Py_XDECREF(result);
 
-    machinetalk::Preview *p = output.add_preview();
+    if (chunked) {
+	chunk_move(machinetalk::PV_STRAIGHT_PROBE, line_number, x, y, z);
+	return;
+    }
+
+    machinetalk::Preview *p = add_preview();
     p->set_type(machinetalk::PV_STRAIGHT_PROBE);
     p->set_line_number(line_number);
 
@@ -803,7 +1175,13 @@ void RIGID_TAP(int line_number,
     // if(result == NULL) interp_error ++;
     // Py_XDECREF(result);
 
-    machinetalk::Preview *p = output.add_preview();
+    if (chunked) {
+	// the client returns to the previous point after a PV_RIGID_TAP row
+	chunk_move(machinetalk::PV_RIGID_TAP, line_number, x, y, z);
+	return;
+    }
+
+    machinetalk::Preview *p = add_preview();
     p->set_type(machinetalk::PV_RIGID_TAP);
     p->set_line_number(line_number);
 
@@ -1044,7 +1422,7 @@ static PyObject *parse_file(PyObject *self, PyObject *args) {
     interp_new.open(f);
     maybe_new_line();
 
-    machinetalk::Preview *p = output.add_preview();
+    machinetalk::Preview *p = add_preview();
     p->set_type(machinetalk::PV_SOURCE_CONTEXT);
     p->set_stype(machinetalk::ST_NGC_FILE);
     p->set_filename(f);
@@ -218,6 +218,12 @@ public:
  int check_m_codes(block_pointer block);
  int check_other_codes(block_pointer block);
  int close_and_downcase(char *line);
+ int cache_open(const char *filename);
+ void cache_close();
+ int cache_build(const char *path, uint64_t key, const char *text, size_t size);
+ int cache_lex_line(const char *raw, size_t len, block_pointer scratch);
+ void cache_prune(const char *keep);
+ uint64_t cache_settings_key();
  int convert_nurbs(int move, block_pointer block, setup_pointer settings);
  int convert_spline(int move, block_pointer block, setup_pointer settings);
  int comp_get_current(setup_pointer settings, double *x, double *y, double *z);
@@ -495,6 +501,7 @@ public:
                   double *parameters);
  int read_text(const char *command, FILE * inport, char *raw_line,
                      char *line, int *length);
+ int read_cached(block_pointer block, int *hit);
  int read_unary(char *line, int *counter, double *double_ptr,
                       double *parameters);
  int read_u(char *line, int *counter, block_pointer block,
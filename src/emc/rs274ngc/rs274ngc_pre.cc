@@ -154,6 +154,7 @@ Interp::Interp()
 
 Interp::~Interp() {
 
+    cache_close();
     if(log_file) {
         if(log_file != stderr)
             fclose(log_file);
@@ -231,6 +232,7 @@ int Interp::close()
     _setup.file_pointer = NULL;
     _setup.percent_flag = false;
   }
+  cache_close();
   reset();
 
   return INTERP_OK;
@@ -940,6 +942,21 @@ int Interp::init()
           {
               logDebug("SUBROUTINE_PATH not found");
           }
+          // directory for pre-parsed program caches, see interp_cache.cc
+          _setup.program_cache_dir[0] = 0;
+          if (NULL != (inistring = inifile.Find("PROGRAM_CACHE_DIR", "RS274NGC"))) {
+            char expandinistring[LINELEN];
+            if (inifile.TildeExpansion(inistring,expandinistring,sizeof(expandinistring))) {
+                   logDebug("TildeExpansion failed for: %s",inistring);
+            }
+            if (realpath(expandinistring, _setup.program_cache_dir) == NULL) {
+                logDebug("realpath failed to find program_cache_dir:%s:", inistring);
+                _setup.program_cache_dir[0] = 0;
+            }
+            logDebug("_setup.program_cache_dir:%s:", _setup.program_cache_dir);
+          }
+          inifile.Find(&_setup.program_cache_size, "PROGRAM_CACHE_SIZE", "RS274NGC");
+
           // subroutine to execute on aborts - for instance to retract
           // toolchange HAL pins
           if (NULL != (inistring = inifile.Find("ON_ABORT_COMMAND", "RS274NGC"))) {
@@ -1389,7 +1406,7 @@ int Interp::open(const char *filename) //!< string: the name of the input NC-pro
   }
   strcpy(_setup.filename, filename);
   reset();
-  return INTERP_OK;
+  return cache_open(filename);
 }
 
 int Interp::read_inputs(setup_pointer settings)
@@ -1571,6 +1588,16 @@ int Interp::_read(const char *command)  //!< may be NULL or a string to read
       EXECUTING_BLOCK(_setup).offset = ftell(_setup.file_pointer);
   }
 
+  if ((command == NULL) && _setup.program_cache) {
+      int cache_hit;
+
+      CHP(read_cached(&(EXECUTING_BLOCK(_setup)), &cache_hit));
+      if (cache_hit) {
+	  logDebug("%s:[cached]:|%s|", name, _setup.linetext);
+	  return INTERP_OK;
+      }
+  }
+
   read_status =
     read_text(command, _setup.file_pointer, _setup.linetext,
               _setup.blocktext, &_setup.line_length);
@@ -0,0 +1,438 @@
+/********************************************************************
+* Description: timedriver.cc
+*   Estimates the run time of a G code program without a machine.
+*
+*   The program is interpreted with the canonical interface of task
+*   (emccanon.cc, naive cam merging included) and the resulting
+*   commands are handed to the trajectory planner the way task hands
+*   them to motion, see timeintf.cc. The planner is stepped as fast as
+*   it goes instead of once a servo period, so the time it reports is
+*   the one the machine would take at 100% feed override.
+*
+* License: GPL Version 2
+* System: Linux
+*
+* Copyright (c) 2016 All rights reserved.
+*
+********************************************************************/
+
+#include "rs274ngc.hh"
+#include "rs274ngc_interp.hh"
+#include "rs274ngc_return.hh"
+#include "interp_return.hh"
+#include "inifile.hh"
+#include "canon.hh"		// _parameter_file_name, FINISH()
+#include "config.h"		// LINELEN
+#include "emc.hh"
+#include "emc_nml.hh"
+#include "emcglb.h"
+#include "interpl.hh"		// interp_list
+#include "initraj.hh"
+#include "iniaxis.hh"
+#include "initool.hh"
+#include "timeintf.hh"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <getopt.h>
+
+int _task = 0; // control preview behaviour when remapping
+
+static InterpBase *pinterp;
+#define interp (*pinterp)
+
+int emcOperatorError(int id, const char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    fputc('\n', stderr);
+    return 0;
+}
+
+static void report_error(int retval)
+{
+    char buf[LINELEN];
+
+    buf[0] = 0;
+    interp.error_text(retval, buf, sizeof(buf));
+    fprintf(stderr, "rs274time: %s\n", buf);
+    interp.line_text(buf, sizeof(buf));
+    if (buf[0]) {
+	fprintf(stderr, "rs274time: near line %d: %s\n", interp.line(), buf);
+    }
+}
+
+/* issue_command
+
+Returned Value: 0 if the command was handled, -1 on a planner error
+
+Called by: run_interp_list
+
+Does what emcTaskIssueCommand does with a command from the interp list,
+including waiting for the motion queued before it to finish where
+emcTaskCheckPreconditions makes task wait. Commands which change
+neither the motion nor the state read back by the interpreter are
+dropped.
+
+*/
+
+static int issue_command(NMLmsg *cmd)
+{
+    switch (cmd->type) {
+    case EMC_TRAJ_LINEAR_MOVE_TYPE:
+	{
+	    EMC_TRAJ_LINEAR_MOVE *msg = (EMC_TRAJ_LINEAR_MOVE *) cmd;
+	    emcTrajUpdateTag(msg->tag);
+	    return emcTrajLinearMove(msg->end, msg->type, msg->vel,
+				     msg->ini_maxvel, msg->acc,
+				     msg->indexrotary);
+	}
+    case EMC_TRAJ_CIRCULAR_MOVE_TYPE:
+	{
+	    EMC_TRAJ_CIRCULAR_MOVE *msg = (EMC_TRAJ_CIRCULAR_MOVE *) cmd;
+	    emcTrajUpdateTag(msg->tag);
+	    return emcTrajCircularMove(msg->end, msg->center, msg->normal,
+				       msg->turn, msg->type, msg->vel,
+				       msg->ini_maxvel, msg->acc);
+	}
+    case EMC_TRAJ_SPLINE_MOVE_TYPE:
+	{
+	    EMC_TRAJ_SPLINE_MOVE *msg = (EMC_TRAJ_SPLINE_MOVE *) cmd;
+	    emcTrajUpdateTag(msg->tag);
+	    return emcTrajSplineMove(msg->end, msg->ctrl1, msg->ctrl2,
+				     msg->type, msg->vel, msg->ini_maxvel,
+				     msg->acc);
+	}
+    case EMC_TRAJ_SET_VELOCITY_TYPE:
+	{
+	    EMC_TRAJ_SET_VELOCITY *msg = (EMC_TRAJ_SET_VELOCITY *) cmd;
+	    return emcTrajSetVelocity(msg->velocity, msg->ini_maxvel);
+	}
+    case EMC_TRAJ_SET_ACCELERATION_TYPE:
+	return emcTrajSetAcceleration(
+	    ((EMC_TRAJ_SET_ACCELERATION *) cmd)->acceleration);
+    case EMC_TRAJ_SET_TERM_COND_TYPE:
+	{
+	    EMC_TRAJ_SET_TERM_COND *msg = (EMC_TRAJ_SET_TERM_COND *) cmd;
+	    return emcTrajSetTermCond(msg->cond, msg->tolerance);
+	}
+    case EMC_TRAJ_SET_SPINDLESYNC_TYPE:
+	{
+	    EMC_TRAJ_SET_SPINDLESYNC *msg = (EMC_TRAJ_SET_SPINDLESYNC *) cmd;
+	    return emcTrajSetSpindleSync(msg->feed_per_revolution,
+					 msg->velocity_mode);
+	}
+    case EMC_TRAJ_PROBE_TYPE:
+	{
+	    EMC_TRAJ_PROBE *msg = (EMC_TRAJ_PROBE *) cmd;
+	    emcTrajUpdateTag(msg->tag);
+	    return emcTrajProbe(msg->pos, msg->type, msg->vel,
+				msg->ini_maxvel, msg->acc, msg->probe_type);
+	}
+    case EMC_TRAJ_RIGID_TAP_TYPE:
+	{
+	    EMC_TRAJ_RIGID_TAP *msg = (EMC_TRAJ_RIGID_TAP *) cmd;
+	    emcTrajUpdateTag(msg->tag);
+	    return emcTrajRigidTap(msg->pos, msg->vel, msg->ini_maxvel,
+				   msg->acc);
+	}
+    case EMC_TRAJ_DELAY_TYPE:
+	if (0 != timeWaitMotion()) {
+	    return -1;
+	}
+	return timeDelay(((EMC_TRAJ_DELAY *) cmd)->delay);
+    case EMC_SPINDLE_ON_TYPE:
+	{
+	    EMC_SPINDLE_ON *msg = (EMC_SPINDLE_ON *) cmd;
+	    if (0 != timeWaitMotion()) {
+		return -1;
+	    }
+	    return emcSpindleOn(msg->speed, msg->factor, msg->xoffset);
+	}
+    case EMC_SPINDLE_SPEED_TYPE:
+	{
+	    EMC_SPINDLE_SPEED *msg = (EMC_SPINDLE_SPEED *) cmd;
+	    if (0 != timeWaitMotion()) {
+		return -1;
+	    }
+	    return emcSpindleSpeed(msg->speed, msg->factor, msg->xoffset);
+	}
+    case EMC_SPINDLE_OFF_TYPE:
+	if (0 != timeWaitMotion()) {
+	    return -1;
+	}
+	return emcSpindleOff();
+    case EMC_TOOL_PREPARE_TYPE:
+	{
+	    EMC_TOOL_PREPARE *msg = (EMC_TOOL_PREPARE *) cmd;
+	    return emcToolPrepare(msg->pocket, msg->tool);
+	}
+    case EMC_TOOL_LOAD_TYPE:
+	if (0 != timeWaitMotion()) {
+	    return -1;
+	}
+	return emcToolLoad();
+    case EMC_TOOL_UNLOAD_TYPE:
+	if (0 != timeWaitMotion()) {
+	    return -1;
+	}
+	return emcToolUnload();
+    case EMC_TOOL_SET_OFFSET_TYPE:
+	{
+	    EMC_TOOL_SET_OFFSET *msg = (EMC_TOOL_SET_OFFSET *) cmd;
+	    if (0 != timeWaitMotion()) {
+		return -1;
+	    }
+	    return emcToolSetOffset(msg->pocket, msg->toolno, msg->offset,
+				    msg->diameter, msg->frontangle,
+				    msg->backangle, msg->orientation);
+	}
+    case EMC_TOOL_SET_NUMBER_TYPE:
+	return emcToolSetNumber(((EMC_TOOL_SET_NUMBER *) cmd)->tool);
+    case EMC_TASK_PLAN_PAUSE_TYPE:
+    case EMC_TASK_PLAN_OPTIONAL_STOP_TYPE:
+	if (0 != timeWaitMotion()) {
+	    return -1;
+	}
+	return timeProgramPause();
+    case EMC_TRAJ_SET_OFFSET_TYPE:
+    case EMC_TRAJ_SET_G5X_TYPE:
+    case EMC_TRAJ_SET_G92_TYPE:
+    case EMC_TRAJ_SET_ROTATION_TYPE:
+    case EMC_TRAJ_CLEAR_PROBE_TRIPPED_FLAG_TYPE:
+    case EMC_AUX_INPUT_WAIT_TYPE:
+    case EMC_TASK_PLAN_END_TYPE:
+    case EMC_COOLANT_MIST_ON_TYPE:
+    case EMC_COOLANT_MIST_OFF_TYPE:
+    case EMC_COOLANT_FLOOD_ON_TYPE:
+    case EMC_COOLANT_FLOOD_OFF_TYPE:
+	// motion has to be done before these
+	return timeWaitMotion();
+    default:
+	return 0;
+    }
+}
+
+static int run_interp_list()
+{
+    NMLmsg *cmd;
+
+    while (0 != (cmd = interp_list.get())) {
+	emcTrajSetMotionId(interp_list.get_line_number());
+	if (0 != issue_command(cmd)) {
+	    return -1;
+	}
+    }
+    return 0;
+}
+
+/* interpret_file
+
+Returned Value: 0 if the program ran to its end, else -1
+
+Called by: main
+
+Reads and executes the program line by line like the readahead of
+task, running the planner on what each line queued. When the
+interpreter has to see the state of the machine (INTERP_EXECUTE_FINISH)
+all motion is finished first and the interpreter synched before the
+next read, like task does with EMC_TASK_PLAN_SYNCH.
+
+*/
+
+static int interpret_file(const char *filename)
+{
+    int status;
+
+    status = interp.open(filename);
+    if (status != INTERP_OK) {
+	report_error(status);
+	return -1;
+    }
+    for (;;) {
+	status = interp.read();
+	if (status == INTERP_ENDFILE || status == INTERP_EXIT) {
+	    break;
+	}
+	if (status == INTERP_EXECUTE_FINISH) {
+	    if (0 != run_interp_list() || 0 != timeWaitMotion()) {
+		return -1;
+	    }
+	    interp.synch();
+	    continue;
+	}
+	if (status != INTERP_OK) {
+	    report_error(status);
+	    return -1;
+	}
+	status = interp.execute();
+	if (status == INTERP_EXECUTE_FINISH) {
+	    // the block is done, but the interpreter wants to see the
+	    // machine state before reading on (probe, tool change, M66).
+	    // Like task, don't execute the block again: the next read()
+	    // picks up the result after the synch.
+	    if (0 != run_interp_list() || 0 != timeWaitMotion()) {
+		return -1;
+	    }
+	    interp.synch();
+	    continue;
+	}
+	if (status == INTERP_ENDFILE || status == INTERP_EXIT) {
+	    break;
+	}
+	if (status != INTERP_OK) {
+	    report_error(status);
+	    return -1;
+	}
+	if (0 != run_interp_list()) {
+	    return -1;
+	}
+    }
+    FINISH();
+    if (0 != run_interp_list() || 0 != timeWaitMotion()) {
+	return -1;
+    }
+    interp.close();
+    return 0;
+}
+
+static int ini_int(IniFile &inifile, const char *tag, const char *section,
+		   int def)
+{
+    const char *inistring = inifile.Find(tag, section);
+    int value;
+
+    if (inistring && 1 == sscanf(inistring, "%d", &value)) {
+	return value;
+    }
+    return def;
+}
+
+int main(int argc, char **argv)
+{
+    const char *inifile = NULL;
+    const char *tool_file = NULL;
+    const char *lines_file = NULL;
+    const char *inistring;
+    double period = 0.0;
+    double fraction = 0.0;
+    int regions = 10;
+    int random_toolchanger;
+    int status;
+    IniFile ini;
+
+    while (1) {
+	int c = getopt(argc, argv, "i:t:v:c:l:r:f:");
+	if (c == -1) break;
+
+	switch (c) {
+	    case 'i': inifile = optarg; break;
+	    case 't': tool_file = optarg; break;
+	    case 'v': strcpy(_parameter_file_name, optarg); break;
+	    case 'c': period = atof(optarg) * 1e-9; break;
+	    case 'l': lines_file = optarg; break;
+	    case 'r': regions = atoi(optarg); break;
+	    case 'f': fraction = atof(optarg); break;
+	    case '?': default: goto usage;
+	}
+    }
+
+    if (inifile == NULL || argc - optind != 1) {
+usage:
+	fprintf(stderr,
+		"Usage: %s -i inifile [-t tool.tbl] [-v var-file.var] [-c period]\n"
+		"          [-l lines-file] [-r regions] [-f fraction] program.ngc\n"
+		"\n"
+		"    -i: the .ini file of the machine\n"
+		"    -t: the tool table (default: [EMCIO]TOOL_TABLE)\n"
+		"    -v: the .var file (default: [RS274NGC]PARAMETER_FILE)\n"
+		"    -c: the planner period in ns (default: [EMCMOT]SERVO_PERIOD)\n"
+		"    -l: write the time of every line to this file, - for stdout\n"
+		"    -r: number of velocity limited regions to list (default: 10)\n"
+		"    -f: velocity limited means below this fraction of the\n"
+		"        programmed feed (default: 0.95)\n"
+		, argv[0]);
+	exit(1);
+    }
+
+    if (ini.Open(inifile) == false) {
+	fprintf(stderr, "rs274time: can't open %s\n", inifile);
+	exit(1);
+    }
+    if (period <= 0.0) {
+	period = ini_int(ini, "SERVO_PERIOD", "EMCMOT", 1000000) * 1e-9;
+    }
+    // hex, like task reads it
+    if (NULL != (inistring = ini.Find("DEBUG", "EMC")) &&
+	1 != sscanf(inistring, "%i", &emc_debug)) {
+	emc_debug = 0;
+    }
+    random_toolchanger = ini_int(ini, "RANDOM_TOOLCHANGER", "EMCIO", 0);
+    traj_naivecam_arcs = ini_int(ini, "NAIVECAM_ARCS", "TRAJ", 0);
+    if (0 == _parameter_file_name[0] &&
+	NULL != (inistring = ini.Find("PARAMETER_FILE", "RS274NGC"))) {
+	strcpy(_parameter_file_name, inistring);
+    }
+    if (NULL != (inistring = ini.Find("RS274NGC_STARTUP_CODE", "EMC")) ||
+	NULL != (inistring = ini.Find("RS274NGC_STARTUP_CODE", "RS274NGC"))) {
+	strcpy(rs274ngc_startup_code, inistring);
+    }
+    ini.Close();
+
+    strcpy(emc_inifile, inifile);
+    if (0 != timeIntfInit(period) || 0 != iniTraj(inifile)) {
+	exit(1);
+    }
+    for (int axis = 0; axis < emcStatus->motion.traj.axes; axis++) {
+	if (0 != iniAxis(axis, inifile)) {
+	    exit(1);
+	}
+    }
+    iniTool(inifile);
+    if (tool_file == NULL) {
+	tool_file = tool_table_file;
+    }
+    if (0 != timeToolInit(tool_file, random_toolchanger)) {
+	fprintf(stderr, "rs274time: can't read the tool table %s\n",
+		tool_file);
+	exit(1);
+    }
+    if (fraction > 0.0) {
+	timeSetLimitFraction(fraction);
+    }
+
+    setenv("INI_FILE_NAME", inifile, 1);
+    pinterp = new Interp;
+    interp.ini_load(inifile);
+    status = interp.init();
+    if (status == INTERP_OK && rs274ngc_startup_code[0]) {
+	status = interp.execute(rs274ngc_startup_code);
+	while (status == INTERP_EXECUTE_FINISH) {
+	    status = interp.execute(0);
+	}
+    }
+    if (status > INTERP_MIN_ERROR) {
+	report_error(status);
+	exit(1);
+    }
+    run_interp_list();
+
+    status = interpret_file(argv[optind]);
+    timeReport(stdout, regions);
+    if (lines_file) {
+	FILE *out = strcmp(lines_file, "-") ? fopen(lines_file, "w") : stdout;
+	if (out == NULL || 0 != timeWriteLines(out)) {
+	    fprintf(stderr, "rs274time: can't write %s\n", lines_file);
+	    exit(1);
+	}
+	if (out != stdout) {
+	    fclose(out);
+	}
+    }
+    // no interp.exit(), which would write the parameter file back
+    return status == 0 ? 0 : 1;
+}
@@ -0,0 +1,997 @@
+/********************************************************************
+* Description: timeintf.cc
+*   Motion interface functions for rs274time.
+*
+*   Where taskintf.cc hands moves to the motion controller, these
+*   queue them on a trajectory planner living in this process and step
+*   it cycle by cycle, so a program is timed by the same planner that
+*   runs it on the machine, only without waiting for the servo thread.
+*   The spindle is simulated as always at speed, tool changes and
+*   program pauses take no time. There are no kinematics here, so the
+*   joint position and velocity limits of the machine are not applied:
+*   the estimate only knows the axis limits from the ini file.
+*
+* License: GPL Version 2
+* System: Linux
+*
+* Copyright (c) 2016 All rights reserved.
+*
+********************************************************************/
+
+#include "rtapi_math.h"
+#include <string.h>
+#include <stdlib.h>
+#include <vector>
+#include <algorithm>
+
+#include "emc.hh"
+#include "emc_nml.hh"
+#include "emcglb.h"
+#include "inihal.hh"
+#include "motion.h"		// FS_ENABLED etc.
+#include "emcmotcfg.h"		// DEFAULT_TC_QUEUE_SIZE
+#include "tool_parse.h"
+#include "tp.h"
+#include "tp_private.h"
+#include "tp_shared.h"
+#include "timeintf.hh"
+
+value_inihal_data old_inihal_data;
+
+// moves handed to tpAddSegments() at once. Each may bring a blend arc
+// along, so twice this has to fit into the TC_QUEUE_MARGIN which is
+// left when tcqFull() says so.
+#define TIME_BATCH 8
+
+// planner waiting this long with motion queued is taken as a hang
+#define TIME_STALL_SECS 60.0
+
+static vtp_t vtp;
+static TP_STRUCT tp;
+static TC_STRUCT tcSpace[DEFAULT_TC_QUEUE_SIZE + 10];
+static tp_shared_t tps;
+
+// the motion controller state the planner reads and writes, see
+// init_shared() in motion.c for where these live there
+static struct {
+    hal_s32_t num_dio;
+    hal_s32_t num_aio;
+    hal_s32_t arcBlendGapCycles;
+    hal_s32_t arcBlendOptDepth;
+    hal_bit_t arcBlendEnable;
+    hal_bit_t arcBlendFallbackEnable;
+    hal_float_t arcBlendRampFreq;
+    hal_float_t arcBlendTangentKinkRatio;
+    hal_float_t maxFeedScale;
+    hal_float_t net_feed_scale;
+    hal_float_t acc_limit[3];
+    hal_float_t jerk_limit[9];
+    hal_float_t vel_limit[3];
+    hal_bit_t stepping;
+    hal_u32_t enables_new;
+    hal_u32_t enables_queued;
+    hal_u32_t tcqlen;
+    hal_s32_t spindle_direction;
+    hal_float_t spindleRevs;
+    hal_float_t spindleSpeedIn;
+    hal_float_t spindle_speed;
+    hal_bit_t spindle_index_enable;
+    hal_bit_t spindle_is_atspeed;
+    hal_bit_t spindleSync;
+    hal_float_t current_vel;
+    hal_float_t requested_vel;
+    hal_float_t distance_to_go;
+    EmcPose dtg;
+} mot;
+
+static long cyclePeriod;		// nsec
+static double cycleTime;		// sec
+static double maxAcceleration = 1e99;
+static int random_toolchanger = 0;
+static double limitFraction = 0.95;
+
+// constant surface speed, as in control.c
+static double css_factor;
+static double css_xoffset;
+
+static int motionId = 0;
+static struct state_tag_t motionTag;
+static tp_segment_t batch[TIME_BATCH];
+static int batchLen = 0;
+
+// what the planner did while executing a line
+struct line_time {
+    double time;		// seconds
+    double limited;		// of these, seconds below the programmed feed
+    double length;		// path traveled
+    double programmed;		// path the programmed feed would have gone
+};
+
+static std::vector<line_time> lines;
+static int lastLine = 0;
+static double totalTime = 0.0;
+static double dwellTime = 0.0;
+static long long cycles = 0;
+static int toolChanges = 0;
+static int pauses = 0;
+static int probes = 0;
+
+static void timeDioWrite(unsigned int index, hal_bit_t value)
+{
+}
+
+static void timeAioWrite(unsigned int index, hal_float_t value)
+{
+}
+
+static void timeSetRotaryUnlock(int axis, hal_bit_t unlock)
+{
+}
+
+// the locking indexer unlocks at once
+static hal_bit_t timeGetRotaryIsUnlocked(int axis)
+{
+    return 1;
+}
+
+static line_time *lineTime(int line)
+{
+    if (line < 0) {
+	line = 0;
+    }
+    if (line >= (int) lines.size()) {
+	line_time zero = { 0.0, 0.0, 0.0, 0.0 };
+	lines.resize(std::max(line + 1, 2 * (int) lines.size()), zero);
+    }
+    if (line > lastLine) {
+	lastLine = line;
+    }
+    return &lines[line];
+}
+
+// the spindle follows its commanded speed at once, see control.c
+static void spindleCycle()
+{
+    double speed = mot.spindle_speed;
+
+    if (css_factor != 0.0) {
+	double denom = rtapi_fabs(css_xoffset - tp.currentPos.tran.x);
+	double maxspeed = rtapi_fabs(mot.spindle_speed);
+	if (denom > 0.0) {
+	    speed = css_factor / denom;
+	} else {
+	    speed = maxspeed;
+	}
+	if (speed > maxspeed) {
+	    speed = maxspeed;
+	}
+	if (mot.spindle_speed < 0.0) {
+	    speed = -speed;
+	}
+    }
+    mot.spindleSpeedIn = speed / 60.0;
+    mot.spindleRevs += mot.spindleSpeedIn * cycleTime;
+    if (mot.spindle_index_enable) {
+	// the index comes right away
+	mot.spindle_index_enable = 0;
+	mot.spindleRevs = 0.0;
+    }
+}
+
+// one servo cycle: 1 if it took time, 0 if there was nothing to do
+static int runCycle(int *waiting)
+{
+    int res;
+
+    spindleCycle();
+    res = vtp.tpRunCycle(&tp, cyclePeriod);
+    if (res == TP_ERR_WAITING && vtp.tpIsDone(&tp)) {
+	return 0;
+    }
+    *waiting = (res == TP_ERR_WAITING) ? *waiting + 1 : 0;
+
+    line_time *lt = lineTime(vtp.tpGetExecId(&tp));
+    double vel = mot.current_vel;
+    double req = mot.requested_vel;
+    lt->time += cycleTime;
+    lt->length += vel * cycleTime;
+    lt->programmed += req * cycleTime;
+    if (vel < limitFraction * req) {
+	lt->limited += cycleTime;
+    }
+    totalTime += cycleTime;
+    cycles++;
+    return 1;
+}
+
+static int runUntilRoom()
+{
+    int waiting = 0;
+
+    while (vtp.tcqFull(&tp.queue)) {
+	runCycle(&waiting);
+	if (waiting * cycleTime > TIME_STALL_SECS) {
+	    fprintf(stderr, "rs274time: planner stalled at line %d\n",
+		    vtp.tpGetExecId(&tp));
+	    return -1;
+	}
+    }
+    return 0;
+}
+
+static int flushBatch()
+{
+    int added = 0;
+    int res;
+
+    if (batchLen == 0) {
+	return 0;
+    }
+    if (0 != runUntilRoom()) {
+	return -1;
+    }
+    res = vtp.tpAddSegments(&tp, batch, batchLen, &added);
+    batchLen = 0;
+    if (res != TP_ERR_OK) {
+	fprintf(stderr, "rs274time: can't add move at line %d, error code %d\n",
+		batch[added].id, res);
+	return -1;
+    }
+    return 0;
+}
+
+static tp_segment_t *newSegment(tc_motion_type_t type, EmcPose end,
+				 int canon_motion_type, double vel,
+				 double ini_maxvel, double acc)
+{
+    tp_segment_t *seg = &batch[batchLen++];
+
+    memset(seg, 0, sizeof(*seg));
+    seg->type = type;
+    seg->id = motionId;
+    seg->end = end;
+    seg->canon_motion_type = canon_motion_type;
+    seg->vel = vel;
+    seg->ini_maxvel = ini_maxvel;
+    seg->acc = acc;
+    seg->enables = mot.enables_new;
+    seg->tag = motionTag;
+    return seg;
+}
+
+int timeIntfInit(double secs)
+{
+    vtp.tpCreate = tpCreate;
+    vtp.tpClear = tpClear;
+    vtp.tpInit = tpInit;
+    vtp.tpClearDIOs = tpClearDIOs;
+    vtp.tpSetCycleTime = tpSetCycleTime;
+    vtp.tpSetVmax = tpSetVmax;
+    vtp.tpSetVlimit = tpSetVlimit;
+    vtp.tpSetAmax = tpSetAmax;
+    vtp.tpSetId = tpSetId;
+    vtp.tpGetExecId = tpGetExecId;
+    vtp.tpGetExecTag = tpGetExecTag;
+    vtp.tpSetTermCond = tpSetTermCond;
+    vtp.tpSetPos = tpSetPos;
+    vtp.tpAddCurrentPos = tpAddCurrentPos;
+    vtp.tpSetCurrentPos = tpSetCurrentPos;
+    vtp.tpAddRigidTap = tpAddRigidTap;
+    vtp.tpAddLine = tpAddLine;
+    vtp.tpAddCircle = tpAddCircle;
+    vtp.tpAddSpline = tpAddSpline;
+    vtp.tpAddSegments = tpAddSegments;
+    vtp.tpRunCycle = tpRunCycle;
+    vtp.tpPause = tpPause;
+    vtp.tpResume = tpResume;
+    vtp.tpAbort = tpAbort;
+    vtp.tpGetPos = tpGetPos;
+    vtp.tpIsDone = tpIsDone;
+    vtp.tpQueueDepth = tpQueueDepth;
+    vtp.tpActiveDepth = tpActiveDepth;
+    vtp.tpGetMotionType = tpGetMotionType;
+    vtp.tpSetSpindleSync = tpSetSpindleSync;
+    vtp.tpToggleDIOs = tpToggleDIOs;
+    vtp.tpSetAout = tpSetAout;
+    vtp.tpSetDout = tpSetDout;
+    vtp.tpIsPaused = tpIsPaused;
+    vtp.tpSnapshot = tpSnapshot;
+    vtp.tcqFull = tcqFull;
+
+    tps.num_dio = &mot.num_dio;
+    tps.num_aio = &mot.num_aio;
+    tps.arcBlendGapCycles = &mot.arcBlendGapCycles;
+    tps.arcBlendOptDepth = &mot.arcBlendOptDepth;
+    tps.arcBlendEnable = &mot.arcBlendEnable;
+    tps.arcBlendRampFreq = &mot.arcBlendRampFreq;
+    tps.arcBlendTangentKinkRatio = &mot.arcBlendTangentKinkRatio;
+    tps.arcBlendFallbackEnable = &mot.arcBlendFallbackEnable;
+    tps.maxFeedScale = &mot.maxFeedScale;
+    tps.net_feed_scale = &mot.net_feed_scale;
+    tps.spindle_direction = &mot.spindle_direction;
+    tps.spindle_speed = &mot.spindle_speed;
+    tps.spindleRevs = &mot.spindleRevs;
+    tps.spindleSpeedIn = &mot.spindleSpeedIn;
+    tps.spindle_index_enable = &mot.spindle_index_enable;
+    tps.spindle_is_atspeed = &mot.spindle_is_atspeed;
+    tps.spindleSync = &mot.spindleSync;
+    tps.current_vel = &mot.current_vel;
+    tps.requested_vel = &mot.requested_vel;
+    tps.distance_to_go = &mot.distance_to_go;
+    tps.enables_new = &mot.enables_new;
+    tps.enables_queued = &mot.enables_queued;
+    tps.tcqlen = &mot.tcqlen;
+    tps.dtg[0] = &mot.dtg.tran.x;
+    tps.dtg[1] = &mot.dtg.tran.y;
+    tps.dtg[2] = &mot.dtg.tran.z;
+    tps.dtg[3] = &mot.dtg.a;
+    tps.dtg[4] = &mot.dtg.b;
+    tps.dtg[5] = &mot.dtg.c;
+    tps.dtg[6] = &mot.dtg.u;
+    tps.dtg[7] = &mot.dtg.v;
+    tps.dtg[8] = &mot.dtg.w;
+    for (int i = 0; i < 3; i++) {
+	tps.acc_limit[i] = &mot.acc_limit[i];
+	tps.vel_limit[i] = &mot.vel_limit[i];
+    }
+    for (int i = 0; i < 9; i++) {
+	tps.jerk_limit[i] = &mot.jerk_limit[i];
+    }
+    tps.stepping = &mot.stepping;
+    tps.dioWrite = timeDioWrite;
+    tps.aioWrite = timeAioWrite;
+    tps.SetRotaryUnlock = timeSetRotaryUnlock;
+    tps.GetRotaryIsUnlocked = timeGetRotaryIsUnlocked;
+    // no kinematics module: tp.c skips the joint space check of a
+    // segment, so joint limits don't slow anything down here
+    tps.GetJointLimits = NULL;
+    tps.KinsInverseBatch = NULL;
+
+    // defaults as set up by motion.c, changed by iniTraj() later
+    mot.arcBlendEnable = 1;
+    mot.arcBlendFallbackEnable = 0;
+    mot.arcBlendOptDepth = 50;
+    mot.arcBlendGapCycles = 4;
+    mot.arcBlendRampFreq = 100.0;
+    mot.arcBlendTangentKinkRatio = 0.1;
+    mot.maxFeedScale = 1.0;
+    mot.net_feed_scale = 1.0;
+    mot.enables_new = SS_ENABLED | FS_ENABLED | FH_ENABLED;
+    mot.spindle_is_atspeed = 1;
+    for (int i = 0; i < 3; i++) {
+	mot.vel_limit[i] = 1.0;
+	mot.acc_limit[i] = 1.0;
+    }
+
+    if (-1 == vtp.tpCreate(&tp, DEFAULT_TC_QUEUE_SIZE, tcSpace, &tps)) {
+	fprintf(stderr, "rs274time: failed to create the trajectory planner\n");
+	return -1;
+    }
+    return emcTrajSetCycleTime(secs);
+}
+
+int timeToolInit(const char *filename, int random)
+{
+    random_toolchanger = random;
+    emcStatus->io.tool.pocketPrepped = -1;
+    return loadToolTable(filename, emcStatus->io.tool.toolTable, 0, 0,
+			 random_toolchanger);
+}
+
+void timeSetLimitFraction(double fraction)
+{
+    limitFraction = fraction;
+}
+
+int timeWaitMotion()
+{
+    int waiting = 0;
+
+    if (0 != flushBatch()) {
+	return -1;
+    }
+    while (!vtp.tpIsDone(&tp)) {
+	runCycle(&waiting);
+	if (waiting * cycleTime > TIME_STALL_SECS) {
+	    fprintf(stderr, "rs274time: planner stalled at line %d\n",
+		    vtp.tpGetExecId(&tp));
+	    return -1;
+	}
+    }
+    vtp.tpGetPos(&tp, &emcStatus->motion.traj.position);
+    emcStatus->motion.traj.queue = 0;
+    return 0;
+}
+
+int timeDelay(double secs)
+{
+    if (secs > 0.0) {
+	lineTime(motionId)->time += secs;
+	totalTime += secs;
+	dwellTime += secs;
+    }
+    return 0;
+}
+
+int timeProgramPause()
+{
+    pauses++;
+    return 0;
+}
+
+// AXIS functions, joints 0..2 are X, Y and Z for the planner as in
+// motion.c
+
+int emcAxisSetAxis(int axis, unsigned char axisType)
+{
+    return 0;
+}
+
+int emcAxisSetUnits(int axis, double units)
+{
+    return 0;
+}
+
+int emcAxisSetBacklash(int axis, double backlash)
+{
+    return 0;
+}
+
+int emcAxisSetMinPositionLimit(int axis, double limit)
+{
+    return 0;
+}
+
+int emcAxisSetMaxPositionLimit(int axis, double limit)
+{
+    return 0;
+}
+
+int emcAxisSetFerror(int axis, double ferror)
+{
+    return 0;
+}
+
+int emcAxisSetMinFerror(int axis, double ferror)
+{
+    return 0;
+}
+
+// the program starts out from the home position
+int emcAxisSetHomingParams(int axis, double home, double offset, double home_final_vel,
+			   double search_vel, double latch_vel,
+			   int use_index, int ignore_limits,
+			   int is_shared, int home_sequence, int volatile_home,
+			   int locking_indexer)
+{
+    EmcPose pos;
+
+    if (axis < 0 || axis >= EMCMOT_MAX_JOINTS) {
+	return -1;
+    }
+    vtp.tpGetPos(&tp, &pos);
+    switch (axis) {
+    case 0: pos.tran.x = home; break;
+    case 1: pos.tran.y = home; break;
+    case 2: pos.tran.z = home; break;
+    case 3: pos.a = home; break;
+    case 4: pos.b = home; break;
+    case 5: pos.c = home; break;
+    case 6: pos.u = home; break;
+    case 7: pos.v = home; break;
+    case 8: pos.w = home; break;
+    }
+    vtp.tpSetPos(&tp, &pos);
+    emcStatus->motion.traj.position = pos;
+    return 0;
+}
+
+int emcAxisSetMaxVelocity(int axis, double vel)
+{
+    if (axis < 0 || axis >= EMC_AXIS_MAX) {
+	return -1;
+    }
+    if (vel < 0.0) {
+	vel = 0.0;
+    }
+    axis_max_velocity[axis] = vel;
+    if (axis < 3) {
+	mot.vel_limit[axis] = vel;
+    }
+    return 0;
+}
+
+int emcAxisSetMaxAcceleration(int axis, double acc)
+{
+    if (axis < 0 || axis >= EMC_AXIS_MAX) {
+	return -1;
+    }
+    if (acc < 0.0) {
+	acc = 0.0;
+    }
+    axis_max_acceleration[axis] = acc;
+    if (axis < 3) {
+	mot.acc_limit[axis] = acc;
+    }
+    return 0;
+}
+
+int emcAxisSetMaxJerk(int axis, double jerk)
+{
+    if (axis < 0 || axis >= EMC_AXIS_MAX) {
+	return -1;
+    }
+    if (jerk < 0.0) {
+	jerk = 0.0;
+    }
+    if (axis < 9) {
+	mot.jerk_limit[axis] = jerk;
+    }
+    return 0;
+}
+
+int emcAxisActivate(int axis)
+{
+    return 0;
+}
+
+int emcAxisLoadComp(int axis, const char *file, int type)
+{
+    return 0;
+}
+
+// TRAJ functions
+
+int emcTrajUpdateTag(StateTag const &tag)
+{
+    motionTag = tag.get_state_tag();
+    return 0;
+}
+
+int emcTrajSetAxes(int axes, int axismask)
+{
+    if (axes == 0) {
+	for (axes = EMCMOT_MAX_JOINTS; axes > 0; axes--) {
+	    if (axismask & (1 << (axes - 1))) {
+		break;
+	    }
+	}
+    }
+    if (axes <= 0 || axes > EMCMOT_MAX_JOINTS || axismask >= (1 << axes)) {
+	fprintf(stderr, "rs274time: bad axes=%d axismask=%x\n", axes, axismask);
+	return -1;
+    }
+    emcStatus->motion.traj.axes = axes;
+    emcStatus->motion.traj.axis_mask = axismask;
+    return 0;
+}
+
+int emcTrajSetUnits(double linearUnits, double angularUnits)
+{
+    if (linearUnits <= 0.0 || angularUnits <= 0.0) {
+	return -1;
+    }
+    emcStatus->motion.traj.linearUnits = linearUnits;
+    emcStatus->motion.traj.angularUnits = angularUnits;
+    return 0;
+}
+
+double emcTrajGetLinearUnits()
+{
+    return emcStatus->motion.traj.linearUnits;
+}
+
+double emcTrajGetAngularUnits()
+{
+    return emcStatus->motion.traj.angularUnits;
+}
+
+int emcTrajSetCycleTime(double secs)
+{
+    if (secs <= 0.0) {
+	return -1;
+    }
+    cycleTime = secs;
+    cyclePeriod = (long) (secs * 1e9 + 0.5);
+    emcStatus->motion.traj.cycleTime = secs;
+    return vtp.tpSetCycleTime(&tp, secs);
+}
+
+int emcTrajSetVelocity(double vel, double ini_maxvel)
+{
+    if (vel < 0.0) {
+	vel = 0.0;
+    } else if (vel > traj_max_velocity) {
+	vel = traj_max_velocity;
+    }
+    if (ini_maxvel < 0.0) {
+	ini_maxvel = 0.0;
+    } else if (ini_maxvel > traj_max_velocity) {
+	ini_maxvel = traj_max_velocity;
+    }
+    if (0 != flushBatch()) {
+	return -1;
+    }
+    return vtp.tpSetVmax(&tp, vel, ini_maxvel);
+}
+
+int emcTrajSetAcceleration(double acc)
+{
+    if (acc < 0.0) {
+	acc = 0.0;
+    } else if (acc > maxAcceleration) {
+	acc = maxAcceleration;
+    }
+    if (0 != flushBatch()) {
+	return -1;
+    }
+    return vtp.tpSetAmax(&tp, acc);
+}
+
+int emcTrajSetMaxVelocity(double vel)
+{
+    if (vel < 0.0) {
+	vel = 0.0;
+    }
+    traj_max_velocity = vel;
+    emcStatus->motion.traj.maxVelocity = vel;
+    return vtp.tpSetVlimit(&tp, vel);
+}
+
+int emcTrajSetMaxAcceleration(double acc)
+{
+    if (acc < 0.0) {
+	acc = 0.0;
+    }
+    maxAcceleration = acc;
+    emcStatus->motion.traj.maxAcceleration = acc;
+    return 0;
+}
+
+int emcTrajSetHome(EmcPose home)
+{
+    return 0;
+}
+
+int emcSetupArcBlends(int arcBlendEnable,
+		      int arcBlendFallbackEnable,
+		      int arcBlendOptDepth,
+		      int arcBlendGapCycles,
+		      double arcBlendRampFreq,
+		      double arcBlendTangentKinkRatio)
+{
+    mot.arcBlendEnable = arcBlendEnable;
+    mot.arcBlendFallbackEnable = arcBlendFallbackEnable;
+    mot.arcBlendOptDepth = arcBlendOptDepth;
+    mot.arcBlendGapCycles = arcBlendGapCycles;
+    mot.arcBlendRampFreq = arcBlendRampFreq;
+    mot.arcBlendTangentKinkRatio = arcBlendTangentKinkRatio;
+    return 0;
+}
+
+int emcSetMaxFeedOverride(double maxFeedScale)
+{
+    mot.maxFeedScale = maxFeedScale;
+    return 0;
+}
+
+int emcTrajSetMotionId(int id)
+{
+    motionId = id;
+    return 0;
+}
+
+int emcTrajSetTermCond(int cond, double tolerance)
+{
+    if (0 != flushBatch()) {
+	return -1;
+    }
+    return vtp.tpSetTermCond(&tp, cond, tolerance);
+}
+
+int emcTrajSetSpindleSync(double fpr, bool wait_for_index)
+{
+    if (0 != flushBatch()) {
+	return -1;
+    }
+    return vtp.tpSetSpindleSync(&tp, fpr, wait_for_index);
+}
+
+int emcTrajLinearMove(EmcPose end, int type, double vel, double ini_maxvel,
+		      double acc, int indexrotary)
+{
+    tp_segment_t *seg = newSegment(TC_LINEAR, end, type, vel, ini_maxvel, acc);
+
+    seg->indexrotary = indexrotary;
+    if (batchLen == TIME_BATCH) {
+	return flushBatch();
+    }
+    return 0;
+}
+
+int emcTrajCircularMove(EmcPose end, PM_CARTESIAN center, PM_CARTESIAN normal,
+			int turn, int type, double vel, double ini_maxvel,
+			double acc)
+{
+    tp_segment_t *seg = newSegment(TC_CIRCULAR, end, type, vel, ini_maxvel, acc);
+
+    seg->center.x = center.x;
+    seg->center.y = center.y;
+    seg->center.z = center.z;
+    seg->normal.x = normal.x;
+    seg->normal.y = normal.y;
+    seg->normal.z = normal.z;
+    seg->turn = turn;
+    if (batchLen == TIME_BATCH) {
+	return flushBatch();
+    }
+    return 0;
+}
+
+int emcTrajSplineMove(EmcPose end, PM_CARTESIAN ctrl1, PM_CARTESIAN ctrl2,
+		      int type, double vel, double ini_maxvel, double acc)
+{
+    tp_segment_t *seg = newSegment(TC_SPLINE, end, type, vel, ini_maxvel, acc);
+
+    seg->ctrl1.x = ctrl1.x;
+    seg->ctrl1.y = ctrl1.y;
+    seg->ctrl1.z = ctrl1.z;
+    seg->ctrl2.x = ctrl2.x;
+    seg->ctrl2.y = ctrl2.y;
+    seg->ctrl2.z = ctrl2.z;
+    if (batchLen == TIME_BATCH) {
+	return flushBatch();
+    }
+    return 0;
+}
+
+// the probe never trips, so this is the longest the probe move can take
+int emcTrajProbe(EmcPose pos, int type, double vel, double ini_maxvel,
+		 double acc, unsigned char probe_type)
+{
+    probes++;
+    if (0 != timeWaitMotion()) {
+	return -1;
+    }
+    newSegment(TC_LINEAR, pos, type, vel, ini_maxvel, acc);
+    if (0 != timeWaitMotion()) {
+	return -1;
+    }
+    emcStatus->motion.traj.probedPosition = emcStatus->motion.traj.position;
+    return 0;
+}
+
+int emcTrajRigidTap(EmcPose pos, double vel, double ini_maxvel, double acc)
+{
+    EmcPose end;
+
+    if (0 != timeWaitMotion()) {
+	return -1;
+    }
+    vtp.tpGetPos(&tp, &end);
+    end.tran = pos.tran;
+    vtp.tpSetId(&tp, motionId);
+    if (0 != vtp.tpAddRigidTap(&tp, end, vel, ini_maxvel, acc,
+			       mot.enables_new, motionTag)) {
+	fprintf(stderr, "rs274time: can't add rigid tap at line %d\n",
+		motionId);
+	return -1;
+    }
+    return timeWaitMotion();
+}
+
+// SPINDLE functions
+
+int emcSpindleOn(double speed, double factor, double xoffset)
+{
+    mot.spindle_speed = speed;
+    mot.spindle_direction = (speed > 0.0) ? 1 : ((speed < 0.0) ? -1 : 0);
+    css_factor = factor;
+    css_xoffset = xoffset;
+    return 0;
+}
+
+int emcSpindleSpeed(double speed, double factor, double xoffset)
+{
+    if (mot.spindle_speed == 0.0) {
+	return 0;
+    }
+    return emcSpindleOn(speed, factor, xoffset);
+}
+
+int emcSpindleOff()
+{
+    return emcSpindleOn(0.0, 0.0, 0.0);
+}
+
+// TOOL functions, like iocontrol with the tool changer done at once
+
+int emcToolPrepare(int pocket, int tool)
+{
+    if (random_toolchanger && pocket == 0) {
+	return 0;
+    }
+    emcStatus->io.tool.pocketPrepped = pocket;
+    return 0;
+}
+
+int emcToolLoad()
+{
+    EMC_TOOL_STAT *tool = &emcStatus->io.tool;
+    int pocket = tool->pocketPrepped;
+
+    if (pocket < 0 || (random_toolchanger && pocket == 0)) {
+	return 0;
+    }
+    if (!random_toolchanger && pocket > 0 &&
+	tool->toolInSpindle == tool->toolTable[pocket].toolno) {
+	return 0;
+    }
+    toolChanges++;
+    if (random_toolchanger) {
+	CANON_TOOL_TABLE temp = tool->toolTable[0];
+	tool->toolTable[0] = tool->toolTable[pocket];
+	tool->toolTable[pocket] = temp;
+	tool->toolInSpindle = tool->toolTable[0].toolno;
+    } else if (pocket == 0) {
+	tool->toolInSpindle = 0;
+	tool->toolTable[0].toolno = -1;
+	ZERO_EMC_POSE(tool->toolTable[0].offset);
+	tool->toolTable[0].diameter = 0.0;
+	tool->toolTable[0].frontangle = 0.0;
+	tool->toolTable[0].backangle = 0.0;
+	tool->toolTable[0].orientation = 0;
+    } else {
+	tool->toolInSpindle = tool->toolTable[pocket].toolno;
+	tool->toolTable[0] = tool->toolTable[pocket];
+    }
+    tool->pocketPrepped = -1;
+    return 0;
+}
+
+int emcToolUnload()
+{
+    emcStatus->io.tool.toolInSpindle = 0;
+    return 0;
+}
+
+// G10 L1 and friends, the tool table file is left alone
+int emcToolSetOffset(int pocket, int toolno, EmcPose offset, double diameter,
+		     double frontangle, double backangle, int orientation)
+{
+    EMC_TOOL_STAT *tool = &emcStatus->io.tool;
+
+    if (pocket < 0 || pocket >= CANON_POCKETS_MAX) {
+	return -1;
+    }
+    tool->toolTable[pocket].toolno = toolno;
+    tool->toolTable[pocket].offset = offset;
+    tool->toolTable[pocket].diameter = diameter;
+    tool->toolTable[pocket].frontangle = frontangle;
+    tool->toolTable[pocket].backangle = backangle;
+    tool->toolTable[pocket].orientation = orientation;
+    if (tool->toolInSpindle == toolno) {
+	tool->toolTable[0] = tool->toolTable[pocket];
+    }
+    return 0;
+}
+
+int emcToolSetNumber(int number)
+{
+    EMC_TOOL_STAT *tool = &emcStatus->io.tool;
+
+    tool->toolInSpindle = number;
+    if (!random_toolchanger) {
+	for (int i = 1; i < CANON_POCKETS_MAX; i++) {
+	    if (tool->toolTable[i].toolno == number) {
+		tool->toolTable[0] = tool->toolTable[i];
+		break;
+	    }
+	}
+    }
+    return 0;
+}
+
+// REPORT
+
+static void printTime(FILE *out, double secs)
+{
+    long s = (long) (secs + 0.5);
+
+    fprintf(out, "%ld:%02ld:%02ld", s / 3600, (s / 60) % 60, s % 60);
+}
+
+// a run of lines which spent most of their time below the programmed feed
+struct limited_region {
+    int first;
+    int last;
+    line_time sum;
+};
+
+static bool moreLimited(limited_region const &a, limited_region const &b)
+{
+    return a.sum.limited > b.sum.limited;
+}
+
+void timeReport(FILE *out, int regions)
+{
+    std::vector<limited_region> found;
+    double limited = 0.0;
+    int timed = 0;
+    bool open = false;
+
+    for (int line = 0; line <= lastLine && line < (int) lines.size(); line++) {
+	line_time const &lt = lines[line];
+	// lines which took no time don't end a region
+	if (lt.time <= 0.0) {
+	    continue;
+	}
+	timed++;
+	limited += lt.limited;
+	if (lt.limited < 0.5 * lt.time) {
+	    open = false;
+	    continue;
+	}
+	if (!open) {
+	    limited_region r = { line, line, lt };
+	    found.push_back(r);
+	    open = true;
+	} else {
+	    limited_region &r = found.back();
+	    r.last = line;
+	    r.sum.time += lt.time;
+	    r.sum.limited += lt.limited;
+	    r.sum.length += lt.length;
+	    r.sum.programmed += lt.programmed;
+	}
+    }
+
+    fprintf(out, "cycle time ");
+    printTime(out, totalTime);
+    fprintf(out, " (%.3f s), %lld cycles of %.3f ms\n",
+	    totalTime, cycles, cycleTime * 1000.0);
+    fprintf(out, "%d lines took time, %.3f s in dwells\n", timed, dwellTime);
+    fprintf(out, "velocity limited %.3f s (%.1f%%) below %.0f%% of the "
+	    "programmed feed\n", limited,
+	    totalTime > 0.0 ? 100.0 * limited / totalTime : 0.0,
+	    100.0 * limitFraction);
+    if (toolChanges || pauses || probes) {
+	fprintf(out, "not timed: %d tool changes, %d program pauses, "
+		"%d probes timed as never tripping\n",
+		toolChanges, pauses, probes);
+    }
+    if (regions <= 0 || found.empty()) {
+	return;
+    }
+
+    std::sort(found.begin(), found.end(), moreLimited);
+    if ((int) found.size() > regions) {
+	found.resize(regions);
+    }
+    fprintf(out, "\nslowest velocity limited regions:\n");
+    fprintf(out, "%17s %10s %10s %12s %12s\n", "lines", "time", "limited",
+	    "mean vel", "programmed");
+    for (size_t i = 0; i < found.size(); i++) {
+	limited_region const &r = found[i];
+	char range[32];
+	snprintf(range, sizeof(range), "%d-%d", r.first, r.last);
+	fprintf(out, "%17s %10.3f %10.3f %12.3f %12.3f\n", range,
+		r.sum.time, r.sum.limited,
+		60.0 * r.sum.length / r.sum.time,
+		60.0 * r.sum.programmed / r.sum.time);
+    }
+    fprintf(out, "(times in s, velocities in machine units per minute)\n");
+}
+
+int timeWriteLines(FILE *out)
+{
+    for (int line = 0; line <= lastLine && line < (int) lines.size(); line++) {
+	line_time const &lt = lines[line];
+	if (lt.time <= 0.0) {
+	    continue;
+	}
+	fprintf(out, "%d %.6f %.6f %.6f\n", line, lt.time, lt.limited,
+		lt.length);
+    }
+    return ferror(out) ? -1 : 0;
+}
@@ -0,0 +1,46 @@
+/********************************************************************
+* Description: timeintf.hh
+*   Declarations for the rs274time stand-in of the motion interface,
+*   see timeintf.cc. The emcTraj/emcAxis/emcSpindle/emcTool functions
+*   it implements are declared in emc.hh.
+*
+* License: GPL Version 2
+* System: Linux
+*
+* Copyright (c) 2016 All rights reserved.
+*
+********************************************************************/
+#ifndef TIMEINTF_HH
+#define TIMEINTF_HH
+
+#include <stdio.h>
+
+// create the trajectory planner, before iniTraj() and iniAxis() set it up
+extern int timeIntfInit(double cycleTime);
+
+// load the tool table into emcStatus->io.tool
+extern int timeToolInit(const char *filename, int random_toolchanger);
+
+// cycles below this fraction of the programmed feed count as velocity
+// limited in the report
+extern void timeSetLimitFraction(double fraction);
+
+// run the planner until all queued motion is done, like task waiting
+// for motion. Returns -1 if the planner stalls.
+extern int timeWaitMotion();
+
+// a dwell, charged to the line of the current motion id
+extern int timeDelay(double secs);
+
+// program pauses (M0, M1, M60) are counted but not timed
+extern int timeProgramPause();
+
+// print the total, the non motion events which were not timed and the
+// slowest velocity limited regions
+extern void timeReport(FILE *out, int regions);
+
+// write line, seconds, limited seconds and path length of every line
+// which took time
+extern int timeWriteLines(FILE *out);
+
+#endif
@@ -43,6 +43,7 @@
 #include "interpl.hh"		// interp_list
 #include "emcglb.h"		// TRAJ_MAX_VELOCITY
 #include "modal_state.hh"
+#include "rcs_print.hh"
 
 //#define EMCCANON_DEBUG
 
@@ -907,9 +908,104 @@ struct pt {
 
 static std::vector<struct pt> chained_points;
 
+// longest run of lines the naive cam detector joins, this bounds the
+// work per line as each new point is checked against the whole run
+#define NAIVECAM_MAX_POINTS 100
+
+// circle the chained points lie on, when they are joined into an arc
+// ([TRAJ]NAIVECAM_ARCS)
+struct arc_fit {
+    bool valid;
+    PM_CARTESIAN center, normal;
+    double radius, angle;
+};
+
+static struct arc_fit chained_arc;
+
+// direction at the end of the last line or arc the naive cam detector
+// sent, which the next arc has to start with where the path is smooth
+static struct {
+    bool valid;
+    PM_CARTESIAN end, dir;
+} naivecam_tangent;
+
+// what the naive cam detector made of the lines it saw. the times are
+// for the path it sent at the feed it planned and at the programmed feed
+static struct {
+    long lines_in, lines_out, arcs_out;
+    double time_planned, time_programmed;
+} naivecam_stats;
+
+static void naivecam_account(double length, double vel) {
+    if(vel <= 0 || currentLinearFeedRate <= 0) return;
+    naivecam_stats.time_planned += length / vel;
+    naivecam_stats.time_programmed += length / currentLinearFeedRate;
+}
+
+static void flush_arc(void) {
+    struct pt &pos = chained_points.back();
+    PM_CARTESIAN end(pos.x, pos.y, pos.z);
+    double r = chained_arc.radius;
+
+    // the XYZ axes the plane of the circle extends into limit the
+    // tangential velocity and acceleration
+    double n[3] = {chained_arc.normal.x, chained_arc.normal.y,
+                   chained_arc.normal.z};
+    double v_max_axes = 0, a_max_axes = 0;
+    for(int i = 0; i < 3; i++) {
+        if(!axis_valid(i) || rtapi_fabs(n[i]) > 1 - 1e-9)
+            continue;
+        double vi = FROM_EXT_LEN(axis_max_velocity[i]);
+        double ai = FROM_EXT_LEN(axis_max_acceleration[i]);
+        v_max_axes = v_max_axes ? MIN(v_max_axes, vi) : vi;
+        a_max_axes = a_max_axes ? MIN(a_max_axes, ai) : ai;
+    }
+    //FIXME allow tangential acceleration like in TP (see ARC_FEED)
+    double a_max_normal = a_max_axes * rtapi_sqrt(3.0)/2.0;
+    double v_max = MIN(v_max_axes, rtapi_sqrt(a_max_normal * r));
+    double vel = MIN(currentLinearFeedRate, v_max);
+
+    EMC_TRAJ_CIRCULAR_MOVE circularMoveMsg;
+    circularMoveMsg.feed_mode = feed_mode;
+    circularMoveMsg.end = to_ext_pose(pos.x, pos.y, pos.z,
+                                      pos.a, pos.b, pos.c,
+                                      pos.u, pos.v, pos.w);
+    circularMoveMsg.center = to_ext_len(chained_arc.center);
+    circularMoveMsg.normal = to_ext_len(chained_arc.normal);
+    // counterclockwise about the normal, less than a full turn
+    circularMoveMsg.turn = 0;
+    circularMoveMsg.type = EMC_MOTION_TYPE_ARC;
+    circularMoveMsg.vel = toExtVel(vel);
+    circularMoveMsg.ini_maxvel = toExtVel(v_max);
+    circularMoveMsg.acc = toExtAcc(a_max_axes);
+
+    cartesian_move = 1;
+    angular_move = 0;
+    if(vel && a_max_axes) {
+        interp_list.set_line_number(pos.line_no);
+        tag_and_send(circularMoveMsg, pos.tag);
+    }
+    naivecam_stats.arcs_out++;
+    naivecam_account(r * chained_arc.angle, vel);
+    naivecam_tangent.valid = true;
+    naivecam_tangent.end = end;
+    naivecam_tangent.dir = unit(cross(chained_arc.normal,
+                                      end - chained_arc.center));
+    canonUpdateEndPoint(pos.x, pos.y, pos.z, pos.a, pos.b, pos.c,
+                        pos.u, pos.v, pos.w);
+
+    chained_points.clear();
+    chained_arc.valid = false;
+}
+
 static void flush_segments(void) {
     if(chained_points.empty()) return;
 
+    if(chained_arc.valid) {
+        flush_arc();
+        return;
+    }
+
     struct pt &pos = chained_points.back();
 
     double x = pos.x, y = pos.y, z = pos.z;
@@ -970,8 +1066,17 @@ static void flush_segments(void) {
         interp_list.set_line_number(line_no);
         tag_and_send(linearMoveMsg,pos.tag);
     }
+    PM_CARTESIAN start(canonEndPoint.x, canonEndPoint.y, canonEndPoint.z),
+                 end(x, y, z);
+    naivecam_tangent.valid = (end != start) && !angular_move;
+    if(naivecam_tangent.valid) {
+        naivecam_tangent.end = end;
+        naivecam_tangent.dir = unit(end - start);
+        naivecam_account(mag(end - start), vel);
+    }
     canonUpdateEndPoint(x, y, z, a, b, c, u, v, w);
 
+    naivecam_stats.lines_out++;
     chained_points.clear();
 }
 
@@ -995,8 +1100,7 @@ linkable(double x, double y, double z,
     struct pt &pos = chained_points.back();
     if(canonMotionMode != CANON_CONTINUOUS || canonNaivecamTolerance == 0)
         return false;
-    //FIXME make this length controlled elsewhere?
-    if(chained_points.size() > 100) return false;
+    if(chained_points.size() > NAIVECAM_MAX_POINTS) return false;
 
     //If ABCUVW motion, then the tangent calculation fails?
     // TODO is there a fundamental reason that we can't handle 9D motion here?
@@ -1024,6 +1128,100 @@ linkable(double x, double y, double z,
     return true;
 }
 
+// every chained point and E have to be within the naive cam tolerance of
+// the circle, and so has every line, going around less than once in one
+// direction from S
+static bool
+arc_fits(struct arc_fit &fit, const PM_CARTESIAN &S, const PM_CARTESIAN &E) {
+    PM_CARTESIAN bu = unit(S - fit.center);
+    PM_CARTESIAN bv = cross(fit.normal, bu);
+    double tol = canonNaivecamTolerance;
+    double last = 0;
+    for(unsigned int i = 0; i <= chained_points.size(); i++) {
+        PM_CARTESIAN P = (i < chained_points.size())
+            ? PM_CARTESIAN(chained_points[i].x, chained_points[i].y,
+                           chained_points[i].z)
+            : E;
+        PM_CARTESIAN rel = P - fit.center;
+        double h = dot(rel, fit.normal);
+        double pu = dot(rel, bu), pv = dot(rel, bv);
+        // distance of the point from the circle
+        if(rtapi_hypot(h, rtapi_hypot(pu, pv) - fit.radius) > tol)
+            return false;
+        double theta = rtapi_atan2(pv, pu);
+        if(theta < 0) theta += 2 * M_PI;
+        if(theta <= last) return false;
+        // sagitta of the line to this point
+        if(fit.radius * (1 - rtapi_cos((theta - last) / 2)) > tol)
+            return false;
+        last = theta;
+    }
+    fit.angle = last;
+    fit.valid = true;
+    return true;
+}
+
+// can the chained points and x, y, z be joined into one arc?
+// the circle is the one through the start, the middle and the new
+// point, or, where the run continues the last line or arc sent
+// smoothly, the one which starts tangent to it and goes through the
+// new point.
+static bool
+arc_linkable(double x, double y, double z,
+             double a, double b, double c,
+             double u, double v, double w, struct arc_fit &fit) {
+    if(!traj_naivecam_arcs || canonMotionMode != CANON_CONTINUOUS
+       || canonNaivecamTolerance == 0)
+        return false;
+    // an arc should replace three lines at least
+    if(chained_points.size() < 2) return false;
+    if(chained_points.size() > NAIVECAM_MAX_POINTS) return false;
+
+    struct pt &pos = chained_points.back();
+    if(a != pos.a || b != pos.b || c != pos.c) return false;
+    if(u != pos.u || v != pos.v || w != pos.w) return false;
+
+    struct pt &mid = chained_points[chained_points.size() / 2];
+    PM_CARTESIAN S(canonEndPoint.x, canonEndPoint.y, canonEndPoint.z),
+                 M(mid.x, mid.y, mid.z),
+                 E(x, y, z);
+    PM_CARTESIAN SE = S - E, ME = M - E;
+    PM_CARTESIAN n = cross(SE, ME);
+    double nn = dot(n, n);
+    // (nearly) collinear
+    if(nn <= 1e-12 * dot(SE, SE) * dot(ME, ME)) return false;
+
+    fit.center = E + cross(dot(SE, SE) * ME - dot(ME, ME) * SE, n) / (2 * nn);
+    fit.radius = mag(S - fit.center);
+    // travel from S through M to E is counterclockwise about the normal
+    fit.normal = unit(cross(M - S, E - M));
+
+    if(!naivecam_tangent.valid || naivecam_tangent.end != S)
+        return arc_fits(fit, S, E);
+
+    // the first line leaves the last segment at a corner if no circle
+    // within the tolerance can bend that far over one line
+    PM_CARTESIAN t = naivecam_tangent.dir;
+    PM_CARTESIAN first(chained_points[0].x, chained_points[0].y,
+                       chained_points[0].z);
+    double kink = rtapi_acos(MAX(-1.0, MIN(1.0, dot(t, unit(first - S)))));
+    double bend = rtapi_acos(MAX(-1.0,
+                                 1 - canonNaivecamTolerance / fit.radius));
+    if(kink > bend)
+        return arc_fits(fit, S, E);
+
+    // smooth: the circle through E which starts tangent to t. its center
+    // is off S on the side E is on, counterclockwise about t x SE
+    PM_CARTESIAN se = E - S;
+    PM_CARTESIAN tn = cross(t, se);
+    if(dot(tn, tn) <= 1e-12 * dot(se, se)) return false;
+    fit.normal = unit(tn);
+    PM_CARTESIAN inward = cross(fit.normal, t);
+    fit.radius = dot(se, se) / (2 * dot(se, inward));
+    fit.center = S + fit.radius * inward;
+    return arc_fits(fit, S, E);
+}
+
 static void
 see_segment(int line_number,
         StateTag tag,
@@ -1038,9 +1236,22 @@ see_segment(int line_number,
         || (v != canonEndPoint.v)
         || (w != canonEndPoint.w);
 
-    if(!chained_points.empty() && !linkable(x, y, z, a, b, c, u, v, w)) {
-        flush_segments();
+    if(!chained_points.empty()) {
+        struct arc_fit fit;
+        bool line = linkable(x, y, z, a, b, c, u, v, w);
+
+        if(line && !chained_arc.valid) {
+            // still straight
+        } else if(arc_linkable(x, y, z, a, b, c, u, v, w, fit)) {
+            chained_arc = fit;
+        } else if(line) {
+            // an arc flat enough for a line
+            chained_arc.valid = false;
+        } else {
+            flush_segments();
+        }
     }
+    naivecam_stats.lines_in++;
     pt pos = {x, y, z, a, b, c, u, v, w, line_number, tag};
     chained_points.push_back(pos);
     if(changed_abc || changed_uvw) {
@@ -1050,6 +1261,21 @@ see_segment(int line_number,
 
 void FINISH() {
     flush_segments();
+    if(traj_naivecam_arcs && naivecam_stats.lines_in
+       && (emc_debug & EMC_DEBUG_NAIVECAM)) {
+        long out = naivecam_stats.lines_out + naivecam_stats.arcs_out;
+        rcs_print("naive cam: %ld lines sent as %ld lines and %ld arcs (%.1f:1)\n",
+                  naivecam_stats.lines_in, naivecam_stats.lines_out,
+                  naivecam_stats.arcs_out,
+                  out ? (double)naivecam_stats.lines_in / out : 0.0);
+        // the velocity limits of the moves as sent, before the
+        // trajectory planner accelerates and blends them
+        if(naivecam_stats.time_planned > 0)
+            rcs_print("naive cam: feed planned at %.0f%% of the programmed feed\n",
+                      100 * naivecam_stats.time_programmed
+                          / naivecam_stats.time_planned);
+    }
+    memset(&naivecam_stats, 0, sizeof(naivecam_stats));
 }
 
 void STRAIGHT_TRAVERSE(int line_number,
@@ -1312,90 +1538,132 @@ static double chord_deviation(double sx, double sy, double ex, double ey, double
 
 /* Spline and NURBS additional functions; */
 
-static double max(double a, double b) {
-    if(a < b) return b;
-    return a;
+// a NURBS knot span is split into halves until the cubic through its ends
+// is within this distance (program units) of the curve
+#define NURBS_SPLINE_TOLERANCE 1e-3
+#define NURBS_SPLINE_MAX_DEPTH 6
+#define NURBS_DU 1e-5
+
+struct nurbs_curve {
+    std::vector<CONTROL_POINT> &points;
+    std::vector<unsigned int> &knots;
+    unsigned int k;
+};
+
+// dP/du on the side of u towards 'dir' (the curve is only C(k-2) at the
+// knots), by a second order one sided difference
+static PLANE_POINT nurbs_derivative(nurbs_curve &nc, double u, int dir) {
+    double du = dir * NURBS_DU;
+    PLANE_POINT P0 = nurbs_point(u, nc.k, nc.points, nc.knots);
+    PLANE_POINT P1 = nurbs_point(u + du, nc.k, nc.points, nc.knots);
+    PLANE_POINT P2 = nurbs_point(u + 2 * du, nc.k, nc.points, nc.knots);
+    PLANE_POINT d = {(4 * P1.X - 3 * P0.X - P2.X) / (2 * du),
+                     (4 * P1.Y - 3 * P0.Y - P2.Y) / (2 * du)};
+    return d;
+}
+
+// a point in the XY plane of the program to internal coordinates
+static PM_CARTESIAN nurbs_to_internal(double x, double y) {
+    double z = 0, unused = 0;
+    x = FROM_PROG_LEN(x);
+    y = FROM_PROG_LEN(y);
+    rotate_and_offset_pos(x, y, z, unused, unused, unused, unused, unused, unused);
+    return PM_CARTESIAN(x, y, canonEndPoint.z);
 }
-static void unit(double *x, double *y) {
-    double h = rtapi_hypot(*x, *y);
-    if(h != 0) { *x/=h; *y/=h; }
+
+static void spline_feed(int lineno, PM_CARTESIAN ctrl1, PM_CARTESIAN ctrl2,
+                        PM_CARTESIAN end) {
+    EMC_TRAJ_SPLINE_MOVE splineMoveMsg;
+
+    // the TP limits the velocity by the curvature, only the XY axes here
+    double v_max = MIN(FROM_EXT_LEN(axis_max_velocity[0]),
+                       FROM_EXT_LEN(axis_max_velocity[1]));
+    double a_max = MIN(FROM_EXT_LEN(axis_max_acceleration[0]),
+                       FROM_EXT_LEN(axis_max_acceleration[1]));
+    double vel = MIN(currentLinearFeedRate, v_max);
+
+    splineMoveMsg.feed_mode = feed_mode;
+    splineMoveMsg.end = to_ext_pose(end.x, end.y, canonEndPoint.z,
+                                    canonEndPoint.a, canonEndPoint.b, canonEndPoint.c,
+                                    canonEndPoint.u, canonEndPoint.v, canonEndPoint.w);
+    splineMoveMsg.ctrl1 = to_ext_len(ctrl1);
+    splineMoveMsg.ctrl2 = to_ext_len(ctrl2);
+    splineMoveMsg.type = EMC_MOTION_TYPE_FEED;
+    splineMoveMsg.vel = toExtVel(vel);
+    splineMoveMsg.ini_maxvel = toExtVel(v_max);
+    splineMoveMsg.acc = toExtAcc(a_max);
+
+    cartesian_move = 1;
+    if(vel && a_max) {
+        interp_list.set_line_number(lineno);
+        tag_and_send(splineMoveMsg, _tag);
+    }
+    canonUpdateEndPoint(end.x, end.y, canonEndPoint.z,
+                        canonEndPoint.a, canonEndPoint.b, canonEndPoint.c,
+                        canonEndPoint.u, canonEndPoint.v, canonEndPoint.w);
 }
 
-static void
-arc(int lineno, double x0, double y0, double x1, double y1, double dx, double dy) {
-    double small = 0.000001;
-    double x = x1-x0, y=y1-y0;
-    double den = 2 * (y*dx - x*dy);
-    CANON_POSITION p = unoffset_and_unrotate_pos(canonEndPoint);
-    to_prog(p);
-    if (rtapi_fabs(den) > small) {
-        double r = -(x*x+y*y)/den;
-        double i = dy*r, j = -dx*r;
-        double cx = x1+i, cy=y1+j;
-        ARC_FEED(lineno, x1, y1, cx, cy, r<0 ? 1 : -1,
-                 p.z, p.a, p.b, p.c, p.u, p.v, p.w);
-    } else { 
-        STRAIGHT_FEED(lineno, x1, y1, p.z, p.a, p.b, p.c, p.u, p.v, p.w);
-    }
-}
-
-static int
-biarc(int lineno, double p0x, double p0y, double tsx, double tsy,
-      double p4x, double p4y, double tex, double tey, double r=1.0) {
-    unit(&tsx, &tsy);
-    unit(&tex, &tey);
-
-    double vx = p0x - p4x, vy = p0y - p4y;
-    double c = vx*vx + vy*vy;
-    double b = 2 * (vx * (r*tsx + tex) + vy * (r*tsy + tey));
-    double a = 2 * r * (tsx * tex + tsy * tey - 1);
-
-    double discr = b*b - 4*a*c;
-    if(discr < 0) return 0;
-
-    double disq = rtapi_sqrt(discr);
-    double beta1 = (-b-disq) / 2 / a;
-    double beta2 = (-b+disq) / 2 / a;
-
-    if(beta1 > 0 && beta2 > 0)
-      return 0;
-    double beta = max(beta1, beta2);
-    double alpha = beta * r;
-    double ab = alpha + beta;
-    double p1x = p0x + alpha * tsx, p1y = p0y + alpha * tsy,
-         p3x = p4x - beta * tex, p3y = p4y - beta * tey,
-         p2x = (p1x*beta + p3x*alpha) / ab,
-         p2y = (p1y*beta + p3y*alpha) / ab;
-    double tmx = p3x-p2x, tmy = p3y-p2y;
-    unit(&tmx, &tmy);
-
-    arc(lineno, p0x, p0y, p2x, p2y, tsx, tsy);
-    arc(lineno, p2x, p2y, p4x, p4y, tmx, tmy);
-    return 1;
+// send u0..u1 of a NURBS curve as cubic Hermite splines, with the
+// points and derivatives at the ends given
+static void nurbs_span(int lineno, nurbs_curve &nc, double u0, double u1,
+                       PLANE_POINT P0, PLANE_POINT D0,
+                       PLANE_POINT P1, PLANE_POINT D1, int depth) {
+    double h = u1 - u0;
+    PLANE_POINT C1 = {P0.X + D0.X * h / 3, P0.Y + D0.Y * h / 3};
+    PLANE_POINT C2 = {P1.X - D1.X * h / 3, P1.Y - D1.Y * h / 3};
+
+    // compare with the curve at the same parameter, which bounds the
+    // distance between the two
+    double err = 0;
+    for(int i = 1; i < 4; i++) {
+        double t = i / 4.0, s = 1 - t;
+        double b0 = s*s*s, b1 = 3*s*s*t, b2 = 3*s*t*t, b3 = t*t*t;
+        PLANE_POINT P = nurbs_point(u0 + t * h, nc.k, nc.points, nc.knots);
+        err = rtapi_fmax(err, rtapi_hypot(
+                b0*P0.X + b1*C1.X + b2*C2.X + b3*P1.X - P.X,
+                b0*P0.Y + b1*C1.Y + b2*C2.Y + b3*P1.Y - P.Y));
+    }
+
+    if(err > NURBS_SPLINE_TOLERANCE && depth < NURBS_SPLINE_MAX_DEPTH) {
+        double um = (u0 + u1) / 2;
+        PLANE_POINT Pm = nurbs_point(um, nc.k, nc.points, nc.knots);
+        PLANE_POINT Dm = nurbs_derivative(nc, um, 1);
+        nurbs_span(lineno, nc, u0, um, P0, D0, Pm, Dm, depth + 1);
+        nurbs_span(lineno, nc, um, u1, Pm, Dm, P1, D1, depth + 1);
+        return;
+    }
+    spline_feed(lineno, nurbs_to_internal(C1.X, C1.Y),
+                nurbs_to_internal(C2.X, C2.Y),
+                nurbs_to_internal(P1.X, P1.Y));
 }
 
 
 /* Canon calls */
 
+/* Each knot span of the curve is sent as one or a few cubic spline
+   segments, which the TP runs by arc length. */
 void NURBS_FEED(int lineno, std::vector<CONTROL_POINT> nurbs_control_points, unsigned int k) {
     flush_segments();
 
     unsigned int n = nurbs_control_points.size() - 1;
-    double umax = n - k + 2;
-    unsigned int div = nurbs_control_points.size()*4;
+    unsigned int umax = n - k + 2;
     std::vector<unsigned int> knot_vector = knot_vector_creator(n, k);	
-    PLANE_POINT P0, P0T, P1, P1T;
-
-    P0 = nurbs_point(0,k,nurbs_control_points,knot_vector);
-    P0T = nurbs_tangent(0, k, nurbs_control_points, knot_vector);
-
-    for(unsigned int i=1; i<=div; i++) {
-	double u = umax * i / div;
-        P1 = nurbs_point(u,k,nurbs_control_points,knot_vector);
-	P1T = nurbs_tangent(u,k,nurbs_control_points,knot_vector);
-        biarc(lineno, P0.X,P0.Y, P0T.X,P0T.Y, P1.X,P1.Y, P1T.X,P1T.Y);
+    nurbs_curve nc = {nurbs_control_points, knot_vector, k};
+    PLANE_POINT P0, P1;
+
+    P0 = nurbs_point(0, k, nurbs_control_points, knot_vector);
+    for(unsigned int i = 0; i < umax; i++) {
+        if(i + 1 == umax) {
+            // the end point exactly
+            P1.X = nurbs_control_points[n].X;
+            P1.Y = nurbs_control_points[n].Y;
+        } else {
+            P1 = nurbs_point(i + 1, k, nurbs_control_points, knot_vector);
+        }
+        nurbs_span(lineno, nc, i, i + 1,
+                   P0, nurbs_derivative(nc, i, 1),
+                   P1, nurbs_derivative(nc, i + 1, -1), 0);
         P0 = P1;
-        P0T = P1T;
     }
     knot_vector.clear();
 }
@@ -2515,6 +2783,9 @@ void INIT_CANON()
     double units;
 
     chained_points.clear();
+    chained_arc.valid = false;
+    naivecam_tangent.valid = false;
+    memset(&naivecam_stats, 0, sizeof(naivecam_stats));
 
     // initialize locals to original values
     g5xOffset.x = 0.0;
@@ -82,6 +82,7 @@ fpu_control_t __fpu_control = _FPU_IEEE & ~(_FPU_MASK_IM | _FPU_MASK_ZM | _FPU_M
 #include "taskclass.hh"
 #include "motion.h"             // EMCMOT_ORIENT_*
 #include "inihal.hh"
+#include "emcstatmirror.hh"	// EmcStatMirror
 
 /* time after which the user interface is declared dead
  * because it would'nt read any more messages
@@ -96,6 +97,7 @@ char **Argv;
 // NML channels
 static RCS_CMD_CHANNEL *emcCommandBuffer = 0;
 static RCS_STAT_CHANNEL *emcStatusBuffer = 0;
+static EmcStatMirror emcStatMirror;	// change notification for emcStatus
 static NML *emcErrorBuffer = 0;
 
 // NML command channel data pointer
@@ -389,6 +391,7 @@ static EMC_TRAJ_SET_VELOCITY *emcTrajSetVelocityMsg;
 static EMC_TRAJ_SET_ACCELERATION *emcTrajSetAccelerationMsg;
 static EMC_TRAJ_LINEAR_MOVE *emcTrajLinearMoveMsg;
 static EMC_TRAJ_CIRCULAR_MOVE *emcTrajCircularMoveMsg;
+static EMC_TRAJ_SPLINE_MOVE *emcTrajSplineMoveMsg;
 static EMC_TRAJ_DELAY *emcTrajDelayMsg;
 static EMC_TRAJ_SET_TERM_COND *emcTrajSetTermCondMsg;
 static EMC_TRAJ_SET_SPINDLESYNC *emcTrajSetSpindlesyncMsg;
@@ -1496,6 +1499,7 @@ static int emcTaskCheckPreconditions(NMLmsg * cmd)
 
     case EMC_TRAJ_LINEAR_MOVE_TYPE:
     case EMC_TRAJ_CIRCULAR_MOVE_TYPE:
+    case EMC_TRAJ_SPLINE_MOVE_TYPE:
     case EMC_TRAJ_SET_VELOCITY_TYPE:
     case EMC_TRAJ_SET_ACCELERATION_TYPE:
     case EMC_TRAJ_SET_TERM_COND_TYPE:
@@ -1827,6 +1831,17 @@ static int emcTaskIssueCommand(NMLmsg * cmd)
                 emcTrajCircularMoveMsg->acc);
 	break;
 
+    case EMC_TRAJ_SPLINE_MOVE_TYPE:
+    emcTrajUpdateTag(((EMC_TRAJ_SPLINE_MOVE *) cmd)->tag);
+	emcTrajSplineMoveMsg = (EMC_TRAJ_SPLINE_MOVE *) cmd;
+        retval = emcTrajSplineMove(emcTrajSplineMoveMsg->end,
+                emcTrajSplineMoveMsg->ctrl1, emcTrajSplineMoveMsg->ctrl2,
+                emcTrajSplineMoveMsg->type,
+                emcTrajSplineMoveMsg->vel,
+                emcTrajSplineMoveMsg->ini_maxvel,
+                emcTrajSplineMoveMsg->acc);
+	break;
+
     case EMC_TRAJ_PAUSE_TYPE:
 	emcStatus->task.task_paused = 1;
 	retval = emcTrajPause();
@@ -2390,6 +2405,7 @@ static int emcTaskCheckPostconditions(NMLmsg * cmd)
 
     case EMC_TRAJ_LINEAR_MOVE_TYPE:
     case EMC_TRAJ_CIRCULAR_MOVE_TYPE:
+    case EMC_TRAJ_SPLINE_MOVE_TYPE:
     case EMC_TRAJ_SET_VELOCITY_TYPE:
     case EMC_TRAJ_SET_ACCELERATION_TYPE:
     case EMC_TRAJ_SET_TERM_COND_TYPE:
@@ -2891,6 +2907,8 @@ static int emctask_startup()
 	rcs_print_error("can't get emcStatus buffer\n");
 	return -1;
     }
+    // optional: clients fall back to polling without it
+    emcStatMirror.create();
 
     if (!(emc_debug & EMC_DEBUG_NML)) {
 	set_rcs_print_destination(RCS_PRINT_TO_NULL);	// inhibit diag
@@ -3057,6 +3075,8 @@ static int emctask_shutdown(void)
 	emcErrorBuffer = 0;
     }
 
+    emcStatMirror.detach();
+
     if (0 != emcStatusBuffer) {
 	delete emcStatusBuffer;
 	emcStatusBuffer = 0;
@@ -3194,6 +3214,16 @@ static int iniLoad(const char *filename)
 	no_force_homing = 0;
     }
 
+    if (NULL != (inistring = inifile.Find("NAIVECAM_ARCS", "TRAJ"))) {
+	if (1 != sscanf(inistring, "%d", &traj_naivecam_arcs)) {
+	    // found, but invalid
+	    traj_naivecam_arcs = 0;
+	    rcs_print
+		("invalid [TRAJ] NAIVECAM_ARCS in %s (%s); using default %d\n",
+		 filename, inistring, traj_naivecam_arcs);
+	}
+    }
+
     // configurable template for iocontrol reason display
     if (NULL != (inistring = inifile.Find("IO_ERROR", "TASK"))) {
 	io_error = strdup(inistring);
@@ -3488,6 +3518,8 @@ int main(int argc, char *argv[])
 	// will be updated in the _update() functions above. There's
 	// no need to call the individual functions on all WM items.
 	emcStatusBuffer->write(emcStatus);
+	// and tell local clients which parts of it changed
+	emcStatMirror.publish(emcStatus);
 
 	// wait on timer cycle, if specified, or calculate actual
 	// interval if ini file says to run full out via
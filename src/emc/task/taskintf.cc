@@ -311,6 +311,21 @@ int emcAxisSetMaxAcceleration(int axis, double acc)
     return usrmotWriteEmcmotCommand(&emcmotCommand);
 }
 
+int emcAxisSetMaxJerk(int axis, double jerk)
+{
+
+    if (axis < 0 || axis >= EMC_AXIS_MAX) {
+	return 0;
+    }
+    if (jerk < 0.0) {
+	jerk = 0.0;
+    }
+    emcmotCommand.command = EMCMOT_SET_JOINT_JERK_LIMIT;
+    emcmotCommand.axis = axis;
+    emcmotCommand.jerk = jerk;
+    return usrmotWriteEmcmotCommand(&emcmotCommand);
+}
+
 /* This function checks to see if any axis or the traj has
    been inited already.  At startup, if none have been inited,
    usrmotIniLoad and usrmotInit must be called first.  At
@@ -1058,6 +1073,43 @@ int emcTrajCircularMove(EmcPose end, PM_CARTESIAN center,
     return usrmotWriteEmcmotCommand(&emcmotCommand);
 }
 
+int emcTrajSplineMove(EmcPose end, PM_CARTESIAN ctrl1,
+		      PM_CARTESIAN ctrl2, int type, double vel, double ini_maxvel, double acc)
+{
+#ifdef ISNAN_TRAP
+    if (rtapi_isnan(end.tran.x) || rtapi_isnan(end.tran.y) || rtapi_isnan(end.tran.z) ||
+	rtapi_isnan(end.a) || rtapi_isnan(end.b) || rtapi_isnan(end.c) ||
+	rtapi_isnan(end.u) || rtapi_isnan(end.v) || rtapi_isnan(end.w) ||
+	rtapi_isnan(ctrl1.x) || rtapi_isnan(ctrl1.y) || rtapi_isnan(ctrl1.z) ||
+	rtapi_isnan(ctrl2.x) || rtapi_isnan(ctrl2.y) || rtapi_isnan(ctrl2.z)) {
+	printf("isnan error in emcTrajSplineMove()\n");
+	return 0;		// ignore it for now, just don't send it
+    }
+#endif
+
+    emcmotCommand.command = EMCMOT_SET_SPLINE;
+
+    emcmotCommand.pos = end;
+    emcmotCommand.motion_type = type;
+
+    emcmotCommand.ctrl1.x = ctrl1.x;
+    emcmotCommand.ctrl1.y = ctrl1.y;
+    emcmotCommand.ctrl1.z = ctrl1.z;
+
+    emcmotCommand.ctrl2.x = ctrl2.x;
+    emcmotCommand.ctrl2.y = ctrl2.y;
+    emcmotCommand.ctrl2.z = ctrl2.z;
+
+    emcmotCommand.id = localEmcTrajMotionId;
+    emcmotCommand.tag = localEmcTrajTag;
+
+    emcmotCommand.vel = vel;
+    emcmotCommand.ini_maxvel = ini_maxvel;
+    emcmotCommand.acc = acc;
+
+    return usrmotWriteEmcmotCommand(&emcmotCommand);
+}
+
 int emcTrajClearProbeTrippedFlag()
 {
     emcmotCommand.command = EMCMOT_CLEAR_PROBE_FLAGS;
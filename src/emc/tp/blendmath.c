@@ -614,6 +614,14 @@ int blendParamKinematics(BlendGeom3 * const geom,
     // Calculate max acceleration based on plane containing lines
     int res_dia = calculateInscribedDiameter(&geom->binormal, acc_bound, &param->a_max);
 
+    // Don't exceed what the joints allow on either side of the blend
+    if (prev_tc->kins_maxaccel > 0.0) {
+        param->a_max = rtapi_fmin(param->a_max, prev_tc->kins_maxaccel);
+    }
+    if (tc->kins_maxaccel > 0.0) {
+        param->a_max = rtapi_fmin(param->a_max, tc->kins_maxaccel);
+    }
+
     // Store max normal acceleration
     param->a_n_max = param->a_max * BLEND_ACC_RATIO_NORMAL;
     tp_debug_print("a_max = %f, a_n_max = %f\n", param->a_max,
@@ -1108,6 +1116,21 @@ int blendComputeParameters(BlendParameters * const param)
 
     param->v_plan = rtapi_fmin(v_normal, param->v_goal);
 
+    /* With a jerk limit, the normal acceleration has to build up and fall off
+     * again within the arc, v^2 / R / j_max <= R * phi / v / 2, and it turns
+     * with the tangent, v^3 / R^2 <= j_max. */
+    double R_jerk = 0.0;
+    if (param->j_max > 0.0) {
+        double v_jerk = rtapi_cbrt(param->j_max * pmSq(R_geom) * param->phi / 2.0);
+        v_jerk = jerkActualMaxVel(1.0 / rtapi_fmax(R_geom, TP_POS_EPSILON),
+                v_jerk, param->j_max);
+        tp_debug_print("v_jerk = %f\n", v_jerk);
+        param->v_plan = rtapi_fmin(param->v_plan, v_jerk);
+        double v_cube = pmSq(param->v_plan) * param->v_plan;
+        R_jerk = rtapi_fmax(pmSqrt(2.0 * v_cube / (param->j_max * param->phi)),
+                pmSqrt(v_cube / param->j_max));
+    }
+
     /*Get the limiting velocity of the equivalent parabolic blend. We use the
      * time it would take to do a "stock" parabolic blend as a metric for how
      * much of the segment to consume. A long segment will have a high
@@ -1123,6 +1146,7 @@ int blendComputeParameters(BlendParameters * const param)
     double R_blend = rtapi_fmin(s_blend / param->phi, R_geom);   //Clamp by limiting radius
 
     param->R_plan = rtapi_fmax(pmSq(param->v_plan) / param->a_n_max, R_blend);
+    param->R_plan = rtapi_fmax(param->R_plan, R_jerk);
     param->d_plan = param->R_plan / rtapi_tan(param->theta);
 
     tp_debug_print("v_plan = %f\n", param->v_plan);
@@ -1605,6 +1629,109 @@ double pmCircleActualMaxVel(PmCircle * const circle, double v_max, double a_max,
     }
 }
 
+/**
+ * Limit the velocity on a spline by its curvature.
+ * Like pmCircleActualMaxVel, with the smallest radius of curvature along
+ * the spline as the radius.
+ */
+double splineActualMaxVel(CubicSpline const * const spline, double v_max, double a_max, int parabolic)
+{
+    if (parabolic) {
+        a_max /= 2.0;
+    }
+    if (spline->max_curvature < TP_POS_EPSILON) {
+        return v_max;
+    }
+    double a_n_max = BLEND_ACC_RATIO_NORMAL * a_max;
+    double v_max_acc = pmSqrt(a_n_max / spline->max_curvature);
+    if (v_max_acc < v_max) {
+        tp_debug_print("Maxvel limited from %f to %f for curvature\n", v_max, v_max_acc);
+        return v_max_acc;
+    }
+    return v_max;
+}
+
+/**
+ * Limit the velocity on a curve by the jerk limit.
+ * At constant speed the normal acceleration v^2 * k turns with the path,
+ * which takes a jerk of v^3 * k^2.
+ */
+double jerkActualMaxVel(double curvature, double v_max, double j_max)
+{
+    if (j_max <= 0.0 || curvature < TP_POS_EPSILON) {
+        return v_max;
+    }
+    double v_max_jerk = rtapi_cbrt(j_max / pmSq(curvature));
+    if (v_max_jerk < v_max) {
+        tp_debug_print("Maxvel limited from %f to %f for jerk\n", v_max, v_max_jerk);
+        return v_max_jerk;
+    }
+    return v_max;
+}
+
+
+/**
+ * Distance covered by a piece of constant jerk.
+ */
+static double constJerkDistance(double v, double a, double j, double t)
+{
+    return t * (v + t * (a / 2.0 + t * j / 6.0));
+}
+
+/**
+ * Find the highest velocity from which a segment can slow down to v_final
+ * within a distance, with a jerk limited ("S-curve") deceleration.
+ * Ramping the acceleration in and out costs (v + v_final) * a_max / (2 j_max)
+ * of distance over a trapezoidal deceleration. This overestimates the distance
+ * when a_max is not reached, so the result is on the safe side. If j_max is 0,
+ * this is the trapezoidal result.
+ */
+double findSCurveVStart(double v_final, double a_max, double j_max,
+        double distance)
+{
+    double v_trapz = pmSqrt(pmSq(v_final) + 2.0 * a_max * distance);
+    if (j_max <= 0.0 || a_max <= 0.0) {
+        return v_trapz;
+    }
+
+    // Solve (v^2 - v_f^2) / (2 a) + (v + v_f) a / (2 j) = d for v
+    double b = pmSq(a_max) / j_max;
+    double c = pmSq(v_final) - v_final * b + 2.0 * a_max * distance;
+    double v_scurve = (pmSqrt(pmSq(b) + 4.0 * c) - b) / 2.0;
+    return rtapi_fmin(v_trapz, rtapi_fmax(v_scurve, v_final));
+}
+
+/**
+ * Distance needed to go from velocity v and acceleration a to v_final at
+ * zero acceleration, with the acceleration ramping at j_max and bounded by
+ * a_max.
+ */
+double findSCurveStopDistance(double v, double a, double v_final,
+        double a_max, double j_max)
+{
+    // Peak deceleration p, reached if there is no time to hold it
+    double p_sq = j_max * (v - v_final) + pmSq(a) / 2.0;
+    double p = p_sq > 0.0 ? pmSqrt(p_sq) : 0.0;
+    p = rtapi_fmin(p, a_max);
+
+    if (a < 0.0 && p < -a) {
+        // Already braking harder than needed, only ease off
+        return rtapi_fmax(constJerkDistance(v, a, j_max, -a / j_max), 0.0);
+    }
+
+    // Ramp down to -p, hold it, then ramp back up to zero
+    double t_in = (a + p) / j_max;
+    double dist = constJerkDistance(v, a, -j_max, t_in);
+    double v_hold = v + (pmSq(a) - pmSq(p)) / (2.0 * j_max);
+    double t_hold = 0.0;
+    if (p > 0.0) {
+        t_hold = rtapi_fmax((v_hold - v_final - pmSq(p) / (2.0 * j_max)) / p, 0.0);
+    }
+    dist += constJerkDistance(v_hold, -p, 0.0, t_hold);
+    dist += constJerkDistance(v_hold - p * t_hold, -p, j_max, p / j_max);
+    return dist;
+}
+
 
 /** @section spiralfuncs Functions to approximate spiral arc length */
 
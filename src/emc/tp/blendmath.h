@@ -74,6 +74,7 @@ typedef struct {
     double L2;          /* Available part of line 2 to blend over */
     double v_req;       /* requsted velocity for the blend arc */
     double a_max;       /* max acceleration allowed for blend */
+    double j_max;       /* max normal jerk, 0 if not limited */
 
     /* These fields are considered "output", and may be refactored into a
      * separate structure in the future */
@@ -235,5 +236,14 @@ int pmCircleAngleFromProgress(PmCircle const * const circle,
         double progress,
         double * const angle);
 double pmCircleEffectiveMinRadius(PmCircle const * const circle);
+double splineActualMaxVel(CubicSpline const * const spline,
+        double v_max,
+        double a_max,
+        int parabolic);
+double jerkActualMaxVel(double curvature, double v_max, double j_max);
+double findSCurveVStart(double v_final, double a_max, double j_max,
+        double distance);
+double findSCurveStopDistance(double v, double a, double v_final,
+        double a_max, double j_max);
 
 #endif
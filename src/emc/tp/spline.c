@@ -0,0 +1,259 @@
+/********************************************************************
+ * Description: spline.c
+ *
+ * Cubic Bezier segments for the trajectory planner, parameterized by
+ * arc length.
+ *
+ * License: GPL Version 2
+ * System: Linux
+ *
+ * Copyright (c) 2016 All rights reserved.
+ *
+ ********************************************************************/
+
+#include "posemath.h"
+#include "spline.h"
+#include "tp_types.h"
+#include "rtapi_math.h"
+
+#include "tp_debug.h"
+
+// Newton steps refining the parameter found from the arc length table
+#define SPLINE_NEWTON_STEPS 3
+
+/* 5 point Gauss-Legendre quadrature on [-1, 1] */
+static const double gauss_x[5] = {
+    -0.9061798459386640, -0.5384693101056831, 0.0,
+    0.5384693101056831, 0.9061798459386640
+};
+static const double gauss_w[5] = {
+    0.2369268850561891, 0.4786286704993665, 0.5688888888888889,
+    0.4786286704993665, 0.2369268850561891
+};
+
+/** First derivative dB/du. */
+static void splineDeriv(CubicSpline const * const spline, double u,
+        PmCartesian * const out)
+{
+    PmCartesian t;
+    pmCartScalMult(&spline->a, 3.0 * u, out);
+    pmCartScalMult(&spline->b, 2.0, &t);
+    pmCartCartAddEq(out, &t);
+    pmCartScalMultEq(out, u);
+    pmCartCartAddEq(out, &spline->c);
+}
+
+/** Second derivative d2B/du2. */
+static void splineDeriv2(CubicSpline const * const spline, double u,
+        PmCartesian * const out)
+{
+    PmCartesian t;
+    pmCartScalMult(&spline->a, 6.0 * u, out);
+    pmCartScalMult(&spline->b, 2.0, &t);
+    pmCartCartAddEq(out, &t);
+}
+
+static double splineSpeed(CubicSpline const * const spline, double u)
+{
+    PmCartesian d;
+    double mag;
+    splineDeriv(spline, u, &d);
+    pmCartMag(&d, &mag);
+    return mag;
+}
+
+/** Arc length between parameters u0 and u1. */
+static double splineArcLength(CubicSpline const * const spline,
+        double u0, double u1)
+{
+    double half = 0.5 * (u1 - u0);
+    double mid = 0.5 * (u1 + u0);
+    double sum = 0.0;
+    int i;
+
+    for (i = 0; i < 5; ++i) {
+        sum += gauss_w[i] * splineSpeed(spline, mid + half * gauss_x[i]);
+    }
+    return sum * half;
+}
+
+static double splineCurvature(CubicSpline const * const spline, double u)
+{
+    PmCartesian d1, d2, cr;
+    double speed, mag;
+
+    splineDeriv(spline, u, &d1);
+    splineDeriv2(spline, u, &d2);
+    pmCartMag(&d1, &speed);
+    if (speed < SPLINE_MIN_LENGTH) {
+        // a cusp, the tangent is not defined here
+        return 0.0;
+    }
+    pmCartCartCross(&d1, &d2, &cr);
+    pmCartMag(&cr, &mag);
+    return mag / (speed * speed * speed);
+}
+
+/**
+ * Set up a spline from its four Bezier control points.
+ * The arc length table and the maximum curvature are found here, once
+ * when the segment is queued.
+ */
+int splineInit(CubicSpline * const spline, PmCartesian const * const start,
+        PmCartesian const * const ctrl1, PmCartesian const * const ctrl2,
+        PmCartesian const * const end)
+{
+    PmCartesian t;
+    int i;
+
+    // Power basis coefficients
+    spline->d = *start;
+    pmCartCartSub(ctrl1, start, &spline->c);
+    pmCartScalMultEq(&spline->c, 3.0);
+
+    pmCartScalMult(ctrl1, -2.0, &t);
+    pmCartCartAddEq(&t, start);
+    pmCartCartAddEq(&t, ctrl2);
+    pmCartScalMult(&t, 3.0, &spline->b);
+
+    pmCartCartSub(ctrl1, ctrl2, &t);
+    pmCartScalMultEq(&t, 3.0);
+    pmCartCartAddEq(&t, end);
+    pmCartCartSub(&t, start, &spline->a);
+
+    spline->length[0] = 0.0;
+    spline->max_curvature = 0.0;
+    for (i = 0; i < SPLINE_SPANS; ++i) {
+        double u0 = (double)i / SPLINE_SPANS;
+        double u1 = (double)(i + 1) / SPLINE_SPANS;
+        spline->length[i + 1] = spline->length[i] +
+            splineArcLength(spline, u0, u1);
+        // curvature at the ends and the middle of each span
+        spline->max_curvature = rtapi_fmax(spline->max_curvature,
+                splineCurvature(spline, u0));
+        spline->max_curvature = rtapi_fmax(spline->max_curvature,
+                splineCurvature(spline, 0.5 * (u0 + u1)));
+    }
+    spline->max_curvature = rtapi_fmax(spline->max_curvature,
+            splineCurvature(spline, 1.0));
+
+    tp_debug_print("spline length = %f, max curvature = %f\n",
+            spline->length[SPLINE_SPANS], spline->max_curvature);
+
+    if (spline->length[SPLINE_SPANS] < SPLINE_MIN_LENGTH) {
+        return TP_ERR_ZERO_LENGTH;
+    }
+    return TP_ERR_OK;
+}
+
+/**
+ * Find the curve parameter at an arc length from the start.
+ * The span is looked up in the arc length table, then the parameter is
+ * refined with Newton's method on the arc length within that span.
+ */
+int splineParamFromProgress(CubicSpline const * const spline, double progress,
+        double * const u)
+{
+    int lo = 0, hi = SPLINE_SPANS;
+    int i;
+
+    if (progress <= 0.0) {
+        *u = 0.0;
+        return TP_ERR_OK;
+    }
+    if (progress >= spline->length[SPLINE_SPANS]) {
+        *u = 1.0;
+        return TP_ERR_OK;
+    }
+
+    while (hi - lo > 1) {
+        int mid = (lo + hi) / 2;
+        if (spline->length[mid] <= progress) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+
+    double u0 = (double)lo / SPLINE_SPANS;
+    double u1 = (double)hi / SPLINE_SPANS;
+    double span = spline->length[hi] - spline->length[lo];
+    double s = progress - spline->length[lo];
+    double x = u0;
+    if (span > SPLINE_MIN_LENGTH) {
+        x = u0 + (u1 - u0) * s / span;
+    }
+    for (i = 0; i < SPLINE_NEWTON_STEPS; ++i) {
+        double speed = splineSpeed(spline, x);
+        if (speed < SPLINE_MIN_LENGTH) {
+            break;
+        }
+        x -= (splineArcLength(spline, u0, x) - s) / speed;
+        x = rtapi_fmax(u0, rtapi_fmin(u1, x));
+    }
+    *u = x;
+    return TP_ERR_OK;
+}
+
+int splinePoint(CubicSpline const * const spline, double progress,
+        PmCartesian * const out)
+{
+    double u;
+
+    splineParamFromProgress(spline, progress, &u);
+    pmCartScalMult(&spline->a, u, out);
+    pmCartCartAddEq(out, &spline->b);
+    pmCartScalMultEq(out, u);
+    pmCartCartAddEq(out, &spline->c);
+    pmCartScalMultEq(out, u);
+    pmCartCartAddEq(out, &spline->d);
+    return TP_ERR_OK;
+}
+
+int splineLength(CubicSpline const * const spline, double * const length)
+{
+    *length = spline->length[SPLINE_SPANS];
+    return TP_ERR_OK;
+}
+
+/**
+ * Unit tangent vector at the start or the end of the spline.
+ * If the control point next to the end point coincides with it, the
+ * derivative vanishes there and the curve leaves along the direction to
+ * the next control point which differs, which is where B'(u) points as u
+ * approaches the end. The control points come back from the power basis:
+ * P1 - P0 = c / 3, P2 - P0 = (b + 2c) / 3, P3 - P0 = a + b + c.
+ */
+int splineTangent(CubicSpline const * const spline, PmCartesian * const tan,
+        int at_end)
+{
+    PmCartesian p[4];
+    PmCartesian d;
+    double mag;
+    int i;
+
+    p[0] = spline->d;
+    pmCartScalMult(&spline->c, 1.0 / 3.0, &p[1]);
+    pmCartCartAddEq(&p[1], &p[0]);
+    pmCartScalMult(&spline->c, 2.0, &d);
+    pmCartCartAddEq(&d, &spline->b);
+    pmCartScalMultEq(&d, 1.0 / 3.0);
+    pmCartCartAdd(&p[0], &d, &p[2]);
+    pmCartCartAdd(&spline->a, &spline->b, &d);
+    pmCartCartAddEq(&d, &spline->c);
+    pmCartCartAdd(&p[0], &d, &p[3]);
+
+    for (i = 1; i < 4; ++i) {
+        if (at_end) {
+            pmCartCartSub(&p[3], &p[3 - i], &d);
+        } else {
+            pmCartCartSub(&p[i], &p[0], &d);
+        }
+        pmCartMag(&d, &mag);
+        if (mag > SPLINE_MIN_LENGTH) {
+            return pmCartUnit(&d, tan);
+        }
+    }
+    // all control points coincide, splineInit refuses such a spline
+    return TP_ERR_ZERO_LENGTH;
+}
@@ -0,0 +1,52 @@
+/********************************************************************
+ * Description: spline.h
+ *
+ * Cubic Bezier segments for the trajectory planner, parameterized by
+ * arc length.
+ *
+ * License: GPL Version 2
+ * System: Linux
+ *
+ * Copyright (c) 2016 All rights reserved.
+ *
+ ********************************************************************/
+#ifndef SPLINE_H
+#define SPLINE_H
+
+#include "posemath.h"
+
+// Entries of the arc length table, the curve is split into this many
+// equal parameter spans
+#define SPLINE_SPANS 16
+#define SPLINE_MIN_LENGTH 1e-9
+
+/**
+ * A cubic Bezier curve B(u) = ((a u + b) u + c) u + d, 0 <= u <= 1.
+ * length[i] holds the arc length from u = 0 to u = i / SPLINE_SPANS, so
+ * that a position along the curve can be found from the distance traveled
+ * without integrating over the whole curve each cycle.
+ */
+typedef struct {
+    PmCartesian a;
+    PmCartesian b;
+    PmCartesian c;
+    PmCartesian d;
+    double length[SPLINE_SPANS + 1];
+    double max_curvature;   // highest curvature found along the curve
+} CubicSpline;
+
+int splineInit(CubicSpline * const spline, PmCartesian const * const start,
+        PmCartesian const * const ctrl1, PmCartesian const * const ctrl2,
+        PmCartesian const * const end);
+
+int splineParamFromProgress(CubicSpline const * const spline, double progress,
+        double * const u);
+
+int splinePoint(CubicSpline const * const spline, double progress,
+        PmCartesian * const out);
+
+int splineLength(CubicSpline const * const spline, double * const length);
+
+int splineTangent(CubicSpline const * const spline, PmCartesian * const tan,
+        int at_end);
+#endif
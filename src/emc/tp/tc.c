@@ -77,6 +77,11 @@ int tcGetStartAccelUnitVector(TC_STRUCT const * const tc, PmCartesian * const ou
         case TC_CIRCULAR:
             tcCircleStartAccelUnitVector(tc,out);
             break;
+        case TC_SPLINE:
+            if (splineTangent(&tc->coords.spline.xyz, out, 0)) {
+                return -1;
+            }
+            break;
         case TC_SPHERICAL:
             return -1;
         default:
@@ -101,6 +106,11 @@ int tcGetEndAccelUnitVector(TC_STRUCT const * const tc, PmCartesian * const out)
         case TC_CIRCULAR:
             tcCircleEndAccelUnitVector(tc,out);
             break;
+        case TC_SPLINE:
+            if (splineTangent(&tc->coords.spline.xyz, out, 1)) {
+                return -1;
+            }
+            break;
        case TC_SPHERICAL:
             return -1;
        default:
@@ -207,6 +217,11 @@ int tcGetStartTangentUnitVector(TC_STRUCT const * const tc, PmCartesian * const
         case TC_CIRCULAR:
             pmCircleTangentVector(&tc->coords.circle.xyz, 0.0, out);
             break;
+        case TC_SPLINE:
+            if (splineTangent(&tc->coords.spline.xyz, out, 0)) {
+                return -1;
+            }
+            break;
         default:
             rtapi_print_msg(RTAPI_MSG_ERR, "Invalid motion type %d!\n",tc->motion_type);
             return -1;
@@ -230,6 +245,11 @@ int tcGetEndTangentUnitVector(TC_STRUCT const * const tc, PmCartesian * const ou
             pmCircleTangentVector(&tc->coords.circle.xyz,
                     tc->coords.circle.xyz.angle, out);
             break;
+        case TC_SPLINE:
+            if (splineTangent(&tc->coords.spline.xyz, out, 1)) {
+                return -1;
+            }
+            break;
         default:
             rtapi_print_msg(RTAPI_MSG_ERR, "Invalid motion type %d!\n",tc->motion_type);
             return -1;
@@ -334,6 +354,17 @@ int tcGetPosReal(TC_STRUCT const * const tc, int of_point, EmcPose * const pos)
             abc = tc->coords.arc.abc;
             uvw = tc->coords.arc.uvw;
             break;
+        case TC_SPLINE:
+            splinePoint(&tc->coords.spline.xyz,
+                    progress,
+                    &xyz);
+            pmCartLinePoint(&tc->coords.spline.abc,
+                    progress * tc->coords.spline.abc.tmag / tc->target,
+                    &abc);
+            pmCartLinePoint(&tc->coords.spline.uvw,
+                    progress * tc->coords.spline.uvw.tmag / tc->target,
+                    &uvw);
+            break;
     }
 
     if (res_fit == TP_ERR_OK) {
@@ -637,6 +668,39 @@ double pmCircle9Target(PmCircle9 const * const circ9)
     return helical_length;
 }
 
+int pmSpline9Init(PmSpline9 * const spline9,
+        EmcPose const * const start,
+        EmcPose const * const end,
+        PmCartesian const * const ctrl1,
+        PmCartesian const * const ctrl2)
+{
+    PmCartesian start_xyz, end_xyz;
+    PmCartesian start_uvw, end_uvw;
+    PmCartesian start_abc, end_abc;
+
+    emcPoseToPmCartesian(start, &start_xyz, &start_abc, &start_uvw);
+    emcPoseToPmCartesian(end, &end_xyz, &end_abc, &end_uvw);
+
+    int xyz_fail = splineInit(&spline9->xyz, &start_xyz, ctrl1, ctrl2, &end_xyz);
+    //Initialize line parts of Spline9
+    int abc_fail = pmCartLineInit(&spline9->abc, &start_abc, &end_abc);
+    int uvw_fail = pmCartLineInit(&spline9->uvw, &start_uvw, &end_uvw);
+
+    if (xyz_fail || abc_fail || uvw_fail) {
+        rtapi_print_msg(RTAPI_MSG_ERR,"Failed to initialize Spline9, err codes %d, %d, %d\n",
+                xyz_fail, abc_fail, uvw_fail);
+        return TP_ERR_FAIL;
+    }
+    return TP_ERR_OK;
+}
+
+double pmSpline9Target(PmSpline9 const * const spline9)
+{
+    double length;
+    splineLength(&spline9->xyz, &length);
+    return length;
+}
+
 /**
  * "Finalizes" a segment so that its length can't change.
  * By setting the finalized flag, we tell the optimizer that this segment's
@@ -663,6 +727,8 @@ int tcFinalizeLength(TC_STRUCT * const tc)
 
     if (tc->motion_type == TC_CIRCULAR) {
         tc->maxvel = pmCircleActualMaxVel(&tc->coords.circle.xyz, tc->maxvel, tc->maxaccel, parabolic);
+    } else if (tc->motion_type == TC_SPLINE) {
+        tc->maxvel = splineActualMaxVel(&tc->coords.spline.xyz, tc->maxvel, tc->maxaccel, parabolic);
     }
 
     tcClampVelocityByLength(tc);
@@ -16,6 +16,7 @@
 #define TC_TYPES_H
 
 #include "spherical_arc.h"
+#include "spline.h"
 #include "posemath.h"
 #include "emcpos.h"
 #include "emcmotcfg.h"  // EMCMOT_MAX_DIO, EMCMOT_MAX_AIO
@@ -35,7 +36,8 @@ typedef enum {
     TC_LINEAR = 1,
     TC_CIRCULAR = 2,
     TC_RIGIDTAP = 3,
-    TC_SPHERICAL = 4
+    TC_SPHERICAL = 4,
+    TC_SPLINE = 5
 } tc_motion_type_t;
 
 typedef enum {
@@ -87,6 +89,12 @@ typedef struct {
     PmCartesian uvw;
 } Arc9;
 
+typedef struct {
+    CubicSpline xyz;
+    PmCartLine abc;
+    PmCartLine uvw;
+} PmSpline9;
+
 typedef enum {
     TAPPING, REVERSING, RETRACTION, FINAL_REVERSAL, FINAL_PLACEMENT
 } RIGIDTAP_STATE;
@@ -130,6 +138,12 @@ typedef struct {
 
     //Acceleration
     double maxaccel;        // accel calc'd by task
+    double currentacc;      // acceleration of the last cycle, for the jerk limit
+    int curvature_step;     // cycles left at half the jerk after a step in curvature
+
+    // joint limited accel found when the segment was queued, already
+    // applied to maxaccel, 0 if not checked. Blend arcs stay below it.
+    double kins_maxaccel;
     
     int id;                 // segment's serial number
     struct state_tag_t tag; /* state tag corresponding to running motion */
@@ -139,11 +153,13 @@ typedef struct {
         PmCircle9 circle;
         PmRigidTap rigidtap;
         Arc9 arc;
+        PmSpline9 spline;
     } coords;
 
     int motion_type;       // TC_LINEAR (coords.line) or
                             // TC_CIRCULAR (coords.circle) or
-                            // TC_RIGIDTAP (coords.rigidtap)
+                            // TC_RIGIDTAP (coords.rigidtap) or
+                            // TC_SPLINE (coords.spline)
     int active;            // this motion is being executed
     int canon_motion_type;  // this motion is due to which canon function?
     int term_cond;          // gcode requests continuous feed at the end of
@@ -33,6 +33,10 @@ typedef struct {
 
 /* TC_QUEUE_STRUCT functions */
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /* create queue of _size */
 extern int tcqCreate(TC_QUEUE_STRUCT * const tcq, int _size,
 		     TC_STRUCT * const tcSpace);
@@ -66,4 +70,8 @@ extern TC_STRUCT * tcqLast(TC_QUEUE_STRUCT const * const tcq);
 /* get full status */
 extern int tcqFull(TC_QUEUE_STRUCT const * const tcq);
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif
@@ -65,7 +65,8 @@ STATIC int tpUpdateCycle(
         TC_STRUCT const * const nexttc);
 
 STATIC int tpRunOptimization(
-        TP_STRUCT * const tp);
+        TP_STRUCT * const tp,
+        int new_entries);
 
 STATIC inline int tpAddSegmentToQueue(
         TP_STRUCT * const tp,
@@ -123,6 +124,12 @@ STATIC int tpRotaryMotionCheck(TP_STRUCT const * const tp, TC_STRUCT const * con
             }
         case TC_SPHERICAL:
             return true;
+        case TC_SPLINE:
+            if (tc->coords.spline.abc.tmag_zero && tc->coords.spline.uvw.tmag_zero) {
+                return false;
+            } else {
+                return true;
+            }
         default:
             tp_debug_print("Unknown motion type!\n");
             return false;
@@ -169,6 +176,119 @@ STATIC int tpGetMachineVelBounds(TP_STRUCT const * const tp, PmCartesian  * cons
     return TP_ERR_OK;
 }
 
+/**
+ * Get the jerk limit of the machine, the lowest one set on the XYZ axes.
+ * Axes with no MAX_JERK don't limit it, 0 means no jerk limit at all.
+ */
+STATIC double tpGetMachineJerkLimit(TP_STRUCT const * const tp)
+{
+    double j_max = 0.0;
+    int i;
+
+    for (i = 0; i < 3; ++i) {
+        double j_axis = get_jerk_limit(tp->shared, i);
+        if (j_axis > 0.0 && (j_max == 0.0 || j_axis < j_max)) {
+            j_max = j_axis;
+        }
+    }
+    return j_max;
+}
+
+/**
+ * Lower a path jerk limit so that an axis which moves ratio units per unit
+ * of path length stays within its own limit j_axis.
+ */
+STATIC void tpLimitAxisJerk(double * const j_max, double j_axis, double ratio)
+{
+    ratio = rtapi_fabs(ratio);
+    if (j_axis <= 0.0 || ratio < TP_POS_EPSILON) {
+        return;
+    }
+    if (*j_max == 0.0 || j_axis / ratio < *j_max) {
+        *j_max = j_axis / ratio;
+    }
+}
+
+/**
+ * Limit the path jerk by the axes of a straight part of a segment, which is
+ * ratio long per unit of path length. axis is the index of its first axis.
+ */
+STATIC void tpLimitLineJerk(TP_STRUCT const * const tp, double * const j_max,
+        PmCartLine const * const line, double ratio, int axis)
+{
+    if (line->tmag_zero) {
+        return;
+    }
+    tpLimitAxisJerk(j_max, get_jerk_limit(tp->shared, axis), line->uVec.x * ratio);
+    tpLimitAxisJerk(j_max, get_jerk_limit(tp->shared, axis + 1), line->uVec.y * ratio);
+    tpLimitAxisJerk(j_max, get_jerk_limit(tp->shared, axis + 2), line->uVec.z * ratio);
+}
+
+/**
+ * Get the jerk limit along the path of a segment from the MAX_JERK of all
+ * nine axes, 0 means no jerk limit at all.
+ * On a straight part each axis moves a fixed share of the path length, so
+ * the path jerk is scaled up by that share, like the acceleration of a move
+ * is. The XYZ part of arcs, splines and blend arcs turns, there the lowest
+ * XYZ limit applies.
+ */
+STATIC double tpGetSegmentJerkLimit(TP_STRUCT const * const tp,
+        TC_STRUCT const * const tc)
+{
+    double j_max = 0.0;
+    double target = rtapi_fmax(tc->target, TP_POS_EPSILON);
+
+    switch (tc->motion_type) {
+        case TC_LINEAR:
+            tpLimitLineJerk(tp, &j_max, &tc->coords.line.xyz,
+                    tc->coords.line.xyz.tmag / target, 0);
+            tpLimitLineJerk(tp, &j_max, &tc->coords.line.abc,
+                    tc->coords.line.abc.tmag / target, 3);
+            tpLimitLineJerk(tp, &j_max, &tc->coords.line.uvw,
+                    tc->coords.line.uvw.tmag / target, 6);
+            break;
+        case TC_CIRCULAR:
+            j_max = tpGetMachineJerkLimit(tp);
+            tpLimitLineJerk(tp, &j_max, &tc->coords.circle.abc,
+                    tc->coords.circle.abc.tmag / target, 3);
+            tpLimitLineJerk(tp, &j_max, &tc->coords.circle.uvw,
+                    tc->coords.circle.uvw.tmag / target, 6);
+            break;
+        case TC_SPLINE:
+            j_max = tpGetMachineJerkLimit(tp);
+            tpLimitLineJerk(tp, &j_max, &tc->coords.spline.abc,
+                    tc->coords.spline.abc.tmag / target, 3);
+            tpLimitLineJerk(tp, &j_max, &tc->coords.spline.uvw,
+                    tc->coords.spline.uvw.tmag / target, 6);
+            break;
+        case TC_SPHERICAL:
+            j_max = tpGetMachineJerkLimit(tp);
+            break;
+        default:
+            break;
+    }
+    return j_max;
+}
+
+/**
+ * Curvature of a segment, the highest one along splines. Used for the step
+ * in normal acceleration where segments join tangentially.
+ */
+STATIC double tpGetSegmentCurvature(TC_STRUCT const * const tc)
+{
+    switch (tc->motion_type) {
+        case TC_CIRCULAR:
+            return 1.0 / rtapi_fmax(pmCircleEffectiveMinRadius(&tc->coords.circle.xyz),
+                    TP_POS_EPSILON);
+        case TC_SPHERICAL:
+            return 1.0 / rtapi_fmax(tc->coords.arc.xyz.radius, TP_POS_EPSILON);
+        case TC_SPLINE:
+            return tc->coords.spline.xyz.max_curvature;
+        default:
+            return 0.0;
+    }
+}
+
 STATIC int tpGetMachineActiveLimit(double * const act_limit, PmCartesian const * const bounds) {
     if (!act_limit) {
         return TP_ERR_FAIL;
@@ -316,13 +436,64 @@ STATIC inline double tpGetScaledAccel(TP_STRUCT const * const tp,
     if (tc->term_cond == TC_TERM_COND_PARABOLIC || tc->blend_prev) {
         a_scale *= 0.5;
     }
-    if (tc->motion_type == TC_CIRCULAR || tc->motion_type == TC_SPHERICAL) {
+    if (tc->motion_type == TC_CIRCULAR || tc->motion_type == TC_SPHERICAL ||
+            tc->motion_type == TC_SPLINE) {
         //Limit acceleration for cirular arcs to allow for normal acceleration
         a_scale *= BLEND_ACC_RATIO_TANGENTIAL;
     }
     return a_scale;
 }
 
+/**
+ * Get jerk limit for a tc, 0 if the tc's acceleration is not jerk limited.
+ */
+STATIC inline double tpGetScaledJerk(TP_STRUCT const * const tp,
+        TC_STRUCT const * const tc) {
+    // Spindle synced motion has to follow the spindle
+    if (tc->synchronized || tc->motion_type == TC_RIGIDTAP) {
+        return 0.0;
+    }
+    double j_scale = tpGetSegmentJerkLimit(tp, tc);
+    // Same split as the acceleration for parabolic blends and curves, where
+    // the turning normal acceleration takes the rest
+    if (tc->term_cond == TC_TERM_COND_PARABOLIC || tc->blend_prev) {
+        j_scale *= 0.5;
+    }
+    if (tc->motion_type == TC_CIRCULAR || tc->motion_type == TC_SPHERICAL ||
+            tc->motion_type == TC_SPLINE) {
+        j_scale *= BLEND_ACC_RATIO_TANGENTIAL;
+    }
+    return j_scale;
+}
+
+/**
+ * Jerk left for the normal acceleration of curves and the steps in it at
+ * tangent junctions. Unlike the acceleration the two parts are not split by
+ * BLEND_ACC_RATIO_NORMAL, they add up on an axis which sees both.
+ */
+STATIC inline double tpGetNormalJerkLimit(TP_STRUCT const * const tp)
+{
+    return tpGetMachineJerkLimit(tp) * (1.0 - BLEND_ACC_RATIO_TANGENTIAL);
+}
+
+/**
+ * Highest velocity at a tangent junction for the jerk limit. The normal
+ * acceleration steps by v^2 times the change in curvature within a cycle,
+ * e.g. where a line runs into an arc. Curvatures are added since the two
+ * may bend to opposite sides.
+ */
+STATIC double tpGetJunctionJerkVel(TP_STRUCT const * const tp,
+        TC_STRUCT const * const prev_tc, TC_STRUCT const * const tc)
+{
+    double j_max = tpGetNormalJerkLimit(tp);
+    double dk = tpGetSegmentCurvature(prev_tc) + tpGetSegmentCurvature(tc);
+
+    if (j_max <= 0.0 || dk < TP_POS_EPSILON) {
+        return TP_BIG_NUM;
+    }
+    return pmSqrt(j_max * tp->cycleTime / dk);
+}
+
 /**
  * Cap velocity based on trajectory properties
  */
@@ -408,6 +579,7 @@ int tpClear(TP_STRUCT * const tp)
     tcqInit(&tp->queue);
     tp->queueSize = 0;
     tp->goalPos = tp->currentPos;
+    tp->goalJointsValid = 0;
     tp->nextId = 0;
     tp->execId = 0;
     tp->motionType = 0;
@@ -620,6 +792,7 @@ int tpSetPos(TP_STRUCT * const tp, EmcPose const * const pos)
     }
 
     tp->goalPos = *pos;
+    tp->goalJointsValid = 0;
     return TP_ERR_OK;
 }
 
@@ -719,8 +892,10 @@ STATIC double tpCalculateTriangleVel(TP_STRUCT const * const tp, TC_STRUCT * con
 STATIC double tpCalculateOptimizationInitialVel(TP_STRUCT const * const tp, TC_STRUCT * const tc)
 {
     double acc_scaled = tpGetScaledAccel(tp, tc);
+    double jerk_scaled = tpGetScaledJerk(tp, tc);
     //FIXME this is defined in two places!
-    double triangle_vel = pmSqrt( acc_scaled * tc->target * BLEND_DIST_FRACTION);
+    double triangle_vel = findSCurveVStart(0.0, acc_scaled, jerk_scaled,
+            tc->target * BLEND_DIST_FRACTION / 2.0);
     double max_vel = tpGetMaxTargetVel(tp, tc);
     tp_debug_print("optimization initial vel for segment %d is %f\n", tc->id, triangle_vel);
     return rtapi_fmin(triangle_vel, max_vel);
@@ -878,6 +1053,7 @@ STATIC int tpCreateLineArcBlend(TP_STRUCT * const tp, TC_STRUCT * const prev_tc,
         return TP_ERR_FAIL;
     }
 
+    param.j_max = tpGetNormalJerkLimit(tp);
     int res_param = blendComputeParameters(&param);
 
     int res_points = blendFindPoints3(&points_approx, &geom, &param);
@@ -1042,6 +1218,7 @@ STATIC int tpCreateArcLineBlend(TP_STRUCT * const tp, TC_STRUCT * const prev_tc,
         return TP_ERR_FAIL;
     }
 
+    param.j_max = tpGetNormalJerkLimit(tp);
     int res_param = blendComputeParameters(&param);
 
     int res_points = blendFindPoints3(&points_approx, &geom, &param);
@@ -1200,8 +1377,7 @@ STATIC int tpCreateArcArcBlend(TP_STRUCT * const tp, TC_STRUCT * const prev_tc,
         return TP_ERR_FAIL;
     }
 
-
-
+    param.j_max = tpGetNormalJerkLimit(tp);
     int res_param = blendComputeParameters(&param);
     int res_points = blendFindPoints3(&points_approx, &geom, &param);
     
@@ -1346,6 +1522,7 @@ STATIC int tpCreateLineLineBlend(TP_STRUCT * const tp, TC_STRUCT * const prev_tc
         return res_init;
     }
 
+    param.j_max = tpGetNormalJerkLimit(tp);
     int res_blend = blendComputeParameters(&param);
     if (res_blend != TP_ERR_OK) {
         return res_blend;
@@ -1512,8 +1689,10 @@ int tpAddRigidTap(TP_STRUCT * const tp,
     prev_tc = tcqLast(&tp->queue);
     tcFinalizeLength(prev_tc);
     tcFlagEarlyStop(prev_tc, &tc);
+    // not joint limit checked, the next segment seeds from the commanded joints
+    tp->goalJointsValid = 0;
     int retval = tpAddSegmentToQueue(tp, &tc, true);
-    tpRunOptimization(tp);
+    tpRunOptimization(tp, 1);
     return retval;
 }
 
@@ -1571,9 +1750,11 @@ STATIC int tpComputeOptimalVelocity(TP_STRUCT const * const tp, TC_STRUCT * cons
     //Calculate the maximum starting velocity vs_back of segment tc, given the
     //trajectory parameters
     double acc_this = tpGetScaledAccel(tp, tc);
+    double jerk_this = tpGetScaledJerk(tp, tc);
 
     // Find the reachable velocity of tc, moving backwards in time
-    double vs_back = pmSqrt(pmSq(tc->finalvel) + 2.0 * acc_this * tc->target);
+    double vs_back = findSCurveVStart(tc->finalvel, acc_this, jerk_this,
+            tc->target);
     // Find the reachable velocity of prev1_tc, moving forwards in time
 
     double vf_limit_this = tc->maxvel;
@@ -1583,6 +1764,9 @@ STATIC int tpComputeOptimalVelocity(TP_STRUCT const * const tp, TC_STRUCT * cons
     }
     //Limit the PREVIOUS velocity by how much we can overshoot into
     double vf_limit = rtapi_fmin(vf_limit_this, vf_limit_prev);
+    if (prev1_tc->term_cond == TC_TERM_COND_TANGENT) {
+        vf_limit = rtapi_fmin(vf_limit, tpGetJunctionJerkVel(tp, prev1_tc, tc));
+    }
 
     if (vs_back >= vf_limit ) {
         //If we've hit the requested velocity, then prev_tc is definitely a "peak"
@@ -1608,8 +1792,10 @@ STATIC int tpComputeOptimalVelocity(TP_STRUCT const * const tp, TC_STRUCT * cons
  * final velocity. The depth we walk along the queue is controlled by the
  * TP_LOOKAHEAD_DEPTH constant for now. The process safetly aborts early due to
  * a short queue or other conflicts.
+ * new_entries is the number of queue entries added since the last pass. All
+ * of them are visited, a batch longer than the lookahead depth included.
  */
-STATIC int tpRunOptimization(TP_STRUCT * const tp) {
+STATIC int tpRunOptimization(TP_STRUCT * const tp, int new_entries) {
     // Pointers to the "current", previous, and 2nd previous trajectory
     // components. Current in this context means the segment being optimized,
     // NOT the currently excecuting segment.
@@ -1624,12 +1810,17 @@ STATIC int tpRunOptimization(TP_STRUCT * const tp) {
     int hit_peaks = 0;
     // Flag that says we've hit at least 1 non-tangent segment
     bool hit_non_tangent = false;
+    // Reach the segment before the new ones, they may change its final velocity
+    int depth = get_arcBlendOptDepth(tp->shared);
+    if (depth < new_entries + 1) {
+        depth = new_entries + 1;
+    }
 
     /* Starting at the 2nd to last element in the queue, work backwards towards
      * the front. We can't do anything with the very last element because its
      * length may change if a new line is added to the queue.*/
 
-    for (x = 1; x < get_arcBlendOptDepth(tp->shared) + 2; ++x) {
+    for (x = 1; x < depth + 2; ++x) {
         tp_info_print("==== Optimization step %d ====\n",x);
 
         // Update the pointers to the trajectory segments in use
@@ -1689,6 +1880,7 @@ STATIC int tpRunOptimization(TP_STRUCT * const tp) {
             tp_debug_print("Segment %d, type %d not finalized, continuing\n",tc->id,tc->motion_type);
             // use worst-case final velocity that allows for up to 1/2 of a segment to be consumed.
             prev1_tc->finalvel = rtapi_fmin(prev1_tc->maxvel, tpCalculateOptimizationInitialVel(tp,tc));
+            prev1_tc->finalvel = rtapi_fmin(prev1_tc->finalvel, tpGetJunctionJerkVel(tp, prev1_tc, tc));
             tc->finalvel = 0.0;
         } else {
             tpComputeOptimalVelocity(tp, tc, prev1_tc);
@@ -1699,7 +1891,8 @@ STATIC int tpRunOptimization(TP_STRUCT * const tp) {
         if (tc->optimization_state == TC_OPTIM_AT_MAX) {
             hit_peaks++;
         }
-        if (hit_peaks > TP_OPTIMIZATION_CUTOFF) {
+        // the new segments have no final velocity yet, don't stop early
+        if (hit_peaks > TP_OPTIMIZATION_CUTOFF && x > new_entries) {
             return TP_ERR_OK;
         }
 #endif
@@ -1811,7 +2004,8 @@ STATIC int tpSetupTangent(TP_STRUCT const * const tp,
     //FIXME this ratio is arbitrary, should be more easily tunable
     double acc_scale_max = pmCartAbsMax(&acc_scale);
     //KLUDGE lumping a few calculations together here
-    if (prev_tc->motion_type == TC_CIRCULAR || tc->motion_type == TC_CIRCULAR) {
+    if (prev_tc->motion_type == TC_CIRCULAR || tc->motion_type == TC_CIRCULAR ||
+            prev_tc->motion_type == TC_SPLINE || tc->motion_type == TC_SPLINE) {
         acc_scale_max /= BLEND_ACC_RATIO_TANGENTIAL;
     }
 
@@ -1911,14 +2105,130 @@ STATIC int tpHandleBlendArc(TP_STRUCT * const tp, TC_STRUCT * const tc) {
     return TP_ERR_OK;
 }
 
+/**
+ * Lower a segment's maximum velocity and acceleration to what the joints can do.
+ * The segment is sampled at TP_JOINT_CHECK_SAMPLES + 1 points which are run
+ * through the inverse kinematics in one batch. Finite differences give the
+ * joint motion per unit path length q' and its rate of change q'', so at path
+ * velocity v and acceleration a joint j moves at q' * v and accelerates at
+ * q' * a + q'' * v^2. maxvel is lowered until no joint exceeds its velocity
+ * limit and the q'' term takes at most half of the joint's acceleration
+ * limit, maxaccel to what is left of it.
+ * This is done once when the segment is queued, the result is kept in the
+ * segment so the realtime cycle does not repeat the work. The joints at the
+ * end of the segment are kept in goalJoints: when the next segment starts
+ * there, they are its first sample and seed the kinematics, rather than the
+ * commanded joints which lag the queue end.
+ */
+STATIC int tpCheckJointLimits(TP_STRUCT * const tp, TC_STRUCT * const tc)
+{
+    double vel_limit[EMCMOT_MAX_JOINTS];
+    double acc_limit[EMCMOT_MAX_JOINTS];
+    double d1[EMCMOT_MAX_JOINTS];
+    double d2[EMCMOT_MAX_JOINTS];
+    EmcPose world[TP_JOINT_CHECK_SAMPLES + 1];
+    double joints[(TP_JOINT_CHECK_SAMPLES + 1) * EMCMOT_MAX_JOINTS];
+    const int n = TP_JOINT_CHECK_SAMPLES + 1;
+    const int stride = EMCMOT_MAX_JOINTS;
+    int i, j, first;
+
+    int num_joints = getJointLimits(tp->shared, vel_limit, acc_limit);
+    if (num_joints <= 0 || tc->target < TP_POS_EPSILON) {
+        tp->goalJointsValid = 0;
+        return TP_ERR_NO_ACTION;
+    }
+    if (num_joints > EMCMOT_MAX_JOINTS) {
+        num_joints = EMCMOT_MAX_JOINTS;
+    }
+
+    double ds = tc->target / TP_JOINT_CHECK_SAMPLES;
+    for (i = 0; i < n; ++i) {
+        tc->progress = ds * i;
+        tcGetPos(tc, &world[i]);
+    }
+    tc->progress = 0.0;
+
+    first = 0;
+    if (tp->goalJointsValid) {
+        EmcPose gap;
+        double mag;
+        emcPoseSub(&world[0], &tp->goalJointsPos, &gap);
+        emcPoseMagnitude(&gap, &mag);
+        if (mag < TP_POS_EPSILON) {
+            for (j = 0; j < stride; ++j) {
+                joints[j] = tp->goalJoints[j];
+            }
+            first = 1;
+        }
+    }
+
+    int res_kins = kinsInverseBatch(tp->shared, first ? tp->goalJoints : NULL,
+            &world[first], &joints[first * stride], n - first, stride);
+    if (res_kins < n - first) {
+        // Out of reach, left to the soft limit checks in motion
+        tp_debug_print("joint limit check: kins failed at sample %d\n",
+                res_kins + first);
+        tp->goalJointsValid = 0;
+        return TP_ERR_FAIL;
+    }
+    for (j = 0; j < stride; ++j) {
+        tp->goalJoints[j] = joints[(n - 1) * stride + j];
+    }
+    tp->goalJointsPos = world[n - 1];
+    tp->goalJointsValid = 1;
+
+    for (j = 0; j < num_joints; ++j) {
+        d1[j] = 0.0;
+        d2[j] = 0.0;
+        for (i = 1; i < n; ++i) {
+            double dq = joints[i * stride + j] - joints[(i - 1) * stride + j];
+            d1[j] = rtapi_fmax(d1[j], rtapi_fabs(dq) / ds);
+            if (i < n - 1) {
+                double ddq = joints[(i + 1) * stride + j] - 2.0 * joints[i * stride + j]
+                    + joints[(i - 1) * stride + j];
+                d2[j] = rtapi_fmax(d2[j], rtapi_fabs(ddq) / (ds * ds));
+            }
+        }
+    }
+
+    double maxvel = tc->maxvel;
+    double maxaccel = tc->maxaccel;
+    for (j = 0; j < num_joints; ++j) {
+        if (vel_limit[j] <= 0.0 || acc_limit[j] <= 0.0) {
+            continue;
+        }
+        if (d1[j] > TP_VEL_EPSILON) {
+            maxvel = rtapi_fmin(maxvel, vel_limit[j] / d1[j]);
+        }
+        if (d2[j] > TP_VEL_EPSILON) {
+            maxvel = rtapi_fmin(maxvel, pmSqrt(0.5 * acc_limit[j] / d2[j]));
+        }
+    }
+    for (j = 0; j < num_joints; ++j) {
+        if (vel_limit[j] <= 0.0 || acc_limit[j] <= 0.0 || d1[j] <= TP_VEL_EPSILON) {
+            continue;
+        }
+        maxaccel = rtapi_fmin(maxaccel,
+                (acc_limit[j] - d2[j] * maxvel * maxvel) / d1[j]);
+    }
+
+    tp_debug_print("joint limit check: maxvel %f -> %f, maxaccel %f -> %f\n",
+            tc->maxvel, maxvel, tc->maxaccel, maxaccel);
+    tc->kins_maxaccel = maxaccel;
+    tc->maxvel = maxvel;
+    tc->maxaccel = maxaccel;
+    return TP_ERR_OK;
+}
+
 //TODO final setup steps as separate functions
 //
 /**
  * Add a straight line to the tc queue.
  * end of the previous move to the new end specified here at the
  * currently-active accel and vel settings from the tp struct.
+ * The speed optimization is left to the caller, see tpAddSegments.
  */
-int tpAddLine(TP_STRUCT * const tp, EmcPose end, int canon_motion_type, double vel, double
+STATIC int tpQueueLine(TP_STRUCT * const tp, EmcPose end, int canon_motion_type, double vel, double
         ini_maxvel, double acc, unsigned char enables, char atspeed, int indexrotary, struct state_tag_t tag) {
 
     if (tpErrorCheck(tp) < 0) {
@@ -1959,6 +2269,7 @@ int tpAddLine(TP_STRUCT * const tp, EmcPose end, int canon_motion_type, double v
     }
     tc.nominal_length = tc.target;
     tcClampVelocityByLength(&tc);
+    tpCheckJointLimits(tp, &tc);
 
     // For linear move, set rotary axis settings 
     tc.indexrotary = indexrotary;
@@ -1974,11 +2285,7 @@ int tpAddLine(TP_STRUCT * const tp, EmcPose end, int canon_motion_type, double v
     tcFinalizeLength(prev_tc);
     tcFlagEarlyStop(prev_tc, &tc);
 
-    int retval = tpAddSegmentToQueue(tp, &tc, true);
-    //Run speed optimization (will abort safely if there are no tangent segments)
-    tpRunOptimization(tp);
-
-    return retval;
+    return tpAddSegmentToQueue(tp, &tc, true);
 }
 
 
@@ -1991,8 +2298,9 @@ int tpAddLine(TP_STRUCT * const tp, EmcPose end, int canon_motion_type, double v
  * see pmCircleInit for further details on how arcs are specified. Note that
  * degenerate arcs/circles are not allowed. We are guaranteed to have a move in
  * xyz so the target is always the circle/arc/helical length.
+ * The speed optimization is left to the caller, see tpAddSegments.
  */
-int tpAddCircle(TP_STRUCT * const tp,
+STATIC int tpQueueCircle(TP_STRUCT * const tp,
         EmcPose end,
         PmCartesian center,
         PmCartesian normal,
@@ -2049,12 +2357,15 @@ int tpAddCircle(TP_STRUCT * const tp,
     tcClampVelocityByLength(&tc);
 
     double v_max_actual = pmCircleActualMaxVel(&tc.coords.circle.xyz, ini_maxvel, acc, false);
+    v_max_actual = jerkActualMaxVel(tpGetSegmentCurvature(&tc), v_max_actual,
+            tpGetNormalJerkLimit(tp));
 
     // Copy in motion parameters
     tcSetupMotion(&tc,
             vel,
             v_max_actual,
             acc);
+    tpCheckJointLimits(tp, &tc);
 
     TC_STRUCT *prev_tc;
     prev_tc = tcqLast(&tp->queue);
@@ -2068,13 +2379,243 @@ int tpAddCircle(TP_STRUCT * const tp,
     tcFinalizeLength(prev_tc);
     tcFlagEarlyStop(prev_tc, &tc);
 
-    int retval = tpAddSegmentToQueue(tp, &tc, true);
+    return tpAddSegmentToQueue(tp, &tc, true);
+}
+
+
+/**
+ * Adds a cubic spline move from the end of the last move to this new
+ * position.
+ *
+ * @param end is the xyz/abc point of the destination.
+ * @param ctrl1, ctrl2 are the inner Bezier control points of the XYZ
+ * curve, ABC and UVW move linearly along it.
+ *
+ * The whole curve is one segment, its maximum velocity is limited by the
+ * highest curvature along it. Blend arcs are not created next to splines,
+ * they are joined tangentially or by parabolic blends.
+ * The speed optimization is left to the caller, see tpAddSegments.
+ */
+STATIC int tpQueueSpline(TP_STRUCT * const tp,
+        EmcPose end,
+        PmCartesian ctrl1,
+        PmCartesian ctrl2,
+        int canon_motion_type,
+        double vel,
+        double ini_maxvel,
+        double acc,
+        unsigned char enables,
+        char atspeed,
+        struct state_tag_t tag)
+{
+    if (tpErrorCheck(tp)<0) {
+        return TP_ERR_FAIL;
+    }
+
+    tp_info_print("== AddSpline ==\n");
+
+    TC_STRUCT tc = {0};
+
+    tcInit(&tc,
+            TC_SPLINE,
+            canon_motion_type,
+            tp->cycleTime,
+            enables,
+            atspeed);
+    tc.tag = tag;
+    // Setup any synced IO for this move
+    tpSetupSyncedIO(tp, &tc);
+
+    // Copy over state data from the trajectory planner
+    tcSetupState(&tc, tp);
+
+    // Setup spline geometry
+    int res_init = pmSpline9Init(&tc.coords.spline,
+            &tp->goalPos,
+            &end,
+            &ctrl1,
+            &ctrl2);
+    if (res_init) return res_init;
+
+    tc.target = pmSpline9Target(&tc.coords.spline);
+    if (tc.target < TP_POS_EPSILON) {
+        return TP_ERR_ZERO_LENGTH;
+    }
+    tp_debug_print("tc.target = %f\n",tc.target);
+    tc.nominal_length = tc.target;
+
+    //Reduce max velocity to match sample rate
+    tcClampVelocityByLength(&tc);
+
+    double v_max_actual = splineActualMaxVel(&tc.coords.spline.xyz, ini_maxvel, acc, false);
+    v_max_actual = jerkActualMaxVel(tpGetSegmentCurvature(&tc), v_max_actual,
+            tpGetNormalJerkLimit(tp));
+
+    // Copy in motion parameters
+    tcSetupMotion(&tc,
+            vel,
+            v_max_actual,
+            acc);
+    tpCheckJointLimits(tp, &tc);
+
+    TC_STRUCT *prev_tc;
+    prev_tc = tcqLast(&tp->queue);
+
+    tpCheckCanonType(prev_tc, &tc);
+    if (get_arcBlendEnable(tp->shared)){
+        tpHandleBlendArc(tp, &tc);
+    }
+    tcCheckLastParabolic(&tc, prev_tc);
+    tcFinalizeLength(prev_tc);
+    tcFlagEarlyStop(prev_tc, &tc);
+
+    return tpAddSegmentToQueue(tp, &tc, true);
+}
 
-    tpRunOptimization(tp);
+
+/**
+ * Add a batch of lines, arcs and splines to the queue.
+ * Each segment is set up and blended with the one before it as by the
+ * single segment calls, but the speed optimization runs once at the end over
+ * all of them, instead of once per segment.
+ * Stops at the first segment which can't be queued and returns its error,
+ * the ones before it stay queued. If added is not NULL, it is set to the
+ * number of segments queued.
+ */
+int tpAddSegments(TP_STRUCT * const tp,
+        tp_segment_t const * const segs,
+        int count,
+        int * const added)
+{
+    int len_start = tcqLen(&tp->queue);
+    int retval = TP_ERR_OK;
+    int i;
+
+    for (i = 0; i < count; ++i) {
+        tp_segment_t const * const seg = &segs[i];
+
+        tp->nextId = seg->id;
+        switch (seg->type) {
+            case TC_LINEAR:
+                retval = tpQueueLine(tp, seg->end, seg->canon_motion_type,
+                        seg->vel, seg->ini_maxvel, seg->acc, seg->enables,
+                        seg->atspeed, seg->indexrotary, seg->tag);
+                break;
+            case TC_CIRCULAR:
+                retval = tpQueueCircle(tp, seg->end, seg->center,
+                        seg->normal, seg->turn, seg->canon_motion_type,
+                        seg->vel, seg->ini_maxvel, seg->acc, seg->enables,
+                        seg->atspeed, seg->tag);
+                break;
+            case TC_SPLINE:
+                retval = tpQueueSpline(tp, seg->end, seg->ctrl1, seg->ctrl2,
+                        seg->canon_motion_type, seg->vel, seg->ini_maxvel,
+                        seg->acc, seg->enables, seg->atspeed, seg->tag);
+                break;
+            default:
+                rtapi_print_msg(RTAPI_MSG_ERR,
+                        "can't add segment of type %d in a batch\n", seg->type);
+                retval = TP_ERR_INPUT_TYPE;
+                break;
+        }
+        if (retval != TP_ERR_OK) {
+            break;
+        }
+    }
+    if (added) {
+        *added = i;
+    }
+
+    //Run speed optimization (will abort safely if there are no tangent segments)
+    int new_entries = tcqLen(&tp->queue) - len_start;
+    if (new_entries > 0) {
+        tpRunOptimization(tp, new_entries);
+    }
     return retval;
 }
 
 
+int tpAddLine(TP_STRUCT * const tp, EmcPose end, int canon_motion_type, double vel, double
+        ini_maxvel, double acc, unsigned char enables, char atspeed, int indexrotary, struct state_tag_t tag) {
+    tp_segment_t seg = {0};
+
+    seg.type = TC_LINEAR;
+    seg.id = tp->nextId;
+    seg.end = end;
+    seg.canon_motion_type = canon_motion_type;
+    seg.vel = vel;
+    seg.ini_maxvel = ini_maxvel;
+    seg.acc = acc;
+    seg.enables = enables;
+    seg.atspeed = atspeed;
+    seg.indexrotary = indexrotary;
+    seg.tag = tag;
+    return tpAddSegments(tp, &seg, 1, NULL);
+}
+
+
+int tpAddCircle(TP_STRUCT * const tp,
+        EmcPose end,
+        PmCartesian center,
+        PmCartesian normal,
+        int turn,
+        int canon_motion_type,
+        double vel,
+        double ini_maxvel,
+        double acc,
+        unsigned char enables,
+        char atspeed,
+        struct state_tag_t tag)
+{
+    tp_segment_t seg = {0};
+
+    seg.type = TC_CIRCULAR;
+    seg.id = tp->nextId;
+    seg.end = end;
+    seg.center = center;
+    seg.normal = normal;
+    seg.turn = turn;
+    seg.canon_motion_type = canon_motion_type;
+    seg.vel = vel;
+    seg.ini_maxvel = ini_maxvel;
+    seg.acc = acc;
+    seg.enables = enables;
+    seg.atspeed = atspeed;
+    seg.tag = tag;
+    return tpAddSegments(tp, &seg, 1, NULL);
+}
+
+
+int tpAddSpline(TP_STRUCT * const tp,
+        EmcPose end,
+        PmCartesian ctrl1,
+        PmCartesian ctrl2,
+        int canon_motion_type,
+        double vel,
+        double ini_maxvel,
+        double acc,
+        unsigned char enables,
+        char atspeed,
+        struct state_tag_t tag)
+{
+    tp_segment_t seg = {0};
+
+    seg.type = TC_SPLINE;
+    seg.id = tp->nextId;
+    seg.end = end;
+    seg.ctrl1 = ctrl1;
+    seg.ctrl2 = ctrl2;
+    seg.canon_motion_type = canon_motion_type;
+    seg.vel = vel;
+    seg.ini_maxvel = ini_maxvel;
+    seg.acc = acc;
+    seg.enables = enables;
+    seg.atspeed = atspeed;
+    seg.tag = tag;
+    return tpAddSegments(tp, &seg, 1, NULL);
+}
+
+
 /**
  * Adjusts blend velocity and acceleration to safe limits.
  * If we are blending between tc and nexttc, then we need to figure out what a
@@ -2188,6 +2729,7 @@ STATIC int tcUpdateDistFromAccel(TC_STRUCT * const tc, double acc, double vel_de
         tc->progress += displacement;
         clip_max(&tc->progress,tc->target);
     }
+    tc->currentacc = (v_next - tc->currentvel) / rtapi_fmax(tc->cycle_time, TP_TIME_EPSILON);
     tc->currentvel = v_next;
 
     // Check if we can make the desired velocity
@@ -2290,6 +2832,143 @@ void tpCalculateTrapezoidalAccel(TP_STRUCT const * const tp,
     *vel_desired = maxnewvel;
 }
 
+/**
+ * Distance by which the S-curve stop, starting with an acceleration for this
+ * cycle, runs past the end of the segment. Negative if it stops in time.
+ */
+STATIC double tcGetSCurveOvershoot(TC_STRUCT const * const tc,
+        double acc,
+        double v_final,
+        double a_max,
+        double j_max)
+{
+    double dt = tc->cycle_time;
+    double v_next = tc->currentvel + acc * dt;
+    double dx_next = tc->target - tc->progress -
+        (tc->currentvel + v_next) * 0.5 * dt;
+
+    // Keep half a cycle of travel in hand for the discrete steps
+    return findSCurveStopDistance(v_next, acc, v_final, a_max, j_max) -
+        (dx_next - 0.5 * v_next * dt);
+}
+
+/**
+ * Velocity reached by easing off to zero acceleration at the jerk limit,
+ * starting with an acceleration for this cycle.
+ */
+STATIC double tcGetSCurveEaseVel(TC_STRUCT const * const tc,
+        double acc,
+        double j_max)
+{
+    return tc->currentvel + acc * tc->cycle_time +
+        acc * rtapi_fabs(acc) / (2.0 * j_max);
+}
+
+/**
+ * Check an acceleration for this cycle against the S-curve limits.
+ * @return 0 if the acceleration is fine, 1 if the velocity ends up above
+ * v_target once the acceleration is ramped back to zero, 2 if there is not
+ * enough distance left to slow down to v_final.
+ */
+STATIC int tcCheckSCurveAccel(TC_STRUCT const * const tc,
+        double acc,
+        double v_target,
+        double v_final,
+        double a_max,
+        double j_max)
+{
+    if (tcGetSCurveOvershoot(tc, acc, v_final, a_max, j_max) > 0.0) {
+        return 2;
+    }
+    if (tcGetSCurveEaseVel(tc, acc, j_max) > v_target + TP_VEL_EPSILON) {
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Compute acceleration for a timestep based on a jerk limited ("S-curve")
+ * motion profile.
+ *
+ * The acceleration may change by at most j_max * dt each cycle. Of the
+ * accelerations in that range, the highest one is used that passes
+ * tcCheckSCurveAccel. The trapezoidal profile brakes as late as possible, so
+ * the acceleration is never above it, and it takes over when the jerk limited
+ * profile has crept to a standstill short of the end.
+ */
+STATIC void tpCalculateSCurveAccel(TP_STRUCT const * const tp,
+        TC_STRUCT * const tc,
+        TC_STRUCT const * const nexttc,
+        double j_max,
+        double * const acc,
+        double * const vel_desired)
+{
+    double acc_trapz;
+    tpCalculateTrapezoidalAccel(tp, tc, nexttc, &acc_trapz, vel_desired);
+    tc_debug_print("using S-curve acceleration\n");
+
+    double tc_target_vel = tpGetRealTargetVel(tp, tc);
+    double tc_finalvel = tpGetRealFinalVel(tp, tc, nexttc);
+    double a_max = tpGetScaledAccel(tp, tc);
+    double dt = rtapi_fmax(tc->cycle_time, TP_TIME_EPSILON);
+
+    double acc_lo = rtapi_fmax(tc->currentacc - j_max * dt, -a_max);
+    double acc_hi = rtapi_fmin(tc->currentacc + j_max * dt, a_max);
+    double acc_ease = acc_hi;
+    int i;
+
+    if (!tcCheckSCurveAccel(tc, acc_hi, tc_target_vel, tc_finalvel, a_max, j_max)) {
+        *acc = acc_hi;
+    } else {
+        switch (tcCheckSCurveAccel(tc, acc_lo, tc_target_vel, tc_finalvel, a_max, j_max)) {
+            case 2:
+                // Too late by the discrete steps, mostly where the braking
+                // has to ease off again. Brake as hard as the jerk limit
+                // allows, the check below eases off at v_final.
+                *acc = acc_lo;
+                break;
+            case 1:
+                // Above the target velocity (e.g. feed override went down),
+                // slow down as quickly as the jerk limit allows
+                *acc = acc_lo;
+                break;
+            default:
+                for (i = 0; i < TP_SCURVE_BISECTIONS; ++i) {
+                    double acc_mid = (acc_lo + acc_hi) / 2.0;
+                    if (tcCheckSCurveAccel(tc, acc_mid, tc_target_vel,
+                                tc_finalvel, a_max, j_max)) {
+                        acc_hi = acc_mid;
+                    } else {
+                        acc_lo = acc_mid;
+                    }
+                }
+                *acc = acc_lo;
+        }
+    }
+
+    // The stop distance drifts by the discrete steps, near the end of the
+    // segment it would keep braking below v_final. Ease off no later than
+    // needed to come out at v_final instead.
+    if (*acc < 0.0 && *acc < acc_ease && tc_finalvel > TP_VEL_EPSILON &&
+            tcGetSCurveEaseVel(tc, *acc, j_max) < tc_finalvel) {
+        acc_lo = *acc;
+        acc_hi = rtapi_fmin(acc_ease, 0.0);
+        for (i = 0; i < TP_SCURVE_BISECTIONS; ++i) {
+            double acc_mid = (acc_lo + acc_hi) / 2.0;
+            if (tcGetSCurveEaseVel(tc, acc_mid, j_max) < tc_finalvel) {
+                acc_lo = acc_mid;
+            } else {
+                acc_hi = acc_mid;
+            }
+        }
+        *acc = acc_hi;
+    }
+
+    if (*acc > acc_trapz || tc->currentvel + *acc * dt < 0.5 * j_max * pmSq(dt)) {
+        *acc = acc_trapz;
+    }
+}
+
 /**
  * Calculate "ramp" acceleration for a cycle.
  */
@@ -2603,6 +3282,7 @@ STATIC int tpHandleAbort(TP_STRUCT * const tp, TC_STRUCT * const tc,
             (tc->currentvel == 0.0 && (!nexttc || nexttc->currentvel == 0.0))) {
         tcqInit(&tp->queue);
         tp->goalPos = tp->currentPos;
+        tp->goalJointsValid = 0;
         tp->done = 1;
         tp->depth = tp->activeDepth = 0;
         tp->aborting = 0;
@@ -2907,9 +3587,27 @@ STATIC int tpUpdateCycle(TP_STRUCT * const tp,
         res_accel = tpCalculateRampAccel(tp, tc, nexttc, &acc, &vel_desired);
     }
 
+    double j_max = tpGetScaledJerk(tp, tc);
+
     // Check the return in case the ramp calculation failed, fall back to trapezoidal
     if (res_accel != TP_ERR_OK) {
-        tpCalculateTrapezoidalAccel(tp, tc, nexttc, &acc, &vel_desired);
+        if (j_max > 0.0) {
+            tpCalculateSCurveAccel(tp, tc, nexttc, j_max, &acc, &vel_desired);
+        } else {
+            tpCalculateTrapezoidalAccel(tp, tc, nexttc, &acc, &vel_desired);
+        }
+    } else if (j_max > 0.0) {
+        // The ramp acceleration is nearly constant, only limit how fast we
+        // get there
+        acc = tc->currentacc + saturate(acc - tc->currentacc, j_max * tc->cycle_time);
+    }
+
+    // The normal acceleration steps across a tangent junction into or out of
+    // a curve, it takes half of the jerk in the cycles which see the step
+    if (j_max > 0.0 && tc->curvature_step > 0) {
+        acc = tc->currentacc + saturate(acc - tc->currentacc,
+                (1.0 - BLEND_ACC_RATIO_TANGENTIAL) * j_max * tc->cycle_time);
+        tc->curvature_step--;
     }
 
     tcUpdateDistFromAccel(tc, acc, vel_desired);
@@ -3008,6 +3706,32 @@ STATIC int tpCheckEndCondition(
 
 
     double v_f = tpGetRealFinalVel(tp, tc, nexttc);
+
+    if (tpGetScaledJerk(tp, tc) > 0.0) {
+        // A jerk limited segment can't jump to v_f, carry on with the
+        // current acceleration to the end so the next segment picks up
+        // both the velocity and the acceleration.
+        double v = tc->currentvel;
+        double a = tc->currentacc;
+        double disc = pmSq(v) + 2.0 * a * dx;
+        double dt;
+        if (disc < 0.0 || (v < TP_VEL_EPSILON && a <= 0.0)) {
+            return TP_ERR_NO_ACTION;
+        }
+        if (rtapi_fabs(a) > TP_ACCEL_EPSILON) {
+            dt = (pmSqrt(disc) - v) / a;
+        } else {
+            dt = dx / v;
+        }
+        if (dt < TP_TIME_EPSILON) {
+            tc->progress = tc->target;
+            tcSetSplitCycle(tc, 0.0, v);
+        } else if (dt < tp->cycleTime) {
+            tcSetSplitCycle(tc, dt, v + a * dt);
+        }
+        return TP_ERR_OK;
+    }
+
     double v_avg = (tc->currentvel + v_f) / 2.0;
 
     //Check that we have a non-zero "average" velocity between now and the
@@ -3124,14 +3848,25 @@ STATIC int tpHandleSplitCycle(TP_STRUCT * const tp, TC_STRUCT * const tc,
     switch (tc->term_cond) {
         case TC_TERM_COND_TANGENT:
             nexttc->cycle_time = tp->cycleTime - tc->cycle_time;
+            // hand over the acceleration the segment ends with, that of the
+            // split part of the cycle
+            if (tc->cycle_time > TP_TIME_EPSILON) {
+                tc->currentacc = (tc->term_vel - tc->currentvel) / tc->cycle_time;
+            }
             nexttc->currentvel = tc->term_vel;
+            nexttc->currentacc = tc->currentacc;
+            if (tpGetSegmentCurvature(tc) != tpGetSegmentCurvature(nexttc)) {
+                // the split cycle and the next one
+                nexttc->curvature_step = 2;
+            }
             tp_debug_print("Doing tangent split\n");
             break;
         case TC_TERM_COND_PARABOLIC:
+            // nexttc is already moving with its own acceleration
             break;
         case TC_TERM_COND_STOP:
-            break;
         case TC_TERM_COND_EXACT:
+            nexttc->currentacc = 0.0;
             break;
         default:
             rtapi_print_msg(RTAPI_MSG_ERR,"unknown term cond %d in segment %d\n",
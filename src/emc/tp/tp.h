@@ -67,6 +67,21 @@ typedef int (*tpAddCircle_t)(TP_STRUCT * tp,
 			     unsigned char enables,
 			     char atspeed,
 			    struct state_tag_t tag);
+typedef int (*tpAddSpline_t)(TP_STRUCT * tp,
+			     EmcPose end,
+			     PmCartesian ctrl1,
+			     PmCartesian ctrl2,
+			     int type,
+			     double vel,
+			     double ini_maxvel,
+			     double acc,
+			     unsigned char enables,
+			     char atspeed,
+			    struct state_tag_t tag);
+typedef int (*tpAddSegments_t)(TP_STRUCT * tp,
+			       tp_segment_t const * segs,
+			       int count,
+			       int * added);
 typedef int (*tpRunCycle_t)(TP_STRUCT * tp, long period);
 typedef int (*tpPause_t)(TP_STRUCT * tp);
 typedef int (*tpResume_t)(TP_STRUCT * tp);
@@ -93,6 +108,8 @@ typedef int (*tpSnapshot_t)(TP_STRUCT * from, TP_STRUCT * to);
 
 
 // the tp API vtable
+// VTTP_VERSION1 ends after tcqFull, tpAddSpline and tpAddSegments came
+// with VTTP_VERSION2
 typedef struct {
     tpCreate_t          tpCreate;
     tpClear_t           tpClear;
@@ -128,6 +145,8 @@ typedef struct {
     tpIsPaused_t	tpIsPaused;
     tpSnapshot_t	tpSnapshot;
     tcqFull_t           tcqFull;
+    tpAddSpline_t	tpAddSpline;
+    tpAddSegments_t	tpAddSegments;
 } vtp_t;
 
 
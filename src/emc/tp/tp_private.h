@@ -1,6 +1,6 @@
 // signatures of the - formerly exposed extern - methods of the tp
 // these are used internally only now, and to populate the tp vtable
-// in tpmain.c
+// in tpmain.c, or in a program linking the tp itself (rs274time)
 
 #ifndef TP_PRIVATE_H
 #define TP_PRIVATE_H
@@ -10,6 +10,10 @@
 #include "tp_types.h"
 #include "tcq.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 int tpCreate(TP_STRUCT * tp, int _queueSize, TC_STRUCT * tcSpace,  tp_shared_t *shared);
 
 int tpClear(TP_STRUCT * tp);
@@ -52,6 +56,13 @@ int tpAddCircle(TP_STRUCT * tp, EmcPose end, PmCartesian center,
 		PmCartesian normal, int turn, int type, double vel, double ini_maxvel,
 		double acc, unsigned char enables, char atspeed,struct state_tag_t tag);
 
+int tpAddSpline(TP_STRUCT * tp, EmcPose end, PmCartesian ctrl1,
+		PmCartesian ctrl2, int type, double vel, double ini_maxvel,
+		double acc, unsigned char enables, char atspeed,struct state_tag_t tag);
+
+int tpAddSegments(TP_STRUCT * tp, tp_segment_t const * segs, int count,
+		  int * added);
+
 int tpRunCycle(TP_STRUCT * tp, long period);
 
 int tpPause(TP_STRUCT * tp);
@@ -83,4 +94,8 @@ int tpIsPaused(TP_STRUCT * tp);
 
 int tpSnapshot(TP_STRUCT * from, TP_STRUCT * to);
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif // TP_PRIVATE_H
@@ -11,6 +11,17 @@ typedef void (*emcmotAioWrite_t)(unsigned int index, hal_float_t value);
 typedef void (*emcmotSetRotaryUnlock_t)(int axis, hal_bit_t unlock);
 typedef hal_bit_t  (*emcmotGetRotaryIsUnlocked_t)(int axis);
 
+// joint limits for the queue time joint space check: fill in the
+// velocity and acceleration limit per joint, return the number of
+// joints to check or 0 if the check is not wanted (e.g. identity kins)
+typedef int (*emcmotGetJointLimits_t)(double *vel_limit, double *acc_limit);
+// run n poses through the inverse kinematics, see vtk_inverse_batch()
+// in kinematics.h. The first point starts from the joint set seed, or
+// from the commanded joint positions if seed is NULL.
+typedef int (*emcmotKinsInverseBatch_t)(const double *seed,
+					const EmcPose *world, double *joints,
+					int n, int stride);
+
 
 // this holds all shared data between using code and the tp
 // data items can be pins if so desired,
@@ -33,6 +44,7 @@ typedef struct tp_shared_t {
     hal_float_t *net_feed_scale;
 
     hal_float_t *acc_limit[3];
+    hal_float_t *jerk_limit[9]; // per axis in EmcPose order, 0 = none
     hal_float_t *vel_limit[3];
 
     hal_bit_t  *stepping;
@@ -65,6 +77,10 @@ typedef struct tp_shared_t {
     emcmotSetRotaryUnlock_t SetRotaryUnlock;
     emcmotGetRotaryIsUnlocked_t GetRotaryIsUnlocked;
 
+    // upcalls by the tp into the kinematics, may be NULL
+    emcmotGetJointLimits_t GetJointLimits;
+    emcmotKinsInverseBatch_t KinsInverseBatch;
+
 } tp_shared_t;
 
 static inline int get_num_dio(tp_shared_t *ts)  { return *(ts->num_dio); }
@@ -78,6 +94,11 @@ static inline hal_float_t get_acc_limit(tp_shared_t *ts, int n)
 static inline void set_acc_limit(tp_shared_t *ts, int n, hal_float_t val)
 { *(ts->acc_limit[n]) = val; }
 
+static inline hal_float_t get_jerk_limit(tp_shared_t *ts, int n)
+{ return *(ts->jerk_limit[n]); }
+static inline void set_jerk_limit(tp_shared_t *ts, int n, hal_float_t val)
+{ *(ts->jerk_limit[n]) = val; }
+
 static inline hal_float_t get_vel_limit(tp_shared_t *ts, int n)
 { return *(ts->vel_limit[n]); }
 static inline void set_vel_limit(tp_shared_t *ts, int n, hal_float_t val)
@@ -150,6 +171,13 @@ static inline void dioWrite(tp_shared_t *ts, unsigned int index, char value)
 static inline void aioWrite(tp_shared_t *ts, unsigned int index, double value)
 { if (ts->aioWrite) ts->aioWrite(index, value); }
 
+static inline int getJointLimits(tp_shared_t *ts, double *vel_limit, double *acc_limit)
+{ return ts->GetJointLimits ? ts->GetJointLimits(vel_limit, acc_limit) : 0; }
+static inline int kinsInverseBatch(tp_shared_t *ts, const double *seed,
+				   const EmcPose *world,
+				   double *joints, int n, int stride)
+{ return ts->KinsInverseBatch ? ts->KinsInverseBatch(seed, world, joints, n, stride) : 0; }
+
 static inline hal_float_t get_spindleRevs(tp_shared_t *ts)
 { return *(ts->spindleRevs); }
 static inline void set_spindleRevs(tp_shared_t *ts, hal_float_t n)
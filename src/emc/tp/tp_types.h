@@ -19,7 +19,7 @@
 #include "tc_types.h"
 #include "tcq.h"
 
-#if defined(BUILD_SYS_USER_DSO)
+#if defined(BUILD_SYS_USER_DSO) || defined(ULAPI)
 #include <stdbool.h>
 #endif
 
@@ -48,6 +48,12 @@
 #define TP_MIN_ARC_LENGTH 1e-6
 #define TP_BIG_NUM 1e10
 
+/* number of intervals a segment is split into for the joint limit check */
+#define TP_JOINT_CHECK_SAMPLES 16
+
+/* bisection steps for the jerk limited acceleration of a cycle */
+#define TP_SCURVE_BISECTIONS 12
+
 /**
  * TP return codes.
  * This enum is a catch-all for useful return statuses from TP
@@ -85,6 +91,30 @@ typedef struct {
      int waiting_for_atspeed;
 } tp_spindle_t;
 
+/**
+ * One segment of a batch given to tpAddSegments.
+ * The fields match the arguments of tpAddLine, tpAddCircle and tpAddSpline,
+ * those of the other segment types are ignored.
+ */
+typedef struct {
+    tc_motion_type_t type;      // TC_LINEAR, TC_CIRCULAR or TC_SPLINE
+    int id;                     // as set by tpSetId for a single segment
+    EmcPose end;
+    PmCartesian center;         // TC_CIRCULAR
+    PmCartesian normal;         // TC_CIRCULAR
+    int turn;                   // TC_CIRCULAR
+    PmCartesian ctrl1;          // TC_SPLINE
+    PmCartesian ctrl2;          // TC_SPLINE
+    int canon_motion_type;
+    double vel;
+    double ini_maxvel;
+    double acc;
+    unsigned char enables;
+    char atspeed;
+    int indexrotary;            // TC_LINEAR
+    struct state_tag_t tag;
+} tp_segment_t;
+
 typedef struct tp_shared_t tp_shared_t; // see tp_shared.h
 
 /**
@@ -100,6 +130,12 @@ typedef struct {
     EmcPose currentPos;
     EmcPose goalPos;
 
+    /* joints at goalJointsPos, the end of the last segment through the
+       joint limit check, which seeds the check of the next one */
+    double goalJoints[EMCMOT_MAX_JOINTS];
+    EmcPose goalJointsPos;
+    int goalJointsValid;
+
     int queueSize;
     double cycleTime;
 
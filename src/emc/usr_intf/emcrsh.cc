@@ -2833,6 +2833,8 @@ int main(int argc, char *argv[])
     // get configuration information
     iniLoad(emc_inifile);
     initSockets();
+    // get requests only peek the status if task changed it
+    emcStatusSkipUnchanged = 1;
     // init NML
     if (tryNml() != 0) {
 	rcs_print_error("can't connect to emc\n");
@@ -34,6 +34,7 @@
 #include "rcs_print.hh"
 #include "nml_oi.hh"
 #include "timer.hh"
+#include "emcstatmirror.hh"	// EmcStatMirror
 
 /*
   Using halui:
@@ -410,6 +411,9 @@ static RCS_CMD_CHANNEL *emcCommandBuffer = 0;
 static RCS_STAT_CHANNEL *emcStatusBuffer = 0;
 EMC_STAT *emcStatus = 0;
 
+// tells which parts of emcStatus changed, if task provides it
+static EmcStatMirror emcStatMirror;
+
 // the NML channel for errors
 static NML *emcErrorBuffer = 0;
 
@@ -454,6 +458,7 @@ static int emcTaskNmlGet()
 	    retval = -1;
 	} else {
 	    emcStatus = (EMC_STAT *) emcStatusBuffer->get_address();
+	    emcStatMirror.attach();
 	}
     }
 
@@ -2249,15 +2254,28 @@ int main(int argc, char *argv[])
     /* catch SIGTERM too - the run script uses it to shut things down */
     signal(SIGTERM, quit);
 
+    unsigned changed = EMC_STAT_ALL;
+    hal_u32_t joint_selected = *(halui_data->joint_selected);
+
     while (!done) {
 
 	check_hal_changes(); //if anything changed send NML messages
 
-	modify_hal_pins(); //if status changed modify HAL too
-	
+	// if status changed modify HAL too. The selected joint
+	// pins also follow halui.joint.selected.
+	if (changed || (joint_selected != *(halui_data->joint_selected))) {
+	    joint_selected = *(halui_data->joint_selected);
+	    modify_hal_pins();
+	}
+
 	esleep(0.02); //sleep for a while
-	
-	updateStatus();
+
+	// without a status mirror from task, this is always EMC_STAT_ALL
+	if (!emcStatMirror.attached())
+	    emcStatMirror.attach();
+	changed = emcStatMirror.changed(EMC_STAT_ALL);
+	if (changed)
+	    updateStatus();
     }
     thisQuit();
     return 0;
@@ -35,6 +35,7 @@
 #include "rcs_print.hh"
 #include "timer.hh"             // esleep
 #include "shcom.hh"             // Common NML communications functions
+#include "emcstatmirror.hh"     // EmcStatMirror
 
 LINEAR_UNIT_CONVERSION linearUnitConversion;
 ANGULAR_UNIT_CONVERSION angularUnitConversion;
@@ -47,6 +48,10 @@ RCS_CMD_CHANNEL *emcCommandBuffer;
 RCS_STAT_CHANNEL *emcStatusBuffer;
 EMC_STAT *emcStatus;
 
+// tells whether emcStatus changed at all, if task provides it
+static EmcStatMirror emcStatMirror;
+int emcStatusSkipUnchanged = 0;
+
 // the NML channel for errors
 NML *emcErrorBuffer;
 char error_string[NML_ERROR_LEN];
@@ -97,6 +102,8 @@ int emcTaskNmlGet()
 	    retval = -1;
 	} else {
 	    emcStatus = (EMC_STAT *) emcStatusBuffer->get_address();
+	    if (emcStatusSkipUnchanged)
+		emcStatMirror.attach();
 	}
     }
 
@@ -181,6 +188,12 @@ int updateStatus()
 	return -1;
     }
 
+    // nothing but heartbeats changed since the last peek: the copy
+    // we have is current. Without the mirror this always peeks.
+    if (!emcStatMirror.changed(EMC_STAT_ALL)) {
+	return 0;
+    }
+
     switch (type = emcStatusBuffer->peek()) {
     case -1:
 	// error on CMS channel
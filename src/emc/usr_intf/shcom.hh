@@ -72,6 +72,11 @@ enum EMC_UPDATE_TYPE {
 };
 extern EMC_UPDATE_TYPE emcUpdateType;
 
+// if set before tryNml(), updateStatus() skips the NML peek while task
+// reports no change other than heartbeats (see emcstatmirror.hh).
+// The heartbeat fields of emcStatus are then not current.
+extern int emcStatusSkipUnchanged;
+
 enum EMC_WAIT_TYPE {
     EMC_WAIT_NONE = 1,
     EMC_WAIT_RECEIVED,
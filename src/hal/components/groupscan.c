@@ -0,0 +1,146 @@
+/********************************************************************
+* Description:  groupscan.c
+*               Scans a HAL group for changes on behalf of all users
+*               of the group.
+*
+* License: GPL Version 2
+*
+* Copyright (c) 2016 All rights reserved.
+*
+********************************************************************/
+/** Every user of a group - haltalk, a python script, a logger - compiles
+    it and then scans the member signals for changes on its own. With an
+    instance of groupscan attached, the scan is done once, in a thread
+    function, and the compiled groups only look at the result of that
+    scan (see hal_group_scan() in hal_group.c).
+
+    newinst groupscan <name> group=<group> [period=<ms>]
+
+    exports the function <name>.funct, which scans the group every
+    period ms of thread time. period defaults to the timer of the group,
+    0 scans on every invocation. The funct should run in a thread after
+    the functs writing the members.
+
+    Output pins:
+
+    <name>.changed   (s32) members found changed in the last scan
+    <name>.scans     (u32) scans done
+
+    Deleting the instance detaches the scanner, users of the group then
+    go back to scanning themselves.
+*/
+
+#include "rtapi.h"
+#include "rtapi_app.h"
+#include "hal.h"
+#include "hal_priv.h"
+#include "hal_group.h"
+
+MODULE_DESCRIPTION("shared change detection for HAL groups");
+MODULE_LICENSE("GPL");
+RTAPI_TAG(HAL, HC_INSTANTIABLE);
+
+static int comp_id;
+static char *compname = "groupscan";
+
+struct inst_data {
+    hal_group_scan_t *scan;
+    long long period;		// ns
+    long long next;		// thread time of the next scan
+    s32_pin_ptr changed;
+    u32_pin_ptr scans;
+    char group[HAL_NAME_LEN + 1];
+};
+
+static char *group = NULL;
+RTAPI_IP_STRING(group, "the group to scan");
+
+static int period = -1;
+RTAPI_IP_INT(period, "scan period in ms, default: the group timer");
+
+static int funct(void *arg, const hal_funct_args_t *fa)
+{
+    struct inst_data *ip = arg;
+    long long now = fa_start_time(fa);
+    int n;
+
+    if (now < ip->next)
+	return 0;
+    ip->next = now + ip->period;
+
+    n = hal_group_scan(ip->scan);
+    if (n < 0)
+	return n;
+    set_s32_pin(ip->changed, n);
+    set_u32_pin(ip->scans, get_u32_pin(ip->scans) + 1);
+    return 0;
+}
+
+static int instantiate(const int argc, char* const *argv)
+{
+    const char *name = argv[1];
+    struct inst_data *ip;
+    hal_group_t *grp;
+    int inst_id, ms, retval;
+
+    if (group == NULL)
+	HALFAIL_RC(EINVAL, "%s: %s: group= missing", compname, name);
+
+    inst_id = hal_inst_create(name, comp_id, sizeof(struct inst_data),
+			      (void **)&ip);
+    if (inst_id < 0)
+	return -1;
+
+    {
+	WITH_HAL_MUTEX();
+	grp = halpr_find_group_by_name(group);
+	if (grp == NULL)
+	    HALFAIL_RC(ENOENT, "%s: %s: no such group '%s'",
+		       compname, name, group);
+	ms = (period < 0) ? grp->userarg1 : period;
+	if ((retval = halg_group_share(0, group, &ip->scan)) < 0)
+	    return retval;
+    }
+    rtapi_snprintf(ip->group, sizeof(ip->group), "%s", group);
+    ip->period = ms * 1000000LL;
+    ip->next = 0;
+
+    ip->changed = halx_pin_s32_newf(HAL_OUT, inst_id, "%s.changed", name);
+    ip->scans = halx_pin_u32_newf(HAL_OUT, inst_id, "%s.scans", name);
+    if (hal_errorcount(0))
+	return -EINVAL;
+
+    hal_export_xfunct_args_t xfunct_args = {
+        .type = FS_XTHREADFUNC,
+        .funct.x = funct,
+        .arg = ip,
+        .uses_fp = 1,
+        .reentrant = 0,
+        .owner_id = inst_id
+    };
+    return hal_export_xfunctf(&xfunct_args, "%s.funct", name);
+}
+
+// called after the funct was removed from its thread
+static int delete(const char *name, void *inst, const int inst_size)
+{
+    struct inst_data *ip = inst;
+
+    if (ip->scan == NULL)
+	return 0;
+    return halg_group_unshare(1, ip->group);
+}
+
+int rtapi_app_main(void)
+{
+    comp_id = hal_xinit(TYPE_RT, 0, 0, instantiate, delete, compname);
+    if (comp_id < 0)
+	return comp_id;
+    hal_ready(comp_id);
+    return 0;
+}
+
+void rtapi_app_exit(void)
+{
+    hal_exit(comp_id);
+}
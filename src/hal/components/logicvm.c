@@ -0,0 +1,297 @@
+/********************************************************************
+* Description:  logicvm.c
+*               Runs a HAL logic sub-net compiled to bytecode by
+*               the halcmd 'lcompile' command.
+*
+* License: GPL Version 2
+*
+* Copyright (c) 2016 All rights reserved.
+*
+********************************************************************/
+/** A sub-net of small logic instances - and2, or2, mux4, comp, ... -
+    costs one funct call per instance, each reading and writing its
+    pins. lcompile translates such a sub-net into the bytecode of
+    hal_logicvm.h, and one instance of logicvm runs it in a single
+    funct, keeping intermediate values in registers. The pins and
+    signals of the replaced instances are still written.
+
+    Instances are created by lcompile:
+
+    newinst logicvm <name> code=<insns> regs=<regs> insts=<n>
+                    [fp=0|1] [verify=0|1]
+
+    and export the function <name>.funct, which does nothing until
+    lcompile has filled in the code.
+
+    With verify=1 the stores only compare the computed values with the
+    pins, for running next to the interpreted instances.
+
+    The compiled instances stay referenced until the logicvm instance
+    is deleted. Once any pin is linked or unlinked the registers may no
+    longer match the nets, and the funct stops until lcompile is run
+    again.
+
+    Output pins:
+
+    <name>.mismatches  (u32) verify: stores which differed from the pin
+    <name>.stale       (u32) cycles not run since a link changed
+*/
+
+#include "rtapi.h"
+#include "rtapi_app.h"
+#include "hal.h"
+#include "hal_priv.h"
+#include "hal_accessor.h"
+#include "hal_logicvm.h"
+
+MODULE_DESCRIPTION("bytecode evaluator for compiled HAL logic");
+MODULE_LICENSE("GPL");
+RTAPI_TAG(HAL, HC_INSTANTIABLE);
+
+#define MAX_LOGGED 10		// verify: mismatches logged per instance
+
+static int comp_id;
+static char *compname = "logicvm";
+
+static int code = 0;
+RTAPI_IP_INT(code, "room for instructions");
+
+static int regs = 0;
+RTAPI_IP_INT(regs, "room for registers");
+
+static int fp = 1;
+RTAPI_IP_INT(fp, "the funct uses floating point");
+
+static int verify = 0;
+RTAPI_IP_INT(verify, "compare the stores with the pins instead of writing");
+
+static int insts = 0;
+RTAPI_IP_INT(insts, "room for the ids of the compiled instances");
+
+static void store(hal_lvm_t *vm, const hal_lvm_insn_t *insn,
+		  const hal_data_u *r)
+{
+    hal_pin_t *pin = SHMPTR(insn->arg);
+    hal_data_u *u = pin_value(pin);
+    bool same;
+
+    switch (insn->r[1]) {
+    case HAL_BIT:
+	same = (u->_b == r->_b);
+	break;
+    case HAL_S32:
+	same = (u->_s == r->_s);
+	break;
+    case HAL_U32:
+	same = (u->_u == r->_u);
+	break;
+    case HAL_FLOAT:
+	same = (u->_f == r->_f);
+	break;
+    default:
+	return;
+    }
+    if (same)
+	return;
+
+    if (vm->verify) {
+	set_u32_pin(vm->mismatches, get_u32_pin(vm->mismatches) + 1);
+	if (vm->logged < MAX_LOGGED) {
+	    vm->logged++;
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+			    "%s: %s differs from the interpreted value%s",
+			    compname, ho_name(pin),
+			    vm->logged == MAX_LOGGED ? " (not logging more)" : "");
+	}
+	return;
+    }
+    switch (insn->r[1]) {
+    case HAL_BIT:
+	u->_b = r->_b;
+	break;
+    case HAL_S32:
+	u->_s = r->_s;
+	break;
+    case HAL_U32:
+	u->_u = r->_u;
+	break;
+    case HAL_FLOAT:
+	u->_f = r->_f;
+	break;
+    }
+    hal_bump_generation(u);
+}
+
+static int funct(void *arg, const hal_funct_args_t *fa)
+{
+    hal_lvm_t *vm = arg;
+    const hal_lvm_insn_t *insn = lvm_code(vm);
+    const hal_lvm_insn_t *end = insn + vm->n_code;
+    hal_data_u *r = lvm_regs(vm);
+    hal_float_t diff, halfhyst;
+    hal_u32_t bits;
+    int i;
+
+    if (vm->link_generation != hal_data->link_generation) {
+	// registers may no longer match the nets
+	if (vm->n_code && (get_u32_pin(vm->stale) == 0))
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+			    "%s: pins were relinked, not running until "
+			    "compiled again", compname);
+	if (vm->n_code)
+	    set_u32_pin(vm->stale, get_u32_pin(vm->stale) + 1);
+	return 0;
+    }
+    while (insn < end) {
+	const __u16 *o = insn->r;
+
+	switch (insn->op) {
+	case LVM_LD:
+	    r[o[0]] = *pin_value(SHMPTR(insn->arg));
+	    break;
+	case LVM_ST:
+	    store(vm, insn, &r[o[0]]);
+	    break;
+	case LVM_AND:
+	    r[o[0]]._b = r[o[1]]._b && r[o[2]]._b;
+	    break;
+	case LVM_OR:
+	    r[o[0]]._b = r[o[1]]._b || r[o[2]]._b;
+	    break;
+	case LVM_XOR:
+	    r[o[0]]._b = r[o[1]]._b != r[o[2]]._b;
+	    break;
+	case LVM_NOT:
+	    r[o[0]]._b = !r[o[1]]._b;
+	    break;
+	case LVM_PACK:
+	    bits = 0;
+	    for (i = 0; i < insn->arg; i++)
+		if (r[o[i + 1]]._b)
+		    bits |= 1 << i;
+	    r[o[0]]._u = bits;
+	    break;
+	case LVM_MUX:
+	    if (r[o[1]]._u < insn->arg)
+		r[o[0]] = r[lvm_data(insn, r[o[1]]._u)];
+	    insn += (insn->arg + LVM_NREGS - 1) / LVM_NREGS;
+	    break;
+	case LVM_BIT:
+	    r[o[0]]._b = (r[o[1]]._u & (1 << r[o[2]]._u)) != 0;
+	    break;
+	case LVM_SEQ:
+	    r[o[0]]._b = (r[o[1]]._s == insn->arg);
+	    break;
+	case LVM_FMUL:
+	    r[o[0]]._f = r[o[1]]._f * r[o[2]]._f;
+	    break;
+	case LVM_FADD:
+	    r[o[0]]._f = r[o[1]]._f + r[o[2]]._f;
+	    break;
+	case LVM_FLE:
+	    r[o[0]]._b = (r[o[1]]._f <= r[o[2]]._f);
+	    break;
+	case LVM_FGE:
+	    r[o[0]]._b = (r[o[1]]._f >= r[o[2]]._f);
+	    break;
+	case LVM_COMP:
+	    diff = r[o[3]]._f - r[o[2]]._f;
+	    halfhyst = 0.5 * r[o[4]]._f;
+	    if (diff < -halfhyst) {
+		r[o[0]]._b = false;
+		r[o[1]]._b = false;
+	    } else if (diff > halfhyst) {
+		r[o[0]]._b = true;
+		r[o[1]]._b = false;
+	    } else {
+		r[o[1]]._b = true;
+	    }
+	    break;
+	default:
+	    // LVM_DATA is skipped by its instruction
+	    return -EINVAL;
+	}
+	insn++;
+    }
+    return 0;
+}
+
+static int instantiate(const int argc, char* const *argv)
+{
+    const char *name = argv[1];
+    hal_lvm_t *vm;
+    int inst_id;
+
+    if ((code < 1) || (regs < 1) || (insts < 0) ||
+	(code > 0x7fff) || (regs > 0xffff))
+	HALFAIL_RC(EINVAL, "%s: %s: bad code=%d regs=%d insts=%d",
+		   compname, name, code, regs, insts);
+
+    inst_id = hal_inst_create(name, comp_id, lvm_size(code, regs, insts),
+			      (void **)&vm);
+    if (inst_id < 0)
+	return -1;
+
+    vm->n_code = 0;
+    vm->max_code = code;
+    vm->max_regs = regs;
+    vm->verify = verify;
+    vm->code_off = sizeof(hal_lvm_t);
+    vm->regs_off = lvm_regs_off(code);
+    vm->refs_off = lvm_refs_off(code, regs);
+    vm->max_refs = insts;
+    vm->n_refs = 0;
+    vm->link_generation = hal_data->link_generation;
+    vm->logged = 0;
+
+    vm->mismatches = halx_pin_u32_newf(HAL_OUT, inst_id, "%s.mismatches", name);
+    vm->stale = halx_pin_u32_newf(HAL_OUT, inst_id, "%s.stale", name);
+    if (hal_errorcount(0))
+	return -EINVAL;
+
+    hal_export_xfunct_args_t xfunct_args = {
+        .type = FS_XTHREADFUNC,
+        .funct.x = funct,
+        .arg = vm,
+        .uses_fp = fp,
+        .reentrant = 0,
+        .owner_id = inst_id
+    };
+    return hal_export_xfunctf(&xfunct_args, "%s.funct", name);
+}
+
+// release the instances lcompile referenced, called with the HAL
+// mutex released and the funct already gone
+static int delete(const char *name, void *inst, const int inst_size)
+{
+    hal_lvm_t *vm = inst;
+    hal_s32_t *refs = lvm_refs(vm);
+    hal_inst_t *hi;
+    hal_comp_t *comp;
+    int i;
+
+    WITH_HAL_MUTEX();
+    for (i = 0; i < vm->n_refs; i++) {
+	if ((hi = halpr_find_inst_by_id(refs[i])) == NULL)
+	    continue;
+	ho_decref(hi);
+	if ((comp = halpr_find_owning_comp(ho_id(hi))) != NULL)
+	    ho_decref(comp);
+    }
+    vm->n_refs = 0;
+    return 0;
+}
+
+int rtapi_app_main(void)
+{
+    comp_id = hal_xinit(TYPE_RT, 0, 0, instantiate, delete, compname);
+    if (comp_id < 0)
+	return comp_id;
+    hal_ready(comp_id);
+    return 0;
+}
+
+void rtapi_app_exit(void)
+{
+    hal_exit(comp_id);
+}
@@ -3,6 +3,12 @@
 
 from libc.stdint cimport uintptr_t
 
+# HALData.heap_flags bits
+HEAP_TRACE_MALLOC = RTAPIHEAP_TRACE_MALLOC
+HEAP_TRACE_FREE   = RTAPIHEAP_TRACE_FREE
+HEAP_TRIM         = RTAPIHEAP_TRIM
+HEAP_NOSLAB       = RTAPIHEAP_NOSLAB
+
 cdef class HALData:
     def __cinit__(self):
         hal_required()
@@ -58,7 +64,28 @@ cdef class HALData:
             rtapi_heap_status(&hal_data.heap, &rhs)
             return (rhs.total_avail, rhs.fragments, rhs.largest)
 
+    property heap_stats:
+        def __get__(self):
+            cdef rtapi_heap_stat rhs
+            rtapi_heap_status(&hal_data.heap, &rhs)
+            return dict(arena_size=rhs.arena_size,
+                        total_avail=rhs.total_avail,
+                        fragments=rhs.fragments,
+                        largest=rhs.largest,
+                        fragmentation=rhs.fragmentation,
+                        requested=rhs.requested,
+                        allocated=rhs.allocated,
+                        freed=rhs.freed,
+                        slab_inuse=rhs.slab_inuse,
+                        slab_cached=rhs.slab_cached,
+                        slab_chunks=rhs.slab_chunks)
+
     property heap_flags:
+        def __get__(self):
+            # setflags returns the previous value
+            cdef int f = rtapi_heap_setflags(&hal_data.heap, 0)
+            rtapi_heap_setflags(&hal_data.heap, f)
+            return f
         def __set__(self, int f):
             rtapi_heap_setflags(&hal_data.heap,f)
 
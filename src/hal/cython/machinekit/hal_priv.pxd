@@ -28,6 +28,7 @@ cdef extern from "hal_priv.h":
         int data_ptr  # v2
         int signal
         hal_data_u dummysig
+        unsigned int dummygen
         hal_type_t type
         hal_pin_dir_t dir
         int flags
@@ -36,10 +37,13 @@ cdef extern from "hal_priv.h":
     ctypedef struct hal_sig_t:
         halhdr_t hdr
         hal_data_u value
+        unsigned int generation
+        int data_ptr
         hal_type_t type
         int readers
         int writers
         int bidirs
+        int legacy_writers
 
     ctypedef struct hal_param_t:
         halhdr_t hdr
@@ -196,6 +200,12 @@ cdef extern from "hal_priv.h":
     int pin_linked_to(const hal_pin_t *pin, const hal_sig_t *sig)
     bint pin_is_linked(const hal_pin_t *pin)
 
+    # write generation counters
+    unsigned int hal_get_generation(const hal_data_u *u)
+    void hal_bump_generation(hal_data_u *u)
+    bint sig_generation_valid(const hal_sig_t *sig)
+    bint pin_generation_valid(const hal_pin_t *pin)
+
     # test if dir is in [HAL_IN, HAL_OUT, HAL_IO]
     const int hal_valid_dir(const hal_pin_dir_t dir)
 
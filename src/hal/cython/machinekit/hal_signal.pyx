@@ -1,4 +1,5 @@
 from .hal_priv cimport hal_data_u, hal_valid_dir, hal_valid_type
+from .hal_priv cimport hal_get_generation, sig_generation_valid
 from .hal_util cimport hal2py, py2hal, shmptr
 
 cdef int _pin_by_signal_cb(hal_pin_t *pin,
@@ -11,7 +12,6 @@ cdef int _pin_by_signal_cb(hal_pin_t *pin,
 
 cdef class Signal(HALObject):
     cdef int _handle
-    cdef hal_data_u *_storage
 
     def _alive_check(self):
         if self._handle != hh_get_id(&self._o.sig.hdr):
@@ -51,7 +51,6 @@ cdef class Signal(HALObject):
             if self._o.sig == NULL:
                 raise RuntimeError("BUG: couldnt lookup signal %s" % name)
 
-        self._storage = sig_value(self._o.sig)
         self._handle = self.id  # memoize for liveness check
         if init:
             self.set(init)
@@ -101,11 +100,11 @@ cdef class Signal(HALObject):
         if self._o.sig.writers > 0:
             raise RuntimeError("Signal %s already as %d writer(s)" %
                                       (hh_get_name(&self._o.sig.hdr), self._o.sig.writers))
-        return py2hal(self._o.sig.type, self._storage, v)
+        return py2hal(self._o.sig.type, sig_value(self._o.sig), v)
 
     def get(self):
         self._alive_check()
-        return hal2py(self._o.sig.type, self._storage)
+        return hal2py(self._o.sig.type, sig_value(self._o.sig))
 
     def pins(self):
         ''' return a list of Pin objects linked to this signal '''
@@ -160,6 +159,14 @@ cdef class Signal(HALObject):
             self._alive_check()
             return self._o.sig.bidirs
 
+    property generation:
+        ''' write generation of the value, None if a legacy pin writes it '''
+        def __get__(self):
+            self._alive_check()
+            if not sig_generation_valid(self._o.sig):
+                return None
+            return hal_get_generation(sig_value(self._o.sig))
+
 
     def __repr__(self):
         return "<hal.Signal %s %s %s>" % (self.name,
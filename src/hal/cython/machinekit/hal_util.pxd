@@ -5,7 +5,7 @@ from cpython.float cimport PyFloat_Check
 from cpython.bool  cimport bool
 
 from .hal_priv     cimport hal_shmem_base, hal_data_u, hal_pin_t, hal_sig_t, hal_data
-from .hal_priv     cimport pin_type, pin_value, pin_is_linked
+from .hal_priv     cimport pin_type, pin_value, pin_is_linked, hal_bump_generation
 
 from .hal_priv     cimport set_bit_value, set_s32_value, set_u32_value, set_float_value
 from .hal_priv     cimport set_s64_value, set_u64_value
@@ -38,7 +38,7 @@ cdef inline hal2py(int t, hal_data_u *dp):
     else:
         raise RuntimeError("hal2py: invalid type %d" % t)
 
-cdef inline py2hal(int t, hal_data_u *dp, object v):
+cdef inline _py2hal(int t, hal_data_u *dp, object v):
     cdef bint isint,isfloat
 
     isint = PyInt_Check(v)
@@ -66,3 +66,9 @@ cdef inline py2hal(int t, hal_data_u *dp, object v):
     else:
         raise RuntimeError("py2hal: float value not valid for type: %d" % (t))
 
+# set a v2 value, and bump its write generation
+cdef inline py2hal(int t, hal_data_u *dp, object v):
+    rv = _py2hal(t, dp, v)
+    hal_bump_generation(dp)
+    return rv
+
@@ -63,14 +63,24 @@ cdef extern from "rtapi.h":
 cdef extern from "rtapi_heap.h":
     int RTAPIHEAP_TRACE_MALLOC
     int RTAPIHEAP_TRACE_FREE
+    int RTAPIHEAP_TRIM
+    int RTAPIHEAP_NOSLAB
 
     cdef struct rtapi_heap:
         pass
 
     cdef struct rtapi_heap_stat:
+        size_t arena_size
         size_t total_avail
         size_t fragments
         size_t largest
+        size_t requested
+        size_t allocated
+        size_t freed
+        size_t fragmentation
+        size_t slab_inuse
+        size_t slab_cached
+        size_t slab_chunks
 
     ctypedef void (*chunk_t)(size_t size,  void *chunk, void *user)
 
@@ -36,6 +36,18 @@ MSG_INFO = RTAPI_MSG_INFO
 MSG_DBG = RTAPI_MSG_DBG
 MSG_ALL = RTAPI_MSG_ALL
 
+# funct timing policy of a thread, see newthread()
+TT_FULL = HAL_TT_FULL
+TT_TSC = HAL_TT_TSC
+TT_SAMPLED = HAL_TT_SAMPLED
+TT_OFF = HAL_TT_OFF
+
+# funct timing policy of a thread, see newthread()
+TT_FULL = TT_FULL
+TT_TSC = TT_TSC
+TT_SAMPLED = TT_SAMPLED
+TT_OFF = TT_OFF
+
 cdef class mview:
     cdef void *base
     cdef int size
@@ -192,12 +204,13 @@ class RTAPIcommand:
             raise RuntimeError("cant connect to rtapi: %s" % strerror(-r))
 
     def newthread(self,char *name, int period, instance=0, fp=0, cpu=-1,
-                  cgname="", flags=0):
+                  cgname="", flags=0, timing=HAL_TT_FULL, timing_arg=0):
         cdef char *c_name = name
         cdef char *c_cgname = cgname
         if cgname == "":
             c_cgname = NULL
-        r = rtapi_newthread(instance, c_name, period, cpu, cgname, fp, flags)
+        r = rtapi_newthread(instance, c_name, period, cpu, cgname, fp, flags,
+                            timing, timing_arg)
         if r:
             raise RuntimeError("rtapi_newthread failed:  %s" % strerror(-r))
 
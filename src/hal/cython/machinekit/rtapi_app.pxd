@@ -7,7 +7,8 @@ cdef extern from "halcmd_rtapiapp.h":
     int rtapi_shutdown(int instance)
     int rtapi_ping(int instance)
     int rtapi_newthread(int instance, const char *name,
-                        int period, int cpu, char *cgname, int use_fp, int flags)
+                        int period, int cpu, char *cgname, int use_fp, int flags,
+                        int timing, int timing_arg)
     int rtapi_delthread(int instance, const char *name)
     int rtapi_callfunc(int instance, const char *func, const char **args)
     int rtapi_newinst(int instance, const char *comp, const char *instname, const char **args)
@@ -15,3 +16,10 @@ cdef extern from "halcmd_rtapiapp.h":
     void rtapi_cleanup()
 
     const char *rtapi_rpcerror()
+
+cdef extern from "hal_priv.h":
+    ctypedef enum hal_thread_timing_t:
+        HAL_TT_FULL "TT_FULL"
+        HAL_TT_TSC "TT_TSC"
+        HAL_TT_SAMPLED "TT_SAMPLED"
+        HAL_TT_OFF "TT_OFF"
@@ -148,6 +148,42 @@ void hal_typefailure(const char *file,
 
 #endif
 
+// write generation counter which follows every v2 hal_data_u, see
+// sig_generation_valid()/pin_generation_valid() in hal_priv.h.
+// there is a single writer per value, so a plain load+store is
+// sufficient; release ordering makes the new value visible before
+// the new generation.
+static inline __u32 *hal_generation(const hal_data_u *u) {
+    return (__u32 *)(u + 1);
+}
+static inline __u32 hal_get_generation(const hal_data_u *u) {
+    return __atomic_load_n(hal_generation(u), __ATOMIC_ACQUIRE);
+}
+static inline void hal_bump_generation(hal_data_u *u) {
+    __u32 *g = hal_generation(u);
+    __atomic_store_n(g, *g + 1, __ATOMIC_RELEASE);
+}
+
+// change tracking by generation: remembers which value was looked at
+// (it changes on link/unlink) and its generation at that time.
+typedef struct {
+    shmoff_t source;
+    __u32 generation;
+} hal_gentrack_t;
+
+// true if u is the same value as last time and has not been written since.
+// updates the tracking slot otherwise.
+static inline bool hal_generation_unchanged(hal_gentrack_t *t,
+					    const hal_data_u *u) {
+    shmoff_t source = hal_off(u);
+    __u32 gen = hal_get_generation(u);
+    if ((t->source == source) && (t->generation == gen))
+	return true;
+    t->source = source;
+    t->generation = gen;
+    return false;
+}
+
 // export context-independent setters which are strongly typed,
 // and context-dependent accessors with a descriptor argument,
 // and an optional runtime type check
@@ -159,7 +195,10 @@ void hal_typefailure(const char *file,
     hal_data_u *u =							\
 	(hal_data_u *)hal_ptr(pin->data_ptr);				\
     _CHECK(pin_type(pin), OTYPE);					\
-    SETTER( pin, ACCESS, value,  CAST);				\
+    if (u->ACCESS != value) {						\
+	SETTER( pin, ACCESS, value,  CAST);				\
+	hal_bump_generation(u);						\
+    }									\
     return value;							\
     }									\
 									\
@@ -208,6 +247,8 @@ PINGETTER(_GETVALUEDOUBLE, float, HAL_FLOAT, f,   _f,  FLOATCAST);
 #define _INCREMENT(U, DESC, TYPE, TAG, VALUE)				\
     TYPE rvalue = __atomic_add_fetch(&U->TAG, VALUE,			\
 				     RTAPI_MEMORY_MODEL);		\
+    if (VALUE)								\
+	hal_bump_generation(U);						\
     if (unlikely(hh_get_wmb(&DESC->hdr)))				\
 	rtapi_smp_wmb();						\
     return rvalue;
@@ -238,7 +279,7 @@ PIN_INCREMENTER(u32, u)
     static inline const hal_##TYPE##_t					\
     _get_##TYPE##_sig(const hal_sig_t *sig) {				\
 	_CHECK(sig_type(sig), OTYPE);					\
-	hal_data_u *u = (hal_data_u*)&sig->value;			\
+	hal_data_u *u = (hal_data_u*)hal_ptr(sig->data_ptr);		\
 	GETTER( sig, _##LETTER, CAST);			\
     }									\
 									\
@@ -263,9 +304,12 @@ SIGGETTER(_GETVALUEDOUBLE, float, HAL_FLOAT, f,   _f,   FLOATCAST);
     static inline const hal_##TYPE##_t					\
     _set_##TYPE##_sig(hal_sig_t *sig,					\
 		      const hal_##TYPE##_t value) {			\
-	hal_data_u *u = &sig->value;					\
+	hal_data_u *u = (hal_data_u*)hal_ptr(sig->data_ptr);		\
 	_CHECK(sig_type(sig), OTYPE);					\
-	SETTER( sig, ACCESS, value,  CAST);			\
+	if (u->ACCESS != value) {					\
+	    SETTER( sig, ACCESS, value,  CAST);			\
+	    hal_bump_generation(u);					\
+	}								\
 	return value;							\
     }									\
 									\
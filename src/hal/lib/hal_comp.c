@@ -562,6 +562,10 @@ int init_hal_data(void)
     hal_data->str_alloc = 0;
     hal_data->str_freed = 0;
     hal_data->rt_alignment_loss = 0;
+    hal_data->layout_free_slots = 0;
+    hal_data->layout_free_lines = 0;
+    hal_data->layout_generation = 0;
+    hal_data->link_generation = 0;
 
     RTAPI_ZERO_BITMAP(&hal_data->rings, HAL_MAX_RINGS);
     RTAPI_BIT_SET(hal_data->rings,0);
@@ -11,6 +11,8 @@
 #include <assert.h>
 #endif
 
+static void free_group_scan(hal_group_t *group);
+
 int halg_group_new(const int use_hal_mutex,const char *name, int arg1, int arg2)
 {
     CHECK_HALDATA();
@@ -33,6 +35,7 @@ int halg_group_new(const int use_hal_mutex,const char *name, int arg1, int arg2)
 
 	group->userarg1 = arg1;
 	group->userarg2 = arg2;
+	group->scan_ptr = 0;
 
 	halg_add_object(false, (hal_object_ptr)group);
 	return 0;
@@ -120,6 +123,9 @@ int halg_member_new(const int use_hal_mutex,const char *group, const char *membe
 	    HALFAIL_RC(EBUSY, "group '%s' already has signal '%s' as member", group, member);
 	}
 
+	// the group is unreferenced, so no scanner is attached
+	free_group_scan(grp);
+
 	HALDBG("adding signal '%s' to group '%s'",  member, group);
 	if ((new = halg_create_objectf(0, sizeof(hal_member_t),
 				       HAL_MEMBER, ho_id(grp), member)) == NULL)
@@ -172,12 +178,239 @@ int halg_member_delete(const int use_hal_mutex,const char *group, const char *me
 	    ho_decref(sig); // permit deletion if 0
 	}
 
+	free_group_scan(grp);
+
 	HALDBG("deleting member '%s' from group '%s'",  member, group);
 	halg_free_object(false, (hal_object_ptr) mptr);
     }
     return 0;
 }
 
+// compare a signal with its tracking value, and update the tracking value
+// if it changed. Returns 1 if changed, 0 if not, < 0 on an invalid type.
+static int track_sig(hal_sig_t *sig, hal_data_u *tracking,
+		     hal_gentrack_t *gentrack, const int eps_index)
+{
+    hal_bit_t halbit;
+    hal_s32_t hals32;
+    hal_u32_t halu32;
+    hal_float_t halfloat,delta;
+
+    // not written since the last scan - skip the value compare
+    if (sig_generation_valid(sig) &&
+	hal_generation_unchanged(gentrack, sig_value(sig)))
+	return 0;
+
+    switch (sig_type(sig)) {
+    case HAL_BIT:
+	halbit = _get_bit_sig(sig);
+	if (get_bit_value(tracking) != halbit) {
+	    set_bit_value(tracking, halbit);
+	    return 1;
+	}
+	break;
+    case HAL_FLOAT:
+	halfloat = _get_float_sig(sig);
+	delta = HAL_FABS(halfloat - get_float_value(tracking));
+	if (delta > hal_data->epsilon[eps_index]) {
+	    set_float_value(tracking, halfloat);
+	    return 1;
+	}
+	break;
+    case HAL_S32:
+	hals32 = _get_s32_sig(sig);
+	if (get_s32_value(tracking) != hals32) {
+	    set_s32_value(tracking, hals32);
+	    return 1;
+	}
+	break;
+    case HAL_U32:
+	halu32 = _get_u32_sig(sig);
+	if (get_u32_value(tracking) != halu32) {
+	    set_u32_value(tracking, halu32);
+	    return 1;
+	}
+	break;
+    default:
+	HALFAIL_RC(EINVAL, "BUG: invalid type for signal %s: %d",
+		   ho_name(sig), sig_type(sig));
+    }
+    return 0;
+}
+
+static inline bool member_monitored(const hal_group_t *group,
+				    const hal_member_t *member)
+{
+    return (member->userarg1 & MEMBER_MONITOR_CHANGE) ||
+	(group->userarg2 & GROUP_MONITOR_ALL_MEMBERS);
+}
+
+// shared scans
+
+// fills in the entries if entry_ptr is set, else just counts
+static int scan_init_cb(hal_object_ptr o, foreach_args_t *args)
+{
+    hal_member_t *member = o.member;
+    hal_group_scan_t *gs = args->user_ptr1;
+    hal_group_t *group  = args->user_ptr2;
+
+    if (member_monitored(group, member)) {
+	if (gs->entry_ptr) {
+	    hal_scan_entry_t *entry = SHMPTR(gs->entry_ptr);
+
+	    entry[gs->n_monitored].sig_ptr = member->sig_ptr;
+	    entry[gs->n_monitored].member_index = gs->n_members;
+	    entry[gs->n_monitored].eps_index = member->eps_index;
+	}
+	gs->n_monitored++;
+    }
+    gs->n_members++;
+    return 0;
+}
+
+// build the scan of a group as one block of shared memory:
+// header, tracking values, generations, entries, stamps.
+// must be called with HAL mutex held
+static hal_group_scan_t *new_group_scan(hal_group_t *group)
+{
+    hal_group_scan_t count = {0}, *gs;
+    size_t hdr, tracking, gentrack, entries, stamps;
+    char *base;
+    int n;
+
+    foreach_args_t args =  {
+	.type = HAL_MEMBER,
+	.owner_id = ho_id(group),
+	.user_ptr1 = &count,
+	.user_ptr2 = group,
+    };
+    halg_foreach(0, &args, scan_init_cb);
+    n = count.n_monitored;
+    if (n == 0) {
+	HALFAIL_NULL(EINVAL, "group '%s' has no members to monitor",
+		     ho_name(group));
+    }
+
+    hdr = RTAPI_ALIGN(sizeof(hal_group_scan_t), 8);
+    tracking = sizeof(hal_data_u) * n;
+    gentrack = RTAPI_ALIGN((sizeof(hal_gentrack_t) * n), 8);
+    entries = sizeof(hal_scan_entry_t) * n;
+    stamps = sizeof(hal_u32_t) * n;
+
+    base = shmalloc_desc_aligned(hdr + tracking + gentrack + entries + stamps, 8);
+    if (base == NULL)
+	return NULL;
+    gs = (hal_group_scan_t *) base;
+    gs->tracking_ptr = SHMOFF(base + hdr);
+    gs->gentrack_ptr = SHMOFF(base + hdr + tracking);
+    gs->entry_ptr = SHMOFF(base + hdr + tracking + gentrack);
+    gs->stamp_ptr = SHMOFF(base + hdr + tracking + gentrack + entries);
+
+    // second pass: fill in the entries
+    args.user_ptr1 = gs;
+    halg_foreach(0, &args, scan_init_cb);
+    HAL_ASSERT(gs->n_monitored == n);
+
+    group->scan_ptr = SHMOFF(gs);
+    HALDBG("group '%s': shared scan of %d/%d members",
+	   ho_name(group), gs->n_monitored, gs->n_members);
+    return gs;
+}
+
+// must be called with HAL mutex held, on an unreferenced group
+static void free_group_scan(hal_group_t *group)
+{
+    if (group->scan_ptr == 0)
+	return;
+    shmfree_desc(SHMPTR(group->scan_ptr));
+    group->scan_ptr = 0;
+}
+
+int halg_group_share(const int use_hal_mutex, const char *name,
+		     hal_group_scan_t **scan)
+{
+    CHECK_HALDATA();
+    CHECK_STRLEN(name, HAL_NAME_LEN);
+
+    HALDBG("sharing group '%s'", name);
+    {
+	WITH_HAL_MUTEX_IF(use_hal_mutex);
+
+	hal_group_scan_t *gs;
+	hal_group_t *group = halpr_find_group_by_name(name);
+	if (group == NULL) {
+	    HALFAIL_RC(ENOENT, "group '%s' not found", name);
+	}
+	if (group->scan_ptr) {
+	    gs = SHMPTR(group->scan_ptr);
+	    if (gs->active) {
+		HALFAIL_RC(EBUSY, "group '%s' already has a scanner", name);
+	    }
+	} else if ((gs = new_group_scan(group)) == NULL) {
+	    return _halerrno;
+	}
+	ho_incref(group); // no member changes while scanned
+	rtapi_store_u32(&gs->active, 1);
+	if (scan)
+	    *scan = gs;
+	return 0;
+    }
+}
+
+int halg_group_unshare(const int use_hal_mutex, const char *name)
+{
+    CHECK_HALDATA();
+    CHECK_STRLEN(name, HAL_NAME_LEN);
+
+    HALDBG("unsharing group '%s'", name);
+    {
+	WITH_HAL_MUTEX_IF(use_hal_mutex);
+
+	hal_group_scan_t *gs;
+	hal_group_t *group = halpr_find_group_by_name(name);
+	if (group == NULL) {
+	    HALFAIL_RC(ENOENT, "group '%s' not found", name);
+	}
+	if (group->scan_ptr == 0) {
+	    HALFAIL_RC(EINVAL, "group '%s' is not shared", name);
+	}
+	gs = SHMPTR(group->scan_ptr);
+	if (!gs->active) {
+	    HALFAIL_RC(EINVAL, "group '%s' has no scanner", name);
+	}
+	// compiled groups fall back to scanning themselves. The scan
+	// itself stays, they may still refer to it.
+	rtapi_store_u32(&gs->active, 0);
+	ho_decref(group);
+	return 0;
+    }
+}
+
+int hal_group_scan(hal_group_scan_t *gs)
+{
+    hal_scan_entry_t *entry = SHMPTR(gs->entry_ptr);
+    hal_data_u *tracking = SHMPTR(gs->tracking_ptr);
+    hal_gentrack_t *gentrack = SHMPTR(gs->gentrack_ptr);
+    hal_u32_t *stamp = SHMPTR(gs->stamp_ptr);
+    hal_u32_t serial = gs->serial + 1;
+    int i, changed, nchanged = 0;
+
+    for (i = 0; i < gs->n_monitored; i++) {
+	changed = track_sig(SHMPTR(entry[i].sig_ptr), &tracking[i],
+			    &gentrack[i], entry[i].eps_index);
+	if (changed < 0)
+	    return changed;
+	if (changed) {
+	    rtapi_store_u32(&stamp[i], serial);
+	    nchanged++;
+	}
+    }
+    // readers which see the new serial see the stamps too
+    if (nchanged)
+	rtapi_store_u32(&gs->serial, serial);
+    return nchanged;
+}
+
 #ifdef ULAPI
 
 static int cgroup_init_members_cb(hal_object_ptr o, foreach_args_t *args)
@@ -188,8 +421,7 @@ static int cgroup_init_members_cb(hal_object_ptr o, foreach_args_t *args)
 
     tc->member[tc->mbr_index] = member;
     tc->mbr_index++;
-    if ((member->userarg1 & MEMBER_MONITOR_CHANGE) ||
-	(group->userarg2 & GROUP_MONITOR_ALL_MEMBERS)) {
+    if (member_monitored(group, member)) {
 	tc->mon_index++;
     }
     return 0;
@@ -202,8 +434,7 @@ static int cgroup_size_cb(hal_object_ptr o, foreach_args_t *args)
     hal_group_t *group  = args->user_ptr2;
 
     tc->n_members++;
-    if ((member->userarg1 & MEMBER_MONITOR_CHANGE) ||
-	(group->userarg2 & GROUP_MONITOR_ALL_MEMBERS))
+    if (member_monitored(group, member))
 	tc->n_monitored++;
     return 0;
 }
@@ -266,6 +497,10 @@ int halpr_group_compile(const char *name, hal_compiled_group_t **cgroup)
 	     malloc(sizeof(hal_data_u) * tc->n_monitored )) == NULL)
 	    NOMEM("allocating tracking values");
 	memset(tc->tracking, 0, sizeof(hal_data_u) * tc->n_monitored);
+	if ((tc->gentrack =
+	     malloc(sizeof(hal_gentrack_t) * tc->n_monitored )) == NULL)
+	    NOMEM("allocating tracking generations");
+	memset(tc->gentrack, 0, sizeof(hal_gentrack_t) * tc->n_monitored);
 	if ((tc->changed =
 	     malloc(RTAPI_BITMAP_BYTES(tc->n_members))) == NULL)
 	    NOMEM("allocating change bitmap");
@@ -274,9 +509,21 @@ int halpr_group_compile(const char *name, hal_compiled_group_t **cgroup)
 	// nothing to track
 	tc->n_monitored = 0;
 	tc->tracking = NULL;
+	tc->gentrack = NULL;
 	tc->changed = NULL;
     }
 
+    // use the shared scan if there is one for this member set
+    tc->scan = NULL;
+    tc->seen_valid = 0;
+    if (grp->scan_ptr && tc->n_monitored) {
+	hal_group_scan_t *gs = SHMPTR(grp->scan_ptr);
+
+	if ((gs->n_members == tc->n_members) &&
+	    (gs->n_monitored == tc->n_monitored))
+	    tc->scan = gs;
+    }
+
     tc->magic = CGROUP_MAGIC;
     tc->group = grp;
     ho_incref(grp);
@@ -287,15 +534,41 @@ int halpr_group_compile(const char *name, hal_compiled_group_t **cgroup)
     return 0;
 }
 
+// derive the changed bitmap from the stamps of the shared scan:
+// a member changed if stamped after the serial seen at the last match.
+// O(1) if the scanner found nothing since.
+// The first match reports the members stamped at all, those which moved
+// off their initial zero like with a scan of its own.
+static int cgroup_match_shared(hal_compiled_group_t *cg)
+{
+    hal_group_scan_t *gs = cg->scan;
+    hal_scan_entry_t *entry = SHMPTR(gs->entry_ptr);
+    hal_u32_t *stamp = SHMPTR(gs->stamp_ptr);
+    hal_u32_t serial = rtapi_load_u32(&gs->serial);
+    hal_u32_t s;
+    int i, nchanged = 0;
+
+    if (cg->seen_valid && (serial == cg->seen))
+	return 0;
+
+    // a change stamped during this walk is reported again next time
+    RTAPI_ZERO_BITMAP(cg->changed, cg->n_members);
+    for (i = 0; i < gs->n_monitored; i++) {
+	s = rtapi_load_u32(&stamp[i]);
+	if (cg->seen_valid ? ((__s32)(s - cg->seen) <= 0) : (s == 0))
+	    continue;
+	RTAPI_BIT_SET(cg->changed, entry[i].member_index);
+	nchanged++;
+    }
+    cg->seen = serial;
+    cg->seen_valid = 1;
+    return nchanged;
+}
+
 int hal_cgroup_match(hal_compiled_group_t *cg)
 {
-    int i, monitor, nchanged = 0, m = 0;
-    hal_object_ptr ho;
-    //    hal_sig_t *sig;
-    hal_bit_t halbit;
-    hal_s32_t hals32;
-    hal_u32_t halu32;
-    hal_float_t halfloat,delta;
+    int i, monitor, changed, nchanged = 0, m = 0;
+    hal_sig_t *sig;
 
     HAL_ASSERT(cg->magic == CGROUP_MAGIC);
 
@@ -307,49 +580,22 @@ int hal_cgroup_match(hal_compiled_group_t *cg)
     // to cause a report, or only changed members should be included in a periodic
     // report.
     if (monitor) {
+	// somebody else does the walking
+	if (cg->scan && rtapi_load_u32(&cg->scan->active))
+	    return cgroup_match_shared(cg);
+
 	RTAPI_ZERO_BITMAP(cg->changed, cg->n_members);
 	for (i = 0; i < cg->n_members; i++) {
-	    if (!((cg->member[i]->userarg1 &  MEMBER_MONITOR_CHANGE) ||
-		  (cg->group->userarg2 &  GROUP_MONITOR_ALL_MEMBERS)))
+	    if (!member_monitored(cg->group, cg->member[i]))
 		continue;
-	    ho.any = SHMPTR(cg->member[i]->sig_ptr);
-	    switch (sig_type(ho.sig)) {
-	    case HAL_BIT:
-		halbit = _get_bit_sig(ho.sig);
-		if (get_bit_value(&cg->tracking[m]) != halbit) {
-		    nchanged++;
-		    RTAPI_BIT_SET(cg->changed, i);
-		    set_bit_value(&cg->tracking[m], halbit);
-		}
-		break;
-	    case HAL_FLOAT:
-		halfloat = _get_float_sig(ho.sig);
-		delta = HAL_FABS(halfloat - get_float_value(&cg->tracking[m]));
-		if (delta > hal_data->epsilon[cg->member[i]->eps_index]) {
-		    nchanged++;
-		    RTAPI_BIT_SET(cg->changed, i);
-		    set_float_value(&cg->tracking[m], halfloat);
-		}
-		break;
-	    case HAL_S32:
-		hals32 = _get_s32_sig(ho.sig);
-		if (get_s32_value(&cg->tracking[m]) != hals32) {
-		    nchanged++;
-		    RTAPI_BIT_SET(cg->changed, i);
-		    set_s32_value(&cg->tracking[m], hals32);
-		}
-		break;
-	    case HAL_U32:
-		halu32 = _get_u32_sig(ho.sig);
-		if (get_u32_value(&cg->tracking[m]) != halu32) {
-		    nchanged++;
-		    RTAPI_BIT_SET(cg->changed, i);
-		    set_u32_value(&cg->tracking[m], halu32);
-		}
-		break;
-	    default:
-		HALFAIL_RC(EINVAL, "BUG: detect_changes(%s): invalid type for signal %s: %d",
-		       ho_name(cg->group), ho_name(ho.sig), sig_type(ho.sig));
+	    sig = SHMPTR(cg->member[i]->sig_ptr);
+	    changed = track_sig(sig, &cg->tracking[m], &cg->gentrack[m],
+				cg->member[i]->eps_index);
+	    if (changed < 0)
+		return changed;
+	    if (changed) {
+		nchanged++;
+		RTAPI_BIT_SET(cg->changed, i);
 	    }
 	    m++;
 	}
@@ -393,6 +639,8 @@ int hal_cgroup_free(hal_compiled_group_t *cgroup)
 	HALFAIL_RC(ENOENT, "null cgroup");
     if (cgroup->tracking)
 	free(cgroup->tracking);
+    if (cgroup->gentrack)
+	free(cgroup->gentrack);
     if (cgroup->changed)
 	free(cgroup->changed);
     if (cgroup->member)
@@ -410,6 +658,7 @@ void free_group_struct(hal_group_t * group)
 	.owner_id = ho_id(group),
     };
     halg_foreach(0, &args, yield_free);
+    free_group_scan(group);
     halg_free_object(false, (hal_object_ptr)group);
 }
 
@@ -13,6 +13,7 @@ typedef struct hal_group {
     halhdr_t hdr;		// common HAL object header
     int userarg1;	        /* interpreted by using layer */
     int userarg2;	        /* interpreted by using layer */
+    int scan_ptr;               // hal_group_scan_t if shared, else 0
 } hal_group_t;
 
 // members are subordinate to a group identified by the group_id
@@ -26,6 +27,33 @@ typedef struct hal_member {
     __u8 eps_index;             // index into haldata->epsilon[]; default 0
 } hal_member_t;
 
+// a shared scan of the monitored members of a group, in HAL shared memory.
+//
+// a scanner (see hal/components/groupscan.c) compares the signals with the
+// tracking values at its own rate, and stamps each member it finds changed
+// with the serial of that scan. Compiled groups of a shared group derive
+// their changed bitmap from the stamps instead of each scanning the
+// signals themselves.
+//
+// the scan is created by halg_group_share() and stays with the group; it
+// is rebuilt when the members change, and freed with the group.
+typedef struct hal_scan_entry {
+    int sig_ptr;                // signal of the monitored member
+    int member_index;           // index into hal_compiled_group_t.member
+    int eps_index;
+} hal_scan_entry_t;
+
+typedef struct hal_group_scan {
+    hal_u32_t serial;           // of the last scan which found changes
+    hal_u32_t active;           // a scanner is attached
+    int n_members;
+    int n_monitored;
+    int entry_ptr;              // hal_scan_entry_t[n_monitored]
+    int tracking_ptr;           // hal_data_u[n_monitored]
+    int gentrack_ptr;           // hal_gentrack_t[n_monitored]
+    int stamp_ptr;              // hal_u32_t[n_monitored], serial of last change
+} hal_group_scan_t;
+
 #define CGROUP_MAGIC  0xbeef7411
 typedef struct hal_compiled_group {
     int magic;
@@ -37,6 +65,10 @@ typedef struct hal_compiled_group {
     unsigned long *changed;      // bitmap
     int n_monitored;             // count of pins to monitor for change
     hal_data_u    *tracking;     // tracking values of monitored pins
+    hal_gentrack_t *gentrack;    // tracking generations of monitored pins
+    hal_group_scan_t *scan;      // shared scan of the group, if any
+    hal_u32_t seen;              // scan serial at the last match
+    int seen_valid;              // seen is set - else report all monitored
     unsigned long user_flags;    // uninterpreted by HAL code
     void *user_data;             // uninterpreted by HAL code
 } hal_compiled_group_t;
@@ -52,6 +84,17 @@ extern int halg_group_delete(const int use_hal_mutex, const char *group);
 extern int halg_member_new(const int use_hal_mutex, const char *group, const char *member, int arg1, int eps_index);
 extern int halg_member_delete(const int use_hal_mutex, const char *group, const char *member);
 
+// attach a scanner to a group: build the shared scan if needed and mark it
+// active. The group is referenced until halg_group_unshare().
+// Fails with EBUSY if the group already has a scanner.
+extern int halg_group_share(const int use_hal_mutex, const char *group,
+			    hal_group_scan_t **scan);
+extern int halg_group_unshare(const int use_hal_mutex, const char *group);
+
+// compare the members with the tracking values, stamp the changed ones.
+// RT-safe; returns the number of changed members.
+extern int hal_group_scan(hal_group_scan_t *scan);
+
 extern int hal_cgroup_report(hal_compiled_group_t *cgroup,
 			     group_report_callback_t report_cb,
 			     void *cb_data, int force_all);
@@ -5,6 +5,7 @@
 #include "hal.h"		/* HAL public API decls */
 #include "hal_priv.h"		/* HAL private decls */
 #include "hal_internal.h"
+#include "rtapi_string.h"
 
 int halg_inst_create(const int use_hal_mutex,
 		     const char *name,
@@ -68,6 +69,25 @@ int halg_inst_create(const int use_hal_mutex,
     }
 }
 
+// the batch functs of a component built with 'option batch'
+// (<comp>.batch, <comp>.<funct>.batch) walk all its instances, so none
+// may go away while one of them is on a thread
+static int yield_batch_funct_on_thread(hal_object_ptr o, foreach_args_t *args)
+{
+    const char *comp = args->user_ptr2;
+    const char *name = ho_name(o.funct);
+    size_t clen = strlen(comp), nlen = strlen(name);
+
+    if (o.funct->users > 0 &&
+	nlen > clen + 6 &&
+	strncmp(name, comp, clen) == 0 && name[clen] == '.' &&
+	strcmp(name + nlen - 6, ".batch") == 0) {
+	args->user_ptr1 = o.any;
+	return 1;  // terminate visit on first match
+    }
+    return 0;
+}
+
 int halg_inst_delete(const int use_hal_mutex, const char *name)
 {
     CHECK_HALDATA();
@@ -81,6 +101,25 @@ int halg_inst_delete(const int use_hal_mutex, const char *name)
 	if ((inst = halg_find_object_by_name(0, HAL_INST, name).inst) == NULL) {
 	    HALFAIL_RC(ENOENT, "instance '%s' does not exist", name);
 	}
+	// eg compiled into a logicvm instance which still uses its pins
+	if (ho_referenced(inst)) {
+	    HALFAIL_RC(EBUSY, "not deleting instance %s - still referenced "
+		       "(refcnt=%d)", name, ho_refcnt(inst));
+	}
+	hal_comp_t *comp = halpr_find_owning_comp(ho_id(inst));
+	if (comp != NULL) {
+	    foreach_args_t args =  {
+		.type = HAL_FUNCT,
+		.owner_id = ho_id(comp),
+		.user_ptr2 = (void *) ho_name(comp),
+	    };
+	    if (halg_foreach(0, &args, yield_batch_funct_on_thread)) {
+		HALFAIL_RC(EBUSY, "not deleting instance %s - funct %s of "
+			   "component %s is on a thread, delf it first",
+			   name, ho_name((hal_funct_t *) args.user_ptr1),
+			   ho_name(comp));
+	    }
+	}
 	// this does most of the heavy lifting
 	free_inst_struct(inst);
     }
@@ -41,6 +41,11 @@ RTAPI_BEGIN_DECLS
 
 // must resolve intra-hallib, so move here from hal_lib.c:
 void *shmalloc_rt(size_t size); // was up
+void *shmalloc_rt_aligned(size_t size, size_t alignment);
+
+// pack signal values per thread, see hal_memory.c
+int halg_layout_signals(const int use_hal_mutex);
+void layout_free_slot(hal_sig_t *sig);
 
 void *shmalloc_desc(size_t size); // was dn
 void *shmalloc_desc_aligned(size_t size, size_t alignment); // was dn
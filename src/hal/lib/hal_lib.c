@@ -436,6 +436,11 @@ EXPORT_SYMBOL(hal_stop_threads);
 EXPORT_SYMBOL(halg_inst_create);
 EXPORT_SYMBOL(halg_inst_delete);
 
+// hal_group.c:
+EXPORT_SYMBOL(halg_group_share);
+EXPORT_SYMBOL(halg_group_unshare);
+EXPORT_SYMBOL(hal_group_scan);
+
 // hal_lib.c:
 EXPORT_SYMBOL(hal_print_msg);
 EXPORT_SYMBOL(hal_print_error);
@@ -0,0 +1,109 @@
+#ifndef HAL_LOGICVM_H
+#define HAL_LOGICVM_H
+
+#include <rtapi.h>
+#include <hal_priv.h>
+
+RTAPI_BEGIN_DECLS
+
+// the bytecode run by a logicvm instance (hal/components/logicvm.c).
+//
+// 'lcompile' in halcmd translates a set of logic instances (and2, mux4,
+// comp, ...) into this form: a straight sequence of register operations
+// in the order of the sub-net, with a load for every value coming from
+// outside and a store for every output pin of the replaced instances.
+//
+// registers are hal_data_u, the operand types are implied by the opcode.
+// pins are referred to by the shm offset of their descriptor and read
+// through pin_value() on every run, so the signal layout done at start
+// is picked up without recompiling. The registers are not: lcompile
+// gives all pins linked to one signal the same register, so after any
+// net/unlinkp touching the compiled pins the sub-net must be compiled
+// again. lcompile records hal_data->link_generation in the instance, and
+// the funct does nothing but count <name>.stale while it differs.
+//
+// the replaced instances and their components are referenced (ho_incref)
+// while the code refers to their pins, so delinst and unloadrt refuse to
+// remove them; deleting the logicvm instance releases them.
+
+enum lvm_op {
+    LVM_LD,	// r0 = value of pin arg
+    LVM_ST,	// value of pin arg = r0, of type r1
+    LVM_AND,	// r0 = r1 && r2
+    LVM_OR,	// r0 = r1 || r2
+    LVM_XOR,	// r0 = r1 != r2
+    LVM_NOT,	// r0 = !r1
+    LVM_PACK,	// r0 = r1 | r2 << 1 | ... , arg bits (bit -> u32)
+    LVM_MUX,	// r0 = the r1'th of arg registers in the following LVM_DATA
+    LVM_BIT,	// r0 = bit r2 of r1 (u32)
+    LVM_SEQ,	// r0 = r1 == arg (s32)
+    LVM_FMUL,	// r0 = r1 * r2
+    LVM_FADD,	// r0 = r1 + r2
+    LVM_FLE,	// r0 = r1 <= r2
+    LVM_FGE,	// r0 = r1 >= r2
+    LVM_COMP,	// comparator with hysteresis:
+		// out r0 (kept within the band), equal r1, in0 r2, in1 r3, hyst r4
+    LVM_DATA,	// operand registers of the preceding instruction
+};
+
+#define LVM_NREGS 7	// register operands per instruction
+
+typedef struct {
+    __u16 op;
+    __u16 r[LVM_NREGS];
+    hal_s32_t arg;
+} hal_lvm_insn_t;
+
+// operand i of an instruction with its operands in LVM_DATA
+static inline __u16 lvm_data(const hal_lvm_insn_t *insn, const int i) {
+    return insn[1 + i / LVM_NREGS].r[i % LVM_NREGS];
+}
+
+// the instance data of a logicvm instance, followed by code and registers.
+// set up by the instance, filled in by lcompile before the funct is
+// added to a thread: code and registers first, n_code last.
+typedef struct {
+    hal_u32_t n_code;		// instructions to run, 0 until compiled
+    hal_u32_t max_code;		// room for instructions
+    hal_u32_t max_regs;		// room for registers
+    hal_u32_t verify;		// compare stores against the pins only
+    hal_s32_t code_off;		// offsets from the start of this struct
+    hal_s32_t regs_off;
+    hal_s32_t refs_off;
+    hal_u32_t max_refs;		// room for instance ids
+    hal_u32_t n_refs;		// referenced instances, released on delete
+    hal_u32_t link_generation;	// of hal_data when compiled
+    hal_u32_t logged;		// mismatches logged so far
+    u32_pin_ptr mismatches;	// verify: stores which differed
+    u32_pin_ptr stale;		// cycles skipped since a compiled pin was relinked
+} hal_lvm_t;
+
+static inline hal_lvm_insn_t *lvm_code(hal_lvm_t *vm) {
+    return (hal_lvm_insn_t *)((char *)vm + vm->code_off);
+}
+
+static inline hal_data_u *lvm_regs(hal_lvm_t *vm) {
+    return (hal_data_u *)((char *)vm + vm->regs_off);
+}
+
+static inline size_t lvm_regs_off(const int max_code) {
+    size_t off = sizeof(hal_lvm_t) + max_code * sizeof(hal_lvm_insn_t);
+    return (off + sizeof(hal_data_u) - 1) & ~(sizeof(hal_data_u) - 1);
+}
+
+static inline hal_s32_t *lvm_refs(hal_lvm_t *vm) {
+    return (hal_s32_t *)((char *)vm + vm->refs_off);
+}
+
+static inline size_t lvm_refs_off(const int max_code, const int max_regs) {
+    return lvm_regs_off(max_code) + max_regs * sizeof(hal_data_u);
+}
+
+static inline size_t lvm_size(const int max_code, const int max_regs,
+			      const int max_refs) {
+    return lvm_refs_off(max_code, max_regs) + max_refs * sizeof(hal_s32_t);
+}
+
+RTAPI_END_DECLS
+
+#endif // HAL_LOGICVM_H
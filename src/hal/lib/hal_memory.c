@@ -91,19 +91,18 @@ void *shmalloc_desc(size_t size)
 
 void *shmalloc_desc_aligned(size_t size, size_t alignment)
 {
-    // force arena expansion by alloc/free just in case
-    // so the following internal malloc in rtapi_malloc_aligned()
-    // does not fail
-    // not terribly elegant but effective
-    void *dummy = shmalloc_desc(size + alignment);
-    if (dummy) {
-	shmfree_desc(dummy);
-    } else
-	return NULL;
-
+    // aligned allocations always come from the arena, not from the
+    // size classes - so extend the arena on failure and retry
+    // like shmalloc_desc() does
     void *ptr = rtapi_malloc_aligned(&hal_data->heap,
 				     size,
 				     alignment);
+    if (ptr == NULL) {
+	hal_heap_addmem(HAL_HEAP_INCREMENT);
+	ptr = rtapi_malloc_aligned(&hal_data->heap,
+				   size,
+				   alignment);
+    }
     if (ptr == NULL)
 	HALFAIL_NULL(ENOMEM, "insufficient memory for %zu, align=%zu",
 		     size, alignment);
@@ -144,13 +143,355 @@ void *shmalloc_rt(size_t size)
     return retval;
 }
 
+// like shmalloc_rt(), but with explicit alignment (a power of two),
+// e.g. RTAPI_CACHELINE
+void *shmalloc_rt_aligned(size_t size, size_t alignment)
+{
+    long int tmp_top;
+    void *retval;
+
+    tmp_top = (hal_data->shmem_top - size) & ~((long int) alignment - 1);
+    if (tmp_top < hal_data->shmem_bot) {
+	HALFAIL_NULL(ENOMEM, "giving up - can't allocate %zu bytes", size);
+    }
+    hal_data->rt_alignment_loss += hal_data->shmem_top - tmp_top - size;
+
+    retval = SHMPTR(tmp_top);
+    hal_data->shmem_top = tmp_top;
+    return retval;
+}
+
+// signal value layout
+//
+// signal values are created inside their descriptors on the HAL heap,
+// in creation order, so the values a thread touches end up scattered
+// across many cache lines, next to values other threads write.
+//
+// hal_layout_signals() walks the thread->funct->pin->signal graph and
+// moves each signal value into a slot on RT memory:
+// - signals only touched by functs of one thread are packed into
+//   contiguous cache lines private to that thread
+// - signals touched by functs of several threads get a cache line
+//   of their own
+// - signals not touched by any thread funct stay in place.
+//
+// a funct touches the pins of its owner (instance or legacy comp);
+// a funct owned by a comp also touches the pins of its instances.
+// A value is followed by its write generation, so a slot is 16 bytes.
+//
+// values are only moved once: signals already placed keep their slot,
+// signals created later are placed on the next start.
+// Deleting a placed signal puts its slot on a free list in hal_data,
+// tagged with the thread it was private to. The next pass hands it to a
+// new signal private to the same thread, or for a shared cache line to
+// any shared signal, before it carves new slots from RT memory.
+// Every pass which moves values increments hal_data->layout_generation,
+// so users holding value addresses (halscope) know to look them up again.
+// Must be called with threads stopped.
+
+#define LAYOUT_SLOT  16  // hal_data_u + __u32 generation, 8-aligned
+#define LAYOUT_MAX_THREADS 64  // fits thread mask
+
+// a slot on one of the free lists
+typedef struct {
+    int next;			// offset of the next free slot, 0 ends the list
+    int thread_id;		// thread a private slot belonged to
+} layout_free_t;
+
+typedef struct {
+    int owner_id;		// of the funct: instance or comp
+    int comp_id;		// comp id if the funct is owned by a comp, else 0
+    int thread;			// index of the calling thread
+} layout_funct_t;
+
+typedef struct {
+    int nthreads;
+    hal_thread_t *thread[LAYOUT_MAX_THREADS];
+    int nfuncts;
+    layout_funct_t *funct;
+    int count[LAYOUT_MAX_THREADS];	// private signals per thread
+    int reuse[LAYOUT_MAX_THREADS];	// free private slots per thread
+    char *next[LAYOUT_MAX_THREADS];	// next free private slot
+    int nshared;
+    int nfree_lines;			// free shared cache lines
+    char *next_shared;
+    __u64 mask;				// scratch: threads of current signal
+} layout_t;
+
+static int layout_thread_cb(hal_object_ptr o, foreach_args_t *args)
+{
+    layout_t *l = args->user_ptr1;
+    hal_list_t *list_root, *list_entry;
+    hal_funct_entry_t *fe;
+    hal_funct_t *funct;
+    hal_comp_t *comp;
+
+    if (l->nthreads == LAYOUT_MAX_THREADS) {
+	HALWARN("layout: more than %d threads, ignoring '%s'",
+		LAYOUT_MAX_THREADS, ho_name(o.thread));
+	return 0;
+    }
+    list_root = &o.thread->funct_list;
+    for (list_entry = dlist_next(list_root);
+	 list_entry != list_root;
+	 list_entry = dlist_next(list_entry)) {
+	fe = (hal_funct_entry_t *) list_entry;
+	if (fe->funct_ptr == 0)
+	    continue;
+	if (l->funct) {
+	    funct = SHMPTR(fe->funct_ptr);
+	    comp = halpr_find_owning_comp(ho_owner_id(funct));
+	    l->funct[l->nfuncts].owner_id = ho_owner_id(funct);
+	    l->funct[l->nfuncts].comp_id =
+		(comp && (ho_id(comp) == ho_owner_id(funct))) ? ho_id(comp) : 0;
+	    l->funct[l->nfuncts].thread = l->nthreads;
+	}
+	l->nfuncts++;
+    }
+    l->thread[l->nthreads++] = o.thread;
+    return 0;
+}
+
+// or the threads whose functs touch this pin into l->mask
+static int layout_pin_cb(hal_pin_t *pin, hal_sig_t *sig, void *user)
+{
+    layout_t *l = user;
+    int owner = ho_owner_id(pin);
+    hal_comp_t *comp = halpr_find_owning_comp(owner);
+    int comp_id = comp ? ho_id(comp) : -1;
+    int i;
+
+    for (i = 0; i < l->nfuncts; i++) {
+	if ((l->funct[i].owner_id == owner) ||
+	    (l->funct[i].comp_id == comp_id))
+	    l->mask |= 1ULL << l->funct[i].thread;
+    }
+    return 0;
+}
+
+static int layout_repoint_cb(hal_pin_t *pin, hal_sig_t *sig, void *user)
+{
+    pin->data_ptr = sig->data_ptr;
+    if (hh_get_legacy(&pin->hdr)) {
+	hal_comp_t *comp = halpr_find_owning_comp(ho_owner_id(pin));
+	void **data_ptr_addr = SHMPTR(pin->_data_ptr_addr);
+	*data_ptr_addr = comp->shmem_base + sig->data_ptr;
+    }
+    return 0;
+}
+
+// -1: stays in place, 0..nthreads-1: private to thread, nthreads: shared
+static int layout_classify(layout_t *l, hal_sig_t *sig)
+{
+    int i;
+
+    if (sig->data_ptr != SHMOFF(&sig->value))
+	return -1; // already placed
+    l->mask = 0;
+    halg_foreach_pin_by_signal(0, sig, layout_pin_cb, l);
+    if (l->mask == 0)
+	return -1;
+    if (l->mask & (l->mask - 1))
+	return l->nthreads;
+    for (i = 0; !(l->mask & (1ULL << i)); i++);
+    return i;
+}
+
+static int layout_count_cb(hal_object_ptr o, foreach_args_t *args)
+{
+    layout_t *l = args->user_ptr1;
+    int where = layout_classify(l, o.sig);
+
+    if (where == l->nthreads)
+	l->nshared++;
+    else if (where >= 0)
+	l->count[where]++;
+    return 0;
+}
+
+// unchain the first free slot of thread_id (0: a shared line) from list
+static hal_data_u *layout_pop_free(int *list, const int thread_id)
+{
+    int *prev = list;
+    layout_free_t *f;
+
+    while (*prev) {
+	f = SHMPTR(*prev);
+	if (f->thread_id == thread_id) {
+	    hal_data_u *slot = (hal_data_u *) f;
+	    *prev = f->next;
+	    return slot;
+	}
+	prev = &f->next;
+    }
+    return NULL;
+}
+
+// count the free slots the threads of this pass can take back
+static void layout_count_free(layout_t *l)
+{
+    layout_free_t *f;
+    int off, i;
+
+    for (off = hal_data->layout_free_slots; off; off = f->next) {
+	f = SHMPTR(off);
+	for (i = 0; i < l->nthreads; i++) {
+	    if (ho_id(l->thread[i]) == f->thread_id) {
+		l->reuse[i]++;
+		break;
+	    }
+	}
+    }
+    for (off = hal_data->layout_free_lines; off; off = f->next) {
+	f = SHMPTR(off);
+	l->nfree_lines++;
+    }
+}
+
+// called with the HAL mutex held when a signal is deleted
+void layout_free_slot(hal_sig_t *sig)
+{
+    layout_free_t *f;
+
+    if (sig->data_ptr == SHMOFF(&sig->value))
+	return; // never placed
+    f = SHMPTR(sig->data_ptr);
+    f->thread_id = sig->slot_thread;
+    if (sig->slot_thread) {
+	f->next = hal_data->layout_free_slots;
+	hal_data->layout_free_slots = sig->data_ptr;
+    } else {
+	f->next = hal_data->layout_free_lines;
+	hal_data->layout_free_lines = sig->data_ptr;
+    }
+    sig->data_ptr = SHMOFF(&sig->value);
+}
+
+static int layout_place_cb(hal_object_ptr o, foreach_args_t *args)
+{
+    layout_t *l = args->user_ptr1;
+    hal_sig_t *sig = o.sig;
+    hal_data_u *old, *slot;
+    int where = layout_classify(l, sig);
+
+    if (where < 0)
+	return 0;
+    if (where == l->nthreads) {
+	slot = layout_pop_free(&hal_data->layout_free_lines, 0);
+	if (slot == NULL) {
+	    slot = (hal_data_u *) l->next_shared;
+	    l->next_shared += RTAPI_CACHELINE;
+	}
+	sig->slot_thread = 0;
+    } else {
+	sig->slot_thread = ho_id(l->thread[where]);
+	slot = layout_pop_free(&hal_data->layout_free_slots, sig->slot_thread);
+	if (slot == NULL) {
+	    slot = (hal_data_u *) l->next[where];
+	    l->next[where] += LAYOUT_SLOT;
+	}
+    }
+    old = sig_value(sig);
+    *slot = *old;
+    *hal_generation(slot) = *hal_generation(old);
+    sig->data_ptr = SHMOFF(slot);
+    halg_foreach_pin_by_signal(0, sig, layout_repoint_cb, NULL);
+    return 0;
+}
+
+int halg_layout_signals(const int use_hal_mutex)
+{
+    CHECK_HALDATA();
+    {
+	WITH_HAL_MUTEX_IF(use_hal_mutex);
+	foreach_args_t targs = { .type = HAL_THREAD };
+	foreach_args_t sargs = { .type = HAL_SIGNAL };
+	layout_t *l;
+	int i, n, placed = 0;
+
+	if (hal_data->threads_running)
+	    HALFAIL_RC(EBUSY, "layout: threads running");
+
+	// transient - use the descriptor heap, this runs in RT context
+	// with kernel threads too
+	if ((l = shmalloc_desc(sizeof(layout_t))) == NULL)
+	    return _halerrno;
+
+	// count, then collect the functs of all threads
+	targs.user_ptr1 = l;
+	halg_foreach(0, &targs, layout_thread_cb);
+	if (l->nfuncts == 0) {
+	    shmfree_desc(l);
+	    return 0;
+	}
+	if ((l->funct = shmalloc_desc(sizeof(layout_funct_t) * l->nfuncts)) == NULL) {
+	    shmfree_desc(l);
+	    return _halerrno;
+	}
+	l->nthreads = l->nfuncts = 0;
+	halg_foreach(0, &targs, layout_thread_cb);
+
+	sargs.user_ptr1 = l;
+	halg_foreach(0, &sargs, layout_count_cb);
+	layout_count_free(l);
+
+	for (i = 0; i < l->nthreads; i++) {
+	    if (l->count[i] == 0)
+		continue;
+	    n = l->count[i] - l->reuse[i];
+	    if (n > 0) {
+		l->next[i] = shmalloc_rt_aligned(RTAPI_ALIGN((n * LAYOUT_SLOT),
+							     RTAPI_CACHELINE),
+						 RTAPI_CACHELINE);
+		if (l->next[i] == NULL)
+		    goto nomem;
+	    }
+	    HALDBG("layout: thread '%s': %d signals",
+		   ho_name(l->thread[i]), l->count[i]);
+	    placed += l->count[i];
+	}
+	if (l->nshared) {
+	    n = l->nshared - l->nfree_lines;
+	    if (n > 0) {
+		l->next_shared = shmalloc_rt_aligned(n * RTAPI_CACHELINE,
+						     RTAPI_CACHELINE);
+		if (l->next_shared == NULL)
+		    goto nomem;
+	    }
+	    HALDBG("layout: %d signals shared between threads", l->nshared);
+	    placed += l->nshared;
+	}
+	if (placed) {
+	    halg_foreach(0, &sargs, layout_place_cb);
+	    hal_data->layout_generation++;
+	}
+
+	// the threads pick up the new pointers on start
+	rtapi_smp_mb();
+
+	shmfree_desc(l->funct);
+	shmfree_desc(l);
+	return 0;
+
+    nomem:
+	// nothing was moved yet
+	shmfree_desc(l->funct);
+	shmfree_desc(l);
+	HALFAIL_RC(ENOMEM, "layout: out of RT memory");
+    }
+}
+
 void report_heapstatus(const char *tag,  struct rtapi_heap *h)
 {
 	struct rtapi_heap_stat hs = {};
 	rtapi_heap_status(h, &hs);
 	HALDBG("%s heap status\n", tag);
-	HALDBG("  arena=%zu totail_avail=%zu fragments=%zu largest=%zu\n",
-	       hs.arena_size, hs.total_avail, hs.fragments, hs.largest);
+	HALDBG("  arena=%zu totail_avail=%zu fragments=%zu largest=%zu"
+	       " fragmentation=%zu%%\n",
+	       hs.arena_size, hs.total_avail, hs.fragments, hs.largest,
+	       hs.fragmentation);
+	HALDBG("  size classes: inuse=%zu cached=%zu chunks=%zu\n",
+	       hs.slab_inuse, hs.slab_cached, hs.slab_chunks);
 	HALDBG("  requested=%zu allocated=%zu freed=%zu waste=%zu%%\n",
 	       hs.requested, hs.allocated, hs.freed,
 	       hs.allocated ?
@@ -295,10 +295,10 @@ void unlink_pin(hal_pin_t * pin)
 	    dummy_addr = (hal_data_u *) &pin->dummysig;
 	}
 	pin->data_ptr = SHMOFF(&(pin->dummysig));
+	hal_data->link_generation++;
 
 	/* copy current signal value to dummy */
-	//XXX use SHMPTR
-	sig_data_addr = (hal_data_u *)(hal_shmem_base + SHMOFF(&sig->value));
+	sig_data_addr = sig_value(sig);
 
 
 	switch (pin->type) {
@@ -330,6 +330,14 @@ void unlink_pin(hal_pin_t * pin)
 	if (pin->dir == HAL_IO) {
 	    sig->bidirs--;
 	}
+	if (hh_get_legacy(&pin->hdr) && (pin->dir != HAL_IN)) {
+	    // the generation may be stale by now: invalidate
+	    // trackers before it is trusted again
+	    sig->legacy_writers--;
+	    hal_bump_generation(sig_data_addr);
+	}
+	// the dummy got a new value
+	hal_bump_generation(dummy_addr);
 	/* mark pin as unlinked */
 	pin_set_unlinked(pin);
 
@@ -236,6 +236,13 @@ typedef struct {
     size_t rt_alignment_loss;
     size_t hal_malloced; // mostly by comps doing hal_malloc()
 
+    // signal value slots placed by halg_layout_signals() and given back
+    // when their signal is deleted, see hal_memory.c
+    int layout_free_slots;	// private slots, chained through their first int
+    int layout_free_lines;	// shared cache lines, chained the same way
+    int layout_generation;	// incremented whenever signal values move
+    unsigned int link_generation; // incremented on every link and unlink
+
 
     // HAL heap for shmalloc_desc()
     struct rtapi_heap heap;
@@ -321,6 +328,7 @@ typedef struct hal_pin {
     int data_ptr;		// v2: just the signal's hal_data_u offset
     int _signal;		// PRIVATE: signal descriptor to which pin is linked
     hal_data_u dummysig;	/* if unlinked, data_ptr points here */
+    __u32 dummygen;		// write generation of dummysig - must follow it
     hal_type_t type;		/* data type */
     hal_pin_dir_t dir;		/* pin direction */
     int flags;
@@ -338,9 +346,15 @@ typedef struct hal_sig {
     halhdr_t hdr;		// common HAL object header
     hal_type_t type;		/* data type */
     hal_data_u value;           // v2 - store value in descriptor
+    __u32 generation;		// write generation of value - must follow it
+    int data_ptr;		// offset of the live value: &value, or a
+				// slot placed by hal_layout_signals()
+    int slot_thread;		// placed slot: id of the thread it is
+				// private to, 0 if a shared cache line
     int readers;		/* number of input pins linked */
     int writers;		/* number of output pins linked */
     int bidirs;			/* number of I/O pins linked */
+    int legacy_writers;		// linked v1 OUT/IO pins - generation unreliable
 } hal_sig_t;
 
 
@@ -377,7 +391,7 @@ static inline const hal_pin_dir_t pin_dir(const hal_pin_t *pin) {
 }
 
 static inline hal_data_u *sig_value(hal_sig_t *sig) {
-    return &sig->value;
+    return (hal_data_u *)SHMPTR(sig->data_ptr);
 }
 
 static inline hal_data_u *param_value(const hal_param_t *param)
@@ -391,7 +405,7 @@ static inline hal_data_u *pin_value(hal_pin_t *pin) {
     // once v1 pins are history
     if (pin->_signal != 0) {
 	hal_sig_t *s = (hal_sig_t *)SHMPTR(pin->_signal);
-	return &s->value;
+	return sig_value(s);
     }
     return &pin->dummysig;
 }
@@ -425,6 +439,22 @@ static inline void pin_set_unlinked(hal_pin_t *pin) {
     pin->data_ptr = SHMOFF(&pin->dummysig);
 }
 
+// write generation counters: every hal_data_u a v2 data_ptr can refer to
+// (sig_value(), pin->dummysig) is immediately followed by a __u32 which the
+// accessors bump on each write which actually changes the value.
+// Legacy (v1) pins write through a raw pointer and never bump it, so the
+// counter can only be trusted if no legacy pin can write the value.
+static inline bool sig_generation_valid(const hal_sig_t *sig) {
+    return (sig->legacy_writers == 0);
+}
+
+static inline bool pin_generation_valid(const hal_pin_t *pin) {
+    const hal_sig_t *sig = signal_of(pin);
+    if (sig)
+	return sig_generation_valid(sig);
+    return !hh_get_legacy(&pin->hdr) || (pin->dir == HAL_IN);
+}
+
 
 
 // strongly typed hal_data_u setters and getters, once and for all.
@@ -530,6 +560,8 @@ typedef struct hal_funct_args {
     // without calling rtapi_get_time() yet once more
     // (RTAPI thread_task already does this, so it's all about making an
     // existing value accessible to the funct)
+    // in cycles the thread does not time its functs (TT_SAMPLED, TT_OFF)
+    // this is the start time of the thread.
     long long int start_time;
 
     long long int last_start_time; // used to determine the actual period
@@ -592,6 +624,21 @@ typedef struct hal_funct_entry {
     int funct_ptr;		/* pointer to function */
 } hal_funct_entry_t;
 
+// how a thread measures the execution time of its functs (the
+// <funct>.time/.tmax pins); the thread start is always taken with
+// rtapi_get_time(), for <thread>.curr-period.
+typedef enum {
+    TT_FULL,			// rtapi_get_time() after every funct
+    TT_TSC,			// CPU clocks after every funct, converted to ns
+				// with a ratio calibrated against rtapi_get_time()
+    TT_SAMPLED,			// like TT_FULL, every timing_arg'th cycle only
+    TT_OFF,			// no funct times, <thread>.time only
+} hal_thread_timing_t;
+
+#define TT_SAMPLE_DEFAULT 100	// TT_SAMPLED: cycles per measured cycle
+#define TT_CAL_WINDOW 100000000LL // TT_TSC: ns between calibrations
+#define TT_CAL_SHIFT 24		// TT_TSC: fraction bits of ns per clock
+
 // argument struct for hal_create_xthread()
 typedef struct {
     const char *name;
@@ -600,6 +647,8 @@ typedef struct {
     int cpu_id;
     rtapi_thread_flags_t flags;
     char cgname[LINELEN];
+    hal_thread_timing_t timing;	// 0: TT_FULL
+    int timing_arg;		// TT_SAMPLED: cycles per measured cycle
 } hal_threadargs_t;
 
 // extended arguments version of hal_create_thread().
@@ -623,6 +672,11 @@ typedef struct hal_thread {
     int cpu_id;                 /* cpu to bind on, or -1 */
     rtapi_thread_flags_t flags;             // eg Posix, nowait
     char cgname[LINELEN];       // libcgroup name
+    hal_thread_timing_t timing; // funct timing policy
+    int timing_arg;
+    long long int cal_time;     // TT_TSC: start of the calibration window
+    long long int cal_clocks;
+    hal_u64_t ns_per_clock;     // TT_TSC: << TT_CAL_SHIFT, 0 until calibrated
 } hal_thread_t;
 
 
@@ -702,7 +756,7 @@ typedef struct hal_vtable {
    meaningfull error messages in case of a mismatch.
 */
 #include "rtapi_shmkeys.h"
-#define HAL_VER   13	/* version code */
+#define HAL_VER   17	/* version code */
 
 
 /***********************************************************************
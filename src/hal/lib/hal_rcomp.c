@@ -205,6 +205,10 @@ int halg_compile_comp(const int use_hal_mutex,
        if ((tc->tracking =
 	    malloc(sizeof(hal_data_u) * tc->n_pins )) == NULL)
 	   NOMEM("allocating a array of tracking values");
+       // alloc tracking generation array
+       if ((tc->gentrack =
+	    malloc(sizeof(hal_gentrack_t) * tc->n_pins )) == NULL)
+	   NOMEM("allocating a array of tracking generations");
        // alloc change bitmap
        if ((tc->changed =
 	    malloc(RTAPI_BITMAP_BYTES(tc->n_pins))) == NULL)
@@ -212,6 +216,7 @@ int halg_compile_comp(const int use_hal_mutex,
 
        memset(tc->pin, 0, sizeof(hal_pin_t *) * tc->n_pins);
        memset(tc->tracking, 0, sizeof(hal_data_u) * tc->n_pins);
+       memset(tc->gentrack, 0, sizeof(hal_gentrack_t) * tc->n_pins);
        RTAPI_ZERO_BITMAP(tc->changed,tc->n_pins);
 
        // fill in pin array
@@ -244,6 +249,12 @@ int hal_ccomp_match(hal_compiled_comp_t *cc)
     for (i = 0; i < cc->n_pins; i++) {
 	hp = cc->pin[i];
 
+	// not written since the last scan - skip the value compare
+	if (pin_generation_valid(hp) &&
+	    hal_generation_unchanged(&cc->gentrack[i],
+				     hal_ptr(hp->data_ptr)))
+	    continue;
+
 	switch (pin_type(hp)) {
 	case HAL_BIT:
 	    halbit = _get_bit_pin(hp);
@@ -320,6 +331,8 @@ int hal_ccomp_free(hal_compiled_comp_t *cc)
     assert(cc->magic ==  CCOMP_MAGIC);
     if (cc->tracking)
 	free(cc->tracking);
+    if (cc->gentrack)
+	free(cc->gentrack);
     if (cc->changed)
 	free(cc->changed);
     if (cc->pin)
@@ -14,6 +14,7 @@ typedef struct {
     hal_pin_t  **pin;
     unsigned long *changed;      // bitmap
     hal_data_u    *tracking;     // tracking values of monitored pins
+    hal_gentrack_t *gentrack;    // tracking generations of monitored pins
     void *user_data;             // uninterpreted by HAL code
     unsigned long user_flags;    // uninterpreted by HAL code
 } hal_compiled_comp_t;
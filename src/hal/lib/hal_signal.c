@@ -58,6 +58,8 @@ int halg_signal_new(const int use_hal_mutex,
 	}
 
 	/* initialize the structure */
+	new->data_ptr = SHMOFF(&new->value);
+	new->slot_thread = 0;
 	new->type = type;
 	new->readers = 0;
 	new->writers = 0;
@@ -258,7 +260,7 @@ int halg_link(const int use_hal_mutex,
 	if (hh_get_legacy(&pin->hdr)) {
 	    hal_comp_t *comp = halpr_find_owning_comp(ho_owner_id(pin));
 	    void **data_ptr_addr = SHMPTR(pin->_data_ptr_addr);
-	    void *data_addr = comp->shmem_base + SHMOFF(&sig->value);
+	    void *data_addr = comp->shmem_base + sig->data_ptr;
 
 	    HAL_ASSERT(data_ptr_addr != NULL);
 	    HAL_ASSERT(*data_ptr_addr != NULL);
@@ -268,11 +270,11 @@ int halg_link(const int use_hal_mutex,
 
 	// track in v2 data_ptr. Eventually even this can go, just use
 	// pin->signal. Need to assure though pin->signal is not inited to 0
-	// but to SHMOFF(&sig->value). See pin_is_linked() and pin_linked(to).
+	// but to sig->data_ptr. See pin_is_linked() and pin_linked(to).
 	//
 	// strategy: rename pin.signal to pin._signal and fix fallout.
 	// good runtime assertion on 'halcmd show objects'.
-	pin->data_ptr = SHMOFF(&sig->value);
+	pin->data_ptr = sig->data_ptr;
 
 	if (( sig->readers == 0 ) && ( sig->writers == 0 ) &&
 	    ( sig->bidirs == 0 )) {
@@ -322,8 +324,13 @@ int halg_link(const int use_hal_mutex,
 	if (pin->dir == HAL_IO) {
 	    sig->bidirs++;
 	}
+	// a v1 pin writes the value without bumping its generation
+	if (hh_get_legacy(&pin->hdr) && (pin->dir != HAL_IN)) {
+	    sig->legacy_writers++;
+	}
 	/* and update the pin */
 	set_signal(pin, sig);
+	hal_data->link_generation++;
 
 	// propagate the pin->signal assignment because
 	// halg_signal_propagate_barriers() triggers on
@@ -398,5 +405,7 @@ int free_sig_struct(hal_sig_t * sig)
 {
     // unlink any pins linked to this signal
     halg_foreach_pin_by_signal(0, sig, unlink_pin_callback, NULL);
+    // give back a value slot placed by halg_layout_signals()
+    layout_free_slot(sig);
     return halg_free_object(false, (hal_object_ptr) sig);
 }
@@ -6,19 +6,49 @@
 #include "hal.h"		/* HAL public API decls */
 #include "hal_priv.h"		/* HAL private decls */
 #include "hal_internal.h"
+#include "rtapi_math64.h"	/* rtapi_div_u64() */
+
+#ifdef ULAPI
+#include <stdlib.h>		/* getenv() */
+#endif
 
 #ifdef RTAPI
 
+// TT_TSC: the ns per CPU clock over the last calibration window
+static void calibrate_clocks(hal_thread_t *thread, const long long int now,
+			     const long long int clocks)
+{
+    hal_u64_t dt = now - thread->cal_time;
+    hal_u64_t dc = clocks - thread->cal_clocks;
+
+    if (thread->cal_time && (dt < TT_CAL_WINDOW))
+	return;
+    if (thread->cal_time && (clocks > thread->cal_clocks)) {
+	// rtapi_div_u64() takes a 32bit divisor
+	while (dc > 0xffffffffULL) {
+	    dc >>= 1;
+	    dt >>= 1;
+	}
+	thread->ns_per_clock = rtapi_div_u64(dt << TT_CAL_SHIFT, dc);
+    }
+    thread->cal_time = now;
+    thread->cal_clocks = clocks;
+}
+
 /** 'thread_task()' is a function that is invoked as a realtime task.
     It implements a thread, by running down the thread's function list
     and calling each function in turn.
+
+    The execution time of each funct is measured as set by the timing
+    policy of the thread (see hal_thread_timing_t).
 */
 static void thread_task(void *arg)
 {
     hal_thread_t *thread = arg;
     hal_funct_entry_t *funct_root, *funct_entry;
-    long long int end_time;
+    long long int end_time, start_clocks = 0;
     hal_s32_t delta, act_period;
+    int timed, tsc, sample = 0;
 
     thread->cycles = 0;
     thread->mean = 0.0;
@@ -47,6 +77,28 @@ static void thread_task(void *arg)
 	    set_s32_pin(thread->curr_period, act_period);
 
 	    fa.last_start_time = fa.thread_start_time = fa.start_time;
+	    end_time = fa.start_time;
+
+	    // time the functs in this cycle?
+	    switch (thread->timing) {
+	    case TT_SAMPLED:
+		timed = (sample == 0);
+		if (++sample >= thread->timing_arg)
+		    sample = 0;
+		break;
+	    case TT_OFF:
+		timed = 0;
+		break;
+	    default:
+		timed = 1;
+	    }
+	    tsc = 0;
+	    if (thread->timing == TT_TSC) {
+		start_clocks = rtapi_get_clocks();
+		calibrate_clocks(thread, fa.start_time, start_clocks);
+		// rtapi_get_time() until calibrated
+		tsc = (thread->ns_per_clock != 0);
+	    }
 
 	    /* run thru function list */
 	    while (funct_entry != funct_root) {
@@ -71,19 +123,26 @@ static void thread_task(void *arg)
 		    // bad - a mistyped funct
 		    ;
 		}
-		// capture execution time of this funct
-		end_time = rtapi_get_time();
-
-		/* update execution time data */
-		delta = end_time - fa.start_time;
-		set_s32_pin(fa.funct->f_runtime, delta);
-		if ( delta > get_s32_pin(fa.funct->f_maxtime)) {
-		    set_s32_pin(fa.funct->f_maxtime, delta);
+		if (timed) {
+		    // capture execution time of this funct
+		    if (tsc)
+			end_time = fa.thread_start_time +
+			    (((rtapi_get_clocks() - start_clocks) *
+			      thread->ns_per_clock) >> TT_CAL_SHIFT);
+		    else
+			end_time = rtapi_get_time();
+
+		    /* update execution time data */
+		    delta = end_time - fa.start_time;
+		    set_s32_pin(fa.funct->f_runtime, delta);
+		    if ( delta > get_s32_pin(fa.funct->f_maxtime)) {
+			set_s32_pin(fa.funct->f_maxtime, delta);
 #ifdef ENABLE_TMAX_INC
-		    set_bit_pin(fa.funct->f_maxtime_increased, 1);
-		} else {
-		    set_bit_pin(fa.funct->f_maxtime_increased, 0);
+			set_bit_pin(fa.funct->f_maxtime_increased, 1);
+		    } else {
+			set_bit_pin(fa.funct->f_maxtime_increased, 0);
 #endif
+		    }
 		}
 
 		// issue a write barrier if set in funct_entry or
@@ -97,6 +156,9 @@ static void thread_task(void *arg)
 		/* prepare to measure time for next funct */
 		fa.start_time = end_time;
 	    }
+	    if (!timed)
+		end_time = rtapi_get_time();
+
 	    // update thread execution time in this period
 	    hal_s32_t rt = (end_time - fa.thread_start_time);
 	    set_s32_pin(thread->runtime, rt);
@@ -159,6 +221,11 @@ int hal_create_xthread(const hal_threadargs_t *args)
 	HALFAIL_RC(EINVAL,"create_thread called "
 		   "with period of zero");
     }
+    // an enum may hold anything coming in over RTAPICommand
+    if (((int) args->timing < TT_FULL) || (args->timing > TT_OFF)) {
+	HALFAIL_RC(EINVAL, "create_thread %s: invalid timing policy %d",
+		   args->name, args->timing);
+    }
     {
 	WITH_HAL_MUTEX();
 
@@ -178,6 +245,18 @@ int hal_create_xthread(const hal_threadargs_t *args)
 	new->cpu_id = args->cpu_id;
 	new->flags = args->flags;
     strncpy(new->cgname, args->cgname, LINELEN);
+	new->timing = args->timing;
+	new->timing_arg = args->timing_arg;
+	if ((new->timing == TT_SAMPLED) && (new->timing_arg < 1))
+	    new->timing_arg = TT_SAMPLE_DEFAULT;
+	// in virtual time rtapi_get_time() stands still during a cycle,
+	// the CPU clocks don't: calibrating one against the other is void
+	if ((new->timing == TT_TSC) && global_data->virtual_time_enabled) {
+	    HALINFO("thread %s: virtual time, using timing=full", args->name);
+	    new->timing = TT_FULL;
+	}
+	new->cal_time = new->cal_clocks = 0;
+	new->ns_per_clock = 0;
 
 	/* have to create and start a task to run the thread */
 	if (dlist_empty(&hal_data->threads)) {
@@ -347,6 +426,15 @@ int hal_start_threads(void)
     CHECK_LOCK(HAL_LOCK_RUN);
 
     HALDBG("starting threads");
+    if (!hal_data->threads_running
+#ifdef ULAPI
+	// HAL_NO_LAYOUT keeps values in creation order, for comparison
+	&& (getenv("HAL_NO_LAYOUT") == NULL)
+#endif
+	) {
+	// not fatal - unplaced signals just stay where they are
+	halg_layout_signals(1);
+    }
     hal_data->threads_running = 1;
     return 0;
 }
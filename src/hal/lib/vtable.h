@@ -8,8 +8,10 @@
 
 typedef enum {
     VTKINEMATICS_VERSION1 = 1000,
+    VTKINEMATICS_VERSION2 = 1001,	// adds the batch methods
 
     VTTP_VERSION1 = 2000,
+    VTTP_VERSION2 = 2001,		// adds tpAddSpline, tpAddSegments
 } vtable_t;
 
 #endif // _VTABLE_H
@@ -72,6 +72,11 @@ int main(int argc, char **argv)
     }
     OK(gbl.init_dbg, "init_gbl.mb_tx done OK");
 
+    if (init_mb_queues() != retOK) {
+        ERR(gbl.init_dbg, "init_mb_queues failed");
+        goto QUIT_CLEANUP;
+    }
+
     gbl.hal_mod_id = hal_init(gbl.hal_mod_name);
     if (gbl.hal_mod_id < 0) {
         ERR(gbl.init_dbg, "Unable to initialize HAL component [%s]", gbl.hal_mod_name);
@@ -120,12 +125,15 @@ QUIT_CLEANUP:
 void *link_loop_and_logic(void *thrd_link_num)
 {
     char *fnct_name = "link_loop_and_logic";
-    int ret, ret_available, ret_connected;
-    int tx_counter;
+    int ret_connected;
+    int batch_counter, tx_counter, nbatches, depth;
+    mb_batch_t batches[MB2HAL_MAX_TCP_PIPELINE];
+    mb_batch_t *batch;
     mb_tx_t   *this_mb_tx = NULL;
     int        this_mb_tx_num;
     mb_link_t *this_mb_link = NULL;
     int        this_mb_link_num;
+    double     now, wait;
 
     if (thrd_link_num == NULL) {
         ERR(gbl.init_dbg, "NULL pointer");
@@ -138,115 +146,137 @@ void *link_loop_and_logic(void *thrd_link_num)
     }
     this_mb_link = &gbl.mb_links[this_mb_link_num];
 
+    //requests in flight at once
+    depth = 1;
+    if (this_mb_link->lp_link_type == linkTCP) {
+        depth = gbl.tcp_pipeline;
+    }
+
     while (1) {
 
-        for (tx_counter = 0; tx_counter < gbl.tot_mb_tx; tx_counter++) {
+        if (gbl.quit_flag != 0) { //tell the threads to quit (SIGTERM o SGIQUIT) (unloadusr mb2hal).
+            return NULL;
+        }
 
-            if (gbl.quit_flag != 0) { //tell the threads to quit (SIGTERM o SGIQUIT) (unloadusr mb2hal).
-                return NULL;
+        //sleep until the earliest deadline of this link (update_rate)
+        now = get_time();
+        wait = next_due_time(this_mb_link) - now;
+        if (wait > 0) {
+            if (wait > MB2HAL_MAX_IDLE_SLEEP_S) {
+                wait = MB2HAL_MAX_IDLE_SLEEP_S;
             }
+            usleep(wait * 1000 * 1000);
+            continue;
+        }
 
-            this_mb_tx_num = tx_counter;
-            this_mb_tx = &gbl.mb_tx[this_mb_tx_num];
-
-            DBG(this_mb_tx->cfg_debug, "mb_tx_num[%d] mb_links[%d] thread[%d] fd[%d] going to TEST availability",
-                this_mb_tx_num, this_mb_tx->mb_link_num, this_mb_link_num, modbus_get_socket(this_mb_link->modbus));
+        this_mb_tx_num = this_mb_link->queue[0];
+        this_mb_tx = &gbl.mb_tx[this_mb_tx_num];
 
-            //corresponding link and time (update_rate)
-            if (is_this_tx_ready(this_mb_link_num, this_mb_tx_num, &ret_available) != retOK) {
-                ERR(this_mb_tx->cfg_debug, "mb_tx_num[%d] mb_links[%d] thread[%d] fd[%d] is_this_tx_ready ERR",
-                    this_mb_tx_num, this_mb_tx->mb_link_num, this_mb_link_num, modbus_get_socket(this_mb_link->modbus));
-                return NULL;
-            }
-            if (ret_available == 0) {
-                DBG(this_mb_tx->cfg_debug, "mb_tx_num[%d] mb_links[%d] thread[%d] fd[%d] NOT available",
-                    this_mb_tx_num, this_mb_tx->mb_link_num, this_mb_link_num, modbus_get_socket(this_mb_link->modbus));
-                continue;
-            }
+        DBG(this_mb_tx->cfg_debug, "mb_tx_num[%d] mb_links[%d] thread[%d] fd[%d] going to TEST connection",
+            this_mb_tx_num, this_mb_tx->mb_link_num, this_mb_link_num, modbus_get_socket(this_mb_link->modbus));
 
-            DBG(this_mb_tx->cfg_debug, "mb_tx_num[%d] mb_links[%d] thread[%d] fd[%d] going to TEST connection",
+        //first time connection or reconnection, run time parameters setting
+        if (get_tx_connection(this_mb_tx_num, &ret_connected) != retOK) {
+            ERR(this_mb_tx->cfg_debug, "mb_tx_num[%d] mb_links[%d] thread[%d] fd[%d] get_tx_connection ERR",
                 this_mb_tx_num, this_mb_tx->mb_link_num, this_mb_link_num, modbus_get_socket(this_mb_link->modbus));
-
-            //first time connection or reconnection, run time parameters setting
-            if (get_tx_connection(this_mb_tx_num, &ret_connected) != retOK) {
-                ERR(this_mb_tx->cfg_debug, "mb_tx_num[%d] mb_links[%d] thread[%d] fd[%d] get_tx_connection ERR",
-                    this_mb_tx_num, this_mb_tx->mb_link_num, this_mb_link_num, modbus_get_socket(this_mb_link->modbus));
-                return NULL;
-            }
-            if (ret_connected == 0) {
-                DBG(this_mb_tx->cfg_debug, "mb_tx_num[%d] mb_links[%d] thread[%d] fd[%d] NOT connected",
-                    this_mb_tx_num, this_mb_tx->mb_link_num, this_mb_link_num, modbus_get_socket(this_mb_link->modbus));
-                continue;
+            return NULL;
+        }
+        if (ret_connected == 0) {
+            DBG(this_mb_tx->cfg_debug, "mb_tx_num[%d] mb_links[%d] thread[%d] fd[%d] NOT connected",
+                this_mb_tx_num, this_mb_tx->mb_link_num, this_mb_link_num, modbus_get_socket(this_mb_link->modbus));
+            //try again when it is due next time
+            next_batch(this_mb_link, now, &batches[0]);
+            for (tx_counter = 0; tx_counter < batches[0].ntx; tx_counter++) {
+                this_mb_tx = &gbl.mb_tx[batches[0].tx[tx_counter]];
+                this_mb_tx->next_time = now + this_mb_tx->time_increment;
+                queue_insert(this_mb_link, this_mb_tx->mb_tx_num);
             }
+            continue;
+        }
 
-            DBG(this_mb_tx->cfg_debug, "mb_tx_num[%d] mb_links[%d] thread[%d] fd[%d] lk_dbg[%d] going to EXECUTE transaction",
-                this_mb_tx_num, this_mb_tx->mb_link_num, this_mb_link_num, modbus_get_socket(this_mb_link->modbus),
-                this_mb_tx->protocol_debug);
+        //the due tx, coalesced, as one request or as several in flight
+        nbatches = 0;
+        while (nbatches < depth && next_batch(this_mb_link, now, &batches[nbatches])) {
+            nbatches++;
+        }
 
-            switch (this_mb_tx->mb_tx_fnct) {
+        DBG(this_mb_tx->cfg_debug, "mb_tx_num[%d] mb_links[%d] thread[%d] fd[%d] lk_dbg[%d] going to EXECUTE %d requests",
+            this_mb_tx_num, this_mb_tx->mb_link_num, this_mb_link_num, modbus_get_socket(this_mb_link->modbus),
+            this_mb_tx->protocol_debug, nbatches);
+
+        if (nbatches > 1) {
+            for (batch_counter = 0; batch_counter < nbatches; batch_counter++) {
+                batch = &batches[batch_counter];
+                if (modbus_get_socket(this_mb_link->modbus) < 0) {
+                    batch->ret = retERR;
+                }
+                else {
+                    batch->ret = tcp_send_batch(batch, this_mb_link);
+                }
+            }
+            tcp_receive_batches(batches, nbatches, this_mb_link);
+        }
+        else {
+            batch = &batches[0];
+            switch (batch->fnct) {
             case mbtx_02_READ_DISCRETE_INPUTS:
-                ret = fnct_02_read_discrete_inputs(this_mb_tx, this_mb_link);
+                batch->ret = fnct_02_read_discrete_inputs(batch, this_mb_link);
                 break;
             case mbtx_03_READ_HOLDING_REGISTERS:
-                ret = fnct_03_read_holding_registers(this_mb_tx, this_mb_link);
+                batch->ret = fnct_03_read_holding_registers(batch, this_mb_link);
                 break;
             case mbtx_04_READ_INPUT_REGISTERS:
-                ret = fnct_04_read_input_registers(this_mb_tx, this_mb_link);
+                batch->ret = fnct_04_read_input_registers(batch, this_mb_link);
                 break;
             case mbtx_15_WRITE_MULTIPLE_COILS:
-                ret = fnct_15_write_multiple_coils(this_mb_tx, this_mb_link);
+                batch->ret = fnct_15_write_multiple_coils(batch, this_mb_link);
                 break;
             case mbtx_16_WRITE_MULTIPLE_REGISTERS:
-                ret = fnct_16_write_multiple_registers(this_mb_tx, this_mb_link);
+                batch->ret = fnct_16_write_multiple_registers(batch, this_mb_link);
                 break;
             default:
-                ret = -1;
+                batch->ret = retERR;
                 ERR(this_mb_tx->cfg_debug, "case error with mb_tx_fnct %d [%s] in mb_tx_num[%d]",
                     this_mb_tx->mb_tx_fnct, this_mb_tx->mb_tx_fnct_name, this_mb_tx_num);
                 break;
             }
+        }
 
-            if (gbl.quit_flag != 0) { //tell the threads to quit (SIGTERM o SGIQUIT) (unloadusr mb2hal).
-                return NULL;
-            }
-
-            if (ret != retOK && modbus_get_socket(this_mb_link->modbus) < 0) { //link failure
-                (*this_mb_tx->num_errors)++;
-                ERR(this_mb_tx->cfg_debug, "mb_tx_num[%d] mb_links[%d] thread[%d] fd[%d] link failure, going to close link",
-                    this_mb_tx_num, this_mb_tx->mb_link_num, this_mb_link_num, modbus_get_socket(this_mb_link->modbus));
-                modbus_close(this_mb_link->modbus);
-            }
-            else if (ret != retOK) {  //transaction failure but link OK
-                (**this_mb_tx->num_errors)++;
-                ERR(this_mb_tx->cfg_debug, "mb_tx_num[%d] mb_links[%d] thread[%d] fd[%d] transaction failure, num_errors[%d]",
-                    this_mb_tx_num, this_mb_tx->mb_link_num, this_mb_link_num, modbus_get_socket(this_mb_link->modbus), **this_mb_tx->num_errors);
-            }
-            else { //transaction and link OK
-                OK(this_mb_tx->cfg_debug, "mb_tx_num[%d] mb_links[%d] thread[%d] fd[%d] transaction OK, update_HZ[%0.03f]",
-                   this_mb_tx_num, this_mb_tx->mb_link_num, this_mb_link_num, modbus_get_socket(this_mb_link->modbus),
-                   1.0/(get_time()-this_mb_tx->last_time_ok));
-                this_mb_tx->last_time_ok = get_time();
-                (**this_mb_tx->num_errors) = 0;
-            }
+        if (gbl.quit_flag != 0) { //tell the threads to quit (SIGTERM o SGIQUIT) (unloadusr mb2hal).
+            return NULL;
+        }
 
-            //set the next (waiting) time for update rate
-            this_mb_tx->next_time = get_time() + this_mb_tx->time_increment;
+        for (batch_counter = 0; batch_counter < nbatches; batch_counter++) {
+            batch = &batches[batch_counter];
 
-            //wait time for serial lines
-            if (this_mb_tx->cfg_link_type == linkRTU) {
-                DBG(this_mb_tx->cfg_debug, "mb_tx_num[%d] mb_links[%d] thread[%d] fd[%d] SERIAL_DELAY_MS activated [%d]",
-                    this_mb_tx_num, this_mb_tx->mb_link_num, this_mb_link_num, modbus_get_socket(this_mb_link->modbus),
-                    this_mb_tx->cfg_serial_delay_ms);
-                usleep(this_mb_tx->cfg_serial_delay_ms * 1000);
+            //the slave may not like the merged range, run these alone from now on
+            if (batch->ret != retOK && batch->ntx > 1 && batch->range_error) {
+                ERR(gbl.mb_tx[batch->tx[0]].cfg_debug, "mb_links[%d] slave[%d] coalesced request 1st_addr[%d] nelem[%d] failed, not merging its %d transactions any more",
+                    this_mb_link_num, batch->slave_id, batch->first_addr, batch->nelem, batch->ntx);
+                for (tx_counter = 0; tx_counter < batch->ntx; tx_counter++) {
+                    gbl.mb_tx[batch->tx[tx_counter]].no_merge = 1;
+                }
             }
 
-            //wait time to gbl.slowdown activity (debugging)
-            if (gbl.slowdown > 0) {
-                DBG(this_mb_tx->cfg_debug, "mb_tx_num[%d] mb_links[%d] thread[%d] fd[%d] gbl.slowdown activated [%0.3f]",
-                    this_mb_tx_num, this_mb_tx->mb_link_num, this_mb_link_num, modbus_get_socket(this_mb_link->modbus), gbl.slowdown);
-                usleep(gbl.slowdown * 1000 * 1000);
+            for (tx_counter = 0; tx_counter < batch->ntx; tx_counter++) {
+                finish_tx(this_mb_link, &gbl.mb_tx[batch->tx[tx_counter]], batch->ret);
             }
-        }  //end for
+        }
+
+        //wait time for serial lines
+        if (this_mb_tx->cfg_link_type == linkRTU) {
+            DBG(this_mb_tx->cfg_debug, "mb_tx_num[%d] mb_links[%d] thread[%d] fd[%d] SERIAL_DELAY_MS activated [%d]",
+                this_mb_tx_num, this_mb_tx->mb_link_num, this_mb_link_num, modbus_get_socket(this_mb_link->modbus),
+                this_mb_tx->cfg_serial_delay_ms);
+            usleep(this_mb_tx->cfg_serial_delay_ms * 1000);
+        }
+
+        //wait time to gbl.slowdown activity (debugging)
+        if (gbl.slowdown > 0) {
+            DBG(this_mb_tx->cfg_debug, "mb_tx_num[%d] mb_links[%d] thread[%d] fd[%d] gbl.slowdown activated [%0.3f]",
+                this_mb_tx_num, this_mb_tx->mb_link_num, this_mb_link_num, modbus_get_socket(this_mb_link->modbus), gbl.slowdown);
+            usleep(gbl.slowdown * 1000 * 1000);
+        }
 
     } //end while
 
@@ -254,46 +284,36 @@ void *link_loop_and_logic(void *thrd_link_num)
 }
 
 /*
- * Check if the transaction is available for this link
+ * Account the result of a transaction and queue it for its next update
  */
 
-retCode is_this_tx_ready(const int this_mb_link_num, const int this_mb_tx_num, int *ret_available)
+void finish_tx(mb_link_t *this_mb_link, mb_tx_t *this_mb_tx, retCode ret)
 {
-    char *fnct_name = "is_this_tx_available";
-    mb_tx_t *this_mb_tx;
-    int this_mb_tx_link_num;
-
-    if (this_mb_tx_num < 0 || this_mb_tx_num > gbl.tot_mb_tx) {
-        ERR(gbl.init_dbg, "parameter out of range this_mb_tx_num[%d]", this_mb_tx_num);
-        return retERR;
-    }
-    this_mb_tx = &gbl.mb_tx[this_mb_tx_num];
-
-    if (ret_available == NULL) {
-        ERR(this_mb_tx->cfg_debug, "NULL pointer");
-        return retERR;
+    char *fnct_name = "finish_tx";
+    double now = get_time();
+
+    if (ret != retOK && modbus_get_socket(this_mb_link->modbus) < 0) { //link failure
+        (**this_mb_tx->num_errors)++;
+        ERR(this_mb_tx->cfg_debug, "mb_tx_num[%d] mb_links[%d] fd[%d] link failure, going to close link",
+            this_mb_tx->mb_tx_num, this_mb_tx->mb_link_num, modbus_get_socket(this_mb_link->modbus));
+        modbus_close(this_mb_link->modbus);
     }
-
-    this_mb_tx_link_num = this_mb_tx->mb_link_num;
-    if (this_mb_tx_link_num < 0 || this_mb_tx_link_num >= gbl.tot_mb_links) {
-        ERR(this_mb_tx->cfg_debug, "parameter out of range this_mb_tx_link_num[%d]", this_mb_tx_link_num);
-        return retERR;
+    else if (ret != retOK) {  //transaction failure but link OK
+        (**this_mb_tx->num_errors)++;
+        ERR(this_mb_tx->cfg_debug, "mb_tx_num[%d] mb_links[%d] fd[%d] transaction failure, num_errors[%d]",
+            this_mb_tx->mb_tx_num, this_mb_tx->mb_link_num, modbus_get_socket(this_mb_link->modbus), **this_mb_tx->num_errors);
     }
-
-    *ret_available = 0; //defaults to not available
-
-    //the tx is not of this link
-    if (this_mb_link_num != this_mb_tx_link_num) {
-        return retOK;
+    else { //transaction and link OK
+        OK(this_mb_tx->cfg_debug, "mb_tx_num[%d] mb_links[%d] fd[%d] transaction OK, update_HZ[%0.03f]",
+           this_mb_tx->mb_tx_num, this_mb_tx->mb_link_num, modbus_get_socket(this_mb_link->modbus),
+           1.0/(now-this_mb_tx->last_time_ok));
+        update_tx_stats(this_mb_tx, now);
+        (**this_mb_tx->num_errors) = 0;
     }
 
-    //not now
-    if (get_time() < this_mb_tx->next_time) {
-        return retOK;
-    }
-
-    *ret_available = 1; //is available
-    return retOK;
+    //set the next (waiting) time for update rate
+    this_mb_tx->next_time = now + this_mb_tx->time_increment;
+    queue_insert(this_mb_link, this_mb_tx->mb_tx_num);
 }
 
 /*
@@ -393,6 +413,9 @@ void set_init_gbl_params()
     gbl.hal_mod_id   = -1;
     gbl.init_dbg     = debugERR; //until readed in config file
     gbl.slowdown     = 0;        //until readed in config file
+    gbl.coalesce     = 0;        //until readed in config file
+    gbl.coalesce_gap = 0;        //until readed in config file
+    gbl.tcp_pipeline = 1;        //until readed in config file
     gbl.mb_tx_fncts[mbtxERR]                         = "";
     gbl.mb_tx_fncts[mbtx_02_READ_DISCRETE_INPUTS]    = "fnct_02_read_discrete_inputs";
     gbl.mb_tx_fncts[mbtx_03_READ_HOLDING_REGISTERS]  = "fnct_03_read_holding_registers";
@@ -430,12 +453,20 @@ void quit_cleanup(void)
 
     DBG(gbl.init_dbg, "started");
 
+    if (gbl.mb_tx != NULL && gbl.hal_mod_id >= 0) {
+        print_tx_stats();
+    }
+
     for (counter = 0; counter < gbl.tot_mb_links; counter++) {
         if (gbl.mb_links[counter].modbus != NULL) {
             modbus_close(gbl.mb_links[counter].modbus);
             modbus_free(gbl.mb_links[counter].modbus);
             gbl.mb_links[counter].modbus = NULL;
         }
+        if (gbl.mb_links[counter].queue != NULL) {
+            free(gbl.mb_links[counter].queue);
+            gbl.mb_links[counter].queue = NULL;
+        }
     }
     gbl.tot_mb_links = 0;
 
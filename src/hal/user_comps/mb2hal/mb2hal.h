@@ -29,6 +29,9 @@
 #define MB2HAL_MAX_FNCT05_ELEMENTS 100
 #define MB2HAL_MAX_FNCT15_ELEMENTS 100
 #define MB2HAL_MAX_FNCT16_ELEMENTS 100
+#define MB2HAL_MAX_MERGED_TX        32 //transactions in one coalesced request
+#define MB2HAL_MAX_TCP_PIPELINE     16 //Modbus/TCP requests in flight per link
+#define MB2HAL_MAX_IDLE_SLEEP_S    0.1 //longest sleep while no tx is due
 
 #ifdef MODULE_VERBOSE
 MODULE_VERBOSE(emc2, "component:mb2hal:Userspace HAL component to communicate with one or more Modbus devices");
@@ -93,6 +96,12 @@ typedef struct {
     double time_increment; //wait time between tx
     double next_time;      //next time for this tx
     double last_time_ok;   //last OK tx time
+    int    no_merge;       //a coalesced request with this tx failed, run it alone
+    //achieved update rate and jitter, intervals between OK tx
+    int    stat_n;
+    double stat_sum;
+    double stat_sumsq;
+    double stat_max;
     //HAL related params
     char hal_tx_name[HAL_NAME_LEN + 1];
     hal_float_t **float_value;
@@ -101,6 +110,8 @@ typedef struct {
     //hal_float_t *offset; //not yet implemented
     hal_bit_t **bit;
     hal_u32_t **num_errors;     //num of acummulated errors (0=last tx OK)
+    hal_float_t **update_hz;    //achieved update rate
+    hal_float_t **jitter_ms;    //std deviation of the update interval
 } mb_tx_t;
 
 //Modbus link structure (mb_link_t)
@@ -123,8 +134,27 @@ typedef struct {
     int mb_link_num;       //corresponding number of this link/thread
     modbus_t *modbus;
     pthread_t thrd;
+    //scheduler
+    int *queue;            //tx numbers of this link, ordered by next_time
+    int  queue_len;
+    int  tcp_tid;          //last Modbus/TCP transaction id sent
 } mb_link_t;
 
+//Modbus request structure (mb_batch_t)
+//One request on the wire: a single transaction, or several transactions
+//of the same function and slave with adjacent address ranges coalesced
+typedef struct {
+    mb_tx_fnct fnct;
+    int slave_id;
+    int first_addr;        //range covered by all tx
+    int nelem;
+    int ntx;
+    int tx[MB2HAL_MAX_MERGED_TX];
+    int tid;               //Modbus/TCP transaction id when pipelined
+    retCode ret;
+    int range_error;       //slave answered illegal data address or value
+} mb_batch_t;
+
 //Structure of global data (gbl_t)
 //Reduce functions parameters using this common global structure.
 typedef struct {
@@ -134,6 +164,9 @@ typedef struct {
     //INI config, common section
     int    init_dbg;
     double slowdown;
+    int    coalesce;       //merge adjacent transactions
+    int    coalesce_gap;   //max unused elements between merged read ranges
+    int    tcp_pipeline;   //max Modbus/TCP requests in flight
     //HAL related
     int   hal_mod_id;
     char *hal_mod_name;
@@ -152,8 +185,8 @@ extern gbl_t gbl;
 
 //mb2hal.c
 void *link_loop_and_logic(void *thrd_link_num);
-retCode is_this_tx_ready(const int this_mb_link_num, const int this_mb_tx_num, int *ret_available);
 retCode get_tx_connection(const int mb_tx_num, int *ret_connected);
+void finish_tx(mb_link_t *this_mb_link, mb_tx_t *this_mb_tx, retCode ret);
 void set_init_gbl_params();
 double get_time();
 void quit_signal(int signal);
@@ -170,14 +203,24 @@ retCode check_int_in(int n_args, const int int_value, ...);
 retCode check_str_in(int n_args, const char *str_value, ...);
 retCode init_mb_links();
 retCode init_mb_tx();
+retCode init_mb_queues();
 
 //mb2hal_hal.c
 retCode create_HAL_pins();
 retCode create_each_mb_tx_hal_pins(mb_tx_t *mb_tx);
 
+//mb2hal_sched.c
+void queue_insert(mb_link_t *this_mb_link, const int mb_tx_num);
+int  next_batch(mb_link_t *this_mb_link, double now, mb_batch_t *batch);
+double next_due_time(mb_link_t *this_mb_link);
+void update_tx_stats(mb_tx_t *this_mb_tx, double now);
+void print_tx_stats();
+
 //mb2hal_modbus.c
-retCode fnct_15_write_multiple_coils(mb_tx_t *this_mb_tx, mb_link_t *this_mb_link);
-retCode fnct_02_read_discrete_inputs(mb_tx_t *this_mb_tx, mb_link_t *this_mb_link);
-retCode fnct_04_read_input_registers(mb_tx_t *this_mb_tx, mb_link_t *this_mb_link);
-retCode fnct_03_read_holding_registers(mb_tx_t *this_mb_tx, mb_link_t *this_mb_link);
-retCode fnct_16_write_multiple_registers(mb_tx_t *this_mb_tx, mb_link_t *this_mb_link);
+retCode fnct_15_write_multiple_coils(mb_batch_t *batch, mb_link_t *this_mb_link);
+retCode fnct_02_read_discrete_inputs(mb_batch_t *batch, mb_link_t *this_mb_link);
+retCode fnct_04_read_input_registers(mb_batch_t *batch, mb_link_t *this_mb_link);
+retCode fnct_03_read_holding_registers(mb_batch_t *batch, mb_link_t *this_mb_link);
+retCode fnct_16_write_multiple_registers(mb_batch_t *batch, mb_link_t *this_mb_link);
+retCode tcp_send_batch(mb_batch_t *batch, mb_link_t *this_mb_link);
+retCode tcp_receive_batches(mb_batch_t *batches, int nbatches, mb_link_t *this_mb_link);
@@ -43,6 +43,30 @@ retCode create_each_mb_tx_hal_pins(mb_tx_t *mb_tx)
     **(mb_tx->num_errors) = 0;
     DBG(gbl.init_dbg, "mb_tx_num [%d] pin_name [%s]", mb_tx->mb_tx_num, hal_pin_name);
 
+    //update_hz and jitter_ms hal pins
+    mb_tx->update_hz = hal_malloc(sizeof(hal_float_t *));
+    mb_tx->jitter_ms = hal_malloc(sizeof(hal_float_t *));
+    if (mb_tx->update_hz == NULL || mb_tx->jitter_ms == NULL) {
+        ERR(gbl.init_dbg, "[%d] [%s] NULL hal_malloc update_hz/jitter_ms",
+            mb_tx->mb_tx_fnct, mb_tx->mb_tx_fnct_name);
+        return retERR;
+    }
+    snprintf(hal_pin_name, HAL_NAME_LEN, "%s.%s.update_hz", gbl.hal_mod_name, mb_tx->hal_tx_name);
+    if (0 != hal_pin_float_newf(HAL_OUT, mb_tx->update_hz, gbl.hal_mod_id, "%s", hal_pin_name)) {
+        ERR(gbl.init_dbg, "[%d] [%s] [%s] hal_pin_float_newf failed", mb_tx->mb_tx_fnct, mb_tx->mb_tx_fnct_name, hal_pin_name);
+        return retERR;
+    }
+    **(mb_tx->update_hz) = 0;
+    DBG(gbl.init_dbg, "mb_tx_num [%d] pin_name [%s]", mb_tx->mb_tx_num, hal_pin_name);
+
+    snprintf(hal_pin_name, HAL_NAME_LEN, "%s.%s.jitter_ms", gbl.hal_mod_name, mb_tx->hal_tx_name);
+    if (0 != hal_pin_float_newf(HAL_OUT, mb_tx->jitter_ms, gbl.hal_mod_id, "%s", hal_pin_name)) {
+        ERR(gbl.init_dbg, "[%d] [%s] [%s] hal_pin_float_newf failed", mb_tx->mb_tx_fnct, mb_tx->mb_tx_fnct_name, hal_pin_name);
+        return retERR;
+    }
+    **(mb_tx->jitter_ms) = 0;
+    DBG(gbl.init_dbg, "mb_tx_num [%d] pin_name [%s]", mb_tx->mb_tx_num, hal_pin_name);
+
     switch (mb_tx->mb_tx_fnct) {
 
     case mbtx_02_READ_DISCRETE_INPUTS:
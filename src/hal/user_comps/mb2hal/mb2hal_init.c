@@ -101,6 +101,26 @@ retCode parse_common_section()
     iniFindDouble(gbl.ini_file_ptr, tag, section, &gbl.slowdown);
     DBG(gbl.init_dbg, "[%s] [%s] [%0.3f]", section, tag, gbl.slowdown);
 
+    tag     = "COALESCE"; //optional
+    iniFindInt(gbl.ini_file_ptr, tag, section, &gbl.coalesce);
+    DBG(gbl.init_dbg, "[%s] [%s] [%d]", section, tag, gbl.coalesce);
+
+    tag     = "COALESCE_GAP"; //optional
+    iniFindInt(gbl.ini_file_ptr, tag, section, &gbl.coalesce_gap);
+    if (gbl.coalesce_gap < 0) {
+        ERR(gbl.init_dbg, "[%s] [%s] [%d], must be >= 0", section, tag, gbl.coalesce_gap);
+        return retERR;
+    }
+    DBG(gbl.init_dbg, "[%s] [%s] [%d]", section, tag, gbl.coalesce_gap);
+
+    tag     = "TCP_PIPELINE"; //optional
+    iniFindInt(gbl.ini_file_ptr, tag, section, &gbl.tcp_pipeline);
+    if (gbl.tcp_pipeline < 1 || gbl.tcp_pipeline > MB2HAL_MAX_TCP_PIPELINE) {
+        ERR(gbl.init_dbg, "[%s] [%s] [%d], must be 1..%d", section, tag, gbl.tcp_pipeline, MB2HAL_MAX_TCP_PIPELINE);
+        return retERR;
+    }
+    DBG(gbl.init_dbg, "[%s] [%s] [%d]", section, tag, gbl.tcp_pipeline);
+
     tag     = "TOTAL_TRANSACTIONS"; //required
     if (iniFindInt(gbl.ini_file_ptr, tag, section, &gbl.tot_mb_tx) != 0) {
         ERR(gbl.init_dbg, "required [%s] [%s] not found", section, tag);
@@ -724,3 +744,31 @@ retCode init_mb_tx()
 
     return retOK;
 }
+
+/*
+ * init the scheduler queue of each link with its transactions
+ * (after init_mb_tx, all are due at once)
+ */
+retCode init_mb_queues()
+{
+    char *fnct_name="init_mb_queues";
+    int tx_counter, lk_counter;
+    mb_link_t *this_mb_link;
+
+    for (lk_counter = 0; lk_counter < gbl.tot_mb_links; lk_counter++) {
+        this_mb_link = &gbl.mb_links[lk_counter];
+        this_mb_link->queue = malloc(sizeof(int) * gbl.tot_mb_tx);
+        if (this_mb_link->queue == NULL) {
+            ERR(gbl.init_dbg, "malloc queue of link %d failed [%s]", lk_counter, strerror(errno));
+            return retERR;
+        }
+        this_mb_link->queue_len = 0;
+        this_mb_link->tcp_tid = 0;
+    }
+
+    for (tx_counter = 0; tx_counter < gbl.tot_mb_tx; tx_counter++) {
+        queue_insert(&gbl.mb_links[gbl.mb_tx[tx_counter].mb_link_num], tx_counter);
+    }
+
+    return retOK;
+}
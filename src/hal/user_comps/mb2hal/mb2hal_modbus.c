@@ -1,188 +1,424 @@
 #include <sys/time.h>
+#include <sys/socket.h>
+#include <errno.h>
 #include "mb2hal.h"
 
-retCode fnct_02_read_discrete_inputs(mb_tx_t *this_mb_tx, mb_link_t *this_mb_link)
+//Modbus function codes of mb_tx_fnct
+static const uint8_t fnct_code[mbtxMAX] = { 0, 0x02, 0x03, 0x04, 0x0F, 0x10 };
+
+/*
+ * A request may carry several coalesced transactions: copy between the
+ * request buffer, which starts at batch->first_addr, and the HAL pins
+ * of each transaction
+ */
+
+static void store_bits(mb_batch_t *batch, const uint8_t *bits)
 {
-    char *fnct_name = "fnct_02_read_discrete_inputs";
-    int counter, ret;
-    uint8_t bits[MB2HAL_MAX_FNCT02_ELEMENTS];
+    int counter, tx_counter;
 
-    if (this_mb_tx == NULL || this_mb_link == NULL) {
-        return retERR;
+    for (tx_counter = 0; tx_counter < batch->ntx; tx_counter++) {
+        mb_tx_t *this_mb_tx = &gbl.mb_tx[batch->tx[tx_counter]];
+        const uint8_t *src = bits + this_mb_tx->mb_tx_1st_addr - batch->first_addr;
+
+        for (counter = 0; counter < this_mb_tx->mb_tx_nelem; counter++) {
+            *(this_mb_tx->bit[counter]) = src[counter];
+        }
     }
-    if (this_mb_tx->mb_tx_nelem > MB2HAL_MAX_FNCT02_ELEMENTS) {
-        return retERR;
+}
+
+static void store_registers(mb_batch_t *batch, const uint16_t *data)
+{
+    int counter, tx_counter;
+
+    for (tx_counter = 0; tx_counter < batch->ntx; tx_counter++) {
+        mb_tx_t *this_mb_tx = &gbl.mb_tx[batch->tx[tx_counter]];
+        const uint16_t *src = data + this_mb_tx->mb_tx_1st_addr - batch->first_addr;
+
+        for (counter = 0; counter < this_mb_tx->mb_tx_nelem; counter++) {
+            float val = src[counter];
+            //val *= this_mb_tx->scale[counter];
+            //val += this_mb_tx->offset[counter];
+            *(this_mb_tx->float_value[counter]) = val;
+            *(this_mb_tx->int_value[counter]) = (hal_s32_t) val;
+        }
     }
+}
 
-    DBG(this_mb_tx->cfg_debug, "mb_tx[%d] mb_links[%d] slave[%d] fd[%d] 1st_addr[%d] nelem[%d]",
-        this_mb_tx->mb_tx_num, this_mb_tx->mb_link_num, this_mb_tx->mb_tx_slave_id, modbus_get_socket(this_mb_link->modbus),
-        this_mb_tx->mb_tx_1st_addr, this_mb_tx->mb_tx_nelem);
+static void load_bits(mb_batch_t *batch, uint8_t *bits)
+{
+    int counter, tx_counter;
 
-    ret = modbus_read_input_bits(this_mb_link->modbus, this_mb_tx->mb_tx_1st_addr, this_mb_tx->mb_tx_nelem, bits);
-    if (ret < 0) {
-        if (modbus_get_socket(this_mb_link->modbus) < 0) {
-            modbus_close(this_mb_link->modbus);
+    for (tx_counter = 0; tx_counter < batch->ntx; tx_counter++) {
+        mb_tx_t *this_mb_tx = &gbl.mb_tx[batch->tx[tx_counter]];
+        uint8_t *dst = bits + this_mb_tx->mb_tx_1st_addr - batch->first_addr;
+
+        for (counter = 0; counter < this_mb_tx->mb_tx_nelem; counter++) {
+            dst[counter] = *(this_mb_tx->bit[counter]);
         }
-        ERR(this_mb_tx->cfg_debug, "mb_tx[%d] mb_links[%d] slave[%d] = ret[%d] fd[%d]",
-            this_mb_tx->mb_tx_num, this_mb_tx->mb_link_num, this_mb_tx->mb_tx_slave_id, ret,
-            modbus_get_socket(this_mb_link->modbus));
-        return retERR;
     }
+}
+
+static void load_registers(mb_batch_t *batch, uint16_t *data)
+{
+    int counter, tx_counter;
 
-    for (counter = 0; counter < this_mb_tx->mb_tx_nelem; counter++) {
-        *(this_mb_tx->bit[counter]) = bits[counter];
+    for (tx_counter = 0; tx_counter < batch->ntx; tx_counter++) {
+        mb_tx_t *this_mb_tx = &gbl.mb_tx[batch->tx[tx_counter]];
+        uint16_t *dst = data + this_mb_tx->mb_tx_1st_addr - batch->first_addr;
+
+        for (counter = 0; counter < this_mb_tx->mb_tx_nelem; counter++) {
+            //float val = *(this_mb_tx->float_value[counter]) / this_mb_tx->scale[counter];
+            //val -= this_mb_tx->offset[counter];
+            float val = *(this_mb_tx->float_value[counter]);
+            dst[counter] = (int) val;
+        }
     }
+}
 
-    return retOK;
+static void batch_debug(const char *fnct_name, mb_batch_t *batch, mb_link_t *this_mb_link)
+{
+    mb_tx_t *this_mb_tx = &gbl.mb_tx[batch->tx[0]];
+
+    DBG(this_mb_tx->cfg_debug, "mb_tx[%d] mb_links[%d] slave[%d] fd[%d] 1st_addr[%d] nelem[%d] ntx[%d]",
+        this_mb_tx->mb_tx_num, this_mb_tx->mb_link_num, batch->slave_id, modbus_get_socket(this_mb_link->modbus),
+        batch->first_addr, batch->nelem, batch->ntx);
 }
 
-retCode fnct_03_read_holding_registers(mb_tx_t *this_mb_tx, mb_link_t *this_mb_link)
+static retCode batch_error(const char *fnct_name, mb_batch_t *batch, mb_link_t *this_mb_link, int ret)
 {
-    char *fnct_name = "fnct_03_read_holding_registers";
-    int counter, ret;
-    uint16_t data[MB2HAL_MAX_FNCT03_ELEMENTS];
+    mb_tx_t *this_mb_tx = &gbl.mb_tx[batch->tx[0]];
+
+    batch->range_error = (errno == EMBXILADD || errno == EMBXILVAL);
+    if (modbus_get_socket(this_mb_link->modbus) < 0) {
+        modbus_close(this_mb_link->modbus);
+    }
+    ERR(this_mb_tx->cfg_debug, "mb_tx[%d] mb_links[%d] slave[%d] = ret[%d] fd[%d]",
+        this_mb_tx->mb_tx_num, this_mb_tx->mb_link_num, batch->slave_id, ret,
+        modbus_get_socket(this_mb_link->modbus));
+    return retERR;
+}
+
+retCode fnct_02_read_discrete_inputs(mb_batch_t *batch, mb_link_t *this_mb_link)
+{
+    char *fnct_name = "fnct_02_read_discrete_inputs";
+    int ret;
+    uint8_t bits[MODBUS_MAX_READ_BITS];
 
-    if (this_mb_tx == NULL || this_mb_link == NULL) {
+    if (batch == NULL || this_mb_link == NULL) {
         return retERR;
     }
-    if (this_mb_tx->mb_tx_nelem > MB2HAL_MAX_FNCT03_ELEMENTS) {
+    if (batch->nelem > MODBUS_MAX_READ_BITS) {
         return retERR;
     }
 
-    DBG(this_mb_tx->cfg_debug, "mb_tx[%d] mb_links[%d] slave[%d] fd[%d] 1st_addr[%d] nelem[%d]",
-        this_mb_tx->mb_tx_num, this_mb_tx->mb_link_num, this_mb_tx->mb_tx_slave_id,
-        modbus_get_socket(this_mb_link->modbus), this_mb_tx->mb_tx_1st_addr, this_mb_tx->mb_tx_nelem);
+    batch_debug(fnct_name, batch, this_mb_link);
 
-    ret = modbus_read_registers(this_mb_link->modbus, this_mb_tx->mb_tx_1st_addr, this_mb_tx->mb_tx_nelem, data);
+    ret = modbus_read_input_bits(this_mb_link->modbus, batch->first_addr, batch->nelem, bits);
     if (ret < 0) {
-        if (modbus_get_socket(this_mb_link->modbus) < 0) {
-            modbus_close(this_mb_link->modbus);
-        }
-        ERR(this_mb_tx->cfg_debug, "mb_tx[%d] mb_links[%d] slave[%d] = ret[%d] fd[%d]",
-            this_mb_tx->mb_tx_num, this_mb_tx->mb_link_num, this_mb_tx->mb_tx_slave_id, ret,
-            modbus_get_socket(this_mb_link->modbus));
+        return batch_error(fnct_name, batch, this_mb_link, ret);
+    }
+
+    store_bits(batch, bits);
+    return retOK;
+}
+
+retCode fnct_03_read_holding_registers(mb_batch_t *batch, mb_link_t *this_mb_link)
+{
+    char *fnct_name = "fnct_03_read_holding_registers";
+    int ret;
+    uint16_t data[MODBUS_MAX_READ_REGISTERS];
+
+    if (batch == NULL || this_mb_link == NULL) {
+        return retERR;
+    }
+    if (batch->nelem > MODBUS_MAX_READ_REGISTERS) {
         return retERR;
     }
 
-    for (counter = 0; counter < this_mb_tx->mb_tx_nelem; counter++) {
-        float val = data[counter];
-        //val *= this_mb_tx->scale[counter];
-        //val += this_mb_tx->offset[counter];
-        *(this_mb_tx->float_value[counter]) = val;
-        *(this_mb_tx->int_value[counter]) = (hal_s32_t) val;
+    batch_debug(fnct_name, batch, this_mb_link);
+
+    ret = modbus_read_registers(this_mb_link->modbus, batch->first_addr, batch->nelem, data);
+    if (ret < 0) {
+        return batch_error(fnct_name, batch, this_mb_link, ret);
     }
 
+    store_registers(batch, data);
     return retOK;
 }
 
-retCode fnct_04_read_input_registers(mb_tx_t *this_mb_tx, mb_link_t *this_mb_link)
+retCode fnct_04_read_input_registers(mb_batch_t *batch, mb_link_t *this_mb_link)
 {
     char *fnct_name = "fnct_04_read_input_registers";
-    int counter, ret;
-    uint16_t data[MB2HAL_MAX_FNCT04_ELEMENTS];
+    int ret;
+    uint16_t data[MODBUS_MAX_READ_REGISTERS];
 
-    if (this_mb_tx == NULL || this_mb_link == NULL) {
+    if (batch == NULL || this_mb_link == NULL) {
         return retERR;
     }
-    if (this_mb_tx->mb_tx_nelem > MB2HAL_MAX_FNCT04_ELEMENTS) {
+    if (batch->nelem > MODBUS_MAX_READ_REGISTERS) {
         return retERR;
     }
 
-    DBG(this_mb_tx->cfg_debug, "mb_tx[%d] mb_links[%d] slave[%d] fd[%d] 1st_addr[%d] nelem[%d]",
-        this_mb_tx->mb_tx_num, this_mb_tx->mb_link_num, this_mb_tx->mb_tx_slave_id,
-        modbus_get_socket(this_mb_link->modbus), this_mb_tx->mb_tx_1st_addr, this_mb_tx->mb_tx_nelem);
+    batch_debug(fnct_name, batch, this_mb_link);
 
-    ret = modbus_read_input_registers(this_mb_link->modbus, this_mb_tx->mb_tx_1st_addr, this_mb_tx->mb_tx_nelem, data);
+    ret = modbus_read_input_registers(this_mb_link->modbus, batch->first_addr, batch->nelem, data);
     if (ret < 0) {
-        if (modbus_get_socket(this_mb_link->modbus) < 0) {
-            modbus_close(this_mb_link->modbus);
-        }
-        ERR(this_mb_tx->cfg_debug, "mb_tx[%d] mb_links[%d] slave[%d] = ret[%d] fd[%d]",
-            this_mb_tx->mb_tx_num, this_mb_tx->mb_link_num, this_mb_tx->mb_tx_slave_id, ret,
-            modbus_get_socket(this_mb_link->modbus));
+        return batch_error(fnct_name, batch, this_mb_link, ret);
+    }
+
+    store_registers(batch, data);
+    return retOK;
+}
+
+retCode fnct_15_write_multiple_coils(mb_batch_t *batch, mb_link_t *this_mb_link)
+{
+    char *fnct_name = "fnct_15_write_multiple_coils";
+    int ret;
+    uint8_t bits[MODBUS_MAX_WRITE_BITS];
+
+    if (batch == NULL || this_mb_link == NULL) {
+        return retERR;
+    }
+    if (batch->nelem > MODBUS_MAX_WRITE_BITS) {
         return retERR;
     }
 
-    for (counter = 0; counter < this_mb_tx->mb_tx_nelem; counter++) {
-        float val = data[counter];
-        //val += this_mb_tx->offset[counter];
-        //val *= this_mb_tx->scale[counter];
-        *(this_mb_tx->float_value[counter]) = val;
-        *(this_mb_tx->int_value[counter]) = (hal_s32_t) val;
+    load_bits(batch, bits);
+
+    batch_debug(fnct_name, batch, this_mb_link);
+
+    ret = modbus_write_bits(this_mb_link->modbus, batch->first_addr, batch->nelem, bits);
+    if (ret < 0) {
+        return batch_error(fnct_name, batch, this_mb_link, ret);
     }
 
     return retOK;
 }
 
-retCode fnct_15_write_multiple_coils(mb_tx_t *this_mb_tx, mb_link_t *this_mb_link)
+retCode fnct_16_write_multiple_registers(mb_batch_t *batch, mb_link_t *this_mb_link)
 {
-    char *fnct_name = "fnct_15_write_multiple_coils";
-    int counter, ret;
-    uint8_t bits[MB2HAL_MAX_FNCT15_ELEMENTS];
+    char *fnct_name = "fnct_16_write_multiple_registers";
+    int ret;
+    uint16_t data[MODBUS_MAX_WRITE_REGISTERS];
 
-    if (this_mb_tx == NULL || this_mb_link == NULL) {
+    if (batch == NULL || this_mb_link == NULL) {
         return retERR;
     }
-    if (this_mb_tx->mb_tx_nelem > MB2HAL_MAX_FNCT15_ELEMENTS) {
+    if (batch->nelem > MODBUS_MAX_WRITE_REGISTERS) {
         return retERR;
     }
 
-    for (counter = 0; counter < this_mb_tx->mb_tx_nelem; counter++) {
-        bits[counter] = *(this_mb_tx->bit[counter]);
-    }
+    load_registers(batch, data);
 
-    DBG(this_mb_tx->cfg_debug, "mb_tx[%d] mb_links[%d] slave[%d] fd[%d] 1st_addr[%d] nelem[%d]",
-        this_mb_tx->mb_tx_num, this_mb_tx->mb_link_num, this_mb_tx->mb_tx_slave_id,
-        modbus_get_socket(this_mb_link->modbus), this_mb_tx->mb_tx_1st_addr, this_mb_tx->mb_tx_nelem);
+    batch_debug(fnct_name, batch, this_mb_link);
 
-    ret = modbus_write_bits(this_mb_link->modbus, this_mb_tx->mb_tx_1st_addr, this_mb_tx->mb_tx_nelem, bits);
+    ret = modbus_write_registers(this_mb_link->modbus, batch->first_addr, batch->nelem, data);
     if (ret < 0) {
-        if (modbus_get_socket(this_mb_link->modbus) < 0) {
-            modbus_close(this_mb_link->modbus);
-        }
-        ERR(this_mb_tx->cfg_debug, "mb_tx[%d] mb_links[%d] slave[%d] = ret[%d] fd[%d]",
-            this_mb_tx->mb_tx_num, this_mb_tx->mb_link_num, this_mb_tx->mb_tx_slave_id, ret,
-            modbus_get_socket(this_mb_link->modbus));
+        return batch_error(fnct_name, batch, this_mb_link, ret);
+    }
+
+    return retOK;
+}
+
+/*
+ * Pipelined Modbus/TCP
+ * libmodbus waits for the response of each request before returning, so
+ * to have several requests in flight the MBAP frames are built here and
+ * written to the link socket directly. The responses are read with
+ * modbus_receive_confirmation() and matched by transaction id.
+ */
+
+retCode tcp_send_batch(mb_batch_t *batch, mb_link_t *this_mb_link)
+{
+    char *fnct_name = "tcp_send_batch";
+    uint8_t  req[MODBUS_TCP_MAX_ADU_LENGTH];
+    uint8_t  bits[MODBUS_MAX_WRITE_BITS];
+    uint16_t data[MODBUS_MAX_WRITE_REGISTERS];
+    mb_tx_t *this_mb_tx;
+    int counter, len, nbytes, ret;
+
+    if (batch == NULL || this_mb_link == NULL) {
         return retERR;
     }
+    this_mb_tx = &gbl.mb_tx[batch->tx[0]];
+
+    this_mb_link->tcp_tid = (this_mb_link->tcp_tid + 1) & 0xffff;
+    batch->tid = this_mb_link->tcp_tid;
+
+    req[0] = batch->tid >> 8;
+    req[1] = batch->tid & 0xff;
+    req[2] = 0; //protocol id
+    req[3] = 0;
+    //req[4], req[5]: length, see below
+    req[6] = batch->slave_id;
+    req[7] = fnct_code[batch->fnct];
+    req[8] = batch->first_addr >> 8;
+    req[9] = batch->first_addr & 0xff;
+    req[10] = batch->nelem >> 8;
+    req[11] = batch->nelem & 0xff;
+    len = 12;
+
+    switch (batch->fnct) {
+    case mbtx_15_WRITE_MULTIPLE_COILS:
+        if (batch->nelem > MODBUS_MAX_WRITE_BITS) {
+            return retERR;
+        }
+        load_bits(batch, bits);
+        nbytes = (batch->nelem + 7) / 8;
+        req[len++] = nbytes;
+        memset(&req[len], 0, nbytes);
+        for (counter = 0; counter < batch->nelem; counter++) {
+            if (bits[counter]) {
+                req[len + counter / 8] |= 1 << (counter % 8);
+            }
+        }
+        len += nbytes;
+        break;
+    case mbtx_16_WRITE_MULTIPLE_REGISTERS:
+        if (batch->nelem > MODBUS_MAX_WRITE_REGISTERS) {
+            return retERR;
+        }
+        load_registers(batch, data);
+        req[len++] = batch->nelem * 2;
+        for (counter = 0; counter < batch->nelem; counter++) {
+            req[len++] = data[counter] >> 8;
+            req[len++] = data[counter] & 0xff;
+        }
+        break;
+    default:
+        break;
+    }
+    req[4] = (len - 6) >> 8;
+    req[5] = (len - 6) & 0xff;
 
+    batch_debug(fnct_name, batch, this_mb_link);
+    if (this_mb_tx->protocol_debug) {
+        for (counter = 0; counter < len; counter++) {
+            printf("[%.2X]", req[counter]);
+        }
+        printf("\n");
+    }
+
+    ret = send(modbus_get_socket(this_mb_link->modbus), req, len, MSG_NOSIGNAL);
+    if (ret != len) {
+        ERR(this_mb_tx->cfg_debug, "mb_tx[%d] mb_links[%d] tid[%d] send failed [%s], going to close link",
+            this_mb_tx->mb_tx_num, this_mb_tx->mb_link_num, batch->tid, strerror(errno));
+        modbus_close(this_mb_link->modbus);
+        return retERR;
+    }
     return retOK;
 }
 
-retCode fnct_16_write_multiple_registers(mb_tx_t *this_mb_tx, mb_link_t *this_mb_link)
+//pdu: function code and data of a response, len bytes
+static retCode tcp_parse_response(mb_batch_t *batch, const uint8_t *pdu, int len)
 {
-    char *fnct_name = "fnct_16_write_multiple_registers";
-    int counter, ret;
-    uint16_t data[MB2HAL_MAX_FNCT16_ELEMENTS];
+    char *fnct_name = "tcp_parse_response";
+    mb_tx_t *this_mb_tx = &gbl.mb_tx[batch->tx[0]];
+    uint8_t  bits[MODBUS_MAX_READ_BITS];
+    uint16_t data[MODBUS_MAX_READ_REGISTERS];
+    int counter;
 
-    if (this_mb_tx == NULL || this_mb_link == NULL) {
+    if (len >= 2 && pdu[0] == (fnct_code[batch->fnct] | 0x80)) {
+        batch->range_error = (pdu[1] == 2 || pdu[1] == 3); //illegal data address or value
+        ERR(this_mb_tx->cfg_debug, "mb_tx[%d] mb_links[%d] slave[%d] tid[%d] exception [%d]",
+            this_mb_tx->mb_tx_num, this_mb_tx->mb_link_num, batch->slave_id, batch->tid, pdu[1]);
         return retERR;
     }
-    if (this_mb_tx->mb_tx_nelem > MB2HAL_MAX_FNCT16_ELEMENTS) {
+    if (len < 2 || pdu[0] != fnct_code[batch->fnct]) {
+        ERR(this_mb_tx->cfg_debug, "mb_tx[%d] mb_links[%d] slave[%d] tid[%d] bad response",
+            this_mb_tx->mb_tx_num, this_mb_tx->mb_link_num, batch->slave_id, batch->tid);
         return retERR;
     }
 
-    for (counter = 0; counter < this_mb_tx->mb_tx_nelem; counter++) {
-        //float val = *(this_mb_tx->float_value[counter]) / this_mb_tx->scale[counter];
-        //val -= this_mb_tx->offset[counter];
-        float val = *(this_mb_tx->float_value[counter]);
-        data[counter] = (int) val;
+    switch (batch->fnct) {
+    case mbtx_02_READ_DISCRETE_INPUTS:
+        if (pdu[1] < (batch->nelem + 7) / 8 || len < 2 + pdu[1]) {
+            return retERR;
+        }
+        for (counter = 0; counter < batch->nelem; counter++) {
+            bits[counter] = (pdu[2 + counter / 8] >> (counter % 8)) & 1;
+        }
+        store_bits(batch, bits);
+        break;
+    case mbtx_03_READ_HOLDING_REGISTERS:
+    case mbtx_04_READ_INPUT_REGISTERS:
+        if (pdu[1] != batch->nelem * 2 || len < 2 + pdu[1]) {
+            return retERR;
+        }
+        for (counter = 0; counter < batch->nelem; counter++) {
+            data[counter] = (pdu[2 + 2 * counter] << 8) | pdu[3 + 2 * counter];
+        }
+        store_registers(batch, data);
+        break;
+    case mbtx_15_WRITE_MULTIPLE_COILS:
+    case mbtx_16_WRITE_MULTIPLE_REGISTERS:
+        if (len < 5 || ((pdu[1] << 8) | pdu[2]) != batch->first_addr
+                || ((pdu[3] << 8) | pdu[4]) != batch->nelem) {
+            return retERR;
+        }
+        break;
+    default:
+        return retERR;
     }
+    return retOK;
+}
 
-    DBG(this_mb_tx->cfg_debug, "mb_tx[%d] mb_links[%d] slave[%d] fd[%d] 1st_addr[%d] nelem[%d]",
-        this_mb_tx->mb_tx_num, this_mb_tx->mb_link_num, this_mb_tx->mb_tx_slave_id,
-        modbus_get_socket(this_mb_link->modbus), this_mb_tx->mb_tx_1st_addr, this_mb_tx->mb_tx_nelem);
+/*
+ * Wait for the responses of nbatches requests sent with tcp_send_batch()
+ * Sets batches[].ret, returns retERR if not all of them arrived.
+ */
 
-    ret = modbus_write_registers(this_mb_link->modbus, this_mb_tx->mb_tx_1st_addr, this_mb_tx->mb_tx_nelem, data);
-    if (ret < 0) {
-        if (modbus_get_socket(this_mb_link->modbus) < 0) {
-            modbus_close(this_mb_link->modbus);
-        }
-        ERR(this_mb_tx->cfg_debug, "mb_tx[%d] mb_links[%d] slave[%d] = ret[%d] fd[%d]",
-            this_mb_tx->mb_tx_num, this_mb_tx->mb_link_num, this_mb_tx->mb_tx_slave_id, ret,
-            modbus_get_socket(this_mb_link->modbus));
+retCode tcp_receive_batches(mb_batch_t *batches, int nbatches, mb_link_t *this_mb_link)
+{
+    char *fnct_name = "tcp_receive_batches";
+    uint8_t rsp[MODBUS_TCP_MAX_ADU_LENGTH];
+    int pending[MB2HAL_MAX_TCP_PIPELINE];
+    int counter, npending, ret, tid;
+    mb_tx_t *this_mb_tx;
+
+    if (batches == NULL || this_mb_link == NULL || nbatches > MB2HAL_MAX_TCP_PIPELINE) {
         return retERR;
     }
+    this_mb_tx = &gbl.mb_tx[batches[0].tx[0]];
 
+    npending = 0;
+    for (counter = 0; counter < nbatches; counter++) {
+        pending[counter] = (batches[counter].ret == retOK);
+        if (pending[counter]) {
+            batches[counter].ret = retERR;
+            npending++;
+        }
+    }
+
+    while (npending > 0) {
+        ret = modbus_receive_confirmation(this_mb_link->modbus, rsp);
+        if (ret < 0) {
+            //timeout or link failure, late responses are dropped as stale
+            ERR(this_mb_tx->cfg_debug, "mb_links[%d] fd[%d] %d responses missing [%s]",
+                this_mb_tx->mb_link_num, modbus_get_socket(this_mb_link->modbus),
+                npending, modbus_strerror(errno));
+            if (modbus_get_socket(this_mb_link->modbus) >= 0) {
+                modbus_flush(this_mb_link->modbus);
+            }
+            return retERR;
+        }
+        if (ret < 8) {
+            continue;
+        }
+        tid = (rsp[0] << 8) | rsp[1];
+        for (counter = 0; counter < nbatches; counter++) {
+            if (pending[counter] && batches[counter].tid == tid) {
+                break;
+            }
+        }
+        if (counter == nbatches) {
+            DBG(this_mb_tx->cfg_debug, "mb_links[%d] stale response tid[%d] dropped",
+                this_mb_tx->mb_link_num, tid);
+            continue;
+        }
+        pending[counter] = 0;
+        npending--;
+        batches[counter].ret = tcp_parse_response(&batches[counter], rsp + 7, ret - 7);
+    }
     return retOK;
 }
@@ -0,0 +1,211 @@
+#include <math.h>
+#include "mb2hal.h"
+
+/*
+ * Transaction scheduler
+ * Each link keeps the numbers of its transactions in a queue ordered by
+ * next_time, so the link thread only has to look at the head to know
+ * what is due next and how long it may sleep.
+ * With COALESCE=1 the transaction taken from the head is merged with
+ * others of the same function and slave whose address ranges are adjacent
+ * (reads: also overlapping or at most COALESCE_GAP elements apart) and
+ * which are due within half of their own update period, into one request.
+ */
+
+void queue_insert(mb_link_t *this_mb_link, const int mb_tx_num)
+{
+    double next_time = gbl.mb_tx[mb_tx_num].next_time;
+    int pos = this_mb_link->queue_len;
+
+    //behind all tx with an earlier or the same deadline
+    while (pos > 0 && gbl.mb_tx[this_mb_link->queue[pos - 1]].next_time > next_time) {
+        this_mb_link->queue[pos] = this_mb_link->queue[pos - 1];
+        pos--;
+    }
+    this_mb_link->queue[pos] = mb_tx_num;
+    this_mb_link->queue_len++;
+}
+
+static void queue_remove(mb_link_t *this_mb_link, const int pos)
+{
+    memmove(&this_mb_link->queue[pos], &this_mb_link->queue[pos + 1],
+            (this_mb_link->queue_len - pos - 1) * sizeof(int));
+    this_mb_link->queue_len--;
+}
+
+double next_due_time(mb_link_t *this_mb_link)
+{
+    if (this_mb_link->queue_len == 0) {
+        return get_time() + MB2HAL_MAX_IDLE_SLEEP_S;
+    }
+    return gbl.mb_tx[this_mb_link->queue[0]].next_time;
+}
+
+//largest request the Modbus protocol allows for fnct
+static int max_merged_nelem(const mb_tx_fnct fnct)
+{
+    switch (fnct) {
+    case mbtx_02_READ_DISCRETE_INPUTS:
+        return MODBUS_MAX_READ_BITS;
+    case mbtx_03_READ_HOLDING_REGISTERS:
+    case mbtx_04_READ_INPUT_REGISTERS:
+        return MODBUS_MAX_READ_REGISTERS;
+    case mbtx_15_WRITE_MULTIPLE_COILS:
+        return MODBUS_MAX_WRITE_BITS;
+    case mbtx_16_WRITE_MULTIPLE_REGISTERS:
+        return MODBUS_MAX_WRITE_REGISTERS;
+    default:
+        return 0;
+    }
+}
+
+static int can_merge(const mb_batch_t *batch, const mb_tx_t *this_mb_tx)
+{
+    int tx_last, batch_last, first, last;
+
+    if (batch->ntx >= MB2HAL_MAX_MERGED_TX || this_mb_tx->no_merge) {
+        return 0;
+    }
+    if (this_mb_tx->mb_tx_fnct != batch->fnct || this_mb_tx->mb_tx_slave_id != batch->slave_id) {
+        return 0;
+    }
+
+    tx_last    = this_mb_tx->mb_tx_1st_addr + this_mb_tx->mb_tx_nelem - 1;
+    batch_last = batch->first_addr + batch->nelem - 1;
+
+    if (batch->fnct == mbtx_15_WRITE_MULTIPLE_COILS || batch->fnct == mbtx_16_WRITE_MULTIPLE_REGISTERS) {
+        //writes: exactly adjacent, an element must not be written twice
+        if (this_mb_tx->mb_tx_1st_addr != batch_last + 1 && tx_last + 1 != batch->first_addr) {
+            return 0;
+        }
+    }
+    else if (this_mb_tx->mb_tx_1st_addr > batch_last + 1 + gbl.coalesce_gap
+             || tx_last + 1 + gbl.coalesce_gap < batch->first_addr) {
+        return 0;
+    }
+
+    first = (this_mb_tx->mb_tx_1st_addr < batch->first_addr) ? this_mb_tx->mb_tx_1st_addr : batch->first_addr;
+    last  = (tx_last > batch_last) ? tx_last : batch_last;
+    return (last - first + 1) <= max_merged_nelem(batch->fnct);
+}
+
+static void batch_add(mb_batch_t *batch, const mb_tx_t *this_mb_tx)
+{
+    int tx_last, batch_last;
+
+    if (batch->ntx == 0) {
+        batch->fnct       = this_mb_tx->mb_tx_fnct;
+        batch->slave_id   = this_mb_tx->mb_tx_slave_id;
+        batch->first_addr = this_mb_tx->mb_tx_1st_addr;
+        batch->nelem      = this_mb_tx->mb_tx_nelem;
+    }
+    else {
+        tx_last    = this_mb_tx->mb_tx_1st_addr + this_mb_tx->mb_tx_nelem - 1;
+        batch_last = batch->first_addr + batch->nelem - 1;
+        if (this_mb_tx->mb_tx_1st_addr < batch->first_addr) {
+            batch->first_addr = this_mb_tx->mb_tx_1st_addr;
+        }
+        if (tx_last > batch_last) {
+            batch_last = tx_last;
+        }
+        batch->nelem = batch_last - batch->first_addr + 1;
+    }
+    batch->tx[batch->ntx++] = this_mb_tx->mb_tx_num;
+}
+
+/*
+ * Take the tx at the head of the queue, if it is due at now, and merge
+ * what can be merged with it into batch.
+ * Returns 0 if nothing is due.
+ */
+
+int next_batch(mb_link_t *this_mb_link, double now, mb_batch_t *batch)
+{
+    mb_tx_t *this_mb_tx;
+    int pos, merged;
+
+    if (this_mb_link->queue_len == 0) {
+        return 0;
+    }
+    this_mb_tx = &gbl.mb_tx[this_mb_link->queue[0]];
+    if (this_mb_tx->next_time > now) {
+        return 0;
+    }
+
+    batch->ntx = 0;
+    batch->tid = 0;
+    batch->ret = retOK;
+    batch->range_error = 0;
+    batch_add(batch, this_mb_tx);
+    queue_remove(this_mb_link, 0);
+
+    if (gbl.coalesce == 0 || this_mb_tx->no_merge) {
+        return 1;
+    }
+
+    //merging may close the gap to tx seen earlier, so rescan until stable
+    do {
+        merged = 0;
+        for (pos = 0; pos < this_mb_link->queue_len; pos++) {
+            this_mb_tx = &gbl.mb_tx[this_mb_link->queue[pos]];
+            if (this_mb_tx->next_time > now + this_mb_tx->time_increment / 2) {
+                break; //ordered by next_time, none of the rest is due either
+            }
+            if (can_merge(batch, this_mb_tx)) {
+                batch_add(batch, this_mb_tx);
+                queue_remove(this_mb_link, pos);
+                merged = 1;
+                break;
+            }
+        }
+    } while (merged);
+
+    return 1;
+}
+
+/*
+ * Achieved update rate and jitter, from the intervals between
+ * successful transactions
+ */
+
+void update_tx_stats(mb_tx_t *this_mb_tx, double now)
+{
+    double dt, mean, var;
+
+    if (this_mb_tx->last_time_ok > 0) {
+        dt = now - this_mb_tx->last_time_ok;
+        this_mb_tx->stat_n++;
+        this_mb_tx->stat_sum   += dt;
+        this_mb_tx->stat_sumsq += dt * dt;
+        if (dt > this_mb_tx->stat_max) {
+            this_mb_tx->stat_max = dt;
+        }
+        mean = this_mb_tx->stat_sum / this_mb_tx->stat_n;
+        var  = this_mb_tx->stat_sumsq / this_mb_tx->stat_n - mean * mean;
+        **this_mb_tx->update_hz = 1.0 / mean;
+        **this_mb_tx->jitter_ms = (var > 0) ? sqrt(var) * 1000 : 0;
+    }
+    this_mb_tx->last_time_ok = now;
+}
+
+void print_tx_stats()
+{
+    char *fnct_name = "print_tx_stats";
+    mb_tx_t *this_mb_tx;
+    double mean, var;
+    int tx_counter;
+
+    for (tx_counter = 0; tx_counter < gbl.tot_mb_tx; tx_counter++) {
+        this_mb_tx = &gbl.mb_tx[tx_counter];
+        if (this_mb_tx->stat_n == 0) {
+            OK(gbl.init_dbg, "mb_tx_num[%d] [%s] no successful updates", tx_counter, this_mb_tx->hal_tx_name);
+            continue;
+        }
+        mean = this_mb_tx->stat_sum / this_mb_tx->stat_n;
+        var  = this_mb_tx->stat_sumsq / this_mb_tx->stat_n - mean * mean;
+        OK(gbl.init_dbg, "mb_tx_num[%d] [%s] updates[%d] update_HZ[%0.3f] jitter_ms[%0.3f] max_interval_ms[%0.3f] num_errors[%d]",
+           tx_counter, this_mb_tx->hal_tx_name, this_mb_tx->stat_n + 1, 1.0 / mean,
+           (var > 0) ? sqrt(var) * 1000 : 0, this_mb_tx->stat_max * 1000,
+           **this_mb_tx->num_errors);
+    }
+}
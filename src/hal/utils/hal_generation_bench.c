@@ -0,0 +1,101 @@
+/* hal-generation-bench: cost of the write generation counter in the v2
+ * pin setters (hal_accessor.h) as seen by a realtime funct.
+ *
+ * Calls set_s32_pin() on 64 unlinked pins, laid out as in the HAL
+ * segment (data_ptr pointing to dummysig, dummygen behind it), in a
+ * private arena standing in for that segment:
+ *
+ *   before    the setter as it was before generations, an unconditional
+ *             store; kept here as old_set_s32_pin()
+ *   changing  set_s32_pin() with a new value on every call, so every
+ *             call also bumps the generation
+ *   steady    set_s32_pin() writing the value the pin already has,
+ *             which is the common case for most pins in a thread cycle
+ *
+ * Userland only, no realtime needed. The time per call includes the loop.
+ * Built by 'make bench', not installed.
+ *
+ *   hal-generation-bench [-n calls]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "rtapi.h"
+#include "hal.h"
+#include "hal_priv.h"
+#include "hal_accessor.h"
+
+#define NPINS 64
+
+char *hal_shmem_base;
+
+static s32_pin_ptr pins[NPINS];
+
+// the pre-generation PINSETTER body
+static inline void old_set_s32_pin(s32_pin_ptr p, hal_s32_t value)
+{
+    hal_pin_t *pin = (hal_pin_t *) hal_ptr(p._sp);
+    hal_data_u *u = (hal_data_u *) hal_ptr(pin->data_ptr);
+    _SETVALUE32(pin, _s, value, S32CAST);
+}
+
+static double now(void)
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static void report(const char *what, double t, long n)
+{
+    printf("%-10s %6.2f ns/call\n", what, t / n * 1e9);
+}
+
+int main(int argc, char **argv)
+{
+    long n = 200000000, i;
+    hal_pin_t *pin;
+    double t0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:")) != -1) {
+	switch (opt) {
+	case 'n':
+	    n = atol(optarg);
+	    break;
+	default:
+	    fprintf(stderr, "usage: %s [-n calls]\n", argv[0]);
+	    return 1;
+	}
+    }
+
+    // offset 0 is the NULL pin, start the pins behind it
+    hal_shmem_base = calloc(NPINS + 1, sizeof(hal_pin_t));
+    for (i = 0; i < NPINS; i++) {
+	pin = (hal_pin_t *) hal_shmem_base + i + 1;
+	pin->data_ptr = hal_off(&pin->dummysig);
+	pins[i]._sp = hal_off(pin);
+    }
+
+    t0 = now();
+    for (i = 0; i < n; i++)
+	old_set_s32_pin(pins[i & (NPINS - 1)], i >> 6);
+    report("before", now() - t0, n);
+
+    t0 = now();
+    for (i = 0; i < n; i++)
+	set_s32_pin(pins[i & (NPINS - 1)], i >> 6);
+    report("changing", now() - t0, n);
+
+    t0 = now();
+    for (i = 0; i < n; i++)
+	set_s32_pin(pins[i & (NPINS - 1)], 7);
+    report("steady", now() - t0, n);
+
+    free(hal_shmem_base);
+    return 0;
+}
@@ -257,6 +257,7 @@ struct halcmd_command halcmd_commands[] = {
     {"newinst",  FUNCT(do_newinst_cmd),  A_TWO | A_PLUS },
     {"delinst",  FUNCT(do_delinst_cmd),  A_ONE },
     {"call",  FUNCT(do_callfunc_cmd),  A_ONE | A_PLUS },
+    {"lcompile", FUNCT(do_lcompile_cmd), A_TWO | A_PLUS },
     {"autoload", FUNCT(do_autoload_cmd),  A_ONE | A_OPTIONAL },
 };
 int halcmd_ncommands = (sizeof(halcmd_commands) / sizeof(halcmd_commands[0]));
@@ -733,6 +733,8 @@ int do_setp_cmd(char *name, char *value)
     }
 
     retval = set_common(type, d_ptr, value);
+    if ((retval == 0) && (param == 0))
+	hal_bump_generation(d_ptr);
 
     rtapi_mutex_give(&(hal_data->mutex));
     if (retval == 0) {
@@ -885,6 +887,8 @@ int do_sets_cmd(char *name, char *value)
     type = sig->type;
     d_ptr = sig_value(sig);
     retval = set_common(type, d_ptr, value);
+    if (retval == 0)
+	hal_bump_generation(d_ptr);
     rtapi_mutex_give(&(hal_data->mutex));
     if (retval == 0) {
 	/* print success message */
@@ -2466,8 +2470,12 @@ static int print_heap(char **patterns)
     if (MMAP_OK(hal_data)) {
 	struct rtapi_heap_stat hs;
 	rtapi_heap_status(&hal_data->heap, &hs);
-	halcmd_output("total_avail=%zu fragments=%zu largest=%zu\n",
-		      hs.total_avail, hs.fragments, hs.largest);
+	halcmd_output("total_avail=%zu fragments=%zu largest=%zu"
+		      " fragmentation=%zu%%\n",
+		      hs.total_avail, hs.fragments, hs.largest,
+		      hs.fragmentation);
+	halcmd_output("size classes: inuse=%zu cached=%zu chunks=%zu\n",
+		      hs.slab_inuse, hs.slab_cached, hs.slab_chunks);
     }
     return 0;
 }
@@ -2549,10 +2557,14 @@ static int print_thread_entry(hal_object_ptr o, foreach_args_t *args)
     if (match(patterns, ho_name(tptr))) {
 	// note that the scriptmode format string has no \n
 	// TODO FIXME add thread runtime and max runtime to this print
+	    static const char *timing[] = {
+		[TT_FULL] = "", [TT_TSC] = " timing=tsc",
+		[TT_SAMPLED] = " timing=sampled", [TT_OFF] = " timing=off" };
 	    char flags[100];
-	    snprintf(flags, sizeof(flags),"%s%s",
+	    snprintf(flags, sizeof(flags),"%s%s%s",
 		     tptr->flags & TF_NONRT ? "posix ":"",
-		     tptr->flags & TF_NOWAIT ? "nowait":"");
+		     tptr->flags & TF_NOWAIT ? "nowait":"",
+		     timing[tptr->timing]);
 	halcmd_output(((scriptmode == 0) ?
 		       "%11ld  %-3s %-2d   %-40s  %8u, %8u %3ld%% %3ld%%  +/-%5.2f%% %s\n" :
 		       "%ld %s %d %s %u %u %3ld%% %3ld%% %.2f"),
@@ -2758,8 +2770,11 @@ static void print_mem_status()
     rtapi_heap_status(&hal_data->heap, &hs);
 
     halcmd_output("  heap: arena size=%zu totail_avail=%zu"
-		  " fragments=%zu largest=%zu\n",
-		  hs.arena_size, hs.total_avail, hs.fragments, hs.largest);
+		  " fragments=%zu largest=%zu fragmentation=%zu%%\n",
+		  hs.arena_size, hs.total_avail, hs.fragments, hs.largest,
+		  hs.fragmentation);
+    halcmd_output("  heap: size classes inuse=%zu cached=%zu chunks=%zu\n",
+		  hs.slab_inuse, hs.slab_cached, hs.slab_chunks);
     if (hs.allocated)
 	halcmd_output("  heap: requested=%zu allocated=%zu freed=%zu waste=%zu%%\n",
 		      hs.requested, hs.allocated, hs.freed,
@@ -4394,6 +4409,7 @@ int do_newthread_cmd(char *name, char *args[])
     char *s;
     int per = 1000000;
     int flags = 0;
+    int timing = TT_FULL, timing_arg = 0;
 
     for (i = 0; ((s = args[i]) != NULL) && strlen(s); i++) {
 	if (sscanf(s, "cpu=%d", &cpu) == 1)
@@ -4416,6 +4432,28 @@ int do_newthread_cmd(char *name, char *args[])
 	}
 	if (sscanf(s, "cgname=%s", cgname) == 1)
 		continue;
+	if (strncmp(s, "timing=", 7) == 0) {
+	    char *t = s + 7;
+	    if (strcmp(t, "full") == 0)
+		timing = TT_FULL;
+	    else if (strcmp(t, "tsc") == 0)
+		timing = TT_TSC;
+	    else if (strcmp(t, "off") == 0)
+		timing = TT_OFF;
+	    else if (strncmp(t, "sampled", 7) == 0) {
+		timing = TT_SAMPLED;
+		timing_arg = TT_SAMPLE_DEFAULT;
+		if ((t[7] != '\0') &&
+		    ((sscanf(t + 7, ":%d", &timing_arg) != 1) || (timing_arg < 1))) {
+		    halcmd_error("invalid sample count in '%s'\n", s);
+		    return -EINVAL;
+		}
+	    } else {
+		halcmd_error("timing must be full, tsc, off or sampled[:N]: '%s'\n", s);
+		return -EINVAL;
+	    }
+	    continue;
+	}
 	char *cp = s;
 	per = strtol(s, &cp, 0);
 	if ((*cp != '\0') && (!isspace(*cp))) {
@@ -4431,7 +4469,7 @@ int do_newthread_cmd(char *name, char *args[])
     }
 
     retval = rtapi_newthread(rtapi_instance, name, per, cpu, cgname,
-                             (int)use_fp, flags);
+                             (int)use_fp, flags, timing, timing_arg);
     if (retval)
 	halcmd_error("rc=%d: %s\n",retval,rtapi_rpcerror());
 
@@ -4568,6 +4606,18 @@ int do_help_cmd(char *command)
     } else if (strcmp(command, "delf") == 0) {
 	printf("delf functname threadname\n");
 	printf("  Removes function 'functname' from thread 'threadname'.\n");
+    } else if (strcmp(command, "lcompile") == 0) {
+	printf("lcompile name threadname [verify] [instname ...]\n");
+	printf("  Compiles the logic instances (and2, or2, xor2, not, mux2/4/8,\n");
+	printf("  select8, lut5, scale, sum2, comp, wcomp) 'instname' on thread\n");
+	printf("  'threadname', or all of them on that thread, into a logicvm\n");
+	printf("  instance 'name' which runs them in one function, and takes\n");
+	printf("  them off the thread.  Their pins and signals are still written.\n");
+	printf("  With 'verify' the instances stay, and 'name' runs after them\n");
+	printf("  comparing its results, counted in pin 'name.mismatches'.\n");
+	printf("  The code follows the nets at compile time: after linking or\n");
+	printf("  unlinking any pin, 'name' stops (pin 'name.stale' counts)\n");
+	printf("  until it is deleted and compiled again.\n");
     } else if (strcmp(command, "show") == 0) {
 	printf("show [type] [pattern]\n");
 	printf("  Prints info about HAL items of the specified type.\n");
@@ -4663,6 +4713,7 @@ static void print_help_commands(void)
     printf("  ptype, stype        Get the type of a pin, parameter or signal\n");
     printf("  setp, sets          Set the value of a pin, parameter or signal\n");
     printf("  addf, delf          Add/remove function to/from a thread\n");
+    printf("  lcompile            Compile logic instances on a thread into one function\n");
     printf("  show                Display info about HAL objects\n");
     printf("  list                Display names of HAL objects\n");
     printf("  source              Execute commands from another .hal file\n");
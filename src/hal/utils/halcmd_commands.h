@@ -116,6 +116,7 @@ extern int do_waitunbound_cmd(char *comp, char *tokens[]);
 extern int do_callfunc_cmd(char *func, char *args[]);
 extern int do_newinst_cmd(char *comp, char *inst, char *args[]);
 extern int do_delinst_cmd(char *inst);
+extern int do_lcompile_cmd(char *name, char *thread, char *tokens[]);
 
 extern bool module_loaded(const int use_halmutex, char *mod_name);
 extern bool inst_name_exists(const int use_halmutex, char *name);
@@ -59,7 +59,7 @@ static const char *command_table[] = {
     "newring","delring","ringdump","ringwrite","ringflush",
     "newcomp","newpin","ready","waitbound", "waitunbound", "waitexists",
     "log","shutdown","ping","newthread","delthread",
-    "sleep","vtable","autoload","newinst", "delinst",
+    "sleep","vtable","autoload","newinst", "delinst", "lcompile",
     NULL,
 };
 
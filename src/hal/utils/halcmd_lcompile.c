@@ -0,0 +1,864 @@
+/* halcmd_lcompile.c - the 'lcompile' command
+ *
+ * Replaces a sub-net of small logic instances on a thread - and2, or2,
+ * xor2, not, mux2/4/8, select8, lut5, scale, sum2, comp, wcomp - by one
+ * instance of the logicvm component, which runs the sub-net as bytecode
+ * (see hal_logicvm.h) in a single funct.
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of version 2 of the GNU General
+ *  Public License as published by the Free Software Foundation.
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111 USA
+ */
+
+#include "config.h"
+#include "rtapi.h"		/* RTAPI realtime OS API */
+#include "hal.h"		/* HAL public API decls */
+#include "hal_priv.h"		/* private HAL decls */
+#include "hal_accessor.h"	/* hal_bump_generation() */
+#include "hal_logicvm.h"	/* bytecode */
+#include "halcmd_commands.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#define LC_MAXPINS 16
+#define LC_MAXWARN 5		// order warnings printed
+
+struct lc;
+struct lc_inst;
+typedef int (*lc_emit_t)(struct lc *c, struct lc_inst *li);
+
+// a supported component: the pins in the order the emitter refers to
+// them, outputs prefixed with '>', outputs which are also read - the
+// previous value is kept - with '='.
+typedef struct {
+    const char *comp;		// also matches <comp>v2
+    int uses_fp;
+    lc_emit_t emit;
+    const char *pins[LC_MAXPINS + 1];
+} lc_type_t;
+
+typedef struct lc_inst {
+    char name[HAL_NAME_LEN + 1];
+    int id;			// of the hal_inst_t
+    const lc_type_t *type;
+    int npins;
+    int pin[LC_MAXPINS];	// pin descriptor offsets
+    int reg[LC_MAXPINS];
+    hal_type_t ptype[LC_MAXPINS];
+    int pos;			// position of its funct on the thread, from 1
+    char funct[HAL_NAME_LEN + 1]; // its funct, empty if run by <comp>.batch
+    int batch_enable;		// <inst>.batch-enable if run by <comp>.batch
+    int npred;			// unscheduled instances it reads from
+    int done;
+} lc_inst_t;
+
+typedef struct lc {
+    lc_inst_t *inst;
+    int ninst;
+    int *order;			// inst indices in the order compiled
+    int *edge;			// writer, reader pairs
+    int nedge;
+
+    int *key;			// value (signal or pin offset) -> register
+    int *val;
+    int hsize;
+    int nregs;
+    int *writer;		// register -> writing instance, or -1
+    char *loaded;		// register -> loaded by the preamble
+    int rsize;
+
+    hal_lvm_insn_t *load;	// preamble: loads
+    int nload, maxload;
+    hal_lvm_insn_t *code;	// body
+    int ncode, maxcode;
+    int uses_fp;
+} lc_t;
+
+static int emit_and2(lc_t *c, lc_inst_t *li);
+static int emit_or2(lc_t *c, lc_inst_t *li);
+static int emit_xor2(lc_t *c, lc_inst_t *li);
+static int emit_not(lc_t *c, lc_inst_t *li);
+static int emit_mux(lc_t *c, lc_inst_t *li);
+static int emit_select8(lc_t *c, lc_inst_t *li);
+static int emit_lut5(lc_t *c, lc_inst_t *li);
+static int emit_scale(lc_t *c, lc_inst_t *li);
+static int emit_sum2(lc_t *c, lc_inst_t *li);
+static int emit_comp(lc_t *c, lc_inst_t *li);
+static int emit_wcomp(lc_t *c, lc_inst_t *li);
+
+// the semantics are those of the FUNCTION() in hal/i_components/<comp>.icomp
+static const lc_type_t lc_types[] = {
+    { "and2", 0, emit_and2, { "in0", "in1", ">out" } },
+    { "or2", 0, emit_or2, { "in0", "in1", ">out" } },
+    { "xor2", 0, emit_xor2, { "in0", "in1", ">out" } },
+    { "not", 0, emit_not, { "in", ">out" } },
+    { "mux2", 1, emit_mux, { "sel", "in0", "in1", ">out" } },
+    { "mux4", 1, emit_mux, { "sel0", "sel1",
+			     "in0", "in1", "in2", "in3", ">out" } },
+    { "mux8", 1, emit_mux, { "sel0", "sel1", "sel2",
+			     "in0", "in1", "in2", "in3",
+			     "in4", "in5", "in6", "in7", ">out" } },
+    { "select8", 0, emit_select8, { "enable", "sel",
+				    ">out0", ">out1", ">out2", ">out3",
+				    ">out4", ">out5", ">out6", ">out7" } },
+    { "lut5", 0, emit_lut5, { "in-0", "in-1", "in-2", "in-3", "in-4",
+			      "function", ">out" } },
+    { "scale", 1, emit_scale, { "in", "gain", "offset", ">out" } },
+    { "sum2", 1, emit_sum2, { "in0", "in1", "gain0", "gain1", "offset",
+			      ">out" } },
+    { "comp", 1, emit_comp, { "in0", "in1", "hyst", "=out", ">equal" } },
+    { "wcomp", 1, emit_wcomp, { "in", "min", "max",
+				">out", ">under", ">over" } },
+};
+#define LC_NTYPES (sizeof(lc_types) / sizeof(lc_types[0]))
+
+static const lc_type_t *lc_find_type(const char *comp)
+{
+    size_t i, n;
+
+    for (i = 0; i < LC_NTYPES; i++) {
+	n = strlen(lc_types[i].comp);
+	if (!strncmp(comp, lc_types[i].comp, n) &&
+	    (!strcmp(comp + n, "") || !strcmp(comp + n, "v2")))
+	    return &lc_types[i];
+    }
+    return NULL;
+}
+
+static inline int pin_is_output(const lc_inst_t *li, const int i)
+{
+    return (li->type->pins[i][0] == '>') || (li->type->pins[i][0] == '=');
+}
+
+static inline int pin_is_input(const lc_inst_t *li, const int i)
+{
+    return (li->type->pins[i][0] != '>');
+}
+
+static inline const char *pin_suffix(const lc_inst_t *li, const int i)
+{
+    const char *s = li->type->pins[i];
+    return ((*s == '>') || (*s == '=')) ? s + 1 : s;
+}
+
+/***********************************************************************
+*                         register allocation                          *
+************************************************************************/
+
+// the value a pin refers to: its signal, or the pin itself if unlinked.
+// This ties the code to the links at compile time, see hal_logicvm.h.
+static int value_key(const int pin_off)
+{
+    hal_pin_t *pin = SHMPTR(pin_off);
+    return pin->_signal ? pin->_signal : pin_off;
+}
+
+static int new_reg(lc_t *c)
+{
+    if (c->nregs == c->rsize) {
+	int rsize = c->rsize ? 2 * c->rsize : 256;
+	int *writer;
+	char *loaded;
+
+	// keep the old arrays for lc_free() if either one fails
+	if ((writer = realloc(c->writer, rsize * sizeof(int))) == NULL)
+	    return -ENOMEM;
+	c->writer = writer;
+	if ((loaded = realloc(c->loaded, rsize)) == NULL)
+	    return -ENOMEM;
+	c->loaded = loaded;
+	c->rsize = rsize;
+    }
+    c->writer[c->nregs] = -1;
+    c->loaded[c->nregs] = 0;
+    return c->nregs++;
+}
+
+// open addressing on the shm offset, the table is sized for all pins
+static int key_reg(lc_t *c, const int key)
+{
+    unsigned h = ((unsigned)key * 2654435761u) % c->hsize;
+
+    while (c->key[h] && (c->key[h] != key))
+	h = (h + 1) % c->hsize;
+    if (c->key[h] == 0) {
+	c->key[h] = key;
+	c->val[h] = new_reg(c);
+    }
+    return c->val[h];
+}
+
+/***********************************************************************
+*                              emitting                                *
+************************************************************************/
+
+static hal_lvm_insn_t *add_insn(hal_lvm_insn_t **code, int *n, int *max)
+{
+    hal_lvm_insn_t *insn;
+
+    if (*n == *max) {
+	int max2 = *max ? 2 * *max : 1024;
+
+	if ((insn = realloc(*code, max2 * sizeof(hal_lvm_insn_t))) == NULL)
+	    return NULL;
+	*code = insn;
+	*max = max2;
+    }
+    insn = &(*code)[(*n)++];
+    memset(insn, 0, sizeof(*insn));
+    return insn;
+}
+
+static int op(lc_t *c, const int opcode, const int r0, const int r1,
+	      const int r2, const int arg)
+{
+    hal_lvm_insn_t *insn = add_insn(&c->code, &c->ncode, &c->maxcode);
+
+    if (insn == NULL)
+	return -ENOMEM;
+    insn->op = opcode;
+    insn->r[0] = r0;
+    insn->r[1] = r1;
+    insn->r[2] = r2;
+    insn->arg = arg;
+    return 0;
+}
+
+// an instruction with n operand registers following in LVM_DATA
+static int op_data(lc_t *c, const int opcode, const int r0, const int r1,
+		   const int *regs, const int n)
+{
+    hal_lvm_insn_t *insn;
+    int i, retval;
+
+    if ((retval = op(c, opcode, r0, r1, 0, n)) < 0)
+	return retval;
+    for (i = 0; i < n; i++) {
+	if ((i % LVM_NREGS) == 0) {
+	    insn = add_insn(&c->code, &c->ncode, &c->maxcode);
+	    if (insn == NULL)
+		return -ENOMEM;
+	    insn->op = LVM_DATA;
+	}
+	c->code[c->ncode - 1].r[i % LVM_NREGS] = regs[i];
+    }
+    return 0;
+}
+
+// LVM_PACK of the n bit registers starting at li->reg[first]
+static int op_pack(lc_t *c, const int r0, const lc_inst_t *li,
+		   const int first, const int n)
+{
+    hal_lvm_insn_t *insn = add_insn(&c->code, &c->ncode, &c->maxcode);
+    int i;
+
+    if (insn == NULL)
+	return -ENOMEM;
+    insn->op = LVM_PACK;
+    insn->r[0] = r0;
+    for (i = 0; i < n; i++)
+	insn->r[i + 1] = li->reg[first + i];
+    insn->arg = n;
+    return 0;
+}
+
+#define R(i) (li->reg[i])
+
+static int emit_and2(lc_t *c, lc_inst_t *li)
+{
+    return op(c, LVM_AND, R(2), R(0), R(1), 0);
+}
+
+static int emit_or2(lc_t *c, lc_inst_t *li)
+{
+    return op(c, LVM_OR, R(2), R(0), R(1), 0);
+}
+
+static int emit_xor2(lc_t *c, lc_inst_t *li)
+{
+    return op(c, LVM_XOR, R(2), R(0), R(1), 0);
+}
+
+static int emit_not(lc_t *c, lc_inst_t *li)
+{
+    return op(c, LVM_NOT, R(1), R(0), 0, 0);
+}
+
+// mux2/4/8: n select bits, 2^n inputs, out; sel0 is the low bit
+static int emit_mux(lc_t *c, lc_inst_t *li)
+{
+    int nsel = 0, t = new_reg(c), retval;
+
+    while ((1 << nsel) + nsel + 1 < li->npins)
+	nsel++;
+    if (t < 0)
+	return t;
+    if ((retval = op_pack(c, t, li, 0, nsel)) < 0)
+	return retval;
+    return op_data(c, LVM_MUX, R(li->npins - 1), t, &li->reg[nsel], 1 << nsel);
+}
+
+// out(i) = enable && (sel == i)
+static int emit_select8(lc_t *c, lc_inst_t *li)
+{
+    int i, t = new_reg(c), retval;
+
+    if (t < 0)
+	return t;
+    for (i = 0; i < 8; i++) {
+	if (((retval = op(c, LVM_SEQ, t, R(1), 0, i)) < 0) ||
+	    ((retval = op(c, LVM_AND, R(2 + i), R(0), t, 0)) < 0))
+	    return retval;
+    }
+    return 0;
+}
+
+static int emit_lut5(lc_t *c, lc_inst_t *li)
+{
+    int t = new_reg(c), retval;
+
+    if (t < 0)
+	return t;
+    if ((retval = op_pack(c, t, li, 0, 5)) < 0)
+	return retval;
+    return op(c, LVM_BIT, R(6), R(5), t, 0);
+}
+
+// out = in * gain + offset
+static int emit_scale(lc_t *c, lc_inst_t *li)
+{
+    int t = new_reg(c), retval;
+
+    if (t < 0)
+	return t;
+    if ((retval = op(c, LVM_FMUL, t, R(0), R(1), 0)) < 0)
+	return retval;
+    return op(c, LVM_FADD, R(3), t, R(2), 0);
+}
+
+// out = in0 * gain0 + in1 * gain1 + offset, in the same order
+static int emit_sum2(lc_t *c, lc_inst_t *li)
+{
+    int t0 = new_reg(c), t1 = new_reg(c), retval;
+
+    if ((t0 < 0) || (t1 < 0))
+	return -ENOMEM;
+    if (((retval = op(c, LVM_FMUL, t0, R(0), R(2), 0)) < 0) ||
+	((retval = op(c, LVM_FMUL, t1, R(1), R(3), 0)) < 0) ||
+	((retval = op(c, LVM_FADD, t0, t0, t1, 0)) < 0))
+	return retval;
+    return op(c, LVM_FADD, R(5), t0, R(4), 0);
+}
+
+static int emit_comp(lc_t *c, lc_inst_t *li)
+{
+    hal_lvm_insn_t *insn = add_insn(&c->code, &c->ncode, &c->maxcode);
+
+    if (insn == NULL)
+	return -ENOMEM;
+    insn->op = LVM_COMP;
+    insn->r[0] = R(3);
+    insn->r[1] = R(4);
+    insn->r[2] = R(0);
+    insn->r[3] = R(1);
+    insn->r[4] = R(2);
+    return 0;
+}
+
+// under = in <= min; over = in >= max; out = !(over || under)
+static int emit_wcomp(lc_t *c, lc_inst_t *li)
+{
+    int t = new_reg(c), retval;
+
+    if (t < 0)
+	return t;
+    if (((retval = op(c, LVM_FLE, R(4), R(0), R(1), 0)) < 0) ||
+	((retval = op(c, LVM_FGE, R(5), R(0), R(2), 0)) < 0) ||
+	((retval = op(c, LVM_OR, t, R(5), R(4), 0)) < 0))
+	return retval;
+    return op(c, LVM_NOT, R(3), t, 0, 0);
+}
+
+#undef R
+
+// loads of the values read from outside the sub-net, the operation,
+// and a store to each output pin
+static int emit_inst(lc_t *c, lc_inst_t *li)
+{
+    hal_lvm_insn_t *insn;
+    int i, r, retval;
+
+    for (i = 0; i < li->npins; i++) {
+	r = li->reg[i];
+	if (!pin_is_input(li, i) || c->loaded[r])
+	    continue;
+	if ((c->writer[r] >= 0) && (li->type->pins[i][0] != '='))
+	    continue;
+	insn = add_insn(&c->load, &c->nload, &c->maxload);
+	if (insn == NULL)
+	    return -ENOMEM;
+	insn->op = LVM_LD;
+	insn->r[0] = r;
+	insn->arg = li->pin[i];
+	c->loaded[r] = 1;
+    }
+    if ((retval = li->type->emit(c, li)) < 0)
+	return retval;
+    for (i = 0; i < li->npins; i++) {
+	if (!pin_is_output(li, i))
+	    continue;
+	insn = add_insn(&c->code, &c->ncode, &c->maxcode);
+	if (insn == NULL)
+	    return -ENOMEM;
+	insn->op = LVM_ST;
+	insn->r[0] = li->reg[i];
+	insn->r[1] = li->ptype[i];
+	insn->arg = li->pin[i];
+    }
+    return 0;
+}
+
+/***********************************************************************
+*                         collecting instances                         *
+************************************************************************/
+
+static int add_inst(lc_t *c, hal_inst_t *hi, const lc_type_t *type,
+		    hal_funct_t *funct, const int pos)
+{
+    char name[HAL_NAME_LEN + 1];
+    lc_inst_t *li;
+    hal_pin_t *pin;
+    int i;
+
+    for (i = 0; i < c->ninst; i++) {
+	if (!strcmp(c->inst[i].name, ho_name(hi))) {
+	    halcmd_error("lcompile: instance '%s' given twice\n", ho_name(hi));
+	    return -EINVAL;
+	}
+    }
+    li = realloc(c->inst, (c->ninst + 1) * sizeof(lc_inst_t));
+    if (li == NULL)
+	return -ENOMEM;
+    c->inst = li;
+    li = &c->inst[c->ninst];
+    memset(li, 0, sizeof(*li));
+    rtapi_snprintf(li->name, sizeof(li->name), "%s", ho_name(hi));
+    li->id = ho_id(hi);
+    li->type = type;
+    li->pos = pos;
+
+    if (funct != NULL) {
+	rtapi_snprintf(li->funct, sizeof(li->funct), "%s", ho_name(funct));
+    } else {
+	rtapi_snprintf(name, sizeof(name), "%s.batch-enable", li->name);
+	if ((pin = halpr_find_pin_by_name(name)) == NULL) {
+	    halcmd_error("lcompile: no pin '%s'\n", name);
+	    return -ENOENT;
+	}
+	li->batch_enable = SHMOFF(pin);
+    }
+    for (i = 0; type->pins[i] != NULL; i++) {
+	rtapi_snprintf(name, sizeof(name), "%s.%s", li->name, pin_suffix(li, i));
+	if ((pin = halpr_find_pin_by_name(name)) == NULL) {
+	    halcmd_error("lcompile: no pin '%s'\n", name);
+	    return -ENOENT;
+	}
+	li->pin[i] = SHMOFF(pin);
+	li->ptype[i] = pin_type(pin);
+    }
+    li->npins = i;
+    c->ninst++;
+    return 0;
+}
+
+// the component of an instance, if it can be compiled
+static const lc_type_t *inst_type(hal_inst_t *hi)
+{
+    hal_comp_t *comp = halpr_find_comp_by_id(ho_owner_id(hi));
+
+    return comp ? lc_find_type(ho_name(comp)) : NULL;
+}
+
+// where an instance runs on the thread: its funct, or <comp>.batch
+// with <inst>.batch-enable set. Returns the position from 1, or 0.
+static int inst_pos(hal_thread_t *thread, hal_inst_t *hi, hal_funct_t **fp)
+{
+    hal_comp_t *comp = halpr_find_comp_by_id(ho_owner_id(hi));
+    char name[HAL_NAME_LEN + 1], batch[HAL_NAME_LEN + 1];
+    hal_list_t *list_root = &thread->funct_list;
+    hal_list_t *list_entry = dlist_next(list_root);
+    hal_funct_entry_t *fentry;
+    hal_funct_t *funct;
+    hal_pin_t *pin;
+    int pos = 1, batch_pos = 0;
+
+    rtapi_snprintf(name, sizeof(name), "%s.funct", ho_name(hi));
+    rtapi_snprintf(batch, sizeof(batch), "%s.batch", ho_name(comp));
+    for (; list_entry != list_root; list_entry = dlist_next(list_entry), pos++) {
+	fentry = (hal_funct_entry_t *) list_entry;
+	funct = SHMPTR(fentry->funct_ptr);
+	if (!strcmp(ho_name(funct), name)) {
+	    *fp = funct;
+	    return pos;
+	}
+	if (!strcmp(ho_name(funct), batch))
+	    batch_pos = pos;
+    }
+    *fp = NULL;
+    if (batch_pos) {
+	rtapi_snprintf(name, sizeof(name), "%s.batch-enable", ho_name(hi));
+	pin = halpr_find_pin_by_name(name);
+	if (pin && get_bit_value(pin_value(pin)))
+	    return batch_pos;
+    }
+    return 0;
+}
+
+static int collect_cb(hal_object_ptr o, foreach_args_t *args)
+{
+    lc_t *c = args->user_ptr1;
+    hal_thread_t *thread = args->user_ptr2;
+    const lc_type_t *type = inst_type(o.inst);
+    hal_funct_t *funct;
+    int pos;
+
+    if (type == NULL)
+	return 0;
+    if ((pos = inst_pos(thread, o.inst, &funct)) == 0)
+	return 0;
+    if ((args->user_arg1 = add_inst(c, o.inst, type, funct, pos)) < 0)
+	return 1;
+    return 0;
+}
+
+/***********************************************************************
+*                               compiling                              *
+************************************************************************/
+
+static int compile(lc_t *c)
+{
+    lc_inst_t *li;
+    int i, j, k, r, best, npins = 0, nwarn = 0, retval;
+
+    for (i = 0; i < c->ninst; i++)
+	npins += c->inst[i].npins;
+    c->hsize = 2 * npins + 1;
+    c->key = calloc(c->hsize, sizeof(int));
+    c->val = calloc(c->hsize, sizeof(int));
+    c->order = calloc(c->ninst, sizeof(int));
+    if (!c->key || !c->val || !c->order)
+	return -ENOMEM;
+
+    // a register per value, the writers first
+    for (i = 0; i < c->ninst; i++) {
+	li = &c->inst[i];
+	for (j = 0; j < li->npins; j++) {
+	    if ((li->reg[j] = key_reg(c, value_key(li->pin[j]))) < 0)
+		return -ENOMEM;
+	    if (pin_is_output(li, j))
+		c->writer[li->reg[j]] = i;
+	}
+    }
+
+    // an edge for every input written by another instance
+    c->edge = malloc(2 * npins * sizeof(int));
+    if (c->edge == NULL)
+	return -ENOMEM;
+    for (i = 0; i < c->ninst; i++) {
+	li = &c->inst[i];
+	for (j = 0; j < li->npins; j++) {
+	    if (pin_is_output(li, j))
+		continue;
+	    if ((k = c->writer[li->reg[j]]) < 0)
+		continue;
+	    if (k == i) {
+		halcmd_error("lcompile: %s.%s reads its own output\n",
+			     li->name, pin_suffix(li, j));
+		return -EINVAL;
+	    }
+	    c->edge[2 * c->nedge] = k;
+	    c->edge[2 * c->nedge + 1] = i;
+	    c->nedge++;
+	    li->npred++;
+	    if ((c->inst[k].pos > li->pos) && (nwarn++ < LC_MAXWARN))
+		halcmd_warning("lcompile: %s runs before %s on the thread, "
+			       "compiled it sees the value of this cycle\n",
+			       li->name, c->inst[k].name);
+	}
+    }
+
+    // topological order, the thread order among the ready ones
+    for (i = 0; i < c->ninst; i++) {
+	best = -1;
+	for (j = 0; j < c->ninst; j++) {
+	    li = &c->inst[j];
+	    if (li->done || li->npred)
+		continue;
+	    if ((best < 0) || (li->pos < c->inst[best].pos))
+		best = j;
+	}
+	if (best < 0) {
+	    for (j = 0; c->inst[j].done; j++);
+	    halcmd_error("lcompile: combinational loop through %s\n",
+			 c->inst[j].name);
+	    return -EINVAL;
+	}
+	c->inst[best].done = 1;
+	c->order[i] = best;
+	for (k = 0; k < c->nedge; k++)
+	    if (c->edge[2 * k] == best)
+		c->inst[c->edge[2 * k + 1]].npred--;
+    }
+
+    for (i = 0; i < c->ninst; i++) {
+	li = &c->inst[c->order[i]];
+	if ((retval = emit_inst(c, li)) < 0)
+	    return retval;
+	c->uses_fp |= li->type->uses_fp;
+    }
+    // the loads go first
+    for (i = 0; i < c->ncode; i++) {
+	r = c->nload;
+	if (add_insn(&c->load, &c->nload, &c->maxload) == NULL)
+	    return -ENOMEM;
+	c->load[r] = c->code[i];
+    }
+    return 0;
+}
+
+// thread entries used by the instances, <comp>.batch counts once
+static int distinct_positions(const lc_t *c)
+{
+    int i, j, n = 0;
+
+    for (i = 0; i < c->ninst; i++) {
+	for (j = 0; j < i; j++)
+	    if (c->inst[j].pos == c->inst[i].pos)
+		break;
+	if (j == i)
+	    n++;
+    }
+    return n;
+}
+
+static void lc_free(lc_t *c)
+{
+    free(c->inst);
+    free(c->order);
+    free(c->edge);
+    free(c->key);
+    free(c->val);
+    free(c->writer);
+    free(c->loaded);
+    free(c->load);
+    free(c->code);
+}
+
+// copy the code into the instance, n_code last. The compiled instances
+// and their components are referenced until the logicvm instance is
+// deleted, so their pins stay valid.
+static int load_code(lc_t *c, const char *name)
+{
+    WITH_HAL_MUTEX();
+    hal_inst_t *hi = halpr_find_inst_by_name(name);
+    hal_s32_t *refs;
+    hal_lvm_t *vm;
+    int i;
+
+    if (hi == NULL) {
+	halcmd_error("lcompile: no instance '%s'\n", name);
+	return -ENOENT;
+    }
+    vm = SHMPTR(hi->inst_data_ptr);
+    if ((vm->max_code < c->nload) || (vm->max_regs < c->nregs) ||
+	(vm->max_refs < c->ninst)) {
+	halcmd_error("lcompile: '%s' too small\n", name);
+	return -ENOSPC;
+    }
+    refs = lvm_refs(vm);
+    for (i = 0; i < c->ninst; i++) {
+	if ((hi = halpr_find_inst_by_id(c->inst[i].id)) == NULL) {
+	    halcmd_error("lcompile: instance '%s' is gone\n", c->inst[i].name);
+	    return -ENOENT;
+	}
+	ho_incref(hi);
+	ho_incref(halpr_find_owning_comp(ho_id(hi)));
+	refs[vm->n_refs++] = c->inst[i].id;
+    }
+    memcpy(lvm_code(vm), c->load, c->nload * sizeof(hal_lvm_insn_t));
+    memset(lvm_regs(vm), 0, c->nregs * sizeof(hal_data_u));
+    vm->link_generation = hal_data->link_generation;
+    rtapi_smp_wmb();
+    vm->n_code = c->nload;
+    return 0;
+}
+
+// take the instances off the thread
+static int remove_insts(lc_t *c, char *thread)
+{
+    hal_data_u *u;
+    int i, retval;
+
+    for (i = 0; i < c->ninst; i++) {
+	if (c->inst[i].funct[0]) {
+	    retval = hal_del_funct_from_thread(c->inst[i].funct, thread);
+	    if (retval < 0) {
+		halcmd_error("lcompile: delf %s failed: %s\n",
+			     c->inst[i].funct, hal_lasterror());
+		return retval;
+	    }
+	} else {
+	    WITH_HAL_MUTEX();
+	    u = pin_value(SHMPTR(c->inst[i].batch_enable));
+	    set_bit_value(u, false);
+	    hal_bump_generation(u);
+	}
+    }
+    return 0;
+}
+
+int do_lcompile_cmd(char *name, char *thread_name, char **opt)
+{
+    lc_t lc, *c = &lc;
+    hal_thread_t *thread;
+    hal_inst_t *hi;
+    hal_funct_t *funct;
+    hal_pin_t *pin;
+    const lc_type_t *type;
+    char code[20], regs[20], refs[20], fp[10], vfy[10];
+    char *args[] = { code, regs, refs, fp, vfy, NULL };
+    hal_list_t *list_entry;
+    int i, pos, npos, first, last, verify = 0, retval = 0;
+
+    memset(c, 0, sizeof(lc));
+    {
+	WITH_HAL_MUTEX();
+
+	if ((thread = halpr_find_thread_by_name(thread_name)) == NULL) {
+	    halcmd_error("lcompile: no thread '%s'\n", thread_name);
+	    return -ENOENT;
+	}
+	for (i = 0; opt[i] && strlen(opt[i]); i++) {
+	    if (!strcmp(opt[i], "verify")) {
+		verify = 1;
+		continue;
+	    }
+	    if ((hi = halpr_find_inst_by_name(opt[i])) == NULL) {
+		halcmd_error("lcompile: no instance '%s'\n", opt[i]);
+		retval = -ENOENT;
+		goto out;
+	    }
+	    if ((type = inst_type(hi)) == NULL) {
+		halcmd_error("lcompile: can't compile '%s', its component "
+			     "is not supported\n", opt[i]);
+		retval = -EINVAL;
+		goto out;
+	    }
+	    if ((pos = inst_pos(thread, hi, &funct)) == 0) {
+		halcmd_error("lcompile: '%s' is not on thread '%s'\n",
+			     opt[i], thread_name);
+		retval = -EINVAL;
+		goto out;
+	    }
+	    if ((retval = add_inst(c, hi, type, funct, pos)) < 0)
+		goto out;
+	}
+	if (c->ninst == 0) {
+	    // all supported instances on the thread
+	    foreach_args_t args =  {
+		.type = HAL_INST,
+		.user_ptr1 = c,
+		.user_ptr2 = thread,
+	    };
+	    halg_foreach(0, &args, collect_cb);
+	    if ((retval = args.user_arg1) < 0)
+		goto out;
+	}
+	if (c->ninst == 0) {
+	    halcmd_error("lcompile: nothing to compile on thread '%s'\n",
+			 thread_name);
+	    retval = -EINVAL;
+	    goto out;
+	}
+	if (!verify) {
+	    for (i = 0; i < c->ninst; i++) {
+		if (c->inst[i].funct[0])
+		    continue;
+		pin = SHMPTR(c->inst[i].batch_enable);
+		if (signal_of(pin)) {
+		    halcmd_error("lcompile: %s is linked, can't take %s "
+				 "out of the batch\n", ho_name(pin),
+				 c->inst[i].name);
+		    retval = -EINVAL;
+		    goto out;
+		}
+	    }
+	}
+	if ((retval = compile(c)) < 0) {
+	    if (retval == -ENOMEM)
+		halcmd_error("lcompile: out of memory\n");
+	    goto out;
+	}
+
+	npos = 0;
+	dlist_for_each(list_entry, &thread->funct_list)
+	    npos++;
+    }
+    if ((c->nload > 0x7fff) || (c->nregs > 0xffff)) {
+	halcmd_error("lcompile: %d instructions, %d registers: too many, "
+		     "compile fewer instances\n", c->nload, c->nregs);
+	retval = -E2BIG;
+	goto out;
+    }
+
+    snprintf(code, sizeof(code), "code=%d", c->nload);
+    snprintf(regs, sizeof(regs), "regs=%d", c->nregs);
+    snprintf(refs, sizeof(refs), "insts=%d", c->ninst);
+    snprintf(fp, sizeof(fp), "fp=%d", c->uses_fp);
+    snprintf(vfy, sizeof(vfy), "verify=%d", verify);
+    if ((retval = do_newinst_cmd("logicvm", name, args)) != 0)
+	goto out;
+    if ((retval = load_code(c, name)) < 0)
+	goto out;
+
+    // replacing: where the first instance ran, verifying: after the last
+    first = last = c->inst[0].pos;
+    for (i = 1; i < c->ninst; i++) {
+	if (c->inst[i].pos < first)
+	    first = c->inst[i].pos;
+	if (c->inst[i].pos > last)
+	    last = c->inst[i].pos;
+    }
+    if (!verify && (last - first + 1 > distinct_positions(c)))
+	halcmd_warning("lcompile: functs between the instances on '%s' "
+		       "now run after them\n", thread_name);
+
+    snprintf(code, sizeof(code), "%s.funct", name);
+    pos = verify ? ((last == npos) ? -1 : last + 1) : first;
+    retval = hal_add_funct_to_thread(code, thread_name, pos, 0, 0);
+    if (retval < 0) {
+	halcmd_error("lcompile: addf %s failed: %s\n", code, hal_lasterror());
+	goto out;
+    }
+    if (!verify && ((retval = remove_insts(c, thread_name)) < 0))
+	goto out;
+
+    halcmd_info("lcompile: %d instances on '%s' %s by '%s': "
+		"%d instructions, %d registers\n",
+		c->ninst, thread_name, verify ? "verified" : "replaced",
+		name, c->nload, c->nregs);
+ out:
+    lc_free(c);
+    return retval;
+}
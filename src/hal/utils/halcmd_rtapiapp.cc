@@ -190,7 +190,7 @@ int rtapi_ping(int instance)
 
 int rtapi_newthread(
     int instance, const char *name, int period, int cpu,
-    char *cgname, int use_fp, int flags)
+    char *cgname, int use_fp, int flags, int timing, int timing_arg)
 {
     machinetalk::RTAPICommand *cmd;
     command.Clear();
@@ -203,6 +203,8 @@ int rtapi_newthread(
     cmd->set_use_fp(use_fp);
     cmd->set_flags(flags);
     cmd->set_cgname(cgname);
+    cmd->set_timing(timing);
+    cmd->set_timing_arg(timing_arg);
 
     int retval = rtapi_rpc(z_command, command, reply);
     if (retval)
@@ -624,6 +624,9 @@ def prologue(f):
     ##local copy used in function and set to default value
     if have_numpins:
         print >>f, "    int local_pincount;"
+    if options.get("batch"):
+        print >>f, "    hal_bit_t *batch_enable;"
+        print >>f, "    hal_list_t batch_list;"
     print >>f, "    };"
 
 ############## extra headers and forward defines of functions  ##########################
@@ -647,6 +650,15 @@ def prologue(f):
             print >>f, "static int %s(void *arg, const hal_funct_args_t *fa);\n" % to_c(name)
         names[name] = 1
 
+    if options.get("batch"):
+        for n in ("batch_enable", "batch_list"):
+            if names.has_key(n):
+                Error("Duplicate item name: %s (used by option batch)" % n)
+        print >>f, "// all instances, in creation order, for the batch functs"
+        print >>f, "static hal_list_t *batch_head;\n"
+        for name, fp in functions:
+            print >>f, "static int %s(void *arg, const hal_funct_args_t *fa);\n" % batch_funct_name(name)
+
     print >>f, "static int instantiate(const int argc, char* const *argv);\n"
     # we always have a delete function now - to free local_argv
     print >>f, "static int delete(const char *name, void *inst, const int inst_size);\n"
@@ -791,6 +803,11 @@ def prologue(f):
     for name, mptype, doc, value in instanceparams:
         if ((mptype == 'int') or (mptype == "u32")) and (name != "pincount"):
             print >>f, "    ip->local_%s = %s;" % (to_c(name), to_c(name))
+    if options.get("batch"):
+        print >>f, "    r = hal_pin_bit_newf(HAL_IN, &(ip->batch_enable), owner_id,"
+        print >>f, "            \"%s.batch-enable\", name);"
+        print >>f, "    if(r != 0) return r;\n"
+        print >>f, "    *(ip->batch_enable) = 1;"
     print >>f, "\n    ip->local_argv = halg_dupargv(1, argc, argv);\n"
     print >>f, "    ip->local_argc = argc;\n"
 
@@ -881,6 +898,20 @@ def prologue(f):
         print >>f, "//reset pincount to -1 so that instantiation without it will result in DEFAULTCOUNT"
         print >>f, "    pincount = -1;\n"
 
+    if options.get("batch"):
+        print >>f, "// complete instances are run by the batch functs, which may be walking"
+        print >>f, "// the list in RT: the new entry and the instance behind it are written"
+        print >>f, "// out before the last entry links to it"
+        print >>f, "    if(r == 0)"
+        print >>f, "        {"
+        print >>f, "        hal_list_t *last = SHMPTR(batch_head->prev);"
+        print >>f, "        ip->batch_list.next = SHMOFF(batch_head);"
+        print >>f, "        ip->batch_list.prev = batch_head->prev;"
+        print >>f, "        rtapi_smp_wmb();"
+        print >>f, "        last->next = SHMOFF(&ip->batch_list);"
+        print >>f, "        batch_head->prev = SHMOFF(&ip->batch_list);"
+        print >>f, "        }\n"
+
     print >>f, "    return r;\n}"
 
 ##############################  rtapi_app_main  ######################################################
@@ -890,6 +921,25 @@ def prologue(f):
     print >>f, "    if (comp_id < 0)\n"
     print >>f, "        return -1;\n"
 
+    if options.get("batch"):
+        print >>f, "    // the list head lives in HAL memory like the instances"
+        print >>f, "    batch_head = halg_malloc(1, sizeof(hal_list_t));"
+        print >>f, "    if (batch_head == NULL)"
+        print >>f, "        return -1;"
+        print >>f, "    dlist_init_entry(batch_head);\n"
+        for name, fp in functions:
+            print >>f, "    hal_export_xfunct_args_t %s_batch_xf = " % to_c(name)
+            print >>f, "        {"
+            print >>f, "        .type = FS_XTHREADFUNC,"
+            print >>f, "        .funct.x = %s," % batch_funct_name(name)
+            print >>f, "        .arg = batch_head,"
+            print >>f, "        .uses_fp = %d," % int(fp)
+            print >>f, "        .reentrant = 0,"
+            print >>f, "        .owner_id = comp_id"
+            print >>f, "        };\n"
+            print >>f, "    if (hal_export_xfunctf(&%s_batch_xf, \"%s\"))" % (to_c(name), batch_funct_hal_name(name))
+            print >>f, "        return -1;\n"
+
 ################  stub to allow 'base component to have function if req later ####
 #
 #    print >>f, "    // exporting an extended thread function:"
@@ -951,6 +1001,13 @@ def prologue(f):
 #            print >>f, strg
 #####################################################################################################################
 
+    if options.get("batch"):
+        print >>f, "    struct inst_data *bp = inst;\n"
+        print >>f, "    // the batch functs are not on a thread, halg_inst_delete() refuses"
+        print >>f, "    // to delete an instance while one of them is."
+        print >>f, "    // Not linked if the instance failed to set up"
+        print >>f, "    if (bp->batch_list.next)"
+        print >>f, "        dlist_remove_entry(&bp->batch_list);\n"
     if options.get("extra_inst_cleanup"):
         print >>f, "    return extra_inst_cleanup(name, inst, inst_size);"
     else:
@@ -962,6 +1019,26 @@ def prologue(f):
     print >>f, "    return 0;\n"
     print >>f, "}\n"
 
+######################  batch functs  ####################################################################
+
+    if options.get("batch"):
+        for name, fp in functions:
+            print >>f, "// %s: runs %s for all instances with batch-enable set, in" % (batch_funct_hal_name(name), user_funct_name(name))
+            print >>f, "// creation order, as a single funct of the thread. Added instead of"
+            print >>f, "// the functs of the instances, it saves their per-funct overhead."
+            print >>f, "static int %s(void *arg, const hal_funct_args_t *fa)\n{" % batch_funct_name(name)
+            print >>f, "    hal_list_t *head = arg;"
+            print >>f, "    struct inst_data *ip;"
+            print >>f, "    int r, ret = 0;\n"
+            print >>f, "    dlist_for_each_entry(ip, head, batch_list) {"
+            print >>f, "        if (*(ip->batch_enable)) {"
+            print >>f, "            r = %s(ip, fa);" % user_funct_name(name)
+            print >>f, "            if (r != 0)"
+            print >>f, "                ret = r;"
+            print >>f, "        }"
+            print >>f, "    }"
+            print >>f, "    return ret;\n}\n"
+
 ######################  preliminary defines before user FUNCTION(_) ######################################
 
     print >>f
@@ -1053,6 +1130,20 @@ def prologue(f):
 def epilogue(f):
     print >>f
 
+# C name of the funct generated from FUNCTION(name)
+def user_funct_name(name):
+    if funct_:
+        return funct_name
+    return to_c(name)
+
+def batch_funct_name(name):
+    return "%s_batch" % user_funct_name(name)
+
+def batch_funct_hal_name(name):
+    if (len(functions) == 1) and name == "_":
+        return "%s.batch" % comp_name
+    return "%s.%s.batch" % (comp_name, to_hal(name))
+
 INSTALL, COMPILE, PREPROCESS, DOCUMENT, INSTALLDOC, VIEWDOC, MODINC = range(7)
 modename = ("install", "compile", "preprocess", "document", "installdoc", "viewdoc", "print-modinc")
 
@@ -1253,6 +1344,14 @@ def adocument(filename, outfilename, frontmatter):
             if doc:
         	print >>f, doc
             print >>f, ""    
+            if options.get("batch"):
+                print >>f, "*%s*" % batch_funct_hal_name(name)
+                print >>f, ""
+                print >>f, "Runs the function of all instances which have *batch-enable* set, as"
+                print >>f, "one function of the thread. Add either this or the functions of the"
+                print >>f, "single instances to a thread, not both. While it is on a thread,"
+                print >>f, "instances can't be deleted."
+                print >>f, ""
 
     print >>f, "=== PINS"
     print >>f, ""    
@@ -105,6 +105,7 @@ int main(int argc, gchar * argv[])
     int num_samples = SCOPE_NUM_SAMPLES_DEFAULT;
     char *ifilename = "autosave.halscope";
     char *ofilename = "autosave.halscope";
+    char *rfilename = NULL;
 
     bindtextdomain("linuxcnc", EMC2_PO_DIR);
     setlocale(LC_MESSAGES,"");
@@ -118,13 +119,13 @@ int main(int argc, gchar * argv[])
 
     while(1) {
         int c;
-        c = getopt(argc, argv, "hi:o:");
+        c = getopt(argc, argv, "hi:o:r:");
         if(c == -1) break;
         switch(c) {
          case 'h':
             rtapi_print_msg(RTAPI_MSG_ERR,
             _("Usage:\n  halscope [-h] [-i infile] [-o outfile]"
-            " [num_samples]\n"));
+            " [-r rollfile] [num_samples]\n"));
             return -1;
             break;
          case 'i':
@@ -133,6 +134,9 @@ int main(int argc, gchar * argv[])
          case 'o':
             ofilename = optarg;
             break;
+         case 'r':
+            rfilename = optarg;
+            break;
         }
     }
     if(argc > optind) num_samples = atoi(argv[argc-1]);
@@ -181,6 +185,8 @@ int main(int argc, gchar * argv[])
     /* init control structure */
     ctrl_usr = &ctrl_struct;
     init_usr_control_struct(shm_base);
+    /* roll mode history goes to a file? */
+    ctrl_usr->roll.filename = rfilename;
 
     /* init watchdog */
     ctrl_shm->watchdog = 10;
@@ -320,6 +326,9 @@ hal_param_t *param;
 	    /* channel source is invalid */
 	    chan->data_len = 0;
 	}
+	/* the RT side looks the value up again if signals are moved */
+	ctrl_shm->data_source[n] = chan->data_source;
+	ctrl_shm->data_source_type[n] = chan->data_source_type;
 	/* set data type */
 	ctrl_shm->data_type[n] = chan->data_type;
 	/* set data length - zero means don't sample */
@@ -329,14 +338,24 @@ hal_param_t *param;
 	    ctrl_shm->data_len[n] = 0;
 	}
     }
+    ctrl_shm->roll = (ctrl_usr->run_mode == ROLL);
+    if (ctrl_shm->roll) {
+	/* set up a new history for the channels */
+	if (roll_start() < 0) {
+	    return;
+	}
+    } else {
+	/* back to records */
+	roll_stop();
+    }
     ctrl_shm->pre_trig = (ctrl_shm->rec_len-2) * ctrl_usr->trig.position;
     ctrl_shm->state = INIT;
 }
 
-void capture_copy_data(void) {
+/* where each acquired channel is in a sample */
+void calc_data_offsets(void)
+{
     int n, offs;
-    scope_data_t *src, *dst, *src_end;
-    int samp_len, samp_size;
 
     offs = 0;
     for (n = 0; n < 16; n++) {
@@ -349,6 +368,14 @@ void capture_copy_data(void) {
 	    ctrl_usr->vert.data_offset[n] = -1;
 	}
     }
+}
+
+void capture_copy_data(void) {
+    int n;
+    scope_data_t *src, *dst, *src_end;
+    int samp_len, samp_size;
+
+    calc_data_offsets();
     /* copy data from shared buffer to display buffer */
     ctrl_usr->samples = ctrl_shm->samples;
     samp_len = ctrl_shm->sample_len;
@@ -372,7 +399,7 @@ void capture_copy_data(void) {
 
 void capture_cont()
 {
-    capture_copy_data();
+    roll_update();
     refresh_display();
 }
 
@@ -739,12 +766,6 @@ static void init_run_mode_window(void)
 
 /*  FIXME - things not yet finished */
 
-/** roll mode - display updates as frequently as possible, not just
-    when acquisition is complete.  Also need to revisit pretrig
-    logic - would like to have a full buffer of pretrig samples
-    until trigger occurs, then start dropping the oldest ones.
-*/
-
 /** cursor area = slider for cursor position, two labels, one for
     timevalue, one for signal value, three buttons [1] [2] [d]
     [1] causes labels to display cursor1 data, slider moves
@@ -790,11 +811,9 @@ int set_run_mode(int mode)
     } else if ( mode == 2 ) {
 	/* single sweep mode */
 	button = ctrl_usr->rm_single_button;
-#if 0 /* FIXME - roll mode not implemented yet */
     } else if ( mode == 3 ) {
 	/* roll mode */
 	button = ctrl_usr->rm_roll_button;
-#endif
     } else {
 	/* illegal mode */
 	return -1;
@@ -812,6 +831,8 @@ static void rm_normal_button_clicked(GtkWidget * widget, gpointer * gdata)
     ctrl_usr->run_mode = NORMAL;
     if (ctrl_shm->state == IDLE) {
 	start_capture();
+    } else if (ctrl_shm->state == ROLLING) {
+	prepare_scope_restart();
     }
 }
 
@@ -824,6 +845,8 @@ static void rm_single_button_clicked(GtkWidget * widget, gpointer * gdata)
     ctrl_usr->run_mode = SINGLE;
     if (ctrl_shm->state == IDLE) {
 	start_capture();
+    } else if (ctrl_shm->state == ROLLING) {
+	prepare_scope_restart();
     }
 }
 
@@ -836,6 +859,9 @@ static void rm_roll_button_clicked(GtkWidget * widget, gpointer * gdata)
     ctrl_usr->run_mode = ROLL;
     if (ctrl_shm->state == IDLE) {
 	start_capture();
+    } else {
+	/* don't wait for the trigger of the record in progress */
+	prepare_scope_restart();
     }
 }
 
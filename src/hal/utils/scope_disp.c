@@ -63,6 +63,8 @@ static void update_readout(void);
 static void draw_grid(void);
 static void draw_baseline(int chan_num, int highlight);
 static void draw_waveform(int chan_num, int highlight);
+static void draw_roll_waveform(int chan_num, int highlight);
+static void draw_label(int chan_num, int y);
 static void draw_triggerline(int chan_num, int highlight);
 static void handle_window_expose(GtkWidget * widget, gpointer data);
 static int handle_click(GtkWidget *widget, GdkEventButton *event, gpointer data);
@@ -236,8 +238,10 @@ void refresh_display(void)
     draw_grid();
 
     /* calculate offsets for AC-offset channels */
+    /* (a roll history has no record to average, keep the last ones) */
     for (n = 0; n < 16; n++) {
-        if (vert->chan_enabled[n]) calculate_offset(n);
+        if (vert->chan_enabled[n] && !ctrl_usr->roll.active)
+            calculate_offset(n);
     }
 
     /* draw baselines first */
@@ -497,14 +501,37 @@ static int handle_release(GtkWidget *widget, GdkEventButton *event, gpointer dat
     return 1;
 }
 
+/* roll mode: the position slider spans the history, 1.0 showing the
+   newest sample at the right edge */
+static double roll_right(void) {
+    scope_roll_t *roll = &(ctrl_usr->roll);
+    double span = roll->samples - roll_oldest();
+
+    return roll->samples - (1.0 - ctrl_usr->horiz.pos_setting) * span;
+}
+
+static void roll_set_right(double right) {
+    scope_roll_t *roll = &(ctrl_usr->roll);
+    double span = roll->samples - roll_oldest();
+    double pos = 1.0;
+
+    if(span > 0) pos = 1.0 - (roll->samples - right) / span;
+    if(pos < 0.0) pos = 0.0;
+    if(pos > 1.0) pos = 1.0;
+    set_horiz_pos(pos);
+}
+
 static void change_zoom(int dir, int x) {
     scope_horiz_t *horiz = &(ctrl_usr->horiz);
     scope_disp_t *disp = &(ctrl_usr->disp);
 
     double old_pixels_per_sample, pixels_per_div,
            pixels_per_sec, new_pixels_per_sample, old_fraction, new_fraction;
+    double roll_sample = 0;
 
     old_pixels_per_sample = disp->pixels_per_sample;
+    if(ctrl_usr->roll.active)
+        roll_sample = roll_right() - (disp->width - x) / old_pixels_per_sample;
 
     set_horiz_zoom(horiz->zoom_setting + dir);
 
@@ -514,6 +541,15 @@ static void change_zoom(int dir, int x) {
     disp->pixels_per_sample = new_pixels_per_sample = 
         pixels_per_sec * horiz->sample_period;
 
+    if(ctrl_usr->roll.active) {
+        // keep the sample under the pointer there, unless following
+        // the newest samples
+        if(horiz->pos_setting < 1.0)
+            roll_set_right(roll_sample
+                + (disp->width - x) / new_pixels_per_sample);
+        return;
+    }
+
     // how many samples away from the center of the window is this
     // pixel?
     old_fraction = (x - disp->width / 2) / old_pixels_per_sample / ctrl_shm->rec_len;
@@ -568,7 +604,10 @@ static void middle_drag(int dx) {
     scope_disp_t *disp = &(ctrl_usr->disp);
     scope_horiz_t *horiz = &(ctrl_usr->horiz);
     double dt = (dx / disp->pixels_per_sample) / ctrl_shm->rec_len;
-    set_horiz_pos(horiz->pos_setting + 5 * dt);
+    if(ctrl_usr->roll.active)
+        roll_set_right(roll_right() + dx / disp->pixels_per_sample);
+    else
+        set_horiz_pos(horiz->pos_setting + 5 * dt);
     refresh_display();
 }
 
@@ -789,6 +828,10 @@ void draw_waveform(int chan_num, int highlight)
     int first=1;
     scope_horiz_t *horiz = &(ctrl_usr->horiz);
 
+    if (ctrl_usr->roll.active) {
+	draw_roll_waveform(chan_num, highlight);
+	return;
+    }
     cursor_valid = 0;
     disp = &(ctrl_usr->disp);
     chan = &(ctrl_usr->chan[chan_num - 1]);
@@ -911,29 +954,142 @@ void draw_waveform(int chan_num, int highlight)
     if(pn) {
         lines(chan_num, points, pn);
         if(DRAWING) {
-            PangoLayout *p;
-            int y = points[0].y;
-            char scale[HAL_NAME_LEN];
-            char buffer[2 * HAL_NAME_LEN];
-            int h;
-            PangoRectangle r;
-
-            format_scale_value(scale, sizeof(scale), chan->scale);
-            snprintf(buffer, sizeof(buffer), "%s\n%s", chan->name, scale);
-            p=gtk_widget_create_pango_layout(disp->drawing, buffer);
-            pango_layout_get_extents(p, NULL, &r);
-            h = PANGO_PIXELS(r.height);
-
-            if(y < 0 || y+h > disp->height)
-                // if the first sample isn't visible, try the zero value
-                y = (0-yfoffset) * yscale + ypoffset;
-            if(y < 0 || y+h > disp->height)
-                // if that's not visible either, try the offset value
-                y = ypoffset;
-
-            conflict_avoid(&y, h);
-            gdk_draw_layout(disp->win, disp->context, 5, y, p);
-            g_object_unref(p);
+            draw_label(chan_num, points[0].y);
+        }
+    }
+}
+
+/* name and scale of a channel, next to its trace at 'y' */
+static void draw_label(int chan_num, int y)
+{
+    scope_disp_t *disp = &(ctrl_usr->disp);
+    scope_chan_t *chan = &(ctrl_usr->chan[chan_num - 1]);
+    double yscale = disp->height / (-10.0 * chan->scale);
+    double yfoffset = chan->vert_offset;
+    double ypoffset = chan->position * disp->height;
+    PangoLayout *p;
+    char scale[HAL_NAME_LEN];
+    char buffer[2 * HAL_NAME_LEN];
+    int h;
+    PangoRectangle r;
+
+    format_scale_value(scale, sizeof(scale), chan->scale);
+    snprintf(buffer, sizeof(buffer), "%s\n%s", chan->name, scale);
+    p=gtk_widget_create_pango_layout(disp->drawing, buffer);
+    pango_layout_get_extents(p, NULL, &r);
+    h = PANGO_PIXELS(r.height);
+
+    if(y < 0 || y+h > disp->height)
+        // if the first sample isn't visible, try the zero value
+        y = (0-yfoffset) * yscale + ypoffset;
+    if(y < 0 || y+h > disp->height)
+        // if that's not visible either, try the offset value
+        y = ypoffset;
+
+    conflict_avoid(&y, h);
+    gdk_draw_layout(disp->win, disp->context, 5, y, p);
+    g_object_unref(p);
+}
+
+static int roll_y(double v, double yscale, double yfoffset, double ypoffset,
+    int miny, int maxy)
+{
+    int y = ((v - yfoffset) * yscale) + ypoffset;
+
+    if (y < miny) {
+	y = miny;
+    } else if (y > maxy) {
+	y = maxy;
+    }
+    return y;
+}
+
+/* roll mode: draws from the min/max history instead of the samples.
+   zoomed out, each pixel column gets a vertical line from the min to
+   the max of the samples it covers, read from the coarsest level with
+   entries no longer than a column */
+static void draw_roll_waveform(int chan_num, int highlight)
+{
+    scope_disp_t *disp = &(ctrl_usr->disp);
+    scope_chan_t *chan = &(ctrl_usr->chan[chan_num - 1]);
+    double spp, right, s0, yscale, yfoffset, ypoffset;
+    int x, level, ya, yb, miny, maxy, pn, ct;
+    __u64 n, first, end;
+    scope_minmax_t mm;
+    GdkPoint *points;
+
+    cursor_valid = 0;
+    spp = 1.0 / disp->pixels_per_sample;
+    right = roll_right();
+    miny = -disp->height;
+    maxy = 2 * disp->height;
+    yscale = disp->height / (-10.0 * chan->scale);
+    yfoffset = chan->vert_offset;
+    ypoffset = chan->position * disp->height;
+
+    if (highlight) {
+	gdk_gc_set_foreground(disp->context, &(disp->color_selected[chan_num-1]));
+    } else {
+	gdk_gc_set_foreground(disp->context, &(disp->color_normal[chan_num-1]));
+    }
+    pn = 0;
+    if (spp <= 1.0) {
+	/* zoomed in, one point per sample */
+	s0 = right - disp->width * spp;
+	first = s0 < 0 ? 0 : (__u64) s0;
+	end = right < 0 ? 0 : (__u64) right + 1;
+	ct = (end > first) ? end - first : 0;
+	points = alloca((ct + 1) * sizeof(GdkPoint));
+	for (n = first; n < end; n++) {
+	    if (!roll_minmax(chan_num, 0, n, n + 1, &mm)) {
+		continue;
+	    }
+	    points[pn].x = COORDINATE_CLIP(disp->width - (right - n) / spp);
+	    points[pn].y = roll_y(mm.min, yscale, yfoffset, ypoffset, miny, maxy);
+	    pn++;
+	}
+    } else {
+	level = 0;
+	while ((level < ROLL_LEVELS - 1) &&
+	    ((double)(1ULL << ((level + 1) * ROLL_SHIFT)) <= spp)) {
+	    level++;
+	}
+	points = alloca(2 * (disp->width + 1) * sizeof(GdkPoint));
+	for (x = 0; x < disp->width; x++) {
+	    s0 = right - (disp->width - x) * spp;
+	    if (s0 + spp <= 0) {
+		continue;
+	    }
+	    first = s0 < 0 ? 0 : (__u64) s0;
+	    end = (__u64) (s0 + spp);
+	    if (end <= first) {
+		end = first + 1;
+	    }
+	    if (!roll_minmax(chan_num, level, first, end, &mm)) {
+		continue;
+	    }
+	    ya = roll_y(mm.max, yscale, yfoffset, ypoffset, miny, maxy);
+	    yb = roll_y(mm.min, yscale, yfoffset, ypoffset, miny, maxy);
+	    /* start the column at the end nearer to the previous one */
+	    if (pn && (abs(points[pn-1].y - yb) < abs(points[pn-1].y - ya))) {
+		int t = ya;
+		ya = yb;
+		yb = t;
+	    }
+	    points[pn].x = x;
+	    points[pn].y = ya;
+	    pn++;
+	    if (yb != ya) {
+		points[pn].x = x;
+		points[pn].y = yb;
+		pn++;
+	    }
+	}
+    }
+    if (pn > 1) {
+        lines(chan_num, points, pn);
+        if(DRAWING) {
+            draw_label(chan_num, points[0].y);
         }
     }
 }
@@ -223,10 +223,8 @@ void write_config_file (char *filename)
 	fprintf(fp, "RMODE 1\n" );
     } else if ( ctrl_usr->run_mode == SINGLE ) {
 	fprintf(fp, "RMODE 2\n" );
-#if 0 /* FIXME - role mode not implemented yet */
     } else if ( ctrl_usr->run_mode == ROLL ) {
 	fprintf(fp, "RMODE 3\n" );
-#endif
     } else {
 	/* stop mode */
 	fprintf(fp, "RMODE 0\n" );
@@ -290,14 +290,23 @@ void refresh_state_info(void)
 	"TRIGGER?",
 	"TRIGGERED",
 	"DONE",
-	"RESET"
+	"RESET",
+	"ROLLING"
     };
 
     horiz = &(ctrl_usr->horiz);
-    if (ctrl_shm->state > RESET) {
+    if (ctrl_shm->state > ROLLING) {
 	ctrl_shm->state = IDLE;
     }
-    gtk_label_set_text_if(horiz->state_label, state_names[ctrl_shm->state]);
+    if ((ctrl_shm->state == ROLLING) && ctrl_usr->roll.lost) {
+	/* samples the display fell behind on */
+	static gchar buf[BUFLEN + 1];
+	snprintf(buf, BUFLEN, _("ROLLING\n%llu lost"),
+	    (unsigned long long) ctrl_usr->roll.lost);
+	gtk_label_set_text_if(horiz->state_label, buf);
+    } else {
+	gtk_label_set_text_if(horiz->state_label, state_names[ctrl_shm->state]);
+    }
     refresh_pos_disp();
 }
 
@@ -309,7 +318,8 @@ void write_horiz_config(FILE *fp)
     fprintf(fp, "THREAD %s\n", horiz->thread_name);
     fprintf(fp, "MAXCHAN %d\n", ctrl_shm->sample_len);
     fprintf(fp, "HMULT %d\n", ctrl_shm->mult);
-    fprintf(fp, "HZOOM %d\n", horiz->zoom_setting);
+    /* roll mode zoom out is only valid with a roll history */
+    fprintf(fp, "HZOOM %d\n", horiz->zoom_setting < 1 ? 1 : horiz->zoom_setting);
     fprintf(fp, "HPOS %e\n", horiz->pos_setting);
 }
 
@@ -405,7 +415,8 @@ int set_horiz_zoom(int setting)
     GtkAdjustment *adj;
 
     /* range check setting */
-    if (( setting < 1 ) || ( setting > 9 )) {
+    if (( setting < (ctrl_usr->roll.active ? ROLL_ZOOM_MIN : 1) )
+	|| ( setting > 9 )) {
 	return -1;
     }
     /* point to data */
@@ -444,6 +455,20 @@ int set_horiz_pos(double setting)
     return 0;
 }
 
+/* with a roll history, the zoom slider goes below 1 to zoom out
+   past the length of a record */
+void horiz_roll_mode(int roll)
+{
+    GtkAdjustment *adj;
+
+    adj = GTK_ADJUSTMENT(ctrl_usr->horiz.zoom_adj);
+    adj->lower = roll ? ROLL_ZOOM_MIN : 1;
+    gtk_adjustment_changed(adj);
+    if (!roll && (ctrl_usr->horiz.zoom_setting < 1)) {
+	set_horiz_zoom(1);
+    }
+}
+
 /***********************************************************************
 *                       LOCAL FUNCTIONS                                *
 ************************************************************************/
@@ -1039,6 +1064,17 @@ static void calc_horiz_scaling(void)
 	    sub_decade = 2;
 	}
     }
+    /* settings below 1 (roll mode) zoom out */
+    for (n = horiz->zoom_setting; n < 1; n++) {
+	if (sub_decade == 1) {
+	    sub_decade = 2;
+	} else if (sub_decade == 2) {
+	    sub_decade = 5;
+	} else {
+	    sub_decade = 1;
+	    decade *= 10;
+	}
+    }
     if (decade == 0) {
 	/* underflow from zoom, set to minimum */
 	decade = 1;
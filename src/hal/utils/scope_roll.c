@@ -0,0 +1,323 @@
+/** This file, 'scope_roll.c', contains the portion of halscope
+    that keeps the history of roll mode.
+*/
+
+/** This program is free software; you can redistribute it and/or
+    modify it under the terms of version 2 of the GNU General
+    Public License as published by the Free Software Foundation.
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111 USA
+*/
+
+/** In roll mode the realtime sampler never stops: it writes the
+    shared buffer as a ring and counts the samples in roll_seq.  Each
+    heartbeat, roll_update() copies the samples acquired since the last
+    one out of the ring and adds them to the min/max pyramid of every
+    channel (see scope_roll_t), which is what the display draws from.
+    With enough zoom out, an entry of a coarse level covers thousands
+    of samples, so hours of history can be drawn as fast as one record.
+
+    The pyramid lives in one mapping, anonymous memory by default or
+    the file given with 'halscope -r <file>', which lets the kernel
+    page old history out and keeps it after halscope exits.
+*/
+
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rtapi.h"		/* RTAPI realtime OS API */
+#include "rtapi_atomics.h"	/* rtapi_smp_rmb() */
+#include "hal.h"		/* HAL public API decls */
+#include "hal_priv.h"	/* private HAL decls */
+
+#include <gtk/gtk.h>
+#include "scope_usr.h"		/* scope related declarations */
+
+/* samples left between the reader and the sampler, so the slot being
+   written is never copied */
+#define ROLL_MARGIN 2
+
+/***********************************************************************
+*                       PUBLIC FUNCTIONS                               *
+************************************************************************/
+
+int roll_start(void)
+{
+    scope_roll_t *roll = &(ctrl_usr->roll);
+    int n, nchan, fd;
+    size_t size;
+    char *p;
+
+    roll_stop();
+    calc_data_offsets();
+    roll->len = roll->filename ? ROLL_LEN_FILE : ROLL_LEN;
+    size = (size_t) roll->len * ROLL_LEVELS * sizeof(scope_minmax_t);
+    nchan = 0;
+    for (n = 0; n < 16; n++) {
+	if (ctrl_usr->vert.data_offset[n] >= 0) {
+	    nchan++;
+	}
+    }
+    if (nchan == 0) {
+	return 0;
+    }
+    roll->map_size = size * nchan;
+    if (roll->filename) {
+	fd = open(roll->filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+		"SCOPE: ERROR: can't create roll history file '%s'\n",
+		roll->filename);
+	    return -1;
+	}
+	if (ftruncate(fd, roll->map_size) < 0) {
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+		"SCOPE: ERROR: can't size roll history file '%s'\n",
+		roll->filename);
+	    close(fd);
+	    return -1;
+	}
+	roll->map = mmap(NULL, roll->map_size, PROT_READ | PROT_WRITE,
+	    MAP_SHARED, fd, 0);
+	close(fd);
+    } else {
+	roll->map = mmap(NULL, roll->map_size, PROT_READ | PROT_WRITE,
+	    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    }
+    if (roll->map == MAP_FAILED) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "SCOPE: ERROR: can't map %zu bytes of roll history\n",
+	    roll->map_size);
+	roll->map = NULL;
+	return -1;
+    }
+    p = roll->map;
+    for (n = 0; n < 16; n++) {
+	if (ctrl_usr->vert.data_offset[n] >= 0) {
+	    roll->chan[n].hist = (scope_minmax_t *) p;
+	    roll->chan[n].data_type = ctrl_shm->data_type[n];
+	    p += size;
+	}
+    }
+    roll->samples = 0;
+    roll->lost = 0;
+    roll->seq = 0;
+    roll->slot = 0;
+    roll->active = 1;
+    horiz_roll_mode(1);
+    /* follow the newest samples */
+    set_horiz_pos(1.0);
+    return 0;
+}
+
+void roll_stop(void)
+{
+    scope_roll_t *roll = &(ctrl_usr->roll);
+    int n;
+
+    if (roll->map) {
+	munmap(roll->map, roll->map_size);
+	roll->map = NULL;
+    }
+    for (n = 0; n < 16; n++) {
+	roll->chan[n].hist = NULL;
+    }
+    if (roll->active) {
+	roll->active = 0;
+	horiz_roll_mode(0);
+    }
+}
+
+static double sample_value(scope_data_t *dptr, hal_type_t type)
+{
+    switch (type) {
+    case HAL_BIT:
+	return dptr->d_u8 ? 1.0 : 0.0;
+    case HAL_FLOAT:
+	return dptr->d_real;
+    case HAL_S32:
+	return dptr->d_s32;
+    case HAL_U32:
+	return dptr->d_u32;
+    case HAL_S64:
+	return dptr->d_s64;
+    case HAL_U64:
+	return dptr->d_u64;
+    default:
+	return 0.0;
+    }
+}
+
+/* add sample number 's' of value 'v' to every level of a channel */
+static void push_sample(scope_roll_chan_t *rc, int len, __u64 s, double v)
+{
+    scope_minmax_t *mm;
+    __u64 mask;
+    int k;
+
+    rc->hist[s % len].min = v;
+    rc->hist[s % len].max = v;
+    for (k = 1; k < ROLL_LEVELS; k++) {
+	mask = (1ULL << (k * ROLL_SHIFT)) - 1;
+	mm = &(rc->acc[k]);
+	if ((s & mask) == 0) {
+	    mm->min = mm->max = v;
+	} else if (v < mm->min) {
+	    mm->min = v;
+	} else if (v > mm->max) {
+	    mm->max = v;
+	}
+	if ((s & mask) == mask) {
+	    /* entry complete */
+	    rc->hist[k * len + (s >> (k * ROLL_SHIFT)) % len] = *mm;
+	}
+    }
+}
+
+void roll_update(void)
+{
+    scope_roll_t *roll = &(ctrl_usr->roll);
+    scope_data_t *src, *dst;
+    __u32 seq, n, bad;
+    int slots, samp_len, slot, i, c;
+
+    if (!roll->active || (ctrl_shm->state != ROLLING)) {
+	return;
+    }
+    slots = ctrl_shm->rec_len;
+    samp_len = ctrl_shm->sample_len;
+    seq = ctrl_shm->roll_seq;
+    rtapi_smp_rmb();
+    n = seq - roll->seq;
+    if (n > slots - ROLL_MARGIN) {
+	/* the sampler lapped us, skip what was overwritten */
+	bad = n - (slots - ROLL_MARGIN);
+	roll->lost += bad;
+	roll->seq += bad;
+	roll->slot = (roll->slot + bad) % slots;
+	n -= bad;
+    }
+    /* copy out of the ring first, the sampler keeps going */
+    dst = ctrl_usr->disp_buf;
+    slot = roll->slot;
+    for (i = 0; i < n; i++) {
+	src = ctrl_usr->buffer + slot * samp_len;
+	memcpy(dst, src, samp_len * sizeof(scope_data_t));
+	dst += samp_len;
+	if (++slot >= slots) {
+	    slot = 0;
+	}
+    }
+    /* drop the ones the sampler may have written while copying */
+    rtapi_smp_rmb();
+    bad = ctrl_shm->roll_seq - roll->seq;
+    if (bad > slots - ROLL_MARGIN) {
+	bad -= slots - ROLL_MARGIN;
+	if (bad > n) {
+	    bad = n;
+	}
+    } else {
+	bad = 0;
+    }
+    roll->lost += bad;
+    for (i = bad; i < n; i++) {
+	src = ctrl_usr->disp_buf + i * samp_len;
+	for (c = 0; c < 16; c++) {
+	    if (roll->chan[c].hist) {
+		push_sample(&(roll->chan[c]), roll->len, roll->samples,
+		    sample_value(src + ctrl_usr->vert.data_offset[c],
+			roll->chan[c].data_type));
+	    }
+	}
+	roll->samples++;
+    }
+    roll->seq += n;
+    roll->slot = slot;
+}
+
+/* the oldest sample still in the coarsest level */
+__u64 roll_oldest(void)
+{
+    scope_roll_t *roll = &(ctrl_usr->roll);
+    int shift = (ROLL_LEVELS - 1) * ROLL_SHIFT;
+    __u64 entries = roll->samples >> shift;
+
+    if (entries <= roll->len) {
+	return 0;
+    }
+    return (entries - roll->len) << shift;
+}
+
+/* min and max of samples first..end-1 of a channel, from 'level' or
+   the first coarser one which still holds sample 'first'.
+   returns 0 if none of them is in the history */
+int roll_minmax(int chan_num, int level, __u64 first, __u64 end,
+    scope_minmax_t *mm)
+{
+    scope_roll_t *roll = &(ctrl_usr->roll);
+    scope_roll_chan_t *rc = &(roll->chan[chan_num - 1]);
+    scope_minmax_t *e;
+    __u64 complete, e0, e1, i;
+    int shift, found;
+
+    if ((rc->hist == NULL) || (end > roll->samples)) {
+	end = roll->samples;
+    }
+    if ((rc->hist == NULL) || (first >= end)) {
+	return 0;
+    }
+    /* find a level which reaches back far enough */
+    for (; level < ROLL_LEVELS; level++) {
+	shift = level * ROLL_SHIFT;
+	complete = roll->samples >> shift;
+	if ((complete <= roll->len) ||
+	    ((first >> shift) >= complete - roll->len)) {
+	    break;
+	}
+    }
+    if (level == ROLL_LEVELS) {
+	level = ROLL_LEVELS - 1;
+	shift = level * ROLL_SHIFT;
+	complete = roll->samples >> shift;
+    }
+    e0 = first >> shift;
+    e1 = (end - 1) >> shift;
+    if ((complete > roll->len) && (e0 < complete - roll->len)) {
+	e0 = complete - roll->len;
+    }
+    found = 0;
+    for (i = e0; (i <= e1) && (i < complete); i++) {
+	e = &(rc->hist[level * roll->len + i % roll->len]);
+	if (!found || (e->min < mm->min)) {
+	    mm->min = e->min;
+	}
+	if (!found || (e->max > mm->max)) {
+	    mm->max = e->max;
+	}
+	found = 1;
+    }
+    if ((e1 >= complete) && (level > 0)) {
+	/* the entry still being built */
+	e = &(rc->acc[level]);
+	if (!found || (e->min < mm->min)) {
+	    mm->min = e->min;
+	}
+	if (!found || (e->max > mm->max)) {
+	    mm->max = e->max;
+	}
+	found = 1;
+    }
+    return found;
+}
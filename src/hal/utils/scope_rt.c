@@ -38,6 +38,7 @@
 #include "hal_priv.h"	/* HAL private API decls */
 #include "scope_rt.h"		/* scope related declarations */
 #include "rtapi_string.h"
+#include "rtapi_atomics.h"	/* rtapi_smp_wmb() */
 
 /* module information */
 MODULE_AUTHOR("John Kasunich");
@@ -71,6 +72,7 @@ static void init_rt_control_struct(void *shmem);
 static void init_shm_control_struct(void);
 
 static void sample(void *arg, long period);
+static void get_data_addrs(void);
 static void capture_sample(void);
 static int check_trigger(void);
 
@@ -175,12 +177,13 @@ static void sample(void *arg, long period)
 	ctrl_rt->auto_timer = 0;
 	/* get info about channels */
 	for (n = 0; n < 16; n++) {
-	    ctrl_rt->data_addr[n] = SHMPTR(ctrl_shm->data_offset[n]);
 	    ctrl_rt->data_type[n] = ctrl_shm->data_type[n];
 	    ctrl_rt->data_len[n] = ctrl_shm->data_len[n];
 	}
+	get_data_addrs();
+	ctrl_shm->roll_seq = 0;
 	/* set next state */
-	ctrl_shm->state = PRE_TRIG;
+	ctrl_shm->state = ctrl_shm->roll ? ROLLING : PRE_TRIG;
 	break;
     case PRE_TRIG:
 	/* acquire a sample */
@@ -229,6 +232,13 @@ static void sample(void *arg, long period)
     case DONE:
 	/* do nothing while GUI displays waveform */
 	break;
+    case ROLLING:
+	/* the buffer is a ring of samples, the GUI follows roll_seq */
+	capture_sample();
+	/* sample complete before the GUI can see it */
+	rtapi_smp_wmb();
+	ctrl_shm->roll_seq++;
+	break;
     default:
 	/* shouldn't get here - if we do, set a legal state */
 	ctrl_shm->state = IDLE;
@@ -237,11 +247,42 @@ static void sample(void *arg, long period)
     /* done */
 }
 
+/* signal values may have been moved by a 'start' while the capture
+   was set up (see halg_layout_signals()), so pin and signal channels
+   are looked up through their descriptors */
+static void get_data_addrs(void)
+{
+    int n;
+
+    for (n = 0; n < 16; n++) {
+	if (ctrl_rt->data_len[n] == 0) {
+	    continue;
+	}
+	switch (ctrl_shm->data_source_type[n]) {
+	case 0:
+	    ctrl_rt->data_addr[n] =
+		pin_value((hal_pin_t *) SHMPTR(ctrl_shm->data_source[n]));
+	    break;
+	case 1:
+	    ctrl_rt->data_addr[n] =
+		sig_value((hal_sig_t *) SHMPTR(ctrl_shm->data_source[n]));
+	    break;
+	default:
+	    ctrl_rt->data_addr[n] = SHMPTR(ctrl_shm->data_offset[n]);
+	    break;
+	}
+    }
+    ctrl_rt->layout_generation = hal_data->layout_generation;
+}
+
 static void capture_sample(void)
 {
     scope_data_t *dest;
     int n;
 
+    if (ctrl_rt->layout_generation != hal_data->layout_generation) {
+	get_data_addrs();
+    }
     dest = &(ctrl_rt->buffer[ctrl_shm->curr]);
     /* loop through all channels to acquire data */
     for (n = 0; n < 16; n++) {
@@ -52,6 +52,7 @@ typedef struct {
     char data_len[16];		/* data size for each channel */
     void *data_addr[16];	/* pointers to data for each channel */
     hal_type_t data_type[16];	/* data type for each channel */
+    int layout_generation;	/* of hal_data when data_addr was set */
 } scope_rt_control_t;
 
 /***********************************************************************
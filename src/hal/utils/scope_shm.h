@@ -51,7 +51,8 @@ typedef enum {
     TRIG_WAIT,			/* waiting for trigger */
     POST_TRIG,			/* acquiring post-trigger data */
     DONE,			/* data acquisition complete */
-    RESET			/* data acquisition interrupted */
+    RESET,			/* data acquisition interrupted */
+    ROLLING			/* acquiring continuously (roll mode) */
 } scope_state_t;
 
 /* this struct holds a single value - one sample of one channel */
@@ -90,7 +91,11 @@ typedef struct {
     int curr;			/* R next sample to be acquired */
     int samples;		/* R number of valid samples */
     scope_state_t state;	/* RU current state */
+    int roll;			/* U sample continuously, no trigger */
+    __u32 roll_seq;		/* R samples acquired in roll mode */
     int data_offset[16];	/* U data addr in shmem for each channel */
+    int data_source[16];	/* U pin/signal descriptor for each channel */
+    char data_source_type[16];	/* U 0 = pin, 1 = signal, 2 = param */
     hal_type_t data_type[16];	/* U data type for each channel */
     char data_len[16];		/* U data size, 0 if not to be acquired */
 } scope_shm_control_t;
@@ -194,6 +194,45 @@ typedef struct {
 	GtkWidget *log_prefs_label;
 } scope_log_t;
 
+/* this struct holds the roll mode history of one channel, as a
+   pyramid of min/max values: level 0 holds the samples, each entry of
+   level k covers ROLL_FACTOR^k samples.  every level is a ring of
+   'len' entries, so the history reaches further back the coarser the
+   level.  the display reads the level which fits its time per pixel.
+*/
+
+#define ROLL_LEVELS 8		/* decimation levels */
+#define ROLL_SHIFT 2		/* log2 of ROLL_FACTOR */
+#define ROLL_FACTOR (1 << ROLL_SHIFT)
+#define ROLL_LEN 16384		/* entries per level in memory */
+#define ROLL_LEN_FILE 262144	/* entries per level in a history file */
+#define ROLL_ZOOM_MIN -12	/* zoom settings below 1 zoom out past the
+				   record, down to about ROLL_FACTOR^7 */
+
+typedef struct {
+    double min, max;
+} scope_minmax_t;
+
+typedef struct {
+    scope_minmax_t *hist;	/* ROLL_LEVELS rings of 'len' entries,
+				   NULL if channel not acquired */
+    scope_minmax_t acc[ROLL_LEVELS];	/* entry being built per level */
+    hal_type_t data_type;	/* type of the samples */
+} scope_roll_chan_t;
+
+typedef struct {
+    int active;			/* history matches the acquired channels */
+    int len;			/* entries per level */
+    __u64 samples;		/* samples in the history */
+    __u64 lost;			/* samples overwritten before being read */
+    __u32 seq;			/* next roll_seq to read from shmem */
+    int slot;			/* and its sample slot in the shmem buffer */
+    char *filename;		/* history file, NULL for anonymous memory */
+    void *map;			/* the mapping holding all 'hist' rings */
+    size_t map_size;
+    scope_roll_chan_t chan[16];
+} scope_roll_t;
+
 /* this is the master user space control structure */
 
 typedef enum { STOP = 0, NORMAL, SINGLE, ROLL } scope_run_mode_t;
@@ -230,6 +269,7 @@ typedef struct {
     scope_trig_t trig;		/* triggering data */
     scope_disp_t disp;		/* display data */
 	scope_log_t log;  		/* logging preferences */
+    scope_roll_t roll;		/* roll mode history */
 } scope_usr_control_t;
 
 /***********************************************************************
@@ -253,6 +293,7 @@ void refresh_state_info(void);
 void capture_complete(void);
 void capture_cont(void);
 void start_capture(void);
+void calc_data_offsets(void);
 void request_display_refresh(int delay);
 void refresh_display(void);
 void refresh_trigger(void);
@@ -296,4 +337,13 @@ int set_trigger_mode(int mode);
 int set_run_mode(int mode);
 void prepare_scope_restart(void);
 void log_popup(int);
+void horiz_roll_mode(int roll);
+
+/* roll mode history, in scope_roll.c */
+int roll_start(void);
+void roll_stop(void);
+void roll_update(void);
+__u64 roll_oldest(void);
+int roll_minmax(int chan_num, int level, __u64 first, __u64 end,
+    scope_minmax_t *mm);
 #endif /* HALSC_USR_H */
@@ -0,0 +1,345 @@
+/********************************************************************
+* Description: cms_bench.cc
+*   Contention benchmark for the local CMS buffer types.
+*
+*   cms-bench [-r readers] [-w writers] [-t secs] [-s bytes] [-f hz]
+*	[-k key] [-q qlen] [types...]
+*
+*   For each buffer type (default SHMEM and SEQMEM) two runs are made:
+*
+*   status: one writer process updates a message of -s bytes at -f Hz
+*	(0: as fast as it can) while -r reader processes read it in a
+*	tight loop, the way GUIs poll emcStatus. Reported are the read
+*	rate, the time the writer spends in write() and the number of
+*	torn messages the readers saw (must be 0).
+*
+*   queue: -w writer processes queue messages as fast as they can and
+*	one reader drains the queue, like emcCommand/emcError with
+*	several clients.
+*
+*   Built by 'make bench', not installed.
+*
+* License: GPL Version 2
+* System: Linux
+*
+* Copyright (c) 2016 All rights reserved.
+********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sched.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "cms.hh"		/* class CMS */
+#include "cms_cfg.hh"		/* cms_create_from_lines() */
+#include "rcs_print.hh"		/* rcs_print_error() */
+#include "timer.hh"		/* etime(), esleep() */
+
+static int readers = 4;
+static int writers = 2;
+static double run_time = 3.0;
+static long msg_size = 4096;
+static double write_hz = 1000.0;
+static int key = 7101;
+static int qlen = 64;
+
+static CMS *open_buffer(const char *type, int queue, int cnum, int master)
+{
+    char bufline[CMS_CONFIG_LINELEN];
+    char procline[CMS_CONFIG_LINELEN];
+    CMS *cms = NULL;
+    long size = msg_size + 1024;
+
+    /* SHMEM queues share the buffer size between all messages, SEQMEM
+       gives every one of its QLEN slots the full size */
+    if (queue && strcmp(type, "SEQMEM")) {
+	size *= qlen;
+    }
+    snprintf(bufline, sizeof(bufline),
+	"B bench %s localhost %ld 0 0 1 %d %d%s QLEN=%d",
+	type, size, readers + writers + 2, key,
+	queue ? " queue" : "", qlen);
+    snprintf(procline, sizeof(procline),
+	"P bench%d bench LOCAL localhost RW 0 10.0 %d %d",
+	cnum, master, cnum);
+    if (cms_create_from_lines(&cms, bufline, procline) < 0 || NULL == cms) {
+	rcs_print_error("cms-bench: can't open %s buffer\n", type);
+	return NULL;
+    }
+    return cms;
+}
+
+/* every 64 bit word of message n holds n, a reader that finds the
+   first and the last word different got a torn copy */
+static void fill(uint64_t *p, uint64_t n)
+{
+    long i;
+
+    for (i = 0; i < msg_size / 8; i++) {
+	p[i] = n;
+    }
+}
+
+static int torn(const void *data)
+{
+    const uint64_t *p = (const uint64_t *) data;
+
+    return p[0] != p[msg_size / 8 - 1];
+}
+
+static void status_writer(CMS * cms, int fd)
+{
+    uint64_t *buf = (uint64_t *) malloc(msg_size);
+    double end = etime() + run_time, t0, dt, sum = 0, max = 0;
+    long n = 0;
+    char line[256];
+
+    while (etime() < end) {
+	fill(buf, n + 1);
+	cms->header.in_buffer_size = msg_size;
+	t0 = etime();
+	cms->write(buf);
+	dt = etime() - t0;
+	sum += dt;
+	if (dt > max) {
+	    max = dt;
+	}
+	n++;
+	if (write_hz > 0) {
+	    esleep(1.0 / write_hz - dt);
+	}
+    }
+    snprintf(line, sizeof(line), "W %ld %g %g\n", n, sum, max);
+    if (write(fd, line, strlen(line)) < 0) {
+	perror("write");
+    }
+    free(buf);
+}
+
+static void status_reader(CMS * cms, int fd)
+{
+    double end = etime() + run_time;
+    long reads = 0, fresh = 0, bad = 0;
+    char line[256];
+
+    while (etime() < end) {
+	if (cms->read() == CMS_READ_OK) {
+	    fresh++;
+	    bad += torn(cms->subdiv_data);
+	}
+	reads++;
+    }
+    snprintf(line, sizeof(line), "R %ld %ld %ld\n", reads, fresh, bad);
+    if (write(fd, line, strlen(line)) < 0) {
+	perror("write");
+    }
+}
+
+static void queue_writer(CMS * cms, int fd)
+{
+    uint64_t *buf = (uint64_t *) malloc(msg_size);
+    double end = etime() + run_time;
+    long n = 0, full = 0;
+    char line[256];
+
+    while (etime() < end) {
+	fill(buf, n + 1);
+	cms->header.in_buffer_size = msg_size;
+	if (cms->write(buf) == CMS_QUEUE_FULL) {
+	    /* let the reader run, a spinning writer would starve it on
+	       small machines */
+	    full++;
+	    sched_yield();
+	    continue;
+	}
+	n++;
+    }
+    snprintf(line, sizeof(line), "Q %ld %ld\n", n, full);
+    if (write(fd, line, strlen(line)) < 0) {
+	perror("write");
+    }
+    free(buf);
+}
+
+static void queue_reader(CMS * cms, int fd)
+{
+    /* keep draining a little longer than the writers run */
+    double end = etime() + run_time + 0.5;
+    long n = 0, bad = 0;
+    char line[256];
+
+    while (etime() < end) {
+	if (cms->read() == CMS_READ_OK) {
+	    n++;
+	    bad += torn(cms->subdiv_data);
+	} else {
+	    sched_yield();
+	}
+    }
+    snprintf(line, sizeof(line), "D %ld %ld\n", n, bad);
+    if (write(fd, line, strlen(line)) < 0) {
+	perror("write");
+    }
+}
+
+/* fork nw writers and nr readers on a buffer created by the parent,
+   collect their result lines */
+static int run(const char *type, int queue, int nw, int nr,
+    void (*w) (CMS *, int), void (*r) (CMS *, int), FILE ** out)
+{
+    CMS *master;
+    int fds[2], i, cnum = 1;
+    pid_t pid;
+
+    master = open_buffer(type, queue, 0, 1);
+    if (NULL == master) {
+	return -1;
+    }
+    fflush(stdout);
+    if (pipe(fds) < 0) {
+	perror("pipe");
+	return -1;
+    }
+    for (i = 0; i < nw + nr; i++, cnum++) {
+	pid = fork();
+	if (pid < 0) {
+	    perror("fork");
+	    break;
+	}
+	if (pid == 0) {
+	    CMS *cms;
+
+	    ::close(fds[0]);
+	    cms = open_buffer(type, queue, cnum, 0);
+	    if (NULL != cms) {
+		if (i < nw) {
+		    w(cms, fds[1]);
+		} else {
+		    r(cms, fds[1]);
+		}
+		delete cms;
+	    }
+	    _exit(0);
+	}
+    }
+    ::close(fds[1]);
+    while (wait(NULL) > 0);
+    delete master;
+    *out = fdopen(fds[0], "r");
+    return 0;
+}
+
+static void bench_status(const char *type)
+{
+    FILE *f;
+    char c;
+    long n, a, b, writes = 0, reads = 0, fresh = 0, bad = 0;
+    double sum = 0, max = 0, s, m;
+
+    if (run(type, 0, 1, readers, status_writer, status_reader, &f) < 0) {
+	return;
+    }
+    while (fscanf(f, " %c", &c) == 1) {
+	if (c == 'W' && fscanf(f, "%ld %lf %lf", &n, &s, &m) == 3) {
+	    writes += n;
+	    sum += s;
+	    max = m > max ? m : max;
+	} else if (c == 'R' && fscanf(f, "%ld %ld %ld", &n, &a, &b) == 3) {
+	    reads += n;
+	    fresh += a;
+	    bad += b;
+	}
+    }
+    fclose(f);
+    printf("%-7s status  %d readers: %9.0f reads/s  %8.0f writes/s  "
+	"write mean %6.2fus max %8.2fus  new %ld  torn %ld\n",
+	type, readers, reads / run_time, writes / run_time,
+	writes ? sum / writes * 1e6 : 0.0, max * 1e6, fresh, bad);
+}
+
+static void bench_queue(const char *type)
+{
+    FILE *f;
+    char c;
+    long n, a, sent = 0, full = 0, got = 0, bad = 0;
+
+    if (run(type, 1, writers, 1, queue_writer, queue_reader, &f) < 0) {
+	return;
+    }
+    while (fscanf(f, " %c", &c) == 1) {
+	if (c == 'Q' && fscanf(f, "%ld %ld", &n, &a) == 2) {
+	    sent += n;
+	    full += a;
+	} else if (c == 'D' && fscanf(f, "%ld %ld", &n, &a) == 2) {
+	    got += n;
+	    bad += a;
+	}
+    }
+    fclose(f);
+    printf("%-7s queue   %d writers: %9.0f msgs/s  queued %ld  received %ld"
+	"  full %ld  torn %ld\n",
+	type, writers, sent / run_time, sent, got, full, bad);
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: cms-bench [-r readers] [-w writers] [-t secs] "
+	"[-s bytes] [-f hz] [-k key] [-q qlen] [types...]\n");
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    static const char *default_types[] = { "SHMEM", "SEQMEM", NULL };
+    const char **types = default_types;
+    int opt, i;
+
+    while ((opt = getopt(argc, argv, "r:w:t:s:f:k:q:")) != -1) {
+	switch (opt) {
+	case 'r':
+	    readers = atoi(optarg);
+	    break;
+	case 'w':
+	    writers = atoi(optarg);
+	    break;
+	case 't':
+	    run_time = atof(optarg);
+	    break;
+	case 's':
+	    msg_size = (atol(optarg) + 7) & ~7L;
+	    break;
+	case 'f':
+	    write_hz = atof(optarg);
+	    break;
+	case 'k':
+	    key = strtol(optarg, NULL, 0);
+	    break;
+	case 'q':
+	    qlen = atoi(optarg);
+	    break;
+	default:
+	    usage();
+	}
+    }
+    if (readers < 1 || writers < 1 || run_time <= 0 || msg_size < 8) {
+	usage();
+    }
+    if (optind < argc) {
+	types = (const char **) &argv[optind];
+    }
+    signal(SIGPIPE, SIG_IGN);
+    cms_print_queue_full_messages = 0;
+
+    for (i = 0; types[i] != NULL; i++) {
+	bench_status(types[i]);
+    }
+    for (i = 0; types[i] != NULL; i++) {
+	bench_queue(types[i]);
+    }
+    return 0;
+}
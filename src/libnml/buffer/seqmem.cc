@@ -0,0 +1,558 @@
+/********************************************************************
+* Description: seqmem.cc
+*   C++ file for the Communication Management System (CMS).
+*   Includes member Functions for class SEQMEM, see seqmem.hh.
+*
+* License: GPL Version 2
+* System: Linux
+*
+* Copyright (c) 2016 All rights reserved.
+********************************************************************/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdio.h>		/* sscanf() */
+#include <stddef.h>		/* size_t */
+#include <stdlib.h>		/* malloc(), strtod() */
+#include <string.h>		/* memcpy(), memset() */
+#include <errno.h>		/* errno */
+#include <sched.h>		/* sched_yield() */
+
+#ifdef __cplusplus
+}
+#endif
+#include "rcs_print.hh"		/* rcs_print_error() */
+#include "cms.hh"		/* class CMS */
+#include "seqmem.hh"		/* class SEQMEM */
+#include "shm.hh"		/* class RCS_SHAREDMEM */
+#include "timer.hh"		/* etime(), esleep() */
+
+#define MODE (0777)
+
+static inline uint32_t load_acquire(uint32_t *p)
+{
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+static inline void store_release(uint32_t *p, uint32_t v)
+{
+    __atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+
+SEQMEM::SEQMEM(const char *bufline, const char *procline, int set_to_server,
+    int set_to_master):CMS(bufline, procline, set_to_server)
+{
+    char *eq;
+
+    shm = NULL;
+    block = NULL;
+    slots = NULL;
+    copy = NULL;
+    stride = 0;
+    qlen = SEQMEM_DEFAULT_QLEN;
+    poll_delay = 0.001;
+    last_gen = ~0U;
+    last_id = 0;
+    use_queue = queuing_enabled;
+
+    if (status < 0) {
+	rcs_print_error("SEQMEM: status = %d\n", status);
+	return;
+    }
+
+    /* Same buffer line as SHMEM, the key is the 10th word. */
+    if (sscanf(bufline, "%*s %*s %*s %*s %*s %*s %*s %*s %*s %d", &key) != 1) {
+	rcs_print_error("SEQMEM: Invalid configuration file format.\n");
+	status = CMS_CONFIG_ERROR;
+	return;
+    }
+
+    master = is_local_master;
+    if (1 == set_to_master) {
+	master = 1;
+    } else if (-1 == set_to_master) {
+	master = 0;
+    }
+
+    if (NULL != (eq = strstr(buflineupper, "QLEN="))) {
+	qlen = strtol(eq + 5, (char **) NULL, 0);
+	if (qlen < 2) {
+	    qlen = 2;
+	}
+	/* positions run through all 32 bits and map to slot n % qlen,
+	   which only stays contiguous across the wrap for a power of two */
+	if (qlen & (qlen - 1)) {
+	    uint32_t n = 2;
+
+	    while (n < qlen && n < 0x80000000U) {
+		n <<= 1;
+	    }
+	    qlen = n;
+	}
+    }
+    if (NULL != (eq = strstr(proclineupper, "POLLDELAY="))) {
+	poll_delay = strtod(eq + 10, (char **) NULL);
+    } else if (NULL != (eq = strstr(buflineupper, "POLLDELAY="))) {
+	poll_delay = strtod(eq + 10, (char **) NULL);
+    }
+
+    if (split_buffer || enable_diagnostics || total_subdivisions > 1) {
+	rcs_print_error("SEQMEM(%s): SPLIT, DIAG and SUBDIV are not supported.\n",
+	    BufferName);
+	status = CMS_CONFIG_ERROR;
+	return;
+    }
+
+    open();
+}
+
+SEQMEM::~SEQMEM()
+{
+    close();
+}
+
+int SEQMEM::open()
+{
+    uint32_t nslots = use_queue ? qlen : 2;
+    uint32_t i;
+    long total;
+
+    stride = (sizeof(seqmem_slot_t) + size + 63) & ~63L;
+    total = 32 + sizeof(seqmem_block_t) + nslots * stride;
+
+    shm = new RCS_SHAREDMEM(key, total,
+	master ? RCS_SHAREDMEM_CREATE : RCS_SHAREDMEM_NOCREATE, (int) MODE);
+    if (NULL == shm) {
+	rcs_print_error("SEQMEM: couldn't create RCS_SHAREDMEM.\n");
+	status = CMS_CREATE_ERROR;
+	return -1;
+    }
+    if (shm->addr == NULL) {
+	switch (shm->create_errno) {
+	case EACCES:
+	    status = CMS_PERMISSIONS_ERROR;
+	    break;
+
+	case EEXIST:
+	case EINVAL:
+	    status = CMS_RESOURCE_CONFLICT_ERROR;
+	    break;
+
+	case ENOENT:
+	    status = CMS_NO_MASTER_ERROR;
+	    break;
+
+	case ENOMEM:
+	case ENOSPC:
+	    status = CMS_CREATE_ERROR;
+	    break;
+
+	default:
+	    status = CMS_MISC_ERROR;
+	}
+	delete shm;
+	shm = NULL;
+	return -1;
+    }
+
+    block = (seqmem_block_t *) ((char *) shm->addr + 32);
+    slots = (char *) block + sizeof(seqmem_block_t);
+
+    if (master) {
+	strncpy((char *) shm->addr, BufferName, 32);
+	memset(block, 0, total - 32);
+	block->nslots = nslots;
+	block->slot_size = size;
+	if (use_queue) {
+	    /* slot n is free for the writer at position n */
+	    for (i = 0; i < nslots; i++) {
+		slot(i)->seq = i;
+	    }
+	}
+	store_release(&block->magic, SEQMEM_MAGIC);
+    } else {
+	if (load_acquire(&block->magic) != SEQMEM_MAGIC) {
+	    rcs_print_error("SEQMEM(%s): buffer not initialized by master.\n",
+		BufferName);
+	    block = NULL;
+	    status = CMS_NO_MASTER_ERROR;
+	    return -1;
+	}
+	if (block->nslots != nslots || block->slot_size != (uint32_t) size) {
+	    rcs_print_error
+		("SEQMEM(%s): master uses size %u and %u slots, not %ld and %u.\n",
+		BufferName, block->slot_size, block->nslots, size, nslots);
+	    block = NULL;
+	    status = CMS_CONFIG_ERROR;
+	    return -1;
+	}
+    }
+
+    copy = (char *) malloc(size);
+    if (NULL == copy) {
+	rcs_print_error("SEQMEM: Can't allocate memory for local copy.\n");
+	block = NULL;
+	status = CMS_CREATE_ERROR;
+	return -1;
+    }
+    memset(copy, 0, size);
+    in_buffer_id = 0;
+    return 0;
+}
+
+int SEQMEM::close()
+{
+    if (NULL != shm) {
+	shm->delete_totally = delete_totally;
+	delete shm;
+	shm = NULL;
+    }
+    block = NULL;
+    if (NULL != copy) {
+	free(copy);
+	copy = NULL;
+    }
+    return 0;
+}
+
+/* Copy the message at src out of shared memory. A raw message is only
+   copied as far as its header says it is long. */
+long SEQMEM::copy_out(const char *src)
+{
+    CMS_HEADER h;
+    long n = size;
+
+    if (!neutral) {
+	memcpy(&h, src, sizeof(CMS_HEADER));
+	/* may be torn, the caller retries then */
+	if (h.in_buffer_size >= 0 &&
+	    h.in_buffer_size <= size - (long) sizeof(CMS_HEADER)) {
+	    n = sizeof(CMS_HEADER) + h.in_buffer_size;
+	}
+    }
+    memcpy(copy, src, n);
+    return n;
+}
+
+/* Run the CMS access on a single message, queue slots hold one
+   message each so the queuing code of CMS is bypassed. */
+void SEQMEM::slot_access(char *data, void *_local)
+{
+    int queuing = queuing_enabled;
+
+    queuing_enabled = 0;
+    internal_access(data, size, _local);
+    queuing_enabled = queuing;
+}
+
+CMS_STATUS SEQMEM::buffer_read(void *_local)
+{
+    uint32_t s1, s2;
+
+    s1 = load_acquire(&block->seq);
+    if ((s1 >> 1) == last_gen && in_buffer_id == last_id) {
+	/* nothing was written since the last read */
+	return (status = CMS_READ_OLD);
+    }
+    for (;;) {
+	/* The current message is in slot s1 / 2 and only gets
+	   overwritten by the write after the next one, that is once
+	   seq has moved by more than 2. */
+	copy_out(slot_data(slot(s1 >> 1)));
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	s2 = __atomic_load_n(&block->seq, __ATOMIC_RELAXED);
+	if ((uint32_t) (s2 - (s1 & ~1U)) <= 2) {
+	    break;
+	}
+	s1 = load_acquire(&block->seq);
+    }
+
+    internal_access(copy, size, _local);
+
+    if (internal_access_type == CMS_READ_ACCESS && status >= 0 &&
+	!__atomic_load_n(&block->was_read, __ATOMIC_RELAXED)) {
+	__atomic_store_n(&block->was_read, 1, __ATOMIC_RELAXED);
+    }
+    last_gen = s1 >> 1;
+    last_id = in_buffer_id;
+    return (status);
+}
+
+CMS_STATUS SEQMEM::buffer_write(void *_local)
+{
+    CMS_INTERNAL_ACCESS_TYPE type = internal_access_type;
+    long header_size;
+    uint32_t s;
+
+    if (type == CMS_WRITE_IF_READ_ACCESS &&
+	!__atomic_load_n(&block->was_read, __ATOMIC_RELAXED)) {
+	return (status = CMS_WRITE_WAS_BLOCKED);
+    }
+
+    /* take the writer side of the seqlock, seq is odd while writing */
+    for (;;) {
+	s = __atomic_load_n(&block->seq, __ATOMIC_RELAXED);
+	if (!(s & 1) &&
+	    __atomic_compare_exchange_n(&block->seq, &s, s + 1, true,
+		__ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+	    break;
+	}
+	sched_yield();
+    }
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    /* CMS takes the write id from the header in the buffer, carry it
+       over from the current message */
+    header_size = neutral ? encoded_header_size : (long) sizeof(CMS_HEADER);
+    if (header_size > 0 && header_size <= size) {
+	memcpy(slot_data(slot((s >> 1) + 1)), slot_data(slot(s >> 1)),
+	    header_size);
+    }
+
+    internal_access_type = CMS_WRITE_ACCESS;
+    internal_access(slot_data(slot((s >> 1) + 1)), size, _local);
+    internal_access_type = type;
+
+    if (status < 0) {
+	/* readers stay on the current message */
+	store_release(&block->seq, s);
+	return (status);
+    }
+    __atomic_store_n(&block->was_read, 0, __ATOMIC_RELAXED);
+    store_release(&block->seq, s + 2);
+    return (status);
+}
+
+void SEQMEM::buffer_clear()
+{
+    uint32_t s;
+
+    for (;;) {
+	s = __atomic_load_n(&block->seq, __ATOMIC_RELAXED);
+	if (!(s & 1) &&
+	    __atomic_compare_exchange_n(&block->seq, &s, s + 1, true,
+		__ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+	    break;
+	}
+	sched_yield();
+    }
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    memset(slot_data(slot(0)), 0, size);
+    memset(slot_data(slot(1)), 0, size);
+    __atomic_store_n(&block->was_read, 0, __ATOMIC_RELAXED);
+    store_release(&block->seq, s + 2);
+}
+
+/* The queue is a bounded ring in the style of D. Vyukov's MPMC queue:
+   slot n % nslots is free for the writer at position n when its seq
+   is n and holds a message for the reader at position n when its seq
+   is n + 1. Writers and readers claim positions by advancing tail and
+   head with a compare and swap. */
+CMS_STATUS SEQMEM::queue_write(void *_local)
+{
+    CMS_INTERNAL_ACCESS_TYPE type = internal_access_type;
+    seqmem_slot_t *sl;
+    uint32_t pos, seq;
+    int32_t dif;
+
+    if (type == CMS_WRITE_IF_READ_ACCESS &&
+	load_acquire(&block->head) != load_acquire(&block->tail)) {
+	return (status = CMS_WRITE_WAS_BLOCKED);
+    }
+
+    pos = __atomic_load_n(&block->tail, __ATOMIC_RELAXED);
+    for (;;) {
+	sl = slot(pos);
+	seq = load_acquire(&sl->seq);
+	dif = (int32_t) (seq - pos);
+	if (dif == 0) {
+	    if (__atomic_compare_exchange_n(&block->tail, &pos, pos + 1,
+		    true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+		break;
+	    }
+	} else if (dif < 0) {
+	    if (cms_print_queue_full_messages) {
+		rcs_print_error("CMS: %s message queue is full.\n",
+		    BufferName);
+	    }
+	    return (status = CMS_QUEUE_FULL);
+	} else {
+	    pos = __atomic_load_n(&block->tail, __ATOMIC_RELAXED);
+	}
+    }
+
+    internal_access_type = CMS_WRITE_ACCESS;
+    slot_access(slot_data(sl), _local);
+    internal_access_type = type;
+
+    /* publish the slot even if the write failed, readers skip it */
+    __atomic_store_n(&sl->valid, status >= 0, __ATOMIC_RELAXED);
+    store_release(&sl->seq, pos + 1);
+    return (status);
+}
+
+CMS_STATUS SEQMEM::queue_read(void *_local)
+{
+    seqmem_slot_t *sl;
+    uint32_t pos, seq;
+    int32_t dif;
+
+    for (;;) {
+	pos = __atomic_load_n(&block->head, __ATOMIC_RELAXED);
+	sl = slot(pos);
+	seq = load_acquire(&sl->seq);
+	dif = (int32_t) (seq - (pos + 1));
+	if (dif < 0) {
+	    return (status = CMS_READ_OLD);	/* empty */
+	}
+	if (dif > 0) {
+	    continue;		/* another reader took it */
+	}
+
+	if (internal_access_type == CMS_PEEK_ACCESS) {
+	    /* leave the message in the queue, work on a copy which is
+	       only good if the slot was not consumed meanwhile */
+	    copy_out(slot_data(sl));
+	    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+	    if (__atomic_load_n(&sl->seq, __ATOMIC_RELAXED) != seq) {
+		continue;
+	    }
+	    if (!__atomic_load_n(&sl->valid, __ATOMIC_RELAXED)) {
+		return (status = CMS_READ_OLD);
+	    }
+	    in_buffer_id = 0;
+	    slot_access(copy, _local);
+	    break;
+	}
+
+	if (!__atomic_compare_exchange_n(&block->head, &pos, pos + 1,
+		true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+	    continue;
+	}
+	if (__atomic_load_n(&sl->valid, __ATOMIC_RELAXED)) {
+	    /* every message in the queue is new, whatever write id the
+	       slot carries */
+	    in_buffer_id = 0;
+	    slot_access(slot_data(sl), _local);
+	}
+	store_release(&sl->seq, pos + block->nslots);
+	if (__atomic_load_n(&sl->valid, __ATOMIC_RELAXED)) {
+	    break;
+	}
+    }
+    total_messages_missed -= messages_missed_on_last_read;
+    messages_missed_on_last_read = 0;
+    return (status);
+}
+
+void SEQMEM::queue_clear()
+{
+    seqmem_slot_t *sl;
+    uint32_t pos;
+
+    for (;;) {
+	pos = __atomic_load_n(&block->head, __ATOMIC_RELAXED);
+	sl = slot(pos);
+	if ((int32_t) (load_acquire(&sl->seq) - (pos + 1)) < 0) {
+	    break;
+	}
+	if (__atomic_compare_exchange_n(&block->head, &pos, pos + 1,
+		true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+	    store_release(&sl->seq, pos + block->nslots);
+	}
+    }
+}
+
+/* Access the shared memory buffer. */
+CMS_STATUS SEQMEM::main_access(void *_local)
+{
+    uint32_t head, tail;
+    double start;
+
+    if (NULL == block) {
+	return (status = CMS_MISC_ERROR);
+    }
+
+    switch (internal_access_type) {
+    case CMS_CLEAR_ACCESS:
+	if (use_queue) {
+	    queue_clear();
+	} else {
+	    buffer_clear();
+	}
+	in_buffer_id = 0;
+	status = CMS_CLEAR_OK;
+	break;
+
+    case CMS_READ_ACCESS:
+    case CMS_PEEK_ACCESS:
+	if (use_queue) {
+	    queue_read(_local);
+	} else {
+	    buffer_read(_local);
+	}
+	/* no semaphore to block on, poll for blocking_read() */
+	if (internal_access_type == CMS_READ_ACCESS &&
+	    status == CMS_READ_OLD &&
+	    (blocking_timeout > 1e-6 || blocking_timeout < -1e-6)) {
+	    start = etime();
+	    while (status == CMS_READ_OLD) {
+		if (blocking_timeout > 0 &&
+		    etime() - start > blocking_timeout) {
+		    status = CMS_TIMED_OUT;
+		    break;
+		}
+		esleep(poll_delay);
+		if (use_queue) {
+		    queue_read(_local);
+		} else {
+		    buffer_read(_local);
+		}
+	    }
+	}
+	break;
+
+    case CMS_WRITE_ACCESS:
+    case CMS_WRITE_IF_READ_ACCESS:
+	if (use_queue) {
+	    queue_write(_local);
+	} else {
+	    buffer_write(_local);
+	}
+	break;
+
+    case CMS_CHECK_IF_READ_ACCESS:
+	if (use_queue) {
+	    header.was_read =
+		load_acquire(&block->head) == load_acquire(&block->tail);
+	} else {
+	    header.was_read = load_acquire(&block->was_read);
+	}
+	break;
+
+    case CMS_GET_MSG_COUNT_ACCESS:
+	if (use_queue) {
+	    header.write_id = load_acquire(&block->tail);
+	} else {
+	    header.write_id = load_acquire(&block->seq) >> 1;
+	}
+	break;
+
+    case CMS_GET_QUEUE_LENGTH_ACCESS:
+    case CMS_GET_SPACE_AVAILABLE_ACCESS:
+	head = load_acquire(&block->head);
+	tail = load_acquire(&block->tail);
+	queuing_header.queue_length = tail - head;
+	free_space = (block->nslots - (tail - head)) * size;
+	break;
+
+    default:
+	rcs_print_error("SEQMEM: access type %d not supported.\n",
+	    internal_access_type);
+	status = CMS_NO_IMPLEMENTATION_ERROR;
+	break;
+    }
+    return (status);
+}
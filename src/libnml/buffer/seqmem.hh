@@ -0,0 +1,106 @@
+/********************************************************************
+* Description: seqmem.hh
+*   C++ file for the Communication Management System (CMS).
+*   Includes member Functions for class SEQMEM.
+*   Notes: SEQMEM is a shared memory buffer on the same host, like
+*   SHMEM, which takes no semaphore on read, write or peek.
+*
+*   Without QUEUE the buffer holds two copies of the message behind a
+*   sequence counter (seqlock). The writer fills the copy readers are
+*   not looking at and then flips the counter, readers copy the
+*   current message out and retry if a write overtook them. Readers
+*   never block the writer or each other. Writers are serialized by
+*   the counter, it is meant for channels with a single writer such
+*   as status buffers.
+*
+*   With QUEUE the buffer is a bounded ring of QLEN= (default 16,
+*   rounded up to a power of two) message slots, each guarded by its
+*   own sequence number, so that several writers can queue commands or
+*   errors without a lock.
+*
+*   Every copy or slot holds a message of up to the configured buffer
+*   size, the shared memory segment is sized accordingly.
+*
+* License: GPL Version 2
+* System: Linux
+*
+* Copyright (c) 2016 All rights reserved.
+********************************************************************/
+
+#ifndef SEQMEM_HH
+#define SEQMEM_HH
+
+#include <stdint.h>		/* uint32_t */
+#include <sys/types.h>		/* key_t */
+
+#include "cms.hh"		/* class CMS */
+#include "shm.hh"		/* class RCS_SHAREDMEM */
+
+#define SEQMEM_MAGIC 0x53455131
+#define SEQMEM_DEFAULT_QLEN 16
+
+/* control block, after the 32 byte buffer name. The words written by
+   different parties are kept on separate cache lines. */
+typedef struct {
+    uint32_t magic;
+    uint32_t nslots;
+    uint32_t slot_size;
+    uint32_t reserved;
+    char pad0[48];
+    uint32_t seq;		/* double buffer: odd while writing */
+    uint32_t was_read;
+    char pad1[56];
+    uint32_t head;		/* queue: next slot to read */
+    char pad2[60];
+    uint32_t tail;		/* queue: next slot to write */
+    char pad3[60];
+} seqmem_block_t;
+
+typedef struct {
+    uint32_t seq;		/* queue: position this slot is ready for */
+    uint32_t valid;		/* queue: message was written completely */
+} seqmem_slot_t;
+
+class SEQMEM:public CMS {
+  public:
+    SEQMEM(const char *bufline, const char *procline, int set_to_server = 0,
+	int set_to_master = 0);
+    virtual ~ SEQMEM();
+
+    CMS_STATUS main_access(void *_local);
+
+  private:
+    int open();
+    int close();
+
+    CMS_STATUS buffer_read(void *_local);
+    CMS_STATUS buffer_write(void *_local);
+    void buffer_clear();
+    CMS_STATUS queue_read(void *_local);
+    CMS_STATUS queue_write(void *_local);
+    void queue_clear();
+    long copy_out(const char *src);
+    void slot_access(char *data, void *_local);
+
+    seqmem_slot_t *slot(uint32_t n) {
+	return (seqmem_slot_t *) (slots + (n % block->nslots) * stride);
+    }
+    char *slot_data(seqmem_slot_t * s) {
+	return (char *) s + sizeof(seqmem_slot_t);
+    }
+
+    key_t key;
+    int master;
+    int use_queue;
+    uint32_t qlen;
+    long stride;		/* bytes per slot incl. seqmem_slot_t */
+    double poll_delay;		/* blocking_read() poll interval */
+    RCS_SHAREDMEM *shm;
+    seqmem_block_t *block;
+    char *slots;
+    char *copy;			/* readers copy the message out here */
+    uint32_t last_gen;		/* generation of the last read */
+    CMSID last_id;		/* in_buffer_id after the last read */
+};
+
+#endif /* !SEQMEM_HH */
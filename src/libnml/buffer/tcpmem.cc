@@ -197,7 +197,7 @@ void
     rcs_print_debug(PRINT_ALL_SOCKET_REQUESTS,
 	"TCPMEM sending request: fd = %d, serial_number=%ld, request_type=%d, buffer_number=%ld\n",
 	socket_fd, serial_number,
-	ntohl(*((u_long *) diag_info_buf + 1)), buffer_number);
+	getbe32(diag_info_buf + 4), buffer_number);
     reenable_sigpipe();
 
 }
@@ -225,7 +225,7 @@ void TCPMEM::verify_bufname()
     rcs_print_debug(PRINT_ALL_SOCKET_REQUESTS,
 	"TCPMEM sending request: fd = %d, serial_number=%ld, request_type=%d, buffer_number=%ld\n",
 	socket_fd, serial_number,
-	ntohl(*((u_long *) temp_buffer + 1)), buffer_number);
+	getbe32(temp_buffer + 4), buffer_number);
     if (recvn(socket_fd, temp_buffer, 40, 0, timeout, &recvd_bytes) < 0) {
 	if (recvn_timedout) {
 	    bytes_to_throw_away = 40;
@@ -246,7 +246,7 @@ void TCPMEM::verify_bufname()
 	status = CMS_MISC_ERROR;
 	return;
     }
-    status = (CMS_STATUS) ntohl(*((u_long *) temp_buffer + 1));
+    status = (CMS_STATUS) getbe32(temp_buffer + 4);
     if (status < 0) {
 	return;
     }
@@ -293,7 +293,7 @@ CMS_DIAGNOSTICS_INFO *TCPMEM::get_diagnostics_info()
     rcs_print_debug(PRINT_ALL_SOCKET_REQUESTS,
 	"TCPMEM sending request: fd = %d, serial_number=%ld, request_type=%d, buffer_number=%ld\n",
 	socket_fd, serial_number,
-	ntohl(*((u_long *) temp_buffer + 1)), buffer_number);
+	getbe32(temp_buffer + 4), buffer_number);
     if (recvn(socket_fd, temp_buffer, 32, 0, -1.0, &recvd_bytes) < 0) {
 	if (recvn_timedout) {
 	    bytes_to_throw_away = 32;
@@ -315,7 +315,7 @@ CMS_DIAGNOSTICS_INFO *TCPMEM::get_diagnostics_info()
 	status = CMS_MISC_ERROR;
 	return (NULL);
     }
-    status = (CMS_STATUS) ntohl(*((u_long *) temp_buffer + 1));
+    status = (CMS_STATUS) getbe32(temp_buffer + 4);
     if (status < 0) {
 	return (NULL);
     }
@@ -327,14 +327,14 @@ CMS_DIAGNOSTICS_INFO *TCPMEM::get_diagnostics_info()
     }
     di->last_writer_dpi = NULL;
     di->last_reader_dpi = NULL;
-    di->last_writer = ntohl(*((u_long *) temp_buffer + 2));
-    di->last_reader = ntohl(*((u_long *) temp_buffer + 3));
+    di->last_writer = getbe32(temp_buffer + 8);
+    di->last_reader = getbe32(temp_buffer + 12);
     double server_time;
     memcpy(&server_time, temp_buffer + 16, 8);
     double local_time = etime();
     double diff_time = local_time - server_time;
-    int dpi_count = ntohl(*((u_long *) temp_buffer + 6));
-    int dpi_max_size = ntohl(*((u_long *) temp_buffer + 7));
+    int dpi_count = getbe32(temp_buffer + 24);
+    int dpi_max_size = getbe32(temp_buffer + 28);
     if (dpi_max_size > 32 && dpi_max_size < 0x2000) {
 	if (recvn
 	    (socket_fd, temp_buffer + 32, dpi_max_size - 32, 0, -1.0,
@@ -354,27 +354,27 @@ CMS_DIAGNOSTICS_INFO *TCPMEM::get_diagnostics_info()
 	    memcpy(cms_dpi.host_sysinfo, temp_buffer + dpi_offset, 32);
 	    dpi_offset += 32;
 	    cms_dpi.pid =
-		ntohl(*((u_long *) ((char *) temp_buffer + dpi_offset)));
+		getbe32(temp_buffer + dpi_offset);
 	    dpi_offset += 4;
 	    memcpy(&(cms_dpi.rcslib_ver), temp_buffer + dpi_offset, 8);
 	    dpi_offset += 8;
 	    cms_dpi.access_type = (CMS_INTERNAL_ACCESS_TYPE)
-		ntohl(*((u_long *) ((char *) temp_buffer + dpi_offset)));
+		getbe32(temp_buffer + dpi_offset);
 	    dpi_offset += 4;
 	    cms_dpi.msg_id =
-		ntohl(*((u_long *) ((char *) temp_buffer + dpi_offset)));
+		getbe32(temp_buffer + dpi_offset);
 	    dpi_offset += 4;
 	    cms_dpi.msg_size =
-		ntohl(*((u_long *) ((char *) temp_buffer + dpi_offset)));
+		getbe32(temp_buffer + dpi_offset);
 	    dpi_offset += 4;
 	    cms_dpi.msg_type =
-		ntohl(*((u_long *) ((char *) temp_buffer + dpi_offset)));
+		getbe32(temp_buffer + dpi_offset);
 	    dpi_offset += 4;
 	    cms_dpi.number_of_accesses =
-		ntohl(*((u_long *) ((char *) temp_buffer + dpi_offset)));
+		getbe32(temp_buffer + dpi_offset);
 	    dpi_offset += 4;
 	    cms_dpi.number_of_new_messages =
-		ntohl(*((u_long *) ((char *) temp_buffer + dpi_offset)));
+		getbe32(temp_buffer + dpi_offset);
 	    dpi_offset += 4;
 	    memcpy(&(cms_dpi.bytes_moved), temp_buffer + dpi_offset, 8);
 	    dpi_offset += 8;
@@ -397,14 +397,14 @@ CMS_DIAGNOSTICS_INFO *TCPMEM::get_diagnostics_info()
 	    dpi_offset += 8;
 	    di->dpis->store_at_tail(&cms_dpi, sizeof(CMS_DIAG_PROC_INFO), 1);
 	    int is_last_writer =
-		ntohl(*((u_long *) ((char *) temp_buffer + dpi_offset)));
+		getbe32(temp_buffer + dpi_offset);
 	    dpi_offset += 4;
 	    if (is_last_writer) {
 		di->last_writer_dpi =
 		    (CMS_DIAG_PROC_INFO *) di->dpis->get_tail();
 	    }
 	    int is_last_reader =
-		ntohl(*((u_long *) ((char *) temp_buffer + dpi_offset)));
+		getbe32(temp_buffer + dpi_offset);
 	    dpi_offset += 4;
 	    if (is_last_reader) {
 		di->last_reader_dpi =
@@ -532,7 +532,7 @@ void TCPMEM::reconnect()
 	    rcs_print_debug(PRINT_ALL_SOCKET_REQUESTS,
 		"TCPMEM sending request: fd = %d, serial_number=%ld, request_type=%d, buffer_number=%ld\n",
 		socket_fd, serial_number,
-		ntohl(*((u_long *) temp_buffer + 1)), buffer_number);
+		getbe32(temp_buffer + 4), buffer_number);
 	    memset(temp_buffer, 0, 20);
 	    recvd_bytes = 0;
 	    if (recvn(socket_fd, temp_buffer, 8, 0, 30, &recvd_bytes) < 0) {
@@ -711,11 +711,11 @@ CMS_STATUS TCPMEM::handle_old_replies()
 		    serial_number = returned_serial_number;
 		}
 	    }
-	    message_size = ntohl(*((u_long *) temp_buffer + 2));
+	    message_size = getbe32(temp_buffer + 8);
 	    timedout_request_status =
-		(CMS_STATUS) ntohl(*((u_long *) temp_buffer + 1));
-	    timedout_request_writeid = ntohl(*((u_long *) temp_buffer + 3));
-	    header.was_read = ntohl(*((u_long *) temp_buffer + 4));
+		(CMS_STATUS) getbe32(temp_buffer + 4);
+	    timedout_request_writeid = getbe32(temp_buffer + 12);
+	    header.was_read = getbe32(temp_buffer + 16);
 	    if (message_size > max_encoded_message_size) {
 		rcs_print_error("Recieved message is too big. (%ld > %ld)\n",
 		    message_size, max_encoded_message_size);
@@ -960,7 +960,7 @@ CMS_STATUS TCPMEM::read()
 
     int send_header_size = 20;
     if (total_subdivisions > 1) {
-	*((u_long *) temp_buffer + 5) = htonl((u_long) current_subdivision);
+	putbe32(temp_buffer + 20, (u_long) current_subdivision);
 	send_header_size = 24;
     }
     if (sendn(socket_fd, temp_buffer, send_header_size, 0, timeout) < 0) {
@@ -974,7 +974,7 @@ CMS_STATUS TCPMEM::read()
     rcs_print_debug(PRINT_ALL_SOCKET_REQUESTS,
 	"TCPMEM sending request: fd = %d, serial_number=%ld, request_type=%d, buffer_number=%ld\n",
 	socket_fd, serial_number,
-	ntohl(*((u_long *) temp_buffer + 1)), buffer_number);
+	getbe32(temp_buffer + 4), buffer_number);
 
     if (recvn(socket_fd, temp_buffer, 20, 0, timeout, &recvd_bytes) < 20) {
 	if (recvn_timedout) {
@@ -1011,10 +1011,10 @@ CMS_STATUS TCPMEM::read()
 	    return (status = CMS_MISC_ERROR);
 	}
     }
-    status = (CMS_STATUS) ntohl(*((u_long *) temp_buffer + 1));
-    message_size = ntohl(*((u_long *) temp_buffer + 2));
-    id = ntohl(*((u_long *) temp_buffer + 3));
-    header.was_read = ntohl(*((u_long *) temp_buffer + 4));
+    status = (CMS_STATUS) getbe32(temp_buffer + 4);
+    message_size = getbe32(temp_buffer + 8);
+    id = getbe32(temp_buffer + 12);
+    header.was_read = getbe32(temp_buffer + 16);
     if (message_size > max_encoded_message_size) {
 	rcs_print_error("Recieved message is too big. (%ld > %ld)\n",
 	    message_size, max_encoded_message_size);
@@ -1175,7 +1175,7 @@ CMS_STATUS TCPMEM::blocking_read(double _blocking_timeout)
 	"TCPMEM sending request: fd = %d, serial_number=%ld, "
 	"request_type=%d, buffer_number=%ld\n",
 	socket_fd, serial_number,
-	ntohl(*((u_long *) temp_buffer + 1)), buffer_number);
+	getbe32(temp_buffer + 4), buffer_number);
     if (recvn(socket_fd, temp_buffer, 20, 0, blocking_timeout, &recvd_bytes) <
 	0) {
 	print_recvn_timeout_errors = orig_print_recvn_timeout_errors;
@@ -1214,10 +1214,10 @@ CMS_STATUS TCPMEM::blocking_read(double _blocking_timeout)
 	    return (status = CMS_MISC_ERROR);
 	}
     }
-    status = (CMS_STATUS) ntohl(*((u_long *) temp_buffer + 1));
-    message_size = ntohl(*((u_long *) temp_buffer + 2));
-    id = ntohl(*((u_long *) temp_buffer + 3));
-    header.was_read = ntohl(*((u_long *) temp_buffer + 4));
+    status = (CMS_STATUS) getbe32(temp_buffer + 4);
+    message_size = getbe32(temp_buffer + 8);
+    id = getbe32(temp_buffer + 12);
+    header.was_read = getbe32(temp_buffer + 16);
     if (message_size > max_encoded_message_size) {
 	rcs_print_error("Recieved message is too big. (%ld > %ld)\n",
 	    message_size, max_encoded_message_size);
@@ -1355,7 +1355,7 @@ CMS_STATUS TCPMEM::peek()
     putbe32(temp_buffer + 16, (uint32_t) in_buffer_id);
     int send_header_size = 20;
     if (total_subdivisions > 1) {
-	*((u_long *) temp_buffer + 20) = htonl((u_long) current_subdivision);
+	putbe32(temp_buffer + 80, (u_long) current_subdivision);
 	send_header_size = 24;
     }
     if (sendn(socket_fd, temp_buffer, send_header_size, 0, timeout) < 0) {
@@ -1400,10 +1400,10 @@ CMS_STATUS TCPMEM::peek()
 	    return (status = CMS_MISC_ERROR);
 	}
     }
-    status = (CMS_STATUS) ntohl(*((u_long *) temp_buffer + 1));
-    message_size = ntohl(*((u_long *) temp_buffer + 2));
-    id = ntohl(*((u_long *) temp_buffer + 3));
-    header.was_read = ntohl(*((u_long *) temp_buffer + 4));
+    status = (CMS_STATUS) getbe32(temp_buffer + 4);
+    message_size = getbe32(temp_buffer + 8);
+    id = getbe32(temp_buffer + 12);
+    header.was_read = getbe32(temp_buffer + 16);
     if (message_size > max_encoded_message_size) {
 	reconnect_needed = 1;
 	rcs_print_error("Recieved message is too big. (%ld > %ld)\n",
@@ -1559,8 +1559,8 @@ CMS_STATUS TCPMEM::write(void *user_data)
 		return (status = CMS_MISC_ERROR);
 	    }
 	}
-	status = (CMS_STATUS) ntohl(*((u_long *) temp_buffer + 1));
-	header.was_read = ntohl(*((u_long *) temp_buffer + 2));
+	status = (CMS_STATUS) getbe32(temp_buffer + 4);
+	header.was_read = getbe32(temp_buffer + 8);
     } else {
 	header.was_read = 0;
 	status = CMS_WRITE_OK;
@@ -1678,8 +1678,8 @@ CMS_STATUS TCPMEM::write_if_read(void *user_data)
 		return (status = CMS_MISC_ERROR);
 	    }
 	}
-	status = (CMS_STATUS) ntohl(*((u_long *) temp_buffer + 1));
-	header.was_read = ntohl(*((u_long *) temp_buffer + 2));
+	status = (CMS_STATUS) getbe32(temp_buffer + 4);
+	header.was_read = getbe32(temp_buffer + 8);
     } else {
 	header.was_read = 0;
 	status = CMS_WRITE_OK;
@@ -1763,8 +1763,8 @@ int TCPMEM::check_if_read()
 	reenable_sigpipe();
 	return (status = CMS_MISC_ERROR);
     }
-    status = (CMS_STATUS) ntohl(*((u_long *) temp_buffer + 1));
-    header.was_read = ntohl(*((u_long *) temp_buffer + 2));
+    status = (CMS_STATUS) getbe32(temp_buffer + 4);
+    header.was_read = getbe32(temp_buffer + 8);
     reenable_sigpipe();
     return (header.was_read);
 }
@@ -1843,8 +1843,8 @@ int TCPMEM::get_queue_length()
 	reenable_sigpipe();
 	return (status = CMS_MISC_ERROR);
     }
-    status = (CMS_STATUS) ntohl(*((u_long *) temp_buffer + 1));
-    queuing_header.queue_length = ntohl(*((u_long *) temp_buffer + 2));
+    status = (CMS_STATUS) getbe32(temp_buffer + 4);
+    queuing_header.queue_length = getbe32(temp_buffer + 8);
     reenable_sigpipe();
     return (queuing_header.queue_length);
 }
@@ -1923,8 +1923,8 @@ int TCPMEM::get_msg_count()
 	reenable_sigpipe();
 	return (status = CMS_MISC_ERROR);
     }
-    status = (CMS_STATUS) ntohl(*((u_long *) temp_buffer + 1));
-    header.write_id = ntohl(*((u_long *) temp_buffer + 2));
+    status = (CMS_STATUS) getbe32(temp_buffer + 4);
+    header.write_id = getbe32(temp_buffer + 8);
     reenable_sigpipe();
     return (header.write_id);
 }
@@ -2003,8 +2003,8 @@ int TCPMEM::get_space_available()
 	reenable_sigpipe();
 	return (status = CMS_MISC_ERROR);
     }
-    status = (CMS_STATUS) ntohl(*((u_long *) temp_buffer + 1));
-    free_space = ntohl(*((u_long *) temp_buffer + 2));
+    status = (CMS_STATUS) getbe32(temp_buffer + 4);
+    free_space = getbe32(temp_buffer + 8);
     reenable_sigpipe();
     return (free_space);
 }
@@ -2070,8 +2070,8 @@ CMS_STATUS TCPMEM::clear()
 	reconnect_needed = 1;
 	return (status = CMS_MISC_ERROR);
     }
-    status = (CMS_STATUS) ntohl(*((u_long *) temp_buffer + 1));
-    header.was_read = ntohl(*((u_long *) temp_buffer + 2));
+    status = (CMS_STATUS) getbe32(temp_buffer + 4);
+    header.was_read = getbe32(temp_buffer + 8);
     return (status);
 }
 /*! \todo Another #if 0 */
@@ -2098,10 +2098,9 @@ int TCPMEM::login(const char *name, const char *passwd)
 	return 0;
     }
     set_socket_fds(write_socket_fd);
-    *((u_long *) temp_buffer) = htonl((u_long) serial_number);
-    *((u_long *) temp_buffer + 1) =
-	htonl((u_long) REMOTE_CMS_GET_KEYS_REQUEST_TYPE);
-    *((u_long *) temp_buffer + 2) = htonl((u_long) buffer_number);
+    putbe32(temp_buffer, (u_long) serial_number);
+    putbe32(temp_buffer + 4, (u_long) REMOTE_CMS_GET_KEYS_REQUEST_TYPE);
+    putbe32(temp_buffer + 8, (u_long) buffer_number);
     if (sendn(socket_fd, temp_buffer, 20, 0, 30.0) < 0) {
 	return 0;
     }
@@ -2140,10 +2139,9 @@ int TCPMEM::login(const char *name, const char *passwd)
     char passwd_pass2[16];
     strncpy(passwd_pass2, crypt2_ret, 16);
 
-    *((u_long *) temp_buffer) = htonl((u_long) serial_number);
-    *((u_long *) temp_buffer + 1) =
-	htonl((u_long) REMOTE_CMS_LOGIN_REQUEST_TYPE);
-    *((u_long *) temp_buffer + 2) = htonl((u_long) buffer_number);
+    putbe32(temp_buffer, (u_long) serial_number);
+    putbe32(temp_buffer + 4, (u_long) REMOTE_CMS_LOGIN_REQUEST_TYPE);
+    putbe32(temp_buffer + 8, (u_long) buffer_number);
     if (sendn(socket_fd, temp_buffer, 20, 0, 30.0) < 0) {
 	return 0;
     }
@@ -2170,7 +2168,7 @@ int TCPMEM::login(const char *name, const char *passwd)
 	    returned_serial_number, serial_number);
 	return (status = CMS_MISC_ERROR);
     }
-    int success = ntohl(*((u_long *) temp_buffer + 1));
+    int success = getbe32(temp_buffer + 4);
     return (success);
 }
 #endif
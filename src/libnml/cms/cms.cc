@@ -332,6 +332,8 @@ CMS::CMS(const char *bufline_in, const char *procline_in, int set_to_server)
 	BufferType = CMS_LOCMEM_TYPE;
     } else if (!strcmp(buffer_type_name, "FILEMEM")) {
 	BufferType = CMS_FILEMEM_TYPE;
+    } else if (!strcmp(buffer_type_name, "SEQMEM")) {
+	BufferType = CMS_SEQMEM_TYPE;
     } else {
 	rcs_print_error("CMS: invalid buffer type (%s)\n", buffer_type_name);
 	status = CMS_CONFIG_ERROR;
@@ -632,6 +634,11 @@ void CMS::open(void)
     temp_updater = (CMS_UPDATER *) NULL;
     last_im = CMS_NOT_A_MODE;
     pointer_check_disabled = 0;
+    encode_cache_raw = NULL;
+    encode_cache_enc = NULL;
+    encode_cache_raw_size = 0;
+    encode_cache_enc_size = 0;
+    encode_cache_updater = (CMS_UPDATER *) NULL;
 
     dummy_handle = (PHYSMEM_HANDLE *) NULL;
 
@@ -878,6 +885,14 @@ CMS::~CMS()
 	    encoded_data = NULL;
 	}
     }
+    if (NULL != encode_cache_raw) {
+	free(encode_cache_raw);
+	encode_cache_raw = NULL;
+    }
+    if (NULL != encode_cache_enc) {
+	free(encode_cache_enc);
+	encode_cache_enc = NULL;
+    }
     number_of_cms_objects--;
 
     if (NULL != dummy_handle) {
@@ -1271,6 +1286,55 @@ int CMS::get_encoded_msg_size()
     return (header.in_buffer_size = updater->get_encoded_msg_size());
 }
 
+/* A server encodes the message for every remote read, status buffers
+   are read by every client and mostly hold the same data as on the last
+   read, even if they were written in between. If the raw bytes are the
+   same as last time copy the encoding made then to encoded_data and
+   return 1. */
+int CMS::encode_cache_find(long raw_size)
+{
+    if (NULL == encode_cache_raw || NULL == encoded_data || raw_size <= 0
+	|| raw_size != encode_cache_raw_size
+	|| updater != encode_cache_updater
+	|| encode_cache_enc_size > encoded_data_size) {
+	return 0;
+    }
+    if (memcmp(subdiv_data, encode_cache_raw, raw_size)) {
+	return 0;
+    }
+    memcpy(encoded_data, encode_cache_enc, encode_cache_enc_size);
+    header.in_buffer_size = encode_cache_enc_size;
+    return 1;
+}
+
+/* Keep a copy of the message just encoded and its encoding. Queues are
+   left out, every message is read only once. */
+void CMS::encode_cache_store(long raw_size)
+{
+    void *raw, *enc;
+
+    encode_cache_raw_size = 0;
+    if (queuing_enabled || total_subdivisions > 1 || NULL == encoded_data
+	|| raw_size <= 0 || raw_size > size || header.in_buffer_size <= 0) {
+	return;
+    }
+    raw = realloc(encode_cache_raw, raw_size);
+    if (NULL == raw) {
+	return;
+    }
+    encode_cache_raw = raw;
+    enc = realloc(encode_cache_enc, header.in_buffer_size);
+    if (NULL == enc) {
+	return;
+    }
+    encode_cache_enc = enc;
+    memcpy(encode_cache_raw, subdiv_data, raw_size);
+    memcpy(encode_cache_enc, encoded_data, header.in_buffer_size);
+    encode_cache_raw_size = raw_size;
+    encode_cache_enc_size = header.in_buffer_size;
+    encode_cache_updater = updater;
+}
+
 int CMS::check_pointer(char *ptr, long bytes)
 {
     if (force_raw) {
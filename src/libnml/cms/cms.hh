@@ -121,6 +121,7 @@ enum CMS_BUFFERTYPE {
     CMS_PHANTOM_BUFFER,
     CMS_LOCMEM_TYPE,
     CMS_FILEMEM_TYPE,
+    CMS_SEQMEM_TYPE
 };
 
 /* How will this process access the buffer. */
@@ -208,6 +209,11 @@ class CMS {
     void rewind();		/* positions at beginning */
     int get_encoded_msg_size();	/* Store last position in header.size */
 
+    /* Servers: reuse the encoding of the last message read if it has not
+       changed. */
+    int encode_cache_find(long raw_size);
+    void encode_cache_store(long raw_size);
+
     /* Buffer access control functions. */
     void set_mode(CMSMODE im);	/* Determine read/write mode.(check neutral) */
 
@@ -451,6 +457,11 @@ class CMS {
     int set_subdivision(int _subdiv);
     long encoded_data_size;
     long enc_max_size;
+    void *encode_cache_raw;	/* last message encoded for a reader */
+    void *encode_cache_enc;	/* and its encoding */
+    long encode_cache_raw_size;
+    long encode_cache_enc_size;
+    CMS_UPDATER *encode_cache_updater;
     long enable_diagnostics;
     CMS_DIAG_PROC_INFO *dpi;
     virtual CMS_DIAG_PROC_INFO *get_diag_proc_info();
@@ -23,6 +23,91 @@ extern "C" {
 #include "cms_xup.hh"		/* class CMS_XDR_UPDATER */
 #include "rcs_print.hh"		/* rcs_print_error() */
 
+#include <string.h>		/* memcpy() */
+#include <stdint.h>		/* uint32_t, uint64_t */
+
+/* The data streams are xdrmem streams on malloc'ed (aligned) buffers,
+   for those xdr_inline() returns a pointer to the next bytes of the
+   buffer itself. The update functions encode and decode whole arrays
+   through that pointer instead of making an indirect call into the
+   stream for every 4 bytes, and fall back to the xdr_*() routines when
+   it returns NULL. The encoded bytes are the same either way. */
+
+/* ints of any size are one XDR unit, sign or zero extended on decode
+   depending on the C type */
+template < class T > static int xdr_inline_ints(XDR * xdrs, T * x,
+    unsigned int len)
+{
+    int32_t *buf;
+    unsigned int i;
+
+    buf = (int32_t *) xdr_inline(xdrs, len * BYTES_PER_XDR_UNIT);
+    if (NULL == buf) {
+	return 0;
+    }
+    if (xdrs->x_op == XDR_ENCODE) {
+	for (i = 0; i < len; i++) {
+	    IXDR_PUT_INT32(buf, (x[i]));
+	}
+    } else if (((T) - 1) < 0) {
+	for (i = 0; i < len; i++) {
+	    x[i] = (T) IXDR_GET_INT32(buf);
+	}
+    } else {
+	for (i = 0; i < len; i++) {
+	    x[i] = (T) IXDR_GET_U_INT32(buf);
+	}
+    }
+    return 1;
+}
+
+static int xdr_inline_floats(XDR * xdrs, float *x, unsigned int len)
+{
+    int32_t *buf;
+    uint32_t u;
+    unsigned int i;
+
+    buf = (int32_t *) xdr_inline(xdrs, len * BYTES_PER_XDR_UNIT);
+    if (NULL == buf) {
+	return 0;
+    }
+    for (i = 0; i < len; i++) {
+	if (xdrs->x_op == XDR_ENCODE) {
+	    memcpy(&u, &x[i], sizeof(u));
+	    IXDR_PUT_U_INT32(buf, u);
+	} else {
+	    u = IXDR_GET_U_INT32(buf);
+	    memcpy(&x[i], &u, sizeof(u));
+	}
+    }
+    return 1;
+}
+
+/* IEEE double, most significant word first like xdr_double() */
+static int xdr_inline_doubles(XDR * xdrs, double *x, unsigned int len)
+{
+    int32_t *buf;
+    uint64_t u;
+    unsigned int i;
+
+    buf = (int32_t *) xdr_inline(xdrs, len * 2 * BYTES_PER_XDR_UNIT);
+    if (NULL == buf) {
+	return 0;
+    }
+    for (i = 0; i < len; i++) {
+	if (xdrs->x_op == XDR_ENCODE) {
+	    memcpy(&u, &x[i], sizeof(u));
+	    IXDR_PUT_U_INT32(buf, (uint32_t) (u >> 32));
+	    IXDR_PUT_U_INT32(buf, (uint32_t) u);
+	} else {
+	    u = (uint64_t) IXDR_GET_U_INT32(buf) << 32;
+	    u |= IXDR_GET_U_INT32(buf);
+	    memcpy(&x[i], &u, sizeof(u));
+	}
+    }
+    return 1;
+}
+
 /* Member functions for CMS_XDR_UPDATER Class */
 CMS_XDR_UPDATER::CMS_XDR_UPDATER(CMS * _cms_parent):CMS_UPDATER(_cms_parent,
     0, 2)
@@ -326,6 +411,9 @@ CMS_STATUS CMS_XDR_UPDATER::update(bool &x)
     if (-1 == check_pointer((char *) &x, sizeof(char))) {
 	return (CMS_UPDATE_ERROR);
     }
+    if (xdr_inline_ints(current_stream, &x, 1)) {
+	return (status);
+    }
     if (xdr_char(current_stream, (char *) &x) != TRUE) {
 	rcs_print_error("CMS_XDR_UPDATER: xdr_char failed.\n");
 	return (status = CMS_UPDATE_ERROR);
@@ -341,6 +429,9 @@ CMS_STATUS CMS_XDR_UPDATER::update(char &x)
     if (-1 == check_pointer((char *) &x, sizeof(char))) {
 	return (CMS_UPDATE_ERROR);
     }
+    if (xdr_inline_ints(current_stream, &x, 1)) {
+	return (status);
+    }
     if (xdr_char(current_stream, &x) != TRUE) {
 	rcs_print_error("CMS_XDR_UPDATER: xdr_char failed.\n");
 	return (status = CMS_UPDATE_ERROR);
@@ -368,6 +459,9 @@ CMS_STATUS CMS_XDR_UPDATER::update(unsigned char &x)
     if (-1 == check_pointer((char *) &x, sizeof(char))) {
 	return (CMS_UPDATE_ERROR);
     }
+    if (xdr_inline_ints(current_stream, &x, 1)) {
+	return (status);
+    }
     if (xdr_u_char(current_stream, (unsigned char *) &x) != TRUE) {
 	rcs_print_error("CMS_XDR_UPDATER: xdr_u_char failed.\n");
 	return (status = CMS_UPDATE_ERROR);
@@ -397,6 +491,9 @@ CMS_STATUS CMS_XDR_UPDATER::update(short int &x)
     if (-1 == check_pointer((char *) &x, sizeof(short))) {
 	return (CMS_UPDATE_ERROR);
     }
+    if (xdr_inline_ints(current_stream, &x, 1)) {
+	return (status);
+    }
 
     if (xdr_short(current_stream, &x) != TRUE) {
 	rcs_print_error("CMS_XDR_UPDATER: xdr_short failed.\n");
@@ -411,6 +508,9 @@ CMS_STATUS CMS_XDR_UPDATER::update(short *x, unsigned int len)
     if (-1 == check_pointer((char *) x, len * sizeof(short))) {
 	return (CMS_UPDATE_ERROR);
     }
+    if (xdr_inline_ints(current_stream, x, len)) {
+	return (status);
+    }
 
     if (xdr_vector(current_stream, (char *) x, len, sizeof(short),
 	    (xdrproc_t) xdr_short) != TRUE) {
@@ -426,6 +526,9 @@ CMS_STATUS CMS_XDR_UPDATER::update(unsigned short int &x)
     if (-1 == check_pointer((char *) &x, sizeof(unsigned short))) {
 	return (CMS_UPDATE_ERROR);
     }
+    if (xdr_inline_ints(current_stream, &x, 1)) {
+	return (status);
+    }
 
     if (xdr_u_short(current_stream, &x) != TRUE) {
 	rcs_print_error("CMS_XDR_UPDATER: xdr_u_short failed.\n");
@@ -440,6 +543,9 @@ CMS_STATUS CMS_XDR_UPDATER::update(unsigned short *x, unsigned int len)
     if (-1 == check_pointer((char *) x, len * sizeof(unsigned short))) {
 	return (CMS_UPDATE_ERROR);
     }
+    if (xdr_inline_ints(current_stream, x, len)) {
+	return (status);
+    }
 
     if (xdr_vector(current_stream,
 	    (char *) x, len,
@@ -458,6 +564,9 @@ CMS_STATUS CMS_XDR_UPDATER::update(int &x)
     if (-1 == check_pointer((char *) &x, sizeof(int))) {
 	return (CMS_UPDATE_ERROR);
     }
+    if (xdr_inline_ints(current_stream, &x, 1)) {
+	return (status);
+    }
 
     if (xdr_int(current_stream, &x) != TRUE) {
 	rcs_print_error("CMS_XDR_UPDATER: xdr_int failed.\n");
@@ -471,6 +580,9 @@ CMS_STATUS CMS_XDR_UPDATER::update(int *x, unsigned int len)
     if (-1 == check_pointer((char *) x, len * sizeof(int))) {
 	return (CMS_UPDATE_ERROR);
     }
+    if (xdr_inline_ints(current_stream, x, len)) {
+	return (status);
+    }
     if (xdr_vector(current_stream, (char *) x, len, sizeof(int),
 	    (xdrproc_t) xdr_int) != TRUE) {
 	rcs_print_error
@@ -485,6 +597,9 @@ CMS_STATUS CMS_XDR_UPDATER::update(unsigned int &x)
     if (-1 == check_pointer((char *) &x, sizeof(unsigned int))) {
 	return (CMS_UPDATE_ERROR);
     }
+    if (xdr_inline_ints(current_stream, &x, 1)) {
+	return (status);
+    }
 
     if (xdr_u_int(current_stream, &x) != TRUE) {
 	rcs_print_error("CMS_XDR_UPDATER: xdr_u_int failed.\n");
@@ -498,6 +613,9 @@ CMS_STATUS CMS_XDR_UPDATER::update(unsigned int *x, unsigned int len)
     if (-1 == check_pointer((char *) x, len * sizeof(unsigned int))) {
 	return (CMS_UPDATE_ERROR);
     }
+    if (xdr_inline_ints(current_stream, x, len)) {
+	return (status);
+    }
 
     if (xdr_vector(current_stream,
 	    (char *) x, len,
@@ -516,6 +634,9 @@ CMS_STATUS CMS_XDR_UPDATER::update(long int &x)
     if (-1 == check_pointer((char *) &x, sizeof(long))) {
 	return (CMS_UPDATE_ERROR);
     }
+    if (xdr_inline_ints(current_stream, &x, 1)) {
+	return (status);
+    }
 
     if (xdr_long(current_stream, &x) != TRUE) {
 	rcs_print_error("CMS_XDR_UPDATER: xdr_long failed.\n");
@@ -529,6 +650,9 @@ CMS_STATUS CMS_XDR_UPDATER::update(long *x, unsigned int len)
     if (-1 == check_pointer((char *) x, len * sizeof(long))) {
 	return (CMS_UPDATE_ERROR);
     }
+    if (xdr_inline_ints(current_stream, x, len)) {
+	return (status);
+    }
 
     if (xdr_vector(current_stream, (char *) x, len, sizeof(long),
 	    (xdrproc_t) xdr_long) != TRUE) {
@@ -544,6 +668,9 @@ CMS_STATUS CMS_XDR_UPDATER::update(unsigned long int &x)
     if (-1 == check_pointer((char *) &x, sizeof(unsigned long))) {
 	return (CMS_UPDATE_ERROR);
     }
+    if (xdr_inline_ints(current_stream, &x, 1)) {
+	return (status);
+    }
 
     if (xdr_u_long(current_stream, &x) != TRUE) {
 	rcs_print_error("CMS_XDR_UPDATER: xdr_u_long failed.\n");
@@ -558,6 +685,9 @@ CMS_STATUS CMS_XDR_UPDATER::update(unsigned long *x, unsigned int len)
     if (-1 == check_pointer((char *) x, len * sizeof(unsigned long))) {
 	return (CMS_UPDATE_ERROR);
     }
+    if (xdr_inline_ints(current_stream, x, len)) {
+	return (status);
+    }
 
     if (xdr_vector(current_stream,
 	    (char *) x, len, sizeof(unsigned long),
@@ -576,6 +706,9 @@ CMS_STATUS CMS_XDR_UPDATER::update(float &x)
     if (-1 == check_pointer((char *) &x, sizeof(float))) {
 	return (CMS_UPDATE_ERROR);
     }
+    if (xdr_inline_floats(current_stream, &x, 1)) {
+	return (status);
+    }
 
     if (xdr_float(current_stream, &x) != TRUE) {
 	rcs_print_error("CMS_XDR_UPDATER: xdr_float failed.\n");
@@ -589,6 +722,9 @@ CMS_STATUS CMS_XDR_UPDATER::update(float *x, unsigned int len)
     if (-1 == check_pointer((char *) x, len * sizeof(float))) {
 	return (CMS_UPDATE_ERROR);
     }
+    if (xdr_inline_floats(current_stream, x, len)) {
+	return (status);
+    }
 
     if (xdr_vector(current_stream, (char *) x, len, sizeof(float),
 	    (xdrproc_t) xdr_float) != TRUE) {
@@ -604,6 +740,9 @@ CMS_STATUS CMS_XDR_UPDATER::update(double &x)
     if (-1 == check_pointer((char *) &x, sizeof(double))) {
 	return (CMS_UPDATE_ERROR);
     }
+    if (xdr_inline_doubles(current_stream, &x, 1)) {
+	return (status);
+    }
 
     if (xdr_double(current_stream, &x) != TRUE) {
 	rcs_print_error("CMS_XDR_UPDATER: xdr_double failed.\n");
@@ -617,6 +756,9 @@ CMS_STATUS CMS_XDR_UPDATER::update(double *x, unsigned int len)
     if (-1 == check_pointer((char *) x, len * sizeof(double))) {
 	return (CMS_UPDATE_ERROR);
     }
+    if (xdr_inline_doubles(current_stream, x, len)) {
+	return (status);
+    }
 
     if (xdr_vector(current_stream, (char *) x, len, sizeof(double),
 	    (xdrproc_t) xdr_double) != TRUE) {
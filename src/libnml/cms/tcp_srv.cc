@@ -31,6 +31,8 @@ extern "C" {
 #include <unistd.h>
 #include <sys/socket.h>
 #include <sys/ioctl.h>
+#include <sys/epoll.h>		/* epoll_create1(), epoll_wait() */
+#include <sys/uio.h>		/* struct iovec */
 #include <errno.h>		/* errno */
 #include <signal.h>		// SIGPIPE, signal()
 
@@ -39,7 +41,6 @@ extern "C" {
 #endif
 
 #include <sys/types.h>
-#include <sys/wait.h>		// waitpid
 
 #include <arpa/inet.h>		/* inet_ntoa */
 #include "cms.hh"		/* class CMS */
@@ -52,15 +53,10 @@ extern "C" {
 #include "_timer.h"
 #include "cmsdiag.hh"		// class CMS_DIAGNOSTICS_INFO
 extern "C" {
-#include "recvn.h"		/* recvn() */
-#include "sendn.h"		/* sendn() */
 }
 #include "physmem.hh"           // PHYSMEM_HANDLE
 
-int tcpsvr_threads_created = 0;
-int tcpsvr_threads_killed = 0;
-int tcpsvr_threads_exited = 0;
-int tcpsvr_threads_returned_early = 0;
+#define TCPSVR_MAX_EVENTS 64
 
 TCPSVR_BLOCKING_READ_REQUEST::TCPSVR_BLOCKING_READ_REQUEST()
 {
@@ -72,12 +68,10 @@ TCPSVR_BLOCKING_READ_REQUEST::TCPSVR_BLOCKING_READ_REQUEST()
     timeout_millis = -1;	/* Milliseconds for blocking_timeout or -1 to 
 				   wait forever */
     _client_tcp_port = NULL;
-    remport = NULL;
-    server = NULL;
+    deadline = 0;
     _nml = NULL;
     _reply = NULL;
     _data = NULL;
-    read_reply = NULL;
 }
 
 static inline double tcp_svr_reverse_double(double in)
@@ -104,26 +98,12 @@ TCPSVR_BLOCKING_READ_REQUEST::~TCPSVR_BLOCKING_READ_REQUEST()
     }
     if (NULL != _data) {
 	void *_datacopy = _data;
-	if (NULL != read_reply) {
-	    if (_data == read_reply->data) {
-		read_reply->data = NULL;
-	    }
-	}
 	_data = NULL;
 	free(_datacopy);
     }
     if (NULL != _reply) {
 	free(_reply);
 	_reply = NULL;
-	read_reply = NULL;
-    }
-    if (NULL != read_reply) {
-	if (NULL != read_reply->data) {
-	    free(read_reply->data);
-	    read_reply->data = NULL;
-	}
-	delete read_reply;
-	read_reply = NULL;
     }
 }
 
@@ -133,7 +113,7 @@ CMS_SERVER_REMOTE_PORT(_cms_server)
     client_ports = (LinkedList *) NULL;
     connection_socket = 0;
     connection_port = 0;
-    maxfdpl = 0;
+    epoll_fd = -1;
     dtimeout = 20.0;
 
     memset(&server_socket_address, 0, sizeof(server_socket_address));
@@ -147,13 +127,10 @@ CMS_SERVER_REMOTE_PORT(_cms_server)
 	return;
     }
     polling_enabled = 0;
-    memset(&select_timeout, 0, sizeof(select_timeout));
-    select_timeout.tv_sec = 30;
-    select_timeout.tv_usec = 30;
+    variable_subscriptions = 0;
+    blocking_reads = 0;
     subscription_buffers = NULL;
     current_poll_interval_millis = 30000;
-    memset(&read_fd_set, 0, sizeof(read_fd_set));
-    memset(&write_fd_set, 0, sizeof(write_fd_set));
 }
 
 CMS_SERVER_REMOTE_TCP_PORT::~CMS_SERVER_REMOTE_TCP_PORT()
@@ -166,23 +143,6 @@ CMS_SERVER_REMOTE_TCP_PORT::~CMS_SERVER_REMOTE_TCP_PORT()
     }
 }
 
-void blocking_thread_kill(long int id)
-{
-
-    if (id <= 0) {
-	return;
-    }
-#ifdef POSIX_THREADS
-    pthread_kill(id, SIGINT);
-    pthread_join(id, NULL);
-#endif
-#ifdef NO_THREADS
-    kill(id, SIGINT);
-    waitpid(id, NULL, 0);
-#endif
-    tcpsvr_threads_killed++;
-}
-
 void CMS_SERVER_REMOTE_TCP_PORT::unregister_port()
 {
     CLIENT_TCP_PORT *client;
@@ -219,6 +179,10 @@ void CMS_SERVER_REMOTE_TCP_PORT::unregister_port()
 	close(connection_socket);
 	connection_socket = 0;
     }
+    if (epoll_fd >= 0) {
+	close(epoll_fd);
+	epoll_fd = -1;
+    }
 }
 
 int CMS_SERVER_REMOTE_TCP_PORT::accept_local_port_cms(CMS * _cms)
@@ -301,260 +265,528 @@ static void handle_pipe_error(int signum)
     rcs_print_error("SIGPIPE intercepted.\n");
 }
 
+static void putbe32(char *addr, uint32_t val) {
+    val = htonl(val);
+    memcpy(addr, &val, sizeof(val));
+}
+
+static uint32_t getbe32(char *addr) {
+    uint32_t val;
+    memcpy(&val, addr, sizeof(val));
+    return ntohl(val);
+}
+
+/* Append to the client's reply queue, which holds what the socket did
+   not take yet. */
+static int tcpsvr_queue_reply(CLIENT_TCP_PORT * client, const char *data,
+    long size)
+{
+    if (client->reply_queued + size > client->reply_alloc) {
+	long alloc = client->reply_queued + size + 0x1000;
+	char *queue = (char *) realloc(client->reply_queue, alloc);
+	if (NULL == queue) {
+	    rcs_print_error("server: out of memory for a reply of %ld bytes\n",
+		size);
+	    return -1;
+	}
+	client->reply_queue = queue;
+	client->reply_alloc = alloc;
+    }
+    memcpy(client->reply_queue + client->reply_queued, data, size);
+    client->reply_queued += size;
+    return 0;
+}
+
+/* Send a reply header and the message data behind it with one system
+   call. The socket is never waited for: whatever it does not take is
+   queued on the client and goes out from the event loop when the socket
+   reports EPOLLOUT, so a slow client can't hold up the others. */
+int CMS_SERVER_REMOTE_TCP_PORT::send_reply(CLIENT_TCP_PORT * client,
+    char *hdr, int hdr_size, const void *data, int size)
+{
+    struct iovec iov[2];
+    struct msghdr msg;
+    long sent = 0;
+
+    if (NULL == data || size < 0) {
+	size = 0;
+    }
+    if (client->reply_queued > 0) {
+	/* keep the order behind what is still queued */
+	if (tcpsvr_queue_reply(client, hdr, hdr_size) < 0 ||
+	    tcpsvr_queue_reply(client, (const char *) data, size) < 0) {
+	    return -1;
+	}
+	return hdr_size + size;
+    }
+    iov[0].iov_base = hdr;
+    iov[0].iov_len = hdr_size;
+    iov[1].iov_base = (void *) data;
+    iov[1].iov_len = size;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = size > 0 ? 2 : 1;
+
+    sent = sendmsg(client->socket_fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (sent < 0) {
+	if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+	    rcs_print_error("Send error: %d = %s\n", errno, strerror(errno));
+	    return -1;
+	}
+	sent = 0;
+    }
+    if (sent == hdr_size + size) {
+	return sent;
+    }
+    if (sent < hdr_size) {
+	if (tcpsvr_queue_reply(client, hdr + sent, hdr_size - sent) < 0) {
+	    return -1;
+	}
+	sent = hdr_size;
+    }
+    sent -= hdr_size;
+    if (tcpsvr_queue_reply(client, (const char *) data + sent,
+	    size - sent) < 0) {
+	return -1;
+    }
+    watch_client(client);
+    return hdr_size + size;
+}
+
+/* A client with queued replies is watched for EPOLLOUT only, its requests
+   wait in the socket until it took its replies. */
+void CMS_SERVER_REMOTE_TCP_PORT::watch_client(CLIENT_TCP_PORT * client)
+{
+    struct epoll_event ev;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = client->reply_queued > 0 ? EPOLLOUT : EPOLLIN;
+    ev.data.ptr = client;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, client->socket_fd, &ev) < 0) {
+	rcs_print_error("server: epoll_ctl error.(errno = %d | %s)\n",
+	    errno, strerror(errno));
+    }
+}
+
+/* Send what the client's socket takes of its reply queue. Returns -1 if
+   the connection failed. */
+int CMS_SERVER_REMOTE_TCP_PORT::flush_replies(CLIENT_TCP_PORT * client)
+{
+    long sent;
+
+    while (client->reply_sent < client->reply_queued) {
+	sent = send(client->socket_fd,
+	    client->reply_queue + client->reply_sent,
+	    client->reply_queued - client->reply_sent,
+	    MSG_NOSIGNAL | MSG_DONTWAIT);
+	if (sent < 0) {
+	    if (errno == EINTR) {
+		continue;
+	    }
+	    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+		return 0;
+	    }
+	    rcs_print_error("Send error: %d = %s\n", errno, strerror(errno));
+	    return -1;
+	}
+	client->reply_sent += sent;
+    }
+    client->reply_queued = 0;
+    client->reply_sent = 0;
+    watch_client(client);
+    return 0;
+}
+
+/* Size of the request starting with the 20 byte header hdr, header
+   included, or -1 for one the server can't take. */
+long CMS_SERVER_REMOTE_TCP_PORT::request_size(CMS_SERVER * server,
+    const char *hdr)
+{
+    long request_type = getbe32((char *) hdr + 4);
+    long buffer_number = getbe32((char *) hdr + 8);
+    long size;
+    int total_subdivisions = 1;
+
+    if (max_total_subdivisions > 1 && NULL != server) {
+	total_subdivisions = server->get_total_subdivisions(buffer_number);
+    }
+    switch (request_type) {
+    case REMOTE_CMS_SET_DIAG_INFO_REQUEST_TYPE:
+	return 20 + 68;
+    case REMOTE_CMS_BLOCKING_READ_REQUEST_TYPE:
+	return 20 + (total_subdivisions > 1 ? 8 : 4);
+    case REMOTE_CMS_READ_REQUEST_TYPE:
+	return 20 + (total_subdivisions > 1 ? 4 : 0);
+    case REMOTE_CMS_WRITE_REQUEST_TYPE:
+	size = getbe32((char *) hdr + 16);
+	if (size < 0 || NULL == server || size > server->maximum_cms_size) {
+	    rcs_print_error("server: write request of %ld bytes is too large\n",
+		size);
+	    return -1;
+	}
+	return 20 + (total_subdivisions > 1 ? 4 : 0) + size;
+    case REMOTE_CMS_GET_KEYS_REQUEST_TYPE:
+	return 20 + 16;
+    case REMOTE_CMS_LOGIN_REQUEST_TYPE:
+	return 20 + 32;
+    default:
+	return 20;
+    }
+}
+
+/* Take what the client's socket has into its request buffer, without
+   waiting for the rest of a request. Returns -1 if the connection was
+   closed or failed. */
+int CMS_SERVER_REMOTE_TCP_PORT::read_requests(CLIENT_TCP_PORT * client)
+{
+    long want = client->request_have + 0x2000;
+    long size, got;
+
+    if (client->request_have >= 20) {
+	size = request_size(find_server(getpid(), 0), client->request_buf);
+	if (size > want) {
+	    want = size;
+	}
+    }
+    if (want > client->request_alloc) {
+	char *buf = (char *) realloc(client->request_buf, want);
+	if (NULL == buf) {
+	    rcs_print_error("server: out of memory for a request of %ld bytes\n",
+		want);
+	    return -1;
+	}
+	client->request_buf = buf;
+	client->request_alloc = want;
+    }
+    do {
+	got = recv(client->socket_fd,
+	    client->request_buf + client->request_have,
+	    client->request_alloc - client->request_have, MSG_DONTWAIT);
+    } while (got < 0 && errno == EINTR);
+    if (got < 0) {
+	if (errno == EAGAIN || errno == EWOULDBLOCK) {
+	    return 0;
+	}
+	rcs_print_error("Can not read from client port (%d) from %s: %s\n",
+	    client->socket_fd, inet_ntoa(client->address.sin_addr),
+	    strerror(errno));
+	return -1;
+    }
+    if (got == 0) {
+	return -1;
+    }
+    client->request_have += got;
+    return 0;
+}
+
+/* Handle the complete requests in the client's request buffer, a partial
+   one stays there for the next read. Stops while the client has replies
+   queued, so a client that doesn't read its replies can't make the
+   server queue without bound. Returns -1 if the client was closed. */
+int CMS_SERVER_REMOTE_TCP_PORT::dispatch_requests(CLIENT_TCP_PORT * client)
+{
+    CMS_SERVER *server = find_server(getpid(), 0);
+    long done = 0, size;
+
+    while (client->reply_queued == 0 && client->request_have - done >= 20) {
+	size = request_size(server, client->request_buf + done);
+	if (size < 0) {
+	    close_client(client);
+	    return -1;
+	}
+	if (client->request_have - done < size) {
+	    break;
+	}
+	if (client->blocking) {
+	    /* the client gave up waiting and sent something else */
+	    rcs_print_debug(PRINT_SERVER_THREAD_ACTIVITY,
+		"Request recieved from %s:%d when it should be blocking.\n",
+		inet_ntoa(client->address.sin_addr), client->socket_fd);
+	    client->blocking = 0;
+	    blocking_reads--;
+	}
+	if (handle_request(client, client->request_buf + done) < 0) {
+	    return -1;		/* client is gone */
+	}
+	done += size;
+    }
+    if (done > 0) {
+	client->request_have -= done;
+	memmove(client->request_buf, client->request_buf + done,
+	    client->request_have);
+    }
+    return 0;
+}
+
 void CMS_SERVER_REMOTE_TCP_PORT::run()
 {
-    unsigned long bytes_ready;
-    int ready_descriptors;
+    int ready_descriptors, i;
+    struct epoll_event ev, events[TCPSVR_MAX_EVENTS];
+    CLIENT_TCP_PORT *client_port_to_check;
+
     if (NULL == client_ports) {
 	rcs_print_error("CMS_SERVER: List of client ports is NULL.\n");
 	return;
     }
-    CLIENT_TCP_PORT *new_client_port, *client_port_to_check;
-    FD_ZERO(&read_fd_set);
-    FD_ZERO(&write_fd_set);
-    FD_SET(connection_socket, &read_fd_set);
-    maxfdpl = connection_socket + 1;
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+	rcs_print_error("server: epoll_create error.(errno = %d | %s)\n",
+	    errno, strerror(errno));
+	return;
+    }
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL;		/* the connection socket */
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, connection_socket, &ev) < 0) {
+	rcs_print_error("server: epoll_ctl error.(errno = %d | %s)\n",
+	    errno, strerror(errno));
+	return;
+    }
     signal(SIGPIPE, handle_pipe_error);
     rcs_print_debug(PRINT_CMS_CONFIG_INFO,
 	"running server for TCP port %d (connection_socket = %d).\n",
 	ntohs(server_socket_address.sin_port), connection_socket);
 
     cms_server_count++;
-    fd_set read_fd_set_copy, write_fd_set_copy;
-    FD_ZERO(&read_fd_set_copy);
-    FD_ZERO(&write_fd_set_copy);
-    FD_SET(connection_socket, &read_fd_set_copy);
 
     while (1) {
-	if (polling_enabled) {
-	    memcpy(&read_fd_set_copy, &read_fd_set, sizeof(fd_set));
-	    memcpy(&write_fd_set_copy, &write_fd_set, sizeof(fd_set));
-	    select_timeout.tv_sec = current_poll_interval_millis / 1000;
-	    select_timeout.tv_usec =
-		(current_poll_interval_millis % 1000) * 1000;
-	    ready_descriptors =
-		select(maxfdpl, &read_fd_set, &write_fd_set,
-		(fd_set *) NULL, (timeval *) & select_timeout);
-	    if (ready_descriptors == 0) {
-		update_subscriptions();
-		memcpy(&read_fd_set, &read_fd_set_copy, sizeof(fd_set));
-		memcpy(&write_fd_set, &write_fd_set_copy, sizeof(fd_set));
-		continue;
-	    }
-	} else {
-	    ready_descriptors =
-		select(maxfdpl, &read_fd_set, &write_fd_set,
-		(fd_set *) NULL, (timeval *) NULL);
-
-	}
+	ready_descriptors = epoll_wait(epoll_fd, events, TCPSVR_MAX_EVENTS,
+	    poll_timeout_millis());
 	if (ready_descriptors < 0) {
-	    rcs_print_error("server: select error.(errno = %d | %s)\n",
-		errno, strerror(errno));
+	    if (errno != EINTR) {
+		rcs_print_error("server: epoll_wait error.(errno = %d | %s)\n",
+		    errno, strerror(errno));
+	    }
+	    ready_descriptors = 0;
 	}
 	if (NULL == client_ports) {
 	    rcs_print_error("CMS_SERVER: List of client ports is NULL.\n");
 	    return;
 	}
-	client_port_to_check = (CLIENT_TCP_PORT *) client_ports->get_head();
-	while (NULL != client_port_to_check) {
-	    if (FD_ISSET(client_port_to_check->socket_fd, &read_fd_set)) {
-		ioctl(client_port_to_check->socket_fd, FIONREAD,
-		    (caddr_t) & bytes_ready);
-		if (bytes_ready <= 0) {
-		    rcs_print_debug(PRINT_SOCKET_CONNECT,
-			"Socket closed by host with IP address %s.\n",
-			inet_ntoa(client_port_to_check->address.sin_addr));
-		    if (NULL != client_port_to_check->subscriptions) {
-			TCP_CLIENT_SUBSCRIPTION_INFO *clnt_sub_info =
-			    (TCP_CLIENT_SUBSCRIPTION_INFO *)
-			    client_port_to_check->subscriptions->get_head();
-			while (NULL != clnt_sub_info) {
-			    if (NULL != clnt_sub_info->sub_buf_info &&
-				clnt_sub_info->subscription_list_id >= 0) {
-				if (NULL !=
-				    clnt_sub_info->sub_buf_info->
-				    sub_clnt_info) {
-				    clnt_sub_info->sub_buf_info->
-					sub_clnt_info->
-					delete_node(clnt_sub_info->
-					subscription_list_id);
-				    if (clnt_sub_info->sub_buf_info->
-					sub_clnt_info->list_size < 1) {
-					delete clnt_sub_info->sub_buf_info->
-					    sub_clnt_info;
-					clnt_sub_info->sub_buf_info->
-					    sub_clnt_info = NULL;
-					if (NULL != subscription_buffers
-					    && clnt_sub_info->sub_buf_info->
-					    list_id >= 0) {
-					    subscription_buffers->
-						delete_node(clnt_sub_info->
-						sub_buf_info->list_id);
-					    delete clnt_sub_info->
-						sub_buf_info;
-					    clnt_sub_info->sub_buf_info =
-						NULL;
-					}
-				    }
-				    clnt_sub_info->sub_buf_info = NULL;
-				}
-				delete clnt_sub_info;
-				clnt_sub_info =
-				    (TCP_CLIENT_SUBSCRIPTION_INFO *)
-				    client_port_to_check->subscriptions->
-				    get_next();
-			    }
-			    delete client_port_to_check->subscriptions;
-			    client_port_to_check->subscriptions = NULL;
-			    recalculate_polling_interval();
-			}
-		    }
-		    if (client_port_to_check->threadId > 0
-			&& client_port_to_check->blocking) {
-			blocking_thread_kill(client_port_to_check->threadId);
-		    }
-		    close(client_port_to_check->socket_fd);
-		    FD_CLR(client_port_to_check->socket_fd, &read_fd_set);
-		    client_port_to_check->socket_fd = -1;
-		    delete client_port_to_check;
-		    client_ports->delete_current_node();
-		} else {
-		    if (client_port_to_check->blocking) {
-			if (client_port_to_check->threadId > 0) {
-			    rcs_print_debug(PRINT_SERVER_THREAD_ACTIVITY,
-				"Data recieved from %s:%d when it should be blocking (bytes_ready=%ld).\n",
-				inet_ntoa
-				(client_port_to_check->address.
-				    sin_addr),
-				client_port_to_check->socket_fd, bytes_ready);
-			    rcs_print_debug(PRINT_SERVER_THREAD_ACTIVITY,
-				"Killing handler %d.\n",
-				client_port_to_check->threadId);
-
-			    blocking_thread_kill
-				(client_port_to_check->threadId);
-#if 0
-			    *((u_long *) temp_buffer) =
-				htonl(client_port_to_check->serial_number);
-			    *((u_long *) temp_buffer + 1) =
-				htonl((unsigned long)
-				CMS_SERVER_SIDE_ERROR);
-			    putbe32(temp_buffer + 8, 0);	/* size
-									 */
-			    putbe32(temp_buffer + 12, 0);	/* write_id
-									 */
-			    putbe32(temp_buffer + 16, 0);	/* was_read
-									 */
-			    sendn(client_port_to_check->socket_fd,
-				temp_buffer, 20, 0, dtimeout);
-#endif
-			    client_port_to_check->threadId = 0;
-			    client_port_to_check->blocking = 0;
-			}
-		    }
-		    handle_request(client_port_to_check);
-		}
-		ready_descriptors--;
-	    } else {
-		FD_SET(client_port_to_check->socket_fd, &read_fd_set);
-	    }
-	    client_port_to_check =
-		(CLIENT_TCP_PORT *) client_ports->get_next();
-	}
-	if (FD_ISSET(connection_socket, &read_fd_set)
-	    && ready_descriptors > 0) {
-	    ready_descriptors--;
-	    socklen_t client_address_length;
-	    new_client_port = new CLIENT_TCP_PORT();
-	    client_address_length = sizeof(new_client_port->address);
-	    new_client_port->socket_fd = accept(connection_socket,
-		(struct sockaddr *)
-		&new_client_port->address, &client_address_length);
-	    current_clients++;
-	    if (current_clients > max_clients) {
-		max_clients = current_clients;
-	    }
-	    if (new_client_port->socket_fd < 0) {
-		rcs_print_error("server: accept error -- %d %s \n", errno,
-		    strerror(errno));
+	for (i = 0; i < ready_descriptors; i++) {
+	    client_port_to_check = (CLIENT_TCP_PORT *) events[i].data.ptr;
+	    if (NULL == client_port_to_check) {
+		accept_client();
 		continue;
 	    }
-	    rcs_print_debug(PRINT_SOCKET_CONNECT,
-		"Socket opened by host with IP address %s.\n",
-		inet_ntoa(new_client_port->address.sin_addr));
-	    new_client_port->serial_number = 0;
-	    new_client_port->blocking = 0;
-	    if (NULL != client_ports) {
-		client_ports->store_at_tail(new_client_port,
-		    sizeof(new_client_port), 0);
+	    if (events[i].events & EPOLLOUT) {
+		if (flush_replies(client_port_to_check) < 0) {
+		    close_client(client_port_to_check);
+		    continue;
+		}
+		/* requests that came in behind the replies */
+		if (dispatch_requests(client_port_to_check) < 0) {
+		    continue;
+		}
+		if (!(events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP))) {
+		    continue;
+		}
 	    }
-	    if (maxfdpl < new_client_port->socket_fd + 1) {
-		maxfdpl = new_client_port->socket_fd + 1;
+	    if (read_requests(client_port_to_check) < 0) {
+		rcs_print_debug(PRINT_SOCKET_CONNECT,
+		    "Socket closed by host with IP address %s.\n",
+		    inet_ntoa(client_port_to_check->address.sin_addr));
+		close_client(client_port_to_check);
+		continue;
 	    }
-	    FD_SET(new_client_port->socket_fd, &read_fd_set);
-	} else {
-	    FD_SET(connection_socket, &read_fd_set);
-	}
-	if (0 != ready_descriptors) {
-	    rcs_print_error("%d descriptors ready but not serviced.\n",
-		ready_descriptors);
+	    dispatch_requests(client_port_to_check);
 	}
+	update_blocking_reads();
 	update_subscriptions();
     }
 }
 
-static int tcpsvr_handle_blocking_request_sigint_count = 0;
-static int tcpsvr_last_sig = 0;
-
-void tcpsvr_handle_blocking_request_sigint_handler(int sig)
+/* How long epoll_wait() may sleep before a polled subscription is due,
+   a blocking read times out or the buffers need to be checked for new
+   data. */
+int CMS_SERVER_REMOTE_TCP_PORT::poll_timeout_millis()
 {
-    tcpsvr_last_sig = sig;
-    tcpsvr_handle_blocking_request_sigint_count++;
-}
+    int timeout = -1;
+    int millis;
+    double now = etime();
 
-static void putbe32(char *addr, uint32_t val) {
-    val = htonl(val);
-    memcpy(addr, &val, sizeof(val));
+    if (blocking_reads > 0 || variable_subscriptions > 0) {
+	timeout = TCPSVR_CHANGE_POLL_MILLIS;
+    }
+    if (polling_enabled && NULL != subscription_buffers) {
+	TCP_BUFFER_SUBSCRIPTION_INFO *buf_info =
+	    (TCP_BUFFER_SUBSCRIPTION_INFO *) subscription_buffers->get_head();
+	while (NULL != buf_info) {
+	    TCP_CLIENT_SUBSCRIPTION_INFO *clnt_info =
+		(TCP_CLIENT_SUBSCRIPTION_INFO *) buf_info->sub_clnt_info->
+		get_head();
+	    while (NULL != clnt_info) {
+		if (clnt_info->subscription_type == CMS_POLLED_SUBSCRIPTION) {
+		    millis = (int) ((clnt_info->next_due - now) * 1000.0 + 1);
+		    if (millis <= 0) {
+			/* due, update_subscriptions() moves it on */
+			millis = TCPSVR_CHANGE_POLL_MILLIS;
+		    }
+		    if (timeout < 0 || millis < timeout) {
+			timeout = millis;
+		    }
+		}
+		clnt_info = (TCP_CLIENT_SUBSCRIPTION_INFO *)
+		    buf_info->sub_clnt_info->get_next();
+	    }
+	    buf_info = (TCP_BUFFER_SUBSCRIPTION_INFO *)
+		subscription_buffers->get_next();
+	}
+    }
+    if (blocking_reads > 0) {
+	CLIENT_TCP_PORT *client =
+	    (CLIENT_TCP_PORT *) client_ports->get_head();
+	while (NULL != client) {
+	    if (client->blocking && client->blocking_read_req->deadline > 0) {
+		millis = (int) ((client->blocking_read_req->deadline - now) *
+		    1000.0 + 1);
+		if (millis < 0) {
+		    millis = 0;
+		}
+		if (millis < timeout) {
+		    timeout = millis;
+		}
+	    }
+	    client = (CLIENT_TCP_PORT *) client_ports->get_next();
+	}
+    }
+    return timeout;
 }
 
-static uint32_t getbe32(char *addr) {
-    uint32_t val;
-    memcpy(&val, addr, sizeof(val));
-    return ntohl(val);
+void CMS_SERVER_REMOTE_TCP_PORT::accept_client()
+{
+    socklen_t client_address_length;
+    CLIENT_TCP_PORT *new_client_port;
+    struct epoll_event ev;
+
+    new_client_port = new CLIENT_TCP_PORT();
+    client_address_length = sizeof(new_client_port->address);
+    new_client_port->socket_fd = accept(connection_socket,
+	(struct sockaddr *) &new_client_port->address, &client_address_length);
+    if (new_client_port->socket_fd < 0) {
+	rcs_print_error("server: accept error -- %d %s \n", errno,
+	    strerror(errno));
+	delete new_client_port;
+	return;
+    }
+    current_clients++;
+    if (current_clients > max_clients) {
+	max_clients = current_clients;
+    }
+    rcs_print_debug(PRINT_SOCKET_CONNECT,
+	"Socket opened by host with IP address %s.\n",
+	inet_ntoa(new_client_port->address.sin_addr));
+    new_client_port->serial_number = 0;
+    new_client_port->blocking = 0;
+    new_client_port->list_id =
+	client_ports->store_at_tail(new_client_port,
+	sizeof(new_client_port), 0);
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = new_client_port;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, new_client_port->socket_fd,
+	    &ev) < 0) {
+	rcs_print_error("server: epoll_ctl error.(errno = %d | %s)\n",
+	    errno, strerror(errno));
+	close_client(new_client_port);
+    }
 }
 
-#if defined(POSIX_THREADS) || defined(NO_THREADS)
-void *tcpsvr_handle_blocking_request(void *_req)
+/* Drop a client with all its subscriptions. */
+void CMS_SERVER_REMOTE_TCP_PORT::close_client(CLIENT_TCP_PORT *
+    client_port_to_check)
 {
-    signal(SIGINT, tcpsvr_handle_blocking_request_sigint_handler);
-    TCPSVR_BLOCKING_READ_REQUEST *blocking_read_req =
-	(TCPSVR_BLOCKING_READ_REQUEST *) _req;
-    char temp_buffer[0x2000];
-    if (_req == NULL) {
-	tcpsvr_threads_returned_early++;
-	return 0;
+    if (NULL != client_port_to_check->subscriptions) {
+	TCP_CLIENT_SUBSCRIPTION_INFO *clnt_sub_info =
+	    (TCP_CLIENT_SUBSCRIPTION_INFO *)
+	    client_port_to_check->subscriptions->get_head();
+	while (NULL != clnt_sub_info) {
+	    if (NULL != clnt_sub_info->sub_buf_info &&
+		clnt_sub_info->subscription_list_id >= 0) {
+		if (NULL != clnt_sub_info->sub_buf_info->sub_clnt_info) {
+		    clnt_sub_info->sub_buf_info->sub_clnt_info->
+			delete_node(clnt_sub_info->subscription_list_id);
+		    if (clnt_sub_info->sub_buf_info->sub_clnt_info->
+			list_size < 1) {
+			delete clnt_sub_info->sub_buf_info->sub_clnt_info;
+			clnt_sub_info->sub_buf_info->sub_clnt_info = NULL;
+			if (NULL != subscription_buffers
+			    && clnt_sub_info->sub_buf_info->list_id >= 0) {
+			    subscription_buffers->
+				delete_node(clnt_sub_info->sub_buf_info->
+				list_id);
+			    delete clnt_sub_info->sub_buf_info;
+			    clnt_sub_info->sub_buf_info = NULL;
+			}
+		    }
+		    clnt_sub_info->sub_buf_info = NULL;
+		}
+	    }
+	    delete clnt_sub_info;
+	    clnt_sub_info = (TCP_CLIENT_SUBSCRIPTION_INFO *)
+		client_port_to_check->subscriptions->get_next();
+	}
+	delete client_port_to_check->subscriptions;
+	client_port_to_check->subscriptions = NULL;
+	recalculate_polling_interval();
     }
-    double dtimeout =
-	((double) (blocking_read_req->timeout_millis + 10)) / 1000.0;
-    if (dtimeout < 0) {
-	dtimeout = 600.0;
+    if (client_port_to_check->blocking) {
+	client_port_to_check->blocking = 0;
+	blocking_reads--;
     }
-    if (dtimeout < 0.5) {
-	dtimeout = 0.5;
+    if (client_port_to_check->socket_fd >= 0) {
+	epoll_ctl(epoll_fd, EPOLL_CTL_DEL, client_port_to_check->socket_fd,
+	    NULL);
+	close(client_port_to_check->socket_fd);
+	client_port_to_check->socket_fd = -1;
+	current_clients--;
     }
-    if (dtimeout > 600.0) {
-	dtimeout = 600.0;
+    client_ports->delete_node(client_port_to_check->list_id);
+    delete client_port_to_check;
+}
+
+/* A blocking read waits in the server loop until its buffer has new data
+   or its timeout expires, it is retried every TCPSVR_CHANGE_POLL_MILLIS
+   with an ordinary read. */
+void CMS_SERVER_REMOTE_TCP_PORT::park_blocking_read(CLIENT_TCP_PORT *
+    _client_tcp_port)
+{
+    TCPSVR_BLOCKING_READ_REQUEST *blocking_read_req =
+	_client_tcp_port->blocking_read_req;
+    double now = etime();
+
+    if (blocking_read_req->timeout_millis < 0) {
+	blocking_read_req->deadline = 0;
+    } else {
+	blocking_read_req->deadline =
+	    now + blocking_read_req->timeout_millis / 1000.0;
     }
-    CLIENT_TCP_PORT *_client_tcp_port = blocking_read_req->_client_tcp_port;
-    CMS_SERVER *server = blocking_read_req->server;
+    _client_tcp_port->blocking = 1;
+    blocking_reads++;
+    try_blocking_read(_client_tcp_port, now);
+}
 
-    if (NULL == server || NULL == _client_tcp_port) {
-	tcpsvr_threads_returned_early++;
+/* Returns 1 if the blocking read was answered. */
+int CMS_SERVER_REMOTE_TCP_PORT::try_blocking_read(CLIENT_TCP_PORT *
+    _client_tcp_port, double now)
+{
+    TCPSVR_BLOCKING_READ_REQUEST *blocking_read_req =
+	_client_tcp_port->blocking_read_req;
+    REMOTE_READ_REPLY *read_reply;
+    CMS_SERVER *server;
+    char reply_header[20];
+
+    server = find_server(getpid(), 0);
+    if (NULL == server) {
+	rcs_print_error
+	    ("CMS_SERVER_REMOTE_TCP_PORT::try_blocking_read() Cannot find server object for pid = %d.\n",
+	    getpid());
 	return 0;
     }
-    memset(temp_buffer, 0, 0x2000);
-    REMOTE_BLOCKING_READ_REPLY *read_reply;
-
+    if (server->using_passwd_file) {
+	current_user_info = get_connected_user(_client_tcp_port->socket_fd);
+    }
     if (NULL != _client_tcp_port->diag_info) {
 	_client_tcp_port->diag_info->buffer_number =
 	    blocking_read_req->buffer_number;
@@ -563,88 +795,73 @@ void *tcpsvr_handle_blocking_request(void *_req)
 	server->reset_diag_info(blocking_read_req->buffer_number);
     }
 
-    read_reply = (REMOTE_BLOCKING_READ_REPLY *)
-	server->process_request(blocking_read_req);
-    blocking_read_req->read_reply = read_reply;
+    server->read_req.buffer_number = blocking_read_req->buffer_number;
+    server->read_req.access_type = blocking_read_req->access_type;
+    server->read_req.last_id_read = blocking_read_req->last_id_read;
+    server->read_req.subdiv = blocking_read_req->subdiv;
+    read_reply =
+	(REMOTE_READ_REPLY *) server->process_request(&server->read_req);
+
+    putbe32(reply_header, _client_tcp_port->serial_number);
     if (NULL == read_reply) {
-	_client_tcp_port->blocking = 0;
 	rcs_print_error("Server could not process request.\n");
-	putbe32(temp_buffer, _client_tcp_port->serial_number);
-	putbe32(temp_buffer + 4, CMS_SERVER_SIDE_ERROR);
-	putbe32(temp_buffer + 8, 0);	/* size */
-	putbe32(temp_buffer + 12, 0)	/* write_id */;
-	putbe32(temp_buffer + 16, 0)	/* was_read */;
-	sendn(_client_tcp_port->socket_fd, temp_buffer, 20, 0, dtimeout);
+	putbe32(reply_header + 4, CMS_SERVER_SIDE_ERROR);
+	putbe32(reply_header + 8, 0);	/* size */
+	putbe32(reply_header + 12, 0);	/* write_id */
+	putbe32(reply_header + 16, 0);	/* was_read */
 	_client_tcp_port->errors++;
-	_client_tcp_port->blocking_read_req = NULL;
-	delete blocking_read_req;
-	_client_tcp_port->threadId = 0;
-	tcpsvr_threads_returned_early++;
-	return 0;
-    }
-    putbe32(temp_buffer, _client_tcp_port->serial_number);
-    putbe32(temp_buffer + 4, read_reply->status);
-    putbe32(temp_buffer + 8, read_reply->size);
-    putbe32(temp_buffer + 12, read_reply->write_id);
-    putbe32(temp_buffer + 16, read_reply->was_read);
-    if (read_reply->size < (0x2000 - 20) && read_reply->size > 0) {
-	memcpy(temp_buffer + 20, read_reply->data, read_reply->size);
-	_client_tcp_port->blocking = 0;
-	if (sendn
-	    (_client_tcp_port->socket_fd, temp_buffer, 20 + read_reply->size,
-		0, dtimeout) < 0) {
-	    _client_tcp_port->blocking = 0;
-	    _client_tcp_port->errors++;
-	    _client_tcp_port->blocking_read_req = NULL;
-	    delete blocking_read_req;
-	    _client_tcp_port->threadId = 0;
-	    tcpsvr_threads_returned_early++;
+	send_reply(_client_tcp_port, reply_header, 20,
+	    NULL, 0);
+    } else if (read_reply->status == CMS_READ_OLD) {
+	if (blocking_read_req->deadline <= 0 ||
+	    now < blocking_read_req->deadline) {
 	    return 0;
 	}
-    } else {
-	_client_tcp_port->blocking = 0;
-	if (sendn(_client_tcp_port->socket_fd, temp_buffer, 20, 0, dtimeout) <
-	    0) {
-	    _client_tcp_port->blocking = 0;
+	putbe32(reply_header + 4, CMS_TIMED_OUT);
+	putbe32(reply_header + 8, 0);
+	putbe32(reply_header + 12, blocking_read_req->last_id_read);
+	putbe32(reply_header + 16, read_reply->was_read);
+	if (send_reply(_client_tcp_port, reply_header, 20,
+		NULL, 0) < 0) {
 	    _client_tcp_port->errors++;
-	    _client_tcp_port->blocking_read_req = NULL;
-	    delete blocking_read_req;
-	    _client_tcp_port->threadId = 0;
-	    tcpsvr_threads_returned_early++;
-	    return 0;
 	}
-	if (read_reply->size > 0) {
-	    if (sendn
-		(_client_tcp_port->socket_fd, read_reply->data,
-		    read_reply->size, 0, dtimeout) < 0) {
-		_client_tcp_port->blocking = 0;
-		_client_tcp_port->errors++;
-		_client_tcp_port->blocking_read_req = NULL;
-		delete blocking_read_req;
-		_client_tcp_port->threadId = 0;
-		tcpsvr_threads_returned_early++;
-		return 0;
-	    }
+    } else {
+	putbe32(reply_header + 4, read_reply->status);
+	putbe32(reply_header + 8, read_reply->size);
+	putbe32(reply_header + 12, read_reply->write_id);
+	putbe32(reply_header + 16, read_reply->was_read);
+	if (send_reply(_client_tcp_port, reply_header, 20,
+		read_reply->data, read_reply->size) < 0) {
+	    _client_tcp_port->errors++;
 	}
     }
-    _client_tcp_port->blocking_read_req = NULL;
-    delete blocking_read_req;
-    _client_tcp_port->threadId = 0;
-    tcpsvr_threads_exited++;
-#ifdef POSIX_THREADS
-    pthread_exit(0);
-#endif
-#ifdef NO_THREADS
-    exit(0);
-#endif
+    _client_tcp_port->blocking = 0;
+    blocking_reads--;
+    return 1;
 }
 
-#endif
+void CMS_SERVER_REMOTE_TCP_PORT::update_blocking_reads()
+{
+    CLIENT_TCP_PORT *client;
+    double now;
 
-void CMS_SERVER_REMOTE_TCP_PORT::handle_request(CLIENT_TCP_PORT *
-    _client_tcp_port)
+    if (blocking_reads <= 0) {
+	return;
+    }
+    now = etime();
+    client = (CLIENT_TCP_PORT *) client_ports->get_head();
+    while (NULL != client) {
+	if (client->blocking) {
+	    try_blocking_read(client, now);
+	}
+	client = (CLIENT_TCP_PORT *) client_ports->get_next();
+    }
+}
+
+/* Handle one complete request, returns -1 if it closed the client. */
+int CMS_SERVER_REMOTE_TCP_PORT::handle_request(CLIENT_TCP_PORT *
+    _client_tcp_port, const char *request)
 {
-    CLIENT_TCP_PORT *client_port_to_check = NULL;
     pid_t pid = getpid();
     pid_t tid = 0;
     CMS_SERVER *server;
@@ -653,7 +870,7 @@ void CMS_SERVER_REMOTE_TCP_PORT::handle_request(CLIENT_TCP_PORT *
 	rcs_print_error
 	    ("CMS_SERVER_REMOTE_TCP_PORT::handle_request() Cannot find server object for pid = %d.\n",
 	    pid);
-	return;
+	return 0;
     }
 
     if (server->using_passwd_file) {
@@ -663,29 +880,11 @@ void CMS_SERVER_REMOTE_TCP_PORT::handle_request(CLIENT_TCP_PORT *
     if (_client_tcp_port->errors >= _client_tcp_port->max_errors) {
 	rcs_print_error("Too many errors - closing connection(%d)\n",
 	    _client_tcp_port->socket_fd);
-	client_port_to_check = (CLIENT_TCP_PORT *) client_ports->get_head();
-	while (NULL != client_port_to_check) {
-	    if (client_port_to_check->socket_fd ==
-		_client_tcp_port->socket_fd) {
-		delete client_port_to_check;
-		client_ports->delete_current_node();
-	    }
-	    client_port_to_check =
-		(CLIENT_TCP_PORT *) client_ports->get_next();
-	}
-	close(_client_tcp_port->socket_fd);
-	current_clients--;
-	FD_CLR(_client_tcp_port->socket_fd, &read_fd_set);
-	_client_tcp_port->socket_fd = -1;
+	close_client(_client_tcp_port);
+	return -1;
     }
 
-    if (recvn(_client_tcp_port->socket_fd, temp_buffer, 20, 0, -1, NULL) < 0) {
-	rcs_print_error("Can not read from client port (%d) from %s\n",
-	    _client_tcp_port->socket_fd,
-	    inet_ntoa(_client_tcp_port->address.sin_addr));
-	_client_tcp_port->errors++;
-	return;
-    }
+    memcpy(temp_buffer, request, 20);
     long request_type, buffer_number, received_serial_number;
     received_serial_number = getbe32(temp_buffer);
     if (received_serial_number != _client_tcp_port->serial_number) {
@@ -696,8 +895,8 @@ void CMS_SERVER_REMOTE_TCP_PORT::handle_request(CLIENT_TCP_PORT *
 	_client_tcp_port->errors++;
     }
     _client_tcp_port->serial_number++;
-    request_type = ntohl(*((u_long *) temp_buffer + 1));
-    buffer_number = ntohl(*((u_long *) temp_buffer + 2));
+    request_type = getbe32(temp_buffer + 4);
+    buffer_number = getbe32(temp_buffer + 8);
 
     rcs_print_debug(PRINT_ALL_SOCKET_REQUESTS,
 	"TCPSVR request recieved: fd = %d, serial_number=%ld, request_type=%ld, buffer_number=%ld\n",
@@ -712,7 +911,11 @@ void CMS_SERVER_REMOTE_TCP_PORT::handle_request(CLIENT_TCP_PORT *
     }
 
     switch_function(_client_tcp_port,
-	server, request_type, buffer_number, received_serial_number);
+	server, request_type, buffer_number, received_serial_number,
+	request + 20);
+    if (request_type == REMOTE_CMS_CLOSE_CHANNEL_REQUEST_TYPE) {
+	return -1;		/* _client_tcp_port is gone */
+    }
 
     if (NULL != _client_tcp_port->diag_info &&
 	NULL != server->last_local_port_used && server->diag_enabled) {
@@ -725,15 +928,16 @@ void CMS_SERVER_REMOTE_TCP_PORT::handle_request(CLIENT_TCP_PORT *
 	    }
 	}
     }
+    return 0;
 }
 
 void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
     _client_tcp_port,
     CMS_SERVER * server,
-    long request_type, long buffer_number, long received_serial_number)
+    long request_type, long buffer_number, long received_serial_number,
+    const char *body)
 {
     int total_subdivisions = 1;
-    CLIENT_TCP_PORT *client_port_to_check = NULL;
     switch (request_type) {
     case REMOTE_CMS_SET_DIAG_INFO_REQUEST_TYPE:
 	{
@@ -741,16 +945,7 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 		_client_tcp_port->diag_info =
 		    new REMOTE_SET_DIAG_INFO_REQUEST();
 	    }
-	    if (recvn
-		(_client_tcp_port->socket_fd, server->set_diag_info_buf, 68,
-		    0, -1, NULL) < 0) {
-		rcs_print_error
-		    ("Can not read from client port (%d) from %s\n",
-		    _client_tcp_port->socket_fd,
-		    inet_ntoa(_client_tcp_port->address.sin_addr));
-		_client_tcp_port->errors++;
-		return;
-	    }
+	    memcpy(server->set_diag_info_buf, body, 68);
 	    _client_tcp_port->diag_info->bytes_moved = 0.0;
 	    _client_tcp_port->diag_info->buffer_number = buffer_number;
 	    memcpy(_client_tcp_port->diag_info->process_name,
@@ -758,9 +953,9 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	    memcpy(_client_tcp_port->diag_info->host_sysinfo,
 		server->set_diag_info_buf + 16, 32);
 	    _client_tcp_port->diag_info->pid =
-		htonl(*((u_long *) (server->set_diag_info_buf + 48)));
+		getbe32(server->set_diag_info_buf + 48);
 	    _client_tcp_port->diag_info->c_num =
-		htonl(*((u_long *) (server->set_diag_info_buf + 52)));
+		getbe32(server->set_diag_info_buf + 52);
 	    memcpy(&(_client_tcp_port->diag_info->rcslib_ver),
 		server->set_diag_info_buf + 56, 8);
 	    _client_tcp_port->diag_info->reverse_flag =
@@ -784,9 +979,8 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	    if (NULL == diagreply) {
 		putbe32(temp_buffer, _client_tcp_port->serial_number);
 		putbe32(temp_buffer+4, CMS_SERVER_SIDE_ERROR);
-		if (sendn
-		    (_client_tcp_port->socket_fd, temp_buffer, 24, 0,
-			dtimeout) < 0) {
+		if (send_reply(_client_tcp_port, temp_buffer, 24,
+		    NULL, 0) < 0) {
 		    _client_tcp_port->errors++;
 		}
 		return;
@@ -794,9 +988,8 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	    if (NULL == diagreply->cdi) {
 		putbe32(temp_buffer, _client_tcp_port->serial_number);
 		putbe32(temp_buffer + 4, CMS_SERVER_SIDE_ERROR);
-		if (sendn
-		    (_client_tcp_port->socket_fd, temp_buffer, 24, 0,
-			dtimeout) < 0) {
+		if (send_reply(_client_tcp_port, temp_buffer, 24,
+		    NULL, 0) < 0) {
 		    _client_tcp_port->errors++;
 		}
 		return;
@@ -828,8 +1021,7 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 		    dpi_offset += 16;
 		    memcpy(temp_buffer + dpi_offset, dpi->host_sysinfo, 32);
 		    dpi_offset += 32;
-		    *((u_long *) ((char *) temp_buffer + dpi_offset)) =
-			htonl(dpi->pid);
+		    putbe32(temp_buffer + dpi_offset, dpi->pid);
 		    dpi_offset += 4;
 		    if (_client_tcp_port->diag_info->reverse_flag ==
 			0x44332211) {
@@ -842,23 +1034,17 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 			    8);
 		    }
 		    dpi_offset += 8;
-		    *((u_long *) ((char *) temp_buffer + dpi_offset)) =
-			htonl(dpi->access_type);
+		    putbe32(temp_buffer + dpi_offset, dpi->access_type);
 		    dpi_offset += 4;
-		    *((u_long *) ((char *) temp_buffer + dpi_offset)) =
-			htonl(dpi->msg_id);
+		    putbe32(temp_buffer + dpi_offset, dpi->msg_id);
 		    dpi_offset += 4;
-		    *((u_long *) ((char *) temp_buffer + dpi_offset)) =
-			htonl(dpi->msg_size);
+		    putbe32(temp_buffer + dpi_offset, dpi->msg_size);
 		    dpi_offset += 4;
-		    *((u_long *) ((char *) temp_buffer + dpi_offset)) =
-			htonl(dpi->msg_type);
+		    putbe32(temp_buffer + dpi_offset, dpi->msg_type);
 		    dpi_offset += 4;
-		    *((u_long *) ((char *) temp_buffer + dpi_offset)) =
-			htonl(dpi->number_of_accesses);
+		    putbe32(temp_buffer + dpi_offset, dpi->number_of_accesses);
 		    dpi_offset += 4;
-		    *((u_long *) ((char *) temp_buffer + dpi_offset)) =
-			htonl(dpi->number_of_new_messages);
+		    putbe32(temp_buffer + dpi_offset, dpi->number_of_new_messages);
 		    dpi_offset += 4;
 		    if (_client_tcp_port->diag_info->reverse_flag ==
 			0x44332211) {
@@ -928,24 +1114,21 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 		    dpi_offset += 8;
 		    int is_last_writer =
 			(dpi == diagreply->cdi->last_writer_dpi);
-		    *((u_long *) ((char *) temp_buffer + dpi_offset)) =
-			htonl(is_last_writer);
+		    putbe32(temp_buffer + dpi_offset, is_last_writer);
 		    dpi_offset += 4;
 		    int is_last_reader =
 			(dpi == diagreply->cdi->last_reader_dpi);
-		    *((u_long *) ((char *) temp_buffer + dpi_offset)) =
-			htonl(is_last_reader);
+		    putbe32(temp_buffer + dpi_offset, is_last_reader);
 		    dpi_offset += 4;
 		    dpi =
 			(CMS_DIAG_PROC_INFO *) diagreply->cdi->dpis->
 			get_next();
 		}
 	    }
-	    *((u_long *) temp_buffer + 6) = htonl(dpi_count);
-	    *((u_long *) temp_buffer + 7) = htonl(dpi_offset);
-	    if (sendn
-		(_client_tcp_port->socket_fd, temp_buffer, dpi_offset, 0,
-		    dtimeout) < 0) {
+	    putbe32(temp_buffer + 24, dpi_count);
+	    putbe32(temp_buffer + 28, dpi_offset);
+	    if (send_reply(_client_tcp_port, temp_buffer, dpi_offset,
+		NULL, 0) < 0) {
 		_client_tcp_port->errors++;
 		return;
 	    }
@@ -965,18 +1148,16 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 		putbe32(temp_buffer, _client_tcp_port->serial_number);
 		putbe32(temp_buffer + 4, namereply->status);
 		strncpy(temp_buffer + 8, namereply->name, 31);
-		if (sendn
-		    (_client_tcp_port->socket_fd, temp_buffer, 40, 0,
-			dtimeout) < 0) {
+		if (send_reply(_client_tcp_port, temp_buffer, 40,
+		    NULL, 0) < 0) {
 		    _client_tcp_port->errors++;
 		    return;
 		}
 	    } else {
 		putbe32(temp_buffer, _client_tcp_port->serial_number);
 		putbe32(temp_buffer + 4, CMS_SERVER_SIDE_ERROR);
-		if (sendn
-		    (_client_tcp_port->socket_fd, temp_buffer, 40, 0,
-			dtimeout) < 0) {
+		if (send_reply(_client_tcp_port, temp_buffer, 40,
+		    NULL, 0) < 0) {
 		    _client_tcp_port->errors++;
 		    return;
 		}
@@ -988,132 +1169,40 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	{
 	    TCPSVR_BLOCKING_READ_REQUEST *blocking_read_req;
 
-#ifdef NO_THREADS
 	    if (NULL == _client_tcp_port->blocking_read_req) {
 		_client_tcp_port->blocking_read_req =
 		    new TCPSVR_BLOCKING_READ_REQUEST();
 	    }
 	    blocking_read_req = _client_tcp_port->blocking_read_req;
-#else
-	    blocking_read_req;
-	    = new TCPSVR_BLOCKING_READ_REQUEST();
-#endif
 	    blocking_read_req->buffer_number = buffer_number;
 	    blocking_read_req->access_type =
-		ntohl(*((u_long *) temp_buffer + 3));
+		getbe32(temp_buffer + 12);
 	    blocking_read_req->last_id_read =
-		ntohl(*((u_long *) temp_buffer + 4));
+		getbe32(temp_buffer + 16);
+	    blocking_read_req->subdiv = 0;
 	    total_subdivisions = 1;
 	    if (max_total_subdivisions > 1) {
 		total_subdivisions =
 		    server->get_total_subdivisions(buffer_number);
 	    }
 	    if (total_subdivisions > 1) {
-		if (recvn
-		    (_client_tcp_port->socket_fd,
-			(char *) (((u_long *) temp_buffer) + 5), 8, 0, -1,
-			NULL) < 0) {
-		    rcs_print_error
-			("Can not read from client port (%d) from %s\n",
-			_client_tcp_port->socket_fd,
-			inet_ntoa(_client_tcp_port->address.sin_addr));
-		    _client_tcp_port->errors++;
-		    return;
-		}
+		memcpy(temp_buffer + 20, body, 8);
 		blocking_read_req->subdiv =
-		    ntohl(*((u_long *) temp_buffer + 6));
+		    getbe32(temp_buffer + 24);
 	    } else {
-		if (recvn
-		    (_client_tcp_port->socket_fd,
-			(char *) (((u_long *) temp_buffer) + 5), 4, 0, -1,
-			NULL) < 0) {
-		    rcs_print_error
-			("Can not read from client port (%d) from %s\n",
-			_client_tcp_port->socket_fd,
-			inet_ntoa(_client_tcp_port->address.sin_addr));
-		    _client_tcp_port->errors++;
-		    return;
-		}
+		memcpy(temp_buffer + 20, body, 4);
 	    }
 	    blocking_read_req->timeout_millis =
-		ntohl(*((u_long *) temp_buffer + 5));
-	    blocking_read_req->server = server;
-	    blocking_read_req->remport = this;
-	    _client_tcp_port->blocking = 1;
+		getbe32(temp_buffer + 20);
 	    blocking_read_req->_client_tcp_port = _client_tcp_port;
-#ifdef POSIX_THREADS
-	    int thr_retval = pthread_create(&(_client_tcp_port->threadId),	/* ptr to new-thread-id */
-		NULL,		// pthread_attr_t *, ptr to attributes
-		tcpsvr_handle_blocking_request,	// start_func
-		blocking_read_req	// arg for start_func
-		);
-	    if (thr_retval != 0) {
-		_client_tcp_port->blocking = 0;
-		rcs_print_error("pthread_create error: thr_retval = %d\n",
-		    thr_retval);
-		rcs_print_error("pthread_create error: %d %s\n", errno,
-		    strerror(errno));
-		*((u_long *) temp_buffer) =
-		    htonl(_client_tcp_port->serial_number);
-		*((u_long *) temp_buffer + 1) =
-		    htonl((unsigned long) CMS_SERVER_SIDE_ERROR);
-		putbe32(temp_buffer + 8, 0);	/* size */
-		putbe32(temp_buffer + 12, 0);	/* write_id */
-		putbe32(temp_buffer + 16, 0);	/* was_read */
-		sendn(_client_tcp_port->socket_fd, temp_buffer, 20, 0,
-		    dtimeout);
-		return;
-	    }
-#else
-#ifdef NO_THREADS
-	    int fork_ret = fork();
-	    switch (fork_ret) {
-	    case 0:		// child
-		_client_tcp_port->threadId = getpid();
-		tcpsvr_handle_blocking_request(blocking_read_req);
-		exit(0);
-		break;
-
-	    case -1:		// Error
-		rcs_print_error("fork error: %d %s\n", errno,
-		    strerror(errno));
-		_client_tcp_port->blocking = 0;
-		putbe32(temp_buffer, _client_tcp_port->serial_number);
-		putbe32(temp_buffer + 4, CMS_SERVER_SIDE_ERROR);
-		putbe32(temp_buffer + 8, 0);
-		putbe32(temp_buffer + 12, 0);
-		putbe32(temp_buffer + 16, 0);
-		sendn(_client_tcp_port->socket_fd, temp_buffer, 20, 0,
-		    dtimeout);
-		break;
-
-	    default:		// parent;
-		_client_tcp_port->threadId = fork_ret;
-		break;
-	    }
-#else
-	    rcs_print_error
-		("Blocking read not supported on this platform.\n");
-	    *((u_long *) temp_buffer) =
-		htonl(_client_tcp_port->serial_number);
-	    *((u_long *) temp_buffer + 1) =
-		htonl((unsigned long) CMS_SERVER_SIDE_ERROR);
-	    putbe32(temp_buffer + 8, 0);	/* size */
-	    putbe32(temp_buffer + 12, 0);	/* write_id */
-	    putbe32(temp_buffer + 16, 0);	/* was_read */
-	    sendn(_client_tcp_port->socket_fd, temp_buffer, 20, 0, dtimeout);
-	    return;
-
-#endif
-#endif
-	    tcpsvr_threads_created++;
+	    park_blocking_read(_client_tcp_port);
 	}
 	break;
 
     case REMOTE_CMS_READ_REQUEST_TYPE:
 	server->read_req.buffer_number = buffer_number;
-	server->read_req.access_type = ntohl(*((u_long *) temp_buffer + 3));
-	server->read_req.last_id_read = ntohl(*((u_long *) temp_buffer + 4));
+	server->read_req.access_type = getbe32(temp_buffer + 12);
+	server->read_req.last_id_read = getbe32(temp_buffer + 16);
 	server->read_reply =
 	    (REMOTE_READ_REPLY *) server->process_request(&server->read_req);
 	if (max_total_subdivisions > 1) {
@@ -1121,18 +1210,8 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 		server->get_total_subdivisions(buffer_number);
 	}
 	if (total_subdivisions > 1) {
-	    if (recvn
-		(_client_tcp_port->socket_fd,
-		    (char *) (((u_long *) temp_buffer) + 5), 4, 0, -1,
-		    NULL) < 0) {
-		rcs_print_error
-		    ("Can not read from client port (%d) from %s\n",
-		    _client_tcp_port->socket_fd,
-		    inet_ntoa(_client_tcp_port->address.sin_addr));
-		_client_tcp_port->errors++;
-		return;
-	    }
-	    server->read_req.subdiv = ntohl(*((u_long *) temp_buffer + 5));
+	    memcpy(temp_buffer + 20, body, 4);
+	    server->read_req.subdiv = getbe32(temp_buffer + 20);
 	} else {
 	    server->read_req.subdiv = 0;
 	}
@@ -1143,7 +1222,7 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	    putbe32(temp_buffer + 8, 0);
 	    putbe32(temp_buffer + 12, 0);
 	    putbe32(temp_buffer + 16, 0);
-	    sendn(_client_tcp_port->socket_fd, temp_buffer, 20, 0, dtimeout);
+	    send_reply(_client_tcp_port, temp_buffer, 20, NULL, 0);
 	    return;
 	}
 	putbe32(temp_buffer, _client_tcp_port->serial_number);
@@ -1151,66 +1230,31 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	putbe32(temp_buffer + 8, server->read_reply->size);
 	putbe32(temp_buffer + 12, server->read_reply->write_id);
 	putbe32(temp_buffer + 16, server->read_reply->was_read);
-	if (server->read_reply->size < (0x2000 - 20)
-	    && server->read_reply->size > 0) {
-	    memcpy(temp_buffer + 20, server->read_reply->data,
-		server->read_reply->size);
-	    if (sendn
-		(_client_tcp_port->socket_fd, temp_buffer,
-		    20 + server->read_reply->size, 0, dtimeout) < 0) {
-		_client_tcp_port->errors++;
-		return;
-	    }
-	} else {
-	    if (sendn
-		(_client_tcp_port->socket_fd, temp_buffer, 20, 0,
-		    dtimeout) < 0) {
-		_client_tcp_port->errors++;
-		return;
-	    }
-	    if (server->read_reply->size > 0) {
-		if (sendn
-		    (_client_tcp_port->socket_fd, server->read_reply->data,
-			server->read_reply->size, 0, dtimeout) < 0) {
-		    _client_tcp_port->errors++;
-		    return;
-		}
-	    }
+	if (send_reply(_client_tcp_port, temp_buffer, 20,
+		server->read_reply->data, server->read_reply->size) < 0) {
+	    _client_tcp_port->errors++;
+	    return;
 	}
 	break;
 
     case REMOTE_CMS_WRITE_REQUEST_TYPE:
 	server->write_req.buffer_number = buffer_number;
-	server->write_req.access_type = ntohl(*((u_long *) temp_buffer + 3));
-	server->write_req.size = ntohl(*((u_long *) temp_buffer + 4));
+	server->write_req.access_type = getbe32(temp_buffer + 12);
+	server->write_req.size = getbe32(temp_buffer + 16);
 	total_subdivisions = 1;
 	if (max_total_subdivisions > 1) {
 	    total_subdivisions =
 		server->get_total_subdivisions(buffer_number);
 	}
 	if (total_subdivisions > 1) {
-	    if (recvn
-		(_client_tcp_port->socket_fd,
-		    (char *) (((u_long *) temp_buffer) + 5), 4, 0, -1,
-		    NULL) < 0) {
-		rcs_print_error
-		    ("Can not read from client port (%d) from %s\n",
-		    _client_tcp_port->socket_fd,
-		    inet_ntoa(_client_tcp_port->address.sin_addr));
-		_client_tcp_port->errors++;
-		return;
-	    }
-	    server->write_req.subdiv = ntohl(*((u_long *) temp_buffer + 5));
+	    memcpy(temp_buffer + 20, body, 4);
+	    body += 4;
+	    server->write_req.subdiv = getbe32(temp_buffer + 20);
 	} else {
 	    server->write_req.subdiv = 0;
 	}
 	if (server->write_req.size > 0) {
-	    if (recvn
-		(_client_tcp_port->socket_fd, server->write_req.data,
-		    server->write_req.size, 0, -1, NULL) < 0) {
-		_client_tcp_port->errors++;
-		return;
-	    }
+	    memcpy(server->write_req.data, body, server->write_req.size);
 	}
 	server->write_reply =
 	    (REMOTE_WRITE_REPLY *) server->process_request(&server->
@@ -1221,16 +1265,14 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 		putbe32(temp_buffer, _client_tcp_port->serial_number);
 		putbe32(temp_buffer + 4, CMS_SERVER_SIDE_ERROR);
 		putbe32(temp_buffer + 8, 0);	/* was_read */
-		sendn(_client_tcp_port->socket_fd, temp_buffer, 12, 0,
-		    dtimeout);
+		send_reply(_client_tcp_port, temp_buffer, 12, NULL, 0);
 		return;
 	    }
 	    putbe32(temp_buffer, _client_tcp_port->serial_number);
 	    putbe32(temp_buffer + 4, server->write_reply->status);
 	    putbe32(temp_buffer + 8, server->write_reply->was_read);
-	    if (sendn
-		(_client_tcp_port->socket_fd, temp_buffer, 12, 0,
-		    dtimeout) < 0) {
+	    if (send_reply(_client_tcp_port, temp_buffer, 12,
+		NULL, 0) < 0) {
 		_client_tcp_port->errors++;
 	    }
 	} else {
@@ -1243,7 +1285,7 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
     case REMOTE_CMS_CHECK_IF_READ_REQUEST_TYPE:
 	server->check_if_read_req.buffer_number = buffer_number;
 	server->check_if_read_req.subdiv =
-	    ntohl(*((u_long *) temp_buffer + 3));
+	    getbe32(temp_buffer + 12);
 	server->check_if_read_reply =
 	    (REMOTE_CHECK_IF_READ_REPLY *) server->process_request(&server->
 	    check_if_read_req);
@@ -1252,15 +1294,13 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	    putbe32(temp_buffer, _client_tcp_port->serial_number);
 	    putbe32(temp_buffer + 4, CMS_SERVER_SIDE_ERROR);
 	    putbe32(temp_buffer + 8, 0);	/* was_read */
-	    sendn(_client_tcp_port->socket_fd, temp_buffer, 12, 0, dtimeout);
+	    send_reply(_client_tcp_port, temp_buffer, 12, NULL, 0);
 	    return;
 	}
 	putbe32(temp_buffer, _client_tcp_port->serial_number);
-	*((u_long *) temp_buffer + 1) =
-	    htonl(server->check_if_read_reply->status);
-	*((u_long *) temp_buffer + 2) =
-	    htonl(server->check_if_read_reply->was_read);
-	if (sendn(_client_tcp_port->socket_fd, temp_buffer, 12, 0, dtimeout) <
+	putbe32(temp_buffer + 4, server->check_if_read_reply->status);
+	putbe32(temp_buffer + 8, server->check_if_read_reply->was_read);
+	if (send_reply(_client_tcp_port, temp_buffer, 12, NULL, 0) <
 	    0) {
 	    _client_tcp_port->errors++;
 	}
@@ -1269,7 +1309,7 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
     case REMOTE_CMS_GET_MSG_COUNT_REQUEST_TYPE:
 	server->get_msg_count_req.buffer_number = buffer_number;
 	server->get_msg_count_req.subdiv =
-	    ntohl(*((u_long *) temp_buffer + 3));
+	    getbe32(temp_buffer + 12);
 	server->get_msg_count_reply =
 	    (REMOTE_GET_MSG_COUNT_REPLY *) server->process_request(&server->
 	    get_msg_count_req);
@@ -1278,15 +1318,13 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	    putbe32(temp_buffer, _client_tcp_port->serial_number);
 	    putbe32(temp_buffer + 4, CMS_SERVER_SIDE_ERROR);
 	    putbe32(temp_buffer + 8, 0);	/* was_read */
-	    sendn(_client_tcp_port->socket_fd, temp_buffer, 12, 0, dtimeout);
+	    send_reply(_client_tcp_port, temp_buffer, 12, NULL, 0);
 	    return;
 	}
 	putbe32(temp_buffer, _client_tcp_port->serial_number);
-	*((u_long *) temp_buffer + 1) =
-	    htonl(server->get_msg_count_reply->status);
-	*((u_long *) temp_buffer + 2) =
-	    htonl(server->get_msg_count_reply->count);
-	if (sendn(_client_tcp_port->socket_fd, temp_buffer, 12, 0, dtimeout) <
+	putbe32(temp_buffer + 4, server->get_msg_count_reply->status);
+	putbe32(temp_buffer + 8, server->get_msg_count_reply->count);
+	if (send_reply(_client_tcp_port, temp_buffer, 12, NULL, 0) <
 	    0) {
 	    _client_tcp_port->errors++;
 	}
@@ -1295,7 +1333,7 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
     case REMOTE_CMS_GET_QUEUE_LENGTH_REQUEST_TYPE:
 	server->get_queue_length_req.buffer_number = buffer_number;
 	server->get_queue_length_req.subdiv =
-	    ntohl(*((u_long *) temp_buffer + 3));
+	    getbe32(temp_buffer + 12);
 	server->get_queue_length_reply =
 	    (REMOTE_GET_QUEUE_LENGTH_REPLY *) server->
 	    process_request(&server->get_queue_length_req);
@@ -1304,15 +1342,13 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	    putbe32(temp_buffer, _client_tcp_port->serial_number);
 	    putbe32(temp_buffer + 4, CMS_SERVER_SIDE_ERROR);
 	    putbe32(temp_buffer + 8, 0);	/* was_read */
-	    sendn(_client_tcp_port->socket_fd, temp_buffer, 12, 0, dtimeout);
+	    send_reply(_client_tcp_port, temp_buffer, 12, NULL, 0);
 	    return;
 	}
 	putbe32(temp_buffer, _client_tcp_port->serial_number);
-	*((u_long *) temp_buffer + 1) =
-	    htonl(server->get_queue_length_reply->status);
-	*((u_long *) temp_buffer + 2) =
-	    htonl(server->get_queue_length_reply->queue_length);
-	if (sendn(_client_tcp_port->socket_fd, temp_buffer, 12, 0, dtimeout) <
+	putbe32(temp_buffer + 4, server->get_queue_length_reply->status);
+	putbe32(temp_buffer + 8, server->get_queue_length_reply->queue_length);
+	if (send_reply(_client_tcp_port, temp_buffer, 12, NULL, 0) <
 	    0) {
 	    _client_tcp_port->errors++;
 	}
@@ -1321,7 +1357,7 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
     case REMOTE_CMS_GET_SPACE_AVAILABLE_REQUEST_TYPE:
 	server->get_space_available_req.buffer_number = buffer_number;
 	server->get_space_available_req.subdiv =
-	    ntohl(*((u_long *) temp_buffer + 3));
+	    getbe32(temp_buffer + 12);
 	server->get_space_available_reply =
 	    (REMOTE_GET_SPACE_AVAILABLE_REPLY *) server->
 	    process_request(&server->get_space_available_req);
@@ -1330,15 +1366,13 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	    putbe32(temp_buffer, _client_tcp_port->serial_number);
 	    putbe32(temp_buffer + 4, CMS_SERVER_SIDE_ERROR);
 	    putbe32(temp_buffer + 8, 0);	/* was_read */
-	    sendn(_client_tcp_port->socket_fd, temp_buffer, 12, 0, dtimeout);
+	    send_reply(_client_tcp_port, temp_buffer, 12, NULL, 0);
 	    return;
 	}
 	putbe32(temp_buffer, _client_tcp_port->serial_number);
-	*((u_long *) temp_buffer + 1) =
-	    htonl(server->get_space_available_reply->status);
-	*((u_long *) temp_buffer + 2) =
-	    htonl(server->get_space_available_reply->space_available);
-	if (sendn(_client_tcp_port->socket_fd, temp_buffer, 12, 0, dtimeout) <
+	putbe32(temp_buffer + 4, server->get_space_available_reply->status);
+	putbe32(temp_buffer + 8, server->get_space_available_reply->space_available);
+	if (send_reply(_client_tcp_port, temp_buffer, 12, NULL, 0) <
 	    0) {
 	    _client_tcp_port->errors++;
 	}
@@ -1346,7 +1380,7 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 
     case REMOTE_CMS_CLEAR_REQUEST_TYPE:
 	server->clear_req.buffer_number = buffer_number;
-	server->clear_req.subdiv = ntohl(*((u_long *) temp_buffer + 3));
+	server->clear_req.subdiv = getbe32(temp_buffer + 12);
 	server->clear_reply =
 	    (REMOTE_CLEAR_REPLY *) server->process_request(&server->
 	    clear_req);
@@ -1354,12 +1388,12 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	    rcs_print_error("Server could not process request.\n");
 	    putbe32(temp_buffer, _client_tcp_port->serial_number);
 	    putbe32(temp_buffer + 4, CMS_SERVER_SIDE_ERROR);
-	    sendn(_client_tcp_port->socket_fd, temp_buffer, 8, 0, dtimeout);
+	    send_reply(_client_tcp_port, temp_buffer, 8, NULL, 0);
 	    return;
 	}
 	putbe32(temp_buffer, _client_tcp_port->serial_number);
 	putbe32(temp_buffer + 4, server->clear_reply->status);
-	if (sendn(_client_tcp_port->socket_fd, temp_buffer, 8, 0, dtimeout) <
+	if (send_reply(_client_tcp_port, temp_buffer, 8, NULL, 0) <
 	    0) {
 	    _client_tcp_port->errors++;
 	}
@@ -1371,33 +1405,12 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	break;
 
     case REMOTE_CMS_CLOSE_CHANNEL_REQUEST_TYPE:
-	client_port_to_check = (CLIENT_TCP_PORT *) client_ports->get_head();
-	while (NULL != client_port_to_check) {
-	    if (client_port_to_check->socket_fd ==
-		_client_tcp_port->socket_fd) {
-		break;
-	    }
-	    client_port_to_check =
-		(CLIENT_TCP_PORT *) client_ports->get_next();
-	}
-	FD_CLR(_client_tcp_port->socket_fd, &read_fd_set);
-	close(_client_tcp_port->socket_fd);
-	current_clients--;
-	if (NULL != _client_tcp_port->subscriptions) {
-	    remove_subscription_client(_client_tcp_port, buffer_number);
-	}
-	_client_tcp_port->socket_fd = -1;
-	delete _client_tcp_port;
-	client_ports->delete_current_node();
+	close_client(_client_tcp_port);
 	break;
 
     case REMOTE_CMS_GET_KEYS_REQUEST_TYPE:
 	server->get_keys_req.buffer_number = buffer_number;
-	if (recvn(_client_tcp_port->socket_fd,
-		server->get_keys_req.name, 16, 0, -1, NULL) < 0) {
-	    _client_tcp_port->errors++;
-	    return;
-	}
+	memcpy(server->get_keys_req.name, body, 16);
 	server->get_keys_reply =
 	    (REMOTE_GET_KEYS_REPLY *) server->process_request(&server->
 	    get_keys_req);
@@ -1407,7 +1420,7 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	    putbe32(temp_buffer, _client_tcp_port->serial_number);
 	    server->gen_random_key(((char *) temp_buffer) + 4, 2);
 	    server->gen_random_key(((char *) temp_buffer) + 12, 2);
-	    sendn(_client_tcp_port->socket_fd, temp_buffer, 20, 0, dtimeout);
+	    send_reply(_client_tcp_port, temp_buffer, 20, NULL, 0);
 	    return;
 	} else {
 	    putbe32(temp_buffer, _client_tcp_port->serial_number);
@@ -1416,23 +1429,15 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	    memcpy(((char *) temp_buffer) + 12, server->get_keys_reply->key2,
 		8);
 	    /* successful ? */
-	    sendn(_client_tcp_port->socket_fd, temp_buffer, 20, 0, dtimeout);
+	    send_reply(_client_tcp_port, temp_buffer, 20, NULL, 0);
 	    return;
 	}
 	break;
 
     case REMOTE_CMS_LOGIN_REQUEST_TYPE:
 	server->login_req.buffer_number = buffer_number;
-	if (recvn(_client_tcp_port->socket_fd,
-		server->login_req.name, 16, 0, -1, NULL) < 0) {
-	    _client_tcp_port->errors++;
-	    return;
-	}
-	if (recvn(_client_tcp_port->socket_fd,
-		server->login_req.passwd, 16, 0, -1, NULL) < 0) {
-	    _client_tcp_port->errors++;
-	    return;
-	}
+	memcpy(server->login_req.name, body, 16);
+	memcpy(server->login_req.passwd, body + 16, 16);
 	server->login_reply =
 	    (REMOTE_LOGIN_REPLY *) server->process_request(&server->
 	    login_req);
@@ -1440,13 +1445,13 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	    rcs_print_error("Server could not process request.\n");
 	    putbe32(temp_buffer, _client_tcp_port->serial_number);
 	    putbe32(temp_buffer + 4, 0);	/* not successful */
-	    sendn(_client_tcp_port->socket_fd, temp_buffer, 8, 0, dtimeout);
+	    send_reply(_client_tcp_port, temp_buffer, 8, NULL, 0);
 	    return;
 	} else {
 	    putbe32(temp_buffer, _client_tcp_port->serial_number);
 	    putbe32(temp_buffer + 4, server->login_reply->success);
 	    /* successful ? */
-	    sendn(_client_tcp_port->socket_fd, temp_buffer, 8, 0, dtimeout);
+	    send_reply(_client_tcp_port, temp_buffer, 8, NULL, 0);
 	    return;
 	}
 	break;
@@ -1454,9 +1459,9 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
     case REMOTE_CMS_SET_SUBSCRIPTION_REQUEST_TYPE:
 	server->set_subscription_req.buffer_number = buffer_number;
 	server->set_subscription_req.subscription_type =
-	    ntohl(*((u_long *) temp_buffer + 3));
+	    getbe32(temp_buffer + 12);
 	server->set_subscription_req.poll_interval_millis =
-	    ntohl(*((u_long *) temp_buffer + 4));
+	    getbe32(temp_buffer + 16);
 	server->set_subscription_reply =
 	    (REMOTE_SET_SUBSCRIPTION_REPLY *) server->
 	    process_request(&server->set_subscription_req);
@@ -1464,7 +1469,7 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	    rcs_print_error("Server could not process request.\n");
 	    putbe32(temp_buffer, _client_tcp_port->serial_number);
 	    putbe32(temp_buffer + 4, 0);	/* not successful */
-	    sendn(_client_tcp_port->socket_fd, temp_buffer, 8, 0, dtimeout);
+	    send_reply(_client_tcp_port, temp_buffer, 8, NULL, 0);
 	    return;
 	} else {
 	    if (server->set_subscription_reply->success) {
@@ -1485,10 +1490,9 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 		}
 	    }
 	    putbe32(temp_buffer, _client_tcp_port->serial_number);
-	    *((u_long *) temp_buffer + 1) =
-		htonl(server->set_subscription_reply->success);
+	    putbe32(temp_buffer + 4, server->set_subscription_reply->success);
 	    /* successful ? */
-	    sendn(_client_tcp_port->socket_fd, temp_buffer, 8, 0, dtimeout);
+	    send_reply(_client_tcp_port, temp_buffer, 8, NULL, 0);
 	    return;
 	}
 	break;
@@ -1550,6 +1554,8 @@ void CMS_SERVER_REMOTE_TCP_PORT::add_subscription_client(int buffer_number,
 	temp_clnt_info->sub_buf_info = buf_info;
 	temp_clnt_info->clnt_port = clnt;
 	temp_clnt_info->last_sub_sent_time = etime();
+	temp_clnt_info->next_due = temp_clnt_info->last_sub_sent_time +
+	    poll_interval_millis / 1000.0;
 	temp_clnt_info->subscription_list_id =
 	    clnt->subscriptions->store_at_tail(temp_clnt_info,
 	    sizeof(*temp_clnt_info), 0);
@@ -1597,6 +1603,10 @@ void CMS_SERVER_REMOTE_TCP_PORT::recalculate_polling_interval()
 {
     int min_poll_interval_millis = 30000;
     polling_enabled = 0;
+    variable_subscriptions = 0;
+    if (NULL == subscription_buffers) {
+	return;
+    }
     TCP_BUFFER_SUBSCRIPTION_INFO *buf_info =
 	(TCP_BUFFER_SUBSCRIPTION_INFO *) subscription_buffers->get_head();
     while (NULL != buf_info) {
@@ -1612,6 +1622,10 @@ void CMS_SERVER_REMOTE_TCP_PORT::recalculate_polling_interval()
 		    temp_clnt_info->poll_interval_millis;
 		polling_enabled = 1;
 	    }
+	    if (temp_clnt_info->subscription_type ==
+		CMS_VARIABLE_SUBSCRIPTION) {
+		variable_subscriptions++;
+	    }
 	    temp_clnt_info = (TCP_CLIENT_SUBSCRIPTION_INFO *)
 		buf_info->sub_clnt_info->get_next();
 	}
@@ -1623,19 +1637,45 @@ void CMS_SERVER_REMOTE_TCP_PORT::recalculate_polling_interval()
     } else {
 	current_poll_interval_millis = ((int) (clk_tck() * 1000.0));
     }
-    select_timeout.tv_sec = current_poll_interval_millis / 1000;
-    select_timeout.tv_usec = (current_poll_interval_millis % 1000) * 1000;
     dtimeout = (current_poll_interval_millis + 10) * 1000.0;
     if (dtimeout < 0.5) {
 	dtimeout = 0.5;
     }
 }
 
+/* Move a polled subscription that was due to its next interval. */
+static void tcpsvr_advance_due(TCP_CLIENT_SUBSCRIPTION_INFO * clnt_info,
+    double cur_time)
+{
+    if (clnt_info->subscription_type != CMS_POLLED_SUBSCRIPTION ||
+	cur_time + 0.001 < clnt_info->next_due) {
+	return;
+    }
+    clnt_info->next_due += clnt_info->poll_interval_millis / 1000.0;
+    if (clnt_info->next_due < cur_time) {
+	/* fell behind, don't send a burst to catch up */
+	clnt_info->next_due = cur_time +
+	    clnt_info->poll_interval_millis / 1000.0;
+    }
+}
+
+/* Polled subscriptions are sent on a fixed schedule, next_due advances by
+   the poll interval so updates don't drift with the loop timing. A buffer
+   is only read when one of its subscribers is due, the message read is
+   sent to all of them. A due subscriber moves to its next interval whether
+   or not there was anything new to send, so an idle buffer is read once
+   per interval. */
 void CMS_SERVER_REMOTE_TCP_PORT::update_subscriptions()
 {
     pid_t pid = getpid();
     pid_t tid = 0;
     CMS_SERVER *server;
+    TCP_CLIENT_SUBSCRIPTION_INFO *temp_clnt_info;
+    int due;
+
+    if (NULL == subscription_buffers) {
+	return;
+    }
     server = find_server(pid, tid);
     if (NULL == server) {
 	rcs_print_error
@@ -1643,13 +1683,28 @@ void CMS_SERVER_REMOTE_TCP_PORT::update_subscriptions()
 	    pid);
 	return;
     }
-    if (NULL == subscription_buffers) {
-	return;
-    }
     double cur_time = etime();
     TCP_BUFFER_SUBSCRIPTION_INFO *buf_info =
 	(TCP_BUFFER_SUBSCRIPTION_INFO *) subscription_buffers->get_head();
     while (NULL != buf_info) {
+	due = 0;
+	temp_clnt_info =
+	    (TCP_CLIENT_SUBSCRIPTION_INFO *) buf_info->sub_clnt_info->
+	    get_head();
+	while (temp_clnt_info != NULL && !due) {
+	    due = temp_clnt_info->subscription_type ==
+		CMS_VARIABLE_SUBSCRIPTION
+		|| (temp_clnt_info->subscription_type ==
+		CMS_POLLED_SUBSCRIPTION
+		&& cur_time + 0.001 >= temp_clnt_info->next_due);
+	    temp_clnt_info = (TCP_CLIENT_SUBSCRIPTION_INFO *)
+		buf_info->sub_clnt_info->get_next();
+	}
+	if (!due) {
+	    buf_info = (TCP_BUFFER_SUBSCRIPTION_INFO *)
+		subscription_buffers->get_next();
+	    continue;
+	}
 	server->read_req.buffer_number = buf_info->buffer_number;
 	server->read_req.access_type = CMS_READ_ACCESS;
 	server->read_req.last_id_read = buf_info->min_last_id;
@@ -1663,6 +1718,14 @@ void CMS_SERVER_REMOTE_TCP_PORT::update_subscriptions()
 	}
 	if (server->read_reply->write_id == buf_info->min_last_id ||
 	    server->read_reply->size < 1) {
+	    temp_clnt_info =
+		(TCP_CLIENT_SUBSCRIPTION_INFO *) buf_info->sub_clnt_info->
+		get_head();
+	    while (temp_clnt_info != NULL) {
+		tcpsvr_advance_due(temp_clnt_info, cur_time);
+		temp_clnt_info = (TCP_CLIENT_SUBSCRIPTION_INFO *)
+		    buf_info->sub_clnt_info->get_next();
+	    }
 	    buf_info = (TCP_BUFFER_SUBSCRIPTION_INFO *)
 		subscription_buffers->get_next();
 	    continue;
@@ -1672,52 +1735,35 @@ void CMS_SERVER_REMOTE_TCP_PORT::update_subscriptions()
 	putbe32(temp_buffer + 8, server->read_reply->size);
 	putbe32(temp_buffer + 12, server->read_reply->write_id);
 	putbe32(temp_buffer + 16, server->read_reply->was_read);
-	TCP_CLIENT_SUBSCRIPTION_INFO *temp_clnt_info =
+	temp_clnt_info =
 	    (TCP_CLIENT_SUBSCRIPTION_INFO *) buf_info->sub_clnt_info->
 	    get_head();
 	buf_info->min_last_id = server->read_reply->write_id;
 	while (temp_clnt_info != NULL) {
-	    double time_diff = cur_time - temp_clnt_info->last_sub_sent_time;
-	    int time_diff_millis = (int) ((double) time_diff * 1000.0);
 	    rcs_print_debug(PRINT_SERVER_SUBSCRIPTION_ACTIVITY,
-		"Subscription time_diff_millis=%d\n", time_diff_millis);
+		"Subscription time_diff_millis=%d\n",
+		(int) ((cur_time - temp_clnt_info->last_sub_sent_time) *
+		    1000.0));
 	    if (((temp_clnt_info->subscription_type == CMS_POLLED_SUBSCRIPTION
-			&& time_diff_millis + 10 >=
-			temp_clnt_info->poll_interval_millis)
+			&& cur_time + 0.001 >= temp_clnt_info->next_due)
 		    || temp_clnt_info->subscription_type ==
 		    CMS_VARIABLE_SUBSCRIPTION)
 		&& temp_clnt_info->last_id_read !=
-		server->read_reply->write_id) {
+		server->read_reply->write_id
+		&& temp_clnt_info->clnt_port->reply_queued == 0) {
+		/* a client still taking its last reply gets this message
+		   or a newer one at its next interval */
 		temp_clnt_info->last_id_read = server->read_reply->write_id;
 		temp_clnt_info->last_sub_sent_time = cur_time;
 		temp_clnt_info->clnt_port->serial_number++;
 		putbe32(temp_buffer, temp_clnt_info->clnt_port->serial_number);
-		if (server->read_reply->size < 0x2000 - 20
-		    && server->read_reply->size > 0) {
-		    memcpy(temp_buffer + 20, server->read_reply->data,
-			server->read_reply->size);
-		    if (sendn
-			(temp_clnt_info->clnt_port->socket_fd, temp_buffer,
-			    20 + server->read_reply->size, 0, dtimeout) < 0) {
-			temp_clnt_info->clnt_port->errors++;
-			return;
-		    }
-		} else {
-		    if (sendn(temp_clnt_info->clnt_port->socket_fd,
-			    temp_buffer, 20, 0, dtimeout) < 0) {
-			temp_clnt_info->clnt_port->errors++;
-			return;
-		    }
-		    if (server->read_reply->size > 0) {
-			if (sendn(temp_clnt_info->clnt_port->socket_fd,
-				server->read_reply->data,
-				server->read_reply->size, 0, dtimeout) < 0) {
-			    temp_clnt_info->clnt_port->errors++;
-			    return;
-			}
-		    }
+		if (send_reply(temp_clnt_info->clnt_port, temp_buffer, 20,
+			server->read_reply->data,
+			server->read_reply->size) < 0) {
+		    temp_clnt_info->clnt_port->errors++;
 		}
 	    }
+	    tcpsvr_advance_due(temp_clnt_info, cur_time);
 	    if (temp_clnt_info->last_id_read < buf_info->min_last_id) {
 		buf_info->min_last_id = temp_clnt_info->last_id_read;
 	    }
@@ -1753,6 +1799,7 @@ TCP_CLIENT_SUBSCRIPTION_INFO::TCP_CLIENT_SUBSCRIPTION_INFO()
     subscription_type = CMS_NO_SUBSCRIPTION;
     poll_interval_millis = 30000;
     last_sub_sent_time = 0.0;
+    next_due = 0.0;
     subscription_list_id = -1;
     buffer_number = -1;
     subscription_paused = 0;
@@ -1783,12 +1830,18 @@ CLIENT_TCP_PORT::CLIENT_TCP_PORT()
     address.sin_family = AF_INET;
     address.sin_addr.s_addr = htonl(INADDR_ANY);
     socket_fd = -1;
+    list_id = -1;
     subscriptions = NULL;
-    tid = -1;
-    pid = -1;
+    blocking = 0;
     blocking_read_req = NULL;
-    threadId = 0;
     diag_info = NULL;
+    reply_queue = NULL;
+    reply_queued = 0;
+    reply_sent = 0;
+    reply_alloc = 0;
+    request_buf = NULL;
+    request_have = 0;
+    request_alloc = 0;
 }
 
 CLIENT_TCP_PORT::~CLIENT_TCP_PORT()
@@ -1808,14 +1861,20 @@ CLIENT_TCP_PORT::~CLIENT_TCP_PORT()
 	delete subscriptions;
 	subscriptions = NULL;
     }
-#ifdef NO_THREADS
     if (NULL != blocking_read_req) {
 	delete blocking_read_req;
 	blocking_read_req = NULL;
     }
-#endif
     if (NULL != diag_info) {
 	delete diag_info;
 	diag_info = NULL;
     }
+    if (NULL != reply_queue) {
+	free(reply_queue);
+	reply_queue = NULL;
+    }
+    if (NULL != request_buf) {
+	free(request_buf);
+	request_buf = NULL;
+    }
 }
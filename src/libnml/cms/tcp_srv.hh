@@ -33,15 +33,11 @@ extern "C" {
 }
 #endif
 
-#ifndef NO_THREADS
-#define NO_THREADS
-
-#ifdef POSIX_THREADS
-#include <pthread.h>
-#endif
-#endif
-
 #define MAX_TCP_BUFFER_SIZE 16
+
+/* How often the server looks for new data in buffers that have variable
+   subscriptions or blocking reads waiting on them. */
+#define TCPSVR_CHANGE_POLL_MILLIS 2
 class CLIENT_TCP_PORT;
 
 class CMS_SERVER_REMOTE_TCP_PORT:public CMS_SERVER_REMOTE_PORT {
@@ -54,9 +50,8 @@ class CMS_SERVER_REMOTE_TCP_PORT:public CMS_SERVER_REMOTE_PORT {
     void unregister_port();
     double dtimeout;
   protected:
-      fd_set read_fd_set, write_fd_set;
-    void handle_request(CLIENT_TCP_PORT *);
-    int maxfdpl;
+    int handle_request(CLIENT_TCP_PORT *, const char *request);
+    int epoll_fd;
     LinkedList *client_ports;
     LinkedList *subscription_buffers;
     int connection_socket;
@@ -66,7 +61,21 @@ class CMS_SERVER_REMOTE_TCP_PORT:public CMS_SERVER_REMOTE_PORT {
     char temp_buffer[0x2000];
     int current_poll_interval_millis;
     int polling_enabled;
-    struct timeval select_timeout;
+    int variable_subscriptions;
+    int blocking_reads;
+    int poll_timeout_millis();
+    void accept_client();
+    void close_client(CLIENT_TCP_PORT *);
+    int send_reply(CLIENT_TCP_PORT *, char *hdr, int hdr_size,
+	const void *data, int size);
+    void watch_client(CLIENT_TCP_PORT *);
+    int flush_replies(CLIENT_TCP_PORT *);
+    long request_size(CMS_SERVER * server, const char *hdr);
+    int read_requests(CLIENT_TCP_PORT *);
+    int dispatch_requests(CLIENT_TCP_PORT *);
+    void park_blocking_read(CLIENT_TCP_PORT *);
+    int try_blocking_read(CLIENT_TCP_PORT *, double now);
+    void update_blocking_reads();
     void update_subscriptions();
     void add_subscription_client(int buffer_number, int subscription_type,
 	int poll_interval_millis, CLIENT_TCP_PORT * clnt);
@@ -76,7 +85,7 @@ class CMS_SERVER_REMOTE_TCP_PORT:public CMS_SERVER_REMOTE_PORT {
     void switch_function(CLIENT_TCP_PORT *
 	_client_tcp_port,
 	CMS_SERVER * server, long request_type, long buffer_number, long
-	received_serial_number);
+	received_serial_number, const char *body);
 };
 
 class TCP_BUFFER_SUBSCRIPTION_INFO {
@@ -96,6 +105,7 @@ class TCP_CLIENT_SUBSCRIPTION_INFO {
     int subscription_type;
     int poll_interval_millis;
     double last_sub_sent_time;
+    double next_due;		/* polled: when the next update is due */
     int subscription_list_id;
     int buffer_number;
     int subscription_paused;
@@ -114,18 +124,15 @@ class CLIENT_TCP_PORT {
     int errors, max_errors;
     struct sockaddr_in address;
     int socket_fd;
+    int list_id;
     LinkedList *subscriptions;
-    pid_t tid;
-    pid_t pid;
-    int blocking;
-#ifdef POSIX_THREADS
-    pthread_t threadId;
-#else
-    int threadId;
-#endif
+    int blocking;		/* blocking_read_req is waiting for data */
     TCPSVR_BLOCKING_READ_REQUEST *blocking_read_req;
     REMOTE_SET_DIAG_INFO_REQUEST *diag_info;
-
+    char *reply_queue;		/* reply bytes the socket did not take yet */
+    long reply_queued, reply_sent, reply_alloc;
+    char *request_buf;		/* request bytes received so far */
+    long request_have, request_alloc;
 };
 
 class TCPSVR_BLOCKING_READ_REQUEST:public REMOTE_BLOCKING_READ_REQUEST {
@@ -133,9 +140,7 @@ class TCPSVR_BLOCKING_READ_REQUEST:public REMOTE_BLOCKING_READ_REQUEST {
     TCPSVR_BLOCKING_READ_REQUEST();
     ~TCPSVR_BLOCKING_READ_REQUEST();
     CLIENT_TCP_PORT *_client_tcp_port;
-    CMS_SERVER_REMOTE_TCP_PORT *remport;
-    CMS_SERVER *server;
-    REMOTE_BLOCKING_READ_REPLY *read_reply;
+    double deadline;		/* etime() to give up, 0 waits forever */
 };
 
 #endif /* TCP_SRV_HH */
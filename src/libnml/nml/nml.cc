@@ -1176,7 +1176,8 @@ NMLTYPE NML::blocking_read(double blocking_timeout)
     if (!cms->force_raw) {
 	cms->set_mode(CMS_READ);
     }
-    if (cms->BufferType == CMS_SHMEM_TYPE) {
+    if (cms->BufferType == CMS_SHMEM_TYPE ||
+	cms->BufferType == CMS_SEQMEM_TYPE) {
 	cms->blocking_read(blocking_timeout);
     } else {
 	double time_elapsed = 0.0;
@@ -1495,6 +1496,13 @@ int NML::format_output()
 	    new_type = ((NMLmsg *) cms->subdiv_data)->type;
 	    new_size = ((NMLmsg *) cms->subdiv_data)->size;
 
+	    /* Nothing to do if it was encoded before. */
+	    if (forced_type <= 0 && !ignore_format_chain &&
+		new_size <= cms->max_message_size &&
+		cms->encode_cache_find(new_size)) {
+		break;
+	    }
+
 	    if (forced_type > 0) {
 		new_type = forced_type;
 		((NMLmsg *) cms->subdiv_data)->type = forced_type;
@@ -1540,6 +1548,9 @@ int NML::format_output()
 		/* Get the new size of the message now that it's been
 		   encoded. */
 		cms->get_encoded_msg_size();
+		if (forced_type <= 0 && (int) cms->status >= 0) {
+		    cms->encode_cache_store(new_size);
+		}
 	    }
 	}
 	break;
@@ -2402,7 +2413,8 @@ NMLTYPE NML::blocking_read_extended(double timeout, double poll_interval)
 	return -1;
     }
 
-    if (cms->BufferType == CMS_SHMEM_TYPE) {
+    if (cms->BufferType == CMS_SHMEM_TYPE ||
+	cms->BufferType == CMS_SEQMEM_TYPE) {
 	return blocking_read(timeout);
     } else {
 	NMLTYPE type = 0;
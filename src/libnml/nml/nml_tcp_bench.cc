@@ -0,0 +1,307 @@
+/********************************************************************
+* Description: nml_tcp_bench.cc
+*   Load test for the NML TCP server with many remote clients.
+*
+*   nml-tcp-bench [-c clients] [-m poll|sub|blk] [-t secs] [-s bytes]
+*	[-f hz] [-i poll_secs] [-S sub_secs] [-p port] [-k key]
+*
+*   Starts a TCP server for one SHMEM buffer, a local writer updating it
+*   at -f Hz with a time stamped message of -s bytes, and -c remote
+*   clients on localhost which get the updates by polling with read()
+*   every -i seconds (poll), through a polled subscription every -S
+*   seconds (sub) or with blocking_read() (blk). Reported are the
+*   updates the clients received, their age on arrival and the CPU time
+*   the server used.
+*
+*   Built by 'make bench', not installed.
+*
+* License: LGPL Version 2
+* System: Linux
+*
+* Copyright (c) 2016 All rights reserved.
+********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include "nml.hh"		/* class NML */
+#include "nmlmsg.hh"		/* class NMLmsg */
+#include "nml_srv.hh"		/* run_nml_servers() */
+#include "cms.hh"		/* class CMS */
+#include "rcs_print.hh"		/* set_rcs_print_destination() */
+#include "timer.hh"		/* etime(), esleep() */
+
+#define BENCH_MSG_TYPE 1001
+#define BENCH_MAX_PAYLOAD 65536
+
+class BENCH_MSG:public NMLmsg {
+  public:
+    BENCH_MSG():NMLmsg(BENCH_MSG_TYPE, sizeof(BENCH_MSG)) {
+    };
+    void update(CMS * cms);
+    double stamp;
+    int seq;
+    int payload_length;
+    char payload[BENCH_MAX_PAYLOAD];
+};
+
+void BENCH_MSG::update(CMS * cms)
+{
+    cms->update(stamp);
+    cms->update(seq);
+    cms->update(payload_length);
+    cms->update(payload, payload_length);
+}
+
+static int bench_format(NMLTYPE type, void *buffer, CMS * cms)
+{
+    switch (type) {
+    case BENCH_MSG_TYPE:
+	((BENCH_MSG *) buffer)->update(cms);
+	break;
+
+    default:
+	return 0;
+    }
+    return 1;
+}
+
+static int clients = 8;
+static const char *mode = "poll";
+static double run_time = 5.0;
+static int payload = 4096;
+static double write_hz = 100.0;
+static double poll_time = 0.01;
+static double sub_time = 0.01;
+static int port = 5099;
+static int key = 7201;
+static char cfg[64];
+
+static void write_config(void)
+{
+    FILE *f;
+    int fd;
+
+    strcpy(cfg, "/tmp/nml-tcp-bench.XXXXXX");
+    fd = mkstemp(cfg);
+    if (fd < 0 || NULL == (f = fdopen(fd, "w"))) {
+	perror(cfg);
+	exit(1);
+    }
+    fprintf(f, "B bench SHMEM localhost %d 0 0 1 %d %d TCP=%d xdr\n",
+	payload + 1024, clients + 8, key, port);
+    fprintf(f, "P srv bench LOCAL localhost RW 1 1.0 1 0\n");
+    fprintf(f, "P wr bench LOCAL localhost W 0 1.0 0 1\n");
+    fprintf(f, "P poll bench REMOTE localhost R 0 1.0 0 2\n");
+    fprintf(f, "P sub bench REMOTE localhost R 0 1.0 0 3 sub=%g\n",
+	sub_time);
+    fprintf(f, "P blk bench REMOTE localhost R 0 1.0 0 4\n");
+    fclose(f);
+}
+
+static NML *open_channel(const char *proc)
+{
+    NML *nml;
+    double start = etime();
+
+    /* the server may still be starting */
+    while (etime() - start < 5.0) {
+	nml = new NML(bench_format, "bench", proc, cfg);
+	if (nml->valid()) {
+	    return nml;
+	}
+	delete nml;
+	esleep(0.05);
+    }
+    fprintf(stderr, "nml-tcp-bench: %s can't connect\n", proc);
+    return NULL;
+}
+
+static void writer(void)
+{
+    NML *nml = open_channel("wr");
+    BENCH_MSG *msg = new BENCH_MSG();
+    double end = etime() + run_time;
+
+    if (NULL == nml) {
+	return;
+    }
+    memset(msg->payload, 'x', payload);
+    msg->payload_length = payload;
+    /* the local channel copies size bytes raw, only send what is used */
+    msg->size = offsetof(BENCH_MSG, payload) + payload;
+    while (etime() < end) {
+	msg->seq++;
+	msg->stamp = etime();
+	nml->write(msg);
+	esleep(1.0 / write_hz);
+    }
+    delete msg;
+    delete nml;
+}
+
+static void client(int fd)
+{
+    NML *nml = open_channel(mode);
+    BENCH_MSG *msg;
+    double end, age, sum = 0, max = 0;
+    long n = 0, last = 0;
+    NMLTYPE type;
+    char line[256];
+
+    if (NULL == nml) {
+	return;
+    }
+    end = etime() + run_time;
+    while (etime() < end) {
+	if (!strcmp(mode, "poll")) {
+	    type = nml->read();
+	    esleep(poll_time);
+	} else {
+	    type = nml->blocking_read(0.1);
+	}
+	if (type != BENCH_MSG_TYPE) {
+	    continue;
+	}
+	msg = (BENCH_MSG *) nml->get_address();
+	if (msg->seq == last) {
+	    continue;
+	}
+	last = msg->seq;
+	age = etime() - msg->stamp;
+	sum += age;
+	if (age > max) {
+	    max = age;
+	}
+	n++;
+    }
+    snprintf(line, sizeof(line), "%ld %g %g\n", n, sum, max);
+    if (write(fd, line, strlen(line)) < 0) {
+	perror("write");
+    }
+    delete nml;
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: nml-tcp-bench [-c clients] [-m poll|sub|blk] "
+	"[-t secs] [-s bytes] [-f hz] [-i poll_secs] [-S sub_secs] "
+	"[-p port] [-k key]\n");
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    int opt, i, fds[2];
+    pid_t server, pid;
+    struct rusage ru;
+    FILE *f;
+    long n, total = 0;
+    double sum, max, age_sum = 0, age_max = 0, cpu;
+
+    while ((opt = getopt(argc, argv, "c:m:t:s:f:i:S:p:k:")) != -1) {
+	switch (opt) {
+	case 'c':
+	    clients = atoi(optarg);
+	    break;
+	case 'm':
+	    mode = optarg;
+	    break;
+	case 't':
+	    run_time = atof(optarg);
+	    break;
+	case 's':
+	    payload = atoi(optarg);
+	    break;
+	case 'f':
+	    write_hz = atof(optarg);
+	    break;
+	case 'i':
+	    poll_time = atof(optarg);
+	    break;
+	case 'S':
+	    sub_time = atof(optarg);
+	    break;
+	case 'p':
+	    port = atoi(optarg);
+	    break;
+	case 'k':
+	    key = strtol(optarg, NULL, 0);
+	    break;
+	default:
+	    usage();
+	}
+    }
+    if (clients < 1 || run_time <= 0 || write_hz <= 0 || payload < 0 ||
+	payload > BENCH_MAX_PAYLOAD || (strcmp(mode, "poll") &&
+	    strcmp(mode, "sub") && strcmp(mode, "blk"))) {
+	usage();
+    }
+    set_rcs_print_destination(RCS_PRINT_TO_NULL);
+    write_config();
+    fflush(stdout);
+
+    server = fork();
+    if (server == 0) {
+	NML *nml = new NML(bench_format, "bench", "srv", cfg);
+
+	if (!nml->valid()) {
+	    _exit(1);
+	}
+	run_nml_servers();
+	_exit(0);
+    }
+    esleep(0.5);
+
+    if (pipe(fds) < 0) {
+	perror("pipe");
+	return 1;
+    }
+    for (i = 0; i <= clients; i++) {
+	pid = fork();
+	if (pid == 0) {
+	    ::close(fds[0]);
+	    if (i == 0) {
+		writer();
+	    } else {
+		client(fds[1]);
+	    }
+	    _exit(0);
+	}
+    }
+    ::close(fds[1]);
+    f = fdopen(fds[0], "r");
+    while (fscanf(f, "%ld %lf %lf", &n, &sum, &max) == 3) {
+	total += n;
+	age_sum += sum;
+	if (max > age_max) {
+	    age_max = max;
+	}
+    }
+    fclose(f);
+
+    /* all clients are done once the pipe is closed */
+    kill(server, SIGTERM);
+    memset(&ru, 0, sizeof(ru));
+    wait4(server, NULL, 0, &ru);
+    while (wait(NULL) > 0);
+    cpu = ru.ru_utime.tv_sec + ru.ru_utime.tv_usec * 1e-6 +
+	ru.ru_stime.tv_sec + ru.ru_stime.tv_usec * 1e-6;
+    unlink(cfg);
+
+    printf("%-4s %3d clients: %7.0f updates/s (%.0f%% of %.0f Hz)  "
+	"age mean %6.2fms max %7.2fms  server cpu %5.1f%%\n",
+	mode, clients, total / run_time,
+	100.0 * total / (run_time * write_hz * clients), write_hz,
+	total ? age_sum / total * 1e3 : 0.0, age_max * 1e3,
+	100.0 * cpu / (run_time + 0.5));
+    return 0;
+}
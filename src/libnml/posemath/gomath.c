@@ -3618,6 +3618,36 @@ int go_mat6_vec6_mult(const go_real a[6][6],
   return GO_RESULT_OK;
 }
 
+int go_mat6_solve(const go_real a[6][6],
+			const go_real b[6],
+			go_real x[6])
+{
+  go_real cpy[6][6];
+  go_real *cpyptr[6];
+  go_real scratchrow[6];
+  go_real d;
+  go_integer index[6];
+  go_integer row, col;
+  int retval;
+
+  /* ludcmp destroys its input matrix, so work on a copy */
+  for (row = 0; row < 6; row++) {
+    for (col = 0; col < 6; col++) {
+      cpy[row][col] = a[row][col];
+    }
+    cpyptr[row] = cpy[row];
+  }
+
+  retval = ludcmp(cpyptr, scratchrow, 6, index, &d);
+  if (GO_RESULT_OK != retval) return retval;
+
+  for (row = 0; row < 6; row++) {
+    x[row] = b[row];
+  }
+
+  return lubksb(cpyptr, 6, index, x);
+}
+
 /* recall:                          */
 /*      |  m.x.x   m.y.x   m.z.x  | */
 /* M =  |  m.x.y   m.y.y   m.z.y  | */
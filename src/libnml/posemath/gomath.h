@@ -684,6 +684,17 @@ extern int go_mat6_vec6_mult(const go_real a[6][6],
 				   const go_real v[6],
 				   go_real axv[6]);
 
+/*!
+  Given a 6x6 matrix \a a and a 6x1 vector \a b, solves a x = b for
+  \a x. Cheaper than go_mat6_inv() followed by go_mat6_vec6_mult(),
+  since only one back substitution is done. Leaves \a a and \a b
+  untouched, \a x may be \a b. Returns GO_RESULT_OK if there is a
+  solution, else GO_RESULT_SINGULAR if the matrix is singular.
+*/
+extern int go_mat6_solve(const go_real a[6][6],
+			       const go_real b[6],
+			       go_real x[6]);
+
 /* Denavit-Hartenberg to pose conversions */
 
 /*
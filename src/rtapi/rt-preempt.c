@@ -50,10 +50,16 @@ static pthread_once_t task_key_once = PTHREAD_ONCE_INIT;
 int _rtapi_task_self_hook(void);
 
 
+/* virtual time scheduling state of a task */
+#define VT_IDLE 0		// not taking part (yet)
+#define VT_WAITING 1		// in rtapi_wait() until next_time
+#define VT_RUNNING 2		// running a cycle
+
 typedef struct {
     int deleted;
     int destroyed;
     struct timespec next_time;
+    int vt_state;
 
     /* The realtime thread. */
     pthread_t thread;
@@ -72,6 +78,21 @@ extra_task_data_t extra_task_data[RTAPI_MAX_TASKS + 1];
 int have_cg;  // true when libcgroup initialized successfully
 #endif  /* RTAPI */
 
+/* with virtual time, this is the release time of the running cycle in
+   RT. Userspace (ULAPI) still runs in real time, so its timeouts and
+   delays keep using the wall clock. */
+long long int _rtapi_get_time_hook(void)
+{
+    struct timespec ts;
+
+#ifdef RTAPI
+    if (global_data && global_data->virtual_time_enabled)
+	return global_data->virtual_time;
+#endif
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
 #ifdef HAVE_RTAPI_GET_CLOCKS_HOOK
 long long int _rtapi_get_clocks_hook(void)
 {
@@ -199,6 +220,106 @@ static task_data *rtapi_this_task() {
     return (task_data *)pthread_getspecific(task_key);
 }
 
+/***********************************************************************
+*                           Virtual time                               *
+************************************************************************/
+/* With global_data->virtual_time_enabled (rtapi_msgd --virtualtime),
+   tasks don't sleep until their next period. Only one runs at a time:
+   once none is running, the waiting task with the earliest next_time -
+   on a tie the one of higher priority, then the lower task id - sets
+   the virtual clock to its next_time and runs a cycle. Threads, and
+   the functs on them, so run in the order they would in real time but
+   as fast as the CPU allows.
+
+   Only RT tasks are stepped. Userspace components (task, iocontrol,
+   halui, GUIs, halsampler) run on the wall clock and don't wait for
+   the virtual one, so a run only repeats exactly if no userspace
+   process feeds the threads, ie in HAL-only configs. */
+
+static pthread_mutex_t vt_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t vt_cond = PTHREAD_COND_INITIALIZER;
+
+static inline int virtual_time(void)
+{
+    return global_data->virtual_time_enabled;
+}
+
+static inline long long timespec_ns(const struct timespec *ts)
+{
+    return ts->tv_sec * 1000000000LL + ts->tv_nsec;
+}
+
+// is task n the next to run? called with vt_mutex held
+static int vt_is_next(int n)
+{
+    long long t = timespec_ns(&extra_task_data[n].next_time);
+    int i;
+
+    for (i = 1; i <= RTAPI_MAX_TASKS; i++) {
+	extra_task_data_t *e = &extra_task_data[i];
+	long long ti;
+
+	if (i == n)
+	    continue;
+	if (e->vt_state == VT_RUNNING)
+	    return 0;
+	if (e->vt_state != VT_WAITING)
+	    continue;
+	ti = timespec_ns(&e->next_time);
+	if ((ti < t) ||
+	    ((ti == t) && (task_array[i].prio > task_array[n].prio)) ||
+	    ((ti == t) && (task_array[i].prio == task_array[n].prio) && (i < n)))
+	    return 0;
+    }
+    return 1;
+}
+
+static void vt_set_state(int n, int state)
+{
+    pthread_mutex_lock(&vt_mutex);
+    extra_task_data[n].vt_state = state;
+    pthread_cond_broadcast(&vt_cond);
+    pthread_mutex_unlock(&vt_mutex);
+}
+
+// pthread_cancel() while waiting, vt_mutex is held again
+static void vt_cancel_cleanup(void *arg)
+{
+    extra_task_data_t *e = arg;
+
+    e->vt_state = VT_IDLE;
+    pthread_cond_broadcast(&vt_cond);
+    pthread_mutex_unlock(&vt_mutex);
+}
+
+/* wait until task n is next, then set the clock to its next_time and
+   move next_time on by a period */
+static void vt_wait(task_data *task, int n)
+{
+    extra_task_data_t *e = &extra_task_data[n];
+
+    pthread_mutex_lock(&vt_mutex);
+    pthread_cleanup_push(vt_cancel_cleanup, e);
+
+    // a task joining late starts now
+    if (timespec_ns(&e->next_time) < global_data->virtual_time) {
+	e->next_time.tv_sec = global_data->virtual_time / 1000000000LL;
+	e->next_time.tv_nsec = global_data->virtual_time % 1000000000LL;
+    }
+    e->vt_state = VT_WAITING;
+    pthread_cond_broadcast(&vt_cond);
+    while (!vt_is_next(n))
+	pthread_cond_wait(&vt_cond, &vt_mutex);
+
+    e->vt_state = VT_RUNNING;
+    global_data->virtual_time = timespec_ns(&e->next_time);
+    _rtapi_advance_time(&e->next_time,
+			task->period + task->pll_correction, 0);
+
+    pthread_cleanup_pop(0);
+    pthread_mutex_unlock(&vt_mutex);
+}
+
 int _rtapi_task_new_hook(task_data *task, int task_id) {
     void *stackaddr;
 
@@ -236,6 +357,8 @@ void _rtapi_task_delete_hook(task_data *task, int task_id) {
 			    "pthread_join() on RT thread '%s': %d %s\n",
 			    task->name, err, strerror(err));
     }
+    // in case it was cancelled in a cycle
+    vt_set_state(task_id, VT_IDLE);
     /* Free the thread stack. */
     free(extra_task_data[task_id].stackaddr);
     extra_task_data[task_id].stackaddr = NULL;
@@ -354,7 +477,8 @@ static void *realtime_thread(void *arg) {
                         "Moved task '%s' to cpuset '%s'",
                         task->name, task->cgname);
     }
-    if (!(task->flags & TF_NONRT)) {
+    // running flat out, a realtime priority would lock up the CPU
+    if (!(task->flags & TF_NONRT) && !virtual_time()) {
 	if (realtime_set_priority(task)) {
 #ifdef RTAPI_POSIX // This requires privs - tell user how to obtain them
 	    rtapi_print_msg(RTAPI_MSG_ERR,
@@ -372,9 +496,17 @@ static void *realtime_thread(void *arg) {
     /* We're done initializing. Open the barrier. */
     pthread_barrier_wait(&extra_task_data[task_id(task)].thread_init_barrier);
 
-    clock_gettime(CLOCK_MONOTONIC, &extra_task_data[task_id(task)].next_time);
-    _rtapi_advance_time(&extra_task_data[task_id(task)].next_time,
-		       task->period + task->pll_correction, 0);
+    if (virtual_time()) {
+	// the first cycle starts at the current virtual time
+	memset(&extra_task_data[task_id(task)].next_time, 0,
+	       sizeof(struct timespec));
+	vt_wait(task, task_id(task));
+    } else {
+	clock_gettime(CLOCK_MONOTONIC,
+		      &extra_task_data[task_id(task)].next_time);
+	_rtapi_advance_time(&extra_task_data[task_id(task)].next_time,
+			   task->period + task->pll_correction, 0);
+    }
 
     _rtapi_task_update_stats_hook(); // inital stats update
 
@@ -405,6 +537,7 @@ static void *realtime_thread(void *arg) {
 	 "ERROR: reached end of realtime thread for task %d\n",
 	 task_id(task));
     extra_task_data[task_id(task)].deleted = 1;
+    vt_set_state(task_id(task), VT_IDLE);
 
     return NULL;
  error:
@@ -460,8 +593,17 @@ int _rtapi_wait_hook(const int flags) {
     struct timespec ts;
     task_data *task = rtapi_this_task();
 
-    if (extra_task_data[task_id(task)].deleted)
+    if (extra_task_data[task_id(task)].deleted) {
+	vt_set_state(task_id(task), VT_IDLE);
 	pthread_exit(0);
+    }
+
+    // a task which doesn't wait would keep the others waiting forever,
+    // so TF_NOWAIT tasks are run at their period too
+    if (virtual_time()) {
+	vt_wait(task, task_id(task));
+	return 0;
+    }
 
     if (flags & TF_NOWAIT)
 	return 0;
@@ -53,6 +53,8 @@
 #define HAVE_RTAPI_TASK_PLL_GET_REFERENCE_HOOK
 #define HAVE_RTAPI_TASK_PLL_SET_CORRECTION_HOOK
 
+#define HAVE_RTAPI_GET_TIME_HOOK   // virtual time, see rt-preempt.c
+
 #if !defined(__i386__) && !defined(__x86_64__)
 #define HAVE_RTAPI_GET_CLOCKS_HOOK // needed for e.g. ARM, see rtapi_time.c
 #endif
@@ -1008,12 +1008,15 @@ static int rtapi_request(zloop_t *loop, zsock_t *socket, void *arg)
 		break;
 	    }
 	    hal_threadargs_t args;
+	    memset(&args, 0, sizeof(args));
 	    args.name = pbreq.rtapicmd().threadname().c_str();
 	    args.period_nsec = pbreq.rtapicmd().threadperiod();
 	    args.uses_fp = pbreq.rtapicmd().use_fp();
 	    args.cpu_id = pbreq.rtapicmd().cpu();
 	    args.flags = (rtapi_thread_flags_t) pbreq.rtapicmd().flags();
 	    strncpy(args.cgname, pbreq.rtapicmd().cgname().c_str(), LINELEN);
+	    args.timing = (hal_thread_timing_t) pbreq.rtapicmd().timing();
+	    args.timing_arg = pbreq.rtapicmd().timing_arg();
 
 	    int retval = create_thread(&args);
 	    if (retval < 0) {
@@ -102,6 +102,13 @@ typedef struct {
     // to track memory problems
     int hal_heap_flags;
 
+    // virtual time (rtapi_msgd --virtualtime, posix flavor only):
+    // RT tasks are stepped one cycle at a time as fast as the CPU
+    // allows, and rtapi_get_time() returns virtual_time, the release
+    // time of the running cycle in nS (see rt-preempt.c)
+    int virtual_time_enabled;
+    long long virtual_time;
+
     // service uuid - the unique machinekit instance identifier
     // set once by rtapi_msgd, visible to all of HAL and RTAPI since
     // the global segment is attached right at startup
@@ -132,7 +139,7 @@ typedef struct {
 
 extern global_data_t *global_data;
 
-#define GLOBAL_LAYOUT_VERSION 44   // bump on layout changes of global_data_t
+#define GLOBAL_LAYOUT_VERSION 45   // bump on layout changes of global_data_t
 
 // use global_data->magic to reflect rtapi_msgd state
 #define GLOBAL_INITIALIZING  0x0eadbeefU
@@ -35,6 +35,8 @@
 // adapted to use offsets relative to the heap descriptor
 // so it can be used as a shared memory malloc
 static void _rtapi_unlocked_free(struct rtapi_heap *h, void *ap);
+static void arena_free(struct rtapi_heap *h, rtapi_malloc_hdr_t *bp);
+static void *arena_malloc(struct rtapi_heap *h, size_t nbytes);
 
 #ifdef MODULE
 #define MSG_ORIGIN MSG_KERNEL
@@ -85,7 +87,10 @@ void  *_rtapi_malloc_aligned(struct rtapi_heap *h, size_t nbytes, size_t align)
 		   __FUNCTION__, align, nbytes);
 	return NULL;
     }
-    void *base = _rtapig_malloc(0, h, nbytes + align);
+    // the trim below splits the block, so this must come from the arena
+    void *base = arena_malloc(h, nbytes + align);
+    if (base == NULL)
+	return NULL;
     void *result = (void *)((rtapi_uintptr_t)(base + align) & - align);
     size_t slack = result - base;
     if (slack < sizeof(rtapi_malloc_tag_t)) {
@@ -126,13 +131,10 @@ void  *_rtapi_malloc_aligned(struct rtapi_heap *h, size_t nbytes, size_t align)
 
 void _rtapi_free(struct rtapi_heap *h, void *);
 
-static void *_rtapig_malloc(const int lock, struct rtapi_heap *h, size_t nbytes)
+// first fit on the arena free list, returns the block header
+static rtapi_malloc_hdr_t *arena_alloc(struct rtapi_heap *h, size_t nunits)
 {
-    WITH_MUTEX_IF(HEAP_MUTEX(h), lock);
-
     rtapi_malloc_hdr_t *p, *prevp;
-    size_t nunits  = (nbytes + sizeof(rtapi_malloc_hdr_t) - 1) /
-	sizeof(rtapi_malloc_hdr_t) + 1;
 
     // heaps are explicitly initialized, see rtapi_heap_init()
     // if ((prevp = h->freep) == NULL) {	// no free list yet
@@ -153,28 +155,171 @@ static void *_rtapig_malloc(const int lock, struct rtapi_heap *h, size_t nbytes)
 	    }
 	    p->s.tag.attr = 0;
 	    h->free_p = heap_off(h, prevp);
-	    size_t alloced = _rtapi_allocsize(h, p+1);
-	    h->requested += nbytes;
-	    h->allocated += alloced;
-	    if (h->flags & RTAPIHEAP_TRACE_MALLOC)
-		heap_print(h, RTAPI_MSG_INFO, "malloc req=%zu actual=%zu at %p\n",
-			   nbytes, alloced, p);
-	    return (void *)(p+1);
+	    return p;
 	}
-	if (p == freep)	{	/* wrapped around free list */
-	    heap_print(h, RTAPI_MSG_INFO, "rtapi_malloc: out of memory"
-		       " (size=%zu arena=%zu)\n", nbytes, h->arena_size);
-	    //if ((p = morecore(nunits)) == NULL)
+	if (p == freep)		/* wrapped around free list */
 	    return NULL;	/* none left */
+    }
+}
+
+// hand chunks whose blocks are all free back to the arena
+// returns the number of chunks released
+static int slab_reclaim(struct rtapi_heap *h)
+{
+    int i, released = 0;
+
+    for (i = 0; i < RTAPI_SLAB_CLASSES; i++) {
+	struct rtapi_slab *sl = &h->slab[i];
+	__u32 *link = &sl->free;
+
+	while (*link) {
+	    rtapi_malloc_hdr_t *bp = heap_ptr(h, *link);
+	    rtapi_slab_chunk_t *c = heap_ptr(h, bp->s.next);
+	    __u32 *next = (__u32 *)(bp + 1);
+
+	    if (c->s.live) {
+		link = next;
+		continue;
+	    }
+	    // unlink; all blocks of an idle chunk are on this list,
+	    // so the last one seen releases the chunk
+	    *link = *next;
+	    sl->nfree--;
+	    if (++c->s.unlinked == c->s.nobj) {
+		arena_free(h, (rtapi_malloc_hdr_t *) c - 1);
+		sl->chunks--;
+		released++;
+	    }
 	}
     }
+    if (released && (h->flags & RTAPIHEAP_TRACE_FREE))
+	heap_print(h, RTAPI_MSG_INFO, "%s: released %d chunks\n",
+		   __FUNCTION__, released);
+    return released;
 }
 
-static void _rtapi_unlocked_free(struct rtapi_heap *h, void *ap)
+// carve a new chunk for size class cls from the arena
+static int slab_refill(struct rtapi_heap *h, int cls)
 {
-    rtapi_malloc_hdr_t *bp, *p;
-    rtapi_malloc_hdr_t *freep =  heap_ptr(h,h->free_p);
+    struct rtapi_slab *sl = &h->slab[cls];
+    size_t unit = sizeof(rtapi_malloc_hdr_t);
+    size_t cunits = (sizeof(rtapi_slab_chunk_t) + unit - 1) / unit;
+    size_t bunits = cls + 2; // header + payload
+    size_t nobj = (RTAPI_SLAB_CHUNK / unit - 1 - cunits) / bunits;
+    size_t i;
+
+    if (nobj < RTAPI_SLAB_MINOBJ)
+	nobj = RTAPI_SLAB_MINOBJ;
+
+    size_t nunits = 1 + cunits + nobj * bunits;
+    rtapi_malloc_hdr_t *p = arena_alloc(h, nunits);
+    if ((p == NULL) && slab_reclaim(h))
+	p = arena_alloc(h, nunits);
+    if (p == NULL)
+	return -ENOMEM;
+
+    rtapi_slab_chunk_t *c = (rtapi_slab_chunk_t *)(p + 1);
+    c->s.live = 0;
+    c->s.nobj = nobj;
+    c->s.unlinked = 0;
+
+    // thread the blocks onto the free list in address order
+    rtapi_malloc_hdr_t *bp = (rtapi_malloc_hdr_t *)(p + 1) + cunits;
+    bp += (nobj - 1) * bunits;
+    for (i = 0; i < nobj; i++, bp -= bunits) {
+	bp->s.next = heap_off(h, c);
+	bp->s.tag.size = bunits;
+	bp->s.tag.attr = ATTR_SLAB;
+	*(__u32 *)(bp + 1) = sl->free;
+	sl->free = heap_off(h, bp);
+    }
+    sl->nfree += nobj;
+    sl->chunks++;
+    return 0;
+}
+
+static void *slab_malloc(struct rtapi_heap *h, size_t nbytes, int cls)
+{
+    struct rtapi_slab *sl = &h->slab[cls];
+
+    if (!sl->free && slab_refill(h, cls))
+	return NULL;
 
+    rtapi_malloc_hdr_t *bp = heap_ptr(h, sl->free);
+    rtapi_slab_chunk_t *c = heap_ptr(h, bp->s.next);
+    sl->free = *(__u32 *)(bp + 1);
+    sl->nfree--;
+    sl->inuse++;
+    c->s.live++;
+
+    size_t alloced = (bp->s.tag.size - 1) * sizeof(rtapi_malloc_hdr_t);
+    h->requested += nbytes;
+    h->allocated += alloced;
+    if (h->flags & RTAPIHEAP_TRACE_MALLOC)
+	heap_print(h, RTAPI_MSG_INFO, "malloc req=%zu actual=%zu at %p class=%d\n",
+		   nbytes, alloced, bp, cls);
+    return (void *)(bp + 1);
+}
+
+static void slab_free(struct rtapi_heap *h, rtapi_malloc_hdr_t *bp)
+{
+    int cls = bp->s.tag.size - 2;
+    struct rtapi_slab *sl = &h->slab[cls];
+    rtapi_slab_chunk_t *c = heap_ptr(h, bp->s.next);
+
+    c->s.live--;
+    *(__u32 *)(bp + 1) = sl->free;
+    sl->free = heap_off(h, bp);
+    sl->nfree++;
+    sl->inuse--;
+    h->freed += sizeof(rtapi_malloc_hdr_t) * (bp->s.tag.size - 1);
+    if (h->flags & RTAPIHEAP_TRACE_FREE)
+	heap_print(h, RTAPI_MSG_INFO,  "%s: class=%d live=%d\n",
+		   __FUNCTION__, cls, c->s.live);
+}
+
+static void *arena_malloc(struct rtapi_heap *h, size_t nbytes)
+{
+    size_t nunits  = (nbytes + sizeof(rtapi_malloc_hdr_t) - 1) /
+	sizeof(rtapi_malloc_hdr_t) + 1;
+
+    rtapi_malloc_hdr_t *p = arena_alloc(h, nunits);
+    if ((p == NULL) && slab_reclaim(h))
+	p = arena_alloc(h, nunits);
+    if (p == NULL) {
+	heap_print(h, RTAPI_MSG_INFO, "rtapi_malloc: out of memory"
+		   " (size=%zu arena=%zu)\n", nbytes, h->arena_size);
+	//if ((p = morecore(nunits)) == NULL)
+	return NULL;
+    }
+    size_t alloced = _rtapi_allocsize(h, p+1);
+    h->requested += nbytes;
+    h->allocated += alloced;
+    if (h->flags & RTAPIHEAP_TRACE_MALLOC)
+	heap_print(h, RTAPI_MSG_INFO, "malloc req=%zu actual=%zu at %p\n",
+		   nbytes, alloced, p);
+    return (void *)(p+1);
+}
+
+static void *_rtapig_malloc(const int lock, struct rtapi_heap *h, size_t nbytes)
+{
+    WITH_MUTEX_IF(HEAP_MUTEX(h), lock);
+
+    size_t units = (nbytes + sizeof(rtapi_malloc_hdr_t) - 1) /
+	sizeof(rtapi_malloc_hdr_t);
+
+    if ((units <= RTAPI_SLAB_CLASSES) && !(h->flags & RTAPIHEAP_NOSLAB)) {
+	void *p = slab_malloc(h, nbytes, units ? units - 1 : 0);
+	if (p)
+	    return p;
+	// no room for a whole chunk - an exact fit might still do
+    }
+    return arena_malloc(h, nbytes);
+}
+
+static void _rtapi_unlocked_free(struct rtapi_heap *h, void *ap)
+{
+    rtapi_malloc_hdr_t *bp;
     rtapi_malloc_tag_t *rt = (rtapi_malloc_tag_t *) ap - 1;
 
     // a block with non-standard alignment?
@@ -190,6 +335,20 @@ static void _rtapi_unlocked_free(struct rtapi_heap *h, void *ap)
     }
 
     bp = (rtapi_malloc_hdr_t *)ap - 1;	// point to block header
+
+    if (bp->s.tag.attr & ATTR_SLAB) {
+	slab_free(h, bp);
+	return;
+    }
+    h->freed += sizeof(rtapi_malloc_hdr_t) * (bp->s.tag.size - 1);
+    arena_free(h, bp);
+}
+
+// return a block to the arena free list, coalescing with its neighbors
+static void arena_free(struct rtapi_heap *h, rtapi_malloc_hdr_t *bp)
+{
+    rtapi_malloc_hdr_t *p;
+    rtapi_malloc_hdr_t *freep =  heap_ptr(h,h->free_p);
     size_t alloc = bp->s.tag.size;
 
     for (p = freep;
@@ -206,8 +365,6 @@ static void _rtapi_unlocked_free(struct rtapi_heap *h, void *ap)
 	    break;
 	}
 
-    h->freed += sizeof(rtapi_malloc_hdr_t) * (bp->s.tag.size - 1);
-
     if (bp + bp->s.tag.size == ((rtapi_malloc_hdr_t *)heap_ptr(h,p->s.next))) {
 	// join to upper neighbor
 	size_t ns = ((rtapi_malloc_hdr_t *)heap_ptr(h,p->s.next))->s.tag.size;
@@ -283,6 +440,8 @@ void *_rtapi_realloc(struct rtapi_heap *h, void *ptr, size_t size)
     return p;
 }
 
+// walks the arena free list only - free size class blocks are
+// accounted for in _rtapi_heap_status()
 size_t _rtapi_heap_walk_freelist(struct rtapi_heap *h, chunk_t callback, void *user)
 {
     WITH_MUTEX(HEAP_MUTEX(h));
@@ -312,8 +471,7 @@ int _rtapi_heap_addmem(struct rtapi_heap *h, void *space, size_t size)
     rtapi_malloc_hdr_t *arena = space;
     size_t clicks = size / sizeof(rtapi_malloc_hdr_t);
     arena->s.tag.size = clicks;
-    _rtapi_unlocked_free(h, (void *) (arena + 1));
-    h->freed -= (clicks-1) * sizeof(rtapi_malloc_hdr_t);
+    arena_free(h, arena);
     h->arena_size += size;
     return 0;
 }
@@ -331,6 +489,7 @@ int _rtapi_heap_init(struct rtapi_heap *heap, const char *name)
     heap->requested = 0;
     heap->allocated = 0;
     heap->freed = 0;
+    memset(heap->slab, 0, sizeof(heap->slab));
     if (name) 
 	strncpy(heap->name, name, sizeof(heap->name));
     else {
@@ -362,6 +521,17 @@ size_t _rtapi_heap_status(struct rtapi_heap *h,
     hs->total_avail = 0;
     hs->fragments = 0;
     hs->largest = 0;
+    hs->slab_inuse = 0;
+    hs->slab_cached = 0;
+    hs->slab_chunks = 0;
+
+    int i;
+    for (i = 0; i < RTAPI_SLAB_CLASSES; i++) {
+	size_t bsize = (i + 1) * sizeof(rtapi_malloc_hdr_t);
+	hs->slab_inuse += h->slab[i].inuse * bsize;
+	hs->slab_cached += h->slab[i].nfree * bsize;
+	hs->slab_chunks += h->slab[i].chunks;
+    }
 
     rtapi_malloc_hdr_t *p, *prevp, *freep = heap_ptr(h, h->free_p);
     prevp = freep;
@@ -375,6 +545,8 @@ size_t _rtapi_heap_status(struct rtapi_heap *h,
 	if (p == freep) {
 	    hs->total_avail *= sizeof(rtapi_malloc_hdr_t);
 	    hs->largest *= sizeof(rtapi_malloc_hdr_t);
+	    hs->fragmentation = hs->total_avail ?
+		100 - (hs->largest * 100) / hs->total_avail : 0;
 	    return hs->largest;
 	}
     }
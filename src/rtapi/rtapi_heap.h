@@ -21,6 +21,7 @@ RTAPI_BEGIN_DECLS
 #define RTAPIHEAP_TRACE_MALLOC RTAPI_BIT(0)
 #define RTAPIHEAP_TRACE_FREE   RTAPI_BIT(1)
 #define RTAPIHEAP_TRIM         RTAPI_BIT(2)  //  free alignment overallocations
+#define RTAPIHEAP_NOSLAB       RTAPI_BIT(3)  //  serve small sizes from the arena too
 
 struct rtapi_heap;
 struct rtapi_heap_stat {
@@ -31,6 +32,10 @@ struct rtapi_heap_stat {
     size_t requested;
     size_t allocated;
     size_t freed;
+    size_t fragmentation; // % of free arena space outside the largest block
+    size_t slab_inuse;    // bytes allocated from size classes
+    size_t slab_cached;   // bytes on size class free lists
+    size_t slab_chunks;   // arena chunks owned by size classes
 };
 
 void  *_rtapi_malloc_aligned(struct rtapi_heap *h, size_t nbytes, size_t align);
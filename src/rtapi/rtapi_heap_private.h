@@ -23,6 +23,22 @@
 #endif
 
 #define ATTR_ALIGNED 1
+#define ATTR_SLAB    2  // block belongs to a slab chunk, see below
+
+// size-class front end:
+// requests of up to RTAPI_SLAB_CLASSES units of rtapi_malloc_hdr_t
+// are served from per-size free lists, one class per unit count, so
+// the many small fixed-size HAL descriptors neither walk nor fragment
+// the arena free list. A class is refilled by carving a chunk of
+// about RTAPI_SLAB_CHUNK bytes from the arena; chunks whose blocks
+// are all free are handed back to the arena when it runs dry.
+#ifndef RTAPI_SLAB_CLASSES
+#define RTAPI_SLAB_CLASSES 32   // 256 bytes with RTAPI_MALLOC_ALIGN 1
+#endif
+#ifndef RTAPI_SLAB_CHUNK
+#define RTAPI_SLAB_CHUNK   1024
+#endif
+#define RTAPI_SLAB_MINOBJ  4
 
 
 typedef struct rtapi_malloc_align {
@@ -48,6 +64,28 @@ union rtapi_malloc_header {
 
 typedef union rtapi_malloc_header rtapi_malloc_hdr_t;
 
+// a slab chunk is a single arena allocation starting with this
+// header, followed by nobj blocks of one size class. Each block has
+// a regular rtapi_malloc_hdr_t with tag.attr = ATTR_SLAB, tag.size
+// the block size in units (so _rtapi_allocsize() works unchanged)
+// and s.next the offset of its chunk. The free list link of a
+// free block lives in the first word of its payload.
+typedef union rtapi_slab_chunk {
+    struct {
+	__u32 live;      // blocks currently allocated
+	__u16 nobj;      // blocks in this chunk
+	__u16 unlinked;  // reclaim: blocks taken off the free list
+    } s;
+    rtapi_malloc_align_t align;
+} rtapi_slab_chunk_t;
+
+struct rtapi_slab {
+    __u32 free;     // offset of first free block, 0: none
+    __u32 nfree;    // blocks on the free list
+    __u32 inuse;    // blocks allocated
+    __u32 chunks;   // chunks carved from the arena
+};
+
 struct rtapi_heap {
     rtapi_malloc_hdr_t base;
     size_t free_p;
@@ -58,6 +96,7 @@ struct rtapi_heap {
     size_t allocated;
     int freed;
     char name[16];
+    struct rtapi_slab slab[RTAPI_SLAB_CLASSES];
 };
 
 static inline void *heap_ptr(struct rtapi_heap *base, size_t offset) {
@@ -124,6 +124,7 @@ static int global_segment_size = MESSAGE_RING_SIZE + GLOBAL_HEAP_SIZE + sizeof(g
 static int actual_global_size; // as returned by create_global_segment()
 static int hal_heap_flags    =  RTAPIHEAP_TRIM;
 static int global_heap_flags =  RTAPIHEAP_TRIM;
+static int virtual_time;
 
 static const char *inifile;
 static int foreground;
@@ -360,7 +361,8 @@ static int init_global_data(global_data_t * data,
 			    const char *service_uuid,
 			    int hal_descriptor_alignment,
 			    int global_heap_flags,
-			    int hal_heap_flags)
+			    int hal_heap_flags,
+			    int virtual_time)
 {
     // data is set to zero except global_segment_size is filled in
     int retval = 0;
@@ -404,6 +406,10 @@ static int init_global_data(global_data_t * data,
     // stack size passed to rtapi_task_new() in hal_create_thread()
     data->hal_thread_stack_size = stack_size;
 
+    // step RT tasks in virtual time, starting at 1s
+    data->virtual_time_enabled = virtual_time;
+    data->virtual_time = virtual_time ? 1000000000LL : 0;
+
     // export the service UUID in the global data segment
     // in binary form
     if (uuid_parse(service_uuid, data->service_uuid)) {
@@ -750,6 +756,7 @@ static struct option long_options[] = {
     { "shmdrv_opts", required_argument, 0, 'o'},
     { "nosighdlr",   no_argument,    0, 'G'},
     { "heapdebug",   no_argument,    0, 'P'},
+    { "virtualtime", no_argument,    0, 'V'},
 
     {0, 0, 0, 0}
 };
@@ -844,6 +851,9 @@ int main(int argc, char **argv)
 	    hal_heap_flags |= (RTAPIHEAP_TRACE_MALLOC|RTAPIHEAP_TRACE_FREE);
 	    global_heap_flags |= (RTAPIHEAP_TRACE_MALLOC|RTAPIHEAP_TRACE_FREE);
 	    break;
+	case 'V':
+	    virtual_time = 1;
+	    break;
 	case 's':
 	    option |= LOG_PERROR;
 	    break;
@@ -872,6 +882,9 @@ int main(int argc, char **argv)
     if (getenv("DEFAULTALIGN") != NULL)
 	hal_descriptor_alignment = 0;
 
+    if (getenv("VIRTUALTIME") != NULL)
+	virtual_time = 1;
+
     // sanity
     if (getuid() == 0) {
 	fprintf(stderr, "%s: FATAL - will not run as root\n", progname);
@@ -897,6 +910,13 @@ int main(int argc, char **argv)
 	exit(EXIT_FAILURE);
     }
 
+    // the tasks would run flat out with realtime priority otherwise
+    if (virtual_time && (flavor->flavor_id != RTAPI_POSIX_ID)) {
+	fprintf(stderr, "%s: FATAL - virtual time needs the posix flavor, not %s\n",
+		progname, flavor->name);
+	exit(EXIT_FAILURE);
+    }
+
     // catch installation error: user not in xenomai group
     if (flavor->flavor_id == RTAPI_XENOMAI_ID) {
 	int retval = user_in_xenomai_group();
@@ -1016,7 +1036,8 @@ int main(int argc, char **argv)
 			 netopts.service_uuid,
 			 hal_descriptor_alignment,
 			 global_heap_flags,
-			 hal_heap_flags)) {
+			 hal_heap_flags,
+			 virtual_time)) {
 
 	syslog_async(LOG_ERR, "%s: startup failed, exiting\n",
 		     progname);
@@ -57,6 +57,9 @@
 // from rtapi/rtapi_common.h
 #define RTAPI_KEY   0x00280A48	/* key used to open RTAPI shared memory */
 
+// from emc/nml_intf/emcstatmirror.hh
+#define EMC_STAT_MIRROR_KEY 0x00455354 // "EST"
+
 // RTAPI rings
 #define RTAPI_RING_SHM_KEY 0x00415000  
 
@@ -0,0 +1,126 @@
+# gcode.previewarray read through memoryview (the new buffer protocol)
+# and through buffer() (the old one), checked against the data the
+# classic Python canon path builds for the same program
+import sys, struct
+import gcode
+from rs274.interpret import Translated, ArcsToSegmentsMixin
+
+class Canon(Translated, ArcsToSegmentsMixin):
+    def __init__(self):
+        self.traverse = []
+        self.feed = []
+        self.arcfeed = []
+        self.feedrate = 1
+        self.lo = (0,) * 9
+        self.first_move = True
+        self.xo = self.yo = self.zo = self.ao = self.bo = self.co = self.uo = self.vo = self.wo = 0
+        self.suppress = 0
+        self.g5x_index = 1
+        self.lineno = -1
+
+    def comment(self, arg): pass
+    def message(self, message): pass
+    def check_abort(self): pass
+    def next_line(self, st): self.lineno = st.sequence_number
+    def set_spindle_rate(self, arg): pass
+    def set_feed_rate(self, arg): self.feedrate = arg / 60.
+    def set_feed_mode(self, arg): pass
+    def set_traverse_rate(self, arg): pass
+    def select_plane(self, arg): pass
+    def change_tool(self, arg): self.first_move = True
+    def dwell(self, arg): pass
+    def user_defined_function(self, i, p, q): pass
+    def get_tool(self, pocket): return -1, 0,0,0, 0,0,0, 0,0,0, 0, 0,0, 0
+    def get_external_angular_units(self): return 1.0
+    def get_external_length_units(self): return 1.0
+    def get_axis_mask(self): return 7
+    def get_block_delete(self): return 0
+
+    def tool_offset(self, xo, yo, zo, ao, bo, co, uo, vo, wo):
+        self.first_move = True
+        self.xo, self.yo, self.zo = xo, yo, zo
+
+    def straight_traverse(self, x,y,z, a,b,c, u, v, w):
+        if self.suppress > 0: return
+        l = self.rotate_and_translate(x,y,z,a,b,c,u,v,w)
+        if not self.first_move:
+            self.traverse.append((self.lineno, self.lo, l))
+        self.lo = l
+
+    def straight_feed(self, x,y,z, a,b,c, u, v, w):
+        if self.suppress > 0: return
+        self.first_move = False
+        l = self.rotate_and_translate(x,y,z,a,b,c,u,v,w)
+        self.feed.append((self.lineno, self.lo, l, self.feedrate))
+        self.lo = l
+    straight_probe = straight_feed
+
+    def arc_feed(self, *args):
+        if self.suppress > 0: return
+        self.first_move = False
+        ArcsToSegmentsMixin.arc_feed(self, *args)
+
+    def straight_arcsegments(self, segs):
+        lo = self.lo
+        for l in segs:
+            self.arcfeed.append((self.lineno, lo, l, self.feedrate))
+            lo = l
+        self.lo = lo
+
+def parse(canon):
+    result, seq = gcode.parse(sys.argv[1], canon, "G20", "")
+    if result > gcode.MIN_ERROR:
+        print "parse failed:", gcode.strerror(result)
+        raise SystemExit, 1
+
+classic = Canon()
+parse(classic)
+canon = Canon()
+canon.preview_sink = gcode.previewsink()
+parse(canon)
+sink = canon.preview_sink
+
+def expected(name):
+    moves = getattr(classic, name.split("_")[0])
+    if name.endswith("_lines"):
+        return [m[0] for m in moves]
+    if name.endswith("_rates"):
+        return [m[3] for m in moves]
+    return [c for m in moves for c in tuple(m[1][:3]) + tuple(m[2][:3])]
+
+def same(values, wanted):
+    return len(values) == len(wanted) and \
+        all(abs(a - b) < 1e-5 for a, b in zip(values, wanted))
+
+for name in ("traverse", "traverse_lines", "feed", "feed_lines", "feed_rates",
+             "arcfeed", "arcfeed_lines", "arcfeed_rates"):
+    a = getattr(sink, name)
+    wanted = expected(name)
+    m = memoryview(a)
+    shape = m.shape
+    # the arc tessellation is the one of arc_to_segments, compare the
+    # number of segments with the python path rather than spelling it out
+    if name.startswith("arcfeed"):
+        if shape[0] == len(classic.arcfeed) and shape[0] > 0:
+            shape = ("n",) + shape[1:]
+    new = m.tobytes()
+    old = str(buffer(a))
+    values = struct.unpack("%d%s" % (len(new) / m.itemsize, m.format), new)
+    print "%-14s format %s itemsize %d ndim %d shape %s readonly %s" % (
+        name, m.format, m.itemsize, m.ndim, shape, m.readonly)
+    print "%-14s len %s, old buffer %s, contents %s" % (
+        name, "as shape" if len(a) == m.shape[0] else len(a),
+        "same" if old == new else "differs",
+        "same" if same(values, wanted) else "differ")
+    del m
+
+# the sink refuses to change its buffers while a view is held
+a = sink.feed
+try:
+    sink.clear()
+    print "clear with a previewarray: allowed"
+except BufferError:
+    print "clear with a previewarray: BufferError"
+del a
+sink.clear()
+print "clear without: feed has %d moves" % len(sink.feed_lines)
@@ -0,0 +1,2 @@
+#!/bin/sh
+python2 previewarray.py test.ngc
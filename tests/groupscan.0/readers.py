@@ -0,0 +1,44 @@
+# several readers of one group scanned by groupscan: each compiles the
+# group on its own and must see a member change exactly once, found by
+# the scanner and not by a scan of its own
+import subprocess
+import time
+from machinekit import hal
+
+readers = [hal.Group("watched") for i in range(3)]
+
+def wait_scans():
+    # two scans, so one started after the change
+    n = hal.pins["gs.scans"].get()
+    end = time.time() + 5.0
+    while hal.pins["gs.scans"].get() < n + 2 and time.time() < end:
+        time.sleep(0.01)
+
+def report(what):
+    print what
+    for i, r in enumerate(readers):
+        first = sorted(s.name for s in r.changed())
+        again = sorted(s.name for s in r.changed())
+        print "reader %d: %s, then %s" % (i, first, again)
+
+wait_scans()
+report("initial values")
+
+hal.signals["s-float"].set(2.5)
+wait_scans()
+report("s-float changed")
+
+hal.signals["s-s32"].set(-3)
+hal.signals["s-bit"].set(True)
+wait_scans()
+report("s-s32 and s-bit changed")
+
+# with the scanner out of its thread the readers see nothing new
+subprocess.call(["halcmd", "delf", "gs.funct", "scan"])
+hal.signals["s-s32"].set(7)
+time.sleep(0.1)
+report("s-s32 changed, scanner stopped")
+
+subprocess.call(["halcmd", "addf", "gs.funct", "scan"])
+wait_scans()
+report("scanner running again")
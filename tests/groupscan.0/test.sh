@@ -0,0 +1,6 @@
+#!/bin/sh
+realtime start
+halcmd -f scan.hal
+python2 readers.py
+halcmd stop
+realtime stop
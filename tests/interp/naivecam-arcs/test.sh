@@ -0,0 +1,9 @@
+#!/bin/bash
+# with [TRAJ]NAIVECAM_ARCS the naive cam detector of task's canon layer
+# joins lines on a circle into one arc, while lines off a straight line
+# by less than the G64 Q tolerance still become one line and a zigzag
+# stays as it is
+for prog in arc wobble zigzag; do
+    echo "$prog:"
+    timeout 60 rs274time -i test.ini $prog.ngc | grep "lines sent as" || exit 1
+done
@@ -0,0 +1,15 @@
+#!/bin/bash
+# the same program parsed without a cache, while the cache is built,
+# and read back from the cache must produce identical canon calls
+rm -rf cache && mkdir cache
+rs274 -g test.ngc > plain 2>&1
+rs274 -i test.ini -g test.ngc > cold 2>&1
+rs274 -i test.ini -g test.ngc > warm 2>&1
+ls cache | wc -l
+# below the size of one cache file only the one built last is kept
+rm -rf small && mkdir small
+sed 's/f600/f700/' test.ngc > other.ngc
+rs274 -i small.ini -g test.ngc > /dev/null 2>&1
+rs274 -i small.ini -g other.ngc > /dev/null 2>&1
+ls small | wc -l
+exit 0
@@ -0,0 +1,4 @@
+#!/bin/bash
+# rs274time must get through blocks which wait for the machine (M6,
+# G38.2) once each, without issuing their moves again
+timeout 60 rs274time -i test.ini test.ngc
@@ -0,0 +1,45 @@
+/*
+ * Minimal Modbus TCP slave for the mb2hal test.
+ * Serves one connection, counts the requests it answers and prints the
+ * count and the holding registers 20..23 when the client disconnects.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <modbus.h>
+
+int main(int argc, char **argv)
+{
+    modbus_t *ctx;
+    modbus_mapping_t *map;
+    uint8_t req[MODBUS_TCP_MAX_ADU_LENGTH];
+    int port = (argc > 1) ? atoi(argv[1]) : 1502;
+    int s, i, rc, requests = 0;
+
+    ctx = modbus_new_tcp("127.0.0.1", port);
+    map = modbus_mapping_new(0, 0, 100, 100);
+    if (ctx == NULL || map == NULL) {
+        return 1;
+    }
+    for (i = 0; i < 100; i++) {
+        map->tab_registers[i] = i * 3 + 1;
+        map->tab_input_registers[i] = 1000 + i;
+    }
+    s = modbus_tcp_listen(ctx, 1);
+    if (s < 0 || modbus_tcp_accept(ctx, &s) < 0) {
+        return 1;
+    }
+    while ((rc = modbus_receive(ctx, req)) >= 0) {
+        if (rc > 0 && modbus_reply(ctx, req, rc, map) >= 0) {
+            requests++;
+        }
+    }
+    printf("requests %d\n", requests);
+    for (i = 20; i < 24; i++) {
+        printf("reg%d %d\n", i, map->tab_registers[i]);
+    }
+    modbus_mapping_free(map);
+    modbus_close(ctx);
+    modbus_free(ctx);
+    return 0;
+}
@@ -0,0 +1,10 @@
+#!/bin/bash
+rm -f mb2hal_test_server server.out
+gcc -o mb2hal_test_server mb2hal_test_server.c \
+    $(pkg-config --cflags --libs libmodbus) || exit 1
+
+./mb2hal_test_server 15020 > server.out &
+sleep 0.5
+halrun -f test.hal || exit 1
+wait
+cat server.out
@@ -0,0 +1,364 @@
+/* SEQMEM with concurrent writers and readers, across the 32 bit wrap of
+ * its counters. The counters of a new buffer are moved to just below the
+ * wrap through the shared memory segment before anyone uses it.
+ *
+ * status: one writer process writes messages as fast as it can for
+ *	STATUS_TIME, then a last one, while two reader processes read in a
+ *	tight loop. Every word of message n holds n: a reader must never
+ *	get a torn copy, nor n going back. On a single cpu the readers are
+ *	only overtaken when they are preempted in the middle of a copy, the
+ *	run is long enough for that to happen many times.
+ *
+ * interrupted: the same, with a writer that is sure to overtake the
+ *	reader: a fast interval timer interrupts the reading process and
+ *	its handler writes two messages straight into the slots the way
+ *	SEQMEM does, so the copy the reader is in the middle of gets
+ *	overwritten. Those reads have to be retried, not returned torn.
+ *
+ * queue: QLEN=3, which the buffer rounds up, two writer processes queue
+ *	NQUEUE messages each, one reader drains them. Every message must
+ *	come out once, each writer's in order, none torn.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <sys/wait.h>
+
+#include "cms.hh"
+#include "cms_cfg.hh"
+#include "seqmem.hh"
+#include "timer.hh"
+
+#define MSG_SIZE 4096
+#define BUF_SIZE (MSG_SIZE + 1024)
+#define STATUS_TIME 1.0
+#define STATUS_LAST 0xffffffffffffULL
+#define NQUEUE 5000
+#define WRAP (0xffffffffU - 9)
+#define TIMEOUT 20.0
+#define TIMER_USEC 20
+
+static const int status_key = 7321;
+static const int queue_key = 7322;
+
+static CMS *open_buffer(int key, int queue, int cnum, int master)
+{
+    char bufline[CMS_CONFIG_LINELEN];
+    char procline[CMS_CONFIG_LINELEN];
+    CMS *cms = NULL;
+
+    snprintf(bufline, sizeof(bufline),
+	"B seqtest SEQMEM localhost %d 0 0 1 8 %d%s QLEN=3",
+	BUF_SIZE, key, queue ? " queue" : "");
+    snprintf(procline, sizeof(procline),
+	"P seqtest%d seqtest LOCAL localhost RW 0 10.0 %d %d",
+	cnum, master, cnum);
+    if (cms_create_from_lines(&cms, bufline, procline) < 0 || NULL == cms) {
+	fprintf(stderr, "seqmem_test: can't open the buffer\n");
+	exit(1);
+    }
+    return cms;
+}
+
+/* the control block of the buffer with the given key */
+static seqmem_block_t *attach(int key)
+{
+    int id = shmget(key, 0, 0);
+    char *addr;
+
+    if (id < 0 || (addr = (char *) shmat(id, NULL, 0)) == (char *) -1) {
+	perror("seqmem_test: shmat");
+	exit(1);
+    }
+    return (seqmem_block_t *) (addr + 32);
+}
+
+/* a segment left behind by a run that was killed is in the way */
+static void remove_stale(int key)
+{
+    int id = shmget(key, 0, 0);
+
+    if (id >= 0) {
+	shmctl(id, IPC_RMID, NULL);
+    }
+}
+
+static seqmem_slot_t *slot(seqmem_block_t * b, uint32_t n)
+{
+    long stride = (sizeof(seqmem_slot_t) + BUF_SIZE + 63) & ~63L;
+
+    return (seqmem_slot_t *) ((char *) b + sizeof(seqmem_block_t) +
+	(n % b->nslots) * stride);
+}
+
+static void fill(uint64_t * p, uint64_t v)
+{
+    for (int i = 0; i < MSG_SIZE / 8; i++) {
+	p[i] = v;
+    }
+}
+
+static int torn(const void *data)
+{
+    const uint64_t *p = (const uint64_t *) data;
+
+    for (int i = 1; i < MSG_SIZE / 8; i++) {
+	if (p[i] != p[0]) {
+	    return 1;
+	}
+    }
+    return 0;
+}
+
+static void status_writer(CMS * cms)
+{
+    uint64_t *buf = (uint64_t *) malloc(MSG_SIZE);
+    double end = etime() + STATUS_TIME;
+    uint64_t n = 1;
+
+    do {
+	fill(buf, etime() < end ? n++ : STATUS_LAST);
+	cms->header.in_buffer_size = MSG_SIZE;
+	if (cms->write(buf) < 0) {
+	    fprintf(stderr, "seqmem_test: status write failed\n");
+	    exit(1);
+	}
+    } while (buf[0] != STATUS_LAST);
+    free(buf);
+}
+
+/* exit code: bit 0 torn, bit 1 backwards, bit 2 never got the last */
+static int status_reader(CMS * cms)
+{
+    double end = etime() + TIMEOUT;
+    uint64_t last = 0, n;
+    int r = 0;
+
+    while (last != STATUS_LAST && etime() < end) {
+	if (cms->read() != CMS_READ_OK) {
+	    continue;
+	}
+	if (torn(cms->subdiv_data)) {
+	    r |= 1;
+	    continue;
+	}
+	n = *(uint64_t *) cms->subdiv_data;
+	if (n < last) {
+	    r |= 2;
+	}
+	last = n;
+    }
+    if (last != STATUS_LAST) {
+	r |= 4;
+    }
+    return r;
+}
+
+static void queue_writer(CMS * cms, uint64_t w)
+{
+    uint64_t *buf = (uint64_t *) malloc(MSG_SIZE);
+    double end = etime() + TIMEOUT;
+
+    for (uint64_t n = 1; n <= NQUEUE && etime() < end;) {
+	fill(buf, w << 32 | n);
+	cms->header.in_buffer_size = MSG_SIZE;
+	if (cms->write(buf) == CMS_QUEUE_FULL) {
+	    sched_yield();
+	    continue;
+	}
+	n++;
+    }
+    free(buf);
+}
+
+static void queue_reader(CMS * cms)
+{
+    double end = etime() + TIMEOUT;
+    uint64_t next[3] = { 0, 1, 1 }, v, w, n;
+    long got = 0, bad_torn = 0, lost = 0, order = 0;
+
+    while (got < 2 * NQUEUE && etime() < end) {
+	if (cms->read() != CMS_READ_OK) {
+	    sched_yield();
+	    continue;
+	}
+	got++;
+	if (torn(cms->subdiv_data)) {
+	    bad_torn++;
+	    continue;
+	}
+	v = *(uint64_t *) cms->subdiv_data;
+	w = v >> 32;
+	n = v & 0xffffffff;
+	if (w < 1 || w > 2 || n < next[w]) {
+	    order++;
+	    continue;
+	}
+	lost += n - next[w];
+	next[w] = n + 1;
+    }
+    lost += (NQUEUE + 1 - next[1]) + (NQUEUE + 1 - next[2]);
+    printf("queue: received %ld, lost %ld, out of order %ld, torn %ld\n",
+	got, lost, order, bad_torn);
+}
+
+static void status_test()
+{
+    remove_stale(status_key);
+    CMS *master = open_buffer(status_key, 0, 0, 1);
+    seqmem_block_t *b = attach(status_key);
+    int status, bad = 0, i;
+    pid_t pid;
+
+    /* the current message is the one in slot seq / 2 */
+    b->seq = WRAP & ~1U;
+    fflush(stdout);
+    for (i = 0; i < 3; i++) {
+	if ((pid = fork()) == 0) {
+	    CMS *cms = open_buffer(status_key, 0, i + 1, 0);
+	    int r = 0;
+
+	    if (i == 0) {
+		status_writer(cms);
+	    } else {
+		r = status_reader(cms);
+	    }
+	    delete cms;
+	    _exit(r);
+	}
+    }
+    while (wait(&status) > 0) {
+	bad |= WEXITSTATUS(status);
+    }
+    printf("status: seq wrapped %s, torn %s, backwards %s, last message %s\n",
+	b->seq < (WRAP & ~1U) ? "yes" : "no",
+	bad & 1 ? "yes" : "no", bad & 2 ? "yes" : "no",
+	bad & 4 ? "missed" : "read");
+    shmdt((char *) b - 32);
+    delete master;
+}
+
+static seqmem_block_t *timer_block;
+static uint64_t timer_n;
+
+/* two writes, as SEQMEM::buffer_write() does them */
+static void timer_writer(int sig)
+{
+    uint32_t s = __atomic_load_n(&timer_block->seq, __ATOMIC_RELAXED);
+    char *cur, *next;
+    CMS_HEADER *h;
+
+    for (int i = 0; i < 2; i++, s += 2) {
+	__atomic_store_n(&timer_block->seq, s + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	cur = (char *) (slot(timer_block, s >> 1) + 1);
+	next = (char *) (slot(timer_block, (s >> 1) + 1) + 1);
+	memcpy(next, cur, sizeof(CMS_HEADER));
+	h = (CMS_HEADER *) next;
+	h->write_id++;
+	fill((uint64_t *) (next + sizeof(CMS_HEADER)), ++timer_n);
+	__atomic_store_n(&timer_block->seq, s + 2, __ATOMIC_RELEASE);
+    }
+}
+
+static void interrupted_test()
+{
+    remove_stale(status_key);
+    CMS *master = open_buffer(status_key, 0, 0, 1);
+    CMS *cms = open_buffer(status_key, 0, 1, 0);
+    uint64_t *buf = (uint64_t *) malloc(MSG_SIZE);
+    struct itimerval it = { {0, TIMER_USEC}, {0, TIMER_USEC} };
+    struct itimerval off = { {0, 0}, {0, 0} };
+    struct sigaction sa;
+    double end;
+    long reads = 0, bad_torn = 0;
+
+    timer_block = attach(status_key);
+    timer_block->seq = WRAP & ~1U;
+    timer_n = 1;
+    fill(buf, timer_n);
+    cms->header.in_buffer_size = MSG_SIZE;
+    cms->write(buf);
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = timer_writer;
+    sa.sa_flags = SA_RESTART;
+    sigaction(SIGALRM, &sa, NULL);
+    setitimer(ITIMER_REAL, &it, NULL);
+    end = etime() + STATUS_TIME;
+    while (etime() < end) {
+	if (cms->read() != CMS_READ_OK) {
+	    continue;
+	}
+	reads++;
+	if (torn(cms->subdiv_data)) {
+	    bad_torn++;
+	}
+    }
+    setitimer(ITIMER_REAL, &off, NULL);
+    signal(SIGALRM, SIG_DFL);
+    /* the timer was the one of alarm() */
+    alarm(120);
+    printf("interrupted: seq wrapped %s, read %s, torn %s\n",
+	timer_block->seq < (WRAP & ~1U) ? "yes" : "no",
+	reads > 0 ? "yes" : "no", bad_torn ? "yes" : "no");
+    free(buf);
+    shmdt((char *) timer_block - 32);
+    delete cms;
+    delete master;
+}
+
+static void queue_test()
+{
+    remove_stale(queue_key);
+    CMS *master = open_buffer(queue_key, 1, 0, 1);
+    seqmem_block_t *b = attach(queue_key);
+    uint32_t k;
+    int i;
+    pid_t pid;
+
+    printf("queue: %u slots\n", b->nslots);
+    /* an empty queue at position WRAP: slot n is free for the writer at
+       position n */
+    for (k = 0; k < b->nslots; k++) {
+	slot(b, WRAP + k)->seq = WRAP + k;
+    }
+    b->head = b->tail = WRAP;
+    fflush(stdout);
+    for (i = 0; i < 2; i++) {
+	if ((pid = fork()) == 0) {
+	    CMS *cms = open_buffer(queue_key, 1, i + 1, 0);
+
+	    queue_writer(cms, i + 1);
+	    delete cms;
+	    _exit(0);
+	}
+    }
+    queue_reader(master);
+    while (wait(NULL) > 0);
+    printf("queue: head and tail wrapped %s\n",
+	b->head < WRAP && b->tail < WRAP ? "yes" : "no");
+    shmdt((char *) b - 32);
+    delete master;
+}
+
+int main()
+{
+    /* full is expected, the writers retry */
+    cms_print_queue_full_messages = 0;
+    /* a lost slot can leave a reader spinning, fail instead */
+    alarm(120);
+    status_test();
+    interrupted_test();
+    queue_test();
+    return 0;
+}
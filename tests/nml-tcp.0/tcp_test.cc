@@ -0,0 +1,325 @@
+/* The epoll based NML TCP server with several clients at once.
+ *
+ * A server process serves one SHMEM buffer over TCP. A remote writer
+ * writes RUN_TIME worth of numbered messages, a few kilobytes each so
+ * that the server gets them in pieces, then a last one. At the same
+ * time there are
+ *
+ *	poll: clients reading with read()
+ *	blk:  clients reading with blocking_read()
+ *	sub:  clients with a polled subscription every SUB_TIME
+ *
+ * and a raw socket that sends the first bytes of a request header and
+ * nothing more until the end. Every client must see the message number
+ * go up only, get each message intact and get the last one. A
+ * subscription gets at most one update per interval. The half sent
+ * request must not hold up anyone else.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "nml.hh"
+#include "nmlmsg.hh"
+#include "nml_srv.hh"
+#include "cms.hh"
+#include "rcs_print.hh"
+#include "timer.hh"
+
+#define TEST_MSG_TYPE 1001
+#define PAYLOAD 8192
+#define LAST_SEQ 0x7fffffff
+#define RUN_TIME 2.0
+#define WRITE_HZ 100.0
+#define SUB_TIME 0.1
+#define TIMEOUT 20.0
+#define NPOLL 3
+#define NBLK 3
+#define NSUB 2
+
+static const int port = 5199;
+static const int key = 7211;
+
+class TEST_MSG:public NMLmsg {
+  public:
+    TEST_MSG():NMLmsg(TEST_MSG_TYPE, sizeof(TEST_MSG)) {
+    };
+    void update(CMS * cms);
+    int seq;
+    int payload_length;
+    char payload[PAYLOAD];
+};
+
+void TEST_MSG::update(CMS * cms)
+{
+    cms->update(seq);
+    cms->update(payload_length);
+    cms->update(payload, payload_length);
+}
+
+static int test_format(NMLTYPE type, void *buffer, CMS * cms)
+{
+    switch (type) {
+    case TEST_MSG_TYPE:
+	((TEST_MSG *) buffer)->update(cms);
+	break;
+
+    default:
+	return 0;
+    }
+    return 1;
+}
+
+static char cfg[64];
+static pid_t children[NPOLL + NBLK + NSUB + 3];
+static int nchildren;
+
+static void write_config(void)
+{
+    FILE *f;
+    int fd;
+
+    strcpy(cfg, "/tmp/nml-tcp-test.XXXXXX");
+    fd = mkstemp(cfg);
+    if (fd < 0 || NULL == (f = fdopen(fd, "w"))) {
+	perror(cfg);
+	exit(1);
+    }
+    fprintf(f, "B test SHMEM localhost %d 0 0 1 32 %d TCP=%d xdr\n",
+	PAYLOAD + 1024, key, port);
+    fprintf(f, "P srv test LOCAL localhost RW 1 1.0 1 0\n");
+    fprintf(f, "P wr test REMOTE localhost W 0 5.0 0 1\n");
+    fprintf(f, "P poll test REMOTE localhost R 0 5.0 0 2\n");
+    fprintf(f, "P blk test REMOTE localhost R 0 5.0 0 3\n");
+    fprintf(f, "P sub test REMOTE localhost R 0 5.0 0 4 sub=%g\n",
+	SUB_TIME);
+    fclose(f);
+}
+
+static NML *open_channel(const char *proc)
+{
+    NML *nml;
+    double start = etime();
+
+    /* the server may still be starting */
+    while (etime() - start < 5.0) {
+	nml = new NML(test_format, "test", proc, cfg);
+	if (nml->valid()) {
+	    return nml;
+	}
+	delete nml;
+	esleep(0.05);
+    }
+    fprintf(stderr, "tcp_test: %s can't connect\n", proc);
+    exit(1);
+}
+
+static void fill(TEST_MSG * msg, int seq)
+{
+    msg->seq = seq;
+    memset(msg->payload, 'a' + seq % 26, PAYLOAD);
+    msg->payload_length = PAYLOAD;
+}
+
+static int intact(TEST_MSG * msg)
+{
+    if (msg->payload_length != PAYLOAD) {
+	return 0;
+    }
+    for (int i = 0; i < PAYLOAD; i++) {
+	if (msg->payload[i] != 'a' + msg->seq % 26) {
+	    return 0;
+	}
+    }
+    return 1;
+}
+
+static void writer(void)
+{
+    NML *nml = open_channel("wr");
+    TEST_MSG *msg = new TEST_MSG();
+    double end = etime() + RUN_TIME;
+    int seq = 1;
+
+    do {
+	fill(msg, etime() < end ? seq++ : LAST_SEQ);
+	if (nml->write(msg) < 0) {
+	    fprintf(stderr, "tcp_test: write failed\n");
+	    _exit(1);
+	}
+	esleep(1.0 / WRITE_HZ);
+    } while (msg->seq != LAST_SEQ);
+    delete msg;
+    delete nml;
+}
+
+/* exit code: bit 0 torn, bit 1 backwards, bit 2 never got the last,
+   bit 3 more than one update per subscription interval */
+static int client(const char *mode)
+{
+    NML *nml = open_channel(mode);
+    TEST_MSG *msg;
+    double start = etime(), end = start + TIMEOUT;
+    int last = 0, updates = 0, r = 0;
+    NMLTYPE type;
+
+    while (last != LAST_SEQ && etime() < end) {
+	if (!strcmp(mode, "blk")) {
+	    type = nml->blocking_read(0.1);
+	} else {
+	    type = nml->read();
+	    esleep(0.005);
+	}
+	if (type != TEST_MSG_TYPE) {
+	    continue;
+	}
+	msg = (TEST_MSG *) nml->get_address();
+	if (msg->seq == last) {
+	    continue;
+	}
+	if (!intact(msg)) {
+	    r |= 1;
+	}
+	if (msg->seq < last) {
+	    r |= 2;
+	}
+	last = msg->seq;
+	updates++;
+    }
+    if (last != LAST_SEQ) {
+	r |= 4;
+    }
+    /* one for the message already there when subscribing */
+    if (!strcmp(mode, "sub") &&
+	updates > (etime() - start) / SUB_TIME + 2) {
+	r |= 8;
+    }
+    delete nml;
+    return r;
+}
+
+/* the first bytes of a request, then nothing until it is killed */
+static void stalled(void)
+{
+    struct sockaddr_in addr;
+    char partial[8];
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (fd < 0 || connect(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+	perror("tcp_test: connect");
+	_exit(1);
+    }
+    memset(partial, 0, sizeof(partial));
+    if (write(fd, partial, sizeof(partial)) != sizeof(partial)) {
+	perror("tcp_test: write");
+    }
+    pause();
+}
+
+static void timed_out(int sig)
+{
+    static const char msg[] = "tcp_test: timed out\n";
+
+    if (write(2, msg, sizeof(msg) - 1) < 0) {
+	/* nothing left to do about it */
+    }
+    /* the server and the clients too */
+    for (int i = 0; i < nchildren; i++) {
+	kill(children[i], SIGKILL);
+    }
+    _exit(1);
+}
+
+static pid_t start(int what, const char *mode)
+{
+    pid_t pid = fork();
+
+    if (pid == 0) {
+	int r = 0;
+
+	switch (what) {
+	case 0:
+	    writer();
+	    break;
+	case 1:
+	    r = client(mode);
+	    break;
+	default:
+	    stalled();
+	}
+	_exit(r);
+    }
+    children[nchildren++] = pid;
+    return pid;
+}
+
+int main()
+{
+    const char *modes[] = { "poll", "blk", "sub" };
+    int counts[] = { NPOLL, NBLK, NSUB };
+    pid_t server, stall, pids[NPOLL + NBLK + NSUB];
+    int bad[3] = { 0, 0, 0 }, status, i, k, n = 0;
+
+    set_rcs_print_destination(RCS_PRINT_TO_NULL);
+    /* a stuck server would leave the clients waiting, fail instead */
+    signal(SIGALRM, timed_out);
+    alarm(60);
+    write_config();
+    fflush(stdout);
+
+    server = fork();
+    if (server == 0) {
+	NML *nml = new NML(test_format, "test", "srv", cfg);
+
+	if (!nml->valid()) {
+	    _exit(1);
+	}
+	run_nml_servers();
+	_exit(0);
+    }
+    children[nchildren++] = server;
+    esleep(0.5);
+
+    stall = start(2, NULL);
+    esleep(0.1);
+    for (i = 0; i < 3; i++) {
+	for (k = 0; k < counts[i]; k++) {
+	    pids[n++] = start(1, modes[i]);
+	}
+    }
+    start(0, NULL);
+
+    n = 0;
+    for (i = 0; i < 3; i++) {
+	for (k = 0; k < counts[i]; k++) {
+	    waitpid(pids[n++], &status, 0);
+	    bad[i] |= WIFEXITED(status) ? WEXITSTATUS(status) : 16;
+	}
+	printf("%-4s %d clients: torn %s, backwards %s, last message %s",
+	    modes[i], counts[i], bad[i] & 1 ? "yes" : "no",
+	    bad[i] & 2 ? "yes" : "no", bad[i] & 4 ? "missed" : "read");
+	if (i == 2) {
+	    printf(", updates %s", bad[i] & 8 ? "too often" : "per interval");
+	}
+	printf("%s\n", bad[i] & 16 ? ", crashed" : "");
+    }
+
+    kill(stall, SIGTERM);
+    kill(server, SIGTERM);
+    while (wait(NULL) > 0);
+    unlink(cfg);
+    return 0;
+}
@@ -0,0 +1,12 @@
+#!/bin/sh
+rm -f tcp_test
+set -e
+SRC=../../src
+g++ -O2 -I$SRC -I$SRC/rtapi -I/usr/include/tirpc \
+    -I$SRC/libnml/cms -I$SRC/libnml/buffer -I$SRC/libnml/nml \
+    -I$SRC/libnml/rcs -I$SRC/libnml/os_intf -I$SRC/libnml/linklist \
+    -I$SRC/libnml/posemath -I$SRC/libnml/inifile \
+    tcp_test.cc \
+    ../../lib/libnml.so.0 ../../lib/librtapi_math.so.0 \
+    -o tcp_test
+./tcp_test
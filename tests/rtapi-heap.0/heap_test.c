@@ -0,0 +1,146 @@
+/* The size class front end of rtapi_heap.c, on an arena of its own.
+ *
+ * classes: requests of up to RTAPI_SLAB_CLASSES units come from the size
+ *	classes, one byte more goes to the arena.
+ * reclaim: freed class blocks stay cached in their chunks until the
+ *	arena runs dry, then the idle chunks go back to it.
+ * fallback: with no room left for a whole chunk a small request is still
+ *	served from the arena, and with RTAPIHEAP_NOSLAB every one is.
+ * fragmentation: big and small blocks allocated in turn, then the big
+ *	ones freed. With the classes the small ones sit together in a chunk,
+ *	without them they cut the free arena into pieces.
+ */
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+
+#include "rtapi.h"
+#include "rtapi_heap.h"
+#include "rtapi_heap_private.h"
+
+#define ARENA 65536
+#define UNIT sizeof(rtapi_malloc_hdr_t)
+#define NFRAG 16
+
+static struct {
+    struct rtapi_heap heap;
+    rtapi_malloc_hdr_t arena[ARENA / sizeof(rtapi_malloc_hdr_t)];
+} mem;
+
+static struct rtapi_heap *h = &mem.heap;
+
+/* the messages of rtapi_heap.c, there is no message ring here */
+int vs_ringlogfv(const msg_level_t level, const int pid,
+		 const msg_origin_t origin, const char *tag,
+		 const char *format, va_list ap)
+{
+    return vfprintf(stderr, format, ap);
+}
+
+static void init(int flags)
+{
+    memset(&mem, 0, sizeof(mem));
+    _rtapi_heap_init(h, "heap_test");
+    _rtapi_heap_setflags(h, flags);
+    _rtapi_heap_addmem(h, mem.arena, sizeof(mem.arena));
+}
+
+static struct rtapi_heap_stat status(void)
+{
+    struct rtapi_heap_stat hs;
+
+    _rtapi_heap_status(h, &hs);
+    return hs;
+}
+
+static void classes(void)
+{
+    size_t sizes[] = { 1, UNIT, UNIT + 1, RTAPI_SLAB_CLASSES * UNIT - 1,
+	RTAPI_SLAB_CLASSES * UNIT, RTAPI_SLAB_CLASSES * UNIT + 1, 1000 };
+    int n = sizeof(sizes) / sizeof(sizes[0]), i;
+    struct rtapi_heap_stat before, after;
+    void *p[n];
+
+    init(0);
+    for (i = 0; i < n; i++) {
+	before = status();
+	p[i] = _rtapi_malloc(h, sizes[i]);
+	after = status();
+	printf("classes: %4zu bytes from the %s, %zu usable\n", sizes[i],
+	    after.slab_inuse > before.slab_inuse ? "classes" : "arena",
+	    p[i] ? _rtapi_allocsize(h, p[i]) : 0);
+    }
+    for (i = 0; i < n; i++) {
+	_rtapi_free(h, p[i]);
+    }
+    after = status();
+    printf("classes: all freed, in use %zu, cached %s, %zu chunks\n",
+	after.slab_inuse, after.slab_cached ? "yes" : "no",
+	after.slab_chunks);
+
+    /* only fits once the chunks are back */
+    p[0] = _rtapi_malloc(h, ARENA - UNIT);
+    after = status();
+    printf("reclaim: whole arena allocated %s, %zu chunks, %zu cached\n",
+	p[0] ? "yes" : "no", after.slab_chunks, after.slab_cached);
+}
+
+static void fallback(void)
+{
+    struct rtapi_heap_stat hs;
+    void *p, *q;
+
+    init(0);
+    /* leaves 8 units, a chunk needs about RTAPI_SLAB_CHUNK bytes */
+    p = _rtapi_malloc(h, ARENA - 9 * UNIT);
+    q = _rtapi_malloc(h, 2 * UNIT);
+    hs = status();
+    printf("fallback: %zu bytes with %zu free: %s, %zu chunks, "
+	"%zu in classes\n", 2 * UNIT, 8 * UNIT, q ? "allocated" : "failed",
+	hs.slab_chunks, hs.slab_inuse);
+    _rtapi_free(h, q);
+    _rtapi_free(h, p);
+
+    init(RTAPIHEAP_NOSLAB);
+    q = _rtapi_malloc(h, 2 * UNIT);
+    hs = status();
+    printf("fallback: RTAPIHEAP_NOSLAB: %s, %zu chunks, %zu in classes\n",
+	q ? "allocated" : "failed", hs.slab_chunks, hs.slab_inuse);
+}
+
+static void fragmentation(int flags)
+{
+    struct rtapi_heap_stat hs;
+    void *big[NFRAG], *small[NFRAG];
+    int i;
+
+    init(flags);
+    for (i = 0; i < NFRAG; i++) {
+	big[i] = _rtapi_malloc(h, 512);
+	small[i] = _rtapi_malloc(h, 24);
+    }
+    for (i = 0; i < NFRAG; i++) {
+	_rtapi_free(h, big[i]);
+    }
+    hs = status();
+    printf("fragmentation: %s: %zu fragments, %zu free, largest %zu, %zu%%\n",
+	flags & RTAPIHEAP_NOSLAB ? "arena only" : "classes",
+	hs.fragments, hs.total_avail, hs.largest, hs.fragmentation);
+    for (i = 0; i < NFRAG; i++) {
+	_rtapi_free(h, small[i]);
+    }
+    hs = status();
+    printf("fragmentation: %s: all freed, %zu in use\n",
+	flags & RTAPIHEAP_NOSLAB ? "arena only" : "classes",
+	hs.allocated - hs.freed);
+}
+
+int main()
+{
+    classes();
+    fallback();
+    fragmentation(0);
+    fragmentation(RTAPIHEAP_NOSLAB);
+    return 0;
+}
@@ -0,0 +1,8 @@
+#!/bin/sh
+rm -f heap_test
+set -e
+SRC=../../src
+gcc -O2 -DULAPI -I$SRC -I$SRC/rtapi \
+    heap_test.c $SRC/rtapi/rtapi_heap.c \
+    -o heap_test
+./heap_test
@@ -0,0 +1,56 @@
+#!/usr/bin/python2
+'''Run each of the given programs and append its run time to a results file.
+
+    usage: compare_jerk.py <results file> <label> <program.ngc> ...
+
+The time is measured from the program start until the interpreter is done,
+with the 0.25 s resolution of wait_on_program, so use longer programs.
+Nothing is asserted here, the acceleration and jerk limits are checked by
+tests/trajectory-planner/jerk.
+'''
+
+import linuxcnc
+from linuxcnc_control import  LinuxcncControl
+import hal
+
+from time import sleep, time
+import sys
+import os
+
+if len(sys.argv) < 4:
+    print "usage: compare_jerk.py <results file> <label> <program.ngc> ..."
+    sys.exit(1)
+
+results = sys.argv[1]
+label = sys.argv[2]
+
+#Hack to make this wait while LCNC loads
+sleep(3)
+
+h = hal.component("python-ui")
+h.ready() # mark the component as 'ready'
+
+e = LinuxcncControl(1)
+e.g_raise_except = False
+e.set_mode(linuxcnc.MODE_MANUAL)
+e.set_state(linuxcnc.STATE_ESTOP_RESET)
+e.set_state(linuxcnc.STATE_ON)
+e.do_home(-1)
+sleep(1)
+e.set_mode(linuxcnc.MODE_AUTO)
+
+out = open(results, 'a')
+for f in sys.argv[3:]:
+    e.open_program(os.path.abspath(f))
+    start = time()
+    e.run_full_program()
+    if not e.wait_on_program():
+        print "Program {0} failed to complete!".format(f)
+        sys.exit(1)
+    elapsed = time() - start
+    print "{0} {1} {2:.2f}".format(label, f, elapsed)
+    out.write("{0} {1} {2:.2f}\n".format(label, f, elapsed))
+    out.flush()
+out.close()
+
+# Leave LinuxCNC running, the calling script shuts it down
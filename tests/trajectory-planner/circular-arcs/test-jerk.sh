@@ -0,0 +1,35 @@
+#!/bin/bash
+# Compare the run time of programs with trapezoidal acceleration
+# (XYZ_fast.ini) and with the jerk limited S-curve (XYZ_jerk.ini, same
+# machine with MAX_JERK set on X, Y and Z). This is a manual timing
+# comparison, it doesn't check the limits, tests/trajectory-planner/jerk
+# does that.
+#
+# usage: ./test-jerk.sh [program.ngc ...]
+# defaults to the programs in nc_files/performance
+set -o monitor
+
+if [ $# -gt 0 ]
+then
+    FILES="$@"
+else
+    FILES=`ls nc_files/performance/*.ngc`
+fi
+
+RESULTS=jerk_results.txt
+rm -f $RESULTS
+
+for INI in configs/XYZ_fast.ini configs/XYZ_jerk.ini
+do
+    LABEL=`basename $INI .ini`
+    cp position.blank configs/position.txt
+    linuxcnc $INI > test-$LABEL.log &
+    python2 compare_jerk.py $RESULTS $LABEL $FILES
+    kill -INT %1
+    wait
+done
+
+# One line per program: trapezoidal time, S-curve time, ratio
+awk '$1 == "XYZ_fast" { t[$2] = $3 }
+     $1 == "XYZ_jerk" && ($2 in t) {
+         printf "%-50s %8.2f %8.2f %6.3f\n", $2, t[$2], $3, $3 / t[$2] }' $RESULTS
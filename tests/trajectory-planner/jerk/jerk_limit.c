@@ -0,0 +1,277 @@
+/* runs a short program through the tp with MAX_JERK set and checks that
+ * no axis goes above its acceleration or jerk limit. Acceleration and jerk
+ * are the finite differences of the commanded position, cycle by cycle,
+ * so steps in the normal acceleration where lines run into arcs count too.
+ */
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+
+#include "rtapi.h"
+#include "tp.h"
+#include "tp_private.h"
+#include "tp_shared.h"
+#include "tcq.h"
+
+#define QUEUE_SIZE 32
+#define PERIOD 1000000		// nsec
+#define AXES 4			// X Y Z A
+// slack for the discrete steps of the profile
+#define TOLERANCE 1.02
+
+static struct {
+    hal_s32_t num_dio;
+    hal_s32_t num_aio;
+    hal_s32_t arcBlendGapCycles;
+    hal_s32_t arcBlendOptDepth;
+    hal_bit_t arcBlendEnable;
+    hal_bit_t arcBlendFallbackEnable;
+    hal_float_t arcBlendRampFreq;
+    hal_float_t arcBlendTangentKinkRatio;
+    hal_float_t maxFeedScale;
+    hal_float_t net_feed_scale;
+    hal_float_t acc_limit[3];
+    hal_float_t jerk_limit[9];
+    hal_float_t vel_limit[3];
+    hal_bit_t stepping;
+    hal_u32_t enables_new;
+    hal_u32_t enables_queued;
+    hal_u32_t tcqlen;
+    hal_s32_t spindle_direction;
+    hal_float_t spindleRevs;
+    hal_float_t spindleSpeedIn;
+    hal_float_t spindle_speed;
+    hal_bit_t spindle_index_enable;
+    hal_bit_t spindle_is_atspeed;
+    hal_bit_t spindleSync;
+    hal_float_t current_vel;
+    hal_float_t requested_vel;
+    hal_float_t distance_to_go;
+    EmcPose dtg;
+} mot;
+
+static TP_STRUCT tp;
+static tp_shared_t tps;
+static TC_STRUCT tcSpace[QUEUE_SIZE];
+
+static const char *axis_name[AXES] = { "X", "Y", "Z", "A" };
+static const double acc_limit[AXES] = { 1000.0, 1000.0, 1000.0, 2000.0 };
+static const double jerk_limit[AXES] = { 20000.0, 10000.0, 20000.0, 50000.0 };
+
+// the last three positions and the last acceleration of each axis
+static double pos[3][AXES];
+static double last_acc[AXES];
+static double max_acc[AXES];
+static double max_jerk[AXES];
+static long cycles;
+
+void rtapi_print_msg(int level, const char *fmt, ...)
+{
+    va_list ap;
+
+    if (level > RTAPI_MSG_ERR)
+	return;
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+}
+
+static void testDioWrite(unsigned int index, hal_bit_t value) {}
+static void testAioWrite(unsigned int index, hal_float_t value) {}
+static void testSetRotaryUnlock(int axis, hal_bit_t unlock) {}
+static hal_bit_t testGetRotaryIsUnlocked(int axis) { return 1; }
+
+static void setup(int term_cond, double tolerance)
+{
+    int i;
+
+    memset(&tp, 0, sizeof(tp));
+    memset(pos, 0, sizeof(pos));
+    memset(last_acc, 0, sizeof(last_acc));
+    memset(max_acc, 0, sizeof(max_acc));
+    memset(max_jerk, 0, sizeof(max_jerk));
+    cycles = 0;
+    tps.num_dio = &mot.num_dio;
+    tps.num_aio = &mot.num_aio;
+    tps.arcBlendGapCycles = &mot.arcBlendGapCycles;
+    tps.arcBlendOptDepth = &mot.arcBlendOptDepth;
+    tps.arcBlendEnable = &mot.arcBlendEnable;
+    tps.arcBlendRampFreq = &mot.arcBlendRampFreq;
+    tps.arcBlendTangentKinkRatio = &mot.arcBlendTangentKinkRatio;
+    tps.arcBlendFallbackEnable = &mot.arcBlendFallbackEnable;
+    tps.maxFeedScale = &mot.maxFeedScale;
+    tps.net_feed_scale = &mot.net_feed_scale;
+    tps.spindle_direction = &mot.spindle_direction;
+    tps.spindle_speed = &mot.spindle_speed;
+    tps.spindleRevs = &mot.spindleRevs;
+    tps.spindleSpeedIn = &mot.spindleSpeedIn;
+    tps.spindle_index_enable = &mot.spindle_index_enable;
+    tps.spindle_is_atspeed = &mot.spindle_is_atspeed;
+    tps.spindleSync = &mot.spindleSync;
+    tps.current_vel = &mot.current_vel;
+    tps.requested_vel = &mot.requested_vel;
+    tps.distance_to_go = &mot.distance_to_go;
+    tps.enables_new = &mot.enables_new;
+    tps.enables_queued = &mot.enables_queued;
+    tps.tcqlen = &mot.tcqlen;
+    tps.dtg[0] = &mot.dtg.tran.x;
+    tps.dtg[1] = &mot.dtg.tran.y;
+    tps.dtg[2] = &mot.dtg.tran.z;
+    tps.dtg[3] = &mot.dtg.a;
+    tps.dtg[4] = &mot.dtg.b;
+    tps.dtg[5] = &mot.dtg.c;
+    tps.dtg[6] = &mot.dtg.u;
+    tps.dtg[7] = &mot.dtg.v;
+    tps.dtg[8] = &mot.dtg.w;
+    for (i = 0; i < 3; i++) {
+	mot.acc_limit[i] = acc_limit[i];
+	mot.vel_limit[i] = 100.0;
+	tps.acc_limit[i] = &mot.acc_limit[i];
+	tps.vel_limit[i] = &mot.vel_limit[i];
+    }
+    for (i = 0; i < 9; i++) {
+	mot.jerk_limit[i] = i < AXES ? jerk_limit[i] : 0.0;
+	tps.jerk_limit[i] = &mot.jerk_limit[i];
+    }
+    tps.stepping = &mot.stepping;
+    tps.dioWrite = testDioWrite;
+    tps.aioWrite = testAioWrite;
+    tps.SetRotaryUnlock = testSetRotaryUnlock;
+    tps.GetRotaryIsUnlocked = testGetRotaryIsUnlocked;
+    mot.arcBlendEnable = 1;
+    mot.arcBlendFallbackEnable = 0;
+    mot.arcBlendOptDepth = 50;
+    mot.arcBlendGapCycles = 4;
+    mot.arcBlendRampFreq = 100.0;
+    mot.arcBlendTangentKinkRatio = 0.1;
+    mot.maxFeedScale = 1.0;
+    mot.net_feed_scale = 1.0;
+    mot.spindle_is_atspeed = 1;
+
+    assert(tpCreate(&tp, QUEUE_SIZE, tcSpace, &tps) == 0);
+    assert(tpSetCycleTime(&tp, PERIOD * 1e-9) == 0);
+    tpSetVmax(&tp, 100.0, 100.0);
+    tpSetVlimit(&tp, 100.0);
+    tpSetAmax(&tp, 1000.0);
+    tpSetTermCond(&tp, term_cond, tolerance);
+}
+
+static EmcPose pose(double x, double y, double z, double a)
+{
+    EmcPose p;
+
+    memset(&p, 0, sizeof(p));
+    p.tran.x = x;
+    p.tran.y = y;
+    p.tran.z = z;
+    p.a = a;
+    return p;
+}
+
+static void line(double x, double y, double z, double a)
+{
+    struct state_tag_t tag;
+
+    memset(&tag, 0, sizeof(tag));
+    tpSetId(&tp, tp.nextId + 1);
+    assert(tpAddLine(&tp, pose(x, y, z, a), 2, 50.0, 100.0, 1000.0,
+		     0, 0, -1, tag) == 0);
+}
+
+static void arc(double x, double y, double cx, double cy)
+{
+    struct state_tag_t tag;
+    PmCartesian center = { cx, cy, 0.0 };
+    PmCartesian normal = { 0.0, 0.0, 1.0 };
+
+    memset(&tag, 0, sizeof(tag));
+    tpSetId(&tp, tp.nextId + 1);
+    assert(tpAddCircle(&tp, pose(x, y, 0.0, 0.0), center, normal, 0, 2,
+		       50.0, 100.0, 1000.0, 0, 0, tag) == 0);
+}
+
+static void sample(void)
+{
+    EmcPose p;
+    double dt = PERIOD * 1e-9;
+    int i;
+
+    tpGetPos(&tp, &p);
+    memmove(pos[1], pos[0], sizeof(pos[0]) * 2);
+    pos[0][0] = p.tran.x;
+    pos[0][1] = p.tran.y;
+    pos[0][2] = p.tran.z;
+    pos[0][3] = p.a;
+    cycles++;
+    if (cycles < 3)
+	return;
+    for (i = 0; i < AXES; i++) {
+	double acc = (pos[0][i] - 2.0 * pos[1][i] + pos[2][i]) / (dt * dt);
+	max_acc[i] = fmax(max_acc[i], fabs(acc));
+	if (cycles > 3)
+	    max_jerk[i] = fmax(max_jerk[i], fabs(acc - last_acc[i]) / dt);
+	last_acc[i] = acc;
+    }
+}
+
+static void run(void)
+{
+    int i;
+
+    do {
+	tpRunCycle(&tp, PERIOD);
+	sample();
+    } while (!tpIsDone(&tp) && cycles < 100000);
+    // let the position settle, the last steps come to rest
+    for (i = 0; i < 3; i++) {
+	tpRunCycle(&tp, PERIOD);
+	sample();
+    }
+}
+
+// runs the program, prints which axes stayed within their limits
+static int check(int term_cond, double tolerance)
+{
+    int i, fail = 0;
+
+    setup(term_cond, tolerance);
+    // a line running tangentially into a quarter arc and out again
+    line(50, 0, 0, 0);
+    arc(60, 10, 50, 10);
+    line(60, 40, 0, 0);
+    // corners with blend arcs, a diagonal move limited by Y
+    line(90, 40, 0, 0);
+    line(60, 70, 0, 0);
+    // a diagonal XZ move and a rotary move
+    line(50, 70, 10, 0);
+    line(50, 70, 10, 90);
+    run();
+
+    printf("%s\n", tpIsDone(&tp) ? "done" : "not done");
+    for (i = 0; i < AXES; i++) {
+	int acc_ok = max_acc[i] <= acc_limit[i] * TOLERANCE;
+	int jerk_ok = max_jerk[i] <= jerk_limit[i] * TOLERANCE;
+	printf("%s: acceleration %s, jerk %s\n", axis_name[i],
+	       acc_ok ? "ok" : "above the limit",
+	       jerk_ok ? "ok" : "above the limit");
+	fprintf(stderr, "%s: acceleration %g of %g, jerk %g of %g\n",
+		axis_name[i], max_acc[i], acc_limit[i], max_jerk[i],
+		jerk_limit[i]);
+	fail |= !acc_ok || !jerk_ok;
+    }
+    return fail;
+}
+
+int main(int argc, char **argv)
+{
+    int fail = 0;
+
+    printf("blended\n");
+    fail |= check(TC_TERM_COND_PARABOLIC, 0.1);
+    printf("exact stop\n");
+    fail |= check(TC_TERM_COND_STOP, 0.0);
+    return fail;
+}
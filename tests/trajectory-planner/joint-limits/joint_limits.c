@@ -0,0 +1,222 @@
+/* the tp's queue time joint limit check, tpCheckJointLimits() in tp.c,
+ * with trivial kinematics and with a kinematics which scales and couples
+ * the joints. The kinematics are stand-ins for the ones motion hands the
+ * tp through tp_shared_t, they count the inverse calls and record the
+ * seed of every batch.
+ */
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <assert.h>
+
+#include "rtapi.h"
+#include "tp.h"
+#include "tp_private.h"
+#include "tp_shared.h"
+#include "tcq.h"
+
+#define QUEUE_SIZE 32
+
+static struct {
+    hal_s32_t num_dio;
+    hal_s32_t num_aio;
+    hal_s32_t arcBlendGapCycles;
+    hal_s32_t arcBlendOptDepth;
+    hal_bit_t arcBlendEnable;
+    hal_bit_t arcBlendFallbackEnable;
+    hal_float_t arcBlendRampFreq;
+    hal_float_t arcBlendTangentKinkRatio;
+    hal_float_t maxFeedScale;
+    hal_float_t net_feed_scale;
+    hal_float_t acc_limit[3];
+    hal_float_t jerk_limit[9];
+    hal_float_t vel_limit[3];
+    hal_bit_t stepping;
+    hal_u32_t enables_new;
+    hal_u32_t enables_queued;
+    hal_u32_t tcqlen;
+    hal_s32_t spindle_direction;
+    hal_float_t spindleRevs;
+    hal_float_t spindleSpeedIn;
+    hal_float_t spindle_speed;
+    hal_bit_t spindle_index_enable;
+    hal_bit_t spindle_is_atspeed;
+    hal_bit_t spindleSync;
+    hal_float_t current_vel;
+    hal_float_t requested_vel;
+    hal_float_t distance_to_go;
+    EmcPose dtg;
+} mot;
+
+static TP_STRUCT tp;
+static tp_shared_t tps;
+static TC_STRUCT tcSpace[QUEUE_SIZE];
+
+// kinematics under test
+static int scaled;		// 0: joint = axis, 1: j0 = 2x, j1 = x + y
+static int inverse_calls;
+static int seeded;		// last batch had a seed
+static double seed0;		// its joint 0
+static double commanded[EMCMOT_MAX_JOINTS];
+
+void rtapi_print_msg(int level, const char *fmt, ...)
+{
+    va_list ap;
+
+    if (level > RTAPI_MSG_ERR)
+	return;
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+}
+
+static void testDioWrite(unsigned int index, hal_bit_t value) {}
+static void testAioWrite(unsigned int index, hal_float_t value) {}
+static void testSetRotaryUnlock(int axis, hal_bit_t unlock) {}
+static hal_bit_t testGetRotaryIsUnlocked(int axis) { return 1; }
+
+static int testGetJointLimits(double *vel_limit, double *acc_limit)
+{
+    int j;
+
+    for (j = 0; j < 3; j++) {
+	vel_limit[j] = 10.0;
+	acc_limit[j] = 100.0;
+    }
+    return 3;
+}
+
+static int testKinsInverseBatch(const double *seed, const EmcPose *world,
+				double *joints, int n, int stride)
+{
+    int i;
+
+    seeded = seed != NULL;
+    seed0 = seed ? seed[0] : commanded[0];
+    for (i = 0; i < n; i++) {
+	double *q = joints + i * stride;
+	if (scaled) {
+	    q[0] = 2.0 * world[i].tran.x;
+	    q[1] = world[i].tran.x + world[i].tran.y;
+	} else {
+	    q[0] = world[i].tran.x;
+	    q[1] = world[i].tran.y;
+	}
+	q[2] = world[i].tran.z;
+	inverse_calls++;
+    }
+    return n;
+}
+
+static void setup(int with_kins)
+{
+    int i;
+
+    memset(&tps, 0, sizeof(tps));
+    tps.num_dio = &mot.num_dio;
+    tps.num_aio = &mot.num_aio;
+    tps.arcBlendGapCycles = &mot.arcBlendGapCycles;
+    tps.arcBlendOptDepth = &mot.arcBlendOptDepth;
+    tps.arcBlendEnable = &mot.arcBlendEnable;
+    tps.arcBlendRampFreq = &mot.arcBlendRampFreq;
+    tps.arcBlendTangentKinkRatio = &mot.arcBlendTangentKinkRatio;
+    tps.arcBlendFallbackEnable = &mot.arcBlendFallbackEnable;
+    tps.maxFeedScale = &mot.maxFeedScale;
+    tps.net_feed_scale = &mot.net_feed_scale;
+    tps.spindle_direction = &mot.spindle_direction;
+    tps.spindle_speed = &mot.spindle_speed;
+    tps.spindleRevs = &mot.spindleRevs;
+    tps.spindleSpeedIn = &mot.spindleSpeedIn;
+    tps.spindle_index_enable = &mot.spindle_index_enable;
+    tps.spindle_is_atspeed = &mot.spindle_is_atspeed;
+    tps.spindleSync = &mot.spindleSync;
+    tps.current_vel = &mot.current_vel;
+    tps.requested_vel = &mot.requested_vel;
+    tps.distance_to_go = &mot.distance_to_go;
+    tps.enables_new = &mot.enables_new;
+    tps.enables_queued = &mot.enables_queued;
+    tps.tcqlen = &mot.tcqlen;
+    tps.dtg[0] = &mot.dtg.tran.x;
+    tps.dtg[1] = &mot.dtg.tran.y;
+    tps.dtg[2] = &mot.dtg.tran.z;
+    tps.dtg[3] = &mot.dtg.a;
+    tps.dtg[4] = &mot.dtg.b;
+    tps.dtg[5] = &mot.dtg.c;
+    tps.dtg[6] = &mot.dtg.u;
+    tps.dtg[7] = &mot.dtg.v;
+    tps.dtg[8] = &mot.dtg.w;
+    for (i = 0; i < 3; i++) {
+	mot.acc_limit[i] = 1000.0;
+	mot.vel_limit[i] = 100.0;
+	tps.acc_limit[i] = &mot.acc_limit[i];
+	tps.vel_limit[i] = &mot.vel_limit[i];
+    }
+    for (i = 0; i < 9; i++) {
+	tps.jerk_limit[i] = &mot.jerk_limit[i];
+    }
+    tps.stepping = &mot.stepping;
+    tps.dioWrite = testDioWrite;
+    tps.aioWrite = testAioWrite;
+    tps.SetRotaryUnlock = testSetRotaryUnlock;
+    tps.GetRotaryIsUnlocked = testGetRotaryIsUnlocked;
+    // identity kinematics: motion hands out no limits, nothing is checked
+    tps.GetJointLimits = with_kins ? testGetJointLimits : NULL;
+    tps.KinsInverseBatch = with_kins ? testKinsInverseBatch : NULL;
+    mot.maxFeedScale = 1.0;
+    mot.net_feed_scale = 1.0;
+
+    assert(tpCreate(&tp, QUEUE_SIZE, tcSpace, &tps) == 0);
+    assert(tpSetCycleTime(&tp, 0.001) == 0);
+    tpSetVmax(&tp, 100.0, 100.0);
+    tpSetVlimit(&tp, 100.0);
+    tpSetAmax(&tp, 1000.0);
+    tpSetTermCond(&tp, TC_TERM_COND_STOP, 0.0);
+    inverse_calls = 0;
+}
+
+// queue a feed move to x, y at 50 units/s, print what the check left
+static void line(double x, double y)
+{
+    EmcPose end;
+    struct state_tag_t tag;
+    int calls = inverse_calls;
+
+    memset(&end, 0, sizeof(end));
+    memset(&tag, 0, sizeof(tag));
+    end.tran.x = x;
+    end.tran.y = y;
+    tpSetId(&tp, tp.nextId + 1);
+    assert(tpAddLine(&tp, end, 2, 50.0, 100.0, 1000.0, 0, 0, -1, tag) == 0);
+
+    TC_STRUCT *tc = tcqLast(&tp.queue);
+    printf("line to %g %g: maxvel %g, %d inverse calls", x, y,
+	   tc->maxvel, inverse_calls - calls);
+    if (inverse_calls > calls)
+	printf(", %s %g", seeded ? "seed" : "commanded", seed0);
+    printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+    printf("trivkins, no check\n");
+    setup(0);
+    line(10, 0);
+    line(10, 10);
+
+    printf("trivial kinematics, checked\n");
+    setup(1);
+    scaled = 0;
+    line(10, 0);
+    line(10, 10);
+
+    printf("scaled kinematics\n");
+    setup(1);
+    scaled = 1;
+    line(10, 0);		// j0 at 2 * v
+    line(10, 10);		// j1 at v, seeded with j0 = 20
+    line(0, 0);			// j0 at 2 * v, j1 at 2 * v / sqrt(2)
+    tpClear(&tp);
+    line(10, 0);		// after a clear the commanded joints seed
+    return 0;
+}
@@ -0,0 +1,15 @@
+#!/bin/sh
+rm -f joint_limits
+set -e
+SRC=../../../src
+gcc -std=gnu99 -DULAPI \
+    -I$SRC -I$SRC/emc/tp -I$SRC/emc/motion -I$SRC/emc/nml_intf \
+    -I$SRC/emc/kinematics -I$SRC/libnml/posemath -I$SRC/rtapi -I$SRC/hal/lib \
+    joint_limits.c \
+    $SRC/emc/tp/tp.c $SRC/emc/tp/tc.c $SRC/emc/tp/tcq.c \
+    $SRC/emc/tp/blendmath.c $SRC/emc/tp/spherical_arc.c $SRC/emc/tp/spline.c \
+    $SRC/emc/nml_intf/emcpose.c \
+    $SRC/libnml/posemath/_posemath.c $SRC/libnml/posemath/sincos.c \
+    ../../../lib/librtapi_math.so.0 -lm \
+    -o joint_limits
+./joint_limits
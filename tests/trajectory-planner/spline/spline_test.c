@@ -0,0 +1,63 @@
+/* length, position and end tangents of the tp's cubic Bezier segments,
+ * spline.c, including control points which coincide with an end point
+ * where the derivative of the curve vanishes.
+ */
+
+#include <stdio.h>
+#include <stdarg.h>
+
+#include "rtapi.h"
+#include "posemath.h"
+#include "spline.h"
+#include "tp_types.h"
+
+void rtapi_print_msg(int level, const char *fmt, ...)
+{
+    va_list ap;
+
+    if (level > RTAPI_MSG_ERR)
+	return;
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+}
+
+static void show(const char *name, double x1, double y1, double z1,
+		 double x2, double y2, double z2, double x3, double y3, double z3)
+{
+    PmCartesian start = { 0.0, 0.0, 0.0 };
+    PmCartesian ctrl1 = { x1, y1, z1 };
+    PmCartesian ctrl2 = { x2, y2, z2 };
+    PmCartesian end = { x3, y3, z3 };
+    CubicSpline spline;
+    PmCartesian p, t;
+    double length;
+    int i;
+
+    printf("%s\n", name);
+    if (splineInit(&spline, &start, &ctrl1, &ctrl2, &end)) {
+	printf("  refused\n");
+	return;
+    }
+    splineLength(&spline, &length);
+    printf("  length %.6f\n", length);
+    for (i = 0; i <= 4; i++) {
+	splinePoint(&spline, length * i / 4, &p);
+	printf("  at %.6f: %.6f %.6f %.6f\n", length * i / 4, p.x, p.y, p.z);
+    }
+    if (splineTangent(&spline, &t, 0) == 0)
+	printf("  start tangent %.6f %.6f %.6f\n", t.x, t.y, t.z);
+    if (splineTangent(&spline, &t, 1) == 0)
+	printf("  end tangent %.6f %.6f %.6f\n", t.x, t.y, t.z);
+}
+
+int main(int argc, char **argv)
+{
+    show("straight", 1, 0, 0, 2, 0, 0, 3, 0, 0);
+    show("straight, both control points on the start", 0, 0, 0, 0, 0, 0, 0, 0, 2);
+    show("arch", 0, 1, 0, 1, 1, 0, 1, 0, 0);
+    show("first control point on the start", 0, 0, 0, 1, 1, 0, 2, 0, 0);
+    show("second control point on the end", 0, 1, 0, 2, 0, 0, 2, 0, 0);
+    show("all points coincide", 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    return 0;
+}
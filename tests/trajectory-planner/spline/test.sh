@@ -0,0 +1,12 @@
+#!/bin/sh
+rm -f spline_test
+set -e
+SRC=../../../src
+gcc -std=gnu99 -DULAPI \
+    -I$SRC -I$SRC/emc/tp -I$SRC/emc/motion -I$SRC/emc/nml_intf \
+    -I$SRC/libnml/posemath -I$SRC/rtapi -I$SRC/hal/lib \
+    spline_test.c $SRC/emc/tp/spline.c \
+    $SRC/libnml/posemath/_posemath.c $SRC/libnml/posemath/sincos.c \
+    ../../../lib/librtapi_math.so.0 -lm \
+    -o spline_test
+./spline_test
@@ -0,0 +1,3 @@
+#!/bin/sh
+export FLAVOR=posix VIRTUALTIME=1
+halrun -f virtual-time.hal